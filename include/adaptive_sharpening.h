@@ -1,7 +1,20 @@
 #pragma once
 
+#include "frame_arena.h"
+#include "frame_features.h"
+
 #include <opencv2/opencv.hpp>
 #include <memory>
+#include <vector>
+
+#ifdef WITH_CUDA
+#include <opencv2/core/cuda.hpp>
+#include <opencv2/cudafilters.hpp>
+#endif
+
+#ifdef WITH_FUSED_KERNELS
+#include "sharpen_kernels.h"
+#endif
 
 /**
  * @brief Implements adaptive sharpening for video upscaling
@@ -56,6 +69,22 @@ public:
      */
     bool process(const cv::Mat& input, cv::Mat& output);
     
+#ifdef WITH_CUDA
+    /**
+     * @brief Apply adaptive sharpening to a device-resident image
+     * 
+     * Same processing as the host overload, but every step is enqueued on
+     * @p stream and the frame stays in device memory.
+     * 
+     * @param input The input image on the device
+     * @param output The output image on the device with adaptive sharpening applied
+     * @param stream Stream to enqueue the work on
+     * @return true if processing was successful
+     */
+    bool process(const cv::cuda::GpuMat& input, cv::cuda::GpuMat& output,
+                 cv::cuda::Stream& stream = cv::cuda::Stream::Null());
+#endif
+    
     /**
      * @brief Set the configuration parameters
      * 
@@ -70,9 +99,26 @@ public:
      */
     Config getConfig() const;
     
+    /**
+     * @brief Share scratch buffers and filters with other stages
+     * 
+     * @param arena Arena owned by the enclosing pipeline (ignored if null)
+     */
+    void setArena(std::shared_ptr<FrameArena> arena);
+    
+    /**
+     * @brief Share per-frame gray, gradient and variance maps with other stages
+     * 
+     * @param features Shared cache (see FrameFeatures), or null for a private one
+     */
+    void setFeatures(std::shared_ptr<FrameFeatures> features);
+    
 private:
     Config m_config;
     bool m_initialized;
+    std::shared_ptr<FrameArena> m_arena;  // Scratch buffers and host-path filters
+    std::shared_ptr<FrameFeatures> m_features;  // Gray, gradient and variance maps of the host input
+    bool m_shared_features;               // m_features is invalidated by its owner
     
     /**
      * @brief Create an edge mask for adaptive sharpening
@@ -93,6 +139,19 @@ private:
      */
     bool applyUnsharpMask(const cv::Mat& input, const cv::Mat& edge_mask, cv::Mat& output);
     
+    /**
+     * @brief Add edge-weighted detail (input - blurred, clipped at 0) to the input
+     * 
+     * Row-parallel fused kernel shared by both unsharp mask variants.
+     * 
+     * @param input The 8-bit input image
+     * @param blurred Blurred input of the same type
+     * @param edge_mask Edge mask (CV_32F, 0-1)
+     * @param output Preallocated output of the same size and type as @p input
+     */
+    void applyAdaptiveStrength(const cv::Mat& input, const cv::Mat& blurred,
+                               const cv::Mat& edge_mask, cv::Mat& output) const;
+    
     /**
      * @brief Calculate texture energy map for adaptive sigma
      * 
@@ -124,4 +183,47 @@ private:
                                       const cv::Mat& sigma_map, 
                                       const cv::Mat& edge_mask, 
                                       cv::Mat& output);
+    
+#ifdef WITH_CUDA
+    // Filters for the device path, rebuilt whenever the configuration changes
+    cv::Ptr<cv::cuda::Filter> m_d_sobel_x;
+    cv::Ptr<cv::cuda::Filter> m_d_sobel_y;
+    cv::Ptr<cv::cuda::Filter> m_d_laplacian;
+    cv::Ptr<cv::cuda::Filter> m_d_mask_blur;
+    cv::Ptr<cv::cuda::Filter> m_d_unsharp_blur;
+    cv::Ptr<cv::cuda::Filter> m_d_texture_box;
+    cv::Ptr<cv::cuda::Filter> m_d_sigma_blur;
+    std::vector<cv::Ptr<cv::cuda::Filter>> m_d_sigma_levels;
+    
+#ifdef WITH_FUSED_KERNELS
+    // Gaussian taps of the sigma levels for the one-pass blend kernel;
+    // no levels when the kernel size is too large for it
+    sharpen_kernels::Params m_d_blend_params;
+#endif
+    
+    /**
+     * @brief Create the device filters for the current configuration
+     * 
+     * @return true if all filters were created
+     */
+    bool createGpuFilters();
+    
+    // Device counterparts of the host helpers above
+    bool createEdgeMask(const cv::cuda::GpuMat& input, cv::cuda::GpuMat& edge_mask,
+                        cv::cuda::Stream& stream);
+    bool applyUnsharpMask(const cv::cuda::GpuMat& input, const cv::cuda::GpuMat& edge_mask,
+                          cv::cuda::GpuMat& output, cv::cuda::Stream& stream);
+    bool calculateTextureMap(const cv::cuda::GpuMat& input, cv::cuda::GpuMat& texture_map,
+                             cv::cuda::Stream& stream);
+    bool applyVariableSigmaUnsharpMask(const cv::cuda::GpuMat& input, 
+                                       const cv::cuda::GpuMat& texture_map, 
+                                       const cv::cuda::GpuMat& edge_mask, 
+                                       cv::cuda::GpuMat& output,
+                                       cv::cuda::Stream& stream);
+    void applyEdgeWeightedSharpening(const cv::cuda::GpuMat& input,
+                                     const cv::cuda::GpuMat& blurred,
+                                     const cv::cuda::GpuMat& edge_mask,
+                                     cv::cuda::GpuMat& output,
+                                     cv::cuda::Stream& stream);
+#endif
 };
\ No newline at end of file
@@ -0,0 +1,140 @@
+#pragma once
+
+#include "dnn_super_res.h"
+#include "frame_metadata.h"
+
+#include <opencv2/opencv.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/**
+ * @brief Asynchronous, frame-ordered super-resolution engine
+ *
+ * Wraps a DnnSuperRes model with a dedicated inference thread. Callers submit
+ * frames with their metadata and get a future that resolves to the upscaled
+ * result for that exact frame, so SR can run at its own rate without stalling
+ * capture and without pairing outputs with the wrong source frame. Frames are
+ * processed in submission order; the number of frames queued or in inference
+ * is bounded and the configured drop policy decides what gives way.
+ */
+class AsyncSuperRes {
+public:
+    /**
+     * @brief What happens when a frame is submitted while the engine is full
+     */
+    enum DropPolicy {
+        BLOCK,          ///< Wait in submit() until a slot frees up
+        DROP_NEWEST,    ///< Reject the submitted frame
+        DROP_OLDEST     ///< Drop the oldest frame still waiting for inference
+    };
+
+    /**
+     * @brief Configuration for the engine
+     */
+    struct Config {
+        size_t max_in_flight = 2;               ///< Frames queued plus in inference
+        DropPolicy drop_policy = DROP_OLDEST;   ///< Policy when max_in_flight is reached
+        double max_age_ms = 0.0;                ///< Skip frames older than this at inference start (0 disables)
+    };
+
+    /**
+     * @brief Outcome of one submitted frame
+     */
+    struct Result {
+        uint64_t frame_id = 0;      ///< ID of the source frame
+        FrameMetadata metadata;     ///< Metadata submitted with the frame
+        cv::Mat source;             ///< The source frame the result belongs to
+        cv::Mat output;             ///< Upscaled frame (empty if dropped or failed)
+        bool success = false;       ///< True if inference produced an output
+        bool dropped = false;       ///< True if the frame was dropped before inference
+        double inference_ms = 0.0;  ///< Time spent in the model
+    };
+
+    /**
+     * @brief Construct a new engine
+     * @param model Initialized super-resolution model (used from the engine thread only)
+     * @param config Engine configuration
+     */
+    AsyncSuperRes(std::shared_ptr<DnnSuperRes> model, const Config& config);
+
+    /**
+     * @brief Destroy the engine, dropping any frames still queued
+     */
+    ~AsyncSuperRes();
+
+    AsyncSuperRes(const AsyncSuperRes&) = delete;
+    AsyncSuperRes& operator=(const AsyncSuperRes&) = delete;
+
+    /**
+     * @brief Start the inference thread
+     * @return true if the engine is running
+     */
+    bool start();
+
+    /**
+     * @brief Stop the inference thread; queued frames resolve as dropped
+     */
+    void stop();
+
+    /**
+     * @brief Submit a frame for super-resolution
+     *
+     * The frame is held by reference (cv::Mat reference counting), not
+     * copied, so its pixels must not be modified until the result is ready.
+     *
+     * @param frame Frame to upscale
+     * @param metadata Metadata identifying the frame
+     * @return Future resolving to the result for this frame
+     */
+    std::future<Result> submit(const cv::Mat& frame, const FrameMetadata& metadata);
+
+    /**
+     * @brief Get the number of frames queued or in inference
+     * @return Number of in-flight frames
+     */
+    size_t inFlight() const;
+
+    /**
+     * @brief Get the number of frames dropped so far
+     * @return Dropped frame count
+     */
+    uint64_t droppedFrames() const;
+
+    /**
+     * @brief Check if the inference thread is running
+     * @return true if running
+     */
+    bool isRunning() const;
+
+private:
+    struct Job {
+        cv::Mat frame;
+        FrameMetadata metadata;
+        std::promise<Result> promise;
+        FrameMetadata::TimePoint submit_time;
+    };
+
+    std::shared_ptr<DnnSuperRes> m_model;
+    Config m_config;
+
+    std::deque<Job> m_pending;      // Waiting for inference, oldest first
+    size_t m_running_jobs;          // 0 or 1: job currently in the model
+    uint64_t m_dropped;
+    bool m_running;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_work_available;
+    std::condition_variable m_space_available;
+    std::thread m_worker;
+
+    // Inference thread loop
+    void workerLoop();
+
+    // Resolve a job without running it
+    void dropJob(Job& job);
+};
@@ -0,0 +1,154 @@
+#pragma once
+
+#include "dnn_super_res.h"
+#include "metrics.h"
+
+#include <opencv2/opencv.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/**
+ * @brief Dynamic batching front-end for a shared super-resolution model
+ *
+ * Any number of threads submit frames; one inference thread collects them
+ * into batches of same-sized frames and runs each batch through
+ * DnnSuperRes::upscaleBatch(), so FSRCNN and ESPCN get one forward pass per
+ * batch instead of one per frame. A batch is dispatched as soon as it is
+ * full, or once its oldest frame has waited max_wait_ms, which bounds the
+ * latency traded for throughput. Results are scattered back to each
+ * caller's future in submission order.
+ *
+ * The inference thread binds to the CUDA device that was current when
+ * start() was called, which should be the device the model was built on.
+ */
+class BatchedSuperRes {
+public:
+    /**
+     * @brief Configuration for the batcher
+     */
+    struct Config {
+        size_t max_batch = 4;               ///< Frames per forward pass
+        double max_wait_ms = 4.0;           ///< Longest a frame waits for its batch to fill
+        bool fixed_batch_shape = true;      ///< Pad short batches so the blob shape never changes (GPU only)
+    };
+
+    /**
+     * @brief Outcome of one submitted frame
+     */
+    struct Result {
+        cv::Mat output;             ///< Upscaled frame (empty on failure)
+        bool success = false;       ///< True if inference produced an output
+        size_t batch_size = 0;      ///< Frames in the batch this one ran in
+        double wait_ms = 0.0;       ///< Time spent waiting for the batch to fill
+    };
+
+    /**
+     * @brief Batching counters
+     */
+    struct Stats {
+        uint64_t batches = 0;       ///< Forward passes run
+        uint64_t frames = 0;        ///< Frames upscaled
+
+        double meanBatchSize() const { return batches > 0 ? static_cast<double>(frames) / batches : 0.0; }
+    };
+
+    /**
+     * @brief Construct a new batcher
+     * @param model Initialized super-resolution model (used from the inference thread only)
+     * @param config Batcher configuration
+     */
+    BatchedSuperRes(std::shared_ptr<DnnSuperRes> model, const Config& config);
+
+    /**
+     * @brief Destroy the batcher, failing any frames still queued
+     */
+    ~BatchedSuperRes();
+
+    BatchedSuperRes(const BatchedSuperRes&) = delete;
+    BatchedSuperRes& operator=(const BatchedSuperRes&) = delete;
+
+    /**
+     * @brief Start the inference thread
+     * @return true if the batcher is running
+     */
+    bool start();
+
+    /**
+     * @brief Stop the inference thread; queued frames resolve as failed
+     */
+    void stop();
+
+    /**
+     * @brief Submit a frame for batched super-resolution
+     *
+     * The frame is held by reference (cv::Mat reference counting), not
+     * copied, so its pixels must not be modified until the result is ready.
+     *
+     * @param frame Frame to upscale
+     * @return Future resolving to the result for this frame
+     */
+    std::future<Result> submit(const cv::Mat& frame);
+
+    /**
+     * @brief Submit a frame and wait for its result
+     * @param input Frame to upscale
+     * @param output Upscaled frame
+     * @return true if upscaling was successful
+     */
+    bool upscale(const cv::Mat& input, cv::Mat& output);
+
+    /**
+     * @brief Get the batching counters
+     * @return Current statistics
+     */
+    Stats getStats() const;
+
+    /**
+     * @brief Check if the inference thread is running
+     * @return true if running
+     */
+    bool isRunning() const;
+
+    /**
+     * @brief Get the configured batch size
+     * @return Frames per forward pass
+     */
+    size_t maxBatch() const { return m_config.max_batch; }
+
+private:
+    struct Job {
+        cv::Mat frame;
+        std::promise<Result> promise;
+        std::chrono::steady_clock::time_point submit_time;
+    };
+
+    std::shared_ptr<DnnSuperRes> m_model;
+    Config m_config;
+
+    std::deque<Job> m_pending;      // Waiting for a batch, oldest first
+    Stats m_stats;
+    bool m_running;
+    int m_device;                   // CUDA device of the thread that called start()
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_work_available;
+    std::thread m_worker;
+
+    Metrics::Id m_metric_forward;
+    Metrics::Id m_metric_wait;
+
+    // Inference thread loop
+    void workerLoop();
+
+    // Number of pending frames that can share a batch with the oldest one
+    size_t batchableCount() const;
+
+    // Resolve a job without running it
+    static void failJob(Job& job);
+};
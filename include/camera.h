@@ -1,5 +1,8 @@
 #pragma once
 
+#include "frame_metadata.h"
+#include "raw_capture.h"
+
 #include <opencv2/opencv.hpp>
 #include <string>
 #include <memory>
@@ -7,30 +10,87 @@
 #include <thread>
 #include <mutex>
 #include <atomic>
+#include <condition_variable>
+
+#ifdef WITH_CUDA
+#include <opencv2/core/cuda.hpp>
+#if defined(HAVE_OPENCV_CUDACODEC)
+#include <opencv2/cudacodec.hpp>
+#endif
+#endif
 
 class Camera {
 public:
-    // Constructor with camera index or video file
+    // Constructor with camera index or video file (.vpraw files are mapped
+    // and replayed without decoding, see raw_capture.h)
     Camera(int camera_index = 0);
     Camera(const std::string& video_source);
     ~Camera();
 
+    // Decode video files with NVDEC when available (call before initialize;
+    // enabled by default, falls back to the CPU decoders when it fails)
+    void setHardwareDecode(bool enable);
+    
+    // Deliver frames no larger than max_size (aspect ratio kept; call before
+    // initialize). Cameras are asked for the smaller mode directly; NVDEC
+    // frames are scaled on the device before they leave it, and CPU-decoded
+    // frames are scaled once at read time. An empty size disables scaling.
+    void setMaxOutputSize(const cv::Size& max_size);
+    
+    // Deliver host frames as planar I420 (see yuv_frame.h) instead of BGR
+    // (call before initialize). GStreamer camera pipelines then stop at the
+    // YUV stage instead of converting to BGR, and delivered sizes are
+    // rounded down to even. Device frames are always BGR.
+    void setDeliverI420(bool enable);
+    
     // Initialize the camera with specific resolution and framerate
     bool initialize(int width = 1280, int height = 720, int fps = 60);
     
-    // Get the next frame (non-blocking)
+    // Wait until a new frame is ready, up to timeout_ms. Live cameras are
+    // grabbed on a background thread started by the first read or wait;
+    // other sources read on demand, so this returns at once for them
+    bool waitForFrame(int timeout_ms);
+    
+    // Get the next frame (non-blocking); BGR, or I420 with setDeliverI420.
+    // Live cameras return the newest complete frame, or false when none
+    // has arrived since the last call
     bool getFrame(cv::Mat& frame);
     
-    // Check if camera is opened successfully
+    // Get the next frame and stamp its capture time and backend timestamp
+    // into metadata (frame_id and stage stamps are left to the caller)
+    bool getFrame(cv::Mat& frame, FrameMetadata& metadata);
+    
+#ifdef WITH_CUDA
+    // Get the next frame on the device (8-bit BGR). With NVDEC the frame is
+    // decoded into device memory and never touches the host; other sources
+    // are read on the host and uploaded on the given stream
+    bool getFrame(cv::cuda::GpuMat& frame, FrameMetadata& metadata,
+                  cv::cuda::Stream& stream = cv::cuda::Stream::Null());
+#endif
+    
+    // Move a file source to a frame index. Raw files seek exactly; decoded
+    // files seek through the backend, which may land on a nearby keyframe
+    bool seekFrame(int64_t index);
+    
+    // Number of frames in a file source, -1 when unknown or live
+    int64_t getFrameCount() const;
+    
+    // Check if frames are decoded on the GPU
+    bool isGpuDecoding() const;
+    
+    // Check if camera is opened successfully (raw files report false once
+    // played to the end, until seekFrame)
     bool isOpened() const;
     
-    // Get camera properties
+    // Get camera properties (width and height are the delivered frame size)
     double getFPS() const;
     int getWidth() const;
     int getHeight() const;
     
-    // List available cameras on the system
-    static std::vector<int> listAvailableCameras();
+    // List available cameras on the system. Opening every index is slow, so
+    // the result is cached on disk and reused while the set of video device
+    // nodes is unchanged (Linux; elsewhere every call probes)
+    static std::vector<int> listAvailableCameras(bool use_cache = true);
     
     // Try different camera backends
     bool tryBackends();
@@ -45,13 +105,76 @@ private:
     std::string video_source;
     bool is_file;
     
-    // New private members for threaded capture
+    // Threaded capture for live cameras. The grab thread and the reader
+    // share a triple buffer: the grabber fills its back slot and exchanges
+    // it with the middle one, the reader exchanges the middle slot with its
+    // front one. Neither side waits for the other and the reader always
+    // gets the newest complete frame.
+    struct GrabbedFrame {
+        cv::Mat image;
+        FrameMetadata::TimePoint capture_time;
+        double source_timestamp = -1.0;
+    };
+    static constexpr int kFreshSlot = 4;    // Set in grab_middle when unread
+    static constexpr int kSlotMask = 3;
     std::thread grab_thread;
-    std::mutex frame_mutex;
-    cv::Mat latest_frame;
-    std::atomic<bool> has_new_frame{false};
+    GrabbedFrame grab_slots[3];
+    std::atomic<int> grab_middle{1};        // Middle slot index | kFreshSlot
+    int grab_back = 0;                      // Owned by the grab thread
+    int grab_front = 2;                     // Owned by the reader
+    std::mutex frame_mutex;                 // Only for readers waiting on frame_ready
+    std::condition_variable frame_ready;
+    std::atomic<bool> reader_waiting{false};
     std::atomic<bool> thread_running{false};
     
+    // Hardware decode state
+    bool hardware_decode = true;
+    uint64_t decoded_frames = 0;
+    cv::Size max_output;                // Empty when frames are delivered at source size
+    bool deliver_i420 = false;
+#if defined(WITH_CUDA) && defined(HAVE_OPENCV_CUDACODEC)
+    cv::Ptr<cv::cudacodec::VideoReader> gpu_reader;
+    cv::cuda::GpuMat gpu_decoded;       // Decoder output before conversion to BGR
+    bool gpu_frame_pending = false;     // First frame decoded by initialize()
+#endif
+#ifdef WITH_CUDA
+    cv::cuda::GpuMat gpu_staging;       // Device copy for host reads of GPU frames
+    cv::Mat host_staging;               // Host copy for device reads of CPU frames
+    cv::cuda::GpuMat device_scaled;     // Full-size device frame before scaling
+#endif
+    cv::Mat host_scaled;                // Full-size host frame before scaling
+    
+    // Raw replay: frames are views on the mapped file, valid while the
+    // Camera lives
+    std::unique_ptr<RawFrameReader> raw_reader;
+    cv::Mat host_i420;                  // Scaled BGR host frame before conversion
+    
     // Background frame grabbing method
     void grabLoop();
+    
+    // Start the grab thread for live cameras
+    void startGrabbing();
+    
+    // Take the newest frame from the triple buffer, false when none is new
+    bool takeGrabbedFrame(cv::Mat& frame, FrameMetadata& metadata);
+    
+    // Read the next host frame at source size
+    bool readHostFrame(cv::Mat& frame, FrameMetadata& metadata);
+    
+    // Read the next raw file frame (BGR unless delivering I420)
+    bool readRawFrame(cv::Mat& frame, FrameMetadata& metadata);
+    
+    // Read the next host frame as I420 at output size
+    bool readI420Frame(cv::Mat& frame, FrameMetadata& metadata);
+    
+    // Frame size after applying max_output to a source size
+    cv::Size outputSize(int source_width, int source_height) const;
+    
+    // Open the file with NVDEC, returns false if unavailable
+    bool initializeGpuDecoder();
+    
+    // Camera probe cache: identity of the current /dev/video* nodes (empty
+    // when it can't be determined) and the cache file location
+    static std::string deviceFingerprint();
+    static std::string probeCachePath();
 };
\ No newline at end of file
@@ -0,0 +1,192 @@
+#pragma once
+
+#include "frame_metadata.h"
+#include "metrics.h"
+#include "upscaler.h"
+
+#include <opencv2/opencv.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Spreads upscaling work across every available GPU
+ *
+ * Holds one Upscaler replica per device, each with its own model, filters
+ * and stream, built and run on a thread bound to that device. A submitted
+ * frame goes to the device with the shortest expected wait: its queue depth
+ * times its recent per-frame latency, so a slower or busier GPU gets fewer
+ * frames. Frames tagged with a stream ID stay on the device that stream
+ * was first given, which keeps temporal state on one replica.
+ *
+ * submit() returns a future per frame; consuming the futures in submission
+ * order gives the outputs in source order whichever device finished first.
+ * Without CUDA a single host replica is used.
+ */
+class DeviceScheduler {
+public:
+    /**
+     * @brief Configuration for the scheduler
+     */
+    struct Config {
+        Upscaler::Algorithm algorithm = Upscaler::BICUBIC;      ///< Algorithm for every replica
+        int target_width = 1920;                                ///< Output width
+        int target_height = 1080;                               ///< Output height
+        std::vector<int> devices;                               ///< CUDA devices to use (empty = all)
+        size_t max_queue_per_device = 2;                        ///< Frames queued plus running per device
+    };
+
+    /**
+     * @brief Outcome of one submitted frame
+     */
+    struct Result {
+        uint64_t frame_id = 0;      ///< ID of the source frame
+        FrameMetadata metadata;     ///< Metadata submitted with the frame
+        cv::Mat source;             ///< The source frame the result belongs to
+        cv::Mat output;             ///< Upscaled frame (empty if dropped or failed)
+        bool success = false;       ///< True if the replica produced an output
+        bool dropped = false;       ///< True if the scheduler stopped before running the frame
+        int device = -1;            ///< Device that ran the frame (-1 for the host replica)
+        double upscale_ms = 0.0;    ///< Time spent in the replica
+    };
+
+    /**
+     * @brief Per-device load report
+     */
+    struct DeviceStats {
+        int device = -1;            ///< CUDA device ID (-1 for the host replica)
+        std::string name;           ///< Device name
+        uint64_t frames = 0;        ///< Frames completed
+        size_t queue_depth = 0;     ///< Frames queued plus running right now
+        double mean_ms = 0.0;       ///< Recent per-frame latency (moving average)
+        double utilisation = 0.0;   ///< Fraction of wall time spent upscaling since start()
+    };
+
+    /**
+     * @brief Construct a new scheduler
+     * @param config Scheduler configuration
+     */
+    explicit DeviceScheduler(const Config& config);
+
+    /**
+     * @brief Destroy the scheduler, dropping any frames still queued
+     */
+    ~DeviceScheduler();
+
+    DeviceScheduler(const DeviceScheduler&) = delete;
+    DeviceScheduler& operator=(const DeviceScheduler&) = delete;
+
+    /**
+     * @brief Build a replica on every device and start their threads
+     * @return true if at least one replica is running
+     */
+    bool start();
+
+    /**
+     * @brief Stop every replica; queued frames resolve as dropped
+     */
+    void stop();
+
+    /**
+     * @brief Submit a frame for upscaling
+     *
+     * Blocks while every eligible device is at its queue limit. The frame is
+     * held by reference, not copied, so its pixels must not be modified
+     * until the result is ready.
+     *
+     * @param frame Frame to upscale
+     * @param metadata Metadata identifying the frame
+     * @param stream_id Keep frames of this stream on one device (-1 = any device)
+     * @return Future resolving to the result for this frame
+     */
+    std::future<Result> submit(const cv::Mat& frame, const FrameMetadata& metadata, int stream_id = -1);
+
+    /**
+     * @brief Get the number of frames that can be in flight at once
+     * @return Running replicas times the per-device queue limit
+     */
+    size_t capacity() const;
+
+    /**
+     * @brief Get the number of running replicas
+     * @return Replica count
+     */
+    size_t deviceCount() const;
+
+    /**
+     * @brief Get the load of every running replica
+     * @return One entry per device
+     */
+    std::vector<DeviceStats> getDeviceStats() const;
+
+    /**
+     * @brief Format the per-device load as a table
+     * @return Printable report
+     */
+    std::string toTable() const;
+
+    /**
+     * @brief Get the algorithm every replica runs
+     * @return Configured algorithm
+     */
+    Upscaler::Algorithm getAlgorithm() const { return m_config.algorithm; }
+
+    /**
+     * @brief Check if the scheduler is running
+     * @return true if running
+     */
+    bool isRunning() const;
+
+private:
+    struct Job {
+        cv::Mat frame;
+        FrameMetadata metadata;
+        std::promise<Result> promise;
+    };
+
+    // One replica; everything but the thread and upscaler is guarded by m_mutex
+    struct Device {
+        int id = -1;
+        std::string name;
+        std::unique_ptr<Upscaler> upscaler;     // Created and used on the device thread only
+        std::deque<Job> queue;
+        size_t running = 0;
+        uint64_t frames = 0;
+        double ema_ms = 0.0;
+        double busy_ms = 0.0;
+        bool ready = false;                     // Replica initialized
+        bool failed = false;                    // Replica could not be initialized
+        Metrics::Id metric = Metrics::INVALID_ID;
+        std::condition_variable work_available;
+        std::thread worker;
+
+        size_t depth() const { return queue.size() + running; }
+    };
+
+    Config m_config;
+    std::vector<std::unique_ptr<Device>> m_devices;
+    std::map<int, Device*> m_stream_devices;    // Stream ID -> device it is pinned to
+    std::chrono::steady_clock::time_point m_start_time;
+    bool m_running;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_space_available;
+    std::condition_variable m_replica_ready;
+
+    // Device thread: bind the device, build the replica, run its queue
+    void deviceLoop(Device& device);
+
+    // Pick the device for a frame, or null if every candidate is full
+    Device* selectDevice(int stream_id);
+
+    // Resolve a job without running it
+    static void dropJob(Job& job, int device);
+};
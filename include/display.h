@@ -1,25 +1,43 @@
 #pragma once
 
 #include <opencv2/opencv.hpp>
+#include <opencv2/core/opengl.hpp>
 #include <string>
 #include <atomic>
 #include <mutex>
 #include "timer.h"
 
+#ifdef WITH_CUDA
+#include <opencv2/core/cuda.hpp>
+#endif
+
 /**
  * @brief Display component for rendering processed frames with minimal latency
  * 
  * This class handles the efficient rendering of processed video frames
  * with options for performance monitoring and latency optimization.
+ * The performance HUD is a small cached layer that is redrawn a few times
+ * a second, not text drawn into every full-resolution frame.
  */
 class Display {
 public:
+    /**
+     * @brief How frames are presented
+     */
+    enum Backend {
+        HIGHGUI,    ///< cv::imshow of a host frame (device frames are downloaded)
+        OPENGL,     ///< OpenGL window; device frames reach the texture through CUDA-GL interop
+        HEADLESS    ///< No window; frames are timed and counted only (servers, benchmarks)
+    };
+    
     /**
      * @brief Construct a new Display object
      * @param width Display window width
      * @param height Display window height
+     * @param backend Presentation backend (OPENGL falls back to HIGHGUI when
+     *        OpenCV was built without OpenGL)
      */
-    Display(int width = 1920, int height = 1080);
+    Display(int width = 1920, int height = 1080, Backend backend = HIGHGUI);
     
     /**
      * @brief Destroy the Display object and free resources
@@ -40,6 +58,42 @@ public:
      */
     bool renderFrame(const cv::Mat& frame);
     
+#ifdef WITH_CUDA
+    /**
+     * @brief Render a device-resident frame to the display
+     * 
+     * On the OpenGL backend the frame is copied into the window's texture on
+     * the device and never visits host memory.
+     * 
+     * @param frame The 8-bit BGR frame to render
+     * @return true if rendering was successful
+     */
+    bool renderFrame(const cv::cuda::GpuMat& frame);
+#endif
+    
+    /**
+     * @brief Get the backend in use (after initialize(), which may fall back)
+     * @return Presentation backend
+     */
+    Backend getBackend() const { return m_backend; }
+    
+    /**
+     * @brief Pump window events without presenting a new frame
+     * 
+     * Keeps the window responsive when the previous frame is being held.
+     */
+    void processEvents();
+    
+    /**
+     * @brief Get the most recent key pressed in the display window
+     * 
+     * Keys are collected by the thread that renders, so other threads can
+     * react to them without calling cv::waitKey themselves.
+     * 
+     * @return Key code, or -1 if no key was pressed since the last call
+     */
+    int takeLastKey();
+    
     /**
      * @brief Enable or disable performance metrics overlay
      * @param show Whether to show metrics
@@ -80,6 +134,7 @@ private:
     std::string m_window_name;
     int m_width;
     int m_height;
+    Backend m_backend;
     bool m_show_metrics;
     bool m_vsync_enabled;
     int m_max_fps;
@@ -89,6 +144,7 @@ private:
     double m_last_render_time;
     std::chrono::time_point<std::chrono::high_resolution_clock> m_last_frame_time;
     std::atomic<double> m_current_fps;
+    std::atomic<int> m_last_key;
     
     // Frame rate control
     std::chrono::microseconds m_frame_interval;
@@ -97,8 +153,30 @@ private:
     // Thread synchronization
     std::mutex m_render_mutex;
     
+    // Cached HUD layer, redrawn at most every kOverlayIntervalMs
+    static constexpr int kOverlayIntervalMs = 250;
+    cv::Mat m_overlay;
+    std::chrono::time_point<std::chrono::high_resolution_clock> m_overlay_time;
+    bool m_overlay_dirty;              // Redrawn since the last texture upload
+    
+    // OpenGL backend
+    cv::ogl::Texture2D m_frame_texture;
+    cv::ogl::Texture2D m_overlay_texture;
+    
+#ifdef WITH_CUDA
+    cv::Mat m_host_staging;            // Download target for device frames on HighGUI
+#endif
+    
     // Internal methods
-    void drawPerformanceOverlay(cv::Mat& frame);
+    bool updateOverlay();
+    cv::Rect overlayRect(const cv::Size& frame_size) const;
+    bool showHost(const cv::Mat& frame);
+    bool showTexture(cv::InputArray frame);
+    void pollKey();
+    void finishRender();
     void updateFPS();
     void limitFrameRate();
+    
+    // Window redraw callback for the OpenGL backend
+    static void drawTexture(void* userdata);
 };
\ No newline at end of file
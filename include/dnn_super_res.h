@@ -1,11 +1,17 @@
 #pragma once
 
+#include "memory_budget.h"
+
 #include <opencv2/opencv.hpp>
 #include <opencv2/dnn.hpp>
 #include <opencv2/dnn_superres.hpp>
 #include <string>
+#include <vector>
 #include <memory>
 #include <iostream>
+#include <algorithm>
+
+class TensorRTEngine;
 
 class DnnSuperRes {
 public:
@@ -16,12 +22,28 @@ public:
         LAPSRN,
         REAL_ESRGAN   // Add this for the new model
     };
+    
+    // Arithmetic precision
+    enum Precision {
+        PRECISION_FP32,
+        PRECISION_FP16,   // DNN_TARGET_CUDA_FP16, or FP16 kernels in TensorRT
+        PRECISION_INT8    // CPU with OpenVINO: FSRCNN/ESPCN IR quantised by quantize_int8.py
+    };
+    
+    // Inference engine. TensorRT runs the ONNX models on the GPU; OpenVINO
+    // runs every model on CPU-only hosts (DNN_BACKEND_INFERENCE_ENGINE)
+    enum InferenceBackend {
+        BACKEND_OPENCV,
+        BACKEND_TENSORRT, // Needs a WITH_TENSORRT build; engines are cached on disk
+        BACKEND_OPENVINO  // Needs OpenCV built with OpenVINO; ignored on the GPU
+    };
         
     // Constructor with model type parameter
     DnnSuperRes(const std::string& model_path = "models/FSRCNN_x4.pb", 
                 const std::string& model_name = "fsrcnn", 
                 int scale = 4,
                 ModelType type = FSRCNN);
+    ~DnnSuperRes();
     
     // Initialize the model
     bool initialize();
@@ -29,6 +51,27 @@ public:
     // Upscale an image
     bool upscale(const cv::Mat& input, cv::Mat& output);
     
+    // Upscale several images with one forward() where the model allows it.
+    // FSRCNN and ESPCN batch same-sized inputs into one NCHW blob; a batch
+    // shorter than pad_to is padded by repeating its last image so the blob
+    // shape stays fixed. Other models, and mixed sizes, run one at a time.
+    bool upscaleBatch(const std::vector<cv::Mat>& inputs, std::vector<cv::Mat>& outputs,
+                      size_t pad_to = 0);
+    
+    // Check if upscaleBatch() runs a real batched forward pass
+    bool supportsBatching() const { return !m_batch_net.empty(); }
+    
+    // Upscale a single 8-bit luma plane (FSRCNN and ESPCN only), resized to
+    // the target size when one is set. Lets I420 callers skip the colour
+    // conversions upscale() does around the model
+    bool upscaleLuma(const cv::Mat& luma, cv::Mat& output);
+    
+    // Check if upscaleLuma() is available for the loaded model
+    bool supportsLuma() const { return !m_batch_net.empty(); }
+    
+    // Check if inference runs on a CUDA device
+    bool isUsingGPU() const { return m_on_gpu; }
+    
     // Check if model is loaded
     bool isInitialized() const { return m_initialized; }
     
@@ -41,6 +84,52 @@ public:
     // Set to use GPU if available
     void setUseGPU(bool use_gpu) { m_use_gpu = use_gpu; }
     
+    // Select precision and backend; both take effect on initialize()
+    void setPrecision(Precision precision) { m_precision = precision; }
+    void setInferenceBackend(InferenceBackend backend) { m_backend = backend; }
+    void setEngineCacheDir(const std::string& dir) { m_engine_cache_dir = dir; }
+    
+    // Directory of the INT8 IR models (<model stem>.xml and .bin)
+    void setInt8ModelDir(const std::string& dir) { m_int8_dir = dir; }
+    
+    // Check if this OpenCV build can run networks through OpenVINO on the CPU
+    static bool isOpenVINOAvailable();
+    
+    // Defaults picked up by every model constructed afterwards, so the
+    // choice made on the command line reaches models built inside Upscaler
+    static void setDefaultPrecision(Precision precision);
+    static void setDefaultInferenceBackend(InferenceBackend backend);
+    static void setDefaultIncremental(bool enable);
+    static Precision getDefaultPrecision();
+    static InferenceBackend getDefaultInferenceBackend();
+    
+    // Describe the engine in use, e.g. "TensorRT FP16"
+    std::string getInferenceDescription() const;
+    
+    // Configure tiled RealESRGAN inference: the input is split into
+    // tile_size x tile_size tiles overlapping by tile_overlap pixels, run
+    // tile_batch tiles per forward() and feather-blended at the seams.
+    // A tile_size of 0 feeds the whole frame as one blob.
+    void setTiling(int tile_size, int tile_overlap = 16, int tile_batch = 4) {
+        m_tile_size = std::max(0, tile_size);
+        m_tile_overlap = std::max(0, tile_overlap);
+        m_tile_batch = std::max(1, tile_batch);
+    }
+    
+    // Incremental tiled inference for mostly static scenes: a tile whose
+    // low-res input (plus a halo of tile_overlap pixels) differs from what it
+    // was last inferred on by less than threshold (mean absolute difference,
+    // 0-255 scale) reuses last frame's output. Every refresh_interval frames
+    // all tiles are re-inferred to bound drift. Only the tiled path uses it.
+    void setIncremental(bool enable, double threshold = 3.0, int refresh_interval = 60);
+    
+    // Fraction of tiles reused on the last incremental frame (0-1)
+    double getReusedTileFraction() const { return m_reused_fraction; }
+    
+    // Estimated bytes of live activations for one forward pass over
+    // frames images of the given input size (or RealESRGAN tiles)
+    size_t estimateWorkspaceBytes(const cv::Size& input, size_t frames = 1) const;
+    
 private:
     std::string m_model_path;
     std::string m_model_name;
@@ -48,15 +137,76 @@ private:
     bool m_initialized;
     bool m_use_gpu;
     cv::dnn::Net m_net;
+    cv::dnn::Net m_batch_net;   // Raw FSRCNN/ESPCN graph for batched luma inference
+    bool m_on_gpu;
+    Precision m_precision;
+    InferenceBackend m_backend;
+    std::string m_engine_cache_dir;
+    std::string m_int8_dir;     // Empty = "int8" next to the model
+    bool m_on_openvino;         // CPU inference runs through OpenVINO
+    bool m_int8;                // m_batch_net is the quantised IR
+#ifdef WITH_TENSORRT
+    std::unique_ptr<TensorRTEngine> m_trt;     // Set when TensorRT runs the ONNX model
+#endif
+    
+    // cv::dnn target for the GPU at the requested precision (drops to FP32
+    // if this OpenCV build has no FP16 CUDA target)
+    int cudaTarget();
+    
+    // Run one blob through TensorRT if active, otherwise cv::dnn
+    cv::Mat forwardNet(const cv::Mat& blob);
+    
+    // Point a CPU network at OpenVINO when it is selected and available
+    void setCpuBackend(cv::dnn::Net& net) const;
+    
+    // Load the quantised IR of an FSRCNN/ESPCN model into m_batch_net
+    bool loadInt8Model();
+    
+    // Run same-sized BGR images through the luma graph in one forward
+    // pass, chroma upscaled bicubically; false if the blob is unexpected
+    bool forwardLumaBatch(const std::vector<cv::Mat>& inputs, std::vector<cv::Mat>& outputs, size_t pad_to);
     int m_target_width;
     int m_target_height;
     ModelType m_model_type;
     
+    // Tiled inference settings (RealESRGAN only)
+    int m_tile_size;
+    int m_tile_overlap;
+    int m_tile_batch;
+    cv::Mat m_tile_weight;      // Feathering weights for one output tile (CV_32FC3)
+    
+    // Incremental inference state
+    bool m_incremental;
+    double m_change_threshold;
+    int m_refresh_interval;
+    int m_frames_since_refresh;
+    int m_prev_scale;
+    double m_reused_fraction;
+    cv::Mat m_prev_input;       // Low-res input each tile was last inferred on (CV_32FC3)
+    cv::Mat m_prev_output;      // Blended output of the previous frame (CV_32FC3)
+    
+    // Activation workspace charged to the memory budget; RealESRGAN tiles
+    // (batch, then size) shrink until it fits
+    MemoryBudget::Account m_memory;
+    cv::Size m_workspace_input;
+    size_t m_workspace_frames;
+    void fitWorkspace(const cv::Size& input, size_t frames);
+    
+    // Check whether a tile's neighbourhood changed since it was last inferred
+    bool tileChanged(const cv::Mat& float_rgb, const cv::Rect& tile) const;
+    
     // Add RealESRGAN-specific processing methods
     bool upscaleRealESRGAN(const cv::Mat& input, cv::Mat& output);
     void preProcessRealESRGAN(const cv::Mat& input, cv::Mat& processed);
     void postProcessRealESRGAN(const cv::Mat& processed, cv::Mat& output);
     
+    // Run the network over overlapping tiles of a normalized RGB float image
+    // and blend the upscaled tiles into output (CV_32FC3)
+    bool forwardTiled(const cv::Mat& float_rgb, cv::Mat& output);
+    
+    // Build feathering weights for an upscaled tile with the given ramp width
+    void buildTileWeight(const cv::Size& tile_size, int ramp);
+    
     // Original dnn_superres implementation
     cv::dnn_superres::DnnSuperResImpl m_sr;
 };
\ No newline at end of file
@@ -0,0 +1,158 @@
+#pragma once
+
+#include "metrics.h"
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <deque>
+
+#ifdef WITH_CUDA
+#include <opencv2/core/cuda.hpp>
+#endif
+
+/**
+ * @brief Reuses results for repeated input frames
+ *
+ * Many sources repeat frames: 24p content in 60p containers, screen
+ * recordings, paused feeds. Before a frame goes through an expensive chain,
+ * lookup() compares a small grey thumbnail of it (the signature) with the
+ * previous input and with a few older inputs found by a hash of their
+ * thumbnail. A match within the threshold hands back that input's stored
+ * result instead of processing the frame again.
+ *
+ * Usage per frame: lookup(); on a miss process the frame and store() the
+ * result. Host and device results are kept separately: device lookups only
+ * hit results stored from the device, and vice versa.
+ */
+class DuplicateDetector {
+public:
+    /**
+     * @brief Configuration of the duplicate check
+     */
+    struct Config {
+        float threshold = 1.0f;                 ///< Max mean absolute signature difference (8-bit levels)
+        size_t cache_entries = 4;               ///< Older results kept besides the previous one
+        cv::Size signature_size = cv::Size(64, 36); ///< Thumbnail size compared per frame
+    };
+
+    /**
+     * @brief Counters since construction or reset()
+     */
+    struct Stats {
+        uint64_t checked = 0;                   ///< Frames looked up
+        uint64_t previous_hits = 0;             ///< Frames matching the previous input
+        uint64_t cache_hits = 0;                ///< Frames matching an older input
+    };
+
+    /**
+     * @brief Default constructor
+     */
+    DuplicateDetector();
+
+    /**
+     * @brief Constructor with configuration
+     * @param config Threshold and cache size
+     */
+    explicit DuplicateDetector(const Config& config);
+
+    /**
+     * @brief Look a host frame up
+     * @param input Input frame (any 8-bit layout, including I420)
+     * @param output Receives a copy of the stored result on a hit
+     * @return true if @p output was filled and the frame needs no processing
+     */
+    bool lookup(const cv::Mat& input, cv::Mat& output);
+
+    /**
+     * @brief Store the result for the frame of the last missed lookup
+     * @param output Processed frame (copied)
+     */
+    void store(const cv::Mat& output);
+
+#ifdef WITH_CUDA
+    /**
+     * @brief Look a device frame up
+     *
+     * The signature is computed on @p stream and downloaded, so this waits
+     * for the stream once per frame.
+     *
+     * @param input Input frame on the device
+     * @param output Receives a copy of the stored result on a hit
+     * @param stream CUDA stream for the signature and the copy
+     * @return true if @p output was filled and the frame needs no processing
+     */
+    bool lookup(const cv::cuda::GpuMat& input, cv::cuda::GpuMat& output,
+                cv::cuda::Stream& stream = cv::cuda::Stream::Null());
+
+    /**
+     * @brief Store the device result for the frame of the last missed lookup
+     * @param output Processed frame (copied on @p stream)
+     * @param stream CUDA stream for the copy
+     */
+    void store(const cv::cuda::GpuMat& output, cv::cuda::Stream& stream = cv::cuda::Stream::Null());
+#endif
+
+    /**
+     * @brief Drop every stored result (after the processing changed)
+     */
+    void reset();
+
+    /**
+     * @brief Get the hit counters
+     * @return Counters since construction or reset()
+     */
+    Stats getStats() const { return m_stats; }
+
+    /**
+     * @brief Set configuration parameters (drops stored results)
+     * @param config New configuration
+     */
+    void setConfig(const Config& config);
+
+    /**
+     * @brief Get current configuration
+     * @return Current configuration
+     */
+    Config getConfig() const { return m_config; }
+
+private:
+    struct Entry {
+        uint64_t hash = 0;
+        int input_type = -1;
+        cv::Size input_size;
+        cv::Mat signature;
+        cv::Mat host_output;
+#ifdef WITH_CUDA
+        cv::cuda::GpuMat device_output;
+#endif
+    };
+
+    Config m_config;
+    Stats m_stats;
+    std::deque<Entry> m_entries;                // Most recent first
+    Entry m_pending;                            // Input of the last missed lookup
+    bool m_has_pending;
+    cv::Mat m_scaled;
+    cv::Mat m_signature;
+
+    Metrics::Id m_metric_previous;
+    Metrics::Id m_metric_cached;
+
+#ifdef WITH_CUDA
+    cv::cuda::GpuMat m_d_scaled;
+    cv::cuda::GpuMat m_d_signature;
+#endif
+
+    // Match the signature in m_signature against the stored inputs, moving
+    // a hit to the front; returns the entry or nullptr
+    Entry* match(int input_type, const cv::Size& input_size, bool device);
+
+    // Remember the current signature for store()
+    void setPending(int input_type, const cv::Size& input_size);
+
+    // Push the pending entry to the front and trim the cache
+    Entry& pushPending();
+
+    // Hash of the signature quantised to 16 levels
+    static uint64_t hashSignature(const cv::Mat& signature);
+};
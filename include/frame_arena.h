@@ -0,0 +1,214 @@
+#pragma once
+
+#include "memory_budget.h"
+#include "metrics.h"
+
+#include <opencv2/opencv.hpp>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#ifdef WITH_CUDA
+#include <opencv2/core/cuda.hpp>
+#include <opencv2/cudafilters.hpp>
+#endif
+
+/**
+ * @brief Reusable per-pipeline frame buffers and filter objects
+ *
+ * Buffers are looked up by a name plus the requested size and type. A lookup
+ * allocates only when the buffer is missing or the request no longer matches
+ * it, so a frame loop that asks for the same buffers every frame allocates
+ * nothing after the first frame. Lookups with a string literal do not
+ * allocate either. Host, page-locked host and device buffers are kept
+ * separately. Device filters are cached by name, type and parameters.
+ *
+ * Every allocation is counted. endFrame() closes a frame so the per-frame
+ * count shows whether the loop has reached steady state. The totals are also
+ * published to the metrics registry ("arena.allocations",
+ * "arena.filter_creations"), and the bytes held are charged to the
+ * MemoryBudget at endFrame().
+ *
+ * An arena is not thread-safe; share it between the stages of one pipeline
+ * thread only. References stay valid until clear() or a lookup of the same
+ * name with a different size or type; scratch buffers also go when
+ * endFrame() finds them idle.
+ */
+class FrameArena {
+public:
+    /// Maximum number of filter parameters that take part in the cache key
+    static constexpr size_t MAX_FILTER_PARAMS = 4;
+
+    /// Frames a scratch buffer may go unused before endFrame() releases it
+    static constexpr uint64_t SCRATCH_IDLE_FRAMES = 120;
+
+    /**
+     * @brief Allocation counters
+     */
+    struct Stats {
+        uint64_t frames = 0;                    ///< Frames closed with endFrame()
+        uint64_t host_allocations = 0;          ///< Host buffer (re)allocations
+        uint64_t pinned_allocations = 0;        ///< Page-locked buffer (re)allocations
+        uint64_t device_allocations = 0;        ///< Device buffer (re)allocations
+        uint64_t filter_creations = 0;          ///< Device filters constructed
+        uint64_t scratch_releases = 0;          ///< Idle scratch buffers released
+        uint64_t last_frame_allocations = 0;    ///< All allocations during the last closed frame
+        size_t host_bytes = 0;                  ///< Bytes held in host and page-locked buffers
+        size_t device_bytes = 0;                ///< Bytes held in device buffers
+    };
+
+    FrameArena();
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    /**
+     * @brief Get a host buffer
+     * @param name Buffer name, unique within the arena (e.g. "sharpen.gray")
+     * @param size Required size
+     * @param type Required OpenCV type
+     * @return Buffer of exactly @p size and @p type (contents unspecified)
+     */
+    cv::Mat& host(const char* name, cv::Size size, int type);
+
+#ifdef WITH_CUDA
+    /**
+     * @brief Get a page-locked host buffer for asynchronous transfers
+     * @param name Buffer name, unique within the arena
+     * @param size Required size
+     * @param type Required OpenCV type
+     * @return Header over page-locked memory of exactly @p size and @p type
+     */
+    cv::Mat& pinned(const char* name, cv::Size size, int type);
+
+    /**
+     * @brief Get a device buffer
+     * @param name Buffer name, unique within the arena
+     * @param size Required size
+     * @param type Required OpenCV type
+     * @return Buffer of exactly @p size and @p type (contents unspecified)
+     */
+    cv::cuda::GpuMat& device(const char* name, cv::Size size, int type);
+
+    /**
+     * @brief Get a device scratch buffer keyed by stream, size and type
+     *
+     * For helpers that run at many sizes and on several streams (see
+     * gpu_utils): a named buffer would be reallocated whenever the size
+     * changes, and a buffer shared between streams could be overwritten
+     * while another stream still reads it. Buffers found here are only
+     * reused by later work on the same stream, and endFrame() releases
+     * those not asked for in the last SCRATCH_IDLE_FRAMES frames.
+     *
+     * @param stream Stream the buffer is used on
+     * @param size Required size
+     * @param type Required OpenCV type
+     * @param slot Distinguishes buffers a helper needs at the same time
+     * @return Buffer of exactly @p size and @p type (contents unspecified)
+     */
+    cv::cuda::GpuMat& scratch(cv::cuda::Stream& stream, cv::Size size, int type, int slot);
+
+    /**
+     * @brief Get a cached device filter, creating it on first use
+     *
+     * @param name Filter name, unique within the arena
+     * @param type Source type the filter is created for
+     * @param params Parameters the filter was built from (kernel size,
+     *               sigma...); a change creates a new filter
+     * @param create Factory called on a cache miss
+     * @return The cached filter
+     */
+    template <typename Factory>
+    const cv::Ptr<cv::cuda::Filter>& filter(const char* name, int type,
+                                            std::initializer_list<double> params,
+                                            Factory&& create) {
+        std::array<double, MAX_FILTER_PARAMS> key = packParams(params);
+        auto it = m_filters.find(name);
+        if (it == m_filters.end()) {
+            it = m_filters.emplace(name, std::vector<FilterEntry>()).first;
+        }
+        for (const FilterEntry& entry : it->second) {
+            if (entry.type == type && entry.params == key) {
+                return entry.filter;
+            }
+        }
+        it->second.push_back({type, key, create()});
+        countFilterCreation();
+        return it->second.back().filter;
+    }
+#endif
+
+    /**
+     * @brief Close the current frame, latch its allocation count and
+     *        release idle scratch buffers
+     */
+    void endFrame();
+
+    /**
+     * @brief Get the allocation counters
+     * @return Counters since construction or the last clear()
+     */
+    Stats getStats() const;
+
+    /**
+     * @brief Release every buffer and filter and reset the counters
+     */
+    void clear();
+
+private:
+    // Buffers are found by name, whatever size they currently have
+    struct NameLess {
+        using is_transparent = void;
+        bool operator()(const std::string& a, const std::string& b) const { return a < b; }
+        bool operator()(const std::string& a, const char* b) const { return std::strcmp(a.c_str(), b) < 0; }
+        bool operator()(const char* a, const std::string& b) const { return std::strcmp(a, b.c_str()) < 0; }
+    };
+
+    std::map<std::string, cv::Mat, NameLess> m_host;
+
+#ifdef WITH_CUDA
+    struct PinnedBuffer {
+        cv::cuda::HostMem memory;
+        cv::Mat header;
+    };
+
+    // Filters sharing a name differ only in type or parameters, so a short
+    // list per name is searched linearly
+    struct FilterEntry {
+        int type;
+        std::array<double, MAX_FILTER_PARAMS> params;
+        cv::Ptr<cv::cuda::Filter> filter;
+    };
+
+    std::map<std::string, PinnedBuffer, NameLess> m_pinned;
+    std::map<std::string, cv::cuda::GpuMat, NameLess> m_device;
+    std::map<std::string, std::vector<FilterEntry>, NameLess> m_filters;
+
+    // Stream handle, rows, cols, type, slot
+    using ScratchKey = std::tuple<void*, int, int, int, int>;
+
+    struct ScratchEntry {
+        cv::cuda::GpuMat buffer;
+        uint64_t last_used;             // Frame of the last lookup
+    };
+
+    std::map<ScratchKey, ScratchEntry> m_scratch;
+
+    static std::array<double, MAX_FILTER_PARAMS> packParams(std::initializer_list<double> params);
+    void countFilterCreation();
+#endif
+
+    Stats m_stats;
+    uint64_t m_frame_allocations;       // Allocations since the last endFrame()
+    Metrics::Id m_metric_allocations;
+    Metrics::Id m_metric_filters;
+    MemoryBudget::Account m_host_memory;    // Updated by endFrame()
+    MemoryBudget::Account m_device_memory;
+
+    void countAllocation(uint64_t& counter);
+};
@@ -1,6 +1,11 @@
 #pragma once
 
+#include "frame_metadata.h"
+#include "memory_budget.h"
+#include "metrics.h"
+
 #include <opencv2/opencv.hpp>
+#include <string>
 #include <vector>
 #include <mutex>
 #include <atomic>
@@ -8,20 +13,56 @@
 #include <memory>
 
 /**
- * @brief A thread-safe ring buffer for video frames
+ * @brief A single-producer/single-consumer ring buffer for video frames
+ * 
+ * This class implements a lock-free ring buffer for efficiently passing
+ * frames between exactly one producer thread and one consumer thread.
+ * Slots are preallocated and reused: the producer copies into a slot's
+ * existing storage and the consumer takes the slot by swapping it with
+ * its own cv::Mat, so steady-state operation performs no allocations.
+ * A mutex and condition variables are only touched when a blocking call
+ * actually has to wait.
+ * 
+ * What a push into a full buffer does is set by the drop policy. The
+ * evicting policies move the consumer's index from the producer, so with
+ * them push and pop serialize on the mutex (frames are still copied
+ * outside it).
  * 
- * This class implements a zero-copy ring buffer for efficiently passing
- * frames between producer and consumer threads. It uses cv::Mat with
- * reference counting to avoid unnecessary copying of frame data.
+ * Slot storage is charged to the host pool of the MemoryBudget; size a
+ * buffer in bytes with capacityForBytes() or MemoryBudget::fit().
  */
 class FrameBuffer {
 public:
+    /**
+     * @brief What happens to frames when the buffer is full or stale
+     */
+    enum DropPolicy {
+        BLOCK,          ///< A blocking push waits for space; a non-blocking one is rejected
+        DROP_NEWEST,    ///< The pushed frame is rejected, push never waits
+        DROP_OLDEST,    ///< The oldest queued frame is evicted (latest wins), push never waits
+        MAX_AGE         ///< DROP_OLDEST, and pop skips frames older than the age limit
+    };
+    
     /**
      * @brief Construct a new FrameBuffer with specified capacity
      * @param capacity Maximum number of frames the buffer can hold
      */
     explicit FrameBuffer(size_t capacity = 10);
     
+    /**
+     * @brief Construct a new FrameBuffer with preallocated slots
+     * 
+     * Page-locked slots let a consumer that uploads popped frames on a CUDA
+     * stream overlap the transfer with device work; without CUDA the flag
+     * is ignored.
+     * 
+     * @param capacity Maximum number of frames the buffer can hold
+     * @param frame_size Size of the frames that will be pushed
+     * @param type OpenCV type of the frames that will be pushed
+     * @param page_locked Back the slots with page-locked host memory
+     */
+    FrameBuffer(size_t capacity, const cv::Size& frame_size, int type, bool page_locked = false);
+    
     /**
      * @brief Delete copy constructor
      */
@@ -46,8 +87,8 @@ public:
      * @brief Add a frame to the buffer (producer)
      * 
      * This function is called by the producer thread to add a new frame
-     * to the buffer. If the buffer is full, it will overwrite the oldest
-     * frame.
+     * to the buffer. The frame is copied into the next free slot, reusing
+     * the slot's storage when its size and type match.
      * 
      * @param frame The frame to add to the buffer
      * @param blocking If true, blocks until space is available
@@ -55,11 +96,23 @@ public:
      */
     bool pushFrame(const cv::Mat& frame, bool blocking = true);
     
+    /**
+     * @brief Add a frame and its metadata to the buffer (producer)
+     * 
+     * @param frame The frame to add to the buffer
+     * @param metadata Envelope travelling with the frame
+     * @param blocking If true, blocks until space is available
+     * @return true if frame was added, false if buffer was full (when non-blocking)
+     */
+    bool pushFrame(const cv::Mat& frame, const FrameMetadata& metadata, bool blocking = true);
+    
     /**
      * @brief Get the next frame from the buffer (consumer)
      * 
      * This function is called by the consumer thread to retrieve the 
-     * next frame from the buffer.
+     * next frame from the buffer. The slot is swapped with @p frame, so the
+     * consumer takes ownership without a copy and its previous storage is
+     * recycled by the producer.
      * 
      * @param frame Output parameter that will contain the next frame
      * @param blocking If true, will block until a frame is available
@@ -67,6 +120,16 @@ public:
      */
     bool popFrame(cv::Mat& frame, bool blocking = true);
     
+    /**
+     * @brief Get the next frame and its metadata from the buffer (consumer)
+     * 
+     * @param frame Output parameter that will contain the next frame
+     * @param metadata Output parameter that will contain the frame's envelope
+     * @param blocking If true, will block until a frame is available
+     * @return true if a frame was retrieved, false if buffer is empty (when non-blocking)
+     */
+    bool popFrame(cv::Mat& frame, FrameMetadata& metadata, bool blocking = true);
+    
     /**
      * @brief Get the number of frames currently in the buffer
      * @return The number of frames
@@ -91,22 +154,130 @@ public:
      */
     size_t capacity() const;
     
+    /**
+     * @brief Get the number of frames that fit in a byte budget
+     * @param bytes Bytes available for slots
+     * @param frame_size Size of the frames that will be pushed
+     * @param type OpenCV type of the frames that will be pushed
+     * @return Capacity, at least 1
+     */
+    static size_t capacityForBytes(size_t bytes, const cv::Size& frame_size, int type);
+    
+    /**
+     * @brief Set the drop policy (before the producer and consumer start)
+     * 
+     * MAX_AGE measures age from the frame's capture time, or from the push
+     * when the metadata has none. The newest frame is never skipped, so a
+     * stalled source still delivers its last frame.
+     * 
+     * @param policy Policy for full buffers
+     * @param max_age_ms Age limit for MAX_AGE
+     */
+    void setDropPolicy(DropPolicy policy, double max_age_ms = 0.0);
+    
+    /**
+     * @brief Get the drop policy
+     * @return Policy for full buffers
+     */
+    DropPolicy getDropPolicy() const { return m_policy; }
+    
+    /**
+     * @brief Name the buffer and export its drops as a counter
+     * 
+     * Registers buffer.<name>.dropped with Metrics, so each stage boundary
+     * reports its own drops, and names the buffer's memory account.
+     * 
+     * @param name Buffer name (letters, digits, '_' and '.')
+     */
+    void setName(const std::string& name);
+    
+    /**
+     * @brief Get the number of frames rejected or evicted so far
+     * @return Dropped frame count
+     */
+    uint64_t droppedFrames() const;
+    
+    /**
+     * @brief Preallocate every slot for frames of the given size and type
+     * 
+     * Must not be called while a producer or consumer is active.
+     * 
+     * @param frame_size Size of the frames that will be pushed
+     * @param type OpenCV type of the frames that will be pushed
+     */
+    void reserve(const cv::Size& frame_size, int type);
+    
     /**
      * @brief Clear all frames from the buffer
+     * 
+     * Slot storage is kept for reuse. Must be called from the consumer
+     * thread or while the producer is idle.
      */
     void clear();
     
+    /**
+     * @brief Close the buffer for shutdown
+     * 
+     * Wakes any blocked push or pop. Pushes fail from then on; pops drain
+     * the frames still queued.
+     */
+    void close();
+    
+    /**
+     * @brief Accept pushes again after close()
+     * 
+     * Must not be called while a producer or consumer is active.
+     */
+    void reopen();
+    
 private:
+    // Cache line size used to keep producer and consumer indices apart
+    static constexpr size_t kCacheLine = 64;
+    
     size_t m_capacity;                 // Maximum number of frames
-    std::vector<cv::Mat> m_frames;     // The actual frame storage
-    size_t m_head;                     // Index where next frame will be written
-    size_t m_tail;                     // Index where next frame will be read
-    std::atomic<size_t> m_size;        // Number of frames currently in buffer
+    bool m_page_locked;                // Slots use page-locked memory
+    std::vector<cv::Mat> m_frames;     // Preallocated slot storage
+    std::vector<FrameMetadata> m_metadata; // Envelope for each slot
+    std::vector<FrameMetadata::TimePoint> m_push_times; // Push time of each slot (MAX_AGE)
     
-    mutable std::mutex m_mutex;        // Mutex for thread safety
+    // Drop policy and accounting
+    DropPolicy m_policy;
+    FrameMetadata::Clock::duration m_max_age;
+    std::atomic<uint64_t> m_dropped;
+    Metrics::Id m_metric_dropped;
+    MemoryBudget::Account m_memory;    // Slot storage, as capacity full-size frames
+    
+    // Monotonic counters; slot index is counter % capacity
+    alignas(kCacheLine) std::atomic<size_t> m_head;  // Next write position (producer-owned)
+    alignas(kCacheLine) std::atomic<size_t> m_tail;  // Next read position (consumer-owned unless evicting)
+    
+    // Slow path used only when a blocking call has to wait
+    alignas(kCacheLine) std::atomic<bool> m_producer_waiting;
+    std::atomic<bool> m_consumer_waiting;
+    std::atomic<bool> m_closed;
+    mutable std::mutex m_mutex;
     std::condition_variable m_not_empty; // Signaled when buffer becomes non-empty
     std::condition_variable m_not_full;  // Signaled when buffer becomes non-full
     
-    // Advance index with wrap-around
-    size_t nextIndex(size_t current) const;
+    // Map a monotonic counter to a slot index
+    size_t slotIndex(size_t counter) const;
+    
+    // Give a slot storage for a frame, page-locked when requested
+    void prepareSlot(cv::Mat& slot, const cv::Size& frame_size, int type);
+    
+    // Copy a frame into a slot the consumer can't see yet
+    void writeSlot(size_t head, const cv::Mat& frame, const FrameMetadata& metadata);
+    
+    // Push and pop for the evicting policies, under the mutex
+    bool pushEvicting(const cv::Mat& frame, const FrameMetadata& metadata);
+    bool popEvicting(cv::Mat& frame, FrameMetadata& metadata, bool blocking);
+    
+    // Check if a queued frame is past the MAX_AGE limit
+    bool isStale(size_t counter, FrameMetadata::TimePoint now) const;
+    
+    // Count dropped frames
+    void recordDrop(uint64_t count = 1);
+    
+    // Wake a waiting peer, if any
+    void notify(std::atomic<bool>& waiting, std::condition_variable& cv);
 };
\ No newline at end of file
@@ -0,0 +1,169 @@
+#pragma once
+
+#include "memory_budget.h"
+#include "metrics.h"
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Lazily computed analysis maps of the images of one frame
+ *
+ * Sharpening, bilateral filtering, bicubic enhancement and temporal
+ * consistency all start from the same analysis: a grayscale copy, Sobel
+ * gradients, an edge map or a local variance map. FrameFeatures computes
+ * each map of an image the first time a stage asks for it and hands the
+ * same map to every later request for that image, so a stage that needs the
+ * gray frame for two masks, or two stages looking at the same image, convert
+ * and differentiate it only once.
+ *
+ * Images are recognised by their data pointer, size and type. A map stays
+ * valid until invalidate() drops the image, or the whole frame; the owner
+ * of the chain calls invalidate() when a frame is done, and a stage that
+ * writes into an image it (or anyone) analysed drops that image. Buffers
+ * are kept across frames, so a steady resolution allocates nothing after
+ * the first frame. The bytes held are charged to the MemoryBudget as
+ * "frame_features".
+ *
+ * Stages receive a cache through their setFeatures(). Whoever owns a shared
+ * cache invalidates it once per frame (the Upscaler for its chain); a stage
+ * given none keeps a private cache and drops it at the start of every call,
+ * so its maps never outlive the call that computed them.
+ *
+ * Not thread-safe; share it between the stages of one pipeline thread only,
+ * like FrameArena. References stay valid until the image is invalidated.
+ */
+class FrameFeatures {
+public:
+    /// Images tracked at once; the least recently used is evicted beyond that
+    static constexpr size_t MAX_IMAGES = 8;
+
+    /**
+     * @brief Cache counters
+     */
+    struct Stats {
+        uint64_t requests = 0;          ///< Maps requested
+        uint64_t computations = 0;      ///< Maps computed (cache misses)
+    };
+
+    FrameFeatures();
+
+    FrameFeatures(const FrameFeatures&) = delete;
+    FrameFeatures& operator=(const FrameFeatures&) = delete;
+
+    /**
+     * @brief Get the grayscale image
+     * @param image 8-bit BGR, BGRA or single-channel image
+     * @return CV_8UC1 luminance (a copy for single-channel input)
+     */
+    const cv::Mat& gray(const cv::Mat& image);
+
+    /**
+     * @brief Get the horizontal 3x3 Sobel derivative of the gray image
+     * @param image Image as for gray()
+     * @return CV_16S derivative
+     */
+    const cv::Mat& gradientX(const cv::Mat& image);
+
+    /**
+     * @brief Get the vertical 3x3 Sobel derivative of the gray image
+     * @param image Image as for gray()
+     * @return CV_16S derivative
+     */
+    const cv::Mat& gradientY(const cv::Mat& image);
+
+    /**
+     * @brief Get the gradient magnitude of the gray image
+     * @param image Image as for gray()
+     * @return CV_32F L2 norm of the Sobel derivatives
+     */
+    const cv::Mat& gradientMagnitude(const cv::Mat& image);
+
+    /**
+     * @brief Get the Canny edge map of the gray image
+     * @param image Image as for gray()
+     * @param low_threshold Hysteresis low threshold
+     * @param high_threshold Hysteresis high threshold
+     * @return CV_8UC1 map, 255 on edges; other thresholds recompute it
+     */
+    const cv::Mat& edgeMask(const cv::Mat& image, double low_threshold, double high_threshold);
+
+    /**
+     * @brief Get the local variance of the gray image
+     * @param image Image as for gray()
+     * @param window Side of the square box window
+     * @return CV_32F variance in squared 8-bit levels; another window recomputes it
+     */
+    const cv::Mat& localVariance(const cv::Mat& image, int window);
+
+    /**
+     * @brief Drop the maps of one image
+     *
+     * Call after writing into an image whose maps may have been requested.
+     *
+     * @param image Image whose contents changed
+     */
+    void invalidate(const cv::Mat& image);
+
+    /**
+     * @brief Drop the maps of every image, keeping the buffers
+     */
+    void invalidate();
+
+    /**
+     * @brief Get the cache counters
+     * @return Counters since construction
+     */
+    Stats getStats() const { return m_stats; }
+
+private:
+    enum Feature : unsigned {
+        GRAY = 1u << 0,
+        GRADIENTS = 1u << 1,
+        MAGNITUDE = 1u << 2,
+        EDGES = 1u << 3,
+        VARIANCE = 1u << 4
+    };
+
+    struct Entry {
+        const uchar* data = nullptr;    // Key: the analysed image
+        cv::Size size;
+        int type = -1;
+        bool active = false;
+        unsigned valid = 0;             // Feature bits computed for the current image
+        uint64_t last_use = 0;
+
+        cv::Mat gray;
+        cv::Mat grad_x;
+        cv::Mat grad_y;
+        cv::Mat magnitude;
+        cv::Mat edges;
+        cv::Mat variance;
+        cv::Mat scratch_float;          // Gray as float for the variance
+        cv::Mat scratch_mean;
+        double edge_low = 0.0;
+        double edge_high = 0.0;
+        int variance_window = 0;
+    };
+
+    std::vector<Entry> m_entries;
+    uint64_t m_uses;
+    Stats m_stats;
+    MemoryBudget::Account m_memory;
+
+    // Hot-path metric IDs
+    Metrics::Id m_metric_requests;
+    Metrics::Id m_metric_computations;
+
+    // Find the image's entry, claiming one (same size first) on a miss
+    Entry& lookup(const cv::Mat& image);
+
+    // Count a request; true if the map is cached and was built with the same parameters
+    bool request(Entry& entry, unsigned feature, bool params_match = true);
+
+    // Compute the Sobel derivatives into the entry
+    void computeGradients(Entry& entry);
+
+    void updateMemory();
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * @brief Per-frame envelope carried alongside each cv::Mat through the pipeline
+ *
+ * Holds a monotonically increasing frame ID, the time the frame was captured
+ * and enter/exit stamps for every pipeline stage, so latency can be measured
+ * from capture to display and broken down per stage.
+ */
+struct FrameMetadata {
+    using Clock = std::chrono::high_resolution_clock;
+    using TimePoint = Clock::time_point;
+
+    /**
+     * @brief Pipeline stages that record enter/exit stamps
+     */
+    enum Stage {
+        CAPTURE = 0,    ///< Frame acquisition from the source
+        PROCESS,        ///< Upscaling and enhancement
+        DISPLAY,        ///< Rendering / presentation
+        STAGE_COUNT
+    };
+
+    /**
+     * @brief Enter/exit stamps of one stage (default-constructed when not visited)
+     */
+    struct StageStamp {
+        TimePoint enter;
+        TimePoint exit;
+    };
+
+    uint64_t frame_id = 0;                 ///< Sequential ID assigned at capture
+    TimePoint capture_time;                ///< Host time the frame was grabbed from the source
+    double source_timestamp_ms = -1.0;     ///< Backend timestamp (driver time for cameras), -1 if unavailable
+    std::array<StageStamp, STAGE_COUNT> stages{};
+
+    /**
+     * @brief Stamp the entry into a stage with the current time
+     * @param stage Stage being entered
+     */
+    void enter(Stage stage) {
+        stages[stage].enter = Clock::now();
+    }
+
+    /**
+     * @brief Stamp the exit from a stage with the current time
+     * @param stage Stage being left
+     */
+    void exit(Stage stage) {
+        stages[stage].exit = Clock::now();
+    }
+
+    /**
+     * @brief Time spent inside a stage
+     * @param stage Stage to query
+     * @return Duration in milliseconds, or 0 if the stage was not completed
+     */
+    double stageDuration(Stage stage) const {
+        const StageStamp& s = stages[stage];
+        if (s.enter == TimePoint() || s.exit == TimePoint()) {
+            return 0.0;
+        }
+        return std::chrono::duration<double, std::milli>(s.exit - s.enter).count();
+    }
+
+    /**
+     * @brief Time spent queued between the exit of one stage and the entry of the next
+     * @param from Stage the frame left
+     * @param to Stage the frame entered next
+     * @return Duration in milliseconds, or 0 if either stamp is missing
+     */
+    double queueDuration(Stage from, Stage to) const {
+        if (stages[from].exit == TimePoint() || stages[to].enter == TimePoint()) {
+            return 0.0;
+        }
+        return std::chrono::duration<double, std::milli>(stages[to].enter - stages[from].exit).count();
+    }
+
+    /**
+     * @brief Glass-to-glass latency from capture to the end of display
+     * @return Latency in milliseconds, or 0 if the frame has not been displayed
+     */
+    double glassToGlass() const {
+        if (capture_time == TimePoint() || stages[DISPLAY].exit == TimePoint()) {
+            return 0.0;
+        }
+        return std::chrono::duration<double, std::milli>(stages[DISPLAY].exit - capture_time).count();
+    }
+};
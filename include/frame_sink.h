@@ -0,0 +1,83 @@
+#pragma once
+
+#include "frame_metadata.h"
+
+#include <opencv2/opencv.hpp>
+#include <string>
+
+#ifdef WITH_CUDA
+#include <opencv2/core/cuda.hpp>
+#endif
+
+/**
+ * @brief Destination for finished frames (file, network, ...)
+ *
+ * Pipeline hands every new output frame to each registered sink before it
+ * is rendered, so write() must not block on encoding or I/O: sinks copy the
+ * frame and do the work on their own thread. A sink is configured when it
+ * is constructed; start() opens it and stop() flushes and closes it.
+ */
+class FrameSink {
+public:
+    virtual ~FrameSink() = default;
+
+    /**
+     * @brief Open the sink and start its worker
+     * @return true if the sink accepts frames
+     */
+    virtual bool start() = 0;
+
+    /**
+     * @brief Flush queued frames and close the sink
+     */
+    virtual void stop() = 0;
+
+    /**
+     * @brief Queue a host frame
+     * @param frame Frame of the configured size and format (copied)
+     * @param metadata Envelope of the frame (capture time, stage stamps)
+     * @return true if the frame was queued
+     */
+    virtual bool write(const cv::Mat& frame, const FrameMetadata& metadata) = 0;
+
+#ifdef WITH_CUDA
+    /**
+     * @brief Queue a device frame
+     *
+     * The default downloads on @p stream and queues the host copy; sinks
+     * that encode from device memory override it.
+     *
+     * @param frame 8-bit BGR frame of the configured size (copied)
+     * @param metadata Envelope of the frame
+     * @param stream Stream the frame was produced on
+     * @return true if the frame was queued
+     */
+    virtual bool write(const cv::cuda::GpuMat& frame, const FrameMetadata& metadata,
+                       cv::cuda::Stream& stream) {
+        try {
+            frame.download(m_download, stream);
+            stream.waitForCompletion();
+        } catch (const cv::Exception&) {
+            return false;
+        }
+        return write(m_download, metadata);
+    }
+#endif
+
+    /**
+     * @brief Check if the sink accepts frames
+     * @return true between start() and stop()
+     */
+    virtual bool isRunning() const = 0;
+
+    /**
+     * @brief Describe the sink for logs
+     * @return Destination (file name, URL)
+     */
+    virtual std::string describe() const = 0;
+
+#ifdef WITH_CUDA
+private:
+    cv::Mat m_download;     // Host copy for the default device write
+#endif
+};
@@ -0,0 +1,106 @@
+#pragma once
+
+#ifdef WITH_FUSED_KERNELS
+
+#include <cstddef>
+#include <cuda_runtime_api.h>
+
+/**
+ * @brief Launch interface for the project's custom CUDA kernels
+ *
+ * Kept free of OpenCV types so the .cu translation unit only needs the CUDA
+ * runtime; FusedEnhancer and VideoEnhancer fill in the parameters.
+ */
+namespace fused_kernels {
+
+/// Unsharp blur and edge-preserving filter radius (5x5 windows)
+constexpr int kRadius = 2;
+
+/**
+ * @brief Parameters for one fused sharpen + edge-preserving filter pass
+ */
+struct Params {
+    // Adaptive sharpening
+    float strength;                                 ///< Overall sharpening strength
+    float edge_strength;                            ///< Strength multiplier on edges
+    float smooth_strength;                          ///< Strength multiplier on flat areas
+    float edge_threshold;                           ///< Edge response at the mask midpoint
+    float blur_weights[2 * kRadius + 1];            ///< Normalised 1D Gaussian for the unsharp blur
+
+    // Edge-preserving post filter
+    float space_weights[2 * kRadius + 1][2 * kRadius + 1];  ///< Spatial bilateral weights
+    float color_coeff;                              ///< -1 / (2 * sigma_color^2)
+    float detail_threshold;                         ///< Detail mask midpoint (0-1)
+    float edge_preserve;                            ///< Extra weight of the sharpened pixel on detail
+};
+
+/**
+ * @brief Sharpen, filter and blend a BGR 8-bit image in one tiled pass
+ *
+ * @param src Source pixels (CV_8UC3)
+ * @param src_step Source row pitch in bytes
+ * @param dst Destination pixels (CV_8UC3, must not alias @p src)
+ * @param dst_step Destination row pitch in bytes
+ * @param width Image width
+ * @param height Image height
+ * @param params Filter parameters
+ * @param stream Stream to enqueue the kernel on
+ * @return true if the kernel was launched
+ */
+bool launchFusedEnhance(const unsigned char* src, size_t src_step,
+                        unsigned char* dst, size_t dst_step,
+                        int width, int height,
+                        const Params& params, cudaStream_t stream);
+
+/**
+ * @brief 3D colour LUT held in a CUDA array behind a filtering texture
+ *
+ * The texture hardware does the trilinear interpolation, so a lookup is one
+ * fetch per pixel instead of eight.
+ */
+struct Lut3D {
+    cudaArray_t array = nullptr;
+    cudaTextureObject_t texture = 0;
+    int size = 0;                                   ///< Lattice points per axis
+};
+
+/**
+ * @brief Upload a BGR lattice into a 3D texture (replaces @p lut's contents)
+ *
+ * @param bgr Lattice as (size * size) rows of size BGR 8-bit entries,
+ *            row b + g * size, column r (the VideoEnhancer layout)
+ * @param size Lattice points per axis (at least 2)
+ * @param lut Texture to (re)create
+ * @return true if the texture is ready
+ */
+bool uploadLut3D(const unsigned char* bgr, int size, Lut3D& lut);
+
+/**
+ * @brief Release the array and texture of a LUT
+ * @param lut LUT to release (left empty)
+ */
+void releaseLut3D(Lut3D& lut);
+
+/**
+ * @brief Map a BGR 8-bit image through a 3D LUT, optionally scaled per pixel
+ *
+ * @param src Source pixels (CV_8UC3)
+ * @param src_step Source row pitch in bytes
+ * @param dst Destination pixels (CV_8UC3, may alias @p src)
+ * @param dst_step Destination row pitch in bytes
+ * @param width Image width
+ * @param height Image height
+ * @param lut LUT from uploadLut3D()
+ * @param gain Per-pixel CV_32F gain applied to the result, or null
+ * @param gain_step Gain row pitch in bytes
+ * @param stream Stream to enqueue the kernel on
+ * @return true if the kernel was launched
+ */
+bool launchApplyLut3D(const unsigned char* src, size_t src_step,
+                      unsigned char* dst, size_t dst_step,
+                      int width, int height, const Lut3D& lut,
+                      const float* gain, size_t gain_step, cudaStream_t stream);
+
+} // namespace fused_kernels
+
+#endif // WITH_FUSED_KERNELS
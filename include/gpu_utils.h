@@ -0,0 +1,111 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#ifdef WITH_CUDA
+#include <opencv2/core/cuda.hpp>
+#include <opencv2/cudafilters.hpp>
+
+/**
+ * @brief Small helpers shared by the device-resident enhancement paths
+ *
+ * The CUDA filter factories only accept single-channel (or four-channel)
+ * 8-bit images, and most blends in the enhancement modules are per-pixel
+ * weighted sums. These helpers keep those operations on the device and on
+ * the caller's stream so a frame never has to visit host memory between
+ * stages. Their temporaries come from a per-thread FrameArena, keyed by
+ * stream, size and type, so they allocate only on first use.
+ */
+namespace gpu_utils {
+
+/**
+ * @brief Apply a single-channel filter to every channel of an image
+ *
+ * @param filter Filter created for the single-channel type of @p src
+ * @param src Source image (any channel count)
+ * @param dst Destination image with the same channel count as @p src
+ * @param stream Stream to enqueue the work on
+ */
+void applyPerChannel(const cv::Ptr<cv::cuda::Filter>& filter,
+                     const cv::cuda::GpuMat& src,
+                     cv::cuda::GpuMat& dst,
+                     cv::cuda::Stream& stream);
+
+/**
+ * @brief Replicate a single-channel map to match a channel count
+ *
+ * @param src Single-channel source map
+ * @param channels Number of channels required
+ * @param dst Destination (aliases @p src when channels is 1)
+ * @param stream Stream to enqueue the work on
+ */
+void replicateChannels(const cv::cuda::GpuMat& src, int channels,
+                       cv::cuda::GpuMat& dst, cv::cuda::Stream& stream);
+
+/**
+ * @brief Per-pixel linear interpolation: dst = a + weight * (b - a)
+ *
+ * @param a Image selected where weight is 0
+ * @param b Image selected where weight is 1 (same size and type as @p a)
+ * @param weight Single-channel CV_32F weight map
+ * @param dst Destination with the type of @p a (saturated)
+ * @param stream Stream to enqueue the work on
+ */
+void lerp(const cv::cuda::GpuMat& a, const cv::cuda::GpuMat& b,
+          const cv::cuda::GpuMat& weight, cv::cuda::GpuMat& dst,
+          cv::cuda::Stream& stream);
+
+/**
+ * @brief Per-pixel weighted add: dst = base + weight * delta
+ *
+ * @param base Base image
+ * @param delta Detail image with the channel count of @p base (any depth)
+ * @param weight Single-channel CV_32F weight map
+ * @param dst Destination with the type of @p base (saturated)
+ * @param stream Stream to enqueue the work on
+ */
+void weightedAdd(const cv::cuda::GpuMat& base, const cv::cuda::GpuMat& delta,
+                 const cv::cuda::GpuMat& weight, cv::cuda::GpuMat& dst,
+                 cv::cuda::Stream& stream);
+
+/**
+ * @brief Smooth step used by the mask builders: dst = 1 / (1 + exp(-(src - center) * steepness))
+ *
+ * @param src Single-channel CV_32F input
+ * @param center Midpoint of the transition
+ * @param steepness Transition steepness
+ * @param dst Single-channel CV_32F output
+ * @param stream Stream to enqueue the work on
+ */
+void sigmoid(const cv::cuda::GpuMat& src, double center, double steepness,
+             cv::cuda::GpuMat& dst, cv::cuda::Stream& stream);
+
+/**
+ * @brief Back a host image with page-locked memory
+ *
+ * Stream uploads and downloads from pageable memory are staged through a
+ * driver buffer and block the calling thread; from page-locked memory they
+ * are true DMA transfers that overlap with kernels on other streams. The
+ * image is reallocated only when its size, type or allocator differ or its
+ * storage is shared, so calling this every frame costs nothing in steady
+ * state.
+ *
+ * @param mat Host image to (re)allocate
+ * @param size Required size
+ * @param type Required OpenCV type
+ */
+void ensurePageLocked(cv::Mat& mat, const cv::Size& size, int type);
+
+/**
+ * @brief Check whether ensurePageLocked() would keep an image as it is
+ *
+ * @param mat Host image
+ * @param size Required size
+ * @param type Required OpenCV type
+ * @return true if @p mat solely owns page-locked storage of that size and type
+ */
+bool isPageLocked(const cv::Mat& mat, const cv::Size& size, int type);
+
+} // namespace gpu_utils
+
+#endif // WITH_CUDA
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Fixed-bucket latency histogram with percentile queries
+ *
+ * Samples are counted in linear buckets of a fixed resolution, so recording
+ * is O(1) and allocation-free and percentiles are exact to within one bucket.
+ * Samples beyond the configured range fall into an overflow bucket and are
+ * reported as the largest value seen. Safe to record from one thread while
+ * another thread queries.
+ */
+class LatencyHistogram {
+public:
+    /**
+     * @brief Construct a histogram
+     * @param max_ms Largest latency tracked with full resolution
+     * @param resolution_ms Width of each bucket in milliseconds
+     */
+    explicit LatencyHistogram(double max_ms = 2000.0, double resolution_ms = 0.25);
+
+    /**
+     * @brief Record one latency sample
+     * @param latency_ms Latency in milliseconds (negative values are clamped to 0)
+     */
+    void record(double latency_ms);
+
+    /**
+     * @brief Get a latency percentile
+     * @param percentile Percentile in the range [0, 100]
+     * @return Latency in milliseconds (upper edge of the matching bucket), 0 if empty
+     */
+    double percentile(double percentile) const;
+
+    /**
+     * @brief Get the number of recorded samples
+     * @return Sample count
+     */
+    uint64_t count() const;
+
+    /**
+     * @brief Get the mean of all recorded samples
+     * @return Mean latency in milliseconds, 0 if empty
+     */
+    double mean() const;
+
+    /**
+     * @brief Get the largest recorded sample
+     * @return Maximum latency in milliseconds, 0 if empty
+     */
+    double max() const;
+
+    /**
+     * @brief Discard all samples
+     */
+    void reset();
+
+    /**
+     * @brief Format count, mean, p50/p95/p99 and max on one line
+     * @param name Label printed before the statistics
+     * @return Formatted summary
+     */
+    std::string summary(const std::string& name) const;
+
+private:
+    double m_resolution_ms;
+    std::vector<uint64_t> m_buckets;   // Last bucket collects overflow
+    uint64_t m_count;
+    double m_sum_ms;
+    double m_max_ms;
+
+    mutable std::mutex m_mutex;
+
+    double percentileLocked(double percentile) const;
+};
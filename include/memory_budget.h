@@ -0,0 +1,211 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Process-wide accounting of host and device memory against a budget
+ *
+ * Frame buffers, temporal history rings, scratch arenas and model
+ * workspaces each hold an Account and report the bytes they keep
+ * allocated, so the budget knows how much of each pool is in use. Before
+ * a component allocates something that scales with resolution it asks
+ * fit() how many units (frames, history entries, tiles) still fit, and
+ * takes a smaller capacity, history depth or tile instead of running
+ * out of memory later.
+ *
+ * The host pool is unlimited unless a budget is configured. The device
+ * pool is bounded by the configured budget and, on CUDA builds, by the
+ * memory the device reports free minus a headroom for the driver and
+ * library workspaces that are not accounted here.
+ *
+ * Accounting is a relaxed atomic add per change; nothing is queried on
+ * the hot path.
+ */
+class MemoryBudget {
+    struct Entry;   // Registry slot behind an Account
+
+public:
+    /**
+     * @brief Memory pools tracked separately
+     */
+    enum Pool {
+        HOST = 0,       ///< Pageable and page-locked host memory
+        DEVICE,         ///< CUDA device memory
+        POOL_COUNT
+    };
+
+    /**
+     * @brief Budget limits
+     */
+    struct Config {
+        size_t host_bytes = 0;              ///< Host budget (0 = unlimited)
+        size_t device_bytes = 0;            ///< Device budget (0 = what the device has free)
+        double device_headroom = 0.10;      ///< Fraction of device memory never handed out
+    };
+
+    /**
+     * @brief Bytes one component holds in one pool
+     *
+     * Releases its bytes when destroyed. A default-constructed account is
+     * not registered and ignores set().
+     */
+    class Account {
+    public:
+        Account() = default;
+
+        /**
+         * @brief Register an account
+         * @param name Component name shown in toTable() (accounts may share one)
+         * @param pool Pool the bytes are charged to
+         */
+        Account(const std::string& name, Pool pool);
+
+        ~Account();
+
+        Account(Account&& other) noexcept;
+        Account& operator=(Account&& other) noexcept;
+        Account(const Account&) = delete;
+        Account& operator=(const Account&) = delete;
+
+        /**
+         * @brief Report the bytes currently held
+         * @param bytes Bytes allocated by the component
+         */
+        void set(size_t bytes);
+
+        /**
+         * @brief Get the bytes last reported
+         * @return Bytes held
+         */
+        size_t bytes() const;
+
+        /**
+         * @brief Rename the account (e.g. once a buffer learns its role)
+         * @param name New name
+         */
+        void rename(const std::string& name);
+
+        /**
+         * @brief Move the account's bytes to another pool
+         * @param pool New pool
+         */
+        void setPool(Pool pool);
+
+    private:
+        Entry* m_entry = nullptr;
+        void release();
+    };
+
+    /**
+     * @brief Usage of one component, summed over accounts sharing its name
+     */
+    struct Usage {
+        std::string name;
+        Pool pool;
+        size_t bytes;
+    };
+
+    /**
+     * @brief Get the process-wide budget
+     * @return Budget instance (unlimited until configure())
+     */
+    static MemoryBudget& instance();
+
+    /**
+     * @brief Set the limits
+     * @param config New limits; bytes already accounted are kept
+     */
+    void configure(const Config& config);
+
+    /**
+     * @brief Get the current limits
+     * @return Limits
+     */
+    Config getConfig() const;
+
+    /**
+     * @brief Get the bytes accounted in a pool
+     * @param pool Pool to query
+     * @return Bytes in use
+     */
+    size_t used(Pool pool) const;
+
+    /**
+     * @brief Get the bytes that may still be allocated in a pool
+     *
+     * Queries the device on CUDA builds, so keep it off the hot path.
+     *
+     * @param pool Pool to query
+     * @return Remaining bytes, SIZE_MAX when unlimited
+     */
+    size_t available(Pool pool) const;
+
+    /**
+     * @brief Size a capacity so it fits what is left of a pool
+     *
+     * Logs when the capacity has to shrink. The minimum is returned even
+     * if it does not fit: callers need at least that much to work at all.
+     *
+     * @param pool Pool the units are allocated in
+     * @param unit_bytes Bytes of one unit (frame slot, history entry...)
+     * @param wanted Units requested
+     * @param minimum Units needed to work at all
+     * @param what Label for the log message (nullptr = silent)
+     * @return Units to allocate, between @p minimum and @p wanted
+     */
+    size_t fit(Pool pool, size_t unit_bytes, size_t wanted, size_t minimum = 1,
+               const char* what = nullptr) const;
+
+    /**
+     * @brief Check if an allocation fits what is left of a pool
+     * @param pool Pool to allocate in
+     * @param bytes Bytes to allocate
+     * @return true if it fits
+     */
+    bool fits(Pool pool, size_t bytes) const { return bytes <= available(pool); }
+
+    /**
+     * @brief Get every component's usage
+     * @return Usage per name and pool, largest first
+     */
+    std::vector<Usage> usage() const;
+
+    /**
+     * @brief Format usage and limits as a table
+     * @return Multi-line table
+     */
+    std::string toTable() const;
+
+    /**
+     * @brief Bytes of one frame
+     * @param size Frame size
+     * @param type OpenCV type
+     * @return size.area() * element size
+     */
+    static size_t frameBytes(const cv::Size& size, int type) {
+        return static_cast<size_t>(size.area()) * CV_ELEM_SIZE(type);
+    }
+
+    MemoryBudget(const MemoryBudget&) = delete;
+    MemoryBudget& operator=(const MemoryBudget&) = delete;
+
+private:
+    MemoryBudget();
+
+    friend class Account;
+
+    mutable std::mutex m_mutex;                     // Guards m_config and m_entries
+    Config m_config;
+    std::vector<std::unique_ptr<Entry>> m_entries;  // Reused once released, never freed
+    std::atomic<size_t> m_used[POOL_COUNT];
+
+    Entry* acquireEntry(const std::string& name, Pool pool);
+    void charge(Pool pool, size_t old_bytes, size_t new_bytes);
+};
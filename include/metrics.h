@@ -0,0 +1,277 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Process-wide registry of hot-path metrics
+ *
+ * Metrics are registered once by name and then addressed by a small integer
+ * ID, so recording never touches a string or a map. Every thread records into
+ * its own shard of fixed-size accumulators without locks or read-modify-write
+ * atomics; readers merge the shards on demand. Latencies go into log-linear
+ * buckets (8 per power of two, at most 12.5% wide) covering 1 ns to about
+ * 36 minutes.
+ *
+ * Values are cumulative for the life of the process, as monitoring systems
+ * expect; compare two snapshots to look at an interval.
+ */
+class Metrics {
+public:
+    using Id = uint32_t;
+    using Clock = std::chrono::steady_clock;
+
+    /// Maximum number of registered metrics; shards are sized for this many
+    static constexpr size_t MAX_METRICS = 64;
+
+    /// Returned by register calls when the registry is full
+    static constexpr Id INVALID_ID = static_cast<Id>(MAX_METRICS);
+
+    enum Type {
+        LATENCY,    ///< Distribution of durations in milliseconds
+        COUNTER     ///< Monotonic event count
+    };
+
+    /**
+     * @brief Merged view of one metric across all threads
+     */
+    struct Snapshot {
+        std::string name;
+        std::string help;
+        Type type = LATENCY;
+        uint64_t count = 0;     ///< Samples (latency) or total (counter)
+        double sum_ms = 0.0;
+        double min_ms = 0.0;
+        double max_ms = 0.0;
+        double p50_ms = 0.0;
+        double p90_ms = 0.0;
+        double p99_ms = 0.0;
+
+        double mean_ms() const { return count > 0 ? sum_ms / count : 0.0; }
+    };
+
+    /**
+     * @brief Get the process-wide registry
+     * @return The registry
+     */
+    static Metrics& instance();
+
+    /**
+     * @brief Register a latency metric, or look up an existing one
+     * @param name Metric name (letters, digits, '_' and '.')
+     * @param help One-line description used by the exporters
+     * @return Metric ID, INVALID_ID if the registry is full
+     */
+    Id registerLatency(const std::string& name, const std::string& help = "");
+
+    /**
+     * @brief Register a counter metric, or look up an existing one
+     * @param name Metric name (letters, digits, '_' and '.')
+     * @param help One-line description used by the exporters
+     * @return Metric ID, INVALID_ID if the registry is full
+     */
+    Id registerCounter(const std::string& name, const std::string& help = "");
+
+    /**
+     * @brief Record one latency sample from the calling thread
+     * @param id Latency metric ID
+     * @param latency_ms Duration in milliseconds
+     */
+    void record(Id id, double latency_ms);
+
+    /**
+     * @brief Record the time elapsed since @p start
+     * @param id Latency metric ID
+     * @param start Start of the measured interval
+     * @return The recorded duration in milliseconds
+     */
+    double recordSince(Id id, Clock::time_point start);
+
+    /**
+     * @brief Add to a counter from the calling thread
+     * @param id Counter metric ID
+     * @param value Amount to add
+     */
+    void add(Id id, uint64_t value = 1);
+
+    /**
+     * @brief Merge one metric across threads
+     * @param id Metric ID
+     * @return Snapshot (empty name for an unknown ID)
+     */
+    Snapshot snapshot(Id id) const;
+
+    /**
+     * @brief Merge every registered metric across threads
+     * @return Snapshots in registration order
+     */
+    std::vector<Snapshot> snapshotAll() const;
+
+    /**
+     * @brief Export all metrics as a JSON document
+     * @return JSON text
+     */
+    std::string toJson() const;
+
+    /**
+     * @brief Export all metrics in the Prometheus text exposition format
+     *
+     * Latencies are exported as summaries (quantiles, sum and count) plus
+     * min/max gauges; names are prefixed with "video_processor_".
+     *
+     * @return Exposition text
+     */
+    std::string toPrometheus() const;
+
+    /**
+     * @brief Format all metrics as a console table
+     * @return Table text
+     */
+    std::string toTable() const;
+
+    /**
+     * @brief Write toJson() to a file
+     * @param path Output path
+     * @return true if the file was written
+     */
+    bool dumpJson(const std::string& path) const;
+
+    Metrics(const Metrics&) = delete;
+    Metrics& operator=(const Metrics&) = delete;
+
+private:
+    Metrics();
+
+    // Log-linear bucket layout, values in nanoseconds
+    static constexpr int SUB_BUCKET_BITS = 3;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static constexpr int MAX_OCTAVE = 40;
+    static constexpr size_t BUCKET_COUNT = (MAX_OCTAVE - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + SUB_BUCKETS;
+
+    struct Definition {
+        std::string name;
+        std::string help;
+        Type type;
+    };
+
+    // One thread's accumulators. Only the owning thread writes, so plain
+    // relaxed loads and stores suffice; readers may see a sample half-applied
+    // across fields, never a torn value.
+    struct Shard {
+        struct Slot {
+            std::atomic<uint64_t> count{0};
+            std::atomic<uint64_t> sum_ns{0};
+            std::atomic<uint64_t> min_ns{UINT64_MAX};
+            std::atomic<uint64_t> max_ns{0};
+            std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets{};
+        };
+        std::array<Slot, MAX_METRICS> slots;
+    };
+
+    mutable std::mutex m_mutex;                     // Guards registration and the shard list
+    std::vector<Definition> m_definitions;
+    std::vector<std::unique_ptr<Shard>> m_shards;   // Kept after their thread exits
+
+    Id registerMetric(const std::string& name, const std::string& help, Type type);
+    Shard& localShard();
+    Snapshot mergeLocked(Id id) const;
+
+    static size_t bucketIndex(uint64_t value_ns);
+    static uint64_t bucketUpperBound(size_t index);
+    static double percentileFromBuckets(const std::vector<uint64_t>& buckets, uint64_t count,
+                                        double percentile, uint64_t max_ns);
+};
+
+/**
+ * @brief Records the lifetime of a scope into a latency metric
+ *
+ * Call stop() to record early (for example to use the duration); the
+ * destructor then does nothing.
+ */
+class MetricTimer {
+public:
+    explicit MetricTimer(Metrics::Id id)
+        : m_id(id), m_start(Metrics::Clock::now()), m_stopped(false) {
+    }
+
+    ~MetricTimer() {
+        stop();
+    }
+
+    /**
+     * @brief Record the elapsed time now
+     * @return Duration in milliseconds (0 if already stopped)
+     */
+    double stop() {
+        if (m_stopped) {
+            return 0.0;
+        }
+        m_stopped = true;
+        return Metrics::instance().recordSince(m_id, m_start);
+    }
+
+    /**
+     * @brief Discard the measurement
+     */
+    void cancel() {
+        m_stopped = true;
+    }
+
+    MetricTimer(const MetricTimer&) = delete;
+    MetricTimer& operator=(const MetricTimer&) = delete;
+
+private:
+    Metrics::Id m_id;
+    Metrics::Clock::time_point m_start;
+    bool m_stopped;
+};
+
+/**
+ * @brief Minimal HTTP endpoint serving the metrics registry
+ *
+ * Answers GET /metrics with the Prometheus text format and GET /metrics.json
+ * with the JSON dump, one request at a time on a background thread. Intended
+ * for scraping a long-running pipeline, not as a general web server.
+ */
+class MetricsServer {
+public:
+    MetricsServer();
+    ~MetricsServer();
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    /**
+     * @brief Start listening
+     * @param port TCP port
+     * @param bind_address Address to bind (loopback by default)
+     * @return true if the server is listening
+     */
+    bool start(int port, const std::string& bind_address = "127.0.0.1");
+
+    /**
+     * @brief Stop the server and join its thread
+     */
+    void stop();
+
+    /**
+     * @brief Check if the server is listening
+     * @return true if running
+     */
+    bool isRunning() const;
+
+private:
+    int m_socket;
+    std::atomic<bool> m_running;
+    std::thread m_thread;
+
+    void serveLoop();
+    void handleClient(int client);
+};
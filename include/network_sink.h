@@ -0,0 +1,251 @@
+#pragma once
+
+#include "frame_sink.h"
+#include "latency_histogram.h"
+#include "metrics.h"
+#include "trace.h"
+
+#include <opencv2/opencv.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef WITH_CUDA
+#include <opencv2/core/cuda.hpp>
+#endif
+
+/**
+ * @brief Low-latency live stream of the output over SRT or RTP
+ *
+ * Frames are encoded to H.264 by a GStreamer pipeline opened through
+ * cv::VideoWriter and sent as MPEG-TS over SRT (srt://host:port) or UDP
+ * (udp://host:port), or as RTP over UDP (rtp://host:port). The encoder is
+ * tuned for latency rather than size: NVENC (nvh264enc) in its low-latency
+ * preset with CBR, no B-frames and zero lookahead, or x264 with
+ * tune=zerolatency when NVENC is missing. Every element runs unsynced, so
+ * an encoded frame leaves the host as soon as it is ready.
+ *
+ * The queue in front of the encoder is short and always drops the oldest
+ * frame: a remote monitor is better served by a skipped frame than by one
+ * that arrives late. Each frame sent produces a SendRecord with its capture,
+ * queue and send times, and capture-to-send latency is kept in a histogram
+ * and in the net.capture_to_send metric. The send time is the hand-off to
+ * GStreamer; encoding and packetization follow on its streaming thread
+ * without lookahead, so they add roughly one frame's encode time.
+ */
+class NetworkSink : public FrameSink {
+public:
+    /**
+     * @brief Transport derived from the URL scheme
+     */
+    enum Protocol {
+        SRT,    ///< MPEG-TS over SRT (srt://)
+        RTP,    ///< RTP H.264 payload over UDP (rtp://)
+        UDP,    ///< MPEG-TS over plain UDP (udp://)
+        UNKNOWN
+    };
+
+    /**
+     * @brief Configuration for the sink
+     */
+    struct Config {
+        std::string url;                    ///< srt://host:port[?mode=listener], rtp://host:port or udp://host:port
+        cv::Size frame_size;                ///< Frame size (required)
+        double fps = 30.0;                  ///< Nominal frame rate (CBR rate control and timestamps)
+        int bitrate_kbps = 8000;            ///< Constant bitrate
+        int keyframe_interval = 30;         ///< Frames between IDR frames (a new viewer waits up to this long)
+        int srt_latency_ms = 40;            ///< SRT receive buffer; retransmissions must fit inside it
+        bool use_nvenc = true;              ///< Prefer NVENC when GStreamer has nvh264enc
+        size_t queue_size = 2;              ///< Frames buffered ahead of the encoder (oldest dropped)
+        bool i420_input = false;            ///< Host frames are I420 (see yuv_frame.h)
+    };
+
+    /**
+     * @brief Timing of one frame handed to the network
+     */
+    struct SendRecord {
+        uint64_t frame_id;                      ///< Pipeline frame ID
+        FrameMetadata::TimePoint capture_time;  ///< Capture time from the frame's metadata
+        FrameMetadata::TimePoint queued_time;   ///< When write() queued the frame
+        FrameMetadata::TimePoint send_time;     ///< When the frame was pushed into the encoder pipeline
+
+        /**
+         * @brief Capture-to-send latency
+         * @return Milliseconds, or 0 if the capture time is unknown
+         */
+        double captureToSend() const {
+            if (capture_time == FrameMetadata::TimePoint()) {
+                return 0.0;
+            }
+            return std::chrono::duration<double, std::milli>(send_time - capture_time).count();
+        }
+    };
+
+    /// Called on the sending thread for every frame sent; keep it short
+    using SendCallback = std::function<void(const SendRecord&)>;
+
+    /**
+     * @brief Construct a new sink
+     * @param config Sink configuration
+     */
+    explicit NetworkSink(const Config& config);
+
+    /**
+     * @brief Destroy the sink, stopping the stream
+     */
+    ~NetworkSink() override;
+
+    NetworkSink(const NetworkSink&) = delete;
+    NetworkSink& operator=(const NetworkSink&) = delete;
+
+    /**
+     * @brief Open the encoder and transport and start the sending thread
+     * @return true if the stream is open
+     */
+    bool start() override;
+
+    /**
+     * @brief Send the queued frames, close the stream and join the thread
+     *
+     * A concurrent call waits for the stop already in progress.
+     */
+    void stop() override;
+
+    /**
+     * @brief Queue a host frame for streaming
+     * @param frame 8-bit BGR frame, or I420 with Config::i420_input, of the configured size (copied)
+     * @param metadata Envelope of the frame; the capture time is reported in its SendRecord
+     * @return true if the frame was queued
+     */
+    bool write(const cv::Mat& frame, const FrameMetadata& metadata) override;
+
+#ifdef WITH_CUDA
+    /**
+     * @brief Queue a device frame for streaming
+     *
+     * The frame is copied on @p stream and read back on the sending thread,
+     * so the caller never waits for the transfer. Not available with
+     * Config::i420_input.
+     *
+     * @param frame 8-bit BGR frame of the configured size (copied)
+     * @param metadata Envelope of the frame
+     * @param stream Stream the frame was produced on
+     * @return true if the frame was queued
+     */
+    bool write(const cv::cuda::GpuMat& frame, const FrameMetadata& metadata,
+               cv::cuda::Stream& stream) override;
+#endif
+
+    /**
+     * @brief Check if the stream is open
+     * @return true if running
+     */
+    bool isRunning() const override;
+
+    /**
+     * @brief Describe the stream for logs
+     * @return The URL
+     */
+    std::string describe() const override { return m_config.url; }
+
+    /**
+     * @brief Set the callback receiving each frame's send timestamps
+     * @param callback Callback (empty disables); set before start()
+     */
+    void setSendCallback(SendCallback callback) { m_send_callback = std::move(callback); }
+
+    /**
+     * @brief Check if frames are encoded with NVENC
+     * @return true if the GStreamer pipeline uses nvh264enc
+     */
+    bool isHardwareEncoding() const;
+
+    /**
+     * @brief Get the number of frames sent so far
+     * @return Sent frame count
+     */
+    uint64_t framesSent() const;
+
+    /**
+     * @brief Get the number of frames dropped at the queue
+     * @return Dropped frame count
+     */
+    uint64_t droppedFrames() const;
+
+    /**
+     * @brief Get the capture-to-send latency distribution
+     * @return Histogram of SendRecord::captureToSend()
+     */
+    const LatencyHistogram& getSendLatency() const { return m_send_latency; }
+
+    /**
+     * @brief Get the transport of a URL
+     * @param url Stream URL
+     * @return Protocol, UNKNOWN if the scheme is not supported
+     */
+    static Protocol protocolOf(const std::string& url);
+
+    /**
+     * @brief Build the GStreamer pipeline for a configuration
+     * @param config Sink configuration
+     * @param nvenc Use nvh264enc instead of x264enc
+     * @return Pipeline description for cv::VideoWriter, empty if the URL is invalid
+     */
+    static std::string buildPipeline(const Config& config, bool nvenc);
+
+private:
+    struct Job {
+        cv::Mat host;
+#ifdef WITH_CUDA
+        cv::cuda::GpuMat device;
+        std::shared_ptr<cv::cuda::Event> ready;     // Recorded after the device copy
+#endif
+        bool on_device = false;
+        uint64_t frame_id = 0;
+        FrameMetadata::TimePoint capture_time;
+        FrameMetadata::TimePoint queued_time;
+    };
+
+    Config m_config;
+    SendCallback m_send_callback;
+
+    std::deque<Job> m_queue;        // Waiting for the encoder, oldest first
+    std::vector<Job> m_free;        // Recycled jobs so steady state doesn't allocate
+    uint64_t m_sent;
+    uint64_t m_dropped;
+    bool m_running;
+    bool m_stopping;
+    bool m_nvenc;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_work_available;
+    std::condition_variable m_stopped;  // Signalled when a stop() finishes
+    std::thread m_worker;
+
+    std::unique_ptr<cv::VideoWriter> m_writer;
+    cv::Mat m_staging;              // BGR conversion or device read-back (sending thread only)
+    LatencyHistogram m_send_latency;
+
+    // Hot-path metric IDs
+    Metrics::Id m_metric_send;
+    Metrics::Id m_metric_capture_to_send;
+    Metrics::Id m_metric_dropped;
+
+    // Sending thread loop
+    void workerLoop();
+
+    // Encode and send one job (sending thread only)
+    bool send(Job& job);
+
+    // Claim a job slot, dropping the oldest queued frame when full
+    bool acquireJob(Job& job);
+
+    // Queue a filled job
+    bool enqueue(Job& job, const FrameMetadata& metadata);
+};
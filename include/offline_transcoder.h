@@ -0,0 +1,207 @@
+#pragma once
+
+#include "upscaler.h"
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef WITH_CUDA
+#include <opencv2/core/cuda.hpp>
+#endif
+
+class BatchedSuperRes;
+class Camera;
+class RecordingSink;
+
+/**
+ * @brief Offline file-to-file upscaling at full throughput
+ *
+ * Unlike the live pipeline there is no pacing and nothing is dropped: a
+ * reader cuts the input into chunks, N workers upscale chunks in parallel,
+ * each with its own Upscaler (and so its own DnnSuperRes model), and a
+ * reorder buffer hands frames to the encoder in source order.
+ *
+ * With several GPUs, workers are spread across them round-robin.
+ *
+ * With max_batch above 1 and FSRCNN, there is one model per GPU behind a
+ * BatchedSuperRes instead of one per worker. Workers submit a whole chunk at
+ * once, so batches fill from one chunk and from workers sharing the GPU.
+ *
+ * Temporal stages need history, so every chunk starts with a few frames from
+ * the end of the previous one. Workers reset their temporal state, run those
+ * warm-up frames, and discard their output. Chunk boundaries then match a
+ * continuous run once the warm-up covers the temporal window.
+ *
+ * When the input is decoded with NVDEC and the workers run the device chain
+ * on the decoder's GPU, chunks hold device frames. Each frame then crosses the
+ * bus once, as the upscaled result on its way to the encoder.
+ */
+class OfflineTranscoder {
+public:
+    /**
+     * @brief Configuration for a transcode job
+     */
+    struct Config {
+        std::string input_path;                                         ///< Source video file
+        std::string output_path;                                        ///< Output video file
+        Upscaler::Algorithm algorithm = Upscaler::BICUBIC;              ///< Upscaling algorithm
+        int target_width = 1920;                                        ///< Output width
+        int target_height = 1080;                                       ///< Output height
+        bool use_gpu = true;                                            ///< Use GPU acceleration if available
+        size_t workers = 0;                                             ///< Parallel workers (0 = automatic)
+        size_t chunk_size = 32;                                         ///< Frames per work unit
+        size_t overlap = 4;                                             ///< Warm-up frames replayed before each chunk
+        int fourcc = cv::VideoWriter::fourcc('m', 'p', '4', 'v');       ///< Codec for the CPU encoder
+        bool use_nvenc = true;                                          ///< Prefer NVENC when available
+        size_t max_batch = 1;                                           ///< Frames per SR forward pass (SUPER_RES only)
+    };
+
+    /**
+     * @brief Progress of a transcode job
+     */
+    struct Stats {
+        uint64_t frames_read = 0;       ///< Frames decoded from the input
+        uint64_t frames_written = 0;    ///< Frames handed to the encoder
+        uint64_t upscale_failures = 0;  ///< Frames that fell back to a plain resize
+        double elapsed_seconds = 0.0;   ///< Wall-clock time since run() started
+
+        double fps() const { return elapsed_seconds > 0.0 ? frames_written / elapsed_seconds : 0.0; }
+    };
+
+    /**
+     * @brief Construct a new transcoder
+     * @param config Job configuration
+     */
+    explicit OfflineTranscoder(const Config& config);
+
+    /**
+     * @brief Destroy the transcoder, cancelling a running job
+     */
+    ~OfflineTranscoder();
+
+    OfflineTranscoder(const OfflineTranscoder&) = delete;
+    OfflineTranscoder& operator=(const OfflineTranscoder&) = delete;
+
+    /**
+     * @brief Run the job to completion on the calling thread
+     * @return true if every frame of the input was written
+     */
+    bool run();
+
+    /**
+     * @brief Stop a running job; frames already processed are still written
+     */
+    void cancel();
+
+    /**
+     * @brief Async-signal-safe cancel: only sets the flag, which every wait
+     *        re-checks on a short timeout
+     */
+    void requestCancel();
+
+    /**
+     * @brief Get the job's progress
+     * @return Current statistics
+     */
+    Stats getStats() const;
+
+private:
+    // A contiguous run of source frames; the first `warmup` only prime temporal state
+    struct Chunk {
+        uint64_t first_frame = 0;       // Index of frames[warmup]
+        size_t warmup = 0;
+        std::vector<cv::Mat> frames;
+#ifdef WITH_CUDA
+        std::vector<cv::cuda::GpuMat> device_frames;    // Used instead of frames with device input
+#endif
+
+        size_t size() const {
+#ifdef WITH_CUDA
+            return frames.size() + device_frames.size();
+#else
+            return frames.size();
+#endif
+        }
+    };
+
+    Config m_config;
+
+    std::unique_ptr<Camera> m_source;
+    std::vector<std::unique_ptr<Upscaler>> m_upscalers;     // One per worker
+    std::vector<int> m_worker_devices;                      // CUDA device per worker (-1 = host)
+    std::vector<std::unique_ptr<BatchedSuperRes>> m_batchers;   // One per GPU when batching
+    std::unique_ptr<RecordingSink> m_sink;
+    bool m_device_frames;                                   // Chunks carry NVDEC frames on the device
+#ifdef WITH_CUDA
+    std::unique_ptr<cv::cuda::Stream> m_decode_stream;      // Reader's stream when m_device_frames
+#endif
+
+    // Chunks waiting for a worker (bounded so decode can't run away)
+    std::deque<Chunk> m_chunks;
+    size_t m_max_pending_chunks;
+    bool m_reader_done;
+    size_t m_workers_running;
+
+    // Reorder buffer: finished frames keyed by source index
+    std::map<uint64_t, cv::Mat> m_completed;
+    uint64_t m_next_to_write;
+
+    std::atomic<bool> m_cancelled;
+    std::atomic<uint64_t> m_frames_read;
+    std::atomic<uint64_t> m_frames_written;
+    std::atomic<uint64_t> m_upscale_failures;
+    std::chrono::steady_clock::time_point m_start_time;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_chunk_available;
+    std::condition_variable m_chunk_space;
+    std::condition_variable m_frame_completed;
+
+    // Set up the source, one upscaler per worker and the encoder
+    bool initialize();
+
+    // Number of usable CUDA devices (0 without CUDA)
+    static size_t gpuCount();
+
+    // Bind the calling thread to the worker's device
+    void bindDevice(size_t worker) const;
+
+    // Build one batched model per device; false if batching doesn't apply
+    bool initializeBatchers(size_t devices);
+
+    // Upscale a chunk through the worker's batcher, in frame order
+    void upscaleBatched(size_t worker, Chunk& chunk);
+
+    // Hand one finished frame to the reorder buffer
+    void completeFrame(uint64_t index, cv::Mat& source, cv::Mat& output, bool success);
+
+    // Decode the next source frame into the chunk; false at the end of the input
+    bool readFrame(Chunk& chunk);
+
+    // Decode the input into overlapping chunks
+    void readerLoop();
+
+    // Upscale chunks with the given worker's upscaler
+    void workerLoop(size_t worker);
+
+#ifdef WITH_CUDA
+    // Upscale a chunk of device frames on the worker's stream
+    void upscaleDeviceChunk(Upscaler& upscaler, Chunk& chunk, cv::cuda::Stream& stream);
+#endif
+
+    // Hand a chunk to the workers, blocking while the queue is full
+    bool pushChunk(Chunk& chunk);
+
+    // Write completed frames in order until the workers are done
+    void writeLoop();
+};
@@ -1,11 +1,14 @@
 #pragma once
 
+#include "display.h"
+#include "frame_sink.h"
 #include "upscaler.h"
-#include "timer.h"
+#include "thread_placement.h"
 
 #include <string>
 #include <memory>
 #include <atomic>
+#include <vector>
 
 /**
  * @brief Integrated pipeline that connects all video processing components
@@ -32,15 +35,55 @@ public:
         int target_height = 1080;
         Upscaler::Algorithm upscale_algorithm = Upscaler::BILINEAR;
         bool use_gpu = true;
+        bool temporal_filter = false;   // Recursive temporal smoothing after upscaling
+        float temporal_history_weight = 0.35f; // Weight of the filter's history (0-1)
+        bool skip_duplicates = false;   // Reuse the result of repeated input frames
+        float duplicate_threshold = 1.0f; // Mean thumbnail difference still counted as a repeat (8-bit levels)
         
         // Buffer options
         int buffer_size = 5;
         
+        // Memory budget in MB (0 = unlimited host, free device memory).
+        // Buffers, temporal history, arenas and SR workspaces are charged
+        // to it, and capacities, history depth and tiles shrink to fit
+        size_t host_memory_mb = 0;
+        size_t device_memory_mb = 0;
+        
+        // Size the capture and display buffers from this many MB, split in
+        // proportion to buffer_size and display_buffer_size, instead of
+        // counting frames (0 = use the frame counts)
+        size_t buffer_memory_mb = 0;
+        
+        // Run the enhancement chain as a graph with one thread per stage
+        // (pre-bilateral, upscale, sharpen, post-bilateral, temporal), so
+        // throughput follows the slowest stage instead of the whole chain
+        bool stage_graph = false;
+        int stage_queue_size = 2;       // Frames queued in front of each stage
+        
+        // Threads for tile-parallel host kernels and OpenCV (0 = the cores
+        // left by the pipeline's own threads)
+        int cpu_threads = 0;
+        
+        // Cores, SCHED_FIFO priorities and the frame memory NUMA node of the
+        // pipeline's threads; cores given to the POOL role size the TaskPool
+        ThreadPlacement::Config threading;
+        
+        // Write a Chrome trace of every frame's stages here on stop()
+        // (empty disables tracing)
+        std::string trace_path;
+        
         // Display options
+        Display::Backend display_backend = Display::HIGHGUI;  // OPENGL for interop, HEADLESS for servers
         std::string window_name = "Video Output";
         bool show_metrics = true;
         bool enable_vsync = false;
-        int max_display_fps = 60;
+        int max_display_fps = 60;       // Presentation cadence (0 presents as frames arrive)
+        int display_buffer_size = 3;    // Frames queued between processing and display
+        
+        // Network output: stream every presented frame to srt://host:port,
+        // rtp://host:port or udp://host:port (empty disables)
+        std::string stream_url;
+        int stream_bitrate_kbps = 8000;
         
         // Performance options
         bool measure_latency = true;
@@ -102,10 +145,20 @@ public:
     
     /**
      * @brief Get end-to-end latency of the pipeline in milliseconds
+     * 
+     * Median glass-to-glass latency, from frame capture to the end of rendering.
+     * 
      * @return Latency in milliseconds
      */
     double getLatency() const;
     
+    /**
+     * @brief Get a percentile of the glass-to-glass latency distribution
+     * @param percentile Percentile in the range [0, 100] (e.g. 50, 95, 99)
+     * @return Latency in milliseconds
+     */
+    double getLatencyPercentile(double percentile) const;
+    
     /**
      * @brief Get the effective frames per second of the pipeline
      * @return Frames per second
@@ -131,6 +184,16 @@ public:
      */
     void setDisplayOptions(bool show_metrics);
     
+    /**
+     * @brief Add a sink that receives every new output frame
+     * 
+     * Sinks are started by start() and flushed by stop(); each frame is
+     * handed to them before it is rendered. Call before start().
+     * 
+     * @param sink Sink configured for the target resolution
+     */
+    void addSink(std::shared_ptr<FrameSink> sink);
+    
     /**
      * @brief Print performance statistics to console
      */
@@ -145,6 +208,5 @@ private:
     // Performance metrics that need to be accessible from outside
     std::atomic<double> m_latency{0.0};
     std::atomic<double> m_fps{0.0};
-    Timer m_timer;
     Config m_config;
 };
\ No newline at end of file
@@ -7,6 +7,10 @@
 #include <vector>
 #include <mutex>
 
+#ifdef WITH_CUDA
+#include <opencv2/core/cuda.hpp>
+#endif
+
 /**
  * @brief Video frame processor for applying transformations to frames
  * 
@@ -18,17 +22,34 @@ class Processor {
 public:
     // Type definition for a processing function
     using ProcessFunction = std::function<void(const cv::Mat&, cv::Mat&)>;
+    
+#ifdef WITH_CUDA
+    // Type definition for a device processing function; work is enqueued on the stream
+    using GpuProcessFunction = std::function<void(const cv::cuda::GpuMat&, cv::cuda::GpuMat&, cv::cuda::Stream&)>;
+#endif
 
     /**
      * @brief Structure representing a processing operation
+     * 
+     * An operation always has a host implementation; on the GPU path it also
+     * uses the device implementation when one is given. Consecutive host-only
+     * operations share a single download/upload pair.
      */
     struct Operation {
         std::string name;
         ProcessFunction func;
+#ifdef WITH_CUDA
+        GpuProcessFunction gpu_func;    ///< Device implementation (optional)
+#endif
         bool enabled;
         
         Operation(const std::string& n, ProcessFunction f)
             : name(n), func(f), enabled(true) {}
+        
+#ifdef WITH_CUDA
+        Operation(const std::string& n, ProcessFunction f, GpuProcessFunction g)
+            : name(n), func(f), gpu_func(g), enabled(true) {}
+#endif
     };
     
     // Forward declaration of implementation class
@@ -59,6 +80,22 @@ public:
      */
     bool process(const cv::Mat& input, cv::Mat& output);
     
+#ifdef WITH_CUDA
+    /**
+     * @brief Process a device-resident frame with all registered operations
+     * 
+     * Device operations run on @p stream; the frame only visits the host for
+     * runs of operations that have no device implementation.
+     * 
+     * @param input Input frame on the device
+     * @param output Output frame on the device
+     * @param stream Stream to enqueue the work on
+     * @return true if processing was successful
+     */
+    bool process(const cv::cuda::GpuMat& input, cv::cuda::GpuMat& output,
+                 cv::cuda::Stream& stream = cv::cuda::Stream::Null());
+#endif
+    
     /**
      * @brief Add a processing operation to the pipeline
      * @param name Name of the operation
@@ -67,6 +104,17 @@ public:
      */
     Processor& addOperation(const std::string& name, ProcessFunction func);
     
+#ifdef WITH_CUDA
+    /**
+     * @brief Add a processing operation with a device implementation
+     * @param name Name of the operation
+     * @param func Host processing function
+     * @param gpu_func Device processing function
+     * @return Reference to this processor for chaining
+     */
+    Processor& addOperation(const std::string& name, ProcessFunction func, GpuProcessFunction gpu_func);
+#endif
+    
     /**
      * @brief Add common pre-processing operations
      * @return Reference to this processor for chaining
@@ -0,0 +1,168 @@
+#pragma once
+
+#include "metrics.h"
+#include "upscaler.h"
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Closed-loop quality control for live upscaling
+ *
+ * Walks an ordered ladder of configurations, from the best model with every
+ * enhancement down to plain bilinear resizing, to keep the upscale time of
+ * each frame inside the frame deadline. The smoothed frame time has to stay
+ * above the deadline for a few frames before quality steps down, and well
+ * below it for much longer before it steps back up, with a cooldown after
+ * every switch so the ladder doesn't oscillate.
+ *
+ * Levels that differ only in enhancement toggles share one Upscaler. Every
+ * distinct algorithm gets its own Upscaler, built in the background after
+ * the top level is ready, so a switch is a pointer change and never
+ * initializes anything on the frame thread. Levels whose Upscaler is still
+ * warming up are skipped.
+ */
+class QualityGovernor {
+public:
+    /**
+     * @brief One rung of the quality ladder
+     */
+    struct Level {
+        std::string name;                                   ///< Shown in logs and overlays
+        Upscaler::Algorithm algorithm = Upscaler::BICUBIC;  ///< Upscaling algorithm
+        bool selective_bilateral = true;                    ///< Bilateral pre/post filtering
+        bool adaptive_sharpening = true;                    ///< Adaptive sharpening
+        bool temporal_consistency = true;                   ///< Temporal consistency
+    };
+
+    /**
+     * @brief Configuration for the governor
+     */
+    struct Config {
+        int target_width = 1920;                            ///< Output width
+        int target_height = 1080;                           ///< Output height
+        bool use_gpu = true;                                ///< Use GPU acceleration if available
+        double target_fps = 30.0;                           ///< Frame rate whose period is the deadline
+        Upscaler::Algorithm top_algorithm = Upscaler::REAL_ESRGAN;  ///< Best algorithm on the default ladder
+        std::vector<Level> ladder;                          ///< Best first (empty = defaultLadder(top_algorithm))
+        double downgrade_ratio = 0.95;                      ///< Step down above this fraction of the deadline
+        double upgrade_ratio = 0.6;                         ///< Consider stepping up below this fraction
+        size_t downgrade_frames = 5;                        ///< Consecutive slow frames before stepping down
+        size_t upgrade_frames = 90;                         ///< Consecutive fast frames before stepping up
+        size_t cooldown_frames = 30;                        ///< Frames after a switch before the next one
+        double smoothing = 0.1;                             ///< Weight of the newest frame in the moving average
+    };
+
+    /**
+     * @brief Construct a new governor
+     * @param config Governor configuration
+     */
+    explicit QualityGovernor(const Config& config);
+
+    /**
+     * @brief Destroy the governor, stopping any background warm-up
+     */
+    ~QualityGovernor();
+
+    QualityGovernor(const QualityGovernor&) = delete;
+    QualityGovernor& operator=(const QualityGovernor&) = delete;
+
+    /**
+     * @brief Build the top level and start warming up the others
+     * @return true if at least the top level is usable
+     */
+    bool initialize();
+
+    /**
+     * @brief Upscale a frame at the current level and feed its time to the controller
+     * @param input Input frame to upscale
+     * @param output Output frame at the target resolution
+     * @return true if upscaling was successful
+     */
+    bool upscale(const cv::Mat& input, cv::Mat& output);
+
+    /**
+     * @brief Get the ladder position in use
+     * @return Index into the ladder (0 = best quality)
+     */
+    size_t getLevelIndex() const { return m_level; }
+
+    /**
+     * @brief Get the ladder rung in use
+     * @return Current level
+     */
+    const Level& getLevel() const { return m_config.ladder[m_level]; }
+
+    /**
+     * @brief Get the smoothed upscale time at the current level
+     * @return Moving average in milliseconds
+     */
+    double getAverageMs() const { return m_average_ms; }
+
+    /**
+     * @brief Get the number of level switches so far
+     * @return Switch count
+     */
+    uint64_t getSwitchCount() const { return m_switches; }
+
+    /**
+     * @brief Build the default ladder below an algorithm
+     *
+     * RealESRGAN sheds temporal consistency, bilateral filtering and then
+     * sharpening before falling back to FSRCNN, bicubic and bilinear.
+     *
+     * @param top Best algorithm allowed on the ladder
+     * @return Ladder, best first
+     */
+    static std::vector<Level> defaultLadder(Upscaler::Algorithm top);
+
+private:
+    // One Upscaler per distinct algorithm on the ladder
+    struct Slot {
+        Upscaler::Algorithm algorithm;
+        std::unique_ptr<Upscaler> upscaler;
+        std::atomic<bool> ready{false};     // Published by the warm-up thread
+        bool failed = false;                // Warm-up thread only
+    };
+
+    Config m_config;
+    std::vector<std::unique_ptr<Slot>> m_slots;
+    std::vector<size_t> m_level_slot;       // Ladder index -> slot index
+    std::vector<double> m_level_cost_ms;    // Last smoothed time seen at each level (0 = never run)
+
+    size_t m_level;
+    double m_deadline_ms;
+    double m_average_ms;
+    size_t m_slow_frames;
+    size_t m_fast_frames;
+    size_t m_frames_since_switch;
+    uint64_t m_switches;
+    int m_device;                           // CUDA device of the frame thread
+
+    std::thread m_warmup;
+    std::atomic<bool> m_stopping;
+
+    Metrics::Id m_metric_upscale;
+    Metrics::Id m_metric_switches;
+
+    // Build and initialize one slot's upscaler
+    bool buildSlot(Slot& slot);
+
+    // Warm-up thread: build every slot but the first
+    void warmupLoop();
+
+    // Feed one frame time to the controller
+    void update(double frame_ms);
+
+    // Switch to a level whose upscaler is ready
+    void switchTo(size_t level);
+
+    // Find the nearest ready level below / above the current one (returns the current level if none)
+    size_t readyBelow() const;
+    size_t readyAbove() const;
+};
@@ -0,0 +1,218 @@
+#pragma once
+
+#include "frame_metadata.h"
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+/**
+ * @brief Uncompressed frame container for deterministic capture and replay
+ *
+ * A .vpraw file is one 4 KiB header page followed by fixed-size records,
+ * each a 64-byte frame header and the frame's pixel rows, padded to a
+ * multiple of 64 bytes. Every frame therefore sits at a known offset, so
+ * seeking is exact and O(1), and a mapped file hands out frames as Mat views
+ * on cache-line aligned pixels without decoding or copying.
+ *
+ * Frames are stored as captured: 8-bit BGR, or planar I420 as the
+ * single-channel layout of yuv_frame.h.
+ */
+namespace rawfile {
+
+constexpr char kMagic[8] = {'V', 'P', 'R', 'A', 'W', '0', '1', '\0'};
+constexpr uint32_t kVersion = 1;
+constexpr size_t kHeaderBytes = 4096;
+constexpr size_t kFrameHeaderBytes = 64;
+constexpr size_t kRecordAlignment = 64;
+
+/**
+ * @brief Header at the start of the file
+ */
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_bytes;          ///< Offset of the first record
+    int32_t cols;                   ///< Mat columns of every frame
+    int32_t rows;                   ///< Mat rows (3/2 of the height for I420)
+    int32_t type;                   ///< Mat type, CV_8UC3 or CV_8UC1
+    uint32_t row_bytes;             ///< Bytes per stored row
+    uint64_t record_bytes;          ///< Frame header plus padded pixel rows
+    uint64_t frame_count;           ///< 0 when the writer did not close the file
+    double fps;
+};
+
+/**
+ * @brief Header in front of every frame's pixels
+ */
+struct FrameHeader {
+    uint64_t index;
+    double source_timestamp_ms;     ///< Backend timestamp at capture, -1 if unknown
+    int64_t capture_offset_ns;      ///< Capture time relative to the first frame
+};
+
+static_assert(sizeof(FileHeader) <= kHeaderBytes, "File header must fit its page");
+static_assert(sizeof(FrameHeader) <= kFrameHeaderBytes, "Frame header must fit its slot");
+
+/**
+ * @brief Check if a path names a raw container (by its .vpraw extension)
+ * @param path File path
+ * @return true for raw containers
+ */
+bool isRawFile(const std::string& path);
+
+} // namespace rawfile
+
+/**
+ * @brief Appends captured frames to a .vpraw file
+ *
+ * The frame geometry is fixed by the first frame written. Writes go through
+ * stdio buffering on the calling thread; the frame count is filled in by
+ * close(), and a file that was never closed is still readable.
+ */
+class RawFrameWriter {
+public:
+    RawFrameWriter();
+    ~RawFrameWriter();
+
+    RawFrameWriter(const RawFrameWriter&) = delete;
+    RawFrameWriter& operator=(const RawFrameWriter&) = delete;
+
+    /**
+     * @brief Create the file (truncating an existing one)
+     * @param path Output path
+     * @param fps Frame rate recorded for playback
+     * @return true if the file was created
+     */
+    bool open(const std::string& path, double fps);
+
+    /**
+     * @brief Append a frame
+     * @param frame 8-bit BGR or I420 frame, same size and type as the first
+     * @param metadata Envelope of the frame (timestamps are recorded)
+     * @return true if the frame was written
+     */
+    bool write(const cv::Mat& frame, const FrameMetadata& metadata);
+
+    /**
+     * @brief Record the frame count and close the file
+     */
+    void close();
+
+    /**
+     * @brief Check if a file is open for writing
+     * @return true between open() and close()
+     */
+    bool isOpen() const { return m_file != nullptr; }
+
+    /**
+     * @brief Get the number of frames written
+     * @return Frame count
+     */
+    uint64_t frameCount() const { return m_header.frame_count; }
+
+private:
+    std::FILE* m_file;
+    std::string m_path;
+    rawfile::FileHeader m_header;
+    FrameMetadata::TimePoint m_first_capture;
+
+    // Write the header page at the start of the file
+    bool writeHeader();
+};
+
+/**
+ * @brief Replays a .vpraw file through a private memory mapping
+ *
+ * Frames are returned as Mat views on the mapped pages, valid until the
+ * reader is closed. The mapping is copy-on-write, so a consumer writing into
+ * a view changes only its own copy of the page, never the file.
+ */
+class RawFrameReader {
+public:
+    RawFrameReader();
+    ~RawFrameReader();
+
+    RawFrameReader(const RawFrameReader&) = delete;
+    RawFrameReader& operator=(const RawFrameReader&) = delete;
+
+    /**
+     * @brief Map a file and validate its header
+     * @param path Input path
+     * @return true if the file is a readable raw container
+     */
+    bool open(const std::string& path);
+
+    /**
+     * @brief Unmap the file (invalidates every view handed out)
+     */
+    void close();
+
+    /**
+     * @brief Check if a file is mapped
+     * @return true between open() and close()
+     */
+    bool isOpen() const { return m_data != nullptr; }
+
+    /**
+     * @brief Get a frame by index without moving the read position
+     * @param index Frame index
+     * @param view Output view on the mapped pixels
+     * @param metadata Receives the recorded source timestamp (optional)
+     * @return true if the index is in range
+     */
+    bool frame(uint64_t index, cv::Mat& view, FrameMetadata* metadata = nullptr) const;
+
+    /**
+     * @brief Get the frame at the read position and advance it
+     * @param view Output view on the mapped pixels
+     * @param metadata Receives the capture time (now) and recorded timestamp
+     * @return true until the end of the file
+     */
+    bool read(cv::Mat& view, FrameMetadata& metadata);
+
+    /**
+     * @brief Move the read position
+     * @param index Next frame to read
+     * @return true if the index is in range
+     */
+    bool seek(uint64_t index);
+
+    /**
+     * @brief Get the index of the next frame read() returns
+     * @return Read position
+     */
+    uint64_t position() const { return m_position; }
+
+    /**
+     * @brief Get the number of frames in the file
+     * @return Frame count
+     */
+    uint64_t frameCount() const { return m_frame_count; }
+
+    /**
+     * @brief Get the recorded frame rate
+     * @return Frames per second
+     */
+    double fps() const { return m_header.fps; }
+
+    /**
+     * @brief Get the stored Mat size of every frame
+     * @return Columns and rows (I420 rows include the chroma planes)
+     */
+    cv::Size frameSize() const { return cv::Size(m_header.cols, m_header.rows); }
+
+    /**
+     * @brief Get the stored Mat type of every frame
+     * @return CV_8UC3 for BGR, CV_8UC1 for I420
+     */
+    int frameType() const { return m_header.type; }
+
+private:
+    uint8_t* m_data;
+    size_t m_mapped_bytes;
+    rawfile::FileHeader m_header;
+    uint64_t m_frame_count;
+    uint64_t m_position;
+};
@@ -0,0 +1,199 @@
+#pragma once
+
+#include "frame_sink.h"
+#include "trace.h"
+
+#include <opencv2/opencv.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef WITH_CUDA
+#include <opencv2/core/cuda.hpp>
+#if defined(HAVE_OPENCV_CUDACODEC)
+#include <opencv2/cudacodec.hpp>
+#endif
+#endif
+
+/**
+ * @brief Asynchronous video recording sink
+ *
+ * Frames handed to write() are copied into a bounded queue and encoded on a
+ * dedicated thread, so a slow encoder never stalls the caller. With CUDA and
+ * the cudacodec module the sink encodes with NVENC from device memory;
+ * otherwise it uses cv::VideoWriter with the configured FourCC. When the
+ * queue is full the drop policy decides which frame gives way. stop()
+ * encodes everything still queued before closing the file.
+ */
+class RecordingSink : public FrameSink {
+public:
+    /**
+     * @brief What happens when a frame is written while the queue is full
+     */
+    enum DropPolicy {
+        BLOCK,          ///< Wait in write() until the encoder catches up
+        DROP_NEWEST,    ///< Reject the written frame
+        DROP_OLDEST     ///< Drop the oldest queued frame
+    };
+
+    /**
+     * @brief Configuration for the sink
+     */
+    struct Config {
+        std::string filename;                                           ///< Output path
+        cv::Size frame_size;                                            ///< Frame size (required)
+        double fps = 30.0;                                              ///< Output frame rate
+        int fourcc = cv::VideoWriter::fourcc('m', 'p', '4', 'v');       ///< Codec for the CPU writer
+        bool use_nvenc = true;                                          ///< Prefer NVENC (H.264) when available
+        size_t queue_size = 16;                                         ///< Frames buffered ahead of the encoder
+        DropPolicy drop_policy = DROP_OLDEST;                           ///< Policy when the queue is full
+        bool i420_input = false;                                        ///< Host frames are I420 (see yuv_frame.h)
+    };
+
+    /**
+     * @brief Construct a new sink
+     * @param config Sink configuration
+     */
+    explicit RecordingSink(const Config& config);
+
+    /**
+     * @brief Destroy the sink, flushing any queued frames
+     */
+    ~RecordingSink() override;
+
+    RecordingSink(const RecordingSink&) = delete;
+    RecordingSink& operator=(const RecordingSink&) = delete;
+
+    /**
+     * @brief Open the encoder and start the encoding thread
+     * @return true if the sink is recording
+     */
+    bool start() override;
+
+    /**
+     * @brief Encode the queued frames, close the file and join the thread
+     *
+     * A concurrent call waits for the stop already in progress.
+     */
+    void stop() override;
+
+    /**
+     * @brief Queue a host frame for encoding
+     * @param frame 8-bit BGR frame, or I420 with Config::i420_input, of the configured size (copied)
+     * @return true if the frame was queued
+     */
+    bool write(const cv::Mat& frame);
+
+    /**
+     * @brief Queue a host frame for encoding (FrameSink interface)
+     * @param frame Frame as for write(const cv::Mat&)
+     * @param metadata Unused; the file carries no per-frame timing
+     * @return true if the frame was queued
+     */
+    bool write(const cv::Mat& frame, const FrameMetadata& /*metadata*/) override { return write(frame); }
+
+#ifdef WITH_CUDA
+    /**
+     * @brief Queue a device frame for encoding
+     *
+     * The frame is copied on @p stream; the encoder waits for that copy, not
+     * for the whole stream. Not available with Config::i420_input.
+     *
+     * @param frame 8-bit BGR frame of the configured size (copied)
+     * @param stream Stream the frame was produced on
+     * @return true if the frame was queued
+     */
+    bool write(const cv::cuda::GpuMat& frame, cv::cuda::Stream& stream = cv::cuda::Stream::Null());
+
+    bool write(const cv::cuda::GpuMat& frame, const FrameMetadata& /*metadata*/,
+               cv::cuda::Stream& stream) override {
+        return write(frame, stream);
+    }
+#endif
+
+    /**
+     * @brief Check if the sink is recording
+     * @return true if running
+     */
+    bool isRunning() const override;
+
+    /**
+     * @brief Check if frames are encoded with NVENC
+     * @return true if the hardware encoder is in use
+     */
+    bool isHardwareEncoding() const;
+
+    /**
+     * @brief Get the number of frames encoded so far
+     * @return Encoded frame count
+     */
+    uint64_t framesWritten() const;
+
+    /**
+     * @brief Get the number of frames dropped at the queue
+     * @return Dropped frame count
+     */
+    uint64_t droppedFrames() const;
+
+    /**
+     * @brief Get the output path
+     * @return Output filename
+     */
+    const std::string& getFilename() const { return m_config.filename; }
+
+    std::string describe() const override { return m_config.filename; }
+
+private:
+    struct Job {
+        cv::Mat host;
+#ifdef WITH_CUDA
+        cv::cuda::GpuMat device;
+        std::shared_ptr<cv::cuda::Event> ready;     // Recorded after the device copy
+#endif
+        bool on_device = false;
+        uint64_t frame = Trace::NO_FRAME;           // Trace frame of the writing thread
+    };
+
+    Config m_config;
+
+    std::deque<Job> m_queue;        // Waiting for the encoder, oldest first
+    std::vector<Job> m_free;        // Recycled jobs so steady state doesn't allocate
+    uint64_t m_written;
+    uint64_t m_dropped;
+    bool m_running;
+    bool m_stopping;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_work_available;
+    std::condition_variable m_space_available;
+    std::condition_variable m_stopped;  // Signalled when a stop() finishes
+    std::thread m_worker;
+
+    // Encoders; exactly one is open while running
+    std::unique_ptr<cv::VideoWriter> m_writer;
+#if defined(WITH_CUDA) && defined(HAVE_OPENCV_CUDACODEC)
+    cv::Ptr<cv::cudacodec::VideoWriter> m_nvenc;
+#endif
+#ifdef WITH_CUDA
+    cv::cuda::GpuMat m_d_staging;   // Upload target for host frames into NVENC
+    cv::Mat m_h_staging;            // Download target for device frames into the CPU writer
+#endif
+    cv::Mat m_bgr_staging;          // BGR conversion of I420 frames for the CPU writer
+
+    // Encoding thread loop
+    void workerLoop();
+
+    // Encode one job (encoding thread only)
+    bool encode(Job& job);
+
+    // Open NVENC, returns false if unavailable
+    bool openHardwareEncoder();
+
+    // Claim a job slot, applying the drop policy; returns false if the frame is dropped
+    bool acquireJob(std::unique_lock<std::mutex>& lock, Job& job);
+};
@@ -1,7 +1,18 @@
 #pragma once
 
+#include "frame_arena.h"
+#include "frame_features.h"
+
 #include <opencv2/opencv.hpp>
+#include <array>
 #include <memory>
+#include <string>
+#include <vector>
+
+#ifdef WITH_CUDA
+#include <opencv2/core/cuda.hpp>
+#include <opencv2/cudafilters.hpp>
+#endif
 
 /**
  * @brief Implements selective bilateral filtering for video upscaling
@@ -17,6 +28,11 @@ public:
         POST_PROCESSING   // Applied after upscaling
     };
     
+    enum FilterMode {
+        BILATERAL_FILTER, // Exact bilateral filter, cost grows with diameter
+        GUIDED_FILTER     // Self-guided filter, box filters only (O(1) per pixel)
+    };
+    
     struct Config {
         // General parameters
         FilteringStage stage = PRE_PROCESSING;
@@ -37,6 +53,10 @@ public:
         // Multi-scale parameters
         bool use_multiscale = true;         // Use multi-scale bilateral filtering
         int num_scales = 3;                 // Number of scales for multi-scale filtering
+        
+        // Edge-preserving filter used at every scale; the guided filter takes
+        // its radius from diameter / 2 and its regularisation from sigma_color
+        FilterMode filter_mode = BILATERAL_FILTER;
     };
     
     /**
@@ -72,6 +92,22 @@ public:
      */
     bool process(const cv::Mat& input, cv::Mat& output);
     
+#ifdef WITH_CUDA
+    /**
+     * @brief Apply selective bilateral filtering to a device-resident image
+     * 
+     * Same processing as the host overload, but every step is enqueued on
+     * @p stream and the frame stays in device memory.
+     * 
+     * @param input The input image on the device
+     * @param output The output filtered image on the device
+     * @param stream Stream to enqueue the work on
+     * @return true if processing was successful
+     */
+    bool process(const cv::cuda::GpuMat& input, cv::cuda::GpuMat& output,
+                 cv::cuda::Stream& stream = cv::cuda::Stream::Null());
+#endif
+    
     /**
      * @brief Set the configuration parameters
      * 
@@ -86,9 +122,40 @@ public:
      */
     Config getConfig() const;
     
+    /**
+     * @brief Share scratch buffers and filters with other stages
+     * 
+     * @param arena Arena owned by the enclosing pipeline (ignored if null)
+     */
+    void setArena(std::shared_ptr<FrameArena> arena);
+    
+    /**
+     * @brief Share per-frame gradient and variance maps with other stages
+     * 
+     * @param features Shared cache (see FrameFeatures), or null for a private one
+     */
+    void setFeatures(std::shared_ptr<FrameFeatures> features);
+    
 private:
     Config m_config;
     bool m_initialized;
+    std::shared_ptr<FrameFeatures> m_features;  // Gray, gradient and variance maps of host images
+    bool m_shared_features;                     // m_features is invalidated by its owner
+    std::shared_ptr<FrameArena> m_arena;        // Guided filter scratch and device staging
+    
+    // Arena names of the guided filter buffers, one set per pyramid level so
+    // levels of different sizes don't reallocate each other. The stage is
+    // part of the name because pre- and post-filters share the upscaler's arena.
+    struct GuidedBuffers {
+        std::string image, mean, corr, var, a, b, tmp;
+        std::array<std::string, 4> planes;
+    };
+    std::vector<GuidedBuffers> m_guided_buffers;
+    std::string m_staging_input;                // Arena names for host/device staging in process()
+    std::string m_staging_output;
+    
+    // Rebuild the arena names for the configured stage and scale count
+    void updateArenaNames();
     
     /**
      * @brief Apply standard bilateral filter
@@ -99,6 +166,31 @@ private:
      */
     bool applyBilateralFilter(const cv::Mat& input, cv::Mat& output);
     
+    /**
+     * @brief Run the configured edge-preserving filter with explicit parameters
+     * 
+     * @param input The input image
+     * @param output The output filtered image
+     * @param diameter Neighbourhood diameter
+     * @param sigma_color Range sigma
+     * @param sigma_space Spatial sigma (bilateral mode only)
+     * @param level Pyramid level of @p input (selects the scratch buffers)
+     */
+    void applyEdgePreservingFilter(const cv::Mat& input, cv::Mat& output,
+                                   int diameter, double sigma_color, double sigma_space,
+                                   int level = 0);
+    
+    /**
+     * @brief Apply a self-guided filter built from box filters
+     * 
+     * @param input The input image (8-bit)
+     * @param output The output filtered image
+     * @param radius Box filter radius
+     * @param eps Regularisation on the 0-1 intensity scale
+     * @param level Pyramid level of @p input (selects the scratch buffers)
+     */
+    void applyGuidedFilter(const cv::Mat& input, cv::Mat& output, int radius, double eps, int level);
+    
     /**
      * @brief Apply selective bilateral filter based on content
      * 
@@ -151,4 +243,49 @@ private:
     bool applyJointBilateral(const cv::Mat& input, 
                              const cv::Mat& detail_mask, 
                              cv::Mat& output);
+    
+    /**
+     * @brief Derive filter parameters from the measured noise level
+     * 
+     * @param avg_stddev Average per-channel standard deviation of the frame
+     * @param diameter Output diameter parameter
+     * @param sigma_color Output sigma color parameter
+     * @param sigma_space Output sigma space parameter
+     */
+    void adaptParamsToNoise(double avg_stddev, 
+                            int& diameter, 
+                            double& sigma_color, 
+                            double& sigma_space) const;
+    
+#ifdef WITH_CUDA
+    // Filters for the device path, created once in initialize()
+    cv::Ptr<cv::cuda::Filter> m_d_sobel_x;
+    cv::Ptr<cv::cuda::Filter> m_d_sobel_y;
+    cv::Ptr<cv::cuda::Filter> m_d_box_filter;
+    cv::Ptr<cv::cuda::Filter> m_d_mask_blur;
+    
+    // Device counterparts of the host helpers above
+    bool applyBilateralFilter(const cv::cuda::GpuMat& input, cv::cuda::GpuMat& output,
+                              cv::cuda::Stream& stream);
+    void applyEdgePreservingFilter(const cv::cuda::GpuMat& input, cv::cuda::GpuMat& output,
+                                   int diameter, double sigma_color, double sigma_space,
+                                   cv::cuda::Stream& stream, int level = 0);
+    void applyGuidedFilter(const cv::cuda::GpuMat& input, cv::cuda::GpuMat& output,
+                           int radius, double eps, int level, cv::cuda::Stream& stream);
+    bool applySelectiveBilateral(const cv::cuda::GpuMat& input, cv::cuda::GpuMat& output,
+                                 cv::cuda::Stream& stream);
+    bool applyMultiscaleBilateral(const cv::cuda::GpuMat& input, cv::cuda::GpuMat& output,
+                                  cv::cuda::Stream& stream);
+    bool createDetailMask(const cv::cuda::GpuMat& input, cv::cuda::GpuMat& detail_mask,
+                          cv::cuda::Stream& stream);
+    bool calculateAdaptiveParams(const cv::cuda::GpuMat& input, 
+                                 int& diameter, 
+                                 double& sigma_color, 
+                                 double& sigma_space,
+                                 cv::cuda::Stream& stream);
+    bool applyJointBilateral(const cv::cuda::GpuMat& input, 
+                             const cv::cuda::GpuMat& detail_mask, 
+                             cv::cuda::GpuMat& output,
+                             cv::cuda::Stream& stream);
+#endif
 };
\ No newline at end of file
@@ -0,0 +1,61 @@
+#pragma once
+
+#ifdef WITH_FUSED_KERNELS
+
+#include <cstddef>
+#include <cuda_runtime_api.h>
+
+/**
+ * @brief Launch interface for the variable-sigma unsharp mask kernel
+ *
+ * Kept free of OpenCV types like fused_enhance_kernels.h; AdaptiveSharpening
+ * fills in the parameters from its configuration.
+ */
+namespace sharpen_kernels {
+
+constexpr int kMaxLevels = 5;                       ///< Sigma levels the weights can hold
+constexpr int kMaxRadius = 7;                       ///< Largest blur radius (15x15 kernel)
+
+struct Params {
+    float weights[kMaxLevels][2 * kMaxRadius + 1];  ///< 1D Gaussian taps per sigma level
+    int radius = 0;                                 ///< Blur radius shared by every level
+    int levels = 0;                                 ///< Sigma levels in use
+    float min_sigma = 0.0f;                         ///< Sigma of level 0
+    float level_scale = 0.0f;                       ///< Levels per unit of sigma
+    float gain = 0.0f;                              ///< Strength is gain * edge + offset
+    float offset = 0.0f;
+    bool preserve_tone = false;                     ///< Add back only the luma change (BGR only)
+};
+
+/**
+ * @brief Sharpen with a per-pixel blur sigma in one pass
+ *
+ * Each pixel maps its sigma to a fractional level, blurs its neighbourhood
+ * with the two bracketing levels only, blends them and applies the
+ * edge-weighted unsharp mask.
+ *
+ * @param src Source pixels (CV_8UC1 or CV_8UC3)
+ * @param src_step Source row pitch in bytes
+ * @param channels 1 or 3
+ * @param sigma Per-pixel blur sigma (CV_32F)
+ * @param sigma_step Sigma row pitch in bytes
+ * @param edge Edge mask (CV_32F, 0-1)
+ * @param edge_step Edge mask row pitch in bytes
+ * @param dst Destination pixels (must not alias @p src)
+ * @param dst_step Destination row pitch in bytes
+ * @param width Image width
+ * @param height Image height
+ * @param params Blur levels and strengths
+ * @param stream Stream to enqueue the kernel on
+ * @return true if the kernel was launched
+ */
+bool launchVariableSigmaSharpen(const unsigned char* src, size_t src_step, int channels,
+                                const float* sigma, size_t sigma_step,
+                                const float* edge, size_t edge_step,
+                                unsigned char* dst, size_t dst_step,
+                                int width, int height,
+                                const Params& params, cudaStream_t stream);
+
+} // namespace sharpen_kernels
+
+#endif // WITH_FUSED_KERNELS
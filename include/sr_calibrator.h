@@ -0,0 +1,143 @@
+#pragma once
+
+#include "upscaler.h"
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Picks the super-resolution model this machine can sustain
+ *
+ * Finds the models in the model directory (FSRCNN, ESPCN, LapSRN and EDSR
+ * .pb files, RealESRGAN .onnx files), orders them best quality first and
+ * times each one through a full Upscaler, enhancement chain included, on a
+ * synthetic frame at the input and output size the pipeline will use. The
+ * first model whose median frame time fits the frame budget wins; models
+ * below it are never timed.
+ *
+ * The choice is cached in a text file keyed by the host, the GPU, the
+ * geometry, the budget, the inference precision and backend and the model
+ * files themselves, so later starts on the same node skip the benchmark
+ * and a new GPU, driver-visible device or model file triggers a new one.
+ */
+class SrCalibrator {
+public:
+    /**
+     * @brief Configuration of the calibration
+     */
+    struct Config {
+        std::string model_dir = "models";                   ///< Directory searched for models
+        std::string cache_path = "models/sr_calibration.cache"; ///< Cached choices (empty = no cache)
+        bool use_cache = true;                              ///< Reuse a cached choice (false re-times and overwrites)
+        cv::Size input_size;                                ///< SR input (empty = each family's pipeline default)
+        cv::Size esrgan_input = cv::Size(1280, 720);       ///< Default RealESRGAN input (tiled inference)
+        cv::Size dnn_input = cv::Size(480, 270);           ///< Default input of the other models
+        int target_width = 1920;                            ///< Output width
+        int target_height = 1080;                           ///< Output height
+        bool use_gpu = true;                                ///< Use GPU acceleration if available
+        double frame_budget_ms = 1000.0 / 30.0;             ///< Time available per frame
+        double headroom = 0.85;                             ///< Fraction of the budget the upscaler may use
+        int warmup_runs = 2;                                ///< Untimed runs (cv::dnn plans on the first)
+        int timed_runs = 7;                                 ///< Timed runs, the median is compared
+    };
+
+    /**
+     * @brief A model file found in the model directory
+     */
+    struct Candidate {
+        Upscaler::Algorithm algorithm;                      ///< SUPER_RES or REAL_ESRGAN
+        Upscaler::Model model;                              ///< Network to load
+        int quality_rank;                                   ///< Higher is better
+        uintmax_t file_bytes;                               ///< Tie-break within a family (bigger network first)
+    };
+
+    /**
+     * @brief Timing of one candidate
+     */
+    struct Measurement {
+        Candidate candidate;
+        bool loaded = false;                                ///< Model initialized
+        double median_ms = 0.0;                             ///< Median upscale time
+        bool fits = false;                                  ///< Within the budget
+    };
+
+    /**
+     * @brief Outcome of calibrate()
+     */
+    struct Result {
+        bool found = false;                                 ///< A model fits the budget
+        Upscaler::Algorithm algorithm = Upscaler::BICUBIC;  ///< Algorithm to run (BICUBIC when none fits)
+        Upscaler::Model model;                              ///< Network to load when found
+        double median_ms = 0.0;                             ///< Measured time of the choice
+        bool from_cache = false;                            ///< Read from the cache, nothing was timed
+        std::vector<Measurement> measurements;              ///< Candidates timed, best quality first
+    };
+
+    /**
+     * @brief Default constructor
+     */
+    SrCalibrator();
+
+    /**
+     * @brief Constructor with configuration
+     * @param config Model directory, geometry and budget
+     */
+    explicit SrCalibrator(const Config& config);
+
+    /**
+     * @brief Choose a model, from the cache or by timing the candidates
+     * @return The choice; found is false if no model fits or none exists
+     */
+    Result calibrate();
+
+    /**
+     * @brief List the models in the model directory
+     * @return Candidates, best quality first
+     */
+    std::vector<Candidate> findCandidates() const;
+
+    /**
+     * @brief Format the timings of a calibration as a table
+     * @param result Result of calibrate()
+     * @return Multi-line table, empty for a cached result
+     */
+    std::string toTable(const Result& result) const;
+
+    /**
+     * @brief Identify this host and its inference device
+     * @return "<hostname>/<GPU name and compute capability>" or "<hostname>/cpu"
+     */
+    std::string hostKey() const;
+
+    /**
+     * @brief Set configuration parameters
+     * @param config New configuration
+     */
+    void setConfig(const Config& config) { m_config = config; }
+
+    /**
+     * @brief Get current configuration
+     * @return Current configuration
+     */
+    Config getConfig() const { return m_config; }
+
+private:
+    Config m_config;
+
+    // SR input the pipeline feeds a candidate
+    cv::Size inputSizeFor(const Candidate& candidate) const;
+
+    // Cache key for the current host, configuration and candidates
+    std::string cacheKey(const std::vector<Candidate>& candidates) const;
+
+    // Look the key up in the cache file
+    bool loadCached(const std::string& key, const std::vector<Candidate>& candidates, Result& result) const;
+
+    // Replace or append the key's line in the cache file
+    void storeCached(const std::string& key, const Result& result) const;
+
+    // Time one candidate through a full Upscaler
+    Measurement measure(const Candidate& candidate) const;
+};
@@ -0,0 +1,292 @@
+#pragma once
+
+#include "temporal_filter.h"
+
+#include <opencv2/opencv.hpp>
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+/**
+ * @brief Compile-time composition of a fixed chain of host processing stages
+ *
+ * Chain<Bilateral, Bicubic, Sharpen, Temporal> runs its stages in order with
+ * no virtual calls, std::function or enable flags on the way, so the
+ * compiler can specialise and inline the whole chain. Use it for fixed
+ * production presets; Processor stays the runtime-configurable path for
+ * experimentation.
+ *
+ * A stage is a plain struct with one of two shapes:
+ * - Frame stages (kRowWise = false) implement frame(src, dst) and may read
+ *   neighbourhoods or change the frame size.
+ * - Row stages (kRowWise = true) implement row(src, dst, length, y) on one
+ *   8-bit row of length = cols * channels; they must be safe with src == dst
+ *   and are called concurrently on different rows. A row stage may also
+ *   implement prepare(input) to look at its whole input frame first (an
+ *   unsharp mask blurring it, say), which makes it start a new pass.
+ *
+ * Adjacent row stages are fused into a single pass over strips of rows, so
+ * each row is read once, stays in cache through every fused stage and is
+ * written once, instead of each stage materialising a full frame.
+ * Intermediates between passes are kept and reused from frame to frame.
+ */
+template <typename... Stages>
+class Chain {
+public:
+    static constexpr size_t kStages = sizeof...(Stages);
+    static_assert(kStages > 0, "A chain needs at least one stage");
+
+    Chain() = default;
+
+    /**
+     * @brief Construct a chain from configured stages
+     *
+     * @param stages One instance of each stage, in chain order
+     */
+    explicit Chain(Stages... stages) : m_stages(std::move(stages)...) {}
+
+    /**
+     * @brief Run every stage on a frame
+     *
+     * @param input Input frame
+     * @param output Output frame (must not alias @p input)
+     * @return true if processing was successful
+     */
+    bool process(const cv::Mat& input, cv::Mat& output) {
+        if (input.empty()) {
+            std::cerr << "Empty input frame" << std::endl;
+            return false;
+        }
+
+        try {
+            runFrom<0>(input, output);
+            return true;
+        } catch (const cv::Exception& e) {
+            std::cerr << "Error in stage chain: " << e.what() << std::endl;
+            return false;
+        }
+    }
+
+    /**
+     * @brief Access a stage by position to configure it
+     */
+    template <size_t I>
+    auto& stage() { return std::get<I>(m_stages); }
+
+    /**
+     * @brief Access a stage by type to configure it (the type must be unique in the chain)
+     */
+    template <typename S>
+    S& stage() { return std::get<S>(m_stages); }
+
+private:
+    using StageTuple = std::tuple<Stages...>;
+
+    template <size_t I>
+    using StageAt = std::tuple_element_t<I, StageTuple>;
+
+    // Rows per parallel strip: a few hundred KB of a 1080p frame, which a
+    // core runs through every fused stage while it is still in cache
+    static constexpr int kRowsPerStrip = 32;
+
+    template <typename S, typename = void>
+    struct Prepares : std::false_type {};
+
+    template <typename S>
+    struct Prepares<S, std::void_t<decltype(std::declval<S&>().prepare(std::declval<const cv::Mat&>()))>>
+        : std::true_type {};
+
+    // One past the last stage fused with the row stage at Begin
+    template <size_t Begin, size_t I = Begin + 1>
+    static constexpr size_t passEnd() {
+        if constexpr (I == kStages) {
+            return I;
+        } else if constexpr (!StageAt<I>::kRowWise || Prepares<StageAt<I>>::value) {
+            return I;
+        } else {
+            return passEnd<Begin, I + 1>();
+        }
+    }
+
+    template <size_t I>
+    void runFrom(const cv::Mat& src, cv::Mat& output) {
+        if constexpr (!StageAt<I>::kRowWise) {
+            cv::Mat& dst = I + 1 == kStages ? output : m_intermediates[I];
+            std::get<I>(m_stages).frame(src, dst);
+            if constexpr (I + 1 < kStages) {
+                runFrom<I + 1>(dst, output);
+            }
+        } else {
+            constexpr size_t end = passEnd<I>();
+            cv::Mat& dst = end == kStages ? output : m_intermediates[I];
+            fusedPass<I, end>(src, dst);
+            if constexpr (end < kStages) {
+                runFrom<end>(dst, output);
+            }
+        }
+    }
+
+    template <size_t Begin, size_t End>
+    void fusedPass(const cv::Mat& src, cv::Mat& dst) {
+        CV_Assert(src.depth() == CV_8U);
+
+        if constexpr (Prepares<StageAt<Begin>>::value) {
+            std::get<Begin>(m_stages).prepare(src);
+        }
+
+        dst.create(src.size(), src.type());
+        const int length = src.cols * src.channels();
+        const int strips = std::max(1, src.rows / kRowsPerStrip);
+
+        cv::parallel_for_(cv::Range(0, src.rows), [&](const cv::Range& range) {
+            for (int y = range.start; y < range.end; ++y) {
+                uchar* out = dst.ptr<uchar>(y);
+                std::get<Begin>(m_stages).row(src.ptr<uchar>(y), out, length, y);
+                rowsInPlace<Begin + 1, End>(out, length, y);
+            }
+        }, strips);
+    }
+
+    template <size_t I, size_t End>
+    void rowsInPlace(uchar* row, int length, int y) const {
+        if constexpr (I < End) {
+            std::get<I>(m_stages).row(row, row, length, y);
+            rowsInPlace<I + 1, End>(row, length, y);
+        }
+    }
+
+    StageTuple m_stages;
+    std::array<cv::Mat, kStages> m_intermediates;  // Output of each non-final pass
+};
+
+/**
+ * @brief Stages for Chain
+ */
+namespace stage {
+
+/**
+ * @brief Edge-preserving bilateral smoothing
+ */
+struct Bilateral {
+    static constexpr bool kRowWise = false;
+
+    int diameter = 5;
+    double sigma_color = 25.0;
+    double sigma_space = 5.0;
+
+    void frame(const cv::Mat& src, cv::Mat& dst) {
+        cv::bilateralFilter(src, dst, diameter, sigma_color, sigma_space);
+    }
+};
+
+/**
+ * @brief Resize to a fixed size with a compile-time interpolation
+ */
+template <int Interpolation>
+struct Resize {
+    static constexpr bool kRowWise = false;
+
+    cv::Size size;  // Output size (set before the first frame)
+
+    void frame(const cv::Mat& src, cv::Mat& dst) {
+        cv::resize(src, dst, size, 0, 0, Interpolation);
+    }
+};
+
+using Bilinear = Resize<cv::INTER_LINEAR>;
+using Bicubic = Resize<cv::INTER_CUBIC>;
+using Lanczos = Resize<cv::INTER_LANCZOS4>;
+
+/**
+ * @brief Unsharp mask: src + amount * (src - blur(src))
+ *
+ * The blur needs the whole frame, so it runs in prepare(); the combine is a
+ * row stage that fuses with the row stages after it.
+ */
+struct Sharpen {
+    static constexpr bool kRowWise = true;
+
+    float amount = 0.5f;
+    double sigma = 1.0;
+    cv::Mat blurred;
+
+    void prepare(const cv::Mat& input) {
+        cv::GaussianBlur(input, blurred, cv::Size(0, 0), sigma);
+    }
+
+    void row(const uchar* src, uchar* dst, int length, int y) const {
+        const uchar* blur = blurred.ptr<uchar>(y);
+        for (int i = 0; i < length; ++i) {
+            dst[i] = cv::saturate_cast<uchar>(src[i] + amount * (src[i] - blur[i]));
+        }
+    }
+};
+
+/**
+ * @brief Linear contrast and brightness: gain * x + bias
+ */
+struct Contrast {
+    static constexpr bool kRowWise = true;
+
+    float gain = 1.0f;
+    float bias = 0.0f;
+
+    void row(const uchar* src, uchar* dst, int length, int) const {
+        for (int i = 0; i < length; ++i) {
+            dst[i] = cv::saturate_cast<uchar>(gain * src[i] + bias);
+        }
+    }
+};
+
+/**
+ * @brief Gamma correction through a lookup table
+ */
+struct Gamma {
+    static constexpr bool kRowWise = true;
+
+    std::array<uchar, 256> lut;
+
+    explicit Gamma(double gamma = 1.0) {
+        for (int i = 0; i < 256; ++i) {
+            lut[i] = cv::saturate_cast<uchar>(std::pow(i / 255.0, 1.0 / gamma) * 255.0);
+        }
+    }
+
+    void row(const uchar* src, uchar* dst, int length, int) const {
+        for (int i = 0; i < length; ++i) {
+            dst[i] = lut[src[i]];
+        }
+    }
+};
+
+/**
+ * @brief Recursive temporal smoothing (see TemporalFilter)
+ */
+struct Temporal {
+    static constexpr bool kRowWise = false;
+
+    TemporalFilter filter;
+
+    void frame(const cv::Mat& src, cv::Mat& dst) {
+        filter.process(src, dst);
+    }
+};
+
+} // namespace stage
+
+/**
+ * @brief Fixed chains for production use
+ */
+namespace presets {
+
+// Denoise at source size, upscale, sharpen, smooth over time
+using Production = Chain<stage::Bilateral, stage::Bicubic, stage::Sharpen, stage::Temporal>;
+
+// Production with a grade; sharpening, contrast and gamma run as one pass
+using Graded = Chain<stage::Bilateral, stage::Bicubic, stage::Sharpen, stage::Contrast,
+                     stage::Gamma, stage::Temporal>;
+
+} // namespace presets
@@ -0,0 +1,154 @@
+#pragma once
+
+#include "frame_buffer.h"
+#include "frame_metadata.h"
+#include "metrics.h"
+#include "trace.h"
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Runs processing stages concurrently, one thread per stage
+ *
+ * Stages are connected by bounded FrameBuffer queues, so while one stage
+ * works on frame N the previous one already works on frame N+1: throughput
+ * is set by the slowest stage instead of the sum of all of them. Full
+ * queues block the stage feeding them, which carries backpressure back to
+ * push().
+ *
+ * Every stage runs on its own thread, so the objects a stage function uses
+ * must not be shared with another stage.
+ */
+class StageGraph {
+public:
+    /**
+     * @brief Stage body: process one frame
+     *
+     * Returning false (or an empty output) forwards the input unchanged.
+     */
+    using StageFunction = std::function<bool(const cv::Mat& input, cv::Mat& output, FrameMetadata& metadata)>;
+
+    /**
+     * @brief Consumer of finished frames, called on the last stage's thread
+     */
+    using SinkFunction = std::function<void(const cv::Mat& frame, const FrameMetadata& metadata)>;
+
+    /**
+     * @brief Per-stage counters
+     */
+    struct StageStats {
+        std::string name;
+        uint64_t processed = 0;         ///< Frames through the stage
+        uint64_t failed = 0;            ///< Frames forwarded unprocessed
+        double occupancy = 0.0;         ///< Fraction of wall time spent working (0-1)
+        double mean_ms = 0.0;           ///< Mean processing time per frame
+        size_t queue_depth = 0;         ///< Frames waiting in the stage's input queue
+        size_t queue_capacity = 0;
+    };
+
+    /**
+     * @brief Construct an empty graph
+     * @param queue_capacity Frames each stage's input queue holds
+     */
+    explicit StageGraph(size_t queue_capacity = 2);
+
+    /**
+     * @brief Stop the stages and join their threads
+     */
+    ~StageGraph();
+
+    StageGraph(const StageGraph&) = delete;
+    StageGraph& operator=(const StageGraph&) = delete;
+
+    /**
+     * @brief Append a stage (before start())
+     *
+     * The stage's time is recorded as graph.<name> with Metrics.
+     *
+     * @param name Stage name (letters, digits, '_' and '.')
+     * @param func Stage body
+     * @return Reference to this graph for chaining
+     */
+    StageGraph& addStage(const std::string& name, StageFunction func);
+
+    /**
+     * @brief Set the consumer of the last stage's frames (before start())
+     * @param sink Consumer; without one, finished frames are discarded
+     */
+    void setSink(SinkFunction sink);
+
+    /**
+     * @brief Start one thread per stage
+     * @return true if the graph has stages and was started
+     */
+    bool start();
+
+    /**
+     * @brief Drain the queued frames and stop every stage
+     *
+     * Stages are closed front to back, so frames already pushed still reach
+     * the sink.
+     */
+    void stop();
+
+    /**
+     * @brief Feed a frame into the first stage
+     * @param frame Frame to process (copied into the queue)
+     * @param metadata Envelope travelling with the frame
+     * @param blocking Wait for room when the first queue is full
+     * @return true if the frame was queued
+     */
+    bool push(const cv::Mat& frame, const FrameMetadata& metadata, bool blocking = true);
+
+    /**
+     * @brief Check if the stage threads are running
+     * @return true between start() and stop()
+     */
+    bool isRunning() const { return m_running; }
+
+    /**
+     * @brief Get the number of stages
+     * @return Stage count
+     */
+    size_t stageCount() const { return m_stages.size(); }
+
+    /**
+     * @brief Get per-stage counters
+     * @return One entry per stage, in graph order
+     */
+    std::vector<StageStats> getStats() const;
+
+    /**
+     * @brief Format the per-stage counters as a table
+     * @return Table with occupancy and queue depth per stage
+     */
+    std::string toTable() const;
+
+private:
+    struct Stage {
+        std::string name;
+        StageFunction func;
+        std::unique_ptr<FrameBuffer> input;
+        std::thread thread;
+        Metrics::Id metric;
+        const char* trace_name = nullptr;   // Interned graph.<name>
+        std::atomic<uint64_t> processed{0};
+        std::atomic<uint64_t> failed{0};
+        std::atomic<int64_t> busy_ns{0};
+    };
+
+    size_t m_queue_capacity;
+    std::vector<std::unique_ptr<Stage>> m_stages;
+    SinkFunction m_sink;
+    bool m_running;
+    FrameMetadata::Clock::time_point m_start_time;
+
+    // Body of each stage thread
+    void runStage(size_t index);
+};
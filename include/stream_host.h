@@ -0,0 +1,210 @@
+#pragma once
+
+#include "frame_metadata.h"
+#include "metrics.h"
+#include "upscaler.h"
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class BatchedSuperRes;
+class Camera;
+class FrameBuffer;
+class TemporalConsistency;
+
+/**
+ * @brief Runs many live streams on one shared set of upscalers
+ *
+ * Each stream has a capture thread that keeps only its newest frame. A
+ * small worker pool, one Upscaler and so one model copy per worker, serves
+ * all streams earliest-deadline-first: a frame's deadline is its capture
+ * time plus its stream's latency target, so tight streams go first and
+ * streams with equal targets take turns. A stream has at most one frame in
+ * service at a time, which keeps its output in order. Temporal consistency
+ * carries history, so it runs per stream after the shared upscale instead
+ * of inside the shared Upscaler.
+ *
+ * With max_batch above 1 and FSRCNN, the workers share a single model behind
+ * a BatchedSuperRes instead, so frames from different streams run through
+ * one forward pass; there are then at least max_batch workers to fill it.
+ *
+ * Finished frames go to a bounded per-stream output buffer. Per-stream
+ * latency and drop counts are recorded in the metrics registry as
+ * "stream.<name>.latency" and "stream.<name>.dropped".
+ */
+class StreamHost {
+public:
+    /**
+     * @brief Settings shared by every stream
+     */
+    struct Config {
+        int target_width = 1920;                                ///< Output width
+        int target_height = 1080;                               ///< Output height
+        Upscaler::Algorithm algorithm = Upscaler::BICUBIC;      ///< Upscaling algorithm
+        bool use_gpu = true;                                    ///< Use GPU acceleration if available
+        size_t workers = 1;                                     ///< Shared upscalers (model copies)
+        size_t max_batch = 1;                                   ///< Frames per SR forward pass (SUPER_RES only)
+        double batch_wait_ms = 4.0;                             ///< Longest a frame waits for its batch
+    };
+
+    /**
+     * @brief Settings for one stream
+     */
+    struct StreamConfig {
+        std::string name;                   ///< Label for stats and metrics (letters, digits, '_')
+        std::string video_source;           ///< Video file or URL (empty = camera_index)
+        int camera_index = 0;               ///< Camera to open when video_source is empty
+        int capture_width = 1280;           ///< Requested capture width
+        int capture_height = 720;           ///< Requested capture height
+        int capture_fps = 30;               ///< Requested capture rate
+        double latency_target_ms = 100.0;   ///< Capture-to-output budget used for scheduling
+        bool realtime = true;               ///< Pace video files at their frame rate
+        size_t output_buffer_size = 3;      ///< Finished frames held for the consumer
+    };
+
+    /**
+     * @brief Per-stream counters
+     */
+    struct StreamStats {
+        std::string name;               ///< Stream name
+        uint64_t captured = 0;          ///< Frames read from the source
+        uint64_t processed = 0;         ///< Frames upscaled
+        uint64_t dropped = 0;           ///< Frames replaced before service or rejected by a full output
+        uint64_t deadline_misses = 0;   ///< Frames finished after their latency target
+        double latency_p50_ms = 0.0;    ///< Median capture-to-output latency
+        double latency_p99_ms = 0.0;    ///< 99th percentile capture-to-output latency
+        bool finished = false;          ///< Source has ended
+    };
+
+    /**
+     * @brief Construct a new host
+     * @param config Shared settings
+     */
+    explicit StreamHost(const Config& config);
+
+    /**
+     * @brief Destroy the host, stopping every stream
+     */
+    ~StreamHost();
+
+    StreamHost(const StreamHost&) = delete;
+    StreamHost& operator=(const StreamHost&) = delete;
+
+    /**
+     * @brief Open a stream's source; only allowed before start()
+     * @param config Stream settings
+     * @return Stream index, or -1 if the source could not be opened
+     */
+    int addStream(const StreamConfig& config);
+
+    /**
+     * @brief Build the shared upscalers and start all threads
+     * @return true if running
+     */
+    bool start();
+
+    /**
+     * @brief Stop capture and processing and join every thread
+     */
+    void stop();
+
+    /**
+     * @brief Check if the host is running
+     * @return true if running
+     */
+    bool isRunning() const { return m_running; }
+
+    /**
+     * @brief Check if every stream's source has ended and been drained
+     * @return true if no more frames will be produced
+     */
+    bool allFinished() const;
+
+    /**
+     * @brief Get the number of streams
+     * @return Stream count
+     */
+    size_t streamCount() const { return m_streams.size(); }
+
+    /**
+     * @brief Get a stream's finished frames
+     * @param stream Stream index
+     * @return Output buffer of upscaled frames, oldest first
+     */
+    FrameBuffer& output(size_t stream);
+
+    /**
+     * @brief Get a stream's name
+     * @param stream Stream index
+     * @return Stream name
+     */
+    const std::string& streamName(size_t stream) const;
+
+    /**
+     * @brief Get every stream's counters
+     * @return One entry per stream
+     */
+    std::vector<StreamStats> getStreamStats() const;
+
+    /**
+     * @brief Format the per-stream counters as a table
+     * @return Printable report
+     */
+    std::string toTable() const;
+
+private:
+    struct Stream {
+        StreamConfig config;
+        std::unique_ptr<Camera> camera;
+        std::unique_ptr<TemporalConsistency> temporal;  // Per-stream history (RealESRGAN only)
+        std::unique_ptr<FrameBuffer> output;
+        std::thread capture;
+
+        // Newest captured frame, guarded by m_mutex
+        cv::Mat pending;
+        FrameMetadata pending_metadata;
+        bool has_pending = false;
+        bool in_service = false;        // A worker holds this stream's previous frame
+        bool capture_done = false;
+
+        std::atomic<uint64_t> captured{0};
+        std::atomic<uint64_t> processed{0};
+        std::atomic<uint64_t> dropped{0};
+        std::atomic<uint64_t> deadline_misses{0};
+
+        Metrics::Id metric_latency = Metrics::INVALID_ID;
+        Metrics::Id metric_dropped = Metrics::INVALID_ID;
+    };
+
+    Config m_config;
+    std::vector<std::unique_ptr<Stream>> m_streams;
+    std::vector<std::unique_ptr<Upscaler>> m_upscalers;    // One per worker (empty when batching)
+    std::unique_ptr<BatchedSuperRes> m_batcher;             // Shared batched model, if enabled
+    std::vector<std::thread> m_workers;
+    std::atomic<bool> m_running;
+    bool m_stopping;                    // Guarded by m_mutex
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_work_available;
+
+    Metrics::Id m_metric_upscale;
+
+    // Read one stream's source until it ends or the host stops
+    void captureLoop(Stream& stream);
+
+    // Serve streams earliest-deadline-first with the given worker's upscaler
+    void workerLoop(size_t worker);
+
+    // Build the shared batched model; false if batching doesn't apply
+    bool startBatcher();
+
+    // Stream whose pending frame is due first, or null if none is waiting
+    Stream* selectStream();
+};
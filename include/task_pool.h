@@ -0,0 +1,141 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Shared work-stealing pool for tile-parallel CPU kernels
+ *
+ * One pool serves every host kernel and, once installed as its parallel
+ * backend, OpenCV's own parallel_for_ as well, so the pipeline threads and
+ * the kernels share one set of cores instead of each library spinning up
+ * its own. The pipeline sizes it with configure(), normally to the cores
+ * its capture, processing and display threads leave free.
+ *
+ * Each worker owns a task deque: it takes its own tiles newest first and
+ * steals the oldest tiles of other workers when it runs dry. A caller of
+ * parallelFor() runs tiles itself while it waits, so nested parallel loops
+ * never deadlock.
+ */
+class TaskPool {
+public:
+    /**
+     * @brief Tile body, called with a half-open range [begin, end)
+     */
+    using RangeBody = std::function<void(int begin, int end)>;
+
+    /**
+     * @brief Get the shared pool
+     * @return Pool instance (no workers until configure())
+     */
+    static TaskPool& instance();
+
+    /**
+     * @brief Get a worker count that leaves cores for pipeline threads
+     * @param pipeline_threads Threads the pipeline keeps busy itself
+     * @return Hardware threads minus @p pipeline_threads, at least 1
+     */
+    static size_t threadsBeside(size_t pipeline_threads);
+
+    /**
+     * @brief Set the number of threads running tiles
+     *
+     * The calling thread of parallelFor() counts as one, so @p threads - 1
+     * workers are started. Must not be called while a loop is running.
+     *
+     * @param threads Threads running tiles (0 = hardware threads)
+     */
+    void configure(size_t threads);
+
+    /**
+     * @brief Get the number of threads running tiles
+     * @return Workers plus the calling thread
+     */
+    size_t threadCount() const;
+
+    /**
+     * @brief Run @p body over [begin, end) in tiles on the pool
+     *
+     * Blocks until every tile has run; the first exception thrown by a tile
+     * is rethrown here.
+     *
+     * @param begin First index
+     * @param end One past the last index
+     * @param body Tile body
+     * @param grain Minimum tile size (0 = about four tiles per thread)
+     */
+    void parallelFor(int begin, int end, const RangeBody& body, int grain = 0);
+
+    /**
+     * @brief Route OpenCV's parallel_for_ through this pool
+     *
+     * Needs OpenCV 4.5.2 or newer; older versions are limited to the same
+     * thread count with cv::setNumThreads() instead.
+     *
+     * @return true if OpenCV now runs on the pool
+     */
+    bool installOpenCVBackend();
+
+    /**
+     * @brief Get the index of the calling thread within the pool
+     * @return 1..workers on a worker, 0 on any other thread
+     */
+    static int currentThreadIndex();
+
+    ~TaskPool();
+
+    TaskPool(const TaskPool&) = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+
+private:
+    // Completion state shared by the tiles of one parallelFor() call
+    struct Group {
+        std::atomic<int> pending{0};
+        std::mutex mutex;
+        std::condition_variable done;
+        std::exception_ptr error;
+        uint64_t frame;                 // Trace frame of the calling thread
+    };
+
+    struct Task {
+        const RangeBody* body;
+        int begin;
+        int end;
+        Group* group;
+    };
+
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        std::thread thread;
+    };
+
+    TaskPool();
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::atomic<bool> m_stop;
+    std::atomic<size_t> m_queued;           // Tasks waiting in any deque
+    std::atomic<size_t> m_next_victim;      // Round-robin start for external callers
+    std::mutex m_wake_mutex;
+    std::condition_variable m_wake;
+
+    // Start and stop worker threads
+    void startWorkers(size_t count);
+    void stopWorkers();
+
+    // Worker thread body
+    void workerLoop(size_t index);
+
+    // Run one queued task: own deque first (newest), then steal (oldest)
+    bool runOne(int self);
+
+    // Execute a task and signal its group
+    static void execute(const Task& task);
+};
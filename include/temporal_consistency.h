@@ -1,17 +1,30 @@
 #pragma once
 
+#include "frame_features.h"
+#include "memory_budget.h"
+
 #include <opencv2/opencv.hpp>
-#include <deque>
+#include <algorithm>
 #include <vector>
 #include <mutex>
 #include <memory>
 
+#ifdef WITH_CUDA
+#include <opencv2/core/cuda.hpp>
+#include <opencv2/cudafilters.hpp>
+#include <opencv2/cudaoptflow.hpp>
+#endif
+
 /**
  * @brief Implements temporal consistency for video upscaling
  * 
  * This class manages a buffer of previous frames and implements
  * optical flow based alignment to provide temporally consistent
  * video upscaling with reduced flickering.
+ * 
+ * The history is sized against the MemoryBudget when the first frame of a
+ * resolution arrives: if buffer_size frames do not fit, the history keeps
+ * fewer (at least one) instead of running out of memory.
  */
 class TemporalConsistency {
 public:
@@ -65,6 +78,44 @@ public:
      */
     bool process(const cv::Mat& current_frame, cv::Mat& output_frame);
     
+#ifdef WITH_CUDA
+    /**
+     * @brief Process a device-resident frame for temporal consistency
+     * 
+     * Flow, warping and blending all run on @p stream. The device path keeps
+     * its own frame history, so a stream should use one overload consistently.
+     * 
+     * @param current_frame The current frame on the device
+     * @param output_frame The output frame on the device with temporal consistency applied
+     * @param stream Stream to enqueue the work on
+     * @return true if processing was successful
+     */
+    bool process(const cv::cuda::GpuMat& current_frame, cv::cuda::GpuMat& output_frame,
+                 cv::cuda::Stream& stream = cv::cuda::Stream::Null());
+#endif
+    
+    /**
+     * @brief Get the reliability mask of the newest flow step
+     * 
+     * Near 0 where motion made the flow unreliable, 1 where the scene is
+     * static; a TemporalFilter can gate its history with it.
+     * 
+     * @param mask Output CV_32F mask (0-1) at frame size
+     * @return true if a mask is available (false after a reset or scene change)
+     */
+    bool getReliabilityMask(cv::Mat& mask);
+    
+#ifdef WITH_CUDA
+    /**
+     * @brief Get the reliability mask of the newest device flow step
+     * 
+     * @param mask Output CV_32F mask (0-1) at frame size on the device
+     * @param stream Stream to enqueue the copy on
+     * @return true if a mask is available
+     */
+    bool getReliabilityMask(cv::cuda::GpuMat& mask, cv::cuda::Stream& stream = cv::cuda::Stream::Null());
+#endif
+    
     /**
      * @brief Reset the frame buffer and state
      */
@@ -84,14 +135,112 @@ public:
      */
     Config getConfig() const;
     
+    /**
+     * @brief Share per-frame gray maps with other stages
+     * 
+     * @param features Shared cache (see FrameFeatures), or null for a private one
+     */
+    void setFeatures(std::shared_ptr<FrameFeatures> features);
+    
 private:
+    /**
+     * @brief One step of history: the previous frame warped onto its successor
+     * 
+     * Flow only ever changes the newest pair of frames, so each warp and its
+     * reliability mask are computed once and reused by the frames that follow.
+     */
+    template <typename MatT>
+    struct HistoryEntry {
+        MatT warped;    // Predecessor warped into this frame's geometry
+        MatT mask;      // Reliability of @c warped (0-1)
+    };
+    
+    /**
+     * @brief Fixed-capacity ring of history entries, newest at age 0
+     * 
+     * Slots are never released: pushing hands back the oldest slot so its
+     * buffers are overwritten in place once the history is full.
+     */
+    template <typename Entry>
+    class HistoryRing {
+    public:
+        void reserve(size_t capacity) {
+            m_slots.resize(std::max<size_t>(capacity, 1));
+            clear();
+        }
+        
+        size_t capacity() const { return m_slots.size(); }
+        
+        Entry& push() {
+            Entry& slot = m_slots[m_next];
+            m_next = (m_next + 1) % m_slots.size();
+            m_count = std::min(m_count + 1, m_slots.size());
+            return slot;
+        }
+        
+        const Entry& at(size_t age) const {
+            return m_slots[(m_next + m_slots.size() - 1 - age) % m_slots.size()];
+        }
+        
+        size_t size() const { return m_count; }
+        bool empty() const { return m_count == 0; }
+        void clear() { m_next = 0; m_count = 0; }
+        
+    private:
+        std::vector<Entry> m_slots;
+        size_t m_next = 0;
+        size_t m_count = 0;
+    };
+    
+    /**
+     * @brief Per-frame scratch buffers, reused so steady-state frames do not allocate
+     */
+    template <typename MatT>
+    struct Workspace {
+        MatT current_gray;
+        MatT flow;
+        std::vector<MatT> flow_xy;
+        MatT grid_x, grid_y;            // Identity sampling grid
+        MatT map_x, map_y;
+        MatT magnitude, reliability;
+        MatT diff;
+        MatT accumulated, weight, weight_n, weight_sum, weight_sum_n, frame_float;
+    };
+    
     Config m_config;
     bool m_initialized;
-    std::deque<cv::Mat> m_frame_buffer;
-    std::deque<cv::Mat> m_gray_buffer;
-    std::deque<cv::Mat> m_flow_buffer;
     std::mutex m_buffer_mutex;
     
+    // Host history
+    cv::Mat m_prev_frame;
+    cv::Mat m_prev_gray;
+    bool m_has_prev;
+    HistoryRing<HistoryEntry<cv::Mat>> m_history;
+    Workspace<cv::Mat> m_workspace;
+    
+    MemoryBudget::Account m_memory;     // History, previous frame and workspace
+    
+    std::shared_ptr<FrameFeatures> m_features;  // Gray maps of host frames
+    bool m_shared_features;                     // m_features is invalidated by its owner
+    
+    /**
+     * @brief Size the history rings for the configured buffer size
+     */
+    void resizeHistory();
+    
+    /**
+     * @brief Shrink a history ring to what the memory budget allows
+     * 
+     * Called with an empty history, before the first frame of a resolution.
+     * 
+     * @param history Ring to size
+     * @param size Frame size
+     * @param type Frame type
+     * @param pool Pool the ring's buffers live in
+     */
+    template <typename Entry>
+    void fitHistory(HistoryRing<Entry>& history, const cv::Size& size, int type, MemoryBudget::Pool pool);
+    
     /**
      * @brief Calculate optical flow between two frames
      * 
@@ -130,13 +279,52 @@ private:
     void calculateFlowReliabilityMask(const cv::Mat& flow, cv::Mat& mask);
     
     /**
-     * @brief Blend frames with variable weights based on motion
+     * @brief Blend the current frame with the warped history
      * 
-     * @param frames Vector of frames to blend
-     * @param reliability_masks Vector of reliability masks
+     * @param current Current frame (full weight)
+     * @param history Warped previous frames with their reliability masks
      * @param output Output blended frame
      */
-    void blendFrames(const std::vector<cv::Mat>& frames, 
-                     const std::vector<cv::Mat>& reliability_masks, 
+    void blendFrames(const cv::Mat& current,
+                     const HistoryRing<HistoryEntry<cv::Mat>>& history,
                      cv::Mat& output);
+    
+#ifdef WITH_CUDA
+    // Device history, guarded by m_buffer_mutex like the host one
+    cv::cuda::GpuMat m_d_prev_frame;
+    cv::cuda::GpuMat m_d_prev_gray;
+    bool m_d_has_prev;
+    HistoryRing<HistoryEntry<cv::cuda::GpuMat>> m_d_history;
+    Workspace<cv::cuda::GpuMat> m_d_workspace;
+    
+    // Reused device objects; the flow engine keeps its image pyramids between calls
+    cv::Ptr<cv::cuda::FarnebackOpticalFlow> m_d_farneback;
+    cv::Ptr<cv::cuda::Filter> m_d_reliability_blur;
+    
+    // Staging for host frames routed through the device path
+    std::unique_ptr<cv::cuda::Stream> m_d_stream;
+    cv::cuda::GpuMat m_d_input;
+    cv::cuda::GpuMat m_d_output;
+    
+    /**
+     * @brief Create the optical flow engine and filters for the device path
+     * 
+     * @return true if successful
+     */
+    bool createGpuResources();
+    
+    // Device counterparts of the host helpers above
+    bool calculateOpticalFlow(const cv::cuda::GpuMat& prev_frame, const cv::cuda::GpuMat& curr_frame,
+                              cv::cuda::GpuMat& flow, cv::cuda::Stream& stream);
+    bool warpFrame(const cv::cuda::GpuMat& frame, const cv::cuda::GpuMat& flow,
+                   cv::cuda::GpuMat& warped_frame, cv::cuda::Stream& stream);
+    bool detectSceneChange(const cv::cuda::GpuMat& prev_frame, const cv::cuda::GpuMat& curr_frame,
+                           cv::cuda::Stream& stream);
+    void calculateFlowReliabilityMask(const cv::cuda::GpuMat& flow, cv::cuda::GpuMat& mask,
+                                      cv::cuda::Stream& stream);
+    void blendFrames(const cv::cuda::GpuMat& current,
+                     const HistoryRing<HistoryEntry<cv::cuda::GpuMat>>& history,
+                     cv::cuda::GpuMat& output,
+                     cv::cuda::Stream& stream);
+#endif
 };
\ No newline at end of file
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+#ifdef WITH_CUDA
+#include <opencv2/core/cuda.hpp>
+#endif
+
+/**
+ * @brief Recursive (IIR) temporal filter for processed frames
+ *
+ * Keeps a single floating-point accumulator instead of a history of frames:
+ * every output is acc = frame + w * (acc - frame), so older frames decay
+ * geometrically at the cost of one preallocated buffer. Host frames keep
+ * the accumulator on the host and device frames keep it on the device.
+ *
+ * With motion gating the history weight falls off where the frame differs
+ * from the accumulator, and a reliability mask (such as the one
+ * TemporalConsistency derives from optical flow) scales it further, so
+ * moving edges don't ghost. BGR and I420 frames are both supported.
+ */
+class TemporalFilter {
+public:
+    struct Config {
+        float history_weight = 0.35f;   // Weight of the accumulated history (0 disables the filter)
+        bool motion_gating = true;      // Drop history where the frame changed
+        float motion_threshold = 32.0f; // Difference (8-bit levels) at which history is fully dropped
+    };
+
+    /**
+     * @brief Construct a new Temporal Filter object with default configuration
+     */
+    TemporalFilter();
+
+    /**
+     * @brief Construct a new Temporal Filter object with custom configuration
+     *
+     * @param config Configuration parameters
+     */
+    explicit TemporalFilter(const Config& config);
+
+    /**
+     * @brief Filter a frame
+     *
+     * The history restarts whenever the frame size or channel count changes.
+     *
+     * @param frame Current frame
+     * @param output Filtered frame (may alias @p frame)
+     * @param reliability Optional CV_32F mask (0-1) at frame size; ignored when the size differs
+     * @return true if processing was successful
+     */
+    bool process(const cv::Mat& frame, cv::Mat& output, const cv::Mat& reliability = cv::Mat());
+
+#ifdef WITH_CUDA
+    /**
+     * @brief Filter a device-resident frame
+     *
+     * The device path keeps its own accumulator, so a stream should use one
+     * overload consistently.
+     *
+     * @param frame Current frame on the device
+     * @param output Filtered frame on the device (may alias @p frame)
+     * @param reliability Optional CV_32F mask (0-1) at frame size; ignored when the size differs
+     * @param stream Stream to enqueue the work on
+     * @return true if processing was successful
+     */
+    bool process(const cv::cuda::GpuMat& frame, cv::cuda::GpuMat& output,
+                 const cv::cuda::GpuMat& reliability = cv::cuda::GpuMat(),
+                 cv::cuda::Stream& stream = cv::cuda::Stream::Null());
+#endif
+
+    /**
+     * @brief Forget the history (buffers stay allocated)
+     */
+    void reset();
+
+    /**
+     * @brief Set the config parameters
+     *
+     * @param config The new configuration to use
+     */
+    void setConfig(const Config& config);
+
+    /**
+     * @brief Get the current configuration
+     *
+     * @return The current configuration
+     */
+    Config getConfig() const;
+
+private:
+    /**
+     * @brief Accumulator and per-frame scratch, reused so steady-state frames do not allocate
+     */
+    template <typename MatT>
+    struct State {
+        MatT accumulator;           // Filtered history (CV_32F, frame channels)
+        MatT frame_float;
+        MatT delta;                 // accumulator - frame
+        MatT weight;                // Per-pixel history weight
+        MatT reliability;           // Reliability mask expanded to the frame channels
+        std::vector<MatT> planes;
+        bool valid = false;
+    };
+
+    Config m_config;
+    State<cv::Mat> m_host;
+#ifdef WITH_CUDA
+    State<cv::cuda::GpuMat> m_device;
+#endif
+
+    /**
+     * @brief Clamp the history weight to [0, 1]
+     */
+    float historyWeight() const;
+};
@@ -0,0 +1,95 @@
+#pragma once
+
+#ifdef WITH_TENSORRT
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace nvinfer1 {
+class ICudaEngine;
+class IExecutionContext;
+class IRuntime;
+}
+
+/**
+ * @brief TensorRT execution of an ONNX model with an on-disk engine cache
+ *
+ * Builds an engine for the exact input blob shape on first use and
+ * serializes it to the cache directory, keyed by the model file contents,
+ * the input shape, the precision, the GPU and the TensorRT version. A later
+ * run with the same key deserializes the engine instead of rebuilding it.
+ * The builder's timing cache (the kernel tactics it measured) is kept per
+ * GPU as well, so even a new shape builds without re-timing every layer.
+ */
+class TensorRTEngine {
+public:
+    /**
+     * @brief Construct an engine for an ONNX model
+     * @param onnx_path Model file
+     * @param cache_dir Directory for serialized engines and timing caches
+     * @param fp16 Allow FP16 kernels
+     */
+    TensorRTEngine(const std::string& onnx_path, const std::string& cache_dir, bool fp16);
+
+    /**
+     * @brief Destroy the engine and free device buffers
+     */
+    ~TensorRTEngine();
+
+    TensorRTEngine(const TensorRTEngine&) = delete;
+    TensorRTEngine& operator=(const TensorRTEngine&) = delete;
+
+    /**
+     * @brief Check that the model can be read; engines are built lazily per shape
+     * @return true if the model file was hashed successfully
+     */
+    bool initialize();
+
+    /**
+     * @brief Run one NCHW float blob through the network
+     * @param blob Input blob (CV_32F, 4 dimensions)
+     * @param output Output blob (CV_32F, 4 dimensions)
+     * @return true if inference was successful
+     */
+    bool forward(const cv::Mat& blob, cv::Mat& output);
+
+private:
+    std::string m_onnx_path;
+    std::string m_cache_dir;
+    bool m_fp16;
+    uint64_t m_model_hash;
+
+    std::unique_ptr<nvinfer1::IRuntime> m_runtime;
+    std::unique_ptr<nvinfer1::ICudaEngine> m_engine;
+    std::unique_ptr<nvinfer1::IExecutionContext> m_context;
+    std::vector<int> m_shape;           // Input shape the loaded engine was built for
+    std::string m_input_name;
+    std::string m_output_name;
+
+    void* m_d_input;
+    void* m_d_output;
+    size_t m_input_bytes;
+    size_t m_output_bytes;
+    void* m_stream;                     // cudaStream_t
+
+    // Load the engine for a shape from the cache, or build and cache it
+    bool loadEngine(const std::vector<int>& shape);
+
+    // Build a serialized engine for a shape from the ONNX model
+    bool buildEngine(const std::vector<int>& shape, std::vector<char>& plan);
+
+    // Cache file names for the current GPU
+    std::string engineCachePath(const std::vector<int>& shape) const;
+    std::string timingCachePath() const;
+
+    // Name and compute capability of the current GPU, for cache keys
+    static std::string deviceKey();
+
+    // Release device buffers
+    void releaseBuffers();
+};
+
+#endif // WITH_TENSORRT
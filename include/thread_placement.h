@@ -0,0 +1,182 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief CPU affinity, real-time scheduling and NUMA placement of pipeline threads
+ *
+ * Each pipeline thread has a role. When a thread starts it calls apply()
+ * with that role, which pins it to the role's cores and, if the role has a
+ * real-time priority, switches it to SCHED_FIFO. The shared TaskPool (and
+ * with it OpenCV's parallel_for_) is one role as well, so it can be kept on
+ * cores disjoint from the threads that have latency deadlines.
+ *
+ * A NUMA node can be chosen for frame memory, normally the GPU's node
+ * (deviceNumaNode()). FrameBuffer slots are then placed on that node, and
+ * roles without their own cores run on its cores. The frame data, the
+ * threads that touch it and the PCIe root of the GPU then share one socket.
+ *
+ * Everything here is best effort. Without permission (SCHED_FIFO needs
+ * CAP_SYS_NICE or an rtprio limit) or off Linux the thread keeps its default
+ * placement, and the failure is logged once. Configure before the pipeline
+ * threads start; the configuration is not re-applied to running threads.
+ */
+class ThreadPlacement {
+public:
+    /**
+     * @brief What a thread does in the pipeline
+     */
+    enum Role {
+        CAPTURE = 0,    ///< Camera or file capture
+        PROCESSING,     ///< Upscaling chain
+        DISPLAY,        ///< Presentation
+        INFERENCE,      ///< Super-resolution worker threads
+        POOL,           ///< TaskPool workers (host kernels and OpenCV)
+        ROLE_COUNT
+    };
+
+    /// Config::numa_node value selecting the GPU's node
+    static constexpr int GPU_NUMA_NODE = -2;
+
+    /**
+     * @brief Placement of one role
+     */
+    struct Policy {
+        std::vector<int> cpus;          ///< Cores the role may run on (empty = any)
+        int realtime_priority = 0;      ///< SCHED_FIFO priority 1-99 (0 = normal scheduling)
+    };
+
+    /**
+     * @brief Placement of every role
+     */
+    struct Config {
+        std::array<Policy, ROLE_COUNT> roles;
+        int numa_node = -1;             ///< Node for frame memory (-1 = none, GPU_NUMA_NODE = the GPU's)
+    };
+
+    /**
+     * @brief Get the process-wide placement
+     * @return Placement instance (leaves threads alone until configure())
+     */
+    static ThreadPlacement& instance();
+
+    /**
+     * @brief Set the placement
+     *
+     * GPU_NUMA_NODE is resolved here; it falls back to no node if the GPU's
+     * node is unknown.
+     *
+     * @param config New placement
+     */
+    void configure(const Config& config);
+
+    /**
+     * @brief Get the placement, with the NUMA node resolved
+     * @return Current placement
+     */
+    Config getConfig() const;
+
+    /**
+     * @brief Check if frame memory is placed on a NUMA node
+     * @return Node index, -1 if none
+     */
+    int numaNode() const;
+
+    /**
+     * @brief Place the calling thread as configured for its role
+     * @param role Role of the calling thread
+     * @return true if the placement took effect (or there was nothing to do)
+     */
+    bool apply(Role role);
+
+    /**
+     * @brief Get the number of cores a role is confined to
+     * @param role Role to query
+     * @param fallback Value returned when the role may run anywhere
+     * @return Core count or @p fallback
+     */
+    size_t cpuCount(Role role, size_t fallback) const;
+
+    /**
+     * @brief Move memory to the configured NUMA node
+     *
+     * Pages already touched are migrated, later faults follow the node.
+     * Only whole pages inside the range are affected. Does nothing
+     * without a node.
+     *
+     * @param data Start of the memory
+     * @param bytes Length of the memory
+     * @return true if the memory is on the node (or no node is set)
+     */
+    bool bindMemory(void* data, size_t bytes) const;
+
+    /**
+     * @brief Allocate on the configured NUMA node for the scope's lifetime
+     *
+     * Sets the calling thread's memory policy to prefer the node, for
+     * allocations that touch their pages straight away (page-locked host
+     * memory). Restores the default policy when destroyed.
+     */
+    class MemoryScope {
+    public:
+        MemoryScope();
+        ~MemoryScope();
+        MemoryScope(const MemoryScope&) = delete;
+        MemoryScope& operator=(const MemoryScope&) = delete;
+
+    private:
+        bool m_active;
+    };
+
+    /**
+     * @brief Parse a Linux CPU list ("0-3,8,10-11")
+     * @param text CPU list
+     * @param cpus Parsed core indices, sorted
+     * @return true if the list is valid and not empty
+     */
+    static bool parseCpuList(const std::string& text, std::vector<int>& cpus);
+
+    /**
+     * @brief Format core indices as a CPU list
+     * @param cpus Core indices
+     * @return List such as "0-3,8", "any" when empty
+     */
+    static std::string formatCpuList(const std::vector<int>& cpus);
+
+    /**
+     * @brief Get the NUMA node a CUDA device is attached to
+     * @param device CUDA device index
+     * @return Node index, -1 if unknown (no CUDA, single node, no sysfs)
+     */
+    static int deviceNumaNode(int device = 0);
+
+    /**
+     * @brief Get the cores of a NUMA node
+     * @param node Node index
+     * @return Core indices, empty if the node is unknown
+     */
+    static std::vector<int> nodeCpus(int node);
+
+    /**
+     * @brief Get the name of a role for logs and options
+     * @param role Role
+     * @return "capture", "process", "display", "sr" or "pool"
+     */
+    static const char* roleName(Role role);
+
+    ThreadPlacement(const ThreadPlacement&) = delete;
+    ThreadPlacement& operator=(const ThreadPlacement&) = delete;
+
+private:
+    ThreadPlacement();
+
+    mutable std::mutex m_mutex;
+    Config m_config;
+    std::vector<int> m_node_cpus;       // Cores of m_config.numa_node
+    bool m_warned_affinity;
+    bool m_warned_realtime;
+};
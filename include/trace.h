@@ -0,0 +1,147 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Per-frame trace timeline of stage spans
+ *
+ * Metrics explain averages; the trace shows which thread and which stage
+ * stalled one particular frame. Each span records a stage name, the frame
+ * ID the thread is working on (see setFrame()) and begin/end times into a
+ * fixed ring owned by the recording thread, so recording takes no lock and
+ * shares no cache line with other threads. dump() writes the rings as
+ * Chrome trace JSON, which chrome://tracing and Perfetto open directly.
+ *
+ * Built with WITH_NVTX, every span is also an NVTX range, so host stages
+ * line up with the GPU work under them in Nsight Systems.
+ *
+ * Until start() every TraceScope is one relaxed load and a branch.
+ */
+class Trace {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /// Frame ID of spans recorded outside any frame
+    static constexpr uint64_t NO_FRAME = UINT64_MAX;
+
+    /**
+     * @brief Start recording spans
+     * @param events_per_thread Ring size of each thread; older spans are overwritten
+     */
+    static void start(size_t events_per_thread = 65536);
+
+    /**
+     * @brief Stop recording (spans already recorded are kept for dump())
+     */
+    static void stop();
+
+    /**
+     * @brief Check if spans are recorded
+     * @return true between start() and stop()
+     */
+    static bool enabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Write every thread's spans as Chrome trace JSON
+     *
+     * Safe while recording, though spans written during the dump may show
+     * up overwritten; call after stop() for a consistent file.
+     *
+     * @param path Output path
+     * @return true if the file was written
+     */
+    static bool dump(const std::string& path);
+
+    /**
+     * @brief Name the calling thread in the trace
+     * @param name Thread name (copied)
+     */
+    static void setThreadName(const std::string& name);
+
+    /**
+     * @brief Set the frame the calling thread works on
+     * @param frame_id Frame ID, or NO_FRAME
+     */
+    static void setFrame(uint64_t frame_id);
+
+    /**
+     * @brief Get the frame the calling thread works on
+     * @return Frame ID, or NO_FRAME
+     */
+    static uint64_t currentFrame();
+
+    /**
+     * @brief Keep a copy of a runtime name for the life of the process
+     *
+     * Span names are stored as pointers; names that are not string literals
+     * must be interned once, outside the hot path.
+     *
+     * @param name Span name
+     * @return Stable pointer to the copy (the same one for equal names)
+     */
+    static const char* intern(const std::string& name);
+
+    /**
+     * @brief Record a finished span on the calling thread
+     * @param name Span name (string literal or interned)
+     * @param frame_id Frame ID, or NO_FRAME
+     * @param begin Start time
+     * @param end End time
+     */
+    static void record(const char* name, uint64_t frame_id, Clock::time_point begin, Clock::time_point end);
+
+    // Range markers for external profilers (no-ops without WITH_NVTX)
+    static void pushRange(const char* name);
+    static void popRange();
+
+private:
+    static inline std::atomic<bool> s_enabled{false};
+};
+
+/**
+ * @brief Records the lifetime of a scope as a trace span
+ *
+ * The frame ID is the calling thread's current frame at construction unless
+ * setFrame() overrides it, for spans (like a buffer wait) that only learn
+ * their frame at the end.
+ */
+class TraceScope {
+public:
+    explicit TraceScope(const char* name)
+        : m_name(name), m_active(Trace::enabled()) {
+        if (m_active) {
+            m_frame = Trace::currentFrame();
+            Trace::pushRange(m_name);
+            m_begin = Trace::Clock::now();
+        }
+    }
+
+    ~TraceScope() {
+        end();
+    }
+
+    /**
+     * @brief Record the span now instead of at the end of the scope
+     */
+    void end() {
+        if (m_active) {
+            m_active = false;
+            Trace::record(m_name, m_frame, m_begin, Trace::Clock::now());
+            Trace::popRange();
+        }
+    }
+
+    void setFrame(uint64_t frame_id) { m_frame = frame_id; }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* m_name;
+    bool m_active;
+    uint64_t m_frame = Trace::NO_FRAME;
+    Trace::Clock::time_point m_begin;
+};
@@ -5,10 +5,18 @@
 #include <memory>
 #include <string>
 
+#ifdef WITH_CUDA
+#include <opencv2/core/cuda.hpp>
+#endif
+
 // Forward declarations for enhancement modules
 class SelectiveBilateral;
 class AdaptiveSharpening;
 class TemporalConsistency;
+class FrameArena;
+class FrameFeatures;
+class FusedEnhancer;
+class DuplicateDetector;
 
 // Forward declaration of implementation classes
 class UpscalerImpl;
@@ -37,6 +45,16 @@ public:
         REAL_ESRGAN   ///< RealESRGAN model (best quality)
     };
     
+    /**
+     * @brief Network file loaded by the SUPER_RES and REAL_ESRGAN algorithms
+     */
+    struct Model {
+        std::string path;               ///< Model file
+        std::string name;               ///< dnn_superres name ("fsrcnn", "edsr", ...), "esrgan" for ONNX
+        DnnSuperRes::ModelType type = DnnSuperRes::FSRCNN; ///< Network family
+        int scale = 4;                  ///< Native upscaling factor
+    };
+    
     /**
      * @brief Construct a new Upscaler
      * @param algorithm The upscaling algorithm to use
@@ -65,6 +83,69 @@ public:
      */
     bool upscale(const cv::Mat& input, cv::Mat& output);
     
+    /**
+     * @brief Upscale a planar I420 frame (see yuv_frame.h) to the target resolution
+     * 
+     * Luma-only models (FSRCNN, ESPCN) run on the Y plane and plain
+     * interpolation resizes each plane, with chroma processed at its native
+     * quarter resolution. Stages that need colour (RealESRGAN, the
+     * enhancement chain, bicubic anti-aliasing, the device path) convert to
+     * BGR and back around themselves.
+     * 
+     * @param input Input I420 frame
+     * @param output Output I420 frame at the target resolution (even sizes only)
+     * @return true if upscaling was successful
+     */
+    bool upscaleI420(const cv::Mat& input, cv::Mat& output);
+    
+#ifdef WITH_CUDA
+    /**
+     * @brief Upscale a device-resident frame to the target resolution
+     * 
+     * Runs the whole enhancement chain on @p stream without leaving the GPU,
+     * so the caller uploads once and downloads once (or hands the result to a
+     * device consumer). The DNN models still exchange host memory with
+     * cv::dnn, which costs one transfer pair around the network only.
+     * 
+     * @param input Input frame on the device (8-bit BGR)
+     * @param output Output frame on the device at the target resolution
+     * @param stream Stream to enqueue all stages on
+     * @return true if upscaling was successful
+     */
+    bool upscale(const cv::cuda::GpuMat& input, cv::cuda::GpuMat& output,
+                 cv::cuda::Stream& stream = cv::cuda::Stream::Null());
+#endif
+    
+    /**
+     * @brief Upscale with host transfers overlapped across consecutive frames
+     * 
+     * Queues @p input on the device chain and returns the frame queued by
+     * the previous call, so frame N uploads and frame N-1 downloads on their
+     * own streams while the chain works. Output therefore lags input by one
+     * frame: @p output is empty after the first call, and an empty @p input
+     * collects the last frame without queueing a new one. Without the device
+     * chain (see overlapsTransfers()) this is a plain synchronous upscale().
+     * Page-locked input frames (see FrameBuffer) are needed for the upload
+     * to overlap.
+     * 
+     * @param input Input frame to queue, or empty to drain
+     * @param output Previous frame at the target resolution, or empty
+     * @return true unless the collected frame failed
+     */
+    bool upscaleOverlapped(const cv::Mat& input, cv::Mat& output);
+    
+    /**
+     * @brief Check if upscaleOverlapped() pipelines frames through the device
+     * @return true if the device chain and its stream are in use
+     */
+    bool overlapsTransfers() const {
+#ifdef WITH_CUDA
+        return m_initialized && m_use_gpu && m_stream != nullptr;
+#else
+        return false;
+#endif
+    }
+    
     /**
      * @brief Set the upscaling algorithm
      * @param algorithm The algorithm to use
@@ -98,6 +179,10 @@ public:
 
     /**
      * @brief Adaptively adjust quality based on performance
+     * 
+     * One-way switch from SUPER_RES to BICUBIC that reinitializes in place;
+     * QualityGovernor steps both ways without stalling a frame.
+     * 
      * @param processing_time Current processing time
      * @param target_time Target processing time
      * @return true if quality was adjusted
@@ -121,6 +206,10 @@ public:
     void setUseAdaptiveSharpening(bool enable) { m_use_adaptive_sharpening = enable; }
     void setUseTemporalConsistency(bool enable) { m_use_temporal_consistency = enable; }
     
+    // Run sharpening and post-filtering as one fused CUDA kernel when it was
+    // built (WITH_FUSED_KERNELS); otherwise the modules run separately
+    void setUseFusedEnhancement(bool enable) { m_use_fused_enhancement = enable; }
+    
     bool isUsingSelectiveBilateral() const { return m_use_selective_bilateral; }
     bool isUsingAdaptiveSharpening() const { return m_use_adaptive_sharpening; }
     bool isUsingTemporalConsistency() const { return m_use_temporal_consistency; }
@@ -131,20 +220,68 @@ public:
     SelectiveBilateral* getBilateralPostProcessor() { return m_bilateral_post.get(); }
     TemporalConsistency* getTemporalConsistency() { return m_temporal_consistency.get(); }
     
+    // Scratch buffers shared by the implementation and the enhancement modules
+    FrameArena* getFrameArena() { return m_arena.get(); }
+    
+    // Gray, gradient, edge and variance maps shared by the host-path stages,
+    // dropped once per upscale() call
+    FrameFeatures* getFrameFeatures() { return m_features.get(); }
+    
+    // Skip inputs that repeat a recent input within threshold (mean absolute
+    // difference of a grey thumbnail, 8-bit levels) and hand back that
+    // input's result instead (see duplicate_detector.h). Stored results are
+    // dropped when the algorithm or device changes. upscaleOverlapped()
+    // always processes, since the check would wait for the device.
+    void setDuplicateSkipping(bool enable, float threshold = 1.0f);
+    
+    // Hit counters of the duplicate check, or nullptr when it is off
+    const DuplicateDetector* getDuplicateDetector() const { return m_duplicates.get(); }
+    
+    // Network loaded for SUPER_RES or REAL_ESRGAN on the next initialize()
+    void setModel(Algorithm algorithm, const Model& model);
+    const Model& getModel(Algorithm algorithm) const;
+    
+    // Check if the network loaded; SUPER_RES and REAL_ESRGAN fall back to
+    // interpolation when it doesn't
+    bool isUsingModel() const { return m_dnn_sr && m_dnn_sr->isInitialized(); }
+    
+    // Networks picked up by every upscaler constructed afterwards, so a
+    // calibrated choice (see sr_calibrator.h) reaches the upscalers built
+    // inside the scheduler, the governor and the loader
+    static void setDefaultModel(Algorithm algorithm, const Model& model);
+    static Model getDefaultModel(Algorithm algorithm);
+    
 private:
     Algorithm m_algorithm;             // Selected upscaling algorithm
     bool m_use_gpu;                    // Whether to use GPU acceleration
     bool m_initialized;                // Whether upscaler has been initialized
     int m_target_width;                // Target width for upscaled frames
     int m_target_height;               // Target height for upscaled frames
+    Model m_sr_model;                  // Network for SUPER_RES
+    Model m_esrgan_model;              // Network for REAL_ESRGAN
     
     // Implementation of upscaler (CPU or GPU depending on availability)
     std::unique_ptr<UpscalerImpl> m_impl;
     std::unique_ptr<DnnSuperRes> m_dnn_sr;
     
+    // Per-frame scratch buffers, closed once per upscale() call
+    std::shared_ptr<FrameArena> m_arena;
+    std::shared_ptr<FrameFeatures> m_features;
+    bool m_in_frame;
+    
     // Initialize the implementation based on current settings
     bool initializeImpl();
     
+    // Repeated-input check in front of the public entry points
+    std::unique_ptr<DuplicateDetector> m_duplicates;
+    
+    // The entry points without the duplicate check
+    bool upscaleHost(const cv::Mat& input, cv::Mat& output);
+    bool upscaleI420Frame(const cv::Mat& input, cv::Mat& output);
+#ifdef WITH_CUDA
+    bool upscaleDevice(const cv::cuda::GpuMat& input, cv::cuda::GpuMat& output, cv::cuda::Stream& stream);
+#endif
+    
     // Helper method to initialize enhancements
     bool initializeEnhancements();
     
@@ -158,4 +295,30 @@ private:
     bool m_use_selective_bilateral;
     bool m_use_adaptive_sharpening;
     bool m_use_temporal_consistency;
+    bool m_use_fused_enhancement;
+    
+#ifdef WITH_CUDA
+    // Stream and reusable buffers for the GPU-resident chain
+    std::unique_ptr<cv::cuda::Stream> m_stream;
+    cv::cuda::GpuMat m_d_input;
+    cv::cuda::GpuMat m_d_preprocessed;
+    cv::cuda::GpuMat m_d_upscaled;
+    cv::cuda::GpuMat m_d_sharpened;
+    cv::cuda::GpuMat m_d_postprocessed;
+    cv::cuda::GpuMat m_d_output;
+    cv::Mat m_h_sr_input;
+    cv::Mat m_h_sr_output;
+    
+#ifdef WITH_FUSED_KERNELS
+    // Fused sharpen + post-filter stage, built from the module configs
+    std::unique_ptr<FusedEnhancer> m_fused;
+#endif
+    
+    // Transfer streams and frames in flight for upscaleOverlapped()
+    struct OverlapState;
+    std::unique_ptr<OverlapState> m_overlap;
+    
+    // Create the chain's stream once the GPU path is selected
+    void initializeStream();
+#endif
 };
\ No newline at end of file
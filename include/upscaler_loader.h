@@ -0,0 +1,88 @@
+#pragma once
+
+#include "upscaler.h"
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <memory>
+#include <thread>
+
+/**
+ * @brief Builds and warms an Upscaler off the frame thread
+ *
+ * Model loading, enhancement setup and the first inference (which is where
+ * cv::dnn allocates and plans for the input shape) take seconds. The loader
+ * does all of that on its own thread, including one forward pass of a dummy
+ * frame at the real input size, so the pipeline can stream with a cheap
+ * upscaler and switch to the loaded one between two frames with no stall.
+ */
+class UpscalerLoader {
+public:
+    /**
+     * @brief What to build and how to warm it
+     */
+    struct Config {
+        Upscaler::Algorithm algorithm = Upscaler::REAL_ESRGAN;  ///< Algorithm to load
+        int target_width = 1920;                                ///< Output width
+        int target_height = 1080;                               ///< Output height
+        bool use_gpu = true;                                    ///< Use GPU acceleration if available
+        cv::Size warmup_size = cv::Size(640, 360);              ///< Input size of the warm-up frame (empty = skip)
+    };
+
+    /**
+     * @brief Construct a new loader
+     * @param config Loader configuration
+     */
+    explicit UpscalerLoader(const Config& config);
+
+    /**
+     * @brief Destroy the loader, waiting for a load in progress
+     */
+    ~UpscalerLoader();
+
+    UpscalerLoader(const UpscalerLoader&) = delete;
+    UpscalerLoader& operator=(const UpscalerLoader&) = delete;
+
+    /**
+     * @brief Start loading on the background thread
+     *
+     * The thread binds to the CUDA device current on the caller.
+     */
+    void start();
+
+    /**
+     * @brief Check if the upscaler is loaded and warm
+     * @return true once take() will succeed
+     */
+    bool isReady() const { return m_ready.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Check if loading gave up
+     * @return true if the algorithm could not be initialized
+     */
+    bool hasFailed() const { return m_failed.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Hand over the loaded upscaler
+     * @return The upscaler, or null if it isn't ready (or was already taken)
+     */
+    std::unique_ptr<Upscaler> take();
+
+    /**
+     * @brief Get the time the load and warm-up took
+     * @return Seconds, valid once ready
+     */
+    double getLoadSeconds() const { return m_load_seconds; }
+
+private:
+    Config m_config;
+    std::unique_ptr<Upscaler> m_upscaler;   // Written by the loader thread before m_ready
+    std::atomic<bool> m_ready;
+    std::atomic<bool> m_failed;
+    double m_load_seconds;
+    int m_device;
+    std::thread m_thread;
+
+    // Loader thread body
+    void load();
+};
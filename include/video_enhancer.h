@@ -1,9 +1,16 @@
 #pragma once
 
+#include "frame_arena.h"
+
 #include <opencv2/opencv.hpp>
 #include <memory>
 #include <string>
 
+#ifdef WITH_FUSED_KERNELS
+#include <opencv2/core/cuda.hpp>
+#include "fused_enhance_kernels.h"
+#endif
+
 class VideoEnhancer {
 public:
     enum EnhancementLevel {
@@ -22,9 +29,51 @@ public:
     void setLevel(EnhancementLevel level);
     EnhancementLevel getLevel() const;
     
+    // Grade with a .cube LUT instead of the built-in cinematic one; an empty
+    // path restores the built-in grade
+    bool loadCubeLUT(const std::string& filepath);
+    
+    // Share scratch buffers with the other stages of a pipeline (ignored if null)
+    void setArena(std::shared_ptr<FrameArena> arena);
+    
+    // Trilinear 3D LUT lookup; the LUT is (size * size) x size CV_8UC3,
+    // indexed as (b + g * size, r). An optional CV_32F per-pixel gain scales
+    // the result. Public so the kernel benchmarks can time it in isolation.
+    void applyLUT(cv::Mat& image, const cv::Mat& lut3D);
+    void applyLUT(const cv::Mat& src, cv::Mat& dst, const cv::Mat& lut3D, const cv::Mat& gain);
+    
+#ifdef WITH_FUSED_KERNELS
+    // Same lookup on the GPU through a 3D texture, so the hardware does the
+    // trilinear interpolation. The texture is re-uploaded only when lut3D is
+    // a different Mat from the previous call. Returns false if the launch fails.
+    bool applyLUT(const cv::cuda::GpuMat& src, cv::cuda::GpuMat& dst, const cv::Mat& lut3D,
+                  const cv::cuda::GpuMat& gain, cv::cuda::Stream& stream = cv::cuda::Stream::Null());
+#endif
+    
 private:
     EnhancementLevel m_level;
     bool m_initialized;
+    std::shared_ptr<FrameArena> m_arena;    // Per-frame scratch buffers
+    cv::Ptr<cv::CLAHE> m_clahe;             // Local contrast, created on first use
+    
+    // Fused colour stage: the per-pixel colour operations of the current level
+    // baked into one 3D LUT, rebuilt when the level or grading LUT changes
+    static const int COLOR_LUT_SIZE = 33;
+    cv::Mat m_color_lut;
+    bool m_color_lut_valid;
+    cv::Mat m_grading_lut;      // Loaded .cube LUT, empty for the built-in grade
+    cv::Mat m_cinematic_lut;    // Built-in grade, created on first use
+    cv::Mat m_vignette_gain;    // Per-pixel vignette gain, cached per frame size
+    float m_vignette_strength;
+    
+#ifdef WITH_FUSED_KERNELS
+    fused_kernels::Lut3D m_device_lut;
+    cv::Mat m_device_lut_source;    // Header of the Mat behind m_device_lut
+#endif
+    
+    void rebuildColorLUT();
+    void applyColorStage(cv::Mat& image);
+    const cv::Mat& vignetteGain(const cv::Size& size, float strength);
     
     // Color processing
     void enhanceColors(cv::Mat& image);
@@ -34,7 +83,6 @@ private:
 
     // LUT-based color grading methods
     cv::Mat createCinematicLUT();
-    void applyLUT(cv::Mat& image, const cv::Mat& lut3D);
     void addVignette(cv::Mat& image, float strength);
     bool loadCubeLUT(const std::string& filepath, cv::Mat& lut3D);
     
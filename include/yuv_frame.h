@@ -0,0 +1,75 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+/**
+ * @brief Helpers for planar I420 frames carried through the pipeline
+ *
+ * An I420 frame uses OpenCV's layout for COLOR_BGR2YUV_I420: one continuous
+ * CV_8UC1 Mat of height * 3 / 2 rows holding the full-resolution Y plane
+ * followed by the quarter-resolution U and V planes. Keeping frames in this
+ * form from capture to the encoder lets luma-only stages skip the BGR
+ * round trip and processes chroma at its native resolution, which is half
+ * the memory traffic of a BGR frame. Frame dimensions must be even.
+ */
+namespace yuv {
+
+/**
+ * @brief Get the picture size of an I420 frame
+ *
+ * @param i420 I420 frame
+ * @return Width and height of the picture (not of the Mat)
+ */
+cv::Size frameSize(const cv::Mat& i420);
+
+/**
+ * @brief Allocate an I420 frame for a picture size
+ *
+ * Reuses the existing buffer when it already has the right shape.
+ *
+ * @param size Picture size (even width and height)
+ * @param i420 Frame to allocate
+ */
+void create(const cv::Size& size, cv::Mat& i420);
+
+/**
+ * @brief Get header views of the three planes of an I420 frame
+ *
+ * The views share the frame's memory, so writing to them writes the frame.
+ *
+ * @param i420 Continuous I420 frame
+ * @param y Full-resolution luma plane
+ * @param u Quarter-resolution U plane
+ * @param v Quarter-resolution V plane
+ */
+void planes(const cv::Mat& i420, cv::Mat& y, cv::Mat& u, cv::Mat& v);
+
+/**
+ * @brief Resize an I420 frame plane by plane
+ *
+ * @param src Source I420 frame
+ * @param dst Destination I420 frame (must not alias @p src)
+ * @param size Destination picture size
+ * @param luma_interpolation Interpolation for the Y plane
+ * @param chroma_interpolation Interpolation for the U and V planes
+ */
+void resize(const cv::Mat& src, cv::Mat& dst, const cv::Size& size,
+            int luma_interpolation, int chroma_interpolation = cv::INTER_LINEAR);
+
+/**
+ * @brief Convert an I420 frame to BGR
+ *
+ * @param i420 Source I420 frame
+ * @param bgr Destination 8-bit BGR image
+ */
+void toBGR(const cv::Mat& i420, cv::Mat& bgr);
+
+/**
+ * @brief Convert a BGR image to an I420 frame
+ *
+ * @param bgr Source 8-bit BGR image (even width and height)
+ * @param i420 Destination I420 frame
+ */
+void fromBGR(const cv::Mat& bgr, cv::Mat& i420);
+
+} // namespace yuv
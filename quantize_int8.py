@@ -0,0 +1,159 @@
+"""Quantise the FSRCNN/ESPCN super-resolution models to INT8 OpenVINO IR.
+
+The TensorFlow graphs in models/ are converted to OpenVINO IR, calibrated
+on luma patches taken from sample frames and quantised with NNCF. The
+result lands in models/int8/<model stem>.xml and .bin, where DnnSuperRes
+looks for it when run with --int8.
+
+Frames come from the videos and images given with --calibration (files or
+directories); without any, blurred noise is used, which quantises but
+loses more quality. The input layout is changed to NCHW with dynamic
+height and width so OpenCV can feed the same blob it feeds the .pb graph.
+
+Requires: pip install openvino nncf opencv-python numpy
+"""
+
+import argparse
+import os
+import sys
+
+import cv2
+import numpy as np
+
+VIDEO_EXTENSIONS = {".mp4", ".mkv", ".avi", ".mov", ".webm"}
+IMAGE_EXTENSIONS = {".png", ".jpg", ".jpeg", ".bmp"}
+
+
+def collect_sources(paths):
+    sources = []
+    for path in paths:
+        if os.path.isdir(path):
+            for name in sorted(os.listdir(path)):
+                sources.append(os.path.join(path, name))
+        else:
+            sources.append(path)
+    return [s for s in sources if os.path.splitext(s)[1].lower() in VIDEO_EXTENSIONS | IMAGE_EXTENSIONS]
+
+
+def read_frames(sources, count):
+    """Yield up to count BGR frames spread over the given videos and images."""
+    produced = 0
+    for source in sources:
+        if os.path.splitext(source)[1].lower() in IMAGE_EXTENSIONS:
+            frame = cv2.imread(source)
+            if frame is not None:
+                yield frame
+                produced += 1
+        else:
+            capture = cv2.VideoCapture(source)
+            total = int(capture.get(cv2.CAP_PROP_FRAME_COUNT)) or count
+            step = max(1, total // max(1, count // max(1, len(sources))))
+            index = 0
+            while produced < count:
+                capture.set(cv2.CAP_PROP_POS_FRAMES, index)
+                ok, frame = capture.read()
+                if not ok:
+                    break
+                yield frame
+                produced += 1
+                index += step
+            capture.release()
+        if produced >= count:
+            return
+
+
+def calibration_patches(sources, count, size):
+    """Luma patches in [0, 1] shaped (1, 1, size, size), as DnnSuperRes feeds them."""
+    rng = np.random.default_rng(0)
+    patches = []
+    for frame in read_frames(sources, count):
+        luma = cv2.cvtColor(frame, cv2.COLOR_BGR2YCrCb)[:, :, 0]
+        if luma.shape[0] < size or luma.shape[1] < size:
+            luma = cv2.resize(luma, (max(size, luma.shape[1]), max(size, luma.shape[0])))
+        y = rng.integers(0, luma.shape[0] - size + 1)
+        x = rng.integers(0, luma.shape[1] - size + 1)
+        patches.append(luma[y:y + size, x:x + size])
+
+    while len(patches) < count:
+        noise = rng.integers(0, 256, (size, size), dtype=np.uint8)
+        patches.append(cv2.GaussianBlur(noise, (0, 0), 1.5))
+
+    return [p.astype(np.float32)[None, None] / 255.0 for p in patches]
+
+
+def to_nchw(model):
+    """Expose the NHWC TensorFlow graph with NCHW input and output tensors."""
+    import openvino as ov
+
+    model.reshape({model.inputs[0]: ov.PartialShape([1, -1, -1, 1])})
+    ppp = ov.preprocess.PrePostProcessor(model)
+    ppp.input().tensor().set_layout(ov.Layout("NCHW"))
+    ppp.input().model().set_layout(ov.Layout("NHWC"))
+    ppp.output().tensor().set_layout(ov.Layout("NCHW"))
+    ppp.output().model().set_layout(ov.Layout("NHWC"))
+    return ppp.build()
+
+
+def quantize(model_path, output_dir, sources, samples, patch_size):
+    import nncf
+    import openvino as ov
+
+    print(f"Converting {model_path} to OpenVINO IR...")
+    model = to_nchw(ov.convert_model(model_path))
+
+    patches = calibration_patches(sources, samples, patch_size)
+    print(f"Calibrating on {len(patches)} luma patches of {patch_size}x{patch_size}...")
+    quantized = nncf.quantize(model, nncf.Dataset(patches), subset_size=len(patches))
+
+    os.makedirs(output_dir, exist_ok=True)
+    stem = os.path.splitext(os.path.basename(model_path))[0]
+    output_path = os.path.join(output_dir, stem + ".xml")
+    ov.save_model(quantized, output_path, compress_to_fp16=False)
+    print(f"Saved INT8 model to {output_path}")
+
+    # Compare against the FP32 graph on the calibration patches
+    core = ov.Core()
+    reference = core.compile_model(model, "CPU")
+    candidate = core.compile_model(quantized, "CPU")
+    errors = []
+    for patch in patches[:16]:
+        expected = reference(patch)[0]
+        actual = candidate(patch)[0]
+        mse = float(np.mean((np.clip(expected, 0, 1) - np.clip(actual, 0, 1)) ** 2))
+        errors.append(10.0 * np.log10(1.0 / max(mse, 1e-12)))
+    print(f"INT8 vs FP32 PSNR: {np.mean(errors):.2f} dB")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("models", nargs="+", help="FSRCNN or ESPCN .pb models")
+    parser.add_argument("--output", default="models/int8", help="Directory for the IR files")
+    parser.add_argument("--calibration", nargs="*", default=[], help="Videos, images or directories of them")
+    parser.add_argument("--samples", type=int, default=300, help="Calibration patches")
+    parser.add_argument("--patch-size", type=int, default=96, help="Side of a calibration patch")
+    args = parser.parse_args()
+
+    sources = collect_sources(args.calibration)
+    if not sources:
+        print("No calibration frames given, using synthetic patches")
+
+    failed = False
+    for model_path in args.models:
+        stem = os.path.basename(model_path).upper()
+        if not (stem.startswith("FSRCNN") or stem.startswith("ESPCN")):
+            print(f"Skipping {model_path}: only FSRCNN and ESPCN have an INT8 path")
+            continue
+        if not os.path.exists(model_path):
+            print(f"Skipping {model_path}: file not found")
+            continue
+        try:
+            quantize(model_path, args.output, sources, args.samples, args.patch_size)
+        except Exception as e:
+            print(f"Error quantising {model_path}: {e}")
+            failed = True
+
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
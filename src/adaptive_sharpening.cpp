@@ -1,20 +1,76 @@
 #include "adaptive_sharpening.h"
 #include <iostream>
 #include <algorithm>
+#include <cmath>
 
 // Check if OpenCV was built with CUDA support
 #ifdef WITH_CUDA
 #include <opencv2/cudafilters.hpp>
 #include <opencv2/cudaarithm.hpp>
 #include <opencv2/cudaimgproc.hpp>
+#include "gpu_utils.h"
 #endif
 
+#ifdef WITH_FUSED_KERNELS
+#include <opencv2/core/cuda_stream_accessor.hpp>
+#endif
+
+namespace {
+// Sigma range produced by calculateAdaptiveSigma()
+constexpr float kMinAdaptiveSigma = 0.8f;
+constexpr float kMaxAdaptiveSigma = 2.5f;
+constexpr int kNumSigmaLevels = 5;
+
+// Rows per parallel stripe; keeps per-stripe work (and the blur halo of the
+// banded variable-sigma pass) small relative to the band
+constexpr int kRowsPerStripe = 32;
+
+double stripeCount(int rows) {
+    return std::max(1, std::min(rows / kRowsPerStripe, cv::getNumThreads() * 4));
+}
+
+// Fused sharpening kernel for one row:
+//   out = saturate(in + strength(e) * max(in - blurred, 0))
+//   strength(e) = gain * e + offset
+// Plain pointer loops without at<> so the compiler can vectorize them; the
+// blurred row may be 8-bit or a float accumulator.
+template <typename BlurredT>
+void sharpenRow(const uchar* in, const BlurredT* blurred, const float* edge,
+                float gain, float offset, int cols, int cn, uchar* out) {
+    if (cn == 1) {
+        for (int x = 0; x < cols; x++) {
+            float detail = std::max(static_cast<float>(in[x]) - static_cast<float>(blurred[x]), 0.0f);
+            float value = in[x] + (gain * edge[x] + offset) * detail;
+            out[x] = static_cast<uchar>(std::min(std::max(value + 0.5f, 0.0f), 255.0f));
+        }
+        return;
+    }
+    
+    for (int x = 0; x < cols; x++) {
+        float strength = gain * edge[x] + offset;
+        for (int c = 0; c < cn; c++) {
+            int i = x * cn + c;
+            float detail = std::max(static_cast<float>(in[i]) - static_cast<float>(blurred[i]), 0.0f);
+            float value = in[i] + strength * detail;
+            out[i] = static_cast<uchar>(std::min(std::max(value + 0.5f, 0.0f), 255.0f));
+        }
+    }
+}
+}
+
 AdaptiveSharpening::AdaptiveSharpening() 
-    : m_initialized(false) {
+    : m_initialized(false),
+      m_arena(std::make_shared<FrameArena>()),
+      m_features(std::make_shared<FrameFeatures>()),
+      m_shared_features(false) {
 }
 
 AdaptiveSharpening::AdaptiveSharpening(const Config& config)
-    : m_config(config), m_initialized(false) {
+    : m_config(config),
+      m_initialized(false),
+      m_arena(std::make_shared<FrameArena>()),
+      m_features(std::make_shared<FrameFeatures>()),
+      m_shared_features(false) {
 }
 
 AdaptiveSharpening::~AdaptiveSharpening() {
@@ -29,6 +85,11 @@ bool AdaptiveSharpening::initialize() {
             m_config.use_gpu = false;
         } else {
             std::cout << "Using CUDA for adaptive sharpening." << std::endl;
+            
+            if (!createGpuFilters()) {
+                std::cerr << "Failed to create CUDA filters for adaptive sharpening. Using CPU fallback." << std::endl;
+                m_config.use_gpu = false;
+            }
         }
 #else
         std::cout << "CUDA requested for adaptive sharpening but OpenCV was built without CUDA support. Using CPU fallback." << std::endl;
@@ -42,12 +103,30 @@ bool AdaptiveSharpening::initialize() {
 
 void AdaptiveSharpening::setConfig(const Config& config) {
     m_config = config;
+    
+#ifdef WITH_CUDA
+    // Kernel size and sigma are baked into the device filters
+    if (m_initialized && m_config.use_gpu && !createGpuFilters()) {
+        m_config.use_gpu = false;
+    }
+#endif
 }
 
 AdaptiveSharpening::Config AdaptiveSharpening::getConfig() const {
     return m_config;
 }
 
+void AdaptiveSharpening::setArena(std::shared_ptr<FrameArena> arena) {
+    if (arena) {
+        m_arena = std::move(arena);
+    }
+}
+
+void AdaptiveSharpening::setFeatures(std::shared_ptr<FrameFeatures> features) {
+    m_shared_features = features != nullptr;
+    m_features = features ? std::move(features) : std::make_shared<FrameFeatures>();
+}
+
 bool AdaptiveSharpening::process(const cv::Mat& input, cv::Mat& output) {
     if (!m_initialized) {
         std::cerr << "Adaptive sharpening module not initialized" << std::endl;
@@ -59,9 +138,16 @@ bool AdaptiveSharpening::process(const cv::Mat& input, cv::Mat& output) {
         return false;
     }
     
+    // A private cache only lives for one call; a shared one is dropped by its owner
+    if (!m_shared_features) {
+        m_features->invalidate();
+    }
+    
     try {
+        FrameArena& arena = *m_arena;
+        
         // Create edge mask for adaptive sharpening
-        cv::Mat edge_mask;
+        cv::Mat& edge_mask = arena.host("sharpen.edge_mask", input.size(), CV_32F);
         if (!createEdgeMask(input, edge_mask)) {
             std::cerr << "Failed to create edge mask" << std::endl;
             return false;
@@ -70,14 +156,14 @@ bool AdaptiveSharpening::process(const cv::Mat& input, cv::Mat& output) {
         // Apply unsharp mask using the edge mask
         if (m_config.adaptive_sigma) {
             // Calculate texture map
-            cv::Mat texture_map;
+            cv::Mat& texture_map = arena.host("sharpen.texture", input.size(), CV_32F);
             if (!calculateTextureMap(input, texture_map)) {
                 std::cerr << "Failed to calculate texture map" << std::endl;
                 return false;
             }
             
             // Calculate adaptive sigma values
-            cv::Mat sigma_map;
+            cv::Mat& sigma_map = arena.host("sharpen.sigma", input.size(), CV_32F);
             if (!calculateAdaptiveSigma(texture_map, sigma_map)) {
                 std::cerr << "Failed to calculate adaptive sigma values" << std::endl;
                 return false;
@@ -96,6 +182,8 @@ bool AdaptiveSharpening::process(const cv::Mat& input, cv::Mat& output) {
             }
         }
         
+        // The output may reuse the memory of an image analysed earlier
+        m_features->invalidate(output);
         return true;
     } catch (const cv::Exception& e) {
         std::cerr << "Error in adaptive sharpening: " << e.what() << std::endl;
@@ -106,30 +194,38 @@ bool AdaptiveSharpening::process(const cv::Mat& input, cv::Mat& output) {
 
 bool AdaptiveSharpening::createEdgeMask(const cv::Mat& input, cv::Mat& edge_mask) {
     try {
-        // Convert to grayscale if needed
-        cv::Mat gray;
-        if (input.channels() == 1) {
-            input.copyTo(gray);
-        } else {
-            cv::cvtColor(input, gray, cv::COLOR_BGR2GRAY);
-        }
+        FrameArena& arena = *m_arena;
+        const cv::Size size = input.size();
+        
+        // Grayscale, shared with the texture map and any other stage
+        // analysing this image
+        const cv::Mat& gray = m_features->gray(input);
         
         // Detect edges using multiple approaches for better results
         
         // 1. Sobel edge detection
-        cv::Mat grad_x, grad_y;
-        cv::Mat abs_grad_x, abs_grad_y;
-        cv::Mat sobel_grad;
+        cv::Mat& abs_grad_x = arena.host("sharpen.abs_grad_x", size, CV_8UC1);
+        cv::Mat& abs_grad_y = arena.host("sharpen.abs_grad_y", size, CV_8UC1);
+        cv::Mat& sobel_grad = arena.host("sharpen.sobel", size, CV_8UC1);
         
         // Use GPU if available and requested
         if (m_config.use_gpu) {
 #ifdef WITH_CUDA
-            cv::cuda::GpuMat d_gray, d_grad_x, d_grad_y, d_abs_grad_x, d_abs_grad_y, d_sobel_grad;
+            cv::cuda::GpuMat& d_gray = arena.device("sharpen.gray", size, CV_8UC1);
+            cv::cuda::GpuMat& d_grad_x = arena.device("sharpen.grad_x", size, CV_16S);
+            cv::cuda::GpuMat& d_grad_y = arena.device("sharpen.grad_y", size, CV_16S);
+            cv::cuda::GpuMat& d_abs_grad_x = arena.device("sharpen.abs_grad_x", size, CV_16S);
+            cv::cuda::GpuMat& d_abs_grad_y = arena.device("sharpen.abs_grad_y", size, CV_16S);
+            cv::cuda::GpuMat& d_sobel_grad = arena.device("sharpen.sobel", size, CV_16S);
             d_gray.upload(gray);
             
             // Sobel gradients
-            cv::Ptr<cv::cuda::Filter> sobel_x = cv::cuda::createSobelFilter(CV_8UC1, CV_16S, 1, 0, 3);
-            cv::Ptr<cv::cuda::Filter> sobel_y = cv::cuda::createSobelFilter(CV_8UC1, CV_16S, 0, 1, 3);
+            const cv::Ptr<cv::cuda::Filter>& sobel_x = arena.filter("sharpen.sobel_x", CV_8UC1, {1, 0, 3}, []() {
+                return cv::cuda::createSobelFilter(CV_8UC1, CV_16S, 1, 0, 3);
+            });
+            const cv::Ptr<cv::cuda::Filter>& sobel_y = arena.filter("sharpen.sobel_y", CV_8UC1, {0, 1, 3}, []() {
+                return cv::cuda::createSobelFilter(CV_8UC1, CV_16S, 0, 1, 3);
+            });
             
             sobel_x->apply(d_gray, d_grad_x);
             sobel_y->apply(d_gray, d_grad_y);
@@ -140,86 +236,78 @@ bool AdaptiveSharpening::createEdgeMask(const cv::Mat& input, cv::Mat& edge_mask
             
             // Combine gradients
             cv::cuda::addWeighted(d_abs_grad_x, 0.5, d_abs_grad_y, 0.5, 0, d_sobel_grad);
-            d_sobel_grad.download(sobel_grad);
+            cv::Mat& sobel_16s = arena.host("sharpen.sobel_16s", size, CV_16S);
+            d_sobel_grad.download(sobel_16s);
             
             // Convert to 8-bit
-            sobel_grad.convertTo(sobel_grad, CV_8UC1);
+            sobel_16s.convertTo(sobel_grad, CV_8UC1);
 #else
             // CPU fallback
-            cv::Sobel(gray, grad_x, CV_16S, 1, 0, 3);
-            cv::Sobel(gray, grad_y, CV_16S, 0, 1, 3);
-            
-            cv::convertScaleAbs(grad_x, abs_grad_x);
-            cv::convertScaleAbs(grad_y, abs_grad_y);
+            cv::convertScaleAbs(m_features->gradientX(input), abs_grad_x);
+            cv::convertScaleAbs(m_features->gradientY(input), abs_grad_y);
             
             cv::addWeighted(abs_grad_x, 0.5, abs_grad_y, 0.5, 0, sobel_grad);
 #endif
         } else {
             // CPU implementation
-            cv::Sobel(gray, grad_x, CV_16S, 1, 0, 3);
-            cv::Sobel(gray, grad_y, CV_16S, 0, 1, 3);
-            
-            cv::convertScaleAbs(grad_x, abs_grad_x);
-            cv::convertScaleAbs(grad_y, abs_grad_y);
+            cv::convertScaleAbs(m_features->gradientX(input), abs_grad_x);
+            cv::convertScaleAbs(m_features->gradientY(input), abs_grad_y);
             
             cv::addWeighted(abs_grad_x, 0.5, abs_grad_y, 0.5, 0, sobel_grad);
         }
         
         // 2. Laplacian edge detection
-        cv::Mat laplacian;
+        cv::Mat& laplacian_16s = arena.host("sharpen.laplacian_16s", size, CV_16S);
+        cv::Mat& laplacian = arena.host("sharpen.laplacian", size, CV_8UC1);
         if (m_config.use_gpu) {
 #ifdef WITH_CUDA
-            cv::cuda::GpuMat d_gray, d_laplacian;
-            d_gray.upload(gray);
+            // The grayscale frame is still on the device from the Sobel pass
+            cv::cuda::GpuMat& d_gray = arena.device("sharpen.gray", size, CV_8UC1);
+            cv::cuda::GpuMat& d_laplacian = arena.device("sharpen.laplacian", size, CV_16S);
             
             // Laplacian filter
-            cv::Ptr<cv::cuda::Filter> laplacian_filter = cv::cuda::createLaplacianFilter(CV_8UC1, CV_16S, 3);
+            const cv::Ptr<cv::cuda::Filter>& laplacian_filter = arena.filter("sharpen.laplacian", CV_8UC1, {3}, []() {
+                return cv::cuda::createLaplacianFilter(CV_8UC1, CV_16S, 3);
+            });
             laplacian_filter->apply(d_gray, d_laplacian);
             
             // Convert to absolute values
             cv::cuda::abs(d_laplacian, d_laplacian);
-            d_laplacian.download(laplacian);
+            d_laplacian.download(laplacian_16s);
             
             // Convert to 8-bit
-            laplacian.convertTo(laplacian, CV_8UC1);
+            laplacian_16s.convertTo(laplacian, CV_8UC1);
 #else
             // CPU fallback
-            cv::Laplacian(gray, laplacian, CV_16S, 3);
-            cv::convertScaleAbs(laplacian, laplacian);
+            cv::Laplacian(gray, laplacian_16s, CV_16S, 3);
+            cv::convertScaleAbs(laplacian_16s, laplacian);
 #endif
         } else {
             // CPU implementation
-            cv::Laplacian(gray, laplacian, CV_16S, 3);
-            cv::convertScaleAbs(laplacian, laplacian);
+            cv::Laplacian(gray, laplacian_16s, CV_16S, 3);
+            cv::convertScaleAbs(laplacian_16s, laplacian);
         }
         
         // 3. Combine edge detectors for better results
-        cv::Mat combined_edges;
+        cv::Mat& combined_edges = arena.host("sharpen.edges", size, CV_8UC1);
         cv::addWeighted(sobel_grad, 0.6, laplacian, 0.4, 0, combined_edges);
         
-        // 4. Create edge mask with smooth transition using threshold
-        cv::Mat edge_mask_8u;
+        // 4. Create edge mask with smooth transition using threshold.
+        // The combined edges are 8-bit, so the sigmoid is evaluated once
+        // per possible value and applied as a lookup table.
         double threshold = m_config.edge_threshold;
-        
-        // Threshold with smooth falloff for natural transitions
-        cv::Mat edge_mask_float;
-        combined_edges.convertTo(edge_mask_float, CV_32F, 1.0/255.0);
-        
-        // Create sigmoid-like mask with threshold as midpoint
-        edge_mask = cv::Mat(edge_mask_float.size(), CV_32F);
         float scale_factor = 0.1f; // Controls transition steepness
         
-        for (int y = 0; y < edge_mask.rows; y++) {
-            for (int x = 0; x < edge_mask.cols; x++) {
-                float edge_value = edge_mask_float.at<float>(y, x) * 255.0f;
-                // Sigmoid-like function centered at threshold
-                float sigmoid = 1.0f / (1.0f + std::exp(-(edge_value - threshold) * scale_factor));
-                edge_mask.at<float>(y, x) = sigmoid;
-            }
+        cv::Mat& sigmoid_lut = arena.host("sharpen.sigmoid_lut", cv::Size(256, 1), CV_32F);
+        for (int v = 0; v < 256; v++) {
+            // Sigmoid-like function centered at threshold
+            sigmoid_lut.at<float>(v) = 1.0f / (1.0f + std::exp(-(v - static_cast<float>(threshold)) * scale_factor));
         }
+        cv::Mat& sigmoid = arena.host("sharpen.sigmoid", size, CV_32F);
+        cv::LUT(combined_edges, sigmoid_lut, sigmoid);
         
         // Apply slight blur to the mask for smoother transitions
-        cv::GaussianBlur(edge_mask, edge_mask, cv::Size(5, 5), 1.5);
+        cv::GaussianBlur(sigmoid, edge_mask, cv::Size(5, 5), 1.5);
         
         return true;
     } catch (const cv::Exception& e) {
@@ -231,19 +319,24 @@ bool AdaptiveSharpening::createEdgeMask(const cv::Mat& input, cv::Mat& edge_mask
 
 bool AdaptiveSharpening::applyUnsharpMask(const cv::Mat& input, const cv::Mat& edge_mask, cv::Mat& output) {
     try {
+        FrameArena& arena = *m_arena;
+        
         // Create a blurred version of the input
-        cv::Mat blurred;
+        cv::Mat& blurred = arena.host("sharpen.blurred", input.size(), input.type());
         
         if (m_config.use_gpu) {
 #ifdef WITH_CUDA
-            cv::cuda::GpuMat d_input, d_blurred;
+            cv::cuda::GpuMat& d_input = arena.device("sharpen.input", input.size(), input.type());
+            cv::cuda::GpuMat& d_blurred = arena.device("sharpen.blurred", input.size(), input.type());
             d_input.upload(input);
             
-            // Apply Gaussian blur
-            cv::Ptr<cv::cuda::Filter> blur_filter = cv::cuda::createGaussianFilter(
-                input.type(), input.type(), 
-                cv::Size(m_config.kernel_size, m_config.kernel_size), 
-                m_config.sigma);
+            // Apply Gaussian blur; the filter is rebuilt only when the kernel changes
+            const int type = input.type();
+            const cv::Size kernel(m_config.kernel_size, m_config.kernel_size);
+            const double sigma = m_config.sigma;
+            const cv::Ptr<cv::cuda::Filter>& blur_filter = arena.filter(
+                "sharpen.unsharp_blur", type, {static_cast<double>(kernel.width), sigma},
+                [type, kernel, sigma]() { return cv::cuda::createGaussianFilter(type, type, kernel, sigma); });
                 
             blur_filter->apply(d_input, d_blurred);
             d_blurred.download(blurred);
@@ -260,90 +353,26 @@ bool AdaptiveSharpening::applyUnsharpMask(const cv::Mat& input, const cv::Mat& e
                 m_config.sigma);
         }
         
-        // Create the unsharp mask by subtracting blurred from original
-        cv::Mat unsharp_mask;
-        cv::subtract(input, blurred, unsharp_mask);
-        
-        // Apply variable strength based on edge mask
-        cv::Mat weighted_mask;
-        
-        // Create an output image of the same type as input
-        output = cv::Mat(input.size(), input.type());
-        
-        // Process based on number of channels
-        if (input.channels() == 1) {
-            // For grayscale images
-            for (int y = 0; y < output.rows; y++) {
-                for (int x = 0; x < output.cols; x++) {
-                    // Calculate adaptive strength based on edge mask
-                    float edge_value = edge_mask.at<float>(y, x);
-                    float strength = m_config.strength * (
-                        edge_value * m_config.edge_strength + 
-                        (1.0f - edge_value) * m_config.smooth_strength
-                    );
-                    
-                    // Apply unsharp mask with adaptive strength
-                    float original = input.at<uchar>(y, x);
-                    float mask_value = unsharp_mask.at<uchar>(y, x);
-                    
-                    // Apply sharpening
-                    float sharpened = original + strength * mask_value;
-                    
-                    // Clamp to valid range
-                    output.at<uchar>(y, x) = cv::saturate_cast<uchar>(sharpened);
-                }
-            }
-        } else {
-            // For color images (assumed BGR)
-            for (int y = 0; y < output.rows; y++) {
-                for (int x = 0; x < output.cols; x++) {
-                    // Calculate adaptive strength based on edge mask
-                    float edge_value = edge_mask.at<float>(y, x);
-                    float strength = m_config.strength * (
-                        edge_value * m_config.edge_strength + 
-                        (1.0f - edge_value) * m_config.smooth_strength
-                    );
-                    
-                    // Apply unsharp mask with adaptive strength to each channel
-                    cv::Vec3b original = input.at<cv::Vec3b>(y, x);
-                    cv::Vec3b mask_value = unsharp_mask.at<cv::Vec3b>(y, x);
-                    
-                    // Apply sharpening to each channel
-                    cv::Vec3b sharpened;
-                    for (int c = 0; c < 3; c++) {
-                        sharpened[c] = cv::saturate_cast<uchar>(
-                            original[c] + strength * mask_value[c]
-                        );
-                    }
-                    
-                    // Set output pixel
-                    output.at<cv::Vec3b>(y, x) = sharpened;
-                }
-            }
-        }
+        // Unsharp mask (input - blurred, clipped at 0) weighted by the edge
+        // mask, fused into one row-parallel pass
+        output.create(input.size(), input.type());
+        applyAdaptiveStrength(input, blurred, edge_mask, output);
         
         // Apply tone preservation if enabled
         if (m_config.preserve_tone) {
             // Convert to YCrCb color space
-            cv::Mat ycrcb_input, ycrcb_output;
+            cv::Mat& ycrcb_input = arena.host("sharpen.ycrcb_input", input.size(), input.type());
+            cv::Mat& ycrcb_output = arena.host("sharpen.ycrcb_output", input.size(), input.type());
             cv::cvtColor(input, ycrcb_input, cv::COLOR_BGR2YCrCb);
             cv::cvtColor(output, ycrcb_output, cv::COLOR_BGR2YCrCb);
             
-            // Split into channels
-            std::vector<cv::Mat> channels_input, channels_output;
-            cv::split(ycrcb_input, channels_input);
-            cv::split(ycrcb_output, channels_output);
-            
-            // Only apply sharpening to Y channel, preserve Cr and Cb
-            channels_output[0] = channels_output[0];  // Y (already sharpened)
-            channels_output[1] = channels_input[1];   // Cr (preserved)
-            channels_output[2] = channels_input[2];   // Cb (preserved)
-            
-            // Merge channels
-            cv::merge(channels_output, ycrcb_output);
+            // Only apply sharpening to Y channel, preserve Cr and Cb: copy
+            // the sharpened Y into the input's YCrCb planes
+            const int from_to[] = {0, 0};
+            cv::mixChannels(&ycrcb_output, 1, &ycrcb_input, 1, from_to, 1);
             
             // Convert back to BGR
-            cv::cvtColor(ycrcb_output, output, cv::COLOR_YCrCb2BGR);
+            cv::cvtColor(ycrcb_input, output, cv::COLOR_YCrCb2BGR);
         }
         
         return true;
@@ -356,39 +385,19 @@ bool AdaptiveSharpening::applyUnsharpMask(const cv::Mat& input, const cv::Mat& e
 
 bool AdaptiveSharpening::calculateTextureMap(const cv::Mat& input, cv::Mat& texture_map) {
     try {
-        // Convert to grayscale if needed
-        cv::Mat gray;
-        if (input.channels() == 1) {
-            input.copyTo(gray);
-        } else {
-            cv::cvtColor(input, gray, cv::COLOR_BGR2GRAY);
-        }
-        
-        // Use local standard deviation as a measure of texture
-        cv::Mat mean, stddev;
-        cv::Mat kernel = cv::Mat::ones(7, 7, CV_32F) / 49.0f;
-        
-        // Mean filter
-        cv::Mat local_mean;
-        cv::filter2D(gray, local_mean, -1, kernel);
-        
-        // Calculate squared differences
-        cv::Mat diff;
-        cv::subtract(gray, local_mean, diff);
-        cv::Mat diff_sq;
-        cv::multiply(diff, diff, diff_sq);
-        
-        // Mean of squared differences
-        cv::Mat local_var;
-        cv::filter2D(diff_sq, local_var, -1, kernel);
-        
-        // Standard deviation (sqrt of variance)
-        cv::sqrt(local_var, texture_map);
+        // Use local standard deviation over a 7x7 window as a measure of
+        // texture; the variance comes from the shared per-frame features
+        cv::sqrt(m_features->localVariance(input, 7), texture_map);
         
         // Normalize to 0-1 range
         double min_val, max_val;
         cv::minMaxLoc(texture_map, &min_val, &max_val);
-        texture_map = (texture_map - min_val) / (max_val - min_val);
+        if (max_val - min_val > 1e-6) {
+            const double range = max_val - min_val;
+            texture_map.convertTo(texture_map, CV_32F, 1.0 / range, -min_val / range);
+        } else {
+            texture_map.setTo(cv::Scalar(0.5));
+        }
         
         return true;
     } catch (const cv::Exception& e) {
@@ -400,30 +409,17 @@ bool AdaptiveSharpening::calculateTextureMap(const cv::Mat& input, cv::Mat& text
 
 bool AdaptiveSharpening::calculateAdaptiveSigma(const cv::Mat& texture_map, cv::Mat& sigma_map) {
     try {
-        // Create sigma map of same size as texture map
-        sigma_map = cv::Mat(texture_map.size(), CV_32F);
-        
         // Define sigma range
-        float min_sigma = 0.8f;
-        float max_sigma = 2.5f;
-        
-        // Map texture values to sigma values
-        // High texture areas get smaller sigma (more precise sharpening)
-        // Low texture areas get larger sigma (more spread-out sharpening)
-        for (int y = 0; y < sigma_map.rows; y++) {
-            for (int x = 0; x < sigma_map.cols; x++) {
-                float texture_value = texture_map.at<float>(y, x);
-                
-                // Inverse mapping: high texture -> low sigma, low texture -> high sigma
-                float sigma = max_sigma - texture_value * (max_sigma - min_sigma);
-                
-                // Store in sigma map
-                sigma_map.at<float>(y, x) = sigma;
-            }
-        }
+        float min_sigma = kMinAdaptiveSigma;
+        float max_sigma = kMaxAdaptiveSigma;
+        
+        // Inverse mapping: high texture -> low sigma (more precise sharpening),
+        // low texture -> high sigma (more spread-out sharpening)
+        cv::Mat& raw_sigma = m_arena->host("sharpen.raw_sigma", texture_map.size(), CV_32F);
+        texture_map.convertTo(raw_sigma, CV_32F, -(max_sigma - min_sigma), max_sigma);
         
         // Apply slight blur to sigma map for smoother transitions
-        cv::GaussianBlur(sigma_map, sigma_map, cv::Size(5, 5), 1.0);
+        cv::GaussianBlur(raw_sigma, sigma_map, cv::Size(5, 5), 1.0);
         
         return true;
     } catch (const cv::Exception& e) {
@@ -438,149 +434,95 @@ bool AdaptiveSharpening::applyVariableSigmaUnsharpMask(const cv::Mat& input,
                                                      const cv::Mat& edge_mask, 
                                                      cv::Mat& output) {
     try {
-        // Create a blurred version of the input with variable sigma
-        cv::Mat blurred = cv::Mat::zeros(input.size(), input.type());
-        
-        // Apply blur in a more efficient way using integral images
-        // First create a set of blurred images with different sigmas
-        const int num_sigma_levels = 5;
-        std::vector<cv::Mat> blurred_levels(num_sigma_levels);
+        FrameArena& arena = *m_arena;
+        const int num_sigma_levels = kNumSigmaLevels;
+        const int cn = input.channels();
+        const cv::Size kernel(m_config.kernel_size, m_config.kernel_size);
         
         double min_sigma_d, max_sigma_d;
         cv::minMaxLoc(sigma_map, &min_sigma_d, &max_sigma_d);
         float min_sigma = static_cast<float>(min_sigma_d);
         float max_sigma = static_cast<float>(max_sigma_d);
-
         
-        // Create blurred versions with different sigma values
-        for (int i = 0; i < num_sigma_levels; i++) {
-            float sigma = min_sigma + (max_sigma - min_sigma) * i / (num_sigma_levels - 1);
-            cv::GaussianBlur(input, blurred_levels[i], 
-                cv::Size(m_config.kernel_size, m_config.kernel_size), 
-                sigma);
+        // Continuous level index per pixel; blur levels are evenly spaced
+        // between the smallest and largest sigma in the map
+        const int levels = (max_sigma - min_sigma > 1e-6f) ? num_sigma_levels : 1;
+        cv::Mat& level_index = arena.host("sharpen.level_index", sigma_map.size(), CV_32F);
+        if (levels > 1) {
+            double scale = (levels - 1) / static_cast<double>(max_sigma - min_sigma);
+            sigma_map.convertTo(level_index, CV_32F, scale, -min_sigma * scale);
+        } else {
+            level_index.setTo(cv::Scalar(0));
         }
         
-        // Interpolate between blurred images based on sigma map
-        for (int y = 0; y < input.rows; y++) {
-            for (int x = 0; x < input.cols; x++) {
-                float sigma = sigma_map.at<float>(y, x);
-                
-                // Find the two closest sigma levels
-                int idx_low = static_cast<int>((sigma - min_sigma) / (max_sigma - min_sigma) * (num_sigma_levels - 1));
-                idx_low = std::max(0, std::min(idx_low, num_sigma_levels - 2));
-                int idx_high = idx_low + 1;
-                
-                // Get sigmas for the two levels
-                float sigma_low = min_sigma + (max_sigma - min_sigma) * idx_low / (num_sigma_levels - 1);
-                float sigma_high = min_sigma + (max_sigma - min_sigma) * idx_high / (num_sigma_levels - 1);
-                
-                // Calculate interpolation factor
-                float alpha = (sigma - sigma_low) / (sigma_high - sigma_low);
+        const float gain = m_config.strength * (m_config.edge_strength - m_config.smooth_strength);
+        const float offset = m_config.strength * m_config.smooth_strength;
+        output.create(input.size(), input.type());
+        
+        // Work in row bands: each band blurs only the sigma levels it actually
+        // uses (blurring an ROI reads the real neighbouring rows, so bands
+        // match a full-frame blur), blends them with tent weights and
+        // sharpens while the band is still in cache. Bands write disjoint
+        // rows of the frame-sized scratch, so the arena is only touched here.
+        cv::Mat& accum_frame = arena.host("sharpen.accum", input.size(), CV_32FC(cn));
+        cv::Mat& level_blur_frame = arena.host("sharpen.level_blur", input.size(), input.type());
+        cv::parallel_for_(cv::Range(0, input.rows), [&](const cv::Range& range) {
+            cv::Rect band(0, range.start, input.cols, range.end - range.start);
+            cv::Mat band_index = level_index(band);
+            
+            double index_min, index_max;
+            cv::minMaxLoc(band_index, &index_min, &index_max);
+            int first = std::max(0, std::min(static_cast<int>(std::floor(index_min)), levels - 1));
+            int last = std::max(first, std::min(static_cast<int>(std::ceil(index_max)), levels - 1));
+            
+            cv::Mat accum = accum_frame(band);
+            cv::Mat level_blur = level_blur_frame(band);
+            accum.setTo(cv::Scalar::all(0));
+            
+            for (int level = first; level <= last; level++) {
+                float sigma = (levels > 1) ?
+                    min_sigma + (max_sigma - min_sigma) * level / (levels - 1) : min_sigma;
+                cv::GaussianBlur(input(band), level_blur, kernel, sigma);
                 
-                // Interpolate blurred pixels
-                if (input.channels() == 1) {
-                    uchar pixel_low = blurred_levels[idx_low].at<uchar>(y, x);
-                    uchar pixel_high = blurred_levels[idx_high].at<uchar>(y, x);
-                    blurred.at<uchar>(y, x) = static_cast<uchar>(
-                        pixel_low * (1.0f - alpha) + pixel_high * alpha
-                    );
-                } else {
-                    cv::Vec3b pixel_low = blurred_levels[idx_low].at<cv::Vec3b>(y, x);
-                    cv::Vec3b pixel_high = blurred_levels[idx_high].at<cv::Vec3b>(y, x);
-                    
-                    cv::Vec3b result;
-                    for (int c = 0; c < 3; c++) {
-                        result[c] = static_cast<uchar>(
-                            pixel_low[c] * (1.0f - alpha) + pixel_high[c] * alpha
-                        );
+                for (int y = 0; y < band.height; y++) {
+                    const float* u = band_index.ptr<float>(y);
+                    const uchar* src = level_blur.ptr<uchar>(y);
+                    float* acc = accum.ptr<float>(y);
+                    for (int x = 0; x < band.width; x++) {
+                        float w = std::max(0.0f, 1.0f - std::abs(u[x] - level));
+                        for (int c = 0; c < cn; c++) {
+                            acc[x * cn + c] += w * src[x * cn + c];
+                        }
                     }
-                    
-                    blurred.at<cv::Vec3b>(y, x) = result;
-                }
-            }
-        }
-        
-        // Create the unsharp mask by subtracting blurred from original
-        cv::Mat unsharp_mask;
-        cv::subtract(input, blurred, unsharp_mask);
-        
-        // Create output image
-        output = cv::Mat(input.size(), input.type());
-        
-        // Apply variable strength based on edge mask
-        if (input.channels() == 1) {
-            // For grayscale images
-            for (int y = 0; y < output.rows; y++) {
-                for (int x = 0; x < output.cols; x++) {
-                    // Calculate adaptive strength based on edge mask
-                    float edge_value = edge_mask.at<float>(y, x);
-                    float strength = m_config.strength * (
-                        edge_value * m_config.edge_strength + 
-                        (1.0f - edge_value) * m_config.smooth_strength
-                    );
-                    
-                    // Apply unsharp mask with adaptive strength
-                    float original = input.at<uchar>(y, x);
-                    float mask_value = unsharp_mask.at<uchar>(y, x);
-                    
-                    // Apply sharpening
-                    float sharpened = original + strength * mask_value;
-                    
-                    // Clamp to valid range
-                    output.at<uchar>(y, x) = cv::saturate_cast<uchar>(sharpened);
                 }
             }
-        } else {
-            // For color images (assumed BGR)
-            for (int y = 0; y < output.rows; y++) {
-                for (int x = 0; x < output.cols; x++) {
-                    // Calculate adaptive strength based on edge mask
-                    float edge_value = edge_mask.at<float>(y, x);
-                    float strength = m_config.strength * (
-                        edge_value * m_config.edge_strength + 
-                        (1.0f - edge_value) * m_config.smooth_strength
-                    );
-                    
-                    // Apply unsharp mask with adaptive strength to each channel
-                    cv::Vec3b original = input.at<cv::Vec3b>(y, x);
-                    cv::Vec3b mask_value = unsharp_mask.at<cv::Vec3b>(y, x);
-                    
-                    // Apply sharpening to each channel
-                    cv::Vec3b sharpened;
-                    for (int c = 0; c < 3; c++) {
-                        sharpened[c] = cv::saturate_cast<uchar>(
-                            original[c] + strength * mask_value[c]
-                        );
-                    }
-                    
-                    // Set output pixel
-                    output.at<cv::Vec3b>(y, x) = sharpened;
+            
+            for (int y = 0; y < band.height; y++) {
+                float* acc = accum.ptr<float>(y);
+                // Blurred value is truncated to 8 bits like the blended image it replaces
+                for (int i = 0; i < band.width * cn; i++) {
+                    acc[i] = std::floor(acc[i]);
                 }
+                sharpenRow(input.ptr<uchar>(band.y + y), acc, edge_mask.ptr<float>(band.y + y),
+                           gain, offset, band.width, cn, output.ptr<uchar>(band.y + y));
             }
-        }
+        }, stripeCount(input.rows));
         
         // Apply tone preservation if enabled
         if (m_config.preserve_tone && input.channels() == 3) {
             // Convert to YCrCb color space
-            cv::Mat ycrcb_input, ycrcb_output;
+            cv::Mat& ycrcb_input = arena.host("sharpen.ycrcb_input", input.size(), input.type());
+            cv::Mat& ycrcb_output = arena.host("sharpen.ycrcb_output", input.size(), input.type());
             cv::cvtColor(input, ycrcb_input, cv::COLOR_BGR2YCrCb);
             cv::cvtColor(output, ycrcb_output, cv::COLOR_BGR2YCrCb);
             
-            // Split into channels
-            std::vector<cv::Mat> channels_input, channels_output;
-            cv::split(ycrcb_input, channels_input);
-            cv::split(ycrcb_output, channels_output);
-            
-            // Only apply sharpening to Y channel, preserve Cr and Cb
-            channels_output[0] = channels_output[0];  // Y (already sharpened)
-            channels_output[1] = channels_input[1];   // Cr (preserved)
-            channels_output[2] = channels_input[2];   // Cb (preserved)
-            
-            // Merge channels
-            cv::merge(channels_output, ycrcb_output);
+            // Only apply sharpening to Y channel, preserve Cr and Cb: copy
+            // the sharpened Y into the input's YCrCb planes
+            const int from_to[] = {0, 0};
+            cv::mixChannels(&ycrcb_output, 1, &ycrcb_input, 1, from_to, 1);
             
             // Convert back to BGR
-            cv::cvtColor(ycrcb_output, output, cv::COLOR_YCrCb2BGR);
+            cv::cvtColor(ycrcb_input, output, cv::COLOR_YCrCb2BGR);
         }
         
         return true;
@@ -589,4 +531,341 @@ bool AdaptiveSharpening::applyVariableSigmaUnsharpMask(const cv::Mat& input,
         input.copyTo(output);
         return false;
     }
-}
\ No newline at end of file
+}
+
+void AdaptiveSharpening::applyAdaptiveStrength(const cv::Mat& input, const cv::Mat& blurred,
+                                               const cv::Mat& edge_mask, cv::Mat& output) const {
+    const float gain = m_config.strength * (m_config.edge_strength - m_config.smooth_strength);
+    const float offset = m_config.strength * m_config.smooth_strength;
+    const int cn = input.channels();
+    
+    cv::parallel_for_(cv::Range(0, input.rows), [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end; y++) {
+            sharpenRow(input.ptr<uchar>(y), blurred.ptr<uchar>(y), edge_mask.ptr<float>(y),
+                       gain, offset, input.cols, cn, output.ptr<uchar>(y));
+        }
+    }, stripeCount(input.rows));
+}
+
+#ifdef WITH_CUDA
+bool AdaptiveSharpening::createGpuFilters() {
+    try {
+        cv::Size kernel(m_config.kernel_size, m_config.kernel_size);
+        
+        m_d_sobel_x = cv::cuda::createSobelFilter(CV_8UC1, CV_32FC1, 1, 0, 3);
+        m_d_sobel_y = cv::cuda::createSobelFilter(CV_8UC1, CV_32FC1, 0, 1, 3);
+        m_d_laplacian = cv::cuda::createLaplacianFilter(CV_32FC1, CV_32FC1, 3);
+        m_d_mask_blur = cv::cuda::createGaussianFilter(CV_32FC1, CV_32FC1, cv::Size(5, 5), 1.5);
+        m_d_unsharp_blur = cv::cuda::createGaussianFilter(CV_8UC1, CV_8UC1, kernel, m_config.sigma);
+        m_d_texture_box = cv::cuda::createBoxFilter(CV_32FC1, CV_32FC1, cv::Size(7, 7));
+        m_d_sigma_blur = cv::cuda::createGaussianFilter(CV_32FC1, CV_32FC1, cv::Size(5, 5), 1.0);
+        
+        // The sigma map is bounded, so the blur levels can be built once
+        m_d_sigma_levels.clear();
+        for (int i = 0; i < kNumSigmaLevels; i++) {
+            double sigma = kMinAdaptiveSigma + (kMaxAdaptiveSigma - kMinAdaptiveSigma) * i / (kNumSigmaLevels - 1);
+            m_d_sigma_levels.push_back(cv::cuda::createGaussianFilter(CV_8UC1, CV_8UC1, kernel, sigma));
+        }
+        
+#ifdef WITH_FUSED_KERNELS
+        // Same levels as 1D taps for the blend kernel
+        m_d_blend_params = sharpen_kernels::Params();
+        const int radius = m_config.kernel_size / 2;
+        if (kNumSigmaLevels <= sharpen_kernels::kMaxLevels && radius <= sharpen_kernels::kMaxRadius) {
+            for (int i = 0; i < kNumSigmaLevels; i++) {
+                double sigma = kMinAdaptiveSigma + (kMaxAdaptiveSigma - kMinAdaptiveSigma) * i / (kNumSigmaLevels - 1);
+                cv::Mat taps = cv::getGaussianKernel(2 * radius + 1, sigma, CV_32F);
+                for (int k = 0; k <= 2 * radius; k++) {
+                    m_d_blend_params.weights[i][k] = taps.at<float>(k);
+                }
+            }
+            m_d_blend_params.radius = radius;
+            m_d_blend_params.levels = kNumSigmaLevels;
+            m_d_blend_params.min_sigma = kMinAdaptiveSigma;
+            m_d_blend_params.level_scale = (kNumSigmaLevels - 1) / (kMaxAdaptiveSigma - kMinAdaptiveSigma);
+        }
+#endif
+        
+        return true;
+    } catch (const cv::Exception& e) {
+        std::cerr << "Error creating CUDA sharpening filters: " << e.what() << std::endl;
+        m_d_sigma_levels.clear();
+        m_d_sobel_x.reset();
+        return false;
+    }
+}
+
+bool AdaptiveSharpening::process(const cv::cuda::GpuMat& input, cv::cuda::GpuMat& output,
+                                 cv::cuda::Stream& stream) {
+    if (!m_initialized) {
+        std::cerr << "Adaptive sharpening module not initialized" << std::endl;
+        return false;
+    }
+    
+    if (input.empty()) {
+        std::cerr << "Empty input image" << std::endl;
+        return false;
+    }
+    
+    FrameArena& arena = *m_arena;
+    
+    // Without the device filters, run the host path once instead of per stage
+    if (!m_config.use_gpu || !m_d_sobel_x) {
+        cv::Mat& h_input = arena.host("sharpen.download", input.size(), input.type());
+        cv::Mat& h_output = arena.host("sharpen.result", input.size(), input.type());
+        input.download(h_input, stream);
+        stream.waitForCompletion();
+        bool result = process(h_input, h_output);
+        output.upload(h_output, stream);
+        return result;
+    }
+    
+    try {
+        cv::cuda::GpuMat& edge_mask = arena.device("sharpen.d_edge_mask", input.size(), CV_32FC1);
+        if (!createEdgeMask(input, edge_mask, stream)) {
+            std::cerr << "Failed to create edge mask" << std::endl;
+            return false;
+        }
+        
+        if (m_config.adaptive_sigma) {
+            cv::cuda::GpuMat& texture_map = arena.device("sharpen.d_texture", input.size(), CV_32FC1);
+            if (!calculateTextureMap(input, texture_map, stream)) {
+                std::cerr << "Failed to calculate texture map" << std::endl;
+                return false;
+            }
+            
+            if (!applyVariableSigmaUnsharpMask(input, texture_map, edge_mask, output, stream)) {
+                std::cerr << "Failed to apply variable sigma unsharp mask" << std::endl;
+                return false;
+            }
+        } else if (!applyUnsharpMask(input, edge_mask, output, stream)) {
+            std::cerr << "Failed to apply unsharp mask" << std::endl;
+            return false;
+        }
+        
+        return true;
+    } catch (const cv::Exception& e) {
+        std::cerr << "Error in adaptive sharpening (GPU): " << e.what() << std::endl;
+        input.copyTo(output, stream);
+        return false;
+    }
+}
+
+bool AdaptiveSharpening::createEdgeMask(const cv::cuda::GpuMat& input, cv::cuda::GpuMat& edge_mask,
+                                        cv::cuda::Stream& stream) {
+    try {
+        FrameArena& arena = *m_arena;
+        const cv::Size size = input.size();
+        
+        cv::cuda::GpuMat gray = input;
+        if (input.channels() != 1) {
+            gray = arena.device("sharpen.d_gray", size, CV_8UC1);
+            cv::cuda::cvtColor(input, gray, cv::COLOR_BGR2GRAY, 0, stream);
+        }
+        
+        // 1. Sobel: mean of absolute gradients, saturated to the 8-bit range
+        cv::cuda::GpuMat& grad_x = arena.device("sharpen.d_grad_x", size, CV_32FC1);
+        cv::cuda::GpuMat& grad_y = arena.device("sharpen.d_grad_y", size, CV_32FC1);
+        cv::cuda::GpuMat& sobel_grad = arena.device("sharpen.d_sobel", size, CV_32FC1);
+        m_d_sobel_x->apply(gray, grad_x, stream);
+        m_d_sobel_y->apply(gray, grad_y, stream);
+        cv::cuda::abs(grad_x, grad_x, stream);
+        cv::cuda::abs(grad_y, grad_y, stream);
+        cv::cuda::addWeighted(grad_x, 0.5, grad_y, 0.5, 0, sobel_grad, -1, stream);
+        cv::cuda::threshold(sobel_grad, sobel_grad, 255.0, 255.0, cv::THRESH_TRUNC, stream);
+        
+        // 2. Laplacian, same treatment
+        cv::cuda::GpuMat& gray_float = arena.device("sharpen.d_gray_float", size, CV_32FC1);
+        cv::cuda::GpuMat& laplacian = arena.device("sharpen.d_laplacian", size, CV_32FC1);
+        gray.convertTo(gray_float, CV_32F, stream);
+        m_d_laplacian->apply(gray_float, laplacian, stream);
+        cv::cuda::abs(laplacian, laplacian, stream);
+        cv::cuda::threshold(laplacian, laplacian, 255.0, 255.0, cv::THRESH_TRUNC, stream);
+        
+        // 3. Combine edge detectors
+        cv::cuda::GpuMat& combined_edges = arena.device("sharpen.d_edges", size, CV_32FC1);
+        cv::cuda::addWeighted(sobel_grad, 0.6, laplacian, 0.4, 0, combined_edges, -1, stream);
+        
+        // 4. Sigmoid around the threshold, then soften the transitions
+        cv::cuda::GpuMat& mask = arena.device("sharpen.d_sigmoid", size, CV_32FC1);
+        gpu_utils::sigmoid(combined_edges, m_config.edge_threshold, 0.1, mask, stream);
+        m_d_mask_blur->apply(mask, edge_mask, stream);
+        
+        return true;
+    } catch (const cv::Exception& e) {
+        std::cerr << "Error creating edge mask (GPU): " << e.what() << std::endl;
+        edge_mask.create(input.size(), CV_32FC1);
+        edge_mask.setTo(cv::Scalar(0.5), stream); // Neutral mask
+        return false;
+    }
+}
+
+bool AdaptiveSharpening::applyUnsharpMask(const cv::cuda::GpuMat& input, const cv::cuda::GpuMat& edge_mask,
+                                          cv::cuda::GpuMat& output, cv::cuda::Stream& stream) {
+    cv::cuda::GpuMat& blurred = m_arena->device("sharpen.d_blurred", input.size(), input.type());
+    gpu_utils::applyPerChannel(m_d_unsharp_blur, input, blurred, stream);
+    
+    applyEdgeWeightedSharpening(input, blurred, edge_mask, output, stream);
+    return true;
+}
+
+bool AdaptiveSharpening::calculateTextureMap(const cv::cuda::GpuMat& input, cv::cuda::GpuMat& texture_map,
+                                             cv::cuda::Stream& stream) {
+    try {
+        FrameArena& arena = *m_arena;
+        const cv::Size size = input.size();
+        
+        cv::cuda::GpuMat gray = input;
+        if (input.channels() != 1) {
+            gray = arena.device("sharpen.d_gray", size, CV_8UC1);
+            cv::cuda::cvtColor(input, gray, cv::COLOR_BGR2GRAY, 0, stream);
+        }
+        
+        // Local standard deviation over a 7x7 window
+        cv::cuda::GpuMat& gray_float = arena.device("sharpen.d_gray_float", size, CV_32FC1);
+        cv::cuda::GpuMat& local_mean = arena.device("sharpen.d_local_mean", size, CV_32FC1);
+        cv::cuda::GpuMat& diff_sq = arena.device("sharpen.d_diff_sq", size, CV_32FC1);
+        cv::cuda::GpuMat& local_var = arena.device("sharpen.d_local_var", size, CV_32FC1);
+        gray.convertTo(gray_float, CV_32F, stream);
+        m_d_texture_box->apply(gray_float, local_mean, stream);
+        cv::cuda::subtract(gray_float, local_mean, diff_sq, cv::noArray(), -1, stream);
+        cv::cuda::sqr(diff_sq, diff_sq, stream);
+        m_d_texture_box->apply(diff_sq, local_var, stream);
+        cv::cuda::sqrt(local_var, texture_map, stream);
+        
+        // Normalize to 0-1 range; only the two extrema cross the bus
+        stream.waitForCompletion();
+        double min_val, max_val;
+        cv::cuda::minMax(texture_map, &min_val, &max_val);
+        double range = std::max(max_val - min_val, 1e-6);
+        texture_map.convertTo(texture_map, CV_32F, 1.0 / range, -min_val / range, stream);
+        
+        return true;
+    } catch (const cv::Exception& e) {
+        std::cerr << "Error calculating texture map (GPU): " << e.what() << std::endl;
+        texture_map.create(input.size(), CV_32FC1);
+        texture_map.setTo(cv::Scalar(0.5), stream); // Neutral map
+        return false;
+    }
+}
+
+bool AdaptiveSharpening::applyVariableSigmaUnsharpMask(const cv::cuda::GpuMat& input, 
+                                                       const cv::cuda::GpuMat& texture_map, 
+                                                       const cv::cuda::GpuMat& edge_mask, 
+                                                       cv::cuda::GpuMat& output,
+                                                       cv::cuda::Stream& stream) {
+    FrameArena& arena = *m_arena;
+    const cv::Size size = input.size();
+    const double sigma_range = kMaxAdaptiveSigma - kMinAdaptiveSigma;
+    const double last_level = kNumSigmaLevels - 1;
+    
+    // High texture -> low sigma, low texture -> high sigma, softened like the host path
+    cv::cuda::GpuMat& raw_sigma = arena.device("sharpen.d_raw_sigma", size, CV_32FC1);
+    cv::cuda::GpuMat& sigma_map = arena.device("sharpen.d_sigma", size, CV_32FC1);
+    texture_map.convertTo(raw_sigma, CV_32F, -sigma_range, kMaxAdaptiveSigma, stream);
+    m_d_sigma_blur->apply(raw_sigma, sigma_map, stream);
+    
+#ifdef WITH_FUSED_KERNELS
+    // One pass per pixel: blend the two bracketing levels and sharpen
+    if (m_d_blend_params.levels > 0 && input.depth() == CV_8U &&
+        (input.channels() == 1 || input.channels() == 3)) {
+        output.create(input.size(), input.type());
+        if (output.data != input.data) {
+            sharpen_kernels::Params params = m_d_blend_params;
+            params.gain = m_config.strength * (m_config.edge_strength - m_config.smooth_strength);
+            params.offset = m_config.strength * m_config.smooth_strength;
+            params.preserve_tone = m_config.preserve_tone;
+            
+            cudaStream_t cuda_stream = static_cast<cudaStream_t>(cv::cuda::StreamAccessor::getStream(stream));
+            if (sharpen_kernels::launchVariableSigmaSharpen(input.data, input.step, input.channels(),
+                                                            sigma_map.ptr<float>(), sigma_map.step,
+                                                            edge_mask.ptr<float>(), edge_mask.step,
+                                                            output.data, output.step,
+                                                            input.cols, input.rows, params, cuda_stream)) {
+                return true;
+            }
+            std::cerr << "Failed to launch variable sigma sharpening kernel, using filter fallback" << std::endl;
+        }
+    }
+#endif
+    
+    // Filter fallback. Fractional level index in [0, levels - 1]
+    cv::cuda::GpuMat& level_index = arena.device("sharpen.d_level_index", size, CV_32FC1);
+    sigma_map.convertTo(level_index, CV_32F, last_level / sigma_range,
+                        -kMinAdaptiveSigma * last_level / sigma_range, stream);
+    cv::cuda::threshold(level_index, level_index, 0.0, 0.0, cv::THRESH_TOZERO, stream);
+    cv::cuda::threshold(level_index, level_index, last_level, last_level, cv::THRESH_TRUNC, stream);
+    
+    // Linear interpolation between neighbouring levels, written as a sum of
+    // tent weights so every pixel is handled by the same kernels. The
+    // levels run in stream order, so one weight and level buffer serve all.
+    cv::cuda::GpuMat& accumulated = arena.device("sharpen.d_accumulated", size, CV_32FC(input.channels()));
+    cv::cuda::GpuMat& weight = arena.device("sharpen.d_level_weight", size, CV_32FC1);
+    cv::cuda::GpuMat& level = arena.device("sharpen.d_level", size, input.type());
+    accumulated.setTo(cv::Scalar::all(0), stream);
+    for (int i = 0; i < kNumSigmaLevels; i++) {
+        cv::cuda::absdiff(level_index, cv::Scalar::all(i), weight, stream);
+        weight.convertTo(weight, CV_32F, -1.0, 1.0, stream);
+        cv::cuda::threshold(weight, weight, 0.0, 0.0, cv::THRESH_TOZERO, stream);
+        
+        gpu_utils::applyPerChannel(m_d_sigma_levels[i], input, level, stream);
+        gpu_utils::weightedAdd(accumulated, level, weight, accumulated, stream);
+    }
+    
+    cv::cuda::GpuMat& blurred = arena.device("sharpen.d_blurred", size, input.type());
+    accumulated.convertTo(blurred, input.depth(), stream);
+    
+    applyEdgeWeightedSharpening(input, blurred, edge_mask, output, stream);
+    return true;
+}
+
+void AdaptiveSharpening::applyEdgeWeightedSharpening(const cv::cuda::GpuMat& input,
+                                                     const cv::cuda::GpuMat& blurred,
+                                                     const cv::cuda::GpuMat& edge_mask,
+                                                     cv::cuda::GpuMat& output,
+                                                     cv::cuda::Stream& stream) {
+    FrameArena& arena = *m_arena;
+    const cv::Size size = input.size();
+    
+    // Unsharp mask, saturated like the host path
+    cv::cuda::GpuMat& unsharp_mask = arena.device("sharpen.d_unsharp", size, input.type());
+    cv::cuda::subtract(input, blurred, unsharp_mask, cv::noArray(), -1, stream);
+    
+    // strength * (edge * edge_strength + (1 - edge) * smooth_strength)
+    cv::cuda::GpuMat& strength = arena.device("sharpen.d_strength", size, CV_32FC1);
+    edge_mask.convertTo(strength, CV_32F,
+                        m_config.strength * (m_config.edge_strength - m_config.smooth_strength),
+                        m_config.strength * m_config.smooth_strength, stream);
+    
+    if (!m_config.preserve_tone || input.channels() != 3) {
+        gpu_utils::weightedAdd(input, unsharp_mask, strength, output, stream);
+        return;
+    }
+    
+    cv::cuda::GpuMat& sharpened = arena.device("sharpen.d_sharpened", size, input.type());
+    gpu_utils::weightedAdd(input, unsharp_mask, strength, sharpened, stream);
+    
+    // Keep the sharpened luma, restore the original chroma
+    cv::cuda::GpuMat& ycrcb_input = arena.device("sharpen.d_ycrcb_input", size, input.type());
+    cv::cuda::GpuMat& ycrcb_output = arena.device("sharpen.d_ycrcb_output", size, input.type());
+    cv::cuda::cvtColor(input, ycrcb_input, cv::COLOR_BGR2YCrCb, 0, stream);
+    cv::cuda::cvtColor(sharpened, ycrcb_output, cv::COLOR_BGR2YCrCb, 0, stream);
+    
+    cv::cuda::GpuMat input_planes[3] = {
+        arena.device("sharpen.d_input_y", size, CV_8UC1),
+        arena.device("sharpen.d_input_cr", size, CV_8UC1),
+        arena.device("sharpen.d_input_cb", size, CV_8UC1)
+    };
+    cv::cuda::GpuMat sharpened_planes[3] = {
+        arena.device("sharpen.d_sharpened_y", size, CV_8UC1),
+        arena.device("sharpen.d_sharpened_cr", size, CV_8UC1),
+        arena.device("sharpen.d_sharpened_cb", size, CV_8UC1)
+    };
+    cv::cuda::split(ycrcb_input, input_planes, stream);
+    cv::cuda::split(ycrcb_output, sharpened_planes, stream);
+    
+    cv::cuda::GpuMat merged[3] = { sharpened_planes[0], input_planes[1], input_planes[2] };
+    cv::cuda::merge(merged, 3, ycrcb_output, stream);
+    cv::cuda::cvtColor(ycrcb_output, output, cv::COLOR_YCrCb2BGR, 0, stream);
+}
+#endif
@@ -0,0 +1,191 @@
+#include "async_super_res.h"
+#include "thread_placement.h"
+#include <chrono>
+#include <iostream>
+
+AsyncSuperRes::AsyncSuperRes(std::shared_ptr<DnnSuperRes> model, const Config& config)
+    : m_model(std::move(model)),
+      m_config(config),
+      m_running_jobs(0),
+      m_dropped(0),
+      m_running(false) {
+    if (m_config.max_in_flight == 0) {
+        m_config.max_in_flight = 1;
+    }
+}
+
+AsyncSuperRes::~AsyncSuperRes() {
+    stop();
+}
+
+bool AsyncSuperRes::start() {
+    if (!m_model || !m_model->isInitialized()) {
+        std::cerr << "Async super-resolution requires an initialized model" << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_running) {
+        return true;
+    }
+
+    m_running = true;
+    m_worker = std::thread(&AsyncSuperRes::workerLoop, this);
+    return true;
+}
+
+void AsyncSuperRes::stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_running) {
+            return;
+        }
+        m_running = false;
+
+        // Resolve everything still waiting so no caller blocks on a future forever
+        for (auto& job : m_pending) {
+            dropJob(job);
+        }
+        m_pending.clear();
+    }
+
+    m_work_available.notify_all();
+    m_space_available.notify_all();
+
+    if (m_worker.joinable()) {
+        m_worker.join();
+    }
+}
+
+std::future<AsyncSuperRes::Result> AsyncSuperRes::submit(const cv::Mat& frame, const FrameMetadata& metadata) {
+    Job job;
+    job.frame = frame;
+    job.metadata = metadata;
+    job.submit_time = FrameMetadata::Clock::now();
+    std::future<Result> future = job.promise.get_future();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    if (!m_running || frame.empty()) {
+        dropJob(job);
+        return future;
+    }
+
+    if (m_pending.size() + m_running_jobs >= m_config.max_in_flight) {
+        switch (m_config.drop_policy) {
+            case BLOCK:
+                m_space_available.wait(lock, [this]() {
+                    return !m_running || m_pending.size() + m_running_jobs < m_config.max_in_flight;
+                });
+                if (!m_running) {
+                    dropJob(job);
+                    return future;
+                }
+                break;
+            case DROP_OLDEST:
+                // Only frames still waiting can be dropped; if every slot is
+                // in inference the new frame gives way instead
+                if (!m_pending.empty()) {
+                    dropJob(m_pending.front());
+                    m_pending.pop_front();
+                    break;
+                }
+                dropJob(job);
+                return future;
+            case DROP_NEWEST:
+            default:
+                dropJob(job);
+                return future;
+        }
+    }
+
+    m_pending.push_back(std::move(job));
+    lock.unlock();
+    m_work_available.notify_one();
+
+    return future;
+}
+
+size_t AsyncSuperRes::inFlight() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pending.size() + m_running_jobs;
+}
+
+uint64_t AsyncSuperRes::droppedFrames() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_dropped;
+}
+
+bool AsyncSuperRes::isRunning() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_running;
+}
+
+void AsyncSuperRes::workerLoop() {
+    std::cout << "Async super-resolution thread started" << std::endl;
+    ThreadPlacement::instance().apply(ThreadPlacement::INFERENCE);
+
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_work_available.wait(lock, [this]() { return !m_running || !m_pending.empty(); });
+            if (!m_running) {
+                break;
+            }
+
+            job = std::move(m_pending.front());
+            m_pending.pop_front();
+
+            // Stale frames are skipped rather than spending inference on them
+            if (m_config.max_age_ms > 0.0) {
+                double age_ms = std::chrono::duration<double, std::milli>(
+                    FrameMetadata::Clock::now() - job.submit_time).count();
+                if (age_ms > m_config.max_age_ms) {
+                    dropJob(job);
+                    lock.unlock();
+                    m_space_available.notify_one();
+                    continue;
+                }
+            }
+
+            m_running_jobs = 1;
+        }
+
+        Result result;
+        result.frame_id = job.metadata.frame_id;
+        result.metadata = job.metadata;
+        result.source = job.frame;
+
+        auto start = std::chrono::high_resolution_clock::now();
+        try {
+            result.success = m_model->upscale(job.frame, result.output) && !result.output.empty();
+        } catch (const cv::Exception& e) {
+            std::cerr << "Error in async super-resolution: " << e.what() << std::endl;
+            result.success = false;
+        }
+        result.inference_ms = std::chrono::duration<double, std::milli>(
+            std::chrono::high_resolution_clock::now() - start).count();
+
+        job.promise.set_value(std::move(result));
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_running_jobs = 0;
+        }
+        m_space_available.notify_one();
+    }
+
+    std::cout << "Async super-resolution thread finished" << std::endl;
+}
+
+void AsyncSuperRes::dropJob(Job& job) {
+    Result result;
+    result.frame_id = job.metadata.frame_id;
+    result.metadata = job.metadata;
+    result.source = job.frame;
+    result.dropped = true;
+
+    job.promise.set_value(std::move(result));
+    m_dropped++;
+}
@@ -0,0 +1,214 @@
+#include "batched_super_res.h"
+#include "thread_placement.h"
+#include <iostream>
+#include <vector>
+
+#ifdef WITH_CUDA
+#include <opencv2/core/cuda.hpp>
+#endif
+
+BatchedSuperRes::BatchedSuperRes(std::shared_ptr<DnnSuperRes> model, const Config& config)
+    : m_model(std::move(model)),
+      m_config(config),
+      m_running(false),
+      m_device(-1) {
+    if (m_config.max_batch == 0) {
+        m_config.max_batch = 1;
+    }
+
+    Metrics& metrics = Metrics::instance();
+    m_metric_forward = metrics.registerLatency("batch.forward", "One batched super-resolution forward pass");
+    m_metric_wait = metrics.registerLatency("batch.wait", "Time a frame waits for its batch to fill");
+}
+
+BatchedSuperRes::~BatchedSuperRes() {
+    stop();
+}
+
+bool BatchedSuperRes::start() {
+    if (!m_model || !m_model->isInitialized()) {
+        std::cerr << "Batched super-resolution requires an initialized model" << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_running) {
+        return true;
+    }
+
+#ifdef WITH_CUDA
+    if (m_model->isUsingGPU()) {
+        m_device = cv::cuda::getDevice();
+    }
+#endif
+
+    if (!m_model->supportsBatching()) {
+        std::cout << "Model has no batched path, frames will run one at a time" << std::endl;
+    }
+
+    m_running = true;
+    m_worker = std::thread(&BatchedSuperRes::workerLoop, this);
+    return true;
+}
+
+void BatchedSuperRes::stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_running) {
+            return;
+        }
+        m_running = false;
+
+        // Resolve everything still waiting so no caller blocks on a future forever
+        for (auto& job : m_pending) {
+            failJob(job);
+        }
+        m_pending.clear();
+    }
+
+    m_work_available.notify_all();
+    if (m_worker.joinable()) {
+        m_worker.join();
+    }
+}
+
+std::future<BatchedSuperRes::Result> BatchedSuperRes::submit(const cv::Mat& frame) {
+    Job job;
+    job.frame = frame;
+    job.submit_time = std::chrono::steady_clock::now();
+    std::future<Result> future = job.promise.get_future();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_running || frame.empty()) {
+            failJob(job);
+            return future;
+        }
+        m_pending.push_back(std::move(job));
+    }
+    m_work_available.notify_one();
+
+    return future;
+}
+
+bool BatchedSuperRes::upscale(const cv::Mat& input, cv::Mat& output) {
+    Result result = submit(input).get();
+    if (!result.success) {
+        return false;
+    }
+    output = result.output;
+    return true;
+}
+
+size_t BatchedSuperRes::batchableCount() const {
+    const cv::Mat& first = m_pending.front().frame;
+    size_t count = 0;
+    for (const Job& job : m_pending) {
+        if (job.frame.size() == first.size() && job.frame.type() == first.type()) {
+            count++;
+        }
+    }
+    return count;
+}
+
+void BatchedSuperRes::workerLoop() {
+    ThreadPlacement::instance().apply(ThreadPlacement::INFERENCE);
+#ifdef WITH_CUDA
+    if (m_device >= 0) {
+        cv::cuda::setDevice(m_device);
+    }
+#endif
+
+    const auto max_wait = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double, std::milli>(m_config.max_wait_ms));
+    const size_t pad_to = (m_config.fixed_batch_shape && m_model->isUsingGPU()) ? m_config.max_batch : 0;
+
+    std::vector<Job> batch;
+    std::vector<cv::Mat> inputs;
+    std::vector<cv::Mat> outputs;
+    batch.reserve(m_config.max_batch);
+    inputs.reserve(m_config.max_batch);
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_work_available.wait(lock, [this]() {
+                return !m_running || !m_pending.empty();
+            });
+            if (!m_running) {
+                // stop() already resolved whatever was queued
+                break;
+            }
+
+            // Hold the batch open until it fills or its oldest frame is due
+            auto deadline = m_pending.front().submit_time + max_wait;
+            m_work_available.wait_until(lock, deadline, [this]() {
+                return !m_running || batchableCount() >= m_config.max_batch;
+            });
+            if (!m_running) {
+                break;
+            }
+
+            // Take the oldest frame and every later one of the same shape
+            const cv::Size size = m_pending.front().frame.size();
+            const int type = m_pending.front().frame.type();
+            for (auto it = m_pending.begin(); it != m_pending.end() && batch.size() < m_config.max_batch;) {
+                if (it->frame.size() == size && it->frame.type() == type) {
+                    batch.push_back(std::move(*it));
+                    it = m_pending.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        inputs.clear();
+        outputs.clear();
+        for (const Job& job : batch) {
+            inputs.push_back(job.frame);
+            Metrics::instance().record(m_metric_wait,
+                std::chrono::duration<double, std::milli>(start - job.submit_time).count());
+        }
+
+        try {
+            // A partial failure still leaves the other frames' outputs
+            m_model->upscaleBatch(inputs, outputs, pad_to);
+        } catch (const cv::Exception& e) {
+            std::cerr << "Error in batched super-resolution: " << e.what() << std::endl;
+        }
+        Metrics::instance().recordSince(m_metric_forward, start);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stats.batches++;
+            m_stats.frames += batch.size();
+        }
+
+        for (size_t i = 0; i < batch.size(); i++) {
+            Result result;
+            result.batch_size = batch.size();
+            result.wait_ms = std::chrono::duration<double, std::milli>(start - batch[i].submit_time).count();
+            if (i < outputs.size() && !outputs[i].empty()) {
+                result.output = std::move(outputs[i]);
+                result.success = true;
+            }
+            batch[i].promise.set_value(std::move(result));
+        }
+        batch.clear();
+    }
+}
+
+void BatchedSuperRes::failJob(Job& job) {
+    job.promise.set_value(Result());
+}
+
+BatchedSuperRes::Stats BatchedSuperRes::getStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+bool BatchedSuperRes::isRunning() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_running;
+}
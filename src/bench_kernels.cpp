@@ -0,0 +1,522 @@
+#include "frame_buffer.h"
+#include "adaptive_sharpening.h"
+#include "selective_bilateral.h"
+#include "temporal_consistency.h"
+#include "video_enhancer.h"
+#include "upscaler.h"
+#include "dnn_super_res.h"
+#include <benchmark/benchmark.h>
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Kernel-level micro-benchmarks (Google Benchmark). Every benchmark times
+// one module on a deterministic synthetic frame, then compares the module's
+// output with a golden frame from a known-good build: an optimisation that
+// makes a kernel faster must not quietly lower PSNR or SSIM. Golden frames
+// are written with --update-golden and checked on every later run; a
+// benchmark without one fails rather than skipping the check.
+
+namespace {
+
+struct Resolution {
+    const char* name;
+    cv::Size size;
+};
+
+// Output resolutions; upscalers and models get a quarter-size input
+const Resolution kResolutions[] = {
+    {"480p", cv::Size(848, 480)},
+    {"720p", cv::Size(1280, 720)},
+    {"1080p", cv::Size(1920, 1080)},
+    {"4k", cv::Size(3840, 2160)},
+};
+constexpr int kScale = 4;
+
+// Frames in the fixed sequence behind the temporal consistency check
+constexpr int kTemporalCheckFrames = 6;
+
+struct QualityOptions {
+    std::string golden_dir = "bench_golden";
+    bool update = false;            // Write outputs as the new golden frames
+    double min_psnr = 40.0;         // dB against the golden frame
+    double min_ssim = 0.98;         // Mean SSIM against the golden frame
+    bool use_gpu = false;           // Benchmark the modules' CUDA paths
+};
+
+QualityOptions g_quality;
+int g_quality_failures = 0;
+int g_missing_golden = 0;
+
+// Textured plane with a grid and a moving disc, as in bench_video_processor:
+// detail for the sharpening and bilateral masks, motion for optical flow
+class SyntheticSource {
+public:
+    const cv::Mat& frame(const cv::Size& size, int index) {
+        Entry& entry = m_entries[{size.width, size.height}];
+        if (entry.texture.empty()) {
+            cv::RNG rng(0x5eed);
+            cv::Mat noise(size.height * 2, size.width * 2, CV_8UC3);
+            rng.fill(noise, cv::RNG::UNIFORM, cv::Scalar::all(0), cv::Scalar::all(255));
+            cv::GaussianBlur(noise, entry.texture, cv::Size(0, 0), 3.0);
+            for (int x = 0; x < entry.texture.cols; x += 32) {
+                cv::line(entry.texture, cv::Point(x, 0), cv::Point(x, entry.texture.rows - 1),
+                         cv::Scalar(240, 240, 240), 1);
+            }
+            for (int y = 0; y < entry.texture.rows; y += 32) {
+                cv::line(entry.texture, cv::Point(0, y), cv::Point(entry.texture.cols - 1, y),
+                         cv::Scalar(16, 16, 16), 1);
+            }
+        }
+
+        const int x = (index * 3) % size.width;
+        const int y = (index * 2) % size.height;
+        entry.texture(cv::Rect(x, y, size.width, size.height)).copyTo(entry.frame);
+        const int cx = (index * 5) % size.width;
+        cv::circle(entry.frame, cv::Point(cx, size.height / 2), size.height / 8,
+                   cv::Scalar(40, 90, 220), -1, cv::LINE_AA);
+        return entry.frame;
+    }
+
+private:
+    struct Entry {
+        cv::Mat texture;
+        cv::Mat frame;
+    };
+    std::map<std::pair<int, int>, Entry> m_entries;
+};
+
+SyntheticSource g_source;
+
+// Mean SSIM over the channels (Wang et al. 2004: 11x11 Gaussian window, sigma 1.5)
+double computeSSIM(const cv::Mat& a, const cv::Mat& b) {
+    const double C1 = 6.5025;   // (0.01 * 255)^2
+    const double C2 = 58.5225;  // (0.03 * 255)^2
+    const cv::Size window(11, 11);
+    const double sigma = 1.5;
+
+    cv::Mat I1, I2;
+    a.convertTo(I1, CV_32F);
+    b.convertTo(I2, CV_32F);
+
+    cv::Mat mu1, mu2;
+    cv::GaussianBlur(I1, mu1, window, sigma);
+    cv::GaussianBlur(I2, mu2, window, sigma);
+    cv::Mat mu1_2 = mu1.mul(mu1);
+    cv::Mat mu2_2 = mu2.mul(mu2);
+    cv::Mat mu1_mu2 = mu1.mul(mu2);
+
+    cv::Mat sigma1_2, sigma2_2, sigma12;
+    cv::GaussianBlur(I1.mul(I1), sigma1_2, window, sigma);
+    cv::GaussianBlur(I2.mul(I2), sigma2_2, window, sigma);
+    cv::GaussianBlur(I1.mul(I2), sigma12, window, sigma);
+    sigma1_2 -= mu1_2;
+    sigma2_2 -= mu2_2;
+    sigma12 -= mu1_mu2;
+
+    cv::Mat numerator = (2 * mu1_mu2 + C1).mul(2 * sigma12 + C2);
+    cv::Mat denominator = (mu1_2 + mu2_2 + C1).mul(sigma1_2 + sigma2_2 + C2);
+    cv::Mat ssim_map;
+    cv::divide(numerator, denominator, ssim_map);
+
+    cv::Scalar mean = cv::mean(ssim_map);
+    double total = 0.0;
+    for (int c = 0; c < a.channels(); c++) {
+        total += mean[c];
+    }
+    return total / a.channels();
+}
+
+std::string goldenPath(const std::string& benchmark_name) {
+    std::string file = benchmark_name;
+    std::replace(file.begin(), file.end(), '/', '_');
+    return (std::filesystem::path(g_quality.golden_dir) / (file + ".png")).string();
+}
+
+// Compare a benchmark's output with its golden frame and report PSNR/SSIM
+// as counters; a frame below the thresholds fails the benchmark
+void checkQuality(benchmark::State& state, const cv::Mat& output) {
+    if (output.empty()) {
+        state.SkipWithError("Module produced no output");
+        g_quality_failures++;
+        return;
+    }
+
+    const std::string path = goldenPath(state.name());
+    if (g_quality.update) {
+        std::error_code error;
+        std::filesystem::create_directories(g_quality.golden_dir, error);
+        if (!cv::imwrite(path, output)) {
+            std::cerr << "Failed to write golden frame " << path << std::endl;
+            g_quality_failures++;
+        }
+        return;
+    }
+
+    cv::Mat golden = cv::imread(path, cv::IMREAD_UNCHANGED);
+    if (golden.empty()) {
+        // A missing golden frame would turn the quality guard into a no-op
+        state.SkipWithError("No golden frame (record one with --update-golden)");
+        g_missing_golden++;
+        return;
+    }
+    if (golden.size() != output.size() || golden.type() != output.type()) {
+        state.SkipWithError("Output size or type differs from the golden frame");
+        g_quality_failures++;
+        return;
+    }
+
+    const double psnr = cv::PSNR(output, golden);
+    const double ssim = computeSSIM(output, golden);
+    state.counters["psnr_db"] = psnr;
+    state.counters["ssim"] = ssim;
+
+    if (psnr < g_quality.min_psnr || ssim < g_quality.min_ssim) {
+        std::ostringstream message;
+        message << "Quality regression: PSNR " << psnr << " dB (min " << g_quality.min_psnr
+                << "), SSIM " << ssim << " (min " << g_quality.min_ssim << ")";
+        state.SkipWithError(message.str().c_str());
+        g_quality_failures++;
+    }
+}
+
+void setPixelCounters(benchmark::State& state, const cv::Size& size) {
+    state.counters["megapixels_per_s"] = benchmark::Counter(
+        size.area() / 1e6, benchmark::Counter::kIsIterationInvariantRate);
+}
+
+cv::Size inputSize(const cv::Size& output_size) {
+    return cv::Size(output_size.width / kScale, output_size.height / kScale);
+}
+
+// --- Benchmarks -----------------------------------------------------------
+
+void benchFrameBuffer(benchmark::State& state, cv::Size size) {
+    FrameBuffer buffer(4, size, CV_8UC3);
+    const cv::Mat& input = g_source.frame(size, 0);
+    cv::Mat output;
+
+    for (auto _ : state) {
+        buffer.pushFrame(input, false);
+        buffer.popFrame(output, false);
+        benchmark::DoNotOptimize(output.data);
+    }
+    setPixelCounters(state, size);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * size.area() * 3 * 2);
+
+    // A buffer hands frames back bit for bit
+    if (output.empty() || cv::norm(input, output, cv::NORM_INF) != 0.0) {
+        state.SkipWithError("Popped frame differs from the pushed frame");
+        g_quality_failures++;
+    }
+}
+
+void benchSharpening(benchmark::State& state, cv::Size size) {
+    AdaptiveSharpening::Config config;
+    config.use_gpu = g_quality.use_gpu;
+    AdaptiveSharpening sharpening(config);
+    if (!sharpening.initialize()) {
+        state.SkipWithError("Failed to initialize adaptive sharpening");
+        return;
+    }
+
+    const cv::Mat& input = g_source.frame(size, 0);
+    cv::Mat output;
+    for (auto _ : state) {
+        sharpening.process(input, output);
+    }
+    setPixelCounters(state, size);
+    checkQuality(state, output);
+}
+
+// Settings of the upscaler's pre- and post-processing filters
+SelectiveBilateral::Config bilateralConfig(SelectiveBilateral::FilteringStage stage) {
+    SelectiveBilateral::Config config;
+    config.stage = stage;
+    config.use_gpu = g_quality.use_gpu;
+    if (stage == SelectiveBilateral::POST_PROCESSING) {
+        config.diameter = 5;
+        config.sigma_color = 20.0;
+        config.sigma_space = 20.0;
+        config.texture_boost = 1.2;
+        config.edge_preserve = 1.5;
+        config.num_scales = 2;
+    } else {
+        config.diameter = 7;
+        config.sigma_color = 30.0;
+        config.sigma_space = 30.0;
+        config.texture_boost = 1.5;
+        config.edge_preserve = 2.0;
+        config.num_scales = 3;
+    }
+    config.use_multiscale = true;
+    return config;
+}
+
+void benchBilateral(benchmark::State& state, cv::Size size, SelectiveBilateral::FilteringStage stage) {
+    SelectiveBilateral bilateral(bilateralConfig(stage));
+    if (!bilateral.initialize()) {
+        state.SkipWithError("Failed to initialize selective bilateral filter");
+        return;
+    }
+
+    const cv::Mat& input = g_source.frame(size, 0);
+    cv::Mat output;
+    for (auto _ : state) {
+        bilateral.process(input, output);
+    }
+    setPixelCounters(state, size);
+    checkQuality(state, output);
+}
+
+void benchTemporal(benchmark::State& state, cv::Size size) {
+    TemporalConsistency::Config config;
+    config.use_gpu = g_quality.use_gpu;
+    TemporalConsistency temporal(config);
+    if (!temporal.initialize()) {
+        state.SkipWithError("Failed to initialize temporal consistency");
+        return;
+    }
+
+    // Moving frames keep the flow and blending paths busy; the inputs are
+    // prepared up front so only process() is timed
+    std::vector<cv::Mat> frames;
+    for (int i = 0; i < kTemporalCheckFrames; i++) {
+        frames.push_back(g_source.frame(size, i).clone());
+    }
+
+    cv::Mat output;
+    size_t index = 0;
+    for (auto _ : state) {
+        temporal.process(frames[index], output);
+        index = (index + 1) % frames.size();
+    }
+    setPixelCounters(state, size);
+
+    // The output depends on the history, so the check replays a fixed sequence
+    temporal.reset();
+    for (const cv::Mat& frame : frames) {
+        temporal.process(frame, output);
+    }
+    checkQuality(state, output);
+}
+
+void benchLUT(benchmark::State& state, cv::Size size) {
+    // Warm grade over a 33-point lattice: (size * size) x size, (b + g * size, r)
+    const int lut_size = 33;
+    cv::Mat lut(lut_size * lut_size, lut_size, CV_8UC3);
+    for (int g = 0; g < lut_size; g++) {
+        for (int b = 0; b < lut_size; b++) {
+            cv::Vec3b* row = lut.ptr<cv::Vec3b>(b + g * lut_size);
+            for (int r = 0; r < lut_size; r++) {
+                const double scale = 255.0 / (lut_size - 1);
+                row[r] = cv::Vec3b(cv::saturate_cast<uchar>(b * scale * 0.92),
+                                   cv::saturate_cast<uchar>(g * scale),
+                                   cv::saturate_cast<uchar>(r * scale * 1.06 + 4));
+            }
+        }
+    }
+
+    VideoEnhancer enhancer;
+    const cv::Mat& input = g_source.frame(size, 0);
+    cv::Mat output;
+#ifdef WITH_FUSED_KERNELS
+    if (g_quality.use_gpu) {
+        // Texture lookup; timed with the stream drained so each iteration
+        // covers the whole kernel
+        cv::cuda::Stream stream;
+        cv::cuda::GpuMat d_input(input), d_output;
+        for (auto _ : state) {
+            if (!enhancer.applyLUT(d_input, d_output, lut, cv::cuda::GpuMat(), stream)) {
+                state.SkipWithError("Device LUT launch failed");
+                return;
+            }
+            stream.waitForCompletion();
+        }
+        d_output.download(output);
+        setPixelCounters(state, size);
+        checkQuality(state, output);
+        return;
+    }
+#endif
+    for (auto _ : state) {
+        enhancer.applyLUT(input, output, lut, cv::Mat());
+    }
+    setPixelCounters(state, size);
+    checkQuality(state, output);
+}
+
+void benchUpscaler(benchmark::State& state, cv::Size size, Upscaler::Algorithm algorithm) {
+    Upscaler upscaler(algorithm, g_quality.use_gpu);
+    if (!upscaler.initialize(size.width, size.height)) {
+        state.SkipWithError("Failed to initialize upscaler");
+        return;
+    }
+    if ((algorithm == Upscaler::SUPER_RES || algorithm == Upscaler::REAL_ESRGAN) && !upscaler.isUsingModel()) {
+        state.SkipWithError("Model not available");
+        return;
+    }
+
+    const cv::Mat input = g_source.frame(inputSize(size), 0).clone();
+    cv::Mat output;
+    for (auto _ : state) {
+        upscaler.upscale(input, output);
+    }
+    setPixelCounters(state, size);
+
+    // Temporal consistency blends with earlier iterations; check a fresh frame
+    if (TemporalConsistency* temporal = upscaler.getTemporalConsistency()) {
+        temporal->reset();
+        upscaler.upscale(input, output);
+    }
+    checkQuality(state, output);
+}
+
+void benchDnnSuperRes(benchmark::State& state, cv::Size size, Upscaler::Model model) {
+    DnnSuperRes sr(model.path, model.name, model.scale, model.type);
+    sr.setUseGPU(g_quality.use_gpu);
+    if (!sr.initialize()) {
+        state.SkipWithError("Model not available");
+        return;
+    }
+
+    const cv::Size input_size(size.width / model.scale, size.height / model.scale);
+    const cv::Mat input = g_source.frame(input_size, 0).clone();
+    cv::Mat output;
+    for (auto _ : state) {
+        sr.upscale(input, output);
+    }
+    setPixelCounters(state, size);
+    checkQuality(state, output);
+}
+
+std::string algorithmKey(Upscaler::Algorithm algorithm) {
+    switch (algorithm) {
+        case Upscaler::NEAREST:     return "nearest";
+        case Upscaler::BILINEAR:    return "bilinear";
+        case Upscaler::BICUBIC:     return "bicubic";
+        case Upscaler::LANCZOS:     return "lanczos";
+        case Upscaler::SUPER_RES:   return "super_res";
+        case Upscaler::REAL_ESRGAN: return "real_esrgan";
+        default:                    return "unknown";
+    }
+}
+
+void registerBenchmarks() {
+    const Upscaler::Algorithm algorithms[] = {
+        Upscaler::NEAREST, Upscaler::BILINEAR, Upscaler::BICUBIC,
+        Upscaler::LANCZOS, Upscaler::SUPER_RES, Upscaler::REAL_ESRGAN
+    };
+    const Upscaler::Model models[] = {
+        {"models/FSRCNN_x4.pb", "fsrcnn", DnnSuperRes::FSRCNN, 4},
+        {"models/ESPCN_x4.pb", "espcn", DnnSuperRes::ESPCN, 4},
+        {"models/EDSR_x4.pb", "edsr", DnnSuperRes::EDSR, 4},
+        {"models/LapSRN_x4.pb", "lapsrn", DnnSuperRes::LAPSRN, 4},
+        {"models/RRDB_ESRGAN_x4.onnx", "esrgan", DnnSuperRes::REAL_ESRGAN, 4},
+    };
+
+    // Frame-rate kernels report milliseconds; the buffer copies are microseconds
+    auto add = [](const std::string& name, std::function<void(benchmark::State&)> fn,
+                  benchmark::TimeUnit unit) {
+        benchmark::RegisterBenchmark(name.c_str(), [fn](benchmark::State& state) { fn(state); })
+            ->Unit(unit)
+            ->UseRealTime();
+    };
+
+    for (const Resolution& res : kResolutions) {
+        const cv::Size size = res.size;
+        const std::string suffix = std::string("/") + res.name;
+
+        add("frame_buffer/push_pop" + suffix,
+            [size](benchmark::State& state) { benchFrameBuffer(state, size); }, benchmark::kMicrosecond);
+        add("adaptive_sharpening" + suffix,
+            [size](benchmark::State& state) { benchSharpening(state, size); }, benchmark::kMillisecond);
+        add("selective_bilateral/pre" + suffix,
+            [size](benchmark::State& state) {
+                benchBilateral(state, size, SelectiveBilateral::PRE_PROCESSING);
+            }, benchmark::kMillisecond);
+        add("selective_bilateral/post" + suffix,
+            [size](benchmark::State& state) {
+                benchBilateral(state, size, SelectiveBilateral::POST_PROCESSING);
+            }, benchmark::kMillisecond);
+        add("temporal_consistency" + suffix,
+            [size](benchmark::State& state) { benchTemporal(state, size); }, benchmark::kMillisecond);
+        add("video_enhancer/lut" + suffix,
+            [size](benchmark::State& state) { benchLUT(state, size); }, benchmark::kMillisecond);
+
+        for (Upscaler::Algorithm algorithm : algorithms) {
+            add("upscaler/" + algorithmKey(algorithm) + suffix,
+                [size, algorithm](benchmark::State& state) { benchUpscaler(state, size, algorithm); },
+                benchmark::kMillisecond);
+        }
+        for (const Upscaler::Model& model : models) {
+            add("dnn_super_res/" + model.name + suffix,
+                [size, model](benchmark::State& state) { benchDnnSuperRes(state, size, model); },
+                benchmark::kMillisecond);
+        }
+    }
+}
+
+void printUsage(const char* program) {
+    std::cout << "Usage: " << program << " [benchmark options] [options]" << std::endl;
+    std::cout << "  --golden-dir DIR  Golden frames (default bench_golden)" << std::endl;
+    std::cout << "  --update-golden   Write this run's outputs as the golden frames" << std::endl;
+    std::cout << "  --min-psnr DB     Lowest PSNR against the golden frame (default 40)" << std::endl;
+    std::cout << "  --min-ssim S      Lowest mean SSIM against the golden frame (default 0.98)" << std::endl;
+    std::cout << "  --gpu             Benchmark the CUDA paths" << std::endl;
+    std::cout << "Google Benchmark options such as --benchmark_filter=REGEX are passed through." << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    // Google Benchmark removes the flags it recognises; the rest are ours
+    benchmark::Initialize(&argc, argv);
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if (arg == "--golden-dir" && has_value) {
+            g_quality.golden_dir = argv[++i];
+        } else if (arg == "--update-golden") {
+            g_quality.update = true;
+        } else if (arg == "--min-psnr" && has_value) {
+            g_quality.min_psnr = std::atof(argv[++i]);
+        } else if (arg == "--min-ssim" && has_value) {
+            g_quality.min_ssim = std::atof(argv[++i]);
+        } else if (arg == "--gpu") {
+            g_quality.use_gpu = true;
+        } else if (arg == "--help" || arg == "-h") {
+            printUsage(argv[0]);
+            return 0;
+        } else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    registerBenchmarks();
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+
+    if (g_quality.update) {
+        std::cout << "Golden frames written to " << g_quality.golden_dir << std::endl;
+    }
+    if (g_missing_golden > 0) {
+        std::cerr << g_missing_golden << " benchmark(s) had no golden frame in " << g_quality.golden_dir
+                  << " (create them with --update-golden)" << std::endl;
+    }
+    if (g_quality_failures > 0) {
+        std::cerr << g_quality_failures << " benchmark(s) failed the quality check" << std::endl;
+    }
+    return g_missing_golden > 0 || g_quality_failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,541 @@
+#include "upscaler.h"
+#include "selective_bilateral.h"
+#include "adaptive_sharpening.h"
+#include "temporal_consistency.h"
+#include "latency_histogram.h"
+#include "processor.h"
+#include "stage_chain.h"
+#include "raw_capture.h"
+#include "yuv_frame.h"
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef WITH_CUDA
+#include <opencv2/core/cuda.hpp>
+#endif
+
+// Headless, deterministic benchmark of every upscaling configuration.
+// Results are written as JSON so runs can be compared between releases.
+
+struct BenchOptions {
+    int frames = 120;                   // Timed frames per configuration
+    int warmup = 10;                    // Untimed frames per configuration
+    cv::Size source_size{640, 360};     // Synthetic input resolution
+    cv::Size target_size{1920, 1080};   // Upscaled resolution
+    std::string input_path;             // Optional clip instead of the synthetic input
+    std::string json_path = "bench_results.json";
+    bool cpu = true;
+    bool gpu = true;
+};
+
+struct BenchConfig {
+    Upscaler::Algorithm algorithm;
+    bool use_gpu;
+    std::string variant;                // Enhancement toggles in effect
+    bool selective_bilateral;
+    bool adaptive_sharpening;
+    bool temporal_consistency;
+};
+
+struct BenchResult {
+    std::string name;
+    std::string device;
+    std::string variant;
+    std::string algorithm;              // As reported by the Upscaler (shows fallbacks)
+    bool ok = false;
+    LatencyHistogram latency{10000.0, 0.05};
+    double fps = 0.0;
+    double peak_rss_mb = 0.0;
+    double peak_gpu_mb = 0.0;
+};
+
+// Deterministic input: a textured plane panning under a moving disc, so
+// optical flow and temporal blending see real motion but no scene changes
+class FrameSource {
+public:
+    explicit FrameSource(const BenchOptions& options) : m_size(options.source_size) {
+        if (!options.input_path.empty() && rawfile::isRawFile(options.input_path)) {
+            // Raw clips are mapped, so frames come straight from the page cache
+            if (m_raw.open(options.input_path) && m_raw.frameCount() > 0) {
+                cv::Size stored = m_raw.frameSize();
+                m_size = m_raw.frameType() == CV_8UC1 ? cv::Size(stored.width, stored.height * 2 / 3) : stored;
+            } else {
+                std::cerr << "Failed to read " << options.input_path << ", using synthetic input" << std::endl;
+            }
+        } else if (!options.input_path.empty()) {
+            // Decode up front so the benchmark never measures the decoder
+            cv::VideoCapture capture(options.input_path);
+            cv::Mat frame;
+            while (capture.isOpened() && static_cast<int>(m_clip.size()) < options.frames + options.warmup &&
+                   capture.read(frame)) {
+                m_clip.push_back(frame.clone());
+            }
+            if (m_clip.empty()) {
+                std::cerr << "Failed to read " << options.input_path << ", using synthetic input" << std::endl;
+            } else {
+                m_size = m_clip[0].size();
+            }
+        }
+
+        if (m_clip.empty() && !m_raw.isOpen()) {
+            cv::RNG rng(0x5eed);
+            cv::Mat noise(m_size.height * 2, m_size.width * 2, CV_8UC3);
+            rng.fill(noise, cv::RNG::UNIFORM, cv::Scalar::all(0), cv::Scalar::all(255));
+            cv::GaussianBlur(noise, m_texture, cv::Size(0, 0), 3.0);
+            for (int x = 0; x < m_texture.cols; x += 32) {
+                cv::line(m_texture, cv::Point(x, 0), cv::Point(x, m_texture.rows - 1), cv::Scalar(240, 240, 240), 1);
+            }
+            for (int y = 0; y < m_texture.rows; y += 32) {
+                cv::line(m_texture, cv::Point(0, y), cv::Point(m_texture.cols - 1, y), cv::Scalar(16, 16, 16), 1);
+            }
+        }
+    }
+
+    const cv::Size& size() const { return m_size; }
+
+    void frame(int index, cv::Mat& out) {
+        if (m_raw.isOpen()) {
+            cv::Mat view;
+            m_raw.frame(static_cast<uint64_t>(index) % m_raw.frameCount(), view);
+            if (view.channels() == 1) {
+                yuv::toBGR(view, out);
+            } else {
+                view.copyTo(out);
+            }
+            return;
+        }
+        if (!m_clip.empty()) {
+            m_clip[index % m_clip.size()].copyTo(out);
+            return;
+        }
+
+        // Pan back and forth so the sequence has no jumps
+        const int period = 2 * m_size.width;
+        int phase = index % period;
+        int x = phase < m_size.width ? phase : period - phase;
+        int y = (x / 2) % m_size.height;
+        m_texture(cv::Rect(x, y, m_size.width, m_size.height)).copyTo(out);
+
+        int cx = (index * 5) % m_size.width;
+        cv::circle(out, cv::Point(cx, m_size.height / 2), m_size.height / 8, cv::Scalar(40, 90, 220), -1, cv::LINE_AA);
+    }
+
+private:
+    cv::Size m_size;
+    cv::Mat m_texture;
+    std::vector<cv::Mat> m_clip;
+    RawFrameReader m_raw;
+};
+
+// Peak resident set size since the last reset (Linux); 0 if unavailable
+double readPeakRssMb() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) {
+            std::istringstream iss(line.substr(6));
+            double kb = 0.0;
+            iss >> kb;
+            return kb / 1024.0;
+        }
+    }
+    return 0.0;
+}
+
+void resetPeakRss() {
+    // Writing 5 to clear_refs resets VmHWM to the current RSS (Linux 4.0+)
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    clear_refs << "5";
+}
+
+// Device-wide memory in use, in MB; 0 without CUDA
+double gpuUsedMb() {
+#ifdef WITH_CUDA
+    if (cv::cuda::getCudaEnabledDeviceCount() > 0) {
+        cv::cuda::DeviceInfo info;
+        return (info.totalMemory() - info.freeMemory()) / (1024.0 * 1024.0);
+    }
+#endif
+    return 0.0;
+}
+
+std::string algorithmKey(Upscaler::Algorithm algorithm) {
+    switch (algorithm) {
+        case Upscaler::NEAREST:     return "nearest";
+        case Upscaler::BILINEAR:    return "bilinear";
+        case Upscaler::BICUBIC:     return "bicubic";
+        case Upscaler::LANCZOS:     return "lanczos";
+        case Upscaler::SUPER_RES:   return "super_res";
+        case Upscaler::REAL_ESRGAN: return "real_esrgan";
+        default:                    return "unknown";
+    }
+}
+
+std::string jsonEscape(const std::string& text) {
+    std::string out;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+        }
+        out += (c == '\n') ? ' ' : c;
+    }
+    return out;
+}
+
+// Time one measured loop: warmup, then frames with per-frame latency and
+// peak memory. Only run() is timed; prepare() feeds it the next input.
+void runTimed(const BenchOptions& options, BenchResult& result,
+              const std::function<void(int)>& prepare, const std::function<bool()>& run) {
+    for (int i = 0; i < options.warmup; i++) {
+        prepare(i);
+        if (!run()) {
+            return;
+        }
+    }
+
+    resetPeakRss();
+    double gpu_baseline = gpuUsedMb();
+    double gpu_peak = gpu_baseline;
+    double total_ms = 0.0;
+
+    for (int i = 0; i < options.frames; i++) {
+        prepare(options.warmup + i);
+        auto start = std::chrono::high_resolution_clock::now();
+        if (!run()) {
+            return;
+        }
+        double ms = std::chrono::duration<double, std::milli>(
+            std::chrono::high_resolution_clock::now() - start).count();
+        result.latency.record(ms);
+        total_ms += ms;
+        gpu_peak = std::max(gpu_peak, gpuUsedMb());
+    }
+
+    result.ok = true;
+    result.fps = total_ms > 0.0 ? options.frames * 1000.0 / total_ms : 0.0;
+    result.peak_rss_mb = readPeakRssMb();
+    result.peak_gpu_mb = gpu_peak - gpu_baseline;
+}
+
+void benchUpscaler(const BenchOptions& options, FrameSource& source, const BenchConfig& config,
+                   BenchResult& result) {
+    result.device = config.use_gpu ? "gpu" : "cpu";
+    result.variant = config.variant;
+    result.name = algorithmKey(config.algorithm) + "/" + result.device + "/" + config.variant;
+
+    Upscaler upscaler(config.algorithm, config.use_gpu);
+    if (!upscaler.initialize(options.target_size.width, options.target_size.height) ||
+        upscaler.isUsingGPU() != config.use_gpu) {
+        std::cerr << "Skipping " << result.name << ": configuration not available" << std::endl;
+        return;
+    }
+
+    // initialize() re-enables every enhancement, so toggles go after it
+    upscaler.setUseSelectiveBilateral(config.selective_bilateral);
+    upscaler.setUseAdaptiveSharpening(config.adaptive_sharpening);
+    upscaler.setUseTemporalConsistency(config.temporal_consistency);
+    result.algorithm = upscaler.getAlgorithmName();
+
+    cv::Mat input, output;
+    runTimed(options, result,
+             [&](int index) { source.frame(index, input); },
+             [&]() { return upscaler.upscale(input, output); });
+}
+
+// Standalone timing of each enhancement stage at the resolution it runs at in the chain
+void benchStages(const BenchOptions& options, FrameSource& source, bool use_gpu,
+                 std::deque<BenchResult>& results) {
+    const std::string device = use_gpu ? "gpu" : "cpu";
+
+    SelectiveBilateral::Config pre_config;
+    pre_config.stage = SelectiveBilateral::PRE_PROCESSING;
+    pre_config.use_gpu = use_gpu;
+    SelectiveBilateral::Config post_config;
+    post_config.stage = SelectiveBilateral::POST_PROCESSING;
+    post_config.use_gpu = use_gpu;
+    SelectiveBilateral::Config guided_config = pre_config;
+    guided_config.filter_mode = SelectiveBilateral::GUIDED_FILTER;
+    AdaptiveSharpening::Config sharpen_config;
+    sharpen_config.use_gpu = use_gpu;
+    TemporalConsistency::Config temporal_config;
+    temporal_config.use_gpu = use_gpu;
+
+    SelectiveBilateral pre(pre_config);
+    SelectiveBilateral post(post_config);
+    SelectiveBilateral guided(guided_config);
+    AdaptiveSharpening sharpening(sharpen_config);
+    TemporalConsistency temporal(temporal_config);
+    pre.initialize();
+    post.initialize();
+    guided.initialize();
+    sharpening.initialize();
+    temporal.initialize();
+
+    // Post-upscale stages get the bicubic-resized frame; resizing is not timed
+    cv::Mat input, upscaled, output;
+    auto at_source = [&](int index) { source.frame(index, input); };
+    auto at_target = [&](int index) {
+        source.frame(index, input);
+        cv::resize(input, upscaled, options.target_size, 0, 0, cv::INTER_CUBIC);
+    };
+
+    struct Stage {
+        const char* name;
+        std::function<void(int)> prepare;
+        std::function<bool()> run;
+    };
+    const Stage stages[] = {
+        {"selective_bilateral_pre", at_source, [&]() { return pre.process(input, output); }},
+        {"selective_bilateral_pre_guided", at_source, [&]() { return guided.process(input, output); }},
+        {"adaptive_sharpening", at_target, [&]() { return sharpening.process(upscaled, output); }},
+        {"selective_bilateral_post", at_target, [&]() { return post.process(upscaled, output); }},
+        {"temporal_consistency", at_target, [&]() { return temporal.process(upscaled, output); }},
+    };
+
+    for (const Stage& stage : stages) {
+        results.emplace_back();
+        BenchResult& result = results.back();
+        result.name = std::string(stage.name) + "/" + device;
+        result.device = device;
+        result.variant = stage.name;
+        result.algorithm = stage.name;
+        runTimed(options, result, stage.prepare, stage.run);
+    }
+}
+
+// The Graded preset as a fixed Chain and as the equivalent dynamic Processor,
+// to measure what compile-time composition and row fusion save (host only)
+void benchChains(const BenchOptions& options, FrameSource& source, std::deque<BenchResult>& results) {
+    presets::Graded chain;
+    chain.stage<stage::Bicubic>().size = options.target_size;
+    chain.stage<stage::Contrast>().gain = 1.1f;
+    chain.stage<stage::Contrast>().bias = -8.0f;
+    chain.stage<stage::Gamma>() = stage::Gamma(1.1);
+
+    // Same stages, each materialising its own frame
+    stage::Bilateral bilateral;
+    stage::Bicubic bicubic;
+    bicubic.size = options.target_size;
+    stage::Sharpen sharpen;
+    stage::Contrast contrast = chain.stage<stage::Contrast>();
+    stage::Gamma gamma = chain.stage<stage::Gamma>();
+    stage::Temporal temporal;
+    auto rows = [](const auto& row_stage, const cv::Mat& src, cv::Mat& dst) {
+        dst.create(src.size(), src.type());
+        for (int y = 0; y < src.rows; y++) {
+            row_stage.row(src.ptr<uchar>(y), dst.ptr<uchar>(y), src.cols * src.channels(), y);
+        }
+    };
+
+    Processor processor(false);
+    processor.initialize();
+    processor.addOperation("bilateral", [&](const cv::Mat& in, cv::Mat& out) { bilateral.frame(in, out); })
+             .addOperation("bicubic", [&](const cv::Mat& in, cv::Mat& out) { bicubic.frame(in, out); })
+             .addOperation("sharpen", [&](const cv::Mat& in, cv::Mat& out) {
+                 sharpen.prepare(in);
+                 rows(sharpen, in, out);
+             })
+             .addOperation("contrast", [&](const cv::Mat& in, cv::Mat& out) { rows(contrast, in, out); })
+             .addOperation("gamma", [&](const cv::Mat& in, cv::Mat& out) { rows(gamma, in, out); })
+             .addOperation("temporal", [&](const cv::Mat& in, cv::Mat& out) { temporal.frame(in, out); });
+
+    cv::Mat input, output;
+    struct Entry {
+        const char* name;
+        std::function<bool()> run;
+    };
+    const Entry entries[] = {
+        {"chain_graded", [&]() { return chain.process(input, output); }},
+        {"processor_graded", [&]() { return processor.process(input, output); }},
+    };
+
+    for (const Entry& entry : entries) {
+        results.emplace_back();
+        BenchResult& result = results.back();
+        result.name = std::string(entry.name) + "/cpu";
+        result.device = "cpu";
+        result.variant = entry.name;
+        result.algorithm = entry.name;
+        runTimed(options, result, [&](int index) { source.frame(index, input); }, entry.run);
+    }
+}
+
+void writeResult(std::ostream& out, const BenchResult& result, bool last) {
+    out << "    {\"name\": \"" << jsonEscape(result.name) << "\""
+        << ", \"device\": \"" << result.device << "\""
+        << ", \"variant\": \"" << jsonEscape(result.variant) << "\""
+        << ", \"algorithm\": \"" << jsonEscape(result.algorithm) << "\""
+        << ", \"ok\": " << (result.ok ? "true" : "false")
+        << ", \"frames\": " << result.latency.count()
+        << ", \"fps\": " << result.fps
+        << ", \"ms\": {\"mean\": " << result.latency.mean()
+        << ", \"p50\": " << result.latency.percentile(50.0)
+        << ", \"p95\": " << result.latency.percentile(95.0)
+        << ", \"p99\": " << result.latency.percentile(99.0)
+        << ", \"max\": " << result.latency.max() << "}"
+        << ", \"peak_rss_mb\": " << result.peak_rss_mb
+        << ", \"peak_gpu_mb\": " << result.peak_gpu_mb
+        << "}" << (last ? "" : ",") << "\n";
+}
+
+void writeJson(std::ostream& out, const BenchOptions& options, const cv::Size& source_size,
+               const std::deque<BenchResult>& configs, const std::deque<BenchResult>& stages) {
+    out << std::fixed << std::setprecision(3);
+    out << "{\n";
+    out << "  \"opencv_version\": \"" << CV_VERSION << "\",\n";
+    out << "  \"threads\": " << cv::getNumThreads() << ",\n";
+    out << "  \"gpu_devices\": " << (Upscaler::isGPUAvailable() ? 1 : 0) << ",\n";
+    out << "  \"input\": \"" << (options.input_path.empty() ? "synthetic" : jsonEscape(options.input_path)) << "\",\n";
+    out << "  \"source\": [" << source_size.width << ", " << source_size.height << "],\n";
+    out << "  \"target\": [" << options.target_size.width << ", " << options.target_size.height << "],\n";
+    out << "  \"frames\": " << options.frames << ",\n";
+    out << "  \"warmup\": " << options.warmup << ",\n";
+    out << "  \"configurations\": [\n";
+    for (size_t i = 0; i < configs.size(); i++) {
+        writeResult(out, configs[i], i + 1 == configs.size());
+    }
+    out << "  ],\n";
+    out << "  \"stages\": [\n";
+    for (size_t i = 0; i < stages.size(); i++) {
+        writeResult(out, stages[i], i + 1 == stages.size());
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+bool parseSize(const std::string& text, cv::Size& size) {
+    int width = 0, height = 0;
+    char separator = 0;
+    std::istringstream iss(text);
+    if (iss >> width >> separator >> height && separator == 'x' && width > 0 && height > 0) {
+        size = cv::Size(width, height);
+        return true;
+    }
+    return false;
+}
+
+void printUsage(const char* program) {
+    std::cout << "Usage: " << program << " [options]" << std::endl;
+    std::cout << "  --frames N        Timed frames per configuration (default 120)" << std::endl;
+    std::cout << "  --warmup N        Untimed frames per configuration (default 10)" << std::endl;
+    std::cout << "  --source WxH      Synthetic input resolution (default 640x360)" << std::endl;
+    std::cout << "  --target WxH      Output resolution (default 1920x1080)" << std::endl;
+    std::cout << "  --input PATH      Use a video clip (or a mapped .vpraw capture) instead of the synthetic input" << std::endl;
+    std::cout << "  --json PATH       Output file (default bench_results.json)" << std::endl;
+    std::cout << "  --cpu-only        Skip GPU configurations" << std::endl;
+    std::cout << "  --gpu-only        Skip CPU configurations" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if (arg == "--frames" && has_value) {
+            options.frames = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--warmup" && has_value) {
+            options.warmup = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--source" && has_value) {
+            if (!parseSize(argv[++i], options.source_size)) {
+                std::cerr << "Invalid --source size" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--target" && has_value) {
+            if (!parseSize(argv[++i], options.target_size)) {
+                std::cerr << "Invalid --target size" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--input" && has_value) {
+            options.input_path = argv[++i];
+        } else if (arg == "--json" && has_value) {
+            options.json_path = argv[++i];
+        } else if (arg == "--cpu-only") {
+            options.gpu = false;
+        } else if (arg == "--gpu-only") {
+            options.cpu = false;
+        } else if (arg == "--help" || arg == "-h") {
+            printUsage(argv[0]);
+            return 0;
+        } else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    FrameSource source(options);
+
+    std::vector<bool> devices;
+    if (options.cpu) {
+        devices.push_back(false);
+    }
+    if (options.gpu && Upscaler::isGPUAvailable()) {
+        devices.push_back(true);
+    }
+
+    const Upscaler::Algorithm algorithms[] = {
+        Upscaler::NEAREST, Upscaler::BILINEAR, Upscaler::BICUBIC,
+        Upscaler::LANCZOS, Upscaler::SUPER_RES, Upscaler::REAL_ESRGAN
+    };
+
+    // Baseline, each enhancement on its own, and the full chain
+    struct Variant {
+        const char* name;
+        bool bilateral, sharpening, temporal;
+    };
+    const Variant variants[] = {
+        {"none", false, false, false},
+        {"selective_bilateral", true, false, false},
+        {"adaptive_sharpening", false, true, false},
+        {"temporal_consistency", false, false, true},
+        {"all", true, true, true},
+    };
+
+    // Results hold a histogram (and its mutex), so they are built in place
+    std::deque<BenchResult> configs;
+    std::deque<BenchResult> stages;
+
+    for (bool use_gpu : devices) {
+        for (Upscaler::Algorithm algorithm : algorithms) {
+            for (const Variant& variant : variants) {
+                BenchConfig config{algorithm, use_gpu, variant.name,
+                                   variant.bilateral, variant.sharpening, variant.temporal};
+                configs.emplace_back();
+                benchUpscaler(options, source, config, configs.back());
+
+                const BenchResult& result = configs.back();
+                if (result.ok) {
+                    std::cout << result.latency.summary(result.name) << " fps=" << result.fps << std::endl;
+                }
+            }
+        }
+
+        benchStages(options, source, use_gpu, stages);
+    }
+
+    if (options.cpu) {
+        benchChains(options, source, stages);
+    }
+
+    std::ofstream json(options.json_path);
+    if (!json.is_open()) {
+        std::cerr << "Failed to open " << options.json_path << std::endl;
+        return 1;
+    }
+    writeJson(json, options, source.size(), configs, stages);
+    std::cout << "Results written to " << options.json_path << std::endl;
+
+    return 0;
+}
@@ -1,21 +1,34 @@
 #include "camera.h"
+#include "yuv_frame.h"
 #include <iostream>
 #include <thread>
 #include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#ifdef WITH_CUDA
+#include <opencv2/cudaimgproc.hpp>
+#include <opencv2/cudawarping.hpp>
+#endif
 
 Camera::Camera(int camera_index) 
-    : width(0), height(0), fps(0), initialized(false), camera_index(camera_index), is_file(false),
-      has_new_frame(false), thread_running(false) {
+    : width(0), height(0), fps(0), initialized(false), camera_index(camera_index), is_file(false) {
 }
 
 Camera::Camera(const std::string& video_source) 
     : width(0), height(0), fps(0), initialized(false), camera_index(-1), 
-      video_source(video_source), is_file(true), has_new_frame(false), thread_running(false) {
+      video_source(video_source), is_file(true) {
 }
 
 Camera::~Camera() {
     // Stop the grabbing thread if it's running
     thread_running = false;
+    {
+        std::lock_guard<std::mutex> lock(frame_mutex);
+        frame_ready.notify_all();
+    }
     if (grab_thread.joinable()) {
         grab_thread.join();
     }
@@ -26,10 +39,61 @@ Camera::~Camera() {
     }
 }
 
-std::vector<int> Camera::listAvailableCameras() {
+std::string Camera::deviceFingerprint() {
+#ifdef __linux__
+    // Node names plus change times: plugging, unplugging or re-enumerating a
+    // device changes the fingerprint and invalidates the cache
+    std::ostringstream fingerprint;
+    for (int i = 0; i < 10; i++) {
+        std::filesystem::path node = "/dev/video" + std::to_string(i);
+        std::error_code ec;
+        auto changed = std::filesystem::last_write_time(node, ec);
+        if (!ec) {
+            fingerprint << i << ":" << changed.time_since_epoch().count() << ";";
+        }
+    }
+    return fingerprint.str().empty() ? std::string("none") : fingerprint.str();
+#else
+    return std::string();
+#endif
+}
+
+std::string Camera::probeCachePath() {
+    const char* xdg = std::getenv("XDG_CACHE_HOME");
+    const char* home = std::getenv("HOME");
+    std::filesystem::path base = xdg && *xdg ? std::filesystem::path(xdg)
+                               : home && *home ? std::filesystem::path(home) / ".cache"
+                               : std::filesystem::temp_directory_path();
+    return (base / "video_processor" / "cameras").string();
+}
+
+std::vector<int> Camera::listAvailableCameras(bool use_cache) {
     std::vector<int> availableCameras;
+    const std::string fingerprint = use_cache ? deviceFingerprint() : std::string();
+    const std::string cache_path = probeCachePath();
+    
+    // Cache format: fingerprint on the first line, then one index per line
+    if (!fingerprint.empty()) {
+        std::ifstream cache(cache_path);
+        std::string cached_fingerprint;
+        if (cache && std::getline(cache, cached_fingerprint) && cached_fingerprint == fingerprint) {
+            int index;
+            while (cache >> index) {
+                availableCameras.push_back(index);
+            }
+            std::cout << "Using cached camera list (" << availableCameras.size() << " found)" << std::endl;
+            return availableCameras;
+        }
+    }
     
     for (int i = 0; i < 10; i++) {
+#ifdef __linux__
+        // No device node, nothing to open
+        std::error_code ec;
+        if (!std::filesystem::exists("/dev/video" + std::to_string(i), ec)) {
+            continue;
+        }
+#endif
         cv::VideoCapture temp(i);
         if (temp.isOpened()) {
             std::cout << "Camera " << i << " is available" << std::endl;
@@ -38,12 +102,120 @@ std::vector<int> Camera::listAvailableCameras() {
         }
     }
     
+    if (!fingerprint.empty()) {
+        std::error_code ec;
+        std::filesystem::create_directories(std::filesystem::path(cache_path).parent_path(), ec);
+        std::ofstream cache(cache_path, std::ios::trunc);
+        if (cache) {
+            cache << fingerprint << "\n";
+            for (int index : availableCameras) {
+                cache << index << "\n";
+            }
+        }
+    }
+    
     return availableCameras;
 }
 
+void Camera::setHardwareDecode(bool enable) {
+    hardware_decode = enable;
+}
+
+void Camera::setMaxOutputSize(const cv::Size& max_size) {
+    max_output = max_size;
+}
+
+void Camera::setDeliverI420(bool enable) {
+    deliver_i420 = enable;
+}
+
+cv::Size Camera::outputSize(int source_width, int source_height) const {
+    if (max_output.empty() || source_width <= 0 || source_height <= 0 ||
+        (source_width <= max_output.width && source_height <= max_output.height)) {
+        if (deliver_i420 && source_width > 1 && source_height > 1) {
+            // I420 subsamples chroma 2x2, so both dimensions must be even
+            return cv::Size(source_width & ~1, source_height & ~1);
+        }
+        return cv::Size(source_width, source_height);
+    }
+    
+    double scale = std::min(static_cast<double>(max_output.width) / source_width,
+                            static_cast<double>(max_output.height) / source_height);
+    cv::Size size(std::max(1, cvRound(source_width * scale)), std::max(1, cvRound(source_height * scale)));
+    if (deliver_i420) {
+        size = cv::Size(std::max(2, size.width & ~1), std::max(2, size.height & ~1));
+    }
+    return size;
+}
+
+bool Camera::initializeGpuDecoder() {
+#if defined(WITH_CUDA) && defined(HAVE_OPENCV_CUDACODEC)
+    if (cv::cuda::getCudaEnabledDeviceCount() == 0) {
+        return false;
+    }
+    
+    try {
+        gpu_reader = cv::cudacodec::createVideoReader(video_source);
+        
+        // Decode one frame to confirm NVDEC supports the codec; it is kept
+        // and handed out by the first getFrame()
+        if (!gpu_reader || !gpu_reader->nextFrame(gpu_decoded) || gpu_decoded.empty()) {
+            std::cout << "NVDEC could not decode " << video_source << ", using CPU decode" << std::endl;
+            gpu_reader.reset();
+            return false;
+        }
+        
+        width = gpu_decoded.cols;
+        height = gpu_decoded.rows;
+        fps = static_cast<int>(gpu_reader->format().fps + 0.5);
+        if (fps <= 0) {
+            // Some containers don't report a rate to the parser; ask the demuxer
+            cv::VideoCapture probe(video_source, cv::CAP_FFMPEG);
+            fps = static_cast<int>(probe.get(cv::CAP_PROP_FPS) + 0.5);
+        }
+        
+        gpu_frame_pending = true;
+        decoded_frames = 0;
+        
+        std::cout << "Successfully opened video file with NVDEC: " << video_source << std::endl;
+        std::cout << "Video properties: " << width << "x" << height << " @ " << fps << " FPS" << std::endl;
+        return true;
+    } catch (const cv::Exception& e) {
+        std::cout << "NVDEC unavailable (" << e.what() << "), using CPU decode" << std::endl;
+        gpu_reader.reset();
+        return false;
+    }
+#else
+    return false;
+#endif
+}
+
 bool Camera::initialize(int w, int h, int framerate) {
+    // Raw files are mapped, not decoded
+    if (is_file && rawfile::isRawFile(video_source)) {
+        raw_reader = std::make_unique<RawFrameReader>();
+        if (!raw_reader->open(video_source) || raw_reader->frameCount() == 0) {
+            std::cerr << "Failed to open raw file: " << video_source << std::endl;
+            raw_reader.reset();
+            return false;
+        }
+        
+        cv::Size stored = raw_reader->frameSize();
+        width = stored.width;
+        height = raw_reader->frameType() == CV_8UC1 ? stored.height * 2 / 3 : stored.height;
+        fps = static_cast<int>(raw_reader->fps() + 0.5);
+        initialized = true;
+        return true;
+    }
+    
     // If this is a video file, use a different approach
     if (is_file) {
+        // Hardware decode keeps frames on the device from the start
+        if (hardware_decode && initializeGpuDecoder()) {
+            initialized = true;
+            return true;
+        }
+        
         // Try to open with FFMPEG backend directly for video files
         cap = std::make_unique<cv::VideoCapture>(video_source, cv::CAP_FFMPEG);
         
@@ -101,6 +273,16 @@ bool Camera::initialize(int w, int h, int framerate) {
         }
     }
     
+    // Ask the camera for the reduced mode so full-size frames are never
+    // transferred; if it can't, frames are scaled at read time
+    cv::Size requested = outputSize(w, h);
+    w = requested.width;
+    h = requested.height;
+    
+    // With I420 delivery the pipelines hand over the planar YUV frame that
+    // videoconvert produces anyway, skipping the conversion to BGR
+    const std::string sink = deliver_i420 ? " ! video/x-raw,format=I420 ! appsink" : " ! appsink";
+    
     // For camera sources, proceed with the original method
     // First, try to query the camera's supported formats
     bool found_suitable_format = false;
@@ -124,7 +306,7 @@ bool Camera::initialize(int w, int h, int framerate) {
             " ! image/jpeg,width=" + std::to_string(w) + 
             ",height=" + std::to_string(h) + 
             ",framerate=" + std::to_string(framerate) + "/1" +
-            " ! jpegdec ! videoconvert ! appsink"
+            " ! jpegdec ! videoconvert" + sink
         });
     }
     
@@ -136,7 +318,7 @@ bool Camera::initialize(int w, int h, int framerate) {
             " ! video/x-h264,width=" + std::to_string(w) + 
             ",height=" + std::to_string(h) + 
             ",framerate=" + std::to_string(framerate) + "/1" +
-            " ! h264parse ! avdec_h264 ! videoconvert ! appsink"
+            " ! h264parse ! avdec_h264 ! videoconvert" + sink
         });
     }
     
@@ -148,7 +330,7 @@ bool Camera::initialize(int w, int h, int framerate) {
             " ! video/x-raw,format=YUY2,width=" + std::to_string(w) + 
             ",height=" + std::to_string(h) + 
             ",framerate=" + std::to_string(framerate) + "/1" +
-            " ! videoconvert ! appsink"
+            " ! videoconvert" + sink
         });
     }
     
@@ -158,7 +340,7 @@ bool Camera::initialize(int w, int h, int framerate) {
         "v4l2src device=/dev/video" + std::to_string(camera_index) + 
         " ! video/x-raw,width=" + std::to_string(w) + 
         ",height=" + std::to_string(h) + 
-        " ! videoconvert ! appsink"
+        " ! videoconvert" + sink
     });
     
     // 5. Add an optimized raw format for better performance
@@ -167,14 +349,15 @@ bool Camera::initialize(int w, int h, int framerate) {
         "v4l2src device=/dev/video" + std::to_string(camera_index) + 
         " ! video/x-raw,width=" + std::to_string(w) + 
         ",height=" + std::to_string(h) + 
-        " ! queue max-size-buffers=5 leaky=downstream ! videoconvert ! video/x-raw,format=BGR ! appsink drop=true"
+        " ! queue max-size-buffers=5 leaky=downstream ! videoconvert ! video/x-raw,format=" +
+        (deliver_i420 ? "I420" : "BGR") + " ! appsink drop=true"
     });
     
     // 6. Final fallback with minimal constraints
     pipeline_configs.push_back({
         "Minimal constraints",
         "v4l2src device=/dev/video" + std::to_string(camera_index) + 
-        " ! videoconvert ! appsink"
+        " ! videoconvert" + sink
     });
     
     // Try each pipeline configuration
@@ -193,9 +376,10 @@ bool Camera::initialize(int w, int h, int framerate) {
                 std::cout << "Successfully opened camera with " << name << std::endl;
                 std::cout << "Frame size: " << test_frame.cols << "x" << test_frame.rows << std::endl;
                 
-                // Store actual dimensions
+                // Store actual dimensions (I420 frames carry the chroma
+                // planes below the luma rows)
                 width = test_frame.cols;
-                height = test_frame.rows;
+                height = test_frame.channels() == 1 ? test_frame.rows * 2 / 3 : test_frame.rows;
                 fps = framerate; // Assume requested framerate
                 
                 initialized = true;
@@ -252,7 +436,6 @@ bool Camera::initialize(int w, int h, int framerate) {
 }
 
 void Camera::grabLoop() {
-    cv::Mat frame;
     int frames_grabbed = 0;
     int frames_dropped = 0;
     
@@ -260,72 +443,345 @@ void Camera::grabLoop() {
     auto start_time = std::chrono::high_resolution_clock::now();
     
     while (thread_running) {
-        if (cap && cap->isOpened()) {
-            // Use grab() which is faster than read()
-            bool grabbed = cap->grab();
-            
-            if (grabbed) {
-                frames_grabbed++;
-                
-                // Only retrieve if we can store it (non-blocking check)
-                std::unique_lock<std::mutex> lock(frame_mutex, std::try_to_lock);
-                if (lock.owns_lock()) {
-                    if (cap->retrieve(frame)) {
-                        if (!frame.empty()) {
-                            frame.copyTo(latest_frame);
-                            has_new_frame = true;
-                        }
-                    }
-                } else {
-                    // Previous frame hasn't been consumed yet
-                    frames_dropped++;
-                }
-                
-                // Print grab rate occasionally
-                if (frames_grabbed % 100 == 0) {
-                    auto current_time = std::chrono::high_resolution_clock::now();
-                    auto elapsed = std::chrono::duration<double>(current_time - start_time).count();
-                    double grab_rate = frames_grabbed / elapsed;
-                    
-                    std::cout << "Background thread: grabbing at " << grab_rate 
-                              << " FPS, dropped " << frames_dropped << " frames" << std::endl;
-                    
-                    // Reset counters
-                    frames_grabbed = 0;
-                    frames_dropped = 0;
-                    start_time = current_time;
-                }
-            }
+        // grab() blocks in the driver until the next frame, so the loop
+        // paces itself; only a failing device needs a pause
+        if (!cap || !cap->isOpened() || !cap->grab()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        frames_grabbed++;
+        
+        // Stamp as close to acquisition as possible; for live cameras the
+        // backend position is the driver's buffer timestamp
+        GrabbedFrame& slot = grab_slots[grab_back];
+        slot.capture_time = FrameMetadata::Clock::now();
+        double source_timestamp = cap->get(cv::CAP_PROP_POS_MSEC);
+        slot.source_timestamp = source_timestamp > 0.0 ? source_timestamp : -1.0;
+        
+        // The reader may still share storage it handed back; decode into a
+        // fresh buffer in that case
+        if (slot.image.u && slot.image.u->refcount > 1) {
+            slot.image.release();
+        }
+        if (!cap->retrieve(slot.image) || slot.image.empty()) {
+            continue;
         }
         
-        // Sleep just enough to avoid burning CPU
-        // Adjust this value if needed - smaller values might give higher FPS
-        // but will use more CPU
-        std::this_thread::sleep_for(std::chrono::microseconds(500));
+        // Publish: the filled slot becomes the middle one and the old middle
+        // slot is the next back buffer. A still-fresh middle slot was never
+        // read and is overwritten.
+        int previous = grab_middle.exchange(grab_back | kFreshSlot);
+        if (previous & kFreshSlot) {
+            frames_dropped++;
+        }
+        grab_back = previous & kSlotMask;
+        
+        // Paired with the sequentially consistent exchange, so a reader about
+        // to wait either sees the fresh slot or is woken
+        if (reader_waiting.load()) {
+            std::lock_guard<std::mutex> lock(frame_mutex);
+            frame_ready.notify_one();
+        }
+        
+        // Print grab rate occasionally
+        if (frames_grabbed % 100 == 0) {
+            auto current_time = std::chrono::high_resolution_clock::now();
+            auto elapsed = std::chrono::duration<double>(current_time - start_time).count();
+            double grab_rate = frames_grabbed / elapsed;
+            
+            std::cout << "Background thread: grabbing at " << grab_rate 
+                      << " FPS, " << frames_dropped << " frames superseded before being read" << std::endl;
+            
+            // Reset counters
+            frames_grabbed = 0;
+            frames_dropped = 0;
+            start_time = current_time;
+        }
     }
     
     std::cout << "Background grab thread exiting" << std::endl;
 }
 
+void Camera::startGrabbing() {
+    if (is_file || thread_running || !initialized || !cap || !cap->isOpened()) {
+        return;
+    }
+    
+    thread_running = true;
+    grab_thread = std::thread(&Camera::grabLoop, this);
+}
+
+bool Camera::takeGrabbedFrame(cv::Mat& frame, FrameMetadata& metadata) {
+    if (!(grab_middle.load() & kFreshSlot)) {
+        return false;
+    }
+    
+    // Hand the front slot back to the grabber and take the fresh one
+    int previous = grab_middle.exchange(grab_front);
+    grab_front = previous & kSlotMask;
+    
+    GrabbedFrame& slot = grab_slots[grab_front];
+    cv::swap(frame, slot.image);
+    metadata.capture_time = slot.capture_time;
+    metadata.source_timestamp_ms = slot.source_timestamp;
+    return true;
+}
+
+bool Camera::waitForFrame(int timeout_ms) {
+    startGrabbing();
+    if (!thread_running) {
+        // Sources read on demand report failures and end of file from
+        // getFrame
+        return true;
+    }
+    
+    if (grab_middle.load() & kFreshSlot) {
+        return true;
+    }
+    
+    reader_waiting.store(true);
+    {
+        std::unique_lock<std::mutex> lock(frame_mutex);
+        frame_ready.wait_for(lock, std::chrono::milliseconds(timeout_ms), [this]() {
+            return (grab_middle.load() & kFreshSlot) || !thread_running;
+        });
+    }
+    reader_waiting.store(false);
+    
+    return (grab_middle.load() & kFreshSlot) != 0;
+}
+
 bool Camera::getFrame(cv::Mat& frame) {
+    FrameMetadata metadata;
+    return getFrame(frame, metadata);
+}
+
+bool Camera::getFrame(cv::Mat& frame, FrameMetadata& metadata) {
+#if defined(WITH_CUDA) && defined(HAVE_OPENCV_CUDACODEC)
+    // Host consumers of an NVDEC source pay one download per frame, of the
+    // already scaled frame
+    if (initialized && gpu_reader) {
+        if (!getFrame(gpu_staging, metadata)) {
+            return false;
+        }
+        if (deliver_i420) {
+            gpu_staging.download(host_scaled);
+            yuv::fromBGR(host_scaled, frame);
+        } else {
+            gpu_staging.download(frame);
+        }
+        return true;
+    }
+#endif
+    
+    if (deliver_i420) {
+        return readI420Frame(frame, metadata);
+    }
+    
+    if (max_output.empty()) {
+        return readHostFrame(frame, metadata);
+    }
+    
+    if (!readHostFrame(host_scaled, metadata)) {
+        return false;
+    }
+    cv::Size size = outputSize(host_scaled.cols, host_scaled.rows);
+    if (size == host_scaled.size()) {
+        host_scaled.copyTo(frame);
+    } else {
+        cv::resize(host_scaled, frame, size, 0, 0, cv::INTER_AREA);
+    }
+    return true;
+}
+
+bool Camera::readI420Frame(cv::Mat& frame, FrameMetadata& metadata) {
+    if (!readHostFrame(host_scaled, metadata)) {
+        return false;
+    }
+    
+    // GStreamer camera pipelines already deliver I420; file decoders and the
+    // plain V4L2 backend deliver BGR, which is converted once here
+    cv::Size source_size = host_scaled.size();
+    if (host_scaled.channels() == 1) {
+        source_size = yuv::frameSize(host_scaled);
+    }
+    cv::Size size = outputSize(source_size.width, source_size.height);
+    
+    if (host_scaled.channels() == 1) {
+        if (size == source_size) {
+            host_scaled.copyTo(frame);
+        } else {
+            yuv::resize(host_scaled, frame, size, cv::INTER_AREA);
+        }
+        return true;
+    }
+    
+    // Scale first so the conversion runs at output size
+    if (size == source_size) {
+        yuv::fromBGR(host_scaled, frame);
+    } else {
+        cv::resize(host_scaled, host_i420, size, 0, 0, cv::INTER_AREA);
+        yuv::fromBGR(host_i420, frame);
+    }
+    return true;
+}
+
+bool Camera::readRawFrame(cv::Mat& frame, FrameMetadata& metadata) {
+    if (deliver_i420 || raw_reader->frameType() != CV_8UC1) {
+        return raw_reader->read(frame, metadata);
+    }
+    
+    // I420 recording replayed as BGR: convert out of the mapping
+    cv::Mat view;
+    if (!raw_reader->read(view, metadata)) {
+        return false;
+    }
+    if (!frame.u) {
+        // Possibly a view on the mapping from an earlier read
+        frame.release();
+    }
+    yuv::toBGR(view, frame);
+    return true;
+}
+
+bool Camera::readHostFrame(cv::Mat& frame, FrameMetadata& metadata) {
+    if (initialized && raw_reader) {
+        return readRawFrame(frame, metadata);
+    }
+    
     if (!initialized || !cap || !cap->isOpened()) {
         return false;
     }
     
-    if (has_new_frame) {
-        std::lock_guard<std::mutex> lock(frame_mutex);
-        if (!latest_frame.empty()) {
-            latest_frame.copyTo(frame);
-            has_new_frame = false;
+    // Live cameras only read through the grab thread
+    startGrabbing();
+    if (thread_running) {
+        return takeGrabbedFrame(frame, metadata);
+    }
+    
+    // Files read on demand so no frame is skipped
+    if (!cap->read(frame)) {
+        return false;
+    }
+    metadata.capture_time = FrameMetadata::Clock::now();
+    metadata.source_timestamp_ms = cap->get(cv::CAP_PROP_POS_MSEC);
+    return true;
+}
+
+#ifdef WITH_CUDA
+bool Camera::getFrame(cv::cuda::GpuMat& frame, FrameMetadata& metadata, cv::cuda::Stream& stream) {
+    if (!initialized) {
+        return false;
+    }
+    
+#if defined(HAVE_OPENCV_CUDACODEC)
+    if (gpu_reader) {
+        try {
+            if (gpu_frame_pending) {
+                gpu_frame_pending = false;
+            } else if (!gpu_reader->nextFrame(gpu_decoded, stream)) {
+                // End of file; dropping the reader lets isOpened() report it
+                gpu_reader.reset();
+                return false;
+            }
+            
+            metadata.capture_time = FrameMetadata::Clock::now();
+            metadata.source_timestamp_ms = fps > 0 ? decoded_frames * 1000.0 / fps : -1.0;
+            decoded_frames++;
+            
+            // Scale before converting so the conversion runs at output size
+            const cv::cuda::GpuMat* decoded = &gpu_decoded;
+            cv::Size size = outputSize(gpu_decoded.cols, gpu_decoded.rows);
+            if (size != gpu_decoded.size()) {
+                cv::cuda::resize(gpu_decoded, device_scaled, size, 0, 0, cv::INTER_AREA, stream);
+                decoded = &device_scaled;
+            }
+            
+            // The decoder's output format depends on the OpenCV version
+            // (BGRA before 4.7), so convert whatever arrives to BGR
+            if (decoded->channels() == 4) {
+                cv::cuda::cvtColor(*decoded, frame, cv::COLOR_BGRA2BGR, 0, stream);
+            } else if (decoded->channels() == 1) {
+                cv::cuda::cvtColor(*decoded, frame, cv::COLOR_GRAY2BGR, 0, stream);
+            } else {
+                decoded->copyTo(frame, stream);
+            }
             return true;
+        } catch (const cv::Exception& e) {
+            std::cerr << "Error in hardware decode: " << e.what() << std::endl;
+            return false;
         }
     }
+#endif
     
-    // Fallback to direct capture if no frame available
-    return cap->read(frame);
+    // CPU decode or live camera: read on the host and upload once, scaling
+    // on the device after the upload rather than on the host
+    if (!readHostFrame(host_staging, metadata)) {
+        return false;
+    }
+    if (host_staging.channels() == 1) {
+        // I420 camera pipeline; device consumers expect BGR
+        yuv::toBGR(host_staging, host_scaled);
+        std::swap(host_staging, host_scaled);
+    }
+    cv::Size size = outputSize(host_staging.cols, host_staging.rows);
+    if (size == host_staging.size()) {
+        frame.upload(host_staging, stream);
+    } else {
+        device_scaled.upload(host_staging, stream);
+        cv::cuda::resize(device_scaled, frame, size, 0, 0, cv::INTER_AREA, stream);
+    }
+    return true;
+}
+#endif
+
+bool Camera::seekFrame(int64_t index) {
+    if (!initialized || !is_file || index < 0) {
+        return false;
+    }
+    
+    if (raw_reader) {
+        return raw_reader->seek(static_cast<uint64_t>(index));
+    }
+    
+#if defined(WITH_CUDA) && defined(HAVE_OPENCV_CUDACODEC)
+    if (gpu_reader) {
+        std::cerr << "Seeking is not supported with hardware decode" << std::endl;
+        return false;
+    }
+#endif
+    
+    return cap && cap->isOpened() && cap->set(cv::CAP_PROP_POS_FRAMES, static_cast<double>(index));
+}
+
+int64_t Camera::getFrameCount() const {
+    if (raw_reader) {
+        return static_cast<int64_t>(raw_reader->frameCount());
+    }
+    if (is_file && cap && cap->isOpened()) {
+        double count = cap->get(cv::CAP_PROP_FRAME_COUNT);
+        return count > 0 ? static_cast<int64_t>(count) : -1;
+    }
+    return -1;
+}
+
+bool Camera::isGpuDecoding() const {
+#if defined(WITH_CUDA) && defined(HAVE_OPENCV_CUDACODEC)
+    return static_cast<bool>(gpu_reader);
+#else
+    return false;
+#endif
 }
 
 bool Camera::isOpened() const {
+    if (raw_reader) {
+        return raw_reader->position() < raw_reader->frameCount();
+    }
+#if defined(WITH_CUDA) && defined(HAVE_OPENCV_CUDACODEC)
+    if (gpu_reader) {
+        return true;
+    }
+#endif
     return (cap && cap->isOpened());
 }
 
@@ -334,11 +790,11 @@ double Camera::getFPS() const {
 }
 
 int Camera::getWidth() const {
-    return width;
+    return outputSize(width, height).width;
 }
 
 int Camera::getHeight() const {
-    return height;
+    return outputSize(width, height).height;
 }
 
 bool Camera::tryBackends() {
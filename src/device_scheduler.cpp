@@ -0,0 +1,353 @@
+#include "device_scheduler.h"
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+DeviceScheduler::DeviceScheduler(const Config& config)
+    : m_config(config),
+      m_start_time(std::chrono::steady_clock::now()),
+      m_running(false) {
+    if (m_config.max_queue_per_device == 0) {
+        m_config.max_queue_per_device = 1;
+    }
+}
+
+DeviceScheduler::~DeviceScheduler() {
+    stop();
+}
+
+bool DeviceScheduler::start() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_running) {
+        return true;
+    }
+
+    std::vector<int> ids = m_config.devices;
+#ifdef WITH_CUDA
+    int device_count = cv::cuda::getCudaEnabledDeviceCount();
+    if (ids.empty()) {
+        for (int i = 0; i < device_count; i++) {
+            ids.push_back(i);
+        }
+    }
+    for (int id : ids) {
+        if (id >= device_count) {
+            std::cerr << "CUDA device " << id << " does not exist" << std::endl;
+            return false;
+        }
+    }
+#endif
+    if (ids.empty()) {
+        std::cout << "No CUDA devices found, scheduling on a single host replica" << std::endl;
+        ids.push_back(-1);
+    }
+
+#ifndef WITH_CUDA
+    // Without CUDA every requested device would be the same host replica
+    ids.assign(1, -1);
+#endif
+
+    m_devices.clear();
+    m_stream_devices.clear();
+    for (int id : ids) {
+        auto device = std::make_unique<Device>();
+        device->id = id;
+        device->name = "host";
+#ifdef WITH_CUDA
+        if (id >= 0) {
+            device->name = cv::cuda::DeviceInfo(id).name();
+        }
+#endif
+        std::string label = id >= 0 ? "gpu" + std::to_string(id) : std::string("host");
+        device->metric = Metrics::instance().registerLatency("scheduler." + label + ".upscale",
+                                                             "Upscaling per frame on one scheduler replica");
+        m_devices.push_back(std::move(device));
+    }
+
+    m_running = true;
+    for (auto& device : m_devices) {
+        device->worker = std::thread(&DeviceScheduler::deviceLoop, this, std::ref(*device));
+    }
+
+    // Replicas load their models in parallel; wait until each has settled
+    m_replica_ready.wait(lock, [this]() {
+        for (const auto& device : m_devices) {
+            if (!device->ready && !device->failed) {
+                return false;
+            }
+        }
+        return true;
+    });
+
+    size_t ready = 0;
+    for (const auto& device : m_devices) {
+        if (device->ready) {
+            std::cout << "Scheduler replica on " << device->name
+                      << (device->id >= 0 ? " (device " + std::to_string(device->id) + ")" : std::string())
+                      << std::endl;
+            ready++;
+        }
+    }
+
+    if (ready == 0) {
+        std::cerr << "No scheduler replica could be initialized" << std::endl;
+        m_running = false;
+        lock.unlock();
+        for (auto& device : m_devices) {
+            device->work_available.notify_all();
+            if (device->worker.joinable()) {
+                device->worker.join();
+            }
+        }
+        lock.lock();
+        m_devices.clear();
+        return false;
+    }
+
+    m_start_time = std::chrono::steady_clock::now();
+    return true;
+}
+
+void DeviceScheduler::stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_running) {
+            return;
+        }
+        m_running = false;
+
+        // Resolve everything still waiting so no caller blocks on a future forever
+        for (auto& device : m_devices) {
+            for (auto& job : device->queue) {
+                dropJob(job, device->id);
+            }
+            device->queue.clear();
+        }
+    }
+
+    m_space_available.notify_all();
+    for (auto& device : m_devices) {
+        device->work_available.notify_all();
+        if (device->worker.joinable()) {
+            device->worker.join();
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_devices.clear();
+    m_stream_devices.clear();
+}
+
+std::future<DeviceScheduler::Result> DeviceScheduler::submit(const cv::Mat& frame, const FrameMetadata& metadata,
+                                                             int stream_id) {
+    Job job;
+    job.frame = frame;
+    job.metadata = metadata;
+    std::future<Result> future = job.promise.get_future();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (!m_running || frame.empty()) {
+        dropJob(job, -1);
+        return future;
+    }
+
+    Device* device = nullptr;
+    m_space_available.wait(lock, [this, &device, stream_id]() {
+        return !m_running || (device = selectDevice(stream_id)) != nullptr;
+    });
+    if (!m_running) {
+        dropJob(job, -1);
+        return future;
+    }
+
+    device->queue.push_back(std::move(job));
+    lock.unlock();
+    device->work_available.notify_one();
+
+    return future;
+}
+
+DeviceScheduler::Device* DeviceScheduler::selectDevice(int stream_id) {
+    if (stream_id >= 0) {
+        auto pinned = m_stream_devices.find(stream_id);
+        if (pinned != m_stream_devices.end()) {
+            Device* device = pinned->second;
+            return device->depth() < m_config.max_queue_per_device ? device : nullptr;
+        }
+    }
+
+    // Expected wait: everything ahead of the frame plus the frame itself,
+    // at the device's recent pace (untimed devices count as 1 ms per frame)
+    Device* best = nullptr;
+    double best_cost = 0.0;
+    for (auto& device : m_devices) {
+        if (!device->ready || device->depth() >= m_config.max_queue_per_device) {
+            continue;
+        }
+
+        double pace = device->ema_ms > 0.0 ? device->ema_ms : 1.0;
+        double cost = (device->depth() + 1) * pace;
+        if (!best || cost < best_cost) {
+            best = device.get();
+            best_cost = cost;
+        }
+    }
+
+    if (best && stream_id >= 0) {
+        m_stream_devices[stream_id] = best;
+    }
+    return best;
+}
+
+void DeviceScheduler::deviceLoop(Device& device) {
+    bool initialized = false;
+    try {
+#ifdef WITH_CUDA
+        // Everything the replica allocates belongs to the device bound here
+        if (device.id >= 0) {
+            cv::cuda::setDevice(device.id);
+        }
+#endif
+        auto upscaler = std::make_unique<Upscaler>(m_config.algorithm, device.id >= 0);
+        initialized = upscaler->initialize(m_config.target_width, m_config.target_height);
+        if (initialized) {
+            device.upscaler = std::move(upscaler);
+        }
+    } catch (const cv::Exception& e) {
+        std::cerr << "Error creating replica on " << device.name << ": " << e.what() << std::endl;
+        initialized = false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        device.ready = initialized;
+        device.failed = !initialized;
+    }
+    m_replica_ready.notify_all();
+    if (!initialized) {
+        return;
+    }
+
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            device.work_available.wait(lock, [this, &device]() {
+                return !m_running || !device.queue.empty();
+            });
+            if (!m_running) {
+                // stop() already resolved whatever was queued
+                break;
+            }
+
+            job = std::move(device.queue.front());
+            device.queue.pop_front();
+            device.running++;
+        }
+
+        Result result;
+        result.frame_id = job.metadata.frame_id;
+        result.metadata = job.metadata;
+        result.source = job.frame;
+        result.device = device.id;
+
+        auto start = Metrics::Clock::now();
+        try {
+            result.success = device.upscaler->upscale(job.frame, result.output) && !result.output.empty();
+        } catch (const cv::Exception& e) {
+            std::cerr << "Error upscaling on " << device.name << ": " << e.what() << std::endl;
+            result.success = false;
+        }
+        result.upscale_ms = Metrics::instance().recordSince(device.metric, start);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            device.running--;
+            device.frames++;
+            device.busy_ms += result.upscale_ms;
+            device.ema_ms = device.frames == 1 ? result.upscale_ms
+                                               : device.ema_ms * 0.8 + result.upscale_ms * 0.2;
+        }
+        m_space_available.notify_all();
+
+        job.promise.set_value(std::move(result));
+    }
+
+    // Release device resources on the thread that is bound to the device
+    device.upscaler.reset();
+}
+
+void DeviceScheduler::dropJob(Job& job, int device) {
+    Result result;
+    result.frame_id = job.metadata.frame_id;
+    result.metadata = job.metadata;
+    result.source = job.frame;
+    result.dropped = true;
+    result.device = device;
+    job.promise.set_value(std::move(result));
+}
+
+size_t DeviceScheduler::capacity() const {
+    return deviceCount() * m_config.max_queue_per_device;
+}
+
+size_t DeviceScheduler::deviceCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t count = 0;
+    for (const auto& device : m_devices) {
+        if (device->ready) {
+            count++;
+        }
+    }
+    return count;
+}
+
+std::vector<DeviceScheduler::DeviceStats> DeviceScheduler::getDeviceStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    double elapsed_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - m_start_time).count();
+
+    std::vector<DeviceStats> stats;
+    for (const auto& device : m_devices) {
+        if (!device->ready) {
+            continue;
+        }
+
+        DeviceStats entry;
+        entry.device = device->id;
+        entry.name = device->name;
+        entry.frames = device->frames;
+        entry.queue_depth = device->depth();
+        entry.mean_ms = device->ema_ms;
+        entry.utilisation = elapsed_ms > 0.0 ? std::min(1.0, device->busy_ms / elapsed_ms) : 0.0;
+        stats.push_back(entry);
+    }
+    return stats;
+}
+
+std::string DeviceScheduler::toTable() const {
+    std::ostringstream out;
+    out << std::left << std::setw(24) << "Device" << " | "
+        << std::right << std::setw(10) << "Frames" << " | "
+        << std::setw(6) << "Queue" << " | "
+        << std::setw(10) << "Avg (ms)" << " | "
+        << std::setw(8) << "Busy" << "\n";
+    out << std::string(70, '-') << "\n";
+
+    out << std::fixed << std::setprecision(1);
+    for (const DeviceStats& entry : getDeviceStats()) {
+        std::string label = entry.device >= 0 ? std::to_string(entry.device) + ": " + entry.name : entry.name;
+        out << std::left << std::setw(24) << label.substr(0, 24) << " | "
+            << std::right << std::setw(10) << entry.frames << " | "
+            << std::setw(6) << entry.queue_depth << " | "
+            << std::setw(10) << entry.mean_ms << " | "
+            << std::setw(7) << entry.utilisation * 100.0 << "%" << "\n";
+    }
+    return out.str();
+}
+
+bool DeviceScheduler::isRunning() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_running;
+}
@@ -3,19 +3,23 @@
 #include <iomanip>
 #include <thread>
 
-Display::Display(int width, int height)
+Display::Display(int width, int height, Backend backend)
     : m_width(width),
       m_height(height),
+      m_backend(backend),
       m_show_metrics(true),
       m_vsync_enabled(false),
       m_max_fps(60),
       m_last_render_time(0.0),
-      m_current_fps(0.0) {
+      m_current_fps(0.0),
+      m_last_key(-1),
+      m_overlay_dirty(false) {
     
     // Calculate frame interval in microseconds based on max FPS
     m_frame_interval = std::chrono::microseconds(static_cast<int>(1000000.0 / m_max_fps));
     m_next_frame_time = std::chrono::high_resolution_clock::now();
     m_last_frame_time = m_next_frame_time;
+    m_overlay_time = m_next_frame_time - std::chrono::milliseconds(kOverlayIntervalMs);
 }
 
 Display::~Display() {
@@ -25,6 +29,27 @@ Display::~Display() {
 bool Display::initialize(const std::string& window_name) {
     m_window_name = window_name;
     
+    if (m_backend == HEADLESS) {
+        std::cout << "Display initialized headless (frames are not shown)" << std::endl;
+        return true;
+    }
+    
+    if (m_backend == OPENGL) {
+        try {
+            cv::namedWindow(m_window_name, cv::WINDOW_OPENGL | cv::WINDOW_NORMAL);
+            cv::resizeWindow(m_window_name, m_width, m_height);
+            cv::setOpenGlDrawCallback(m_window_name, &Display::drawTexture, this);
+            
+            std::cout << "Display initialized with OpenGL: " << m_width << "x" << m_height 
+                      << " @ " << m_max_fps << " FPS" << std::endl;
+            return true;
+        }
+        catch (const cv::Exception& e) {
+            std::cout << "OpenGL display unavailable (" << e.what() << "), using HighGUI" << std::endl;
+            m_backend = HIGHGUI;
+        }
+    }
+    
     // Create window with OpenCV
     try {
         cv::namedWindow(m_window_name, cv::WINDOW_NORMAL);
@@ -57,11 +82,60 @@ bool Display::renderFrame(const cv::Mat& frame) {
     // Start timing the render operation
     m_display_timer.start("render");
     
-    // Clone the frame to avoid modifying the original if showing metrics
+    bool success = true;
+    if (m_backend == OPENGL) {
+        success = showTexture(frame);
+    } else if (m_backend == HIGHGUI) {
+        success = showHost(frame);
+    }
+    
+    finishRender();
+    return success;
+}
+
+#ifdef WITH_CUDA
+bool Display::renderFrame(const cv::cuda::GpuMat& frame) {
+    std::lock_guard<std::mutex> lock(m_render_mutex);
+    
+    if (frame.empty()) {
+        std::cerr << "Warning: Attempted to render empty frame" << std::endl;
+        return false;
+    }
+    
+    limitFrameRate();
+    m_display_timer.start("render");
+    
+    bool success = true;
+    if (m_backend == OPENGL) {
+        success = showTexture(frame);
+    } else if (m_backend == HIGHGUI) {
+        // imshow needs host memory
+        try {
+            frame.download(m_host_staging);
+            success = showHost(m_host_staging);
+        }
+        catch (const cv::Exception& e) {
+            std::cerr << "Error downloading frame for display: " << e.what() << std::endl;
+            success = false;
+        }
+    }
+    
+    finishRender();
+    return success;
+}
+#endif
+
+bool Display::showHost(const cv::Mat& frame) {
+    // Only the HUD region is written, but the caller's frame is never
+    // modified, so showing metrics costs one copy of the frame
     cv::Mat display_frame;
     if (m_show_metrics) {
         frame.copyTo(display_frame);
-        drawPerformanceOverlay(display_frame);
+        updateOverlay();
+        cv::Rect roi = overlayRect(display_frame.size());
+        if (!roi.empty() && display_frame.type() == m_overlay.type()) {
+            m_overlay(cv::Rect(0, 0, roi.width, roi.height)).copyTo(display_frame(roi));
+        }
     } else {
         display_frame = frame;
     }
@@ -69,24 +143,96 @@ bool Display::renderFrame(const cv::Mat& frame) {
     // Display the frame
     try {
         cv::imshow(m_window_name, display_frame);
+        pollKey();
+    }
+    catch (const cv::Exception& e) {
+        std::cerr << "Error rendering frame: " << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool Display::showTexture(cv::InputArray frame) {
+    try {
+        // The texture belongs to the window's context, which must be current
+        // on the rendering thread
+        cv::setOpenGlContext(m_window_name);
+        m_frame_texture.copyFrom(frame);
+        
+        if (m_show_metrics && (updateOverlay() || m_overlay_dirty)) {
+            m_overlay_texture.copyFrom(m_overlay);
+            m_overlay_dirty = false;
+        }
         
-        // Process window events (short wait to allow GUI to update)
-        cv::waitKey(1);
+        cv::updateWindow(m_window_name);
+        pollKey();
     }
     catch (const cv::Exception& e) {
         std::cerr << "Error rendering frame: " << e.what() << std::endl;
-        m_display_timer.stop("render");
         return false;
     }
+    return true;
+}
+
+void Display::drawTexture(void* userdata) {
+    Display* self = static_cast<Display*>(userdata);
+    if (self->m_frame_texture.empty()) {
+        return;
+    }
+    
+    cv::ogl::render(self->m_frame_texture);
     
+    // The HUD keeps its pixel size in the bottom-left corner of the frame
+    if (self->m_show_metrics && !self->m_overlay_texture.empty()) {
+        const cv::Size frame_size = self->m_frame_texture.size();
+        const cv::Rect roi = self->overlayRect(frame_size);
+        if (!roi.empty()) {
+            cv::ogl::render(self->m_overlay_texture,
+                            cv::Rect_<double>(static_cast<double>(roi.x) / frame_size.width,
+                                              static_cast<double>(roi.y) / frame_size.height,
+                                              static_cast<double>(roi.width) / frame_size.width,
+                                              static_cast<double>(roi.height) / frame_size.height),
+                            cv::Rect_<double>(0.0, 0.0,
+                                              static_cast<double>(roi.width) / self->m_overlay.cols,
+                                              static_cast<double>(roi.height) / self->m_overlay.rows));
+        }
+    }
+}
+
+void Display::pollKey() {
+    // Process window events (short wait to allow GUI to update)
+    int key = cv::waitKey(1);
+    if (key >= 0) {
+        m_last_key.store(key);
+    }
+}
+
+void Display::finishRender() {
     // Stop timing and record
     m_display_timer.stop("render");
     m_last_render_time = m_display_timer.getDuration("render");
     
     // Update FPS calculation
     updateFPS();
+}
+
+void Display::processEvents() {
+    std::lock_guard<std::mutex> lock(m_render_mutex);
     
-    return true;
+    if (m_backend == HEADLESS) {
+        return;
+    }
+    
+    try {
+        pollKey();
+    }
+    catch (const cv::Exception& e) {
+        std::cerr << "Error processing window events: " << e.what() << std::endl;
+    }
+}
+
+int Display::takeLastKey() {
+    return m_last_key.exchange(-1);
 }
 
 void Display::showPerformanceMetrics(bool show) {
@@ -94,6 +240,10 @@ void Display::showPerformanceMetrics(bool show) {
 }
 
 void Display::cleanup() {
+    if (m_backend == HEADLESS) {
+        return;
+    }
+    
     try {
         cv::destroyWindow(m_window_name);
     }
@@ -130,7 +280,13 @@ double Display::getCurrentFPS() const {
     return m_current_fps.load();
 }
 
-void Display::drawPerformanceOverlay(cv::Mat& frame) {
+bool Display::updateOverlay() {
+    auto now = std::chrono::high_resolution_clock::now();
+    if (!m_overlay.empty() && now - m_overlay_time < std::chrono::milliseconds(kOverlayIntervalMs)) {
+        return false;
+    }
+    m_overlay_time = now;
+    
     // Add display statistics
     std::stringstream fps_ss;
     fps_ss << std::fixed << std::setprecision(1) << "Display FPS: " << m_current_fps.load();
@@ -140,15 +296,24 @@ void Display::drawPerformanceOverlay(cv::Mat& frame) {
     render_ss << std::fixed << std::setprecision(2) << "Render time: " << m_last_render_time << " ms";
     std::string render_text = render_ss.str();
     
-    // Draw background rectangle for better readability
-    cv::Rect bg_rect(10, frame.rows - 80, 300, 70);
-    cv::rectangle(frame, bg_rect, cv::Scalar(0, 0, 0), -1);
+    // Background panel for better readability; the layer is the panel
+    m_overlay.create(70, 300, CV_8UC3);
+    m_overlay.setTo(cv::Scalar(0, 0, 0));
     
     // Draw text with information
-    cv::putText(frame, fps_text, cv::Point(20, frame.rows - 50), 
+    cv::putText(m_overlay, fps_text, cv::Point(10, 30), 
                cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(0, 255, 0), 2);
-    cv::putText(frame, render_text, cv::Point(20, frame.rows - 20), 
+    cv::putText(m_overlay, render_text, cv::Point(10, 60), 
                cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(0, 255, 0), 2);
+    
+    m_overlay_dirty = true;
+    return true;
+}
+
+cv::Rect Display::overlayRect(const cv::Size& frame_size) const {
+    // Same placement the HUD always had: 10 px in, its bottom 10 px up
+    cv::Rect roi(10, frame_size.height - 80, m_overlay.cols, m_overlay.rows);
+    return roi & cv::Rect(0, 0, frame_size.width, frame_size.height);
 }
 
 void Display::updateFPS() {
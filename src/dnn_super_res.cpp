@@ -1,4 +1,34 @@
 #include "dnn_super_res.h"
+#include "tensorrt_engine.h"
+#include "trace.h"
+#include <filesystem>
+#include <vector>
+
+namespace {
+DnnSuperRes::Precision g_default_precision = DnnSuperRes::PRECISION_FP32;
+DnnSuperRes::InferenceBackend g_default_backend = DnnSuperRes::BACKEND_OPENCV;
+bool g_default_incremental = false;
+}
+
+void DnnSuperRes::setDefaultPrecision(Precision precision) {
+    g_default_precision = precision;
+}
+
+void DnnSuperRes::setDefaultInferenceBackend(InferenceBackend backend) {
+    g_default_backend = backend;
+}
+
+void DnnSuperRes::setDefaultIncremental(bool enable) {
+    g_default_incremental = enable;
+}
+
+DnnSuperRes::Precision DnnSuperRes::getDefaultPrecision() {
+    return g_default_precision;
+}
+
+DnnSuperRes::InferenceBackend DnnSuperRes::getDefaultInferenceBackend() {
+    return g_default_backend;
+}
 
 DnnSuperRes::DnnSuperRes(const std::string& model_path, 
                         const std::string& model_name, 
@@ -9,13 +39,221 @@ DnnSuperRes::DnnSuperRes(const std::string& model_path,
     m_scale(scale),
     m_initialized(false),
     m_use_gpu(true),
+    m_on_gpu(false),
+    m_precision(g_default_precision),
+    m_backend(g_default_backend),
+    m_engine_cache_dir("models/engine_cache"),
+    m_on_openvino(false),
+    m_int8(false),
     m_target_width(0),
     m_target_height(0),
-    m_model_type(type) {
+    m_model_type(type),
+    m_tile_size(128),
+    m_tile_overlap(16),
+    m_tile_batch(4),
+    m_incremental(g_default_incremental),
+    m_change_threshold(3.0),
+    m_refresh_interval(60),
+    m_frames_since_refresh(0),
+    m_prev_scale(0),
+    m_reused_fraction(0.0),
+    m_memory("sr_workspace", MemoryBudget::HOST),
+    m_workspace_frames(0) {
+}
+
+size_t DnnSuperRes::estimateWorkspaceBytes(const cv::Size& input, size_t frames) const {
+    // Float activations alive at once, per input pixel. RRDBNet keeps its
+    // widest dense-block concat (192 channels) and two residuals at input
+    // resolution plus 64 channels at 2x and 4x after the upsampling convs;
+    // EDSR and LapSRN carry 64 channels at input and output scale; FSRCNN
+    // and ESPCN a few dozen channels at input resolution only.
+    const size_t s2 = static_cast<size_t>(m_scale) * m_scale;
+    size_t channels;
+    switch (m_model_type) {
+        case REAL_ESRGAN:
+            channels = 192 + 2 * 64 + 64 * 4 + 64 * s2 + 3 * s2;
+            break;
+        case EDSR:
+        case LAPSRN:
+            channels = 3 * 64 + 64 * s2;
+            break;
+        case FSRCNN:
+        case ESPCN:
+        default:
+            channels = 2 * 56 + 4 * 12 + s2;
+            break;
+    }
+    
+    size_t pixels = static_cast<size_t>(input.area());
+    if (m_model_type == REAL_ESRGAN && m_tile_size > 0 &&
+        (input.width > m_tile_size || input.height > m_tile_size)) {
+        pixels = static_cast<size_t>(m_tile_size) * m_tile_size;
+        frames = static_cast<size_t>(m_tile_batch);
+    }
+    return pixels * frames * channels * sizeof(float);
+}
+
+void DnnSuperRes::fitWorkspace(const cv::Size& input, size_t frames) {
+    if (input == m_workspace_input && frames == m_workspace_frames) {
+        return;
+    }
+    m_workspace_input = input;
+    m_workspace_frames = frames;
+    
+    const MemoryBudget::Pool pool = m_on_gpu ? MemoryBudget::DEVICE : MemoryBudget::HOST;
+    MemoryBudget& budget = MemoryBudget::instance();
+    m_memory.setPool(pool);
+    m_memory.set(0);
+    const size_t available = budget.available(pool);
+    
+    // Only RealESRGAN can trade speed for memory; the other models run
+    // whole frames and are just accounted
+    if (m_model_type == REAL_ESRGAN && estimateWorkspaceBytes(input, frames) > available) {
+        const int tile_size = m_tile_size;
+        const int tile_batch = m_tile_batch;
+        if (m_tile_size == 0 || (input.width <= m_tile_size && input.height <= m_tile_size)) {
+            m_tile_size = std::max(64, std::min(512, std::max(input.width, input.height) / 2));
+        }
+        while (estimateWorkspaceBytes(input, frames) > available && (m_tile_batch > 1 || m_tile_size > 64)) {
+            if (m_tile_batch > 1) {
+                m_tile_batch = std::max(1, m_tile_batch / 2);
+            } else {
+                m_tile_size = std::max(64, m_tile_size / 2);
+            }
+        }
+        if (m_tile_size != tile_size || m_tile_batch != tile_batch) {
+            // Incremental history indexes the old tile grid
+            m_prev_input.release();
+            m_prev_output.release();
+            std::cout << "Memory budget: RealESRGAN tiles reduced from " << tile_size << "px x" << tile_batch
+                      << " to " << m_tile_size << "px x" << m_tile_batch << std::endl;
+        }
+    }
+    m_memory.set(estimateWorkspaceBytes(input, frames));
+}
+
+void DnnSuperRes::setIncremental(bool enable, double threshold, int refresh_interval) {
+    m_incremental = enable;
+    m_change_threshold = std::max(0.0, threshold);
+    m_refresh_interval = std::max(1, refresh_interval);
+    m_frames_since_refresh = 0;
+    m_prev_scale = 0;
+    m_reused_fraction = 0.0;
+    m_prev_input.release();
+    m_prev_output.release();
+}
+
+bool DnnSuperRes::tileChanged(const cv::Mat& float_rgb, const cv::Rect& tile) const {
+    // The halo catches changes just outside the tile that still reach it
+    // through the network's receptive field
+    cv::Rect region(tile.x - m_tile_overlap, tile.y - m_tile_overlap,
+                    tile.width + 2 * m_tile_overlap, tile.height + 2 * m_tile_overlap);
+    region &= cv::Rect(0, 0, float_rgb.cols, float_rgb.rows);
+    
+    double sad = cv::norm(float_rgb(region), m_prev_input(region), cv::NORM_L1);
+    return sad / (region.area() * 3.0) * 255.0 >= m_change_threshold;
+}
+
+DnnSuperRes::~DnnSuperRes() = default;
+
+int DnnSuperRes::cudaTarget() {
+    if (m_precision == PRECISION_FP16) {
+        auto targets = cv::dnn::getAvailableTargets(cv::dnn::DNN_BACKEND_CUDA);
+        if (std::find(targets.begin(), targets.end(), cv::dnn::DNN_TARGET_CUDA_FP16) != targets.end()) {
+            return cv::dnn::DNN_TARGET_CUDA_FP16;
+        }
+        std::cout << "CUDA FP16 target unavailable, using FP32" << std::endl;
+        m_precision = PRECISION_FP32;
+    }
+    return cv::dnn::DNN_TARGET_CUDA;
+}
+
+std::string DnnSuperRes::getInferenceDescription() const {
+    if (!m_on_gpu) {
+        return m_on_openvino ? (m_int8 ? "OpenVINO INT8" : "OpenVINO FP32") : "CPU";
+    }
+    std::string engine = "CUDA";
+#ifdef WITH_TENSORRT
+    if (m_trt) {
+        engine = "TensorRT";
+    }
+#endif
+    return engine + (m_precision == PRECISION_FP16 ? " FP16" : " FP32");
+}
+
+cv::Mat DnnSuperRes::forwardNet(const cv::Mat& blob) {
+    TraceScope span("sr.forward");
+#ifdef WITH_TENSORRT
+    if (m_trt) {
+        cv::Mat output;
+        if (m_trt->forward(blob, output)) {
+            return output;
+        }
+        std::cerr << "TensorRT inference failed, falling back to OpenCV DNN" << std::endl;
+        m_trt.reset();
+    }
+#endif
+    m_net.setInput(blob);
+    return m_net.forward();
+}
+
+bool DnnSuperRes::isOpenVINOAvailable() {
+    auto backends = cv::dnn::getAvailableBackends();
+    return std::find(backends.begin(), backends.end(),
+                     std::make_pair(cv::dnn::DNN_BACKEND_INFERENCE_ENGINE, cv::dnn::DNN_TARGET_CPU)) != backends.end();
+}
+
+void DnnSuperRes::setCpuBackend(cv::dnn::Net& net) const {
+    net.setPreferableBackend(m_on_openvino ? cv::dnn::DNN_BACKEND_INFERENCE_ENGINE : cv::dnn::DNN_BACKEND_OPENCV);
+    net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+}
+
+bool DnnSuperRes::loadInt8Model() {
+    const std::filesystem::path model(m_model_path);
+    const std::filesystem::path dir = m_int8_dir.empty() ? model.parent_path() / "int8" : std::filesystem::path(m_int8_dir);
+    const std::filesystem::path xml = dir / (model.stem().string() + ".xml");
+    const std::filesystem::path bin = dir / (model.stem().string() + ".bin");
+    if (!std::filesystem::exists(xml) || !std::filesystem::exists(bin)) {
+        std::cerr << "INT8 model not found: " << xml.string() << " (build the int8_models target)" << std::endl;
+        return false;
+    }
+    
+    try {
+        cv::dnn::Net net = cv::dnn::readNet(xml.string(), bin.string());
+        if (net.empty()) {
+            std::cerr << "Failed to load INT8 model: " << xml.string() << std::endl;
+            return false;
+        }
+        setCpuBackend(net);
+        m_batch_net = net;
+        std::cout << "Using INT8 model " << xml.string() << std::endl;
+        return true;
+    } catch (const cv::Exception& e) {
+        std::cerr << "Failed to load INT8 model: " << e.what() << std::endl;
+        return false;
+    }
 }
 
 bool DnnSuperRes::initialize() {
     try {
+        m_on_gpu = m_use_gpu && cv::cuda::getCudaEnabledDeviceCount() > 0;
+        m_batch_net = cv::dnn::Net();
+        m_int8 = false;
+        
+        // OpenVINO only replaces the CPU path; with a GPU the CUDA (or
+        // TensorRT) path stays in charge
+        m_on_openvino = false;
+        if (!m_on_gpu && m_backend == BACKEND_OPENVINO) {
+            m_on_openvino = isOpenVINOAvailable();
+            if (!m_on_openvino) {
+                std::cout << "OpenVINO backend not available in this OpenCV build, using the default CPU backend" << std::endl;
+            }
+        }
+        if (m_precision == PRECISION_INT8 && !m_on_openvino) {
+            std::cout << "INT8 inference needs the OpenVINO backend on the CPU, using FP32" << std::endl;
+            m_precision = PRECISION_FP32;
+        }
+        
         if (m_model_type == REAL_ESRGAN) {
             // Load ONNX model
             std::cout << "Loading ONNX model: " << m_model_path << std::endl;
@@ -27,14 +265,38 @@ bool DnnSuperRes::initialize() {
                 return false;
             }
             
-            if (m_use_gpu && cv::cuda::getCudaEnabledDeviceCount() > 0) {
+#ifdef WITH_TENSORRT
+            m_trt.reset();
+#endif
+            if (m_on_gpu) {
                 std::cout << "Using CUDA backend for ONNX super-resolution" << std::endl;
                 m_net.setPreferableBackend(cv::dnn::DNN_BACKEND_CUDA);
-                m_net.setPreferableTarget(cv::dnn::DNN_TARGET_CUDA);
+                m_net.setPreferableTarget(cudaTarget());
+                
+                if (m_backend == BACKEND_TENSORRT) {
+#ifdef WITH_TENSORRT
+                    // Engines are built per input shape on first use; cv::dnn stays as the fallback
+                    m_trt = std::make_unique<TensorRTEngine>(m_model_path, m_engine_cache_dir,
+                                                             m_precision == PRECISION_FP16);
+                    if (m_trt->initialize()) {
+                        std::cout << "Using TensorRT for ONNX super-resolution, engine cache: "
+                                  << m_engine_cache_dir << std::endl;
+                    } else {
+                        std::cerr << "TensorRT unavailable, using OpenCV DNN" << std::endl;
+                        m_trt.reset();
+                    }
+#else
+                    std::cout << "TensorRT support not built, using OpenCV DNN" << std::endl;
+#endif
+                }
             } else {
-                std::cout << "Using CPU backend for ONNX super-resolution" << std::endl;
-                m_net.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
-                m_net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+                std::cout << "Using " << (m_on_openvino ? "OpenVINO" : "CPU")
+                          << " backend for ONNX super-resolution" << std::endl;
+                setCpuBackend(m_net);
+                if (m_precision == PRECISION_INT8) {
+                    std::cout << "No INT8 variant of RealESRGAN, using FP32" << std::endl;
+                    m_precision = PRECISION_FP32;
+                }
             }
             
             // Very important - explicitly set initialized flag
@@ -44,10 +306,41 @@ bool DnnSuperRes::initialize() {
             m_sr.readModel(m_model_path);
             m_sr.setModel(m_model_name, m_scale);
             
-            if (m_use_gpu && cv::cuda::getCudaEnabledDeviceCount() > 0) {
+            if (m_on_gpu) {
                 std::cout << "Using CUDA backend for super-resolution" << std::endl;
                 m_sr.setPreferableBackend(cv::dnn::DNN_BACKEND_CUDA);
-                m_sr.setPreferableTarget(cv::dnn::DNN_TARGET_CUDA);
+                m_sr.setPreferableTarget(cudaTarget());
+            } else if (m_on_openvino) {
+                std::cout << "Using OpenVINO backend for super-resolution" << std::endl;
+                m_sr.setPreferableBackend(cv::dnn::DNN_BACKEND_INFERENCE_ENGINE);
+                m_sr.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+            }
+            
+            // dnn_superres only upsamples one image at a time, so keep the
+            // bare graph as well for batched inference (the weights are tiny)
+            if (m_model_type == FSRCNN || m_model_type == ESPCN) {
+                try {
+                    m_batch_net = cv::dnn::readNet(m_model_path);
+                    if (m_on_gpu) {
+                        m_batch_net.setPreferableBackend(cv::dnn::DNN_BACKEND_CUDA);
+                        m_batch_net.setPreferableTarget(cudaTarget());
+                    } else {
+                        setCpuBackend(m_batch_net);
+                    }
+                } catch (const cv::Exception& e) {
+                    std::cerr << "Batched inference unavailable: " << e.what() << std::endl;
+                    m_batch_net = cv::dnn::Net();
+                }
+            }
+            
+            // The quantised IR replaces the luma graph, which then also
+            // serves single images (dnn_superres only reads the .pb)
+            if (m_precision == PRECISION_INT8) {
+                m_int8 = (m_model_type == FSRCNN || m_model_type == ESPCN) && loadInt8Model();
+                if (!m_int8) {
+                    std::cout << "INT8 variant unavailable for " << m_model_path << ", using FP32" << std::endl;
+                    m_precision = PRECISION_FP32;
+                }
             }
             
             m_initialized = true;
@@ -73,6 +366,7 @@ bool DnnSuperRes::upscale(const cv::Mat& input, cv::Mat& output) {
         std::cerr << "Input image is empty" << std::endl;
         return false;
     }
+    fitWorkspace(input.size(), 1);
     
     try {
         // Start timing
@@ -82,9 +376,16 @@ bool DnnSuperRes::upscale(const cv::Mat& input, cv::Mat& output) {
         if (m_model_type == REAL_ESRGAN) {
             // Use ONNX-based upscaling for RealESRGAN
             return upscaleRealESRGAN(input, output);
-        } else {
+        } else if (!m_int8 || input.type() != CV_8UC3) {
             // Original upscaling code for other models
+            TraceScope span("sr.forward");
             m_sr.upsample(input, output);
+        } else {
+            std::vector<cv::Mat> outputs;
+            if (!forwardLumaBatch({input}, outputs, 0)) {
+                return false;
+            }
+            output = outputs.front();
         }
         
         // Resize to target dimensions if specified
@@ -114,6 +415,139 @@ bool DnnSuperRes::upscale(const cv::Mat& input, cv::Mat& output) {
     }
 }
 
+bool DnnSuperRes::upscaleBatch(const std::vector<cv::Mat>& inputs, std::vector<cv::Mat>& outputs,
+                               size_t pad_to) {
+    outputs.resize(inputs.size());
+    if (!m_initialized) {
+        std::cerr << "Super-resolution model not initialized" << std::endl;
+        return false;
+    }
+    if (inputs.empty()) {
+        return true;
+    }
+    
+    bool batchable = !m_batch_net.empty() && (inputs.size() > 1 || pad_to > 1);
+    for (const cv::Mat& input : inputs) {
+        if (input.empty() || input.type() != CV_8UC3 || input.size() != inputs.front().size()) {
+            batchable = false;
+            break;
+        }
+    }
+    
+    if (batchable) {
+        fitWorkspace(inputs.front().size(), std::max(inputs.size(), pad_to));
+        try {
+            if (forwardLumaBatch(inputs, outputs, pad_to)) {
+                return true;
+            }
+        }
+        catch (const cv::Exception& e) {
+            std::cerr << "Error in batched super-resolution: " << e.what() << std::endl;
+        }
+    }
+    
+    // One image at a time (also the fallback for a failed batch)
+    bool success = true;
+    for (size_t i = 0; i < inputs.size(); i++) {
+        success = upscale(inputs[i], outputs[i]) && success;
+    }
+    return success;
+}
+
+bool DnnSuperRes::forwardLumaBatch(const std::vector<cv::Mat>& inputs, std::vector<cv::Mat>& outputs,
+                                   size_t pad_to) {
+    outputs.resize(inputs.size());
+    
+    // FSRCNN and ESPCN work on luma only; chroma is upscaled bicubically,
+    // the same reconstruction dnn_superres does for a single image
+    std::vector<cv::Mat> ycrcb(inputs.size());
+    std::vector<cv::Mat> luma;
+    luma.reserve(std::max(inputs.size(), pad_to));
+    cv::Mat y;
+    for (size_t i = 0; i < inputs.size(); i++) {
+        cv::cvtColor(inputs[i], ycrcb[i], cv::COLOR_BGR2YCrCb);
+        cv::extractChannel(ycrcb[i], y, 0);
+        luma.emplace_back();
+        y.convertTo(luma.back(), CV_32F, 1.0 / 255.0);
+    }
+    while (luma.size() < pad_to) {
+        luma.push_back(luma.back());
+    }
+    
+    TraceScope forward_span("sr.forward");
+    m_batch_net.setInput(cv::dnn::blobFromImages(luma));
+    cv::Mat outBlob = m_batch_net.forward();
+    forward_span.end();
+    
+    // Expected 4D: [N, 1, H*scale, W*scale]
+    if (outBlob.dims != 4 || outBlob.size[0] < static_cast<int>(inputs.size()) || outBlob.size[1] != 1) {
+        std::cerr << "Unexpected model output format for batched inference" << std::endl;
+        return false;
+    }
+    
+    const cv::Size out_size(outBlob.size[3], outBlob.size[2]);
+    const bool resize_to_target = m_target_width > 0 && m_target_height > 0 &&
+        out_size != cv::Size(m_target_width, m_target_height);
+    
+    cv::Mat y_out, upscaled;
+    for (size_t i = 0; i < inputs.size(); i++) {
+        cv::Mat plane(out_size, CV_32F, outBlob.ptr<float>(static_cast<int>(i), 0));
+        plane.convertTo(y_out, CV_8U, 255.0);
+        cv::resize(ycrcb[i], upscaled, out_size, 0, 0, cv::INTER_CUBIC);
+        cv::insertChannel(y_out, upscaled, 0);
+        cv::cvtColor(upscaled, outputs[i], cv::COLOR_YCrCb2BGR);
+        
+        if (resize_to_target) {
+            cv::resize(outputs[i], outputs[i], cv::Size(m_target_width, m_target_height), 
+                      0, 0, cv::INTER_LANCZOS4);
+        }
+    }
+    return true;
+}
+
+bool DnnSuperRes::upscaleLuma(const cv::Mat& luma, cv::Mat& output) {
+    if (!m_initialized || m_batch_net.empty()) {
+        std::cerr << "Luma super-resolution requires an initialized FSRCNN or ESPCN model" << std::endl;
+        return false;
+    }
+    if (luma.empty() || luma.type() != CV_8UC1) {
+        std::cerr << "Luma super-resolution requires an 8-bit single-channel plane" << std::endl;
+        return false;
+    }
+    fitWorkspace(luma.size(), 1);
+    
+    try {
+        cv::Mat y;
+        luma.convertTo(y, CV_32F, 1.0 / 255.0);
+        TraceScope forward_span("sr.forward");
+        m_batch_net.setInput(cv::dnn::blobFromImage(y));
+        cv::Mat outBlob = m_batch_net.forward();
+        forward_span.end();
+        
+        // Expected 4D: [1, 1, H*scale, W*scale]
+        if (outBlob.dims != 4 || outBlob.size[1] != 1) {
+            std::cerr << "Unexpected model output format for luma inference" << std::endl;
+            return false;
+        }
+        
+        const cv::Size out_size(outBlob.size[3], outBlob.size[2]);
+        const cv::Size target(m_target_width, m_target_height);
+        cv::Mat plane(out_size, CV_32F, outBlob.ptr<float>(0, 0));
+        if (m_target_width > 0 && m_target_height > 0 && out_size != target) {
+            cv::Mat y_out;
+            plane.convertTo(y_out, CV_8U, 255.0);
+            cv::resize(y_out, output, target, 0, 0, cv::INTER_LANCZOS4);
+        } else {
+            plane.convertTo(output, CV_8U, 255.0);
+        }
+        return true;
+    }
+    catch (const cv::Exception& e) {
+        std::cerr << "Error in luma super-resolution: " << e.what() << std::endl;
+        return false;
+    }
+}
+
 bool DnnSuperRes::upscaleRealESRGAN(const cv::Mat& input, cv::Mat& output) {
     try {
         // Print input size for debugging
@@ -127,48 +561,55 @@ bool DnnSuperRes::upscaleRealESRGAN(const cv::Mat& input, cv::Mat& output) {
         cv::Mat floatImg;
         rgb.convertTo(floatImg, CV_32F, 1.0/255.0);
         
-        // Create blob in NCHW format (batch, channels, height, width)
-        cv::Mat inputBlob = cv::dnn::blobFromImage(floatImg);
-        std::cout << "Input blob shape: ";
-        for (int i = 0; i < inputBlob.dims; i++) {
-            std::cout << inputBlob.size[i] << " ";
-        }
-        std::cout << std::endl;
+        cv::Mat processedRgb;
+        
+        if (m_tile_size > 0 && (floatImg.cols > m_tile_size || floatImg.rows > m_tile_size)) {
+            // Bounded-memory path: batched overlapping tiles
+            if (!forwardTiled(floatImg, processedRgb)) {
+                return false;
+            }
+        } else {
+            // Create blob in NCHW format (batch, channels, height, width)
+            cv::Mat inputBlob = cv::dnn::blobFromImage(floatImg);
+            std::cout << "Input blob shape: ";
+            for (int i = 0; i < inputBlob.dims; i++) {
+                std::cout << inputBlob.size[i] << " ";
+            }
+            std::cout << std::endl;
         
-        // 2. Run inference
-        m_net.setInput(inputBlob);
-        cv::Mat outBlob = m_net.forward();
+            // 2. Run inference
+            cv::Mat outBlob = forwardNet(inputBlob);
         
-        // 3. Post-process: Convert back to image format
-        std::cout << "Output blob shape: ";
-        for (int i = 0; i < outBlob.dims; i++) {
-            std::cout << outBlob.size[i] << " ";
-        }
-        std::cout << std::endl;
+            // 3. Post-process: Convert back to image format
+            std::cout << "Output blob shape: ";
+            for (int i = 0; i < outBlob.dims; i++) {
+                std::cout << outBlob.size[i] << " ";
+            }
+            std::cout << std::endl;
         
-        // Extract dimensions - expected 4D: [1, 3, H*4, W*4]
-        if (outBlob.dims != 4) {
-            std::cerr << "Unexpected model output format" << std::endl;
-            return false;
-        }
+            // Extract dimensions - expected 4D: [1, 3, H*4, W*4]
+            if (outBlob.dims != 4) {
+                std::cerr << "Unexpected model output format" << std::endl;
+                return false;
+            }
         
-        int channels = outBlob.size[1];
-        int height = outBlob.size[2];
-        int width = outBlob.size[3];
+            int channels = outBlob.size[1];
+            int height = outBlob.size[2];
+            int width = outBlob.size[3];
         
-        // Create a Mat object from the blob
-        std::vector<cv::Mat> outputChannels;
+            // Create a Mat object from the blob
+            std::vector<cv::Mat> outputChannels;
         
-        // For each channel in the output
-        for (int c = 0; c < channels; c++) {
-            // Get pointer to this channel's data
-            cv::Mat channel(height, width, CV_32F, (float*)outBlob.ptr(0, c));
-            outputChannels.push_back(channel);
-        }
+            // For each channel in the output
+            for (int c = 0; c < channels; c++) {
+                // Get pointer to this channel's data
+                cv::Mat channel(height, width, CV_32F, (float*)outBlob.ptr(0, c));
+                outputChannels.push_back(channel);
+            }
         
-        // Merge the channels back into a color image
-        cv::Mat processedRgb;
-        cv::merge(outputChannels, processedRgb);
+            // Merge the channels back into a color image
+            cv::merge(outputChannels, processedRgb);
+        }
         
         // Convert back to 0-255 range and to 8-bit
         processedRgb = processedRgb * 255.0;
@@ -254,3 +695,163 @@ void DnnSuperRes::postProcessRealESRGAN(const cv::Mat& processed, cv::Mat& outpu
     // Convert RGB back to BGR
     cv::cvtColor(result, output, cv::COLOR_RGB2BGR);
 }
+
+bool DnnSuperRes::forwardTiled(const cv::Mat& float_rgb, cv::Mat& output) {
+    const int tile_w = std::min(m_tile_size, float_rgb.cols);
+    const int tile_h = std::min(m_tile_size, float_rgb.rows);
+    
+    // Tile origins along one axis; every tile has the same size so a batch
+    // forms a single NCHW blob, and the last tile is pulled back inside the image
+    auto tileOffsets = [this](int length, int tile) {
+        std::vector<int> offsets;
+        const int stride = std::max(1, tile - m_tile_overlap);
+        for (int pos = 0; ; pos += stride) {
+            if (pos + tile >= length) {
+                offsets.push_back(std::max(0, length - tile));
+                break;
+            }
+            offsets.push_back(pos);
+        }
+        return offsets;
+    };
+    
+    std::vector<cv::Rect> tiles;
+    for (int y : tileOffsets(float_rgb.rows, tile_h)) {
+        for (int x : tileOffsets(float_rgb.cols, tile_w)) {
+            tiles.emplace_back(x, y, tile_w, tile_h);
+        }
+    }
+    
+    // Incremental mode only sends changed tiles to the network
+    const bool have_history = m_incremental && m_prev_scale > 0 && m_prev_input.size() == float_rgb.size() &&
+                              m_frames_since_refresh + 1 < m_refresh_interval;
+    std::vector<size_t> infer;
+    std::vector<size_t> reuse;
+    for (size_t t = 0; t < tiles.size(); t++) {
+        if (have_history && !tileChanged(float_rgb, tiles[t])) {
+            reuse.push_back(t);
+        } else {
+            infer.push_back(t);
+        }
+    }
+    m_frames_since_refresh = have_history ? m_frames_since_refresh + 1 : 0;
+    m_reused_fraction = static_cast<double>(reuse.size()) / tiles.size();
+    
+    cv::Mat accum, weight_sum;
+    int scale = 0;
+    auto allocate = [&](int tile_scale) {
+        scale = tile_scale;
+        accum = cv::Mat::zeros(float_rgb.rows * scale, float_rgb.cols * scale, CV_32FC3);
+        weight_sum = cv::Mat::zeros(accum.size(), CV_32FC3);
+        buildTileWeight(cv::Size(tile_w * scale, tile_h * scale), m_tile_overlap * scale);
+    };
+    if (have_history) {
+        allocate(m_prev_scale);
+    }
+    
+    std::vector<cv::Mat> batch;
+    batch.reserve(m_tile_batch);
+    
+    for (size_t first = 0; first < infer.size(); first += m_tile_batch) {
+        const size_t count = std::min(infer.size() - first, static_cast<size_t>(m_tile_batch));
+        
+        // Pad the last batch by repeating its final tile so the blob shape
+        // never changes between forward() calls
+        batch.clear();
+        for (int i = 0; i < m_tile_batch; i++) {
+            batch.push_back(float_rgb(tiles[infer[first + std::min(static_cast<size_t>(i), count - 1)]]));
+        }
+        
+        cv::Mat outBlob = forwardNet(cv::dnn::blobFromImages(batch));
+        
+        // Expected 4D: [N, 3, tile_h*scale, tile_w*scale]
+        if (outBlob.dims != 4 || outBlob.size[0] < static_cast<int>(count) || outBlob.size[1] != 3) {
+            std::cerr << "Unexpected model output format for tiled inference" << std::endl;
+            return false;
+        }
+        
+        const int out_h = outBlob.size[2];
+        const int out_w = outBlob.size[3];
+        
+        if (scale == 0) {
+            int tile_scale = out_w / tile_w;
+            if (tile_scale <= 0 || out_h != tile_h * tile_scale) {
+                std::cerr << "Model output does not match an integer tile scale" << std::endl;
+                return false;
+            }
+            allocate(tile_scale);
+        }
+        
+        for (size_t i = 0; i < count; i++) {
+            std::vector<cv::Mat> planes;
+            for (int c = 0; c < 3; c++) {
+                planes.emplace_back(out_h, out_w, CV_32F, outBlob.ptr<float>(static_cast<int>(i), c));
+            }
+            cv::Mat tile_out;
+            cv::merge(planes, tile_out);
+            
+            const cv::Rect& src = tiles[infer[first + i]];
+            cv::Rect dst(src.x * scale, src.y * scale, out_w, out_h);
+            cv::Mat accum_roi = accum(dst);
+            cv::Mat weight_roi = weight_sum(dst);
+            cv::accumulateProduct(tile_out, m_tile_weight, accum_roi);
+            cv::accumulate(m_tile_weight, weight_roi);
+        }
+    }
+    
+    // Reused tiles contribute last frame's output with the same weights, so
+    // seams between reused and re-inferred tiles blend as in a full pass
+    for (size_t t : reuse) {
+        cv::Rect dst(tiles[t].x * scale, tiles[t].y * scale, tile_w * scale, tile_h * scale);
+        cv::Mat accum_roi = accum(dst);
+        cv::Mat weight_roi = weight_sum(dst);
+        cv::accumulateProduct(m_prev_output(dst), m_tile_weight, accum_roi);
+        cv::accumulate(m_tile_weight, weight_roi);
+    }
+    
+    // Normalize by the accumulated weights to blend the overlaps
+    cv::divide(accum, weight_sum, output);
+    
+    if (m_incremental) {
+        // Reference input moves only where the network ran, so slow changes
+        // below the threshold still add up to a re-inference eventually
+        if (!have_history) {
+            float_rgb.copyTo(m_prev_input);
+        } else {
+            for (size_t t : infer) {
+                float_rgb(tiles[t]).copyTo(m_prev_input(tiles[t]));
+            }
+        }
+        output.copyTo(m_prev_output);
+        m_prev_scale = scale;
+    }
+    return true;
+}
+
+void DnnSuperRes::buildTileWeight(const cv::Size& tile_size, int ramp) {
+    if (m_tile_weight.size() == tile_size) {
+        return;
+    }
+    
+    // Linear ramp towards each edge; strictly positive so pixels covered by a
+    // single tile (image borders) normalize back to the tile value
+    auto ramp_weight = [ramp](int i, int length) {
+        if (ramp <= 0) {
+            return 1.0f;
+        }
+        int distance = std::min(i, length - 1 - i);
+        return std::min(1.0f, (distance + 1.0f) / (ramp + 1.0f));
+    };
+    
+    cv::Mat weight(tile_size, CV_32F);
+    for (int y = 0; y < tile_size.height; y++) {
+        float wy = ramp_weight(y, tile_size.height);
+        float* row = weight.ptr<float>(y);
+        for (int x = 0; x < tile_size.width; x++) {
+            row[x] = wy * ramp_weight(x, tile_size.width);
+        }
+    }
+    
+    cv::Mat planes[] = {weight, weight, weight};
+    cv::merge(planes, 3, m_tile_weight);
+}
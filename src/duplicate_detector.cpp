@@ -0,0 +1,176 @@
+#include "duplicate_detector.h"
+#include <iostream>
+
+#ifdef WITH_CUDA
+#include <opencv2/cudaimgproc.hpp>
+#include <opencv2/cudawarping.hpp>
+#endif
+
+DuplicateDetector::DuplicateDetector()
+    : DuplicateDetector(Config()) {
+}
+
+DuplicateDetector::DuplicateDetector(const Config& config)
+    : m_config(config),
+      m_has_pending(false) {
+    m_metric_previous = Metrics::instance().registerCounter(
+        "dedup.previous_hits", "Frames reusing the previous result");
+    m_metric_cached = Metrics::instance().registerCounter(
+        "dedup.cache_hits", "Frames reusing an older cached result");
+}
+
+void DuplicateDetector::setConfig(const Config& config) {
+    m_config = config;
+    reset();
+}
+
+void DuplicateDetector::reset() {
+    m_entries.clear();
+    m_has_pending = false;
+    m_stats = Stats();
+}
+
+uint64_t DuplicateDetector::hashSignature(const cv::Mat& signature) {
+    // FNV-1a over the top four bits of every thumbnail pixel
+    uint64_t hash = 1469598103934665603ULL;
+    for (int y = 0; y < signature.rows; y++) {
+        const uchar* row = signature.ptr<uchar>(y);
+        for (int x = 0; x < signature.cols; x++) {
+            hash = (hash ^ (row[x] >> 4)) * 1099511628211ULL;
+        }
+    }
+    return hash;
+}
+
+DuplicateDetector::Entry* DuplicateDetector::match(int input_type, const cv::Size& input_size, bool device) {
+    m_stats.checked++;
+    const uint64_t hash = hashSignature(m_signature);
+    const double limit = static_cast<double>(m_config.threshold) * m_signature.total();
+
+    for (size_t i = 0; i < m_entries.size(); i++) {
+        Entry& entry = m_entries[i];
+#ifdef WITH_CUDA
+        bool has_output = device ? !entry.device_output.empty() : !entry.host_output.empty();
+#else
+        bool has_output = !device && !entry.host_output.empty();
+#endif
+        if (!has_output || entry.input_type != input_type || entry.input_size != input_size) {
+            continue;
+        }
+
+        // The previous input is compared directly; older ones only when
+        // their hash matches, so near-duplicates of them may be missed
+        if (i > 0 && entry.hash != hash) {
+            continue;
+        }
+        if (cv::norm(m_signature, entry.signature, cv::NORM_L1) > limit) {
+            continue;
+        }
+
+        if (i == 0) {
+            m_stats.previous_hits++;
+            Metrics::instance().add(m_metric_previous);
+            return &m_entries.front();
+        }
+
+        m_stats.cache_hits++;
+        Metrics::instance().add(m_metric_cached);
+        Entry hit = std::move(entry);
+        m_entries.erase(m_entries.begin() + i);
+        m_entries.push_front(std::move(hit));
+        return &m_entries.front();
+    }
+
+    return nullptr;
+}
+
+void DuplicateDetector::setPending(int input_type, const cv::Size& input_size) {
+    m_pending = Entry();
+    m_pending.hash = hashSignature(m_signature);
+    m_pending.input_type = input_type;
+    m_pending.input_size = input_size;
+    m_pending.signature = m_signature.clone();
+    m_has_pending = true;
+}
+
+DuplicateDetector::Entry& DuplicateDetector::pushPending() {
+    m_entries.push_front(std::move(m_pending));
+    m_has_pending = false;
+    while (m_entries.size() > m_config.cache_entries + 1) {
+        m_entries.pop_back();
+    }
+    return m_entries.front();
+}
+
+bool DuplicateDetector::lookup(const cv::Mat& input, cv::Mat& output) {
+    m_has_pending = false;
+    if (input.empty() || input.depth() != CV_8U) {
+        return false;
+    }
+
+    try {
+        cv::resize(input, m_scaled, m_config.signature_size, 0, 0, cv::INTER_AREA);
+        if (m_scaled.channels() == 3) {
+            cv::cvtColor(m_scaled, m_signature, cv::COLOR_BGR2GRAY);
+        } else if (m_scaled.channels() == 4) {
+            cv::cvtColor(m_scaled, m_signature, cv::COLOR_BGRA2GRAY);
+        } else {
+            m_scaled.copyTo(m_signature);
+        }
+
+        if (Entry* entry = match(input.type(), input.size(), false)) {
+            entry->host_output.copyTo(output);
+            return true;
+        }
+        setPending(input.type(), input.size());
+    } catch (const cv::Exception& e) {
+        std::cerr << "Error in duplicate check: " << e.what() << std::endl;
+    }
+    return false;
+}
+
+void DuplicateDetector::store(const cv::Mat& output) {
+    if (!m_has_pending || output.empty()) {
+        return;
+    }
+    output.copyTo(pushPending().host_output);
+}
+
+#ifdef WITH_CUDA
+bool DuplicateDetector::lookup(const cv::cuda::GpuMat& input, cv::cuda::GpuMat& output,
+                               cv::cuda::Stream& stream) {
+    m_has_pending = false;
+    if (input.empty() || input.depth() != CV_8U) {
+        return false;
+    }
+
+    try {
+        cv::cuda::resize(input, m_d_scaled, m_config.signature_size, 0, 0, cv::INTER_AREA, stream);
+        if (m_d_scaled.channels() == 3) {
+            cv::cuda::cvtColor(m_d_scaled, m_d_signature, cv::COLOR_BGR2GRAY, 0, stream);
+        } else if (m_d_scaled.channels() == 4) {
+            cv::cuda::cvtColor(m_d_scaled, m_d_signature, cv::COLOR_BGRA2GRAY, 0, stream);
+        } else {
+            m_d_scaled.copyTo(m_d_signature, stream);
+        }
+        m_d_signature.download(m_signature, stream);
+        stream.waitForCompletion();
+
+        if (Entry* entry = match(input.type(), input.size(), true)) {
+            entry->device_output.copyTo(output, stream);
+            return true;
+        }
+        setPending(input.type(), input.size());
+    } catch (const cv::Exception& e) {
+        std::cerr << "Error in device duplicate check: " << e.what() << std::endl;
+    }
+    return false;
+}
+
+void DuplicateDetector::store(const cv::cuda::GpuMat& output, cv::cuda::Stream& stream) {
+    if (!m_has_pending || output.empty()) {
+        return;
+    }
+    output.copyTo(pushPending().device_output, stream);
+}
+#endif
@@ -0,0 +1,152 @@
+#include "frame_arena.h"
+#include <algorithm>
+
+FrameArena::FrameArena()
+    : m_frame_allocations(0),
+      m_host_memory("arena", MemoryBudget::HOST),
+      m_device_memory("arena", MemoryBudget::DEVICE) {
+    Metrics& metrics = Metrics::instance();
+    m_metric_allocations = metrics.registerCounter("arena.allocations",
+                                                   "Frame arena buffer (re)allocations");
+    m_metric_filters = metrics.registerCounter("arena.filter_creations",
+                                               "Device filters created by frame arenas");
+}
+
+cv::Mat& FrameArena::host(const char* name, cv::Size size, int type) {
+    auto it = m_host.find(name);
+    if (it == m_host.end()) {
+        it = m_host.emplace(name, cv::Mat()).first;
+    }
+
+    cv::Mat& buffer = it->second;
+    if (buffer.size() != size || buffer.type() != type) {
+        buffer.create(size, type);
+        countAllocation(m_stats.host_allocations);
+    }
+    return buffer;
+}
+
+#ifdef WITH_CUDA
+cv::Mat& FrameArena::pinned(const char* name, cv::Size size, int type) {
+    auto it = m_pinned.find(name);
+    if (it == m_pinned.end()) {
+        it = m_pinned.emplace(name, PinnedBuffer()).first;
+    }
+
+    PinnedBuffer& buffer = it->second;
+    if (buffer.header.size() != size || buffer.header.type() != type) {
+        buffer.header.release();
+        buffer.memory = cv::cuda::HostMem(size, type, cv::cuda::HostMem::PAGE_LOCKED);
+        buffer.header = buffer.memory.createMatHeader();
+        countAllocation(m_stats.pinned_allocations);
+    }
+    return buffer.header;
+}
+
+cv::cuda::GpuMat& FrameArena::device(const char* name, cv::Size size, int type) {
+    auto it = m_device.find(name);
+    if (it == m_device.end()) {
+        it = m_device.emplace(name, cv::cuda::GpuMat()).first;
+    }
+
+    cv::cuda::GpuMat& buffer = it->second;
+    if (buffer.size() != size || buffer.type() != type) {
+        buffer.create(size, type);
+        countAllocation(m_stats.device_allocations);
+    }
+    return buffer;
+}
+
+cv::cuda::GpuMat& FrameArena::scratch(cv::cuda::Stream& stream, cv::Size size, int type, int slot) {
+    ScratchKey key(stream.cudaPtr(), size.height, size.width, type, slot);
+    auto it = m_scratch.find(key);
+    if (it == m_scratch.end()) {
+        it = m_scratch.emplace(key, ScratchEntry{cv::cuda::GpuMat(size, type), 0}).first;
+        countAllocation(m_stats.device_allocations);
+    }
+    it->second.last_used = m_stats.frames;
+    return it->second.buffer;
+}
+
+std::array<double, FrameArena::MAX_FILTER_PARAMS> FrameArena::packParams(std::initializer_list<double> params) {
+    std::array<double, MAX_FILTER_PARAMS> key;
+    key.fill(0.0);
+    std::copy_n(params.begin(), std::min(params.size(), MAX_FILTER_PARAMS), key.begin());
+    return key;
+}
+
+void FrameArena::countFilterCreation() {
+    m_stats.filter_creations++;
+    m_frame_allocations++;
+    Metrics::instance().add(m_metric_filters);
+}
+#endif
+
+void FrameArena::countAllocation(uint64_t& counter) {
+    counter++;
+    m_frame_allocations++;
+    Metrics::instance().add(m_metric_allocations);
+}
+
+void FrameArena::endFrame() {
+    bool released = false;
+#ifdef WITH_CUDA
+    // Sizes and streams that stopped coming would otherwise be held forever
+    for (auto it = m_scratch.begin(); it != m_scratch.end();) {
+        if (m_stats.frames - it->second.last_used >= SCRATCH_IDLE_FRAMES) {
+            it = m_scratch.erase(it);
+            m_stats.scratch_releases++;
+            released = true;
+        } else {
+            ++it;
+        }
+    }
+#endif
+
+    // Held bytes only change when something was (re)allocated or released
+    if (m_frame_allocations > 0 || released) {
+        Stats stats = getStats();
+        m_host_memory.set(stats.host_bytes);
+        m_device_memory.set(stats.device_bytes);
+    }
+    
+    m_stats.last_frame_allocations = m_frame_allocations;
+    m_stats.frames++;
+    m_frame_allocations = 0;
+}
+
+FrameArena::Stats FrameArena::getStats() const {
+    Stats stats = m_stats;
+    stats.host_bytes = 0;
+    stats.device_bytes = 0;
+
+    for (const auto& entry : m_host) {
+        stats.host_bytes += entry.second.total() * entry.second.elemSize();
+    }
+#ifdef WITH_CUDA
+    for (const auto& entry : m_pinned) {
+        stats.host_bytes += entry.second.header.total() * entry.second.header.elemSize();
+    }
+    for (const auto& entry : m_device) {
+        stats.device_bytes += entry.second.rows * entry.second.step;
+    }
+    for (const auto& entry : m_scratch) {
+        stats.device_bytes += entry.second.buffer.rows * entry.second.buffer.step;
+    }
+#endif
+    return stats;
+}
+
+void FrameArena::clear() {
+    m_host.clear();
+#ifdef WITH_CUDA
+    m_pinned.clear();
+    m_device.clear();
+    m_scratch.clear();
+    m_filters.clear();
+#endif
+    m_stats = Stats();
+    m_frame_allocations = 0;
+    m_host_memory.set(0);
+    m_device_memory.set(0);
+}
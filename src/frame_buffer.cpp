@@ -1,81 +1,229 @@
 #include "frame_buffer.h"
+#include "thread_placement.h"
 #include <iostream>
+#include <algorithm>
+
+#ifdef WITH_CUDA
+#include "gpu_utils.h"
+#endif
 
 FrameBuffer::FrameBuffer(size_t capacity)
-    : m_capacity(capacity),
+    : m_capacity(std::max<size_t>(capacity, 1)),
+      m_page_locked(false),
+      m_policy(BLOCK),
+      m_max_age(0),
+      m_dropped(0),
+      m_metric_dropped(Metrics::INVALID_ID),
+      m_memory("buffer", MemoryBudget::HOST),
       m_head(0),
       m_tail(0),
-      m_size(0) {
-    // Pre-allocate frames with empty Mats
-    m_frames.resize(capacity);
+      m_producer_waiting(false),
+      m_consumer_waiting(false),
+      m_closed(false) {
+    // Slots are allocated lazily by the first push into each one
+    m_frames.resize(m_capacity);
+    m_metadata.resize(m_capacity);
+    m_push_times.resize(m_capacity);
+}
+
+FrameBuffer::FrameBuffer(size_t capacity, const cv::Size& frame_size, int type, bool page_locked)
+    : FrameBuffer(capacity) {
+#ifdef WITH_CUDA
+    m_page_locked = page_locked && cv::cuda::getCudaEnabledDeviceCount() > 0;
+#else
+    (void)page_locked;
+#endif
+    reserve(frame_size, type);
 }
 
 bool FrameBuffer::pushFrame(const cv::Mat& frame, bool blocking) {
+    return pushFrame(frame, FrameMetadata(), blocking);
+}
+
+bool FrameBuffer::pushFrame(const cv::Mat& frame, const FrameMetadata& metadata, bool blocking) {
     if (frame.empty()) {
         std::cerr << "Warning: Attempting to push empty frame to buffer" << std::endl;
         return false;
     }
-    
-    std::unique_lock<std::mutex> lock(m_mutex);
-    
-    if (full()) {
-        if (!blocking) {
+
+    if (m_closed.load()) {
+        return false;
+    }
+
+    if (m_policy == DROP_OLDEST || m_policy == MAX_AGE) {
+        return pushEvicting(frame, metadata);
+    }
+
+    const size_t head = m_head.load(std::memory_order_relaxed);
+
+    if (head - m_tail.load(std::memory_order_acquire) >= m_capacity) {
+        if (!blocking || m_policy == DROP_NEWEST) {
+            recordDrop();
             return false;
         }
-        
-        // Wait until buffer has space
-        m_not_full.wait(lock, [this]() { return !full(); });
-    }
-    
-    // If the buffer is getting full, optimize memory usage
-    if (m_size > m_capacity * 0.8) {
-        // Use existing memory when possible to reduce allocations
-        frame.copyTo(m_frames[m_head], cv::noArray());
-    } else {
-        // Otherwise use standard copy
-        frame.copyTo(m_frames[m_head]);
-    }
-    
-    // Update head position
-    m_head = nextIndex(m_head);
-    m_size++;
-    
-    // Notify consumers that buffer is not empty
-    m_not_empty.notify_one();
-    
+
+        // Slow path: wait until the consumer frees a slot
+        m_producer_waiting.store(true);
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_not_full.wait(lock, [this, head]() {
+                return head - m_tail.load() < m_capacity || m_closed.load();
+            });
+        }
+        m_producer_waiting.store(false);
+
+        if (head - m_tail.load() >= m_capacity) {
+            return false;
+        }
+    }
+
+    writeSlot(head, frame, metadata);
+
+    // Publish the frame to the consumer
+    m_head.store(head + 1);
+    notify(m_consumer_waiting, m_not_empty);
+
     return true;
 }
 
 bool FrameBuffer::popFrame(cv::Mat& frame, bool blocking) {
+    FrameMetadata metadata;
+    return popFrame(frame, metadata, blocking);
+}
+
+bool FrameBuffer::popFrame(cv::Mat& frame, FrameMetadata& metadata, bool blocking) {
+    if (m_policy == DROP_OLDEST || m_policy == MAX_AGE) {
+        return popEvicting(frame, metadata, blocking);
+    }
+
+    const size_t tail = m_tail.load(std::memory_order_relaxed);
+
+    if (m_head.load(std::memory_order_acquire) == tail) {
+        if (!blocking) {
+            return false;
+        }
+
+        // Slow path: wait until the producer publishes a frame
+        m_consumer_waiting.store(true);
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_not_empty.wait(lock, [this, tail]() { return m_head.load() != tail || m_closed.load(); });
+        }
+        m_consumer_waiting.store(false);
+
+        if (m_head.load() == tail) {
+            return false;
+        }
+    }
+
+    // Hand the slot to the consumer and recycle the consumer's previous storage
+    cv::swap(frame, m_frames[slotIndex(tail)]);
+    metadata = m_metadata[slotIndex(tail)];
+
+    // Release the slot to the producer
+    m_tail.store(tail + 1);
+    notify(m_producer_waiting, m_not_full);
+
+    return true;
+}
+
+bool FrameBuffer::pushEvicting(const cv::Mat& frame, const FrameMetadata& metadata) {
+    const size_t head = m_head.load(std::memory_order_relaxed);
+
+    // Evict the oldest frame when full. Moving tail from the producer is what
+    // makes these policies take the mutex: the consumer advances it under
+    // the same lock, so the evicted slot can't be mid-pop.
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const size_t tail = m_tail.load();
+        if (head - tail >= m_capacity) {
+            m_tail.store(tail + 1);
+            recordDrop();
+        }
+    }
+
+    // The slot at head isn't published, so the copy needs no lock
+    writeSlot(head, frame, metadata);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_head.store(head + 1);
+        m_not_empty.notify_one();
+    }
+
+    return true;
+}
+
+bool FrameBuffer::popEvicting(cv::Mat& frame, FrameMetadata& metadata, bool blocking) {
     std::unique_lock<std::mutex> lock(m_mutex);
-    
-    if (empty()) {
+
+    if (m_head.load() == m_tail.load()) {
         if (!blocking) {
             return false;
         }
-        
-        // Wait until buffer has data
-        m_not_empty.wait(lock, [this]() { return !empty(); });
-    }
-    
-    // Get frame at tail (zero-copy assignment using cv::Mat reference counting)
-    frame = m_frames[m_tail];
-    
-    // Set the buffer slot to empty to allow its memory to be reclaimed if needed
-    m_frames[m_tail] = cv::Mat();
-    
-    // Update tail position
-    m_tail = nextIndex(m_tail);
-    m_size--;
-    
-    // Notify producers that buffer is not full
-    m_not_full.notify_one();
-    
+        m_not_empty.wait(lock, [this]() { return m_head.load() != m_tail.load() || m_closed.load(); });
+        if (m_head.load() == m_tail.load()) {
+            return false;
+        }
+    }
+
+    size_t tail = m_tail.load();
+    const size_t head = m_head.load();
+
+    if (m_policy == MAX_AGE) {
+        // Skip stale frames, but always keep the newest one
+        const auto now = FrameMetadata::Clock::now();
+        size_t stale = 0;
+        while (head - tail > 1 && isStale(tail, now)) {
+            ++tail;
+            ++stale;
+        }
+        if (stale > 0) {
+            recordDrop(stale);
+        }
+    }
+
+    cv::swap(frame, m_frames[slotIndex(tail)]);
+    metadata = m_metadata[slotIndex(tail)];
+    m_tail.store(tail + 1);
+
     return true;
 }
 
+bool FrameBuffer::isStale(size_t counter, FrameMetadata::TimePoint now) const {
+    const FrameMetadata& metadata = m_metadata[slotIndex(counter)];
+    const FrameMetadata::TimePoint origin = metadata.capture_time != FrameMetadata::TimePoint()
+        ? metadata.capture_time
+        : m_push_times[slotIndex(counter)];
+    return now - origin > m_max_age;
+}
+
+void FrameBuffer::setDropPolicy(DropPolicy policy, double max_age_ms) {
+    m_policy = policy;
+    m_max_age = std::chrono::duration_cast<FrameMetadata::Clock::duration>(
+        std::chrono::duration<double, std::milli>(std::max(max_age_ms, 0.0)));
+}
+
+void FrameBuffer::setName(const std::string& name) {
+    m_metric_dropped = Metrics::instance().registerCounter(
+        "buffer." + name + ".dropped", "Frames rejected or evicted by the " + name + " buffer");
+    m_memory.rename("buffer." + name);
+}
+
+uint64_t FrameBuffer::droppedFrames() const {
+    return m_dropped.load(std::memory_order_relaxed);
+}
+
+void FrameBuffer::recordDrop(uint64_t count) {
+    m_dropped.fetch_add(count, std::memory_order_relaxed);
+    Metrics::instance().add(m_metric_dropped, count);
+}
+
 size_t FrameBuffer::size() const {
-    return m_size.load();
+    // Read tail first: head only grows, so the difference never underflows
+    const size_t tail = m_tail.load(std::memory_order_acquire);
+    const size_t head = m_head.load(std::memory_order_acquire);
+    return head - tail;
 }
 
 bool FrameBuffer::empty() const {
@@ -90,22 +238,96 @@ size_t FrameBuffer::capacity() const {
     return m_capacity;
 }
 
-void FrameBuffer::clear() {
-    std::unique_lock<std::mutex> lock(m_mutex);
-    
-    // Clear all frames
+size_t FrameBuffer::capacityForBytes(size_t bytes, const cv::Size& frame_size, int type) {
+    const size_t frame_bytes = MemoryBudget::frameBytes(frame_size, type);
+    return frame_bytes > 0 ? std::max<size_t>(bytes / frame_bytes, 1) : 1;
+}
+
+void FrameBuffer::reserve(const cv::Size& frame_size, int type) {
     for (auto& frame : m_frames) {
-        frame.release();
+        if (frame.u && frame.u->refcount > 1) {
+            frame.release();
+        }
+        prepareSlot(frame, frame_size, type);
     }
-    
-    m_head = 0;
-    m_tail = 0;
-    m_size = 0;
-    
+}
+
+void FrameBuffer::clear() {
+    // Drop pending frames; slot storage stays allocated for reuse. The lock
+    // keeps an evicting producer from moving tail at the same time.
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_tail.store(m_head.load());
+
     // Notify producers that buffer is not full
     m_not_full.notify_all();
 }
 
-size_t FrameBuffer::nextIndex(size_t current) const {
-    return (current + 1) % m_capacity;
-}
\ No newline at end of file
+void FrameBuffer::close() {
+    // Set under the lock so a peer checking its wait predicate can't miss it
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_closed.store(true);
+    m_not_full.notify_all();
+    m_not_empty.notify_all();
+}
+
+void FrameBuffer::reopen() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_closed.store(false);
+}
+
+size_t FrameBuffer::slotIndex(size_t counter) const {
+    return counter % m_capacity;
+}
+
+void FrameBuffer::writeSlot(size_t head, const cv::Mat& frame, const FrameMetadata& metadata) {
+    cv::Mat& slot = m_frames[slotIndex(head)];
+
+    // The slot may hold storage the consumer handed back on pop. Only write
+    // into it when nobody else references it; otherwise start a fresh buffer.
+    if (slot.data && (!slot.u || slot.u->refcount > 1)) {
+        slot.release();
+    }
+
+    // Reuses the slot's allocation when size and type match
+    prepareSlot(slot, frame.size(), frame.type());
+    frame.copyTo(slot);
+    m_metadata[slotIndex(head)] = metadata;
+    if (m_policy == MAX_AGE) {
+        m_push_times[slotIndex(head)] = FrameMetadata::Clock::now();
+    }
+}
+
+void FrameBuffer::prepareSlot(cv::Mat& slot, const cv::Size& frame_size, int type) {
+#ifdef WITH_CUDA
+    // Consumers hand back whatever storage they held before; pageable
+    // storage is swapped for page-locked memory the first time it returns
+    if (m_page_locked) {
+        if (gpu_utils::isPageLocked(slot, frame_size, type)) {
+            return;
+        }
+        // Page-locking touches every page, so the policy must be in place
+        // while the memory is allocated. Only reallocations pay for the
+        // set_mempolicy calls, not every push on the capture thread.
+        ThreadPlacement::MemoryScope numa_local;
+        gpu_utils::ensurePageLocked(slot, frame_size, type);
+        m_memory.set(MemoryBudget::frameBytes(frame_size, type) * m_capacity);
+        return;
+    }
+#endif
+    const uchar* previous = slot.data;
+    slot.create(frame_size, type);
+    if (slot.data != previous) {
+        ThreadPlacement::instance().bindMemory(slot.data, slot.total() * slot.elemSize());
+        // Every slot ends up holding a frame of this size
+        m_memory.set(MemoryBudget::frameBytes(frame_size, type) * m_capacity);
+    }
+}
+
+void FrameBuffer::notify(std::atomic<bool>& waiting, std::condition_variable& cv) {
+    // Paired with the sequentially consistent store of the waiting flag, so
+    // a peer that is about to sleep either sees the new index or is woken
+    if (waiting.load()) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        cv.notify_one();
+    }
+}
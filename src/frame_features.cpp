@@ -0,0 +1,193 @@
+#include "frame_features.h"
+#include <algorithm>
+#include <cmath>
+
+FrameFeatures::FrameFeatures()
+    : m_entries(MAX_IMAGES),
+      m_uses(0),
+      m_memory("frame_features", MemoryBudget::HOST) {
+    Metrics& metrics = Metrics::instance();
+    m_metric_requests = metrics.registerCounter("features.requests",
+                                                "Per-frame feature maps requested");
+    m_metric_computations = metrics.registerCounter("features.computations",
+                                                    "Per-frame feature maps computed (cache misses)");
+}
+
+FrameFeatures::Entry& FrameFeatures::lookup(const cv::Mat& image) {
+    m_uses++;
+    for (Entry& entry : m_entries) {
+        if (entry.active && entry.data == image.data && entry.size == image.size() &&
+            entry.type == image.type()) {
+            entry.last_use = m_uses;
+            return entry;
+        }
+    }
+
+    // Prefer a free entry that already holds buffers of this size, then any
+    // free entry, then the least recently used one
+    Entry* claimed = nullptr;
+    for (Entry& entry : m_entries) {
+        if (!entry.active && entry.gray.size() == image.size()) {
+            claimed = &entry;
+            break;
+        }
+    }
+    if (!claimed) {
+        for (Entry& entry : m_entries) {
+            if (!entry.active) {
+                claimed = &entry;
+                break;
+            }
+        }
+    }
+    if (!claimed) {
+        claimed = &*std::min_element(m_entries.begin(), m_entries.end(),
+            [](const Entry& a, const Entry& b) { return a.last_use < b.last_use; });
+    }
+
+    claimed->data = image.data;
+    claimed->size = image.size();
+    claimed->type = image.type();
+    claimed->active = true;
+    claimed->valid = 0;
+    claimed->last_use = m_uses;
+    return *claimed;
+}
+
+bool FrameFeatures::request(Entry& entry, unsigned feature, bool params_match) {
+    m_stats.requests++;
+    Metrics::instance().add(m_metric_requests);
+    if ((entry.valid & feature) && params_match) {
+        return true;
+    }
+    m_stats.computations++;
+    Metrics::instance().add(m_metric_computations);
+    return false;
+}
+
+const cv::Mat& FrameFeatures::gray(const cv::Mat& image) {
+    Entry& entry = lookup(image);
+    if (request(entry, GRAY)) {
+        return entry.gray;
+    }
+
+    if (image.channels() == 1) {
+        image.copyTo(entry.gray);
+    } else if (image.channels() == 4) {
+        cv::cvtColor(image, entry.gray, cv::COLOR_BGRA2GRAY);
+    } else {
+        cv::cvtColor(image, entry.gray, cv::COLOR_BGR2GRAY);
+    }
+    entry.valid |= GRAY;
+    return entry.gray;
+}
+
+void FrameFeatures::computeGradients(Entry& entry) {
+    cv::Sobel(entry.gray, entry.grad_x, CV_16S, 1, 0, 3);
+    cv::Sobel(entry.gray, entry.grad_y, CV_16S, 0, 1, 3);
+    entry.valid |= GRADIENTS;
+}
+
+const cv::Mat& FrameFeatures::gradientX(const cv::Mat& image) {
+    gray(image);
+    Entry& entry = lookup(image);
+    if (!request(entry, GRADIENTS)) {
+        computeGradients(entry);
+    }
+    return entry.grad_x;
+}
+
+const cv::Mat& FrameFeatures::gradientY(const cv::Mat& image) {
+    gray(image);
+    Entry& entry = lookup(image);
+    if (!request(entry, GRADIENTS)) {
+        computeGradients(entry);
+    }
+    return entry.grad_y;
+}
+
+const cv::Mat& FrameFeatures::gradientMagnitude(const cv::Mat& image) {
+    gradientX(image);
+    Entry& entry = lookup(image);
+    if (request(entry, MAGNITUDE)) {
+        return entry.magnitude;
+    }
+
+    // 3x3 Sobel of 8-bit input is exact in 16 bits, so the float magnitude
+    // matches differentiating in float directly
+    entry.magnitude.create(entry.size, CV_32F);
+    for (int y = 0; y < entry.size.height; y++) {
+        const short* dx = entry.grad_x.ptr<short>(y);
+        const short* dy = entry.grad_y.ptr<short>(y);
+        float* out = entry.magnitude.ptr<float>(y);
+        for (int x = 0; x < entry.size.width; x++) {
+            const float gx = dx[x];
+            const float gy = dy[x];
+            out[x] = std::sqrt(gx * gx + gy * gy);
+        }
+    }
+    entry.valid |= MAGNITUDE;
+    return entry.magnitude;
+}
+
+const cv::Mat& FrameFeatures::edgeMask(const cv::Mat& image, double low_threshold, double high_threshold) {
+    const cv::Mat& source = gray(image);
+    Entry& entry = lookup(image);
+    if (request(entry, EDGES, entry.edge_low == low_threshold && entry.edge_high == high_threshold)) {
+        return entry.edges;
+    }
+
+    cv::Canny(source, entry.edges, low_threshold, high_threshold);
+    entry.edge_low = low_threshold;
+    entry.edge_high = high_threshold;
+    entry.valid |= EDGES;
+    return entry.edges;
+}
+
+const cv::Mat& FrameFeatures::localVariance(const cv::Mat& image, int window) {
+    const cv::Mat& source = gray(image);
+    Entry& entry = lookup(image);
+    if (request(entry, VARIANCE, entry.variance_window == window)) {
+        return entry.variance;
+    }
+
+    // var = E[I^2] - E[I]^2 over the window, clamped against rounding
+    const cv::Size box(window, window);
+    source.convertTo(entry.scratch_float, CV_32F);
+    cv::boxFilter(entry.scratch_float, entry.scratch_mean, CV_32F, box);
+    cv::sqrBoxFilter(entry.scratch_float, entry.variance, CV_32F, box);
+    entry.variance -= entry.scratch_mean.mul(entry.scratch_mean);
+    cv::max(entry.variance, 0.0, entry.variance);
+    entry.variance_window = window;
+    entry.valid |= VARIANCE;
+    return entry.variance;
+}
+
+void FrameFeatures::invalidate(const cv::Mat& image) {
+    for (Entry& entry : m_entries) {
+        if (entry.active && entry.data == image.data) {
+            entry.active = false;
+            entry.valid = 0;
+        }
+    }
+}
+
+void FrameFeatures::invalidate() {
+    for (Entry& entry : m_entries) {
+        entry.active = false;
+        entry.valid = 0;
+    }
+    updateMemory();
+}
+
+void FrameFeatures::updateMemory() {
+    size_t bytes = 0;
+    for (const Entry& entry : m_entries) {
+        for (const cv::Mat* mat : {&entry.gray, &entry.grad_x, &entry.grad_y, &entry.magnitude,
+                                   &entry.edges, &entry.variance, &entry.scratch_float,
+                                   &entry.scratch_mean}) {
+            bytes += mat->total() * mat->elemSize();
+        }
+    }
+    m_memory.set(bytes);
+}
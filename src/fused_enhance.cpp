@@ -0,0 +1,58 @@
+#include "fused_enhance.h"
+
+#ifdef WITH_FUSED_KERNELS
+
+#include <opencv2/core/cuda_stream_accessor.hpp>
+#include <cmath>
+#include <iostream>
+
+FusedEnhancer::FusedEnhancer(const AdaptiveSharpening::Config& sharpen, const SelectiveBilateral::Config& post) {
+    const int r = fused_kernels::kRadius;
+
+    m_params.strength = sharpen.strength;
+    m_params.edge_strength = sharpen.edge_strength;
+    m_params.smooth_strength = sharpen.smooth_strength;
+    m_params.edge_threshold = sharpen.edge_threshold;
+
+    // The kernel window is fixed at 5x5; only the sigmas carry over
+    cv::Mat gaussian = cv::getGaussianKernel(2 * r + 1, sharpen.sigma, CV_32F);
+    for (int i = 0; i <= 2 * r; i++) {
+        m_params.blur_weights[i] = gaussian.at<float>(i);
+    }
+
+    const double sigma_space = std::max(post.sigma_space, 1e-3);
+    const double sigma_color = std::max(post.sigma_color, 1e-3);
+    for (int dy = -r; dy <= r; dy++) {
+        for (int dx = -r; dx <= r; dx++) {
+            m_params.space_weights[dy + r][dx + r] =
+                static_cast<float>(std::exp(-(dx * dx + dy * dy) / (2.0 * sigma_space * sigma_space)));
+        }
+    }
+    m_params.color_coeff = static_cast<float>(-1.0 / (2.0 * sigma_color * sigma_color));
+    m_params.detail_threshold = static_cast<float>(post.detail_threshold / 255.0);
+    m_params.edge_preserve = static_cast<float>(post.edge_preserve);
+}
+
+bool FusedEnhancer::process(const cv::cuda::GpuMat& input, cv::cuda::GpuMat& output,
+                            cv::cuda::Stream& stream) {
+    if (input.empty() || input.type() != CV_8UC3) {
+        std::cerr << "Fused enhancement requires a BGR 8-bit frame" << std::endl;
+        return false;
+    }
+
+    output.create(input.size(), input.type());
+    if (output.data == input.data) {
+        std::cerr << "Fused enhancement cannot run in place" << std::endl;
+        return false;
+    }
+
+    cudaStream_t cuda_stream = static_cast<cudaStream_t>(cv::cuda::StreamAccessor::getStream(stream));
+    if (!fused_kernels::launchFusedEnhance(input.data, input.step, output.data, output.step,
+                                           input.cols, input.rows, m_params, cuda_stream)) {
+        std::cerr << "Failed to launch fused enhancement kernel" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+#endif // WITH_FUSED_KERNELS
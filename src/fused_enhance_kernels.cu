@@ -0,0 +1,254 @@
+#include "fused_enhance_kernels.h"
+
+#include <cuda_runtime.h>
+#include <vector>
+
+namespace fused_kernels {
+
+namespace {
+
+constexpr int kTile = 16;
+constexpr int kSharpHalo = kRadius;                 // Sharpened pixels needed around the tile
+constexpr int kInputHalo = kSharpHalo + kRadius;    // Input pixels needed around the tile
+constexpr int kSharpDim = kTile + 2 * kSharpHalo;
+constexpr int kInputDim = kTile + 2 * kInputHalo;
+
+__device__ __forceinline__ float luma(float b, float g, float r) {
+    return 0.114f * b + 0.587f * g + 0.299f * r;
+}
+
+__device__ __forceinline__ float smoothStep(float x, float center, float steepness) {
+    return 1.0f / (1.0f + __expf(-(x - center) * steepness));
+}
+
+__device__ __forceinline__ float saturate(float v) {
+    return fminf(fmaxf(v, 0.0f), 255.0f);
+}
+
+__device__ __forceinline__ int clampCoord(int v, int size) {
+    return min(max(v, 0), size - 1);
+}
+
+// Every intermediate (luma, edge mask, blur, sharpened tile, detail mask)
+// lives in shared memory; global memory sees one read of the input tile plus
+// halo and one write of the output tile.
+__global__ void fusedEnhanceKernel(const unsigned char* src, size_t src_step,
+                                   unsigned char* dst, size_t dst_step,
+                                   int width, int height, Params p) {
+    __shared__ float in_y[kInputDim][kInputDim];
+    __shared__ float3 sharp_bgr[kSharpDim][kSharpDim];
+    __shared__ float sharp_y[kSharpDim][kSharpDim];
+
+    const int tid = threadIdx.y * kTile + threadIdx.x;
+    const int x0 = blockIdx.x * kTile;
+    const int y0 = blockIdx.y * kTile;
+
+    // 1. Input luma for the tile and its halo (replicated border)
+    for (int i = tid; i < kInputDim * kInputDim; i += kTile * kTile) {
+        const int sy = i / kInputDim;
+        const int sx = i % kInputDim;
+        const int gx = clampCoord(x0 + sx - kInputHalo, width);
+        const int gy = clampCoord(y0 + sy - kInputHalo, height);
+        const unsigned char* px = src + gy * src_step + gx * 3;
+        in_y[sy][sx] = luma(px[0], px[1], px[2]);
+    }
+    __syncthreads();
+
+    // 2. Edge-weighted unsharp mask over the tile plus the filter halo. Only
+    //    luma detail is added back, which keeps the chroma like preserve_tone.
+    for (int i = tid; i < kSharpDim * kSharpDim; i += kTile * kTile) {
+        const int sy = i / kSharpDim;
+        const int sx = i % kSharpDim;
+        const int cy = sy + kRadius;
+        const int cx = sx + kRadius;
+
+        const float gx = (in_y[cy - 1][cx + 1] + 2.0f * in_y[cy][cx + 1] + in_y[cy + 1][cx + 1]) -
+                         (in_y[cy - 1][cx - 1] + 2.0f * in_y[cy][cx - 1] + in_y[cy + 1][cx - 1]);
+        const float gy = (in_y[cy + 1][cx - 1] + 2.0f * in_y[cy + 1][cx] + in_y[cy + 1][cx + 1]) -
+                         (in_y[cy - 1][cx - 1] + 2.0f * in_y[cy - 1][cx] + in_y[cy - 1][cx + 1]);
+        const float lap = in_y[cy - 1][cx] + in_y[cy + 1][cx] + in_y[cy][cx - 1] + in_y[cy][cx + 1] -
+                          4.0f * in_y[cy][cx];
+        const float sobel = fminf(0.5f * (fabsf(gx) + fabsf(gy)), 255.0f);
+        const float edges = 0.6f * sobel + 0.4f * fminf(fabsf(lap), 255.0f);
+        const float edge = smoothStep(edges, p.edge_threshold, 0.1f);
+        const float strength = p.strength * (edge * p.edge_strength + (1.0f - edge) * p.smooth_strength);
+
+        float blurred = 0.0f;
+        for (int dy = -kRadius; dy <= kRadius; dy++) {
+            float row = 0.0f;
+            for (int dx = -kRadius; dx <= kRadius; dx++) {
+                row += p.blur_weights[dx + kRadius] * in_y[cy + dy][cx + dx];
+            }
+            blurred += p.blur_weights[dy + kRadius] * row;
+        }
+        const float delta = strength * (in_y[cy][cx] - blurred);
+
+        const int px_x = clampCoord(x0 + sx - kSharpHalo, width);
+        const int px_y = clampCoord(y0 + sy - kSharpHalo, height);
+        const unsigned char* px = src + px_y * src_step + px_x * 3;
+        const float b = saturate(px[0] + delta);
+        const float g = saturate(px[1] + delta);
+        const float r = saturate(px[2] + delta);
+        sharp_bgr[sy][sx] = make_float3(b, g, r);
+        sharp_y[sy][sx] = luma(b, g, r);
+    }
+    __syncthreads();
+
+    const int x = x0 + threadIdx.x;
+    const int y = y0 + threadIdx.y;
+    if (x >= width || y >= height) {
+        return;
+    }
+    const int cy = threadIdx.y + kSharpHalo;
+    const int cx = threadIdx.x + kSharpHalo;
+
+    // 3. Bilateral filter of the sharpened tile
+    const float3 center = sharp_bgr[cy][cx];
+    float3 sum = make_float3(0.0f, 0.0f, 0.0f);
+    float weight_sum = 0.0f;
+    for (int dy = -kRadius; dy <= kRadius; dy++) {
+        for (int dx = -kRadius; dx <= kRadius; dx++) {
+            const float3 n = sharp_bgr[cy + dy][cx + dx];
+            const float dc = fabsf(n.x - center.x) + fabsf(n.y - center.y) + fabsf(n.z - center.z);
+            const float w = p.space_weights[dy + kRadius][dx + kRadius] * __expf(dc * dc * p.color_coeff);
+            sum.x += w * n.x;
+            sum.y += w * n.y;
+            sum.z += w * n.z;
+            weight_sum += w;
+        }
+    }
+    const float inv = 1.0f / weight_sum;
+
+    // 4. Detail mask from the sharpened luma; detailed pixels keep the
+    //    sharpened value, flat ones take the filtered one
+    const float gx = (sharp_y[cy - 1][cx + 1] + 2.0f * sharp_y[cy][cx + 1] + sharp_y[cy + 1][cx + 1]) -
+                     (sharp_y[cy - 1][cx - 1] + 2.0f * sharp_y[cy][cx - 1] + sharp_y[cy + 1][cx - 1]);
+    const float gy = (sharp_y[cy + 1][cx - 1] + 2.0f * sharp_y[cy + 1][cx] + sharp_y[cy + 1][cx + 1]) -
+                     (sharp_y[cy - 1][cx - 1] + 2.0f * sharp_y[cy - 1][cx] + sharp_y[cy - 1][cx + 1]);
+    const float detail = smoothStep(sqrtf(gx * gx + gy * gy) / 1020.0f, p.detail_threshold, 10.0f);
+    const float keep = fminf(detail * (1.0f + detail * (p.edge_preserve - 1.0f)), 1.0f);
+
+    unsigned char* out = dst + y * dst_step + x * 3;
+    out[0] = static_cast<unsigned char>(__float2int_rn(saturate(center.x * keep + sum.x * inv * (1.0f - keep))));
+    out[1] = static_cast<unsigned char>(__float2int_rn(saturate(center.y * keep + sum.y * inv * (1.0f - keep))));
+    out[2] = static_cast<unsigned char>(__float2int_rn(saturate(center.z * keep + sum.z * inv * (1.0f - keep))));
+}
+
+// One thread per pixel; the texture unit interpolates between the eight
+// lattice points around the colour. Texels are BGRA, read back as 0-1 floats.
+__global__ void applyLut3DKernel(const unsigned char* src, size_t src_step,
+                                 unsigned char* dst, size_t dst_step,
+                                 int width, int height, cudaTextureObject_t lut, float scale,
+                                 const float* gain, size_t gain_step) {
+    const int x = blockIdx.x * blockDim.x + threadIdx.x;
+    const int y = blockIdx.y * blockDim.y + threadIdx.y;
+    if (x >= width || y >= height) {
+        return;
+    }
+
+    // Array axes are (r, b, g), matching rows b + g * size and columns r;
+    // +0.5 moves from lattice index to texel centre
+    const unsigned char* px = src + y * src_step + x * 3;
+    const float4 value = tex3D<float4>(lut, px[2] * scale + 0.5f, px[0] * scale + 0.5f, px[1] * scale + 0.5f);
+
+    float factor = 255.0f;
+    if (gain) {
+        factor *= *reinterpret_cast<const float*>(reinterpret_cast<const char*>(gain) + y * gain_step + x * 4);
+    }
+
+    unsigned char* out = dst + y * dst_step + x * 3;
+    out[0] = static_cast<unsigned char>(__float2int_rn(saturate(value.x * factor)));
+    out[1] = static_cast<unsigned char>(__float2int_rn(saturate(value.y * factor)));
+    out[2] = static_cast<unsigned char>(__float2int_rn(saturate(value.z * factor)));
+}
+
+} // namespace
+
+bool launchFusedEnhance(const unsigned char* src, size_t src_step,
+                        unsigned char* dst, size_t dst_step,
+                        int width, int height,
+                        const Params& params, cudaStream_t stream) {
+    const dim3 block(kTile, kTile);
+    const dim3 grid((width + kTile - 1) / kTile, (height + kTile - 1) / kTile);
+    fusedEnhanceKernel<<<grid, block, 0, stream>>>(src, src_step, dst, dst_step, width, height, params);
+    return cudaGetLastError() == cudaSuccess;
+}
+
+bool uploadLut3D(const unsigned char* bgr, int size, Lut3D& lut) {
+    releaseLut3D(lut);
+    if (!bgr || size < 2) {
+        return false;
+    }
+
+    // Three-channel arrays are not supported, so pad to BGRA
+    const size_t entries = static_cast<size_t>(size) * size * size;
+    std::vector<uchar4> texels(entries);
+    for (size_t i = 0; i < entries; i++) {
+        texels[i] = make_uchar4(bgr[i * 3], bgr[i * 3 + 1], bgr[i * 3 + 2], 255);
+    }
+
+    const cudaChannelFormatDesc format = cudaCreateChannelDesc<uchar4>();
+    const cudaExtent extent = make_cudaExtent(size, size, size);
+    if (cudaMalloc3DArray(&lut.array, &format, extent) != cudaSuccess) {
+        lut.array = nullptr;
+        return false;
+    }
+
+    cudaMemcpy3DParms copy = {};
+    copy.srcPtr = make_cudaPitchedPtr(texels.data(), size * sizeof(uchar4), size, size);
+    copy.dstArray = lut.array;
+    copy.extent = extent;
+    copy.kind = cudaMemcpyHostToDevice;
+    if (cudaMemcpy3D(&copy) != cudaSuccess) {
+        releaseLut3D(lut);
+        return false;
+    }
+
+    cudaResourceDesc resource = {};
+    resource.resType = cudaResourceTypeArray;
+    resource.res.array.array = lut.array;
+
+    cudaTextureDesc texture = {};
+    for (int axis = 0; axis < 3; axis++) {
+        texture.addressMode[axis] = cudaAddressModeClamp;
+    }
+    texture.filterMode = cudaFilterModeLinear;
+    texture.readMode = cudaReadModeNormalizedFloat;
+    texture.normalizedCoords = 0;
+    if (cudaCreateTextureObject(&lut.texture, &resource, &texture, nullptr) != cudaSuccess) {
+        lut.texture = 0;
+        releaseLut3D(lut);
+        return false;
+    }
+
+    lut.size = size;
+    return true;
+}
+
+void releaseLut3D(Lut3D& lut) {
+    if (lut.texture) {
+        cudaDestroyTextureObject(lut.texture);
+    }
+    if (lut.array) {
+        cudaFreeArray(lut.array);
+    }
+    lut = Lut3D();
+}
+
+bool launchApplyLut3D(const unsigned char* src, size_t src_step,
+                      unsigned char* dst, size_t dst_step,
+                      int width, int height, const Lut3D& lut,
+                      const float* gain, size_t gain_step, cudaStream_t stream) {
+    if (!lut.texture) {
+        return false;
+    }
+
+    const dim3 block(32, 8);
+    const dim3 grid((width + block.x - 1) / block.x, (height + block.y - 1) / block.y);
+    const float scale = (lut.size - 1) / 255.0f;
+    applyLut3DKernel<<<grid, block, 0, stream>>>(src, src_step, dst, dst_step, width, height,
+                                                 lut.texture, scale, gain, gain_step);
+    return cudaGetLastError() == cudaSuccess;
+}
+
+} // namespace fused_kernels
@@ -0,0 +1,156 @@
+#include "gpu_utils.h"
+
+#ifdef WITH_CUDA
+#include "frame_arena.h"
+#include <opencv2/cudaarithm.hpp>
+
+namespace gpu_utils {
+
+namespace {
+
+// Scratch slots; helpers that call each other use disjoint ranges
+enum ScratchSlot {
+    SLOT_PLANE = 0,         // Up to four split planes
+    SLOT_FILTERED = 4,      // Up to four filtered planes
+    SLOT_LERP_A = 8,
+    SLOT_LERP_B,
+    SLOT_LERP_DIFF,
+    SLOT_ADD_BASE,
+    SLOT_ADD_DELTA,
+    SLOT_ADD_WEIGHT,
+    SLOT_SIGMOID
+};
+
+// The helpers' temporaries live in a per-thread arena, like the scratch of
+// the modules that call them, so steady state allocates nothing
+FrameArena& scratchArena() {
+    thread_local FrameArena arena;
+    return arena;
+}
+
+// Publishes the arena's bytes to the memory budget once a helper returns,
+// so each helper call counts as a frame when idle scratch is released
+struct ScratchScope {
+    ~ScratchScope() { scratchArena().endFrame(); }
+};
+
+// Header over a scratch buffer; a local copy so aliasing or reassigning it
+// never replaces the arena's own buffer
+cv::cuda::GpuMat scratch(cv::cuda::Stream& stream, cv::Size size, int type, int slot) {
+    return scratchArena().scratch(stream, size, type, slot);
+}
+
+} // namespace
+
+void applyPerChannel(const cv::Ptr<cv::cuda::Filter>& filter,
+                     const cv::cuda::GpuMat& src,
+                     cv::cuda::GpuMat& dst,
+                     cv::cuda::Stream& stream) {
+    ScratchScope scope;
+    const int plane_type = CV_MAKETYPE(src.depth(), 1);
+    if (src.channels() == 1) {
+        if (src.data == dst.data) {
+            // The CUDA filters cannot run in place
+            cv::cuda::GpuMat filtered = scratch(stream, src.size(), plane_type, SLOT_FILTERED);
+            filter->apply(src, filtered, stream);
+            filtered.copyTo(dst, stream);
+        } else {
+            filter->apply(src, dst, stream);
+        }
+        return;
+    }
+
+    const int channels = src.channels();
+    cv::cuda::GpuMat planes[4];
+    cv::cuda::GpuMat filtered[4];
+    for (int c = 0; c < channels; c++) {
+        planes[c] = scratch(stream, src.size(), plane_type, SLOT_PLANE + c);
+        filtered[c] = scratch(stream, src.size(), plane_type, SLOT_FILTERED + c);
+    }
+    cv::cuda::split(src, planes, stream);
+    for (int c = 0; c < channels; c++) {
+        filter->apply(planes[c], filtered[c], stream);
+    }
+    cv::cuda::merge(filtered, channels, dst, stream);
+}
+
+void replicateChannels(const cv::cuda::GpuMat& src, int channels,
+                       cv::cuda::GpuMat& dst, cv::cuda::Stream& stream) {
+    if (channels == 1) {
+        dst = src;
+        return;
+    }
+
+    cv::cuda::GpuMat planes[4];
+    for (int c = 0; c < channels; c++) {
+        planes[c] = src;
+    }
+    cv::cuda::merge(planes, channels, dst, stream);
+}
+
+void lerp(const cv::cuda::GpuMat& a, const cv::cuda::GpuMat& b,
+          const cv::cuda::GpuMat& weight, cv::cuda::GpuMat& dst,
+          cv::cuda::Stream& stream) {
+    ScratchScope scope;
+    const int float_type = CV_MAKETYPE(CV_32F, a.channels());
+    cv::cuda::GpuMat a_float = scratch(stream, a.size(), float_type, SLOT_LERP_A);
+    cv::cuda::GpuMat b_float = scratch(stream, a.size(), float_type, SLOT_LERP_B);
+    cv::cuda::GpuMat diff = scratch(stream, a.size(), float_type, SLOT_LERP_DIFF);
+    a.convertTo(a_float, CV_32F, stream);
+    b.convertTo(b_float, CV_32F, stream);
+    cv::cuda::subtract(b_float, a_float, diff, cv::noArray(), -1, stream);
+
+    weightedAdd(a_float, diff, weight, a_float, stream);
+    a_float.convertTo(dst, a.depth(), stream);
+}
+
+void weightedAdd(const cv::cuda::GpuMat& base, const cv::cuda::GpuMat& delta,
+                 const cv::cuda::GpuMat& weight, cv::cuda::GpuMat& dst,
+                 cv::cuda::Stream& stream) {
+    ScratchScope scope;
+    const int float_type = CV_MAKETYPE(CV_32F, base.channels());
+    cv::cuda::GpuMat base_float = scratch(stream, base.size(), float_type, SLOT_ADD_BASE);
+    cv::cuda::GpuMat delta_float = scratch(stream, base.size(), float_type, SLOT_ADD_DELTA);
+    cv::cuda::GpuMat weight_n;
+    if (base.channels() > 1) {
+        weight_n = scratch(stream, base.size(), float_type, SLOT_ADD_WEIGHT);
+    }
+    base.convertTo(base_float, CV_32F, stream);
+    delta.convertTo(delta_float, CV_32F, stream);
+    replicateChannels(weight, base.channels(), weight_n, stream);
+
+    cv::cuda::multiply(delta_float, weight_n, delta_float, 1.0, -1, stream);
+    cv::cuda::add(base_float, delta_float, base_float, cv::noArray(), -1, stream);
+    base_float.convertTo(dst, base.depth(), stream);
+}
+
+void sigmoid(const cv::cuda::GpuMat& src, double center, double steepness,
+             cv::cuda::GpuMat& dst, cv::cuda::Stream& stream) {
+    ScratchScope scope;
+    cv::cuda::GpuMat tmp = scratch(stream, src.size(), CV_32FC1, SLOT_SIGMOID);
+    src.convertTo(tmp, CV_32F, -steepness, center * steepness, stream);
+    cv::cuda::exp(tmp, tmp, stream);
+    cv::cuda::add(tmp, cv::Scalar::all(1.0), tmp, cv::noArray(), -1, stream);
+    cv::cuda::divide(cv::Scalar::all(1.0), tmp, dst, 1.0, -1, stream);
+}
+
+bool isPageLocked(const cv::Mat& mat, const cv::Size& size, int type) {
+    cv::MatAllocator* allocator = cv::cuda::HostMem::getAllocator(cv::cuda::HostMem::PAGE_LOCKED);
+    return mat.u && mat.u->currAllocator == allocator && mat.u->refcount == 1 &&
+           mat.size() == size && mat.type() == type;
+}
+
+void ensurePageLocked(cv::Mat& mat, const cv::Size& size, int type) {
+    if (isPageLocked(mat, size, type)) {
+        return;
+    }
+    
+    // Storage shared with another header is left to it; this one gets new
+    mat.release();
+    mat.allocator = cv::cuda::HostMem::getAllocator(cv::cuda::HostMem::PAGE_LOCKED);
+    mat.create(size, type);
+}
+
+} // namespace gpu_utils
+
+#endif // WITH_CUDA
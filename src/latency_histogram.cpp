@@ -0,0 +1,91 @@
+#include "latency_histogram.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+LatencyHistogram::LatencyHistogram(double max_ms, double resolution_ms)
+    : m_resolution_ms(resolution_ms > 0.0 ? resolution_ms : 0.25),
+      m_count(0),
+      m_sum_ms(0.0),
+      m_max_ms(0.0) {
+    size_t bucket_count = static_cast<size_t>(std::ceil(std::max(max_ms, m_resolution_ms) / m_resolution_ms));
+    m_buckets.assign(bucket_count + 1, 0);
+}
+
+void LatencyHistogram::record(double latency_ms) {
+    latency_ms = std::max(latency_ms, 0.0);
+    size_t bucket = std::min(static_cast<size_t>(latency_ms / m_resolution_ms), m_buckets.size() - 1);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_buckets[bucket]++;
+    m_count++;
+    m_sum_ms += latency_ms;
+    m_max_ms = std::max(m_max_ms, latency_ms);
+}
+
+double LatencyHistogram::percentile(double percentile) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return percentileLocked(percentile);
+}
+
+uint64_t LatencyHistogram::count() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_count;
+}
+
+double LatencyHistogram::mean() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_count > 0 ? m_sum_ms / m_count : 0.0;
+}
+
+double LatencyHistogram::max() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_max_ms;
+}
+
+void LatencyHistogram::reset() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::fill(m_buckets.begin(), m_buckets.end(), 0);
+    m_count = 0;
+    m_sum_ms = 0.0;
+    m_max_ms = 0.0;
+}
+
+std::string LatencyHistogram::summary(const std::string& name) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2)
+        << name << ": n=" << m_count
+        << " mean=" << (m_count > 0 ? m_sum_ms / m_count : 0.0) << "ms"
+        << " p50=" << percentileLocked(50.0) << "ms"
+        << " p95=" << percentileLocked(95.0) << "ms"
+        << " p99=" << percentileLocked(99.0) << "ms"
+        << " max=" << m_max_ms << "ms";
+    return out.str();
+}
+
+double LatencyHistogram::percentileLocked(double percentile) const {
+    if (m_count == 0) {
+        return 0.0;
+    }
+
+    percentile = std::min(std::max(percentile, 0.0), 100.0);
+    uint64_t rank = static_cast<uint64_t>(std::ceil(percentile / 100.0 * m_count));
+    rank = std::max<uint64_t>(rank, 1);
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < m_buckets.size(); ++i) {
+        seen += m_buckets[i];
+        if (seen >= rank) {
+            // Overflow bucket has no upper edge; report the largest sample
+            if (i == m_buckets.size() - 1) {
+                return m_max_ms;
+            }
+            return std::min((i + 1) * m_resolution_ms, m_max_ms);
+        }
+    }
+
+    return m_max_ms;
+}
@@ -2,9 +2,28 @@
 #include "frame_buffer.h"
 #include "upscaler.h"
 #include "temporal_consistency.h"
+#include "temporal_filter.h"
 #include "adaptive_sharpening.h"
 #include "selective_bilateral.h"
-#include "timer.h"
+#include "metrics.h"
+#include "frame_metadata.h"
+#include "latency_histogram.h"
+#include "async_super_res.h"
+#include "recording_sink.h"
+#include "network_sink.h"
+#include "memory_budget.h"
+#include "offline_transcoder.h"
+#include "device_scheduler.h"
+#include "quality_governor.h"
+#include "stream_host.h"
+#include "upscaler_loader.h"
+#include "yuv_frame.h"
+#include "task_pool.h"
+#include "raw_capture.h"
+#include "duplicate_detector.h"
+#include "trace.h"
+#include "thread_placement.h"
+#include "sr_calibrator.h"
 #include <iostream>
 #include <thread>
 #include <atomic>
@@ -13,6 +32,7 @@
 #include <string>
 #include <filesystem>
 #include <signal.h>
+#include <unistd.h>
 #include <opencv2/video/tracking.hpp>
 
 
@@ -24,87 +44,88 @@ std::atomic<int> g_frames_captured(0);
 std::atomic<int> g_frames_processed(0);
 std::atomic<int> g_frames_displayed(0);
 std::atomic<int> g_frames_dropped(0);
+
+// Per-frame latency distributions, fed from the frame metadata on display
+LatencyHistogram g_glass_to_glass_latency;
+LatencyHistogram g_capture_latency;
+LatencyHistogram g_queue_latency;
+LatencyHistogram g_processing_latency;
+LatencyHistogram g_display_latency;
+
+// Per-stage timings, registered once so the thread loops only touch IDs
+Metrics::Id g_metric_acquisition = Metrics::instance().registerLatency("main.acquisition", "Frame acquisition from the source");
+Metrics::Id g_metric_buffer_push = Metrics::instance().registerLatency("main.buffer_push", "Push into the raw frame buffer");
+Metrics::Id g_metric_buffer_pop = Metrics::instance().registerLatency("main.buffer_pop", "Wait for a raw frame");
+Metrics::Id g_metric_upscale = Metrics::instance().registerLatency("main.upscale", "Upscaling per processed frame");
+Metrics::Id g_metric_temporal = Metrics::instance().registerLatency("main.temporal_filter", "Recursive temporal smoothing");
+Metrics::Id g_metric_text_overlay = Metrics::instance().registerLatency("main.text_overlay", "Statistics overlay drawing");
+Metrics::Id g_metric_output_push = Metrics::instance().registerLatency("main.output_push", "Push into the processed frame buffer");
+Metrics::Id g_metric_display_pop = Metrics::instance().registerLatency("main.display_pop", "Poll for a processed frame");
+Metrics::Id g_metric_video_write = Metrics::instance().registerLatency("main.video_write", "Recording one frame");
+Metrics::Id g_metric_display_show = Metrics::instance().registerLatency("main.display_show", "Presenting one frame");
+std::string g_metrics_json_path;  // Written on exit when set
+std::string g_trace_path;         // Chrome trace written on exit when set
 std::atomic<bool> g_save_video(false);
-std::queue<cv::Mat> g_sr_frame_queue;
-std::mutex g_sr_queue_mutex;
-std::atomic<bool> g_sr_processing_active(false);
-cv::Mat g_last_sr_result;
-std::mutex g_sr_result_mutex;
-cv::Mat g_previous_frame;
-float g_blend_alpha = 0.0f;
-std::mutex g_blend_mutex;
-std::deque<cv::Mat> g_frame_history;
-const int HISTORY_SIZE = 3;
-std::mutex g_history_mutex;
 bool g_using_super_res = false;
 std::string g_output_format = "mp4";
 
-// Global video writer, moved outside so it can be properly closed on exit
-std::unique_ptr<cv::VideoWriter> g_video_writer;
-bool g_writer_initialized = false;
+// Frames travel as planar I420 from capture to the recorder; only the
+// display converts to BGR
+bool g_i420_pipeline = false;
+
+// No windows: frames are recorded and measured but never shown (servers)
+bool g_headless = false;
+
+// Global recording sink, moved outside so it can be flushed and closed on exit
+std::unique_ptr<RecordingSink> g_recorder;
+
+// Live network output (--stream-out), opened with the first displayed frame
+std::string g_stream_url;
+int g_stream_bitrate_kbps = 8000;
+std::unique_ptr<NetworkSink> g_network_sink;
+
+// Running offline transcode, cancelled instead of exiting on a signal so the
+// frames already processed are still written
+std::atomic<OfflineTranscoder*> g_transcoder(nullptr);
 std::string g_output_filename = "output.mp4";
 
-// Add this function for temporal smoothing without optical flow
-cv::Mat createSmoothFrame(const std::deque<cv::Mat>& frame_history) {
-    if (frame_history.size() < 2) {
-        return frame_history.back().clone();
+// Stop tracing and write the timeline if --trace was given
+void writeTrace() {
+    if (!g_trace_path.empty()) {
+        Trace::stop();
+        Trace::dump(g_trace_path);
     }
-    
-    // Get latest frame
-    cv::Mat current = frame_history.back();
-    
-    // Create result frame
-    cv::Mat result = current.clone();
-    
-    // Apply temporal blending with decreasing weights
-    float total_weight = 0.0f;
-    float weights[HISTORY_SIZE] = {0.7f, 0.2f, 0.1f}; // Most weight on current frame
-    
-    for (int i = 0; i < frame_history.size() && i < HISTORY_SIZE; i++) {
-        int idx = frame_history.size() - 1 - i;
-        float weight = weights[i];
-        total_weight += weight;
-        
-        if (i == 0) {
-            // First frame (latest) - initialize result
-            cv::addWeighted(result, 0, frame_history[idx], weight, 0, result);
-        } else {
-            // Add weighted previous frames
-            cv::addWeighted(result, 1.0, frame_history[idx], weight, 0, result);
-        }
-    }
-    
-    // Normalize if needed
-    if (total_weight != 1.0f && total_weight > 0.0f) {
-        result = result * (1.0f / total_weight);
-    }
-    
-    return result;
 }
 
-// Signal handler for clean shutdown
+// Signal handler for clean shutdown. Only async-signal-safe work happens
+// here (write, atomic stores): the threads see g_running, the transcoder
+// polls its cancel flag, and main flushes the sinks, metrics and trace once
+// they have been joined
 void signalHandler(int signum) {
-    std::cout << "Interrupt signal (" << signum << ") received.\n";
+    static const char message[] = "Interrupt signal received, shutting down\n";
+    ssize_t ignored = write(STDERR_FILENO, message, sizeof(message) - 1);
+    (void)ignored;
     g_running = false;
     
-    // Give the threads a chance to exit cleanly
-    std::this_thread::sleep_for(std::chrono::milliseconds(500));
-    
-    // If video was being recorded, make sure it's closed properly
-    if (g_writer_initialized && g_video_writer) {
-        std::cout << "Closing video file..." << std::endl;
-        g_video_writer->release();
-        std::cout << "Video saved to: " << g_output_filename << std::endl;
+    OfflineTranscoder* transcoder = g_transcoder.load();
+    if (transcoder) {
+        transcoder->requestCancel();
     }
     
-    exit(signum);
+    // A second signal terminates immediately if shutdown hangs
+    signal(signum, SIG_DFL);
 }
 
 // Capture thread function - with frame rate control for video files
-void capture_thread(Camera& camera, FrameBuffer& buffer, Timer& timer, 
-                   bool is_video_file, double target_fps, bool using_super_res) {
+void capture_thread(Camera& camera, FrameBuffer& buffer, 
+                   bool is_video_file, double target_fps, bool using_super_res,
+                   RawFrameWriter* raw_tap) {
     std::cout << "Capture thread started" << std::endl;
+    Trace::setThreadName("capture");
+    ThreadPlacement::instance().apply(ThreadPlacement::CAPTURE);
     cv::Mat frame;
+    FrameMetadata metadata;
+    uint64_t next_frame_id = 0;
 
     // For measuring real capture rate
     auto start_time = std::chrono::high_resolution_clock::now();
@@ -154,10 +175,22 @@ void capture_thread(Camera& camera, FrameBuffer& buffer, Timer& timer,
             continue;
         }
 
+        // Block on the camera's new-frame event instead of polling; the
+        // timeout lets the loop notice shutdown
+        if (!camera.waitForFrame(100)) {
+            continue;
+        }
+
         // Time the frame acquisition
-        timer.start("acquisition");
-        bool success = camera.getFrame(frame);
-        timer.stop("acquisition");
+        auto acquisition_start = Metrics::Clock::now();
+        metadata = FrameMetadata();
+        metadata.enter(FrameMetadata::CAPTURE);
+        Trace::setFrame(next_frame_id);
+        TraceScope capture_span("capture");
+        bool success = camera.getFrame(frame, metadata);
+        capture_span.end();
+        metadata.exit(FrameMetadata::CAPTURE);
+        Metrics::instance().recordSince(g_metric_acquisition, acquisition_start);
 
         if (!success || frame.empty()) {
             std::cerr << "Failed to get frame from source" << std::endl;
@@ -185,34 +218,25 @@ void capture_thread(Camera& camera, FrameBuffer& buffer, Timer& timer,
             start_time = current_time;
         }
 
-        // Instead of pure buffer pressure-based frame dropping, use a more
-        // sophisticated approach that considers both buffer state and processing method
-
-        // Calculate buffer utilization
-        double buffer_utilization = static_cast<double>(buffer.size()) / buffer.capacity();
+        // Tap the source into a raw file before anything touches the frame
+        if (raw_tap && raw_tap->isOpen()) {
+            raw_tap->write(frame, metadata);
+        }
 
-        if (buffer_utilization < 0.9) {  // Only push if buffer isn't almost full
-            // Push frame to buffer - use blocking for more consistent behavior
-            timer.start("buffer_push");
-            bool pushed = buffer.pushFrame(frame, true);
-            timer.stop("buffer_push");
+        // The buffer's drop policy decides what a full buffer does: files
+        // block for backpressure, live sources evict the oldest frame
+        auto push_start = Metrics::Clock::now();
+        metadata.frame_id = next_frame_id++;
+        TraceScope push_span("buffer.push");
+        bool pushed = buffer.pushFrame(frame, metadata, true);
+        push_span.end();
+        Metrics::instance().recordSince(g_metric_buffer_push, push_start);
 
-            if (pushed) {
-                g_frames_captured++;
-            } else {
-                g_frames_dropped++;
-                std::cerr << "Failed to push frame to buffer" << std::endl;
-            }
+        if (pushed) {
+            g_frames_captured++;
         } else {
-            // Buffer is too full, we must skip this frame
             g_frames_dropped++;
-
-            if (g_frames_dropped % 10 == 0) {
-                std::cout << "Warning: Dropped " << g_frames_dropped << " frames due to full buffer" << std::endl;
-            }
-
-            // When buffer is almost full, add a longer delay to allow consumer to catch up
-            std::this_thread::sleep_for(std::chrono::milliseconds(10 * using_super_res ? 30 : 10));
+            std::cerr << "Failed to push frame to buffer" << std::endl;
         }
     }
 
@@ -220,25 +244,73 @@ void capture_thread(Camera& camera, FrameBuffer& buffer, Timer& timer,
 }
 
 void processing_thread(FrameBuffer& input_buffer, FrameBuffer& output_buffer, 
-                          Upscaler& upscaler, Timer& timer) {
+                          Upscaler& upscaler,
+                          AsyncSuperRes* async_sr, DeviceScheduler* scheduler,
+                          QualityGovernor* governor, UpscalerLoader* loader,
+                          cv::Size max_sr_input, bool overlap_transfers) {
     std::cout << "Processing thread started" << std::endl;
+    Trace::setThreadName("process");
+    ThreadPlacement::instance().apply(ThreadPlacement::PROCESSING);
+    
+    // Fast start streams on the given upscaler until the loader's is warm
+    Upscaler* active = &upscaler;
+    std::unique_ptr<Upscaler> loaded;
     cv::Mat input_frame, processed_frame;
+    FrameMetadata metadata;
+    
+    // Results from the async SR engine, in submission order
+    std::deque<std::future<AsyncSuperRes::Result>> pending_sr;
+    
+    // Results from the multi-GPU scheduler, in submission order
+    std::deque<std::future<DeviceScheduler::Result>> pending_scheduled;
+    
+    // Envelope of the frame still in flight on the overlapped GPU path
+    FrameMetadata overlapped_metadata;
 
-    // For tracking performance
+    // For tracking performance; the FPS overlay uses these moving averages
+    // rather than the metrics registry, whose snapshots are for reporting
     double avg_processing_time = 0.0;
+    double avg_pop_time = 0.0;
+    double avg_push_time = 0.0;
+
+    // One accumulator replaces the old frame history
+    TemporalFilter temporal_filter;
+    cv::Mat reliability;
 
     // FIXED: Properly check if using super-resolution based on algorithm
-    bool g_using_super_res = (upscaler.getAlgorithmName() == "RealESRGAN" || 
+    bool g_using_super_res = (async_sr != nullptr ||
+                             (scheduler != nullptr && (scheduler->getAlgorithm() == Upscaler::SUPER_RES ||
+                                                       scheduler->getAlgorithm() == Upscaler::REAL_ESRGAN)) ||
+                             governor != nullptr ||
+                             upscaler.getAlgorithmName() == "RealESRGAN" || 
                              upscaler.getAlgorithmName() == "Standard Super-Res");
     
     std::cout << "Processing with " << (g_using_super_res ? "Super-Resolution" : "Bicubic") 
              << " algorithm" << std::endl;
 
     while (g_running) {
+        // Swap in the background-loaded model between two frames
+        if (loader && loader->isReady()) {
+            loaded = loader->take();
+            active = loaded.get();
+            g_using_super_res = true;
+            std::cout << "Switched to " << active->getAlgorithmName() << " after "
+                      << loader->getLoadSeconds() << " s background load" << std::endl;
+            loader = nullptr;
+        } else if (loader && loader->hasFailed()) {
+            std::cerr << "Background model unavailable, staying on " << active->getAlgorithmName() << std::endl;
+            loader = nullptr;
+        }
+        
         // Get frame from input buffer - use blocking mode to avoid busy waiting
-        timer.start("buffer_pop");
-        bool success = input_buffer.popFrame(input_frame, true);
-        timer.stop("buffer_pop");
+        auto pop_start = Metrics::Clock::now();
+        TraceScope pop_span("buffer.wait");
+        bool success = input_buffer.popFrame(input_frame, metadata, true);
+        Trace::setFrame(success ? metadata.frame_id : Trace::NO_FRAME);
+        pop_span.setFrame(Trace::currentFrame());
+        pop_span.end();
+        double pop_time = Metrics::instance().recordSince(g_metric_buffer_pop, pop_start);
+        metadata.enter(FrameMetadata::PROCESS);
 
         if (!success || input_frame.empty()) {
             // This should rarely happen with blocking mode, but just in case
@@ -246,100 +318,175 @@ void processing_thread(FrameBuffer& input_buffer, FrameBuffer& output_buffer,
             continue;
         }
 
-        // Reduce input resolution if it's too high, especially for super-res
-        if (g_using_super_res && (input_frame.cols > 480 || input_frame.rows > 270)) {
+        // Reduce input resolution if it's too high, especially for super-res.
+        // The source already delivers max_sr_input, so this only catches
+        // frames from sources that ignored the request.
+        cv::Size input_size = g_i420_pipeline ? yuv::frameSize(input_frame) : input_frame.size();
+        if (g_using_super_res && (input_size.width > max_sr_input.width || input_size.height > max_sr_input.height)) {
             cv::Mat resized_input;
-            double scale = std::min(480.0 / input_frame.cols, 270.0 / input_frame.rows);
-            cv::resize(input_frame, resized_input, cv::Size(), scale, scale, cv::INTER_AREA);
+            double scale = std::min(static_cast<double>(max_sr_input.width) / input_size.width,
+                                    static_cast<double>(max_sr_input.height) / input_size.height);
+            if (g_i420_pipeline) {
+                cv::Size size(std::max(2, cvRound(input_size.width * scale) & ~1),
+                              std::max(2, cvRound(input_size.height * scale) & ~1));
+                yuv::resize(input_frame, resized_input, size, cv::INTER_AREA);
+            } else {
+                cv::resize(input_frame, resized_input, cv::Size(), scale, scale, cv::INTER_AREA);
+            }
             input_frame = resized_input;
         }
 
         // Process the frame with the upscaler
-        timer.start("upscale");
-        bool upscale_success = upscaler.upscale(input_frame, processed_frame);
-        timer.stop("upscale");
+        MetricTimer upscale_timer(g_metric_upscale);
+        TraceScope upscale_span("upscale");
+        bool upscale_success = false;
+        if (async_sr) {
+            // SR runs at its own rate: hand this frame over and pick up
+            // whatever has finished, keeping each output with its source frame
+            pending_sr.push_back(async_sr->submit(input_frame, metadata));
+            
+            bool have_result = false;
+            AsyncSuperRes::Result result;
+            while (!pending_sr.empty() &&
+                   pending_sr.front().wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+                AsyncSuperRes::Result ready = pending_sr.front().get();
+                pending_sr.pop_front();
+                
+                if (ready.dropped) {
+                    g_frames_dropped++;
+                    continue;
+                }
+                if (have_result) {
+                    // A newer result superseded this one before it could be shown
+                    g_frames_dropped++;
+                }
+                result = std::move(ready);
+                have_result = true;
+            }
+            
+            if (!have_result) {
+                continue;
+            }
+            
+            input_frame = result.source;
+            metadata = result.metadata;  // PROCESS was entered before submit
+            processed_frame = result.output;
+            upscale_success = result.success;
+        } else if (scheduler) {
+            // Every frame is kept: the oldest result is only waited for once
+            // all replicas are busy, so outputs leave in source order
+            pending_scheduled.push_back(scheduler->submit(input_frame, metadata));
+            if (pending_scheduled.size() < scheduler->capacity() &&
+                pending_scheduled.front().wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                continue;
+            }
+            
+            DeviceScheduler::Result result = pending_scheduled.front().get();
+            pending_scheduled.pop_front();
+            if (result.dropped) {
+                g_frames_dropped++;
+                continue;
+            }
+            
+            input_frame = result.source;
+            metadata = result.metadata;  // PROCESS was entered before submit
+            processed_frame = result.output;
+            upscale_success = result.success;
+        } else if (governor) {
+            upscale_success = governor->upscale(input_frame, processed_frame);
+        } else if (overlap_transfers) {
+            // The upscaler hands back the previous frame, so its envelope
+            // travels one frame behind the input
+            upscale_success = active->upscaleOverlapped(input_frame, processed_frame);
+            std::swap(metadata, overlapped_metadata);
+            if (upscale_success && processed_frame.empty()) {
+                continue;
+            }
+        } else if (g_i420_pipeline) {
+            upscale_success = active->upscaleI420(input_frame, processed_frame);
+        } else {
+            upscale_success = active->upscale(input_frame, processed_frame);
+        }
+        double current_processing_time = upscale_timer.stop();
+        upscale_span.end();
 
         if (!upscale_success || processed_frame.empty()) {
             std::cerr << "Upscaling failed, using original input" << std::endl;
             // If upscaling fails, resize the input to target size as fallback
-            cv::resize(input_frame, processed_frame, cv::Size(upscaler.getTargetWidth(), upscaler.getTargetHeight()), 
-                      0, 0, cv::INTER_CUBIC);
+            cv::Size target(active->getTargetWidth(), active->getTargetHeight());
+            if (g_i420_pipeline) {
+                yuv::resize(input_frame, processed_frame, target, cv::INTER_CUBIC);
+            } else {
+                cv::resize(input_frame, processed_frame, target, 0, 0, cv::INTER_CUBIC);
+            }
         }
 
-        // Apply temporal blending for smoother transitions
+        // Recursive temporal smoothing, in place; super-res output keeps
+        // more of the current frame
         {
-            std::lock_guard<std::mutex> lock(g_history_mutex);
+            MetricTimer temporal_timer(g_metric_temporal);
+            TemporalFilter::Config temporal_config = temporal_filter.getConfig();
+            temporal_config.history_weight = g_using_super_res ? 0.3f : 0.4f;
+            temporal_filter.setConfig(temporal_config);
 
-            // Add current frame to history
-            if (g_frame_history.size() >= HISTORY_SIZE) {
-                g_frame_history.pop_front();
-            }
-            g_frame_history.push_back(processed_frame.clone());
-
-            // Create a smooth transition by blending frames
-            if (g_frame_history.size() >= 2) {
-                // Get weights for blending based on whether we're using SR
-                float current_weight = g_using_super_res ? 0.7f : 0.6f;
-                float prev_weight = 1.0f - current_weight;
-
-                // Blend current frame with previous frame
-                cv::addWeighted(
-                  g_frame_history.back(), current_weight, 
-                  g_frame_history[g_frame_history.size() - 2], prev_weight, 
-                  0, processed_frame
-                );
+            // Gate the history with the upscaler's flow reliability when it
+            // computes one for frames of this size
+            reliability.release();
+            TemporalConsistency* consistency = active->getTemporalConsistency();
+            if (!g_i420_pipeline && consistency && active->isUsingTemporalConsistency()) {
+                consistency->getReliabilityMask(reliability);
             }
+            temporal_filter.process(processed_frame, processed_frame, reliability);
         }
 
         // Track processing time with exponential moving average
-        double current_processing_time = timer.getDuration("upscale");
         avg_processing_time = (avg_processing_time * 0.9) + (current_processing_time * 0.1);
+        avg_pop_time = (avg_pop_time * 0.9) + (pop_time * 0.1);
 
         // Add performance metrics text
-        timer.start("text_overlay");
+        MetricTimer overlay_timer(g_metric_text_overlay);
         std::string fps_text = "FPS: " + std::to_string(static_cast<int>(1000.0 / 
-                  (avg_processing_time + 
-                   timer.getAverageDuration("buffer_pop") + 
-                   timer.getAverageDuration("output_push"))));
+                  (avg_processing_time + avg_pop_time + avg_push_time)));
 
         std::string buffer_text = "Buffer: " + std::to_string(input_buffer.size()) + 
                       "/" + std::to_string(input_buffer.capacity());
 
         std::string proc_text = "Process: " + std::to_string(static_cast<int>(avg_processing_time)) + " ms";
 
-        std::string mode_text = "Mode: " + (g_using_super_res ? upscaler.getAlgorithmName() : "Bicubic") + 
+        std::string mode_text = "Mode: " + (governor ? governor->getLevel().name :
+                                            g_using_super_res ? active->getAlgorithmName() : "Bicubic") + 
                      " + Temporal Smoothing";
 
-        // Add text overlay - green for bicubic, orange for super-res
+        // Add text overlay - green for bicubic, orange for super-res. I420
+        // frames get light text drawn into the luma plane only
         cv::Scalar text_color = g_using_super_res ? cv::Scalar(0, 165, 255) : cv::Scalar(0, 255, 0);
+        cv::Mat overlay = processed_frame;
+        if (g_i420_pipeline) {
+            cv::Mat u, v;
+            yuv::planes(processed_frame, overlay, u, v);
+            text_color = cv::Scalar(235);
+        }
 
-        cv::putText(processed_frame, fps_text, cv::Point(20, 30), 
+        cv::putText(overlay, fps_text, cv::Point(20, 30), 
           cv::FONT_HERSHEY_SIMPLEX, 0.7, text_color, 2);
-        cv::putText(processed_frame, buffer_text, cv::Point(20, 60), 
+        cv::putText(overlay, buffer_text, cv::Point(20, 60), 
           cv::FONT_HERSHEY_SIMPLEX, 0.7, text_color, 2);
-        cv::putText(processed_frame, proc_text, cv::Point(20, 90), 
+        cv::putText(overlay, proc_text, cv::Point(20, 90), 
           cv::FONT_HERSHEY_SIMPLEX, 0.7, text_color, 2);
-        cv::putText(processed_frame, mode_text, cv::Point(20, 120), 
+        cv::putText(overlay, mode_text, cv::Point(20, 120), 
           cv::FONT_HERSHEY_SIMPLEX, 0.7, text_color, 2);
 
-        timer.stop("text_overlay");
-
-        // Push to output buffer - use non-blocking and handle potential failure
-        timer.start("output_push");
-        // Check output buffer fullness before pushing
-        if (output_buffer.size() >= output_buffer.capacity() * 0.9) {
-            // Wait briefly to allow display thread to consume frames
-            std::this_thread::sleep_for(std::chrono::milliseconds(5));
-        }
+        overlay_timer.stop();
 
-        bool pushed = output_buffer.pushFrame(processed_frame, false);
-        timer.stop("output_push");
+        // Push to output buffer; its drop policy handles a slow display
+        auto output_push_start = Metrics::Clock::now();
+        metadata.exit(FrameMetadata::PROCESS);
+        bool pushed = output_buffer.pushFrame(processed_frame, metadata, true);
+        double push_time = Metrics::instance().recordSince(g_metric_output_push, output_push_start);
+        avg_push_time = (avg_push_time * 0.9) + (push_time * 0.1);
 
         if (pushed) {
             g_frames_processed++;
-        } else {
-            // If push failed, wait for display thread to catch up
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
         }
 
         // Print detailed stats periodically
@@ -347,61 +494,74 @@ void processing_thread(FrameBuffer& input_buffer, FrameBuffer& output_buffer,
             std::cout << "\nProcessed " << g_frames_processed << " frames" << std::endl;
             std::cout << "Current processing time: " << avg_processing_time << " ms" << std::endl;
             std::cout << "Buffer utilization: " << input_buffer.size() << "/" << input_buffer.capacity() << std::endl;
-            timer.printStats();
+            std::cout << g_glass_to_glass_latency.summary("Glass-to-glass latency") << std::endl;
+            std::cout << Metrics::instance().toTable() << std::endl;
         }
     }
 
     std::cout << "Processing thread finished" << std::endl;
 }
 
-// Add this display thread function to your main.cpp file just before the main() function
-
-void displayLoop(FrameBuffer& buffer, Timer& timer,
-                 double fps, int width, int height) {
-    std::cout << "Display thread started" << std::endl;
-    cv::Mat frame;
-    
-    // Create window with a consistent size
-    cv::namedWindow("Video Feed", cv::WINDOW_NORMAL);
-    cv::resizeWindow("Video Feed", 640, 480);
-
-    // Default video parameters
-    int codec = cv::VideoWriter::fourcc('m', 'p', '4', 'v'); // Default MP4V codec
-    std::string extension = ".mp4";      // Default extension
-    double output_fps = fps;             // Use source FPS to maintain correct timing
-    
-    // Configure codec and extension based on format
-    if (g_output_format == "mp4") {
+// Map an output format name to its codec and container extension; unknown
+// formats fall back to MP4
+void selectOutputCodec(std::string& format, int& codec, std::string& extension) {
+    if (format == "mp4") {
         codec = cv::VideoWriter::fourcc('m', 'p', '4', 'v');
         extension = ".mp4";
         std::cout << "Using MP4 format with MP4V codec" << std::endl;
     }
-    else if (g_output_format == "h264") {
+    else if (format == "h264") {
         codec = cv::VideoWriter::fourcc('a', 'v', 'c', '1');
         extension = ".mp4";  // H.264 is a codec that needs a container (.mp4)
         std::cout << "Using H.264 codec in MP4 container" << std::endl;
     }
-    else if (g_output_format == "yuv") {
+    else if (format == "yuv") {
         codec = 0; // Uncompressed YUV
         extension = ".avi";  // Use AVI container for YUV
         std::cout << "Using raw YUV format in AVI container" << std::endl;
     }
-    else if (g_output_format == "avi") {
+    else if (format == "avi") {
         codec = cv::VideoWriter::fourcc('M', 'J', 'P', 'G');
         extension = ".avi";
         std::cout << "Using AVI format with MJPG codec" << std::endl;
     }
-    else if (g_output_format == "mkv") {
+    else if (format == "mkv") {
         codec = cv::VideoWriter::fourcc('X', '2', '6', '4');
         extension = ".mkv";
         std::cout << "Using MKV format with X264 codec" << std::endl;
     }
     else {
-        std::cout << "Unknown format '" << g_output_format << "', using default MP4" << std::endl;
-        g_output_format = "mp4";
+        std::cout << "Unknown format '" << format << "', using default MP4" << std::endl;
+        format = "mp4";
         codec = cv::VideoWriter::fourcc('m', 'p', '4', 'v');
         extension = ".mp4";
     }
+}
+
+// Add this display thread function to your main.cpp file just before the main() function
+
+void displayLoop(FrameBuffer& buffer,
+                 double fps, int width, int height) {
+    std::cout << "Display thread started" << std::endl;
+    Trace::setThreadName("display");
+    ThreadPlacement::instance().apply(ThreadPlacement::DISPLAY);
+    cv::Mat frame;
+    cv::Mat bgr_frame;   // Display conversion of I420 frames
+    FrameMetadata metadata;
+    
+    // Create window with a consistent size
+    if (!g_headless) {
+        cv::namedWindow("Video Feed", cv::WINDOW_NORMAL);
+        cv::resizeWindow("Video Feed", 640, 480);
+    }
+
+    // Default video parameters
+    int codec = cv::VideoWriter::fourcc('m', 'p', '4', 'v'); // Default MP4V codec
+    std::string extension = ".mp4";      // Default extension
+    double output_fps = fps;             // Use source FPS to maintain correct timing
+    
+    // Configure codec and extension based on format
+    selectOutputCodec(g_output_format, codec, extension);
     
     std::cout << "Video will be recorded at source frame rate: " << output_fps << " FPS" << std::endl;
     
@@ -414,18 +574,21 @@ void displayLoop(FrameBuffer& buffer, Timer& timer,
     
     while (g_running) {
         // Get processed frame - use non-blocking to check if frames are available
-        timer.start("display_pop");
-        bool success = buffer.popFrame(frame, false);
-        timer.stop("display_pop");
+        auto display_pop_start = Metrics::Clock::now();
+        bool success = buffer.popFrame(frame, metadata, false);
+        Metrics::instance().recordSince(g_metric_display_pop, display_pop_start);
         
         if (!success) {
             // No frame available, wait a bit and try again
             std::this_thread::sleep_for(std::chrono::milliseconds(1));
             continue;
         }
+        Trace::setFrame(metadata.frame_id);
+        
+        metadata.enter(FrameMetadata::DISPLAY);
         
         // Initialize video writer when the first valid frame is available and saving is enabled
-        if (g_save_video && !g_writer_initialized && !frame.empty()) {
+        if (g_save_video && !g_recorder && !frame.empty()) {
             try {
                 // Create output directory if it doesn't exist
                 std::filesystem::path output_path = g_output_filename;
@@ -448,19 +611,23 @@ void displayLoop(FrameBuffer& buffer, Timer& timer,
                 
                 std::cout << "Creating video file: " << g_output_filename << std::endl;
                 
-                // Initialize video writer with the frame's properties and SOURCE FPS
-                g_video_writer = std::make_unique<cv::VideoWriter>(
-                    g_output_filename, 
-                    codec, 
-                    output_fps, 
-                    cv::Size(frame.cols, frame.rows)
-                );
+                // Encode on the sink's own thread with the frame's properties and
+                // SOURCE FPS; NVENC replaces the H.264-family CPU codecs when present
+                RecordingSink::Config recorder_config;
+                recorder_config.filename = g_output_filename;
+                recorder_config.frame_size = g_i420_pipeline ? yuv::frameSize(frame) : frame.size();
+                recorder_config.i420_input = g_i420_pipeline;
+                recorder_config.fps = output_fps;
+                recorder_config.fourcc = codec;
+                recorder_config.use_nvenc = (g_output_format == "mp4" || g_output_format == "h264" ||
+                                             g_output_format == "mkv");
                 
-                // Check if writer was properly initialized
-                if (g_video_writer->isOpened()) {
-                    g_writer_initialized = true;
+                auto recorder = std::make_unique<RecordingSink>(recorder_config);
+                if (recorder->start()) {
+                    g_recorder = std::move(recorder);
                     std::cout << "Video recording started: " << g_output_filename << std::endl;
-                    std::cout << "Output resolution: " << frame.cols << "x" << frame.rows << std::endl;
+                    std::cout << "Output resolution: " << recorder_config.frame_size.width << "x"
+                              << recorder_config.frame_size.height << std::endl;
                     std::cout << "Output FPS: " << output_fps << " (matching source)" << std::endl;
                     std::cout << "Format: " << g_output_format << std::endl;
                 } else {
@@ -475,17 +642,54 @@ void displayLoop(FrameBuffer& buffer, Timer& timer,
             }
         }
         
+        // Open the stream with the first frame, so it gets the output size
+        if (!g_stream_url.empty() && !g_network_sink && !frame.empty()) {
+            NetworkSink::Config stream_config;
+            stream_config.url = g_stream_url;
+            stream_config.frame_size = g_i420_pipeline ? yuv::frameSize(frame) : frame.size();
+            stream_config.i420_input = g_i420_pipeline;
+            stream_config.fps = output_fps;
+            stream_config.keyframe_interval = std::max(1, static_cast<int>(output_fps));
+            stream_config.bitrate_kbps = g_stream_bitrate_kbps;
+            
+            g_network_sink = std::make_unique<NetworkSink>(stream_config);
+            if (!g_network_sink->start()) {
+                std::cerr << "Streaming disabled" << std::endl;
+                g_stream_url.clear();
+            }
+        }
+        if (g_network_sink && g_network_sink->isRunning() && !frame.empty()) {
+            g_network_sink->write(frame, metadata);
+        }
+        
         // Write the frame to video file if saving is enabled
-        if (g_save_video && g_writer_initialized && !frame.empty()) {
-            timer.start("video_write");
-            g_video_writer->write(frame);
-            timer.stop("video_write");
+        // Only the copy into the sink's queue is on the display path
+        if (g_save_video && g_recorder && !frame.empty()) {
+            MetricTimer write_timer(g_metric_video_write);
+            TraceScope span("encode.queue");
+            g_recorder->write(frame);
+        }
+        
+        // Display frame (the only BGR conversion on the I420 path)
+        if (!g_headless) {
+            MetricTimer show_timer(g_metric_display_show);
+            TraceScope span("render");
+            if (g_i420_pipeline) {
+                yuv::toBGR(frame, bgr_frame);
+                cv::imshow("Video Feed", bgr_frame);
+            } else {
+                cv::imshow("Video Feed", frame);
+            }
         }
+        metadata.exit(FrameMetadata::DISPLAY);
         
-        // Display frame
-        timer.start("display_show");
-        cv::imshow("Video Feed", frame);
-        timer.stop("display_show");
+        // Record where this frame's latency went
+        g_glass_to_glass_latency.record(metadata.glassToGlass());
+        g_capture_latency.record(metadata.stageDuration(FrameMetadata::CAPTURE));
+        g_queue_latency.record(metadata.queueDuration(FrameMetadata::CAPTURE, FrameMetadata::PROCESS) +
+                               metadata.queueDuration(FrameMetadata::PROCESS, FrameMetadata::DISPLAY));
+        g_processing_latency.record(metadata.stageDuration(FrameMetadata::PROCESS));
+        g_display_latency.record(metadata.stageDuration(FrameMetadata::DISPLAY));
         
         g_frames_displayed++;
         
@@ -503,7 +707,7 @@ void displayLoop(FrameBuffer& buffer, Timer& timer,
         last_frame_time = std::chrono::high_resolution_clock::now();
         
         // Check for key commands
-        int key = cv::waitKey(1);
+        int key = g_headless ? -1 : cv::waitKey(1);
         if (key == 'q') {
             g_running = false;
             break;
@@ -512,7 +716,7 @@ void displayLoop(FrameBuffer& buffer, Timer& timer,
             g_save_video = !g_save_video;
             
             if (g_save_video) {
-                if (!g_writer_initialized) {
+                if (!g_recorder) {
                     std::cout << "Video recording will start with the next frame" << std::endl;
                 } else {
                     std::cout << "Video recording resumed" << std::endl;
@@ -525,72 +729,91 @@ void displayLoop(FrameBuffer& buffer, Timer& timer,
             std::string snapshot_filename = "snapshot_" + 
                                           std::to_string(std::chrono::system_clock::now().time_since_epoch().count()) + 
                                           ".jpg";
-            cv::imwrite(snapshot_filename, frame);
+            cv::imwrite(snapshot_filename, g_i420_pipeline ? bgr_frame : frame);
             std::cout << "Snapshot saved to " << snapshot_filename << std::endl;
         }
     }
     
-    // Clean up the video writer
-    if (g_writer_initialized && g_video_writer) {
-        g_video_writer->release();
-        std::cout << "Video recording finished and saved to: " << g_output_filename << std::endl;
+    // main flushes the recording and stream once every thread has been joined
+    if (!g_headless) {
+        cv::destroyAllWindows();
     }
-    
-    cv::destroyAllWindows();
     std::cout << "Display thread finished" << std::endl;
 }
 
-// Super-resolution background thread function
-void sr_thread_function(std::shared_ptr<DnnSuperRes> dnn_sr, int target_width, int target_height) {
-    std::cout << "Super-resolution background thread started" << std::endl;
+// Add this function
+void addMotionBlur(cv::Mat& frame, float strength = 0.5) {
+    cv::Mat blurred;
+    cv::GaussianBlur(frame, blurred, cv::Size(0, 0), 3);
+    cv::addWeighted(frame, 1.0 - strength, blurred, strength, 0, frame);
+}
+
+// Host several streams on shared upscalers and show each in its own window
+int runStreamHost(const std::vector<std::string>& sources, Upscaler::Algorithm algorithm,
+                  int target_width, int target_height, bool realtime, size_t max_batch) {
+    StreamHost::Config host_config;
+    host_config.algorithm = algorithm;
+    host_config.target_width = target_width;
+    host_config.target_height = target_height;
+    host_config.max_batch = max_batch;
+    StreamHost host(host_config);
     
-    while (g_running) {
-        cv::Mat frame_to_process;
-        bool got_frame = false;
+    for (size_t i = 0; i < sources.size(); i++) {
+        StreamHost::StreamConfig stream_config;
+        stream_config.name = "s" + std::to_string(i);
+        stream_config.capture_width = 640;
+        stream_config.capture_height = 360;
+        stream_config.realtime = realtime;
+        if (std::all_of(sources[i].begin(), sources[i].end(), ::isdigit)) {
+            stream_config.camera_index = std::stoi(sources[i]);
+        } else {
+            stream_config.video_source = sources[i];
+        }
         
-        // Get a frame from the queue
-        {
-            std::lock_guard<std::mutex> lock(g_sr_queue_mutex);
-            if (!g_sr_frame_queue.empty()) {
-                frame_to_process = g_sr_frame_queue.front();
-                g_sr_frame_queue.pop();
-                got_frame = true;
-                g_sr_processing_active = true;
+        if (host.addStream(stream_config) < 0) {
+            std::cerr << "Warning: Skipping stream " << sources[i] << std::endl;
+        }
+    }
+    if (host.streamCount() == 0 || !host.start()) {
+        std::cerr << "Error: Could not start the stream host" << std::endl;
+        return -1;
+    }
+    
+    std::cout << "Hosting " << host.streamCount() << " streams. Press 'q' in a video window to quit." << std::endl;
+    
+    cv::Mat frame;
+    FrameMetadata metadata;
+    while (g_running && !host.allFinished()) {
+        for (size_t i = 0; i < host.streamCount(); i++) {
+            if (host.output(i).popFrame(frame, metadata, false) && !g_headless) {
+                cv::imshow("Stream " + host.streamName(i), frame);
             }
         }
         
-        if (got_frame) {
-            // Process with SR
-            cv::Mat sr_output;
-            auto start_time = std::chrono::high_resolution_clock::now();
-            
-            bool success = dnn_sr->upscale(frame_to_process, sr_output);
-            
-            auto end_time = std::chrono::high_resolution_clock::now();
-            double processing_time = std::chrono::duration<double, std::milli>(end_time - start_time).count();
-            
-            if (success) {
-                // Store the result for main thread to use
-                std::lock_guard<std::mutex> lock(g_sr_result_mutex);
-                g_last_sr_result = sr_output.clone();
-                std::cout << "Background SR completed in " << processing_time << " ms" << std::endl;
-            }
-            
-            g_sr_processing_active = false;
-        } else {
-            // No frames to process, sleep to reduce CPU usage
-            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        if (g_headless) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        int key = cv::waitKey(1);
+        if (key == 'q' || key == 27) {
+            g_running = false;
         }
     }
     
-    std::cout << "Super-resolution background thread finished" << std::endl;
-}
-
-// Add this function
-void addMotionBlur(cv::Mat& frame, float strength = 0.5) {
-    cv::Mat blurred;
-    cv::GaussianBlur(frame, blurred, cv::Size(0, 0), 3);
-    cv::addWeighted(frame, 1.0 - strength, blurred, strength, 0, frame);
+    host.stop();
+    if (!g_headless) {
+        cv::destroyAllWindows();
+    }
+    
+    std::cout << "\n=== Streams ===" << std::endl;
+    std::cout << host.toTable() << std::endl;
+    std::cout << "\n=== Stage Timing ===" << std::endl;
+    std::cout << Metrics::instance().toTable() << std::endl;
+    if (!g_metrics_json_path.empty()) {
+        Metrics::instance().dumpJson(g_metrics_json_path);
+    }
+    writeTrace();
+    return 0;
 }
 
 int main(int argc, char* argv[]) {
@@ -607,10 +830,33 @@ int main(int argc, char* argv[]) {
     bool use_super_res = false;    // Default to bicubic upscaling
     int target_width = 1920;       // Default output width (reduced from 1920)
     int target_height = 1080;       // Default output height (reduced from 1080)
-    std::string g_output_format = "mp4"; // Default format
     
     // Declare algorithm variable before command-line parsing
     Upscaler::Algorithm algorithm = Upscaler::BICUBIC; // Default algorithm
+    bool use_async_sr = false;     // Run SR on its own thread, decoupled from capture
+    int metrics_port = 0;          // Serve /metrics over HTTP when non-zero
+    bool offline = false;          // Transcode a file as fast as possible instead of playing it
+    size_t offline_workers = 0;    // Parallel offline workers (0 = automatic)
+    size_t offline_chunk = 32;     // Frames per offline work unit
+    int gpu_count = 1;             // GPUs to spread upscaling across (0 = all)
+    bool use_qos = false;          // Trade quality for the frame deadline at run time
+    bool fast_start = false;       // Stream on bicubic while the SR model loads
+    std::vector<std::string> stream_sources;  // Extra sources hosted on shared upscalers
+    size_t max_batch = 1;          // Frames per SR forward pass in multi-stream and offline modes
+    cv::Size sr_input;             // SR input resolution (empty = per-model default)
+    bool use_i420 = false;         // Carry frames as planar I420 instead of BGR
+    bool overlap = false;          // Overlap host transfers with device work
+    double max_frame_age_ms = 0.0; // Skip live frames older than this (0 = newest wins only)
+    size_t cpu_threads = 0;        // Threads for host kernels (0 = cores left by capture/process/display)
+    ThreadPlacement::Config threading; // Cores, SCHED_FIFO and NUMA node of the pipeline threads
+    std::string raw_capture_path;  // Tap captured frames into a .vpraw file
+    int64_t start_frame = 0;       // First frame of a file source
+    double playback_rate_override = 0.0; // File playback speed (0 = real time, slower with SR)
+    bool skip_duplicates = false;  // Reuse the result of repeated input frames
+    float duplicate_threshold = 1.0f; // Mean thumbnail difference still counted as a repeat
+    bool auto_sr = false;          // Benchmark the models in models/ and run the best that fits
+    bool recalibrate = false;      // Ignore the cached calibration
+    double sr_budget_ms = 0.0;     // Frame budget for calibration (0 = the 30 FPS capture period)
     
     // Process command line arguments
     for (int i = 1; i < argc; i++) {
@@ -635,6 +881,15 @@ int main(int argc, char* argv[]) {
             use_super_res = true;
             algorithm = Upscaler::REAL_ESRGAN; // Set algorithm to REAL_ESRGAN
             std::cout << "RealESRGAN super-resolution upscaling enabled" << std::endl;
+        } else if (arg == "--async-sr") {
+            use_async_sr = true;
+            std::cout << "Asynchronous super-resolution enabled" << std::endl;
+        } else if (arg == "--sr-input") {
+            if (i + 2 < argc) {
+                sr_input.width = std::stoi(argv[++i]);
+                sr_input.height = std::stoi(argv[++i]);
+                std::cout << "Super-resolution input limited to " << sr_input.width << "x" << sr_input.height << std::endl;
+            }
         } else if (arg == "--resolution" || arg == "-res") {
             if (i + 2 < argc) {
                 target_width = std::stoi(argv[++i]);
@@ -700,6 +955,158 @@ int main(int argc, char* argv[]) {
         //         config.motion_threshold = 20.0f; // Higher motion threshold
         //         upscaler.getTemporalConsistency()->setConfig(config);
         //     }
+        } else if (arg == "--offline") {
+            offline = true;
+            std::cout << "Offline transcode mode enabled (no pacing, no dropped frames)" << std::endl;
+        } else if (arg == "--workers") {
+            if (i + 1 < argc) {
+                offline_workers = std::stoul(argv[++i]);
+            }
+        } else if (arg == "--chunk") {
+            if (i + 1 < argc) {
+                offline_chunk = std::stoul(argv[++i]);
+            }
+        } else if (arg == "--qos") {
+            use_qos = true;
+            std::cout << "Quality governor enabled" << std::endl;
+        } else if (arg == "--fast-start") {
+            fast_start = true;
+            std::cout << "Fast start enabled (SR model loads in the background)" << std::endl;
+        } else if (arg == "--fp16") {
+            DnnSuperRes::setDefaultPrecision(DnnSuperRes::PRECISION_FP16);
+            std::cout << "FP16 inference enabled" << std::endl;
+        } else if (arg == "--headless") {
+            g_headless = true;
+            std::cout << "Headless mode enabled (no display windows)" << std::endl;
+        } else if (arg == "--max-age") {
+            if (i + 1 < argc) {
+                max_frame_age_ms = std::stod(argv[++i]);
+            }
+        } else if (arg == "--skip-duplicates") {
+            skip_duplicates = true;
+            std::cout << "Repeated input frames reuse the previous result" << std::endl;
+        } else if (arg == "--duplicate-threshold") {
+            if (i + 1 < argc) {
+                duplicate_threshold = std::stof(argv[++i]);
+            }
+        } else if (arg == "--raw-capture") {
+            if (i + 1 < argc) {
+                raw_capture_path = argv[++i];
+            }
+        } else if (arg == "--seek") {
+            if (i + 1 < argc) {
+                start_frame = std::stoll(argv[++i]);
+            }
+        } else if (arg == "--playback-rate") {
+            if (i + 1 < argc) {
+                playback_rate_override = std::stod(argv[++i]);
+            }
+        } else if (arg == "--auto-sr") {
+            auto_sr = true;
+        } else if (arg == "--recalibrate") {
+            auto_sr = true;
+            recalibrate = true;
+        } else if (arg == "--sr-budget") {
+            if (i + 1 < argc) {
+                sr_budget_ms = std::stod(argv[++i]);
+            }
+        } else if (arg == "--host-memory" || arg == "--device-memory") {
+            // Budget in MB for buffers, temporal history, arenas and SR workspaces
+            if (i + 1 < argc) {
+                MemoryBudget::Config budget = MemoryBudget::instance().getConfig();
+                size_t bytes = std::stoul(argv[++i]) << 20;
+                if (arg == "--host-memory") {
+                    budget.host_bytes = bytes;
+                } else {
+                    budget.device_bytes = bytes;
+                }
+                MemoryBudget::instance().configure(budget);
+            }
+        } else if (arg == "--stream-out") {
+            if (i + 1 < argc) {
+                g_stream_url = argv[++i];
+                std::cout << "Streaming output to " << g_stream_url << std::endl;
+            }
+        } else if (arg == "--stream-bitrate") {
+            if (i + 1 < argc) {
+                g_stream_bitrate_kbps = std::stoi(argv[++i]);
+            }
+        } else if (arg == "--trace") {
+            if (i + 1 < argc) {
+                g_trace_path = argv[++i];
+                Trace::start();
+            }
+        } else if (arg == "--cpu-threads") {
+            if (i + 1 < argc) {
+                cpu_threads = std::stoul(argv[++i]);
+            }
+        } else if (arg == "--pin-capture" || arg == "--pin-process" || arg == "--pin-display" ||
+                   arg == "--pin-sr" || arg == "--pin-pool") {
+            if (i + 1 < argc) {
+                const std::string role_name = arg.substr(6);
+                std::vector<int> cpus;
+                if (!ThreadPlacement::parseCpuList(argv[++i], cpus)) {
+                    std::cerr << "Invalid CPU list for " << arg << ": " << argv[i] << std::endl;
+                    return -1;
+                }
+                for (int role = 0; role < ThreadPlacement::ROLE_COUNT; role++) {
+                    if (role_name == ThreadPlacement::roleName(static_cast<ThreadPlacement::Role>(role))) {
+                        threading.roles[role].cpus = cpus;
+                    }
+                }
+            }
+        } else if (arg == "--rt-priority") {
+            // Capture and display have the deadlines; processing absorbs jitter in the buffers
+            if (i + 1 < argc) {
+                int priority = std::stoi(argv[++i]);
+                threading.roles[ThreadPlacement::CAPTURE].realtime_priority = priority;
+                threading.roles[ThreadPlacement::DISPLAY].realtime_priority = priority;
+            }
+        } else if (arg == "--numa-node") {
+            if (i + 1 < argc) {
+                std::string node = argv[++i];
+                threading.numa_node = node == "gpu" ? ThreadPlacement::GPU_NUMA_NODE : std::stoi(node);
+            }
+        } else if (arg == "--overlap") {
+            overlap = true;
+            std::cout << "Overlapped GPU transfers requested" << std::endl;
+        } else if (arg == "--i420") {
+            use_i420 = true;
+            std::cout << "I420 frame pipeline requested" << std::endl;
+        } else if (arg == "--incremental") {
+            DnnSuperRes::setDefaultIncremental(true);
+            std::cout << "Incremental super-resolution enabled (static tiles are reused)" << std::endl;
+        } else if (arg == "--tensorrt") {
+            DnnSuperRes::setDefaultInferenceBackend(DnnSuperRes::BACKEND_TENSORRT);
+            std::cout << "TensorRT inference requested for ONNX models" << std::endl;
+        } else if (arg == "--openvino") {
+            DnnSuperRes::setDefaultInferenceBackend(DnnSuperRes::BACKEND_OPENVINO);
+            std::cout << "OpenVINO inference requested for CPU-only hosts" << std::endl;
+        } else if (arg == "--int8") {
+            DnnSuperRes::setDefaultInferenceBackend(DnnSuperRes::BACKEND_OPENVINO);
+            DnnSuperRes::setDefaultPrecision(DnnSuperRes::PRECISION_INT8);
+            std::cout << "INT8 inference requested (OpenVINO, FSRCNN/ESPCN)" << std::endl;
+        } else if (arg == "--batch") {
+            if (i + 1 < argc) {
+                max_batch = std::stoul(argv[++i]);
+            }
+        } else if (arg == "--stream") {
+            if (i + 1 < argc) {
+                stream_sources.push_back(argv[++i]);
+            }
+        } else if (arg == "--gpus") {
+            if (i + 1 < argc) {
+                gpu_count = std::stoi(argv[++i]);
+            }
+        } else if (arg == "--metrics-port") {
+            if (i + 1 < argc) {
+                metrics_port = std::stoi(argv[++i]);
+            }
+        } else if (arg == "--metrics-json") {
+            if (i + 1 < argc) {
+                g_metrics_json_path = argv[++i];
+                std::cout << "Metrics will be written to: " << g_metrics_json_path << std::endl;
+            }
         } else if (arg == "--format" || arg == "-fmt") {
             if (i + 1 < argc) {
                 g_output_format = argv[++i];
@@ -732,6 +1139,89 @@ int main(int argc, char* argv[]) {
         }
     }
     
+    // Host kernels and OpenCV's own loops share one pool sized to the cores
+    // the capture, processing and display threads leave free
+    ThreadPlacement::instance().configure(threading);
+    TaskPool::instance().configure(cpu_threads > 0 ? cpu_threads :
+        ThreadPlacement::instance().cpuCount(ThreadPlacement::POOL, TaskPool::threadsBeside(3)));
+    TaskPool::instance().installOpenCVBackend();
+    
+    // Replace the model flags with the best model this node sustains; the
+    // choice becomes the default of every upscaler built from here on
+    if (auto_sr) {
+        SrCalibrator::Config calibration;
+        calibration.use_cache = !recalibrate;
+        calibration.input_size = sr_input;
+        calibration.target_width = target_width;
+        calibration.target_height = target_height;
+        calibration.frame_budget_ms = sr_budget_ms > 0.0 ? sr_budget_ms : 1000.0 / 30.0;
+        
+        SrCalibrator calibrator(calibration);
+        SrCalibrator::Result choice = calibrator.calibrate();
+        std::string table = calibrator.toTable(choice);
+        if (!table.empty()) {
+            std::cout << table << std::endl;
+        }
+        
+        use_super_res = choice.found;
+        algorithm = choice.found ? choice.algorithm : Upscaler::BICUBIC;
+        if (choice.found) {
+            Upscaler::setDefaultModel(choice.algorithm, choice.model);
+        }
+    }
+    
+    // Offline mode bypasses the live threads entirely
+    if (offline) {
+        if (!use_video_file) {
+            std::cerr << "Error: --offline requires a video file input" << std::endl;
+            return -1;
+        }
+        
+        int codec = 0;
+        std::string extension;
+        selectOutputCodec(g_output_format, codec, extension);
+        if (std::filesystem::path(g_output_filename).extension().empty()) {
+            g_output_filename += extension;
+        }
+        
+        OfflineTranscoder::Config offline_config;
+        offline_config.input_path = video_source;
+        offline_config.output_path = g_output_filename;
+        offline_config.algorithm = algorithm;
+        offline_config.target_width = target_width;
+        offline_config.target_height = target_height;
+        offline_config.workers = offline_workers;
+        offline_config.chunk_size = offline_chunk;
+        offline_config.max_batch = max_batch;
+        offline_config.fourcc = codec;
+        offline_config.use_nvenc = (g_output_format == "mp4" || g_output_format == "h264" ||
+                                    g_output_format == "mkv");
+        
+        OfflineTranscoder transcoder(offline_config);
+        g_transcoder = &transcoder;
+        bool transcoded = transcoder.run();
+        g_transcoder = nullptr;
+        
+        std::cout << "\n=== Stage Timing ===" << std::endl;
+        std::cout << Metrics::instance().toTable() << std::endl;
+        if (!g_metrics_json_path.empty()) {
+            Metrics::instance().dumpJson(g_metrics_json_path);
+        }
+        writeTrace();
+        return transcoded ? 0 : -1;
+    }
+    
+    // Several sources share one set of upscalers instead of a pipeline each
+    if (!video_source.empty() && !stream_sources.empty()) {
+        stream_sources.insert(stream_sources.begin(), video_source);
+    }
+    if (stream_sources.size() >= 2) {
+        return runStreamHost(stream_sources, algorithm, target_width, target_height, simulate_realtime, max_batch);
+    } else if (stream_sources.size() == 1) {
+        video_source = stream_sources.front();
+        use_video_file = !std::all_of(video_source.begin(), video_source.end(), ::isdigit);
+    }
+    
     // Create camera or video source
     std::unique_ptr<Camera> source;
     if (use_video_file) {
@@ -742,7 +1232,7 @@ int main(int argc, char* argv[]) {
         
         if (available_cameras.empty()) {
             std::cerr << "No cameras detected! Please connect a camera or provide a video file path." << std::endl;
-            std::cerr << "Usage: " << argv[0] << " [camera_index|video_file_path] [--output filename] [--record] [--fast] [--super-res] [--realesrgan] [--resolution width height] [--format format]" << std::endl;
+            std::cerr << "Usage: " << argv[0] << " [camera_index|video_file_path] [--output filename] [--record] [--fast] [--super-res] [--realesrgan] [--async-sr] [--resolution width height] [--sr-input width height] [--format format] [--metrics-port port] [--metrics-json path] [--gpus N] [--qos] [--stream source]... [--batch N] [--fast-start] [--fp16] [--tensorrt] [--openvino] [--int8] [--incremental] [--i420] [--overlap] [--headless] [--max-age ms] [--cpu-threads N] [--pin-capture|--pin-process|--pin-display|--pin-sr|--pin-pool CPUS] [--rt-priority N] [--numa-node N|gpu] [--raw-capture path] [--seek N] [--playback-rate X] [--skip-duplicates [--duplicate-threshold X]] [--auto-sr [--recalibrate] [--sr-budget ms]] [--stream-out srt://host:port|rtp://host:port [--stream-bitrate kbps]] [--host-memory MB] [--device-memory MB] [--trace path] [--offline [--workers N] [--chunk N]]" << std::endl;
             std::cerr << "Supported formats: mp4, h264, yuv, avi, mkv" << std::endl;
             return -1;
         }
@@ -761,6 +1251,28 @@ int main(int argc, char* argv[]) {
         source = std::make_unique<Camera>(camera_id);
     }
     
+    // RealESRGAN runs tiled inside DnnSuperRes, so its memory no longer grows
+    // with the frame and full 720p input is accepted
+    cv::Size max_sr_input = !sr_input.empty() ? sr_input :
+                            (algorithm == Upscaler::REAL_ESRGAN) ? cv::Size(1280, 720) : cv::Size(480, 270);
+    
+    // SR never sees more than max_sr_input, so have the source deliver that
+    // size instead of decoding, buffering and shrinking full frames
+    if (use_super_res) {
+        source->setMaxOutputSize(max_sr_input);
+    }
+    
+    // The async engine, the multi-GPU scheduler and the governor take BGR
+    // frames, and I420 needs an even output size
+    if (use_i420 && (use_async_sr || gpu_count != 1 || use_qos)) {
+        std::cerr << "Warning: --i420 is ignored with --async-sr, --gpus or --qos" << std::endl;
+    } else if (use_i420 && (target_width % 2 != 0 || target_height % 2 != 0)) {
+        std::cerr << "Warning: --i420 requires an even output resolution" << std::endl;
+    } else if (use_i420) {
+        g_i420_pipeline = true;
+        source->setDeliverI420(true);
+    }
+    
     // Initialize camera or video source with lower resolution for better performance
     int capture_width = 640;
     int capture_height = 360; // Lower than the previous 480 for better performance
@@ -776,6 +1288,10 @@ int main(int argc, char* argv[]) {
         }
     }
     
+    if (start_frame > 0 && !source->seekFrame(start_frame)) {
+        std::cerr << "Warning: could not seek to frame " << start_frame << std::endl;
+    }
+    
     double source_fps = source->getFPS();
     int source_width = source->getWidth();
     int source_height = source->getHeight();
@@ -788,8 +1304,91 @@ int main(int argc, char* argv[]) {
     std::cout << "Using " << (use_super_res ? "Super-Resolution" : "Bicubic") 
               << " upscaling algorithm" << std::endl;
     
+    // Async SR owns its own model; the upscaler then only provides the
+    // fast fallback so the network isn't loaded twice
+    std::unique_ptr<AsyncSuperRes> async_sr;
+    if (use_async_sr && use_super_res) {
+        Upscaler::Model choice = Upscaler::getDefaultModel(algorithm);
+        auto model = std::make_shared<DnnSuperRes>(choice.path, choice.name, choice.scale, choice.type);
+        model->setTargetSize(target_width, target_height);
+        model->setUseGPU(true);
+        
+        if (model->initialize()) {
+            async_sr = std::make_unique<AsyncSuperRes>(model, AsyncSuperRes::Config{});
+            if (!async_sr->start()) {
+                async_sr.reset();
+            }
+        }
+        
+        if (!async_sr) {
+            std::cerr << "Warning: Async super-resolution unavailable, running it inline" << std::endl;
+        }
+    } else if (use_async_sr) {
+        std::cerr << "Warning: --async-sr requires --super-res or --realesrgan" << std::endl;
+    }
+    
+    // Spread upscaling across several GPUs, one replica each. The inline
+    // upscaler below then only provides the fast fallback.
+    std::unique_ptr<DeviceScheduler> scheduler;
+    if (gpu_count != 1 && !async_sr) {
+        DeviceScheduler::Config scheduler_config;
+        scheduler_config.algorithm = algorithm;
+        scheduler_config.target_width = target_width;
+        scheduler_config.target_height = target_height;
+        for (int i = 0; i < gpu_count; i++) {
+            scheduler_config.devices.push_back(i);
+        }
+        
+        scheduler = std::make_unique<DeviceScheduler>(scheduler_config);
+        if (!scheduler->start() || scheduler->deviceCount() < 2) {
+            std::cerr << "Warning: Fewer than two GPUs available, upscaling inline" << std::endl;
+            scheduler.reset();
+        }
+    } else if (gpu_count != 1) {
+        std::cerr << "Warning: --gpus is ignored with --async-sr" << std::endl;
+    }
+    
+    // The governor owns one upscaler per quality level and steps between
+    // them to hold the source frame rate
+    std::unique_ptr<QualityGovernor> governor;
+    if (use_qos && !async_sr && !scheduler) {
+        QualityGovernor::Config qos_config;
+        qos_config.target_width = target_width;
+        qos_config.target_height = target_height;
+        qos_config.target_fps = source_fps > 0 ? source_fps : 30.0;
+        qos_config.top_algorithm = algorithm;
+        
+        governor = std::make_unique<QualityGovernor>(qos_config);
+        if (!governor->initialize()) {
+            std::cerr << "Warning: Quality governor unavailable, using a fixed configuration" << std::endl;
+            governor.reset();
+        }
+    } else if (use_qos) {
+        std::cerr << "Warning: --qos is ignored with --async-sr or --gpus" << std::endl;
+    }
+    
+    // Fast start: the inline upscaler is bicubic until the SR model has
+    // loaded and run once at the real input size on its own thread
+    std::unique_ptr<UpscalerLoader> loader;
+    if (fast_start && use_super_res && !async_sr && !scheduler && !governor) {
+        UpscalerLoader::Config loader_config;
+        loader_config.algorithm = algorithm;
+        loader_config.target_width = target_width;
+        loader_config.target_height = target_height;
+        
+        // The processing thread shrinks SR input to max_sr_input; warm at that shape
+        double scale = std::min({1.0, static_cast<double>(max_sr_input.width) / source_width,
+                                 static_cast<double>(max_sr_input.height) / source_height});
+        loader_config.warmup_size = cv::Size(cvRound(source_width * scale), cvRound(source_height * scale));
+        
+        loader = std::make_unique<UpscalerLoader>(loader_config);
+        loader->start();
+    } else if (fast_start && use_super_res) {
+        std::cerr << "Warning: --fast-start is ignored with --async-sr, --gpus or --qos" << std::endl;
+    }
+    
     // Create upscaler with target resolution and chosen algorithm
-    Upscaler upscaler(algorithm, true);
+    Upscaler upscaler((async_sr || scheduler || governor || loader) ? Upscaler::BICUBIC : algorithm, true);
     if (!upscaler.initialize(target_width, target_height)) {
         std::cerr << "Error: Could not initialize upscaler" << std::endl;
         return -1;
@@ -798,20 +1397,70 @@ int main(int argc, char* argv[]) {
     std::cout << "Upscaler initialized with algorithm: " 
               << upscaler.getAlgorithmName()
               << ", using " << (upscaler.isUsingGPU() ? "GPU" : "CPU") << std::endl;
+    if (skip_duplicates) {
+        upscaler.setDuplicateSkipping(true, duplicate_threshold);
+    }
+    
+    // Overlapping needs the device chain of the inline upscaler; the other
+    // paths manage their own devices, and the I420 path is host-side
+    bool overlap_transfers = overlap && upscaler.overlapsTransfers() && !async_sr && !scheduler &&
+                             !governor && !loader && !g_i420_pipeline;
+    if (overlap && !overlap_transfers) {
+        std::cerr << "Warning: --overlap needs the GPU upscaler without --async-sr, --gpus, --qos, "
+                  << "--fast-start or --i420" << std::endl;
+    }
     
     // Create frame buffers with sizes based on algorithm
     // Use much larger buffers for super-res to prevent drops
-    int raw_buffer_size = use_super_res ? 120 : 60;
-    int processed_buffer_size = use_super_res ? 90 : 60;
+    size_t raw_buffer_size = use_super_res ? 120 : 60;
+    size_t processed_buffer_size = use_super_res ? 90 : 60;
+    
+    // Slots are preallocated at the stream resolutions so steady-state
+    // capture and processing never allocate frame storage. I420 slots are
+    // single-channel with the chroma rows below the luma; input slots are
+    // page-locked when the upscaler uploads them asynchronously.
+    auto slot_size = [](int width, int height) {
+        return g_i420_pipeline ? cv::Size(width, height * 3 / 2) : cv::Size(width, height);
+    };
+    const int frame_type = g_i420_pipeline ? CV_8UC1 : CV_8UC3;
     
-    FrameBuffer raw_buffer(raw_buffer_size);
-    FrameBuffer processed_buffer(processed_buffer_size);
+    // These depths are generous at 1080p and huge at 4K; the host budget
+    // caps them
+    MemoryBudget& memory_budget = MemoryBudget::instance();
+    raw_buffer_size = memory_budget.fit(MemoryBudget::HOST,
+                                        MemoryBudget::frameBytes(slot_size(source_width, source_height), frame_type),
+                                        raw_buffer_size, 2, "capture buffer");
+    FrameBuffer raw_buffer(raw_buffer_size, slot_size(source_width, source_height), frame_type,
+                           overlap_transfers);
+    processed_buffer_size = memory_budget.fit(MemoryBudget::HOST,
+                                              MemoryBudget::frameBytes(slot_size(target_width, target_height), frame_type),
+                                              processed_buffer_size, 2, "display buffer");
+    FrameBuffer processed_buffer(processed_buffer_size, slot_size(target_width, target_height), frame_type);
+    
+    // Files apply backpressure so no frame is lost; live sources keep the
+    // freshest frames, optionally skipping ones that waited too long
+    if (use_video_file) {
+        raw_buffer.setDropPolicy(FrameBuffer::BLOCK);
+        processed_buffer.setDropPolicy(FrameBuffer::BLOCK);
+    } else {
+        if (max_frame_age_ms > 0.0) {
+            raw_buffer.setDropPolicy(FrameBuffer::MAX_AGE, max_frame_age_ms);
+        } else {
+            raw_buffer.setDropPolicy(FrameBuffer::DROP_OLDEST);
+        }
+        processed_buffer.setDropPolicy(FrameBuffer::DROP_OLDEST);
+    }
+    raw_buffer.setName("capture");
+    processed_buffer.setName("display");
     
     std::cout << "Frame buffers initialized with sizes " << raw_buffer_size 
               << " and " << processed_buffer_size << std::endl;
     
-    // Create timer for performance measurement
-    Timer timer;
+    // Expose the metrics registry for scraping while the pipeline runs
+    MetricsServer metrics_server;
+    if (metrics_port > 0 && metrics_server.start(metrics_port)) {
+        std::cout << "Metrics available at http://127.0.0.1:" << metrics_port << "/metrics" << std::endl;
+    }
     
     // For video files, adjust playback rate based on selected algorithm
     double playback_rate = 1.0;
@@ -821,6 +1470,16 @@ int main(int argc, char* argv[]) {
         std::cout << "Video playback rate set to " << playback_rate 
                   << "x due to super-resolution processing" << std::endl;
     }
+    if (use_video_file && playback_rate_override > 0.0) {
+        playback_rate = playback_rate_override;
+        std::cout << "Video playback rate set to " << playback_rate << "x" << std::endl;
+    }
+    
+    // Raw capture tap for deterministic replay
+    RawFrameWriter raw_tap;
+    if (!raw_capture_path.empty()) {
+        raw_tap.open(raw_capture_path, source_fps);
+    }
     
     // Calculate target FPS for frame rate control
     double target_fps = (use_video_file && simulate_realtime) ? 
@@ -830,24 +1489,47 @@ int main(int argc, char* argv[]) {
     std::cout << "Starting pipeline threads..." << std::endl;
     
     std::thread capture(capture_thread, std::ref(*source), std::ref(raw_buffer), 
-                         std::ref(timer), use_video_file, target_fps, use_super_res);
+                         use_video_file, target_fps, use_super_res, &raw_tap);
     std::thread processor(processing_thread, std::ref(raw_buffer), std::ref(processed_buffer), 
-                         std::ref(upscaler), std::ref(timer));
-    std::thread display(displayLoop, std::ref(processed_buffer), std::ref(timer), 
+                         std::ref(upscaler), async_sr.get(), scheduler.get(),
+                         governor.get(), loader.get(), max_sr_input, overlap_transfers);
+    std::thread display(displayLoop, std::ref(processed_buffer), 
                     source_fps, source_width, source_height);
     
     std::cout << "Pipeline running. Press 'q' in the video window to quit." << std::endl;
     std::cout << "Press 'r' to toggle recording, 's' to take a snapshot." << std::endl;
     
-    // Wait for threads to be done
+    // Wait for threads to be done. The display exits first; closing the buffers releases a capture or
+    // processing thread blocked on a full one
+    display.join();
+    raw_buffer.close();
+    processed_buffer.close();
     capture.join();
     processor.join();
-    display.join();
+    raw_tap.close();
+    
+    if (async_sr) {
+        async_sr->stop();
+    }
     
-    // Ensure video writer is properly closed
-    if (g_writer_initialized && g_video_writer) {
-        g_video_writer->release();
+    std::string device_report;
+    if (scheduler) {
+        device_report = scheduler->toTable();
+        scheduler->stop();
+    }
+    
+    // Ensure the recording is flushed and closed
+    if (g_recorder) {
+        g_recorder->stop();
         std::cout << "Video saved to: " << g_output_filename << std::endl;
+        std::cout << "Recorded frames: " << g_recorder->framesWritten()
+                  << " (" << g_recorder->droppedFrames() << " dropped by the encoder queue)" << std::endl;
+    }
+    if (g_network_sink) {
+        g_network_sink->stop();
+        std::cout << "Streamed frames: " << g_network_sink->framesSent()
+                  << " (" << g_network_sink->droppedFrames() << " dropped)" << std::endl;
+        std::cout << g_network_sink->getSendLatency().summary("Capture-to-send") << std::endl;
     }
     
     // Print final statistics
@@ -855,9 +1537,38 @@ int main(int argc, char* argv[]) {
     std::cout << "Total frames captured:  " << g_frames_captured << std::endl;
     std::cout << "Total frames processed: " << g_frames_processed << std::endl;
     std::cout << "Total frames displayed: " << g_frames_displayed << std::endl;
-    std::cout << "Total frames dropped:   " << g_frames_dropped << std::endl;
+    std::cout << "Total frames dropped:   "
+              << g_frames_dropped + raw_buffer.droppedFrames() + processed_buffer.droppedFrames()
+              << " (capture buffer " << raw_buffer.droppedFrames()
+              << ", display buffer " << processed_buffer.droppedFrames() << ")" << std::endl;
+    if (const DuplicateDetector* duplicates = upscaler.getDuplicateDetector()) {
+        DuplicateDetector::Stats stats = duplicates->getStats();
+        std::cout << "Repeated inputs skipped: " << stats.previous_hits + stats.cache_hits
+                  << " of " << stats.checked << " (previous " << stats.previous_hits
+                  << ", cached " << stats.cache_hits << ")" << std::endl;
+    }
+    
+    std::cout << "\n=== Latency ===" << std::endl;
+    std::cout << g_glass_to_glass_latency.summary("Glass-to-glass") << std::endl;
+    std::cout << g_capture_latency.summary("  Capture") << std::endl;
+    std::cout << g_queue_latency.summary("  Queue wait") << std::endl;
+    std::cout << g_processing_latency.summary("  Processing") << std::endl;
+    std::cout << g_display_latency.summary("  Display") << std::endl;
     
-    timer.printStats();
+    std::cout << "\n=== Stage Timing ===" << std::endl;
+    std::cout << Metrics::instance().toTable() << std::endl;
+    std::cout << MemoryBudget::instance().toTable() << std::endl;
+    
+    if (!device_report.empty()) {
+        std::cout << "\n=== GPU Utilisation ===" << std::endl;
+        std::cout << device_report << std::endl;
+    }
+    
+    metrics_server.stop();
+    if (!g_metrics_json_path.empty()) {
+        Metrics::instance().dumpJson(g_metrics_json_path);
+    }
+    writeTrace();
     
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,242 @@
+#include "memory_budget.h"
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <sstream>
+
+#ifdef WITH_CUDA
+#include <opencv2/core/cuda.hpp>
+#endif
+
+struct MemoryBudget::Entry {
+    std::string name;                           // Guarded by MemoryBudget::m_mutex
+    std::atomic<int> pool{HOST};
+    std::atomic<size_t> bytes{0};
+    bool in_use = false;                        // Guarded by MemoryBudget::m_mutex
+};
+
+namespace {
+
+const char* poolName(MemoryBudget::Pool pool) {
+    return pool == MemoryBudget::DEVICE ? "device" : "host";
+}
+
+std::string formatBytes(size_t bytes) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1) << bytes / (1024.0 * 1024.0) << " MB";
+    return out.str();
+}
+
+} // namespace
+
+MemoryBudget::Account::Account(const std::string& name, Pool pool)
+    : m_entry(MemoryBudget::instance().acquireEntry(name, pool)) {
+}
+
+MemoryBudget::Account::~Account() {
+    release();
+}
+
+MemoryBudget::Account::Account(Account&& other) noexcept
+    : m_entry(other.m_entry) {
+    other.m_entry = nullptr;
+}
+
+MemoryBudget::Account& MemoryBudget::Account::operator=(Account&& other) noexcept {
+    if (this != &other) {
+        release();
+        m_entry = other.m_entry;
+        other.m_entry = nullptr;
+    }
+    return *this;
+}
+
+void MemoryBudget::Account::release() {
+    if (!m_entry) {
+        return;
+    }
+    set(0);
+    MemoryBudget& budget = MemoryBudget::instance();
+    std::lock_guard<std::mutex> lock(budget.m_mutex);
+    m_entry->in_use = false;
+    m_entry = nullptr;
+}
+
+void MemoryBudget::Account::set(size_t bytes) {
+    if (!m_entry) {
+        return;
+    }
+    size_t old_bytes = m_entry->bytes.exchange(bytes, std::memory_order_relaxed);
+    if (old_bytes != bytes) {
+        MemoryBudget::instance().charge(static_cast<Pool>(m_entry->pool.load(std::memory_order_relaxed)),
+                                        old_bytes, bytes);
+    }
+}
+
+size_t MemoryBudget::Account::bytes() const {
+    return m_entry ? m_entry->bytes.load(std::memory_order_relaxed) : 0;
+}
+
+void MemoryBudget::Account::rename(const std::string& name) {
+    if (!m_entry) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(MemoryBudget::instance().m_mutex);
+    m_entry->name = name;
+}
+
+void MemoryBudget::Account::setPool(Pool pool) {
+    if (!m_entry || m_entry->pool.load(std::memory_order_relaxed) == pool) {
+        return;
+    }
+    size_t bytes = m_entry->bytes.load(std::memory_order_relaxed);
+    set(0);
+    m_entry->pool.store(pool, std::memory_order_relaxed);
+    set(bytes);
+}
+
+MemoryBudget::MemoryBudget() {
+    for (auto& used : m_used) {
+        used.store(0, std::memory_order_relaxed);
+    }
+}
+
+MemoryBudget& MemoryBudget::instance() {
+    static MemoryBudget budget;
+    return budget;
+}
+
+MemoryBudget::Entry* MemoryBudget::acquireEntry(const std::string& name, Pool pool) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Entry* entry = nullptr;
+    for (const auto& candidate : m_entries) {
+        if (!candidate->in_use) {
+            entry = candidate.get();
+            break;
+        }
+    }
+    if (!entry) {
+        m_entries.push_back(std::make_unique<Entry>());
+        entry = m_entries.back().get();
+    }
+    entry->name = name;
+    entry->pool.store(pool, std::memory_order_relaxed);
+    entry->bytes.store(0, std::memory_order_relaxed);
+    entry->in_use = true;
+    return entry;
+}
+
+void MemoryBudget::charge(Pool pool, size_t old_bytes, size_t new_bytes) {
+    // Unsigned wrap-around makes a decrease a subtraction
+    m_used[pool].fetch_add(new_bytes - old_bytes, std::memory_order_relaxed);
+}
+
+void MemoryBudget::configure(const Config& config) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_config = config;
+    m_config.device_headroom = std::min(std::max(m_config.device_headroom, 0.0), 0.9);
+}
+
+MemoryBudget::Config MemoryBudget::getConfig() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_config;
+}
+
+size_t MemoryBudget::used(Pool pool) const {
+    return m_used[pool].load(std::memory_order_relaxed);
+}
+
+size_t MemoryBudget::available(Pool pool) const {
+    Config config = getConfig();
+    const size_t in_use = used(pool);
+    size_t remaining = std::numeric_limits<size_t>::max();
+
+    const size_t limit = pool == DEVICE ? config.device_bytes : config.host_bytes;
+    if (limit > 0) {
+        remaining = limit > in_use ? limit - in_use : 0;
+    }
+
+#ifdef WITH_CUDA
+    // What the device has free already excludes everything allocated on it,
+    // accounted or not; the headroom keeps cuDNN and driver workspaces alive
+    if (pool == DEVICE && cv::cuda::getCudaEnabledDeviceCount() > 0) {
+        try {
+            cv::cuda::DeviceInfo device;
+            const size_t reserve = static_cast<size_t>(device.totalMemory() * config.device_headroom);
+            const size_t free_bytes = device.freeMemory();
+            remaining = std::min(remaining, free_bytes > reserve ? free_bytes - reserve : 0);
+        } catch (const cv::Exception& e) {
+            std::cerr << "Error querying device memory: " << e.what() << std::endl;
+        }
+    }
+#endif
+    return remaining;
+}
+
+size_t MemoryBudget::fit(Pool pool, size_t unit_bytes, size_t wanted, size_t minimum,
+                         const char* what) const {
+    minimum = std::min(minimum, wanted);
+    if (unit_bytes == 0 || wanted == 0) {
+        return wanted;
+    }
+
+    const size_t remaining = available(pool);
+    size_t units = std::min(wanted, remaining / unit_bytes);
+    units = std::max(units, minimum);
+
+    if (what && units < wanted) {
+        std::cout << "Memory budget: " << what << " reduced from " << wanted << " to " << units
+                  << " (" << formatBytes(unit_bytes) << " each, " << formatBytes(remaining) << " "
+                  << poolName(pool) << " left)" << std::endl;
+    }
+    return units;
+}
+
+std::vector<MemoryBudget::Usage> MemoryBudget::usage() const {
+    std::map<std::pair<std::string, int>, size_t> totals;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto& entry : m_entries) {
+            if (entry->in_use) {
+                totals[{entry->name, entry->pool.load(std::memory_order_relaxed)}] +=
+                    entry->bytes.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    std::vector<Usage> result;
+    for (const auto& total : totals) {
+        result.push_back({total.first.first, static_cast<Pool>(total.first.second), total.second});
+    }
+    std::sort(result.begin(), result.end(), [](const Usage& a, const Usage& b) { return a.bytes > b.bytes; });
+    return result;
+}
+
+std::string MemoryBudget::toTable() const {
+    Config config = getConfig();
+
+    std::ostringstream out;
+    out << "\n=== Memory budget ===\n";
+    out << std::setw(25) << "Component" << " | " << std::setw(8) << "Pool" << " | "
+        << std::setw(12) << "Bytes" << "\n";
+    out << std::string(51, '-') << "\n";
+    for (const Usage& u : usage()) {
+        out << std::setw(25) << u.name << " | " << std::setw(8) << poolName(u.pool) << " | "
+            << std::setw(12) << formatBytes(u.bytes) << "\n";
+    }
+    out << std::string(51, '-') << "\n";
+
+    for (int p = 0; p < POOL_COUNT; p++) {
+        Pool pool = static_cast<Pool>(p);
+        const size_t limit = pool == DEVICE ? config.device_bytes : config.host_bytes;
+        out << std::setw(25) << (std::string("Total ") + poolName(pool)) << " | " << std::setw(8) << ""
+            << " | " << std::setw(12) << formatBytes(used(pool));
+        if (limit > 0) {
+            out << " of " << formatBytes(limit);
+        }
+        out << "\n";
+    }
+    return out.str();
+}
@@ -0,0 +1,511 @@
+#include "metrics.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define METRICS_HAVE_SOCKETS 1
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <cerrno>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+#endif
+
+namespace {
+// Prometheus metric names allow [a-zA-Z0-9_:]; everything else becomes '_'
+std::string prometheusName(const std::string& name) {
+    std::string out = "video_processor_";
+    for (char c : name) {
+        bool valid = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+        out += valid ? c : '_';
+    }
+    return out;
+}
+
+std::string jsonEscape(const std::string& text) {
+    std::string out;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (c == '\n') {
+            out += "\\n";
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+// Single-writer update: no read-modify-write instruction needed
+inline void relaxedAdd(std::atomic<uint64_t>& value, uint64_t delta) {
+    value.store(value.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+}
+
+Metrics& Metrics::instance() {
+    static Metrics metrics;
+    return metrics;
+}
+
+Metrics::Metrics() {
+    m_definitions.reserve(MAX_METRICS);
+}
+
+Metrics::Id Metrics::registerLatency(const std::string& name, const std::string& help) {
+    return registerMetric(name, help, LATENCY);
+}
+
+Metrics::Id Metrics::registerCounter(const std::string& name, const std::string& help) {
+    return registerMetric(name, help, COUNTER);
+}
+
+Metrics::Id Metrics::registerMetric(const std::string& name, const std::string& help, Type type) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (size_t i = 0; i < m_definitions.size(); i++) {
+        if (m_definitions[i].name == name) {
+            if (m_definitions[i].type != type) {
+                std::cerr << "Metric " << name << " already registered with a different type" << std::endl;
+                return INVALID_ID;
+            }
+            return static_cast<Id>(i);
+        }
+    }
+
+    if (m_definitions.size() >= MAX_METRICS) {
+        std::cerr << "Metric registry full, cannot register " << name << std::endl;
+        return INVALID_ID;
+    }
+
+    m_definitions.push_back({name, help, type});
+    return static_cast<Id>(m_definitions.size() - 1);
+}
+
+Metrics::Shard& Metrics::localShard() {
+    thread_local Shard* shard = nullptr;
+    if (!shard) {
+        // First sample from this thread: the only time recording takes a lock
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_shards.push_back(std::make_unique<Shard>());
+        shard = m_shards.back().get();
+    }
+    return *shard;
+}
+
+void Metrics::record(Id id, double latency_ms) {
+    if (id >= MAX_METRICS) {
+        return;
+    }
+
+    uint64_t value_ns = latency_ms > 0.0 ? static_cast<uint64_t>(latency_ms * 1e6) : 0;
+    Shard::Slot& slot = localShard().slots[id];
+
+    relaxedAdd(slot.count, 1);
+    relaxedAdd(slot.sum_ns, value_ns);
+    relaxedAdd(slot.buckets[bucketIndex(value_ns)], 1);
+    if (value_ns < slot.min_ns.load(std::memory_order_relaxed)) {
+        slot.min_ns.store(value_ns, std::memory_order_relaxed);
+    }
+    if (value_ns > slot.max_ns.load(std::memory_order_relaxed)) {
+        slot.max_ns.store(value_ns, std::memory_order_relaxed);
+    }
+}
+
+double Metrics::recordSince(Id id, Clock::time_point start) {
+    double elapsed_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    record(id, elapsed_ms);
+    return elapsed_ms;
+}
+
+void Metrics::add(Id id, uint64_t value) {
+    if (id >= MAX_METRICS) {
+        return;
+    }
+    relaxedAdd(localShard().slots[id].count, value);
+}
+
+Metrics::Snapshot Metrics::snapshot(Id id) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return mergeLocked(id);
+}
+
+std::vector<Metrics::Snapshot> Metrics::snapshotAll() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<Snapshot> snapshots;
+    snapshots.reserve(m_definitions.size());
+    for (size_t i = 0; i < m_definitions.size(); i++) {
+        snapshots.push_back(mergeLocked(static_cast<Id>(i)));
+    }
+    return snapshots;
+}
+
+Metrics::Snapshot Metrics::mergeLocked(Id id) const {
+    Snapshot snapshot;
+    if (id >= m_definitions.size()) {
+        return snapshot;
+    }
+
+    const Definition& definition = m_definitions[id];
+    snapshot.name = definition.name;
+    snapshot.help = definition.help;
+    snapshot.type = definition.type;
+
+    std::vector<uint64_t> buckets(BUCKET_COUNT, 0);
+    uint64_t sum_ns = 0;
+    uint64_t min_ns = UINT64_MAX;
+    uint64_t max_ns = 0;
+
+    for (const auto& shard : m_shards) {
+        const Shard::Slot& slot = shard->slots[id];
+        snapshot.count += slot.count.load(std::memory_order_relaxed);
+        if (definition.type == COUNTER) {
+            continue;
+        }
+        sum_ns += slot.sum_ns.load(std::memory_order_relaxed);
+        min_ns = std::min(min_ns, slot.min_ns.load(std::memory_order_relaxed));
+        max_ns = std::max(max_ns, slot.max_ns.load(std::memory_order_relaxed));
+        for (size_t b = 0; b < BUCKET_COUNT; b++) {
+            buckets[b] += slot.buckets[b].load(std::memory_order_relaxed);
+        }
+    }
+
+    if (definition.type == LATENCY && snapshot.count > 0) {
+        // Bucket totals can trail the count by an in-flight sample
+        uint64_t bucket_total = 0;
+        for (uint64_t b : buckets) {
+            bucket_total += b;
+        }
+
+        snapshot.sum_ms = sum_ns / 1e6;
+        snapshot.min_ms = (min_ns == UINT64_MAX ? 0 : min_ns) / 1e6;
+        snapshot.max_ms = max_ns / 1e6;
+        snapshot.p50_ms = percentileFromBuckets(buckets, bucket_total, 50.0, max_ns);
+        snapshot.p90_ms = percentileFromBuckets(buckets, bucket_total, 90.0, max_ns);
+        snapshot.p99_ms = percentileFromBuckets(buckets, bucket_total, 99.0, max_ns);
+    }
+
+    return snapshot;
+}
+
+size_t Metrics::bucketIndex(uint64_t value_ns) {
+    if (value_ns < SUB_BUCKETS) {
+        return static_cast<size_t>(value_ns);
+    }
+
+#if defined(__GNUC__)
+    int octave = 63 - __builtin_clzll(value_ns);
+#else
+    int octave = 0;
+    for (uint64_t v = value_ns; v > 1; v >>= 1) {
+        octave++;
+    }
+#endif
+    if (octave > MAX_OCTAVE) {
+        return BUCKET_COUNT - 1;
+    }
+
+    // Top SUB_BUCKET_BITS bits below the leading one select the sub-bucket
+    return static_cast<size_t>((octave - SUB_BUCKET_BITS) * SUB_BUCKETS +
+                               (value_ns >> (octave - SUB_BUCKET_BITS)));
+}
+
+uint64_t Metrics::bucketUpperBound(size_t index) {
+    if (index < static_cast<size_t>(SUB_BUCKETS)) {
+        return index + 1;
+    }
+
+    int octave = static_cast<int>(index / SUB_BUCKETS) + SUB_BUCKET_BITS - 1;
+    uint64_t mantissa = index % SUB_BUCKETS + SUB_BUCKETS;
+    return (mantissa + 1) << (octave - SUB_BUCKET_BITS);
+}
+
+double Metrics::percentileFromBuckets(const std::vector<uint64_t>& buckets, uint64_t count,
+                                      double percentile, uint64_t max_ns) {
+    if (count == 0) {
+        return 0.0;
+    }
+
+    uint64_t rank = static_cast<uint64_t>(std::ceil(percentile / 100.0 * count));
+    rank = std::max<uint64_t>(rank, 1);
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); i++) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            // Report the bucket's upper edge, never more than the largest sample
+            uint64_t value = (i == buckets.size() - 1) ? max_ns : std::min(bucketUpperBound(i), max_ns);
+            return value / 1e6;
+        }
+    }
+
+    return max_ns / 1e6;
+}
+
+std::string Metrics::toJson() const {
+    std::vector<Snapshot> snapshots = snapshotAll();
+
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(4);
+    out << "{\"metrics\": [";
+    for (size_t i = 0; i < snapshots.size(); i++) {
+        const Snapshot& s = snapshots[i];
+        out << (i == 0 ? "\n" : ",\n");
+        out << "  {\"name\": \"" << jsonEscape(s.name) << "\"";
+        if (s.type == COUNTER) {
+            out << ", \"type\": \"counter\", \"value\": " << s.count << "}";
+            continue;
+        }
+        out << ", \"type\": \"latency\""
+            << ", \"count\": " << s.count
+            << ", \"mean_ms\": " << s.mean_ms()
+            << ", \"min_ms\": " << s.min_ms
+            << ", \"p50_ms\": " << s.p50_ms
+            << ", \"p90_ms\": " << s.p90_ms
+            << ", \"p99_ms\": " << s.p99_ms
+            << ", \"max_ms\": " << s.max_ms
+            << ", \"sum_ms\": " << s.sum_ms << "}";
+    }
+    out << "\n]}\n";
+    return out.str();
+}
+
+std::string Metrics::toPrometheus() const {
+    std::vector<Snapshot> snapshots = snapshotAll();
+
+    std::ostringstream out;
+    out << std::setprecision(9);
+    for (const Snapshot& s : snapshots) {
+        std::string name = prometheusName(s.name);
+        const std::string& help = s.help.empty() ? s.name : s.help;
+
+        if (s.type == COUNTER) {
+            out << "# HELP " << name << "_total " << help << "\n"
+                << "# TYPE " << name << "_total counter\n"
+                << name << "_total " << s.count << "\n";
+            continue;
+        }
+
+        out << "# HELP " << name << "_ms " << help << "\n"
+            << "# TYPE " << name << "_ms summary\n"
+            << name << "_ms{quantile=\"0.5\"} " << s.p50_ms << "\n"
+            << name << "_ms{quantile=\"0.9\"} " << s.p90_ms << "\n"
+            << name << "_ms{quantile=\"0.99\"} " << s.p99_ms << "\n"
+            << name << "_ms_sum " << s.sum_ms << "\n"
+            << name << "_ms_count " << s.count << "\n"
+            << "# TYPE " << name << "_ms_min gauge\n"
+            << name << "_ms_min " << s.min_ms << "\n"
+            << "# TYPE " << name << "_ms_max gauge\n"
+            << name << "_ms_max " << s.max_ms << "\n";
+    }
+    return out.str();
+}
+
+std::string Metrics::toTable() const {
+    std::vector<Snapshot> snapshots = snapshotAll();
+
+    std::ostringstream out;
+    out << "\n=== Metrics ===\n";
+    out << std::setw(25) << "Metric" << " | "
+        << std::setw(10) << "Count" << " | "
+        << std::setw(10) << "Min (ms)" << " | "
+        << std::setw(10) << "p50 (ms)" << " | "
+        << std::setw(10) << "p99 (ms)" << " | "
+        << std::setw(10) << "Max (ms)" << " | "
+        << std::setw(10) << "Avg (ms)" << "\n";
+    out << std::string(99, '-') << "\n";
+
+    out << std::fixed << std::setprecision(3);
+    for (const Snapshot& s : snapshots) {
+        if (s.count == 0) {
+            continue;
+        }
+        out << std::setw(25) << s.name << " | " << std::setw(10) << s.count;
+        if (s.type == LATENCY) {
+            out << " | " << std::setw(10) << s.min_ms
+                << " | " << std::setw(10) << s.p50_ms
+                << " | " << std::setw(10) << s.p99_ms
+                << " | " << std::setw(10) << s.max_ms
+                << " | " << std::setw(10) << s.mean_ms();
+        }
+        out << "\n";
+    }
+    return out.str();
+}
+
+bool Metrics::dumpJson(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open metrics file: " << path << std::endl;
+        return false;
+    }
+    file << toJson();
+    return file.good();
+}
+
+MetricsServer::MetricsServer()
+    : m_socket(-1), m_running(false) {
+}
+
+MetricsServer::~MetricsServer() {
+    stop();
+}
+
+bool MetricsServer::isRunning() const {
+    return m_running.load();
+}
+
+#ifdef METRICS_HAVE_SOCKETS
+bool MetricsServer::start(int port, const std::string& bind_address) {
+    if (m_running.load()) {
+        return true;
+    }
+
+    m_socket = socket(AF_INET, SOCK_STREAM, 0);
+    if (m_socket < 0) {
+        std::cerr << "Metrics server: failed to create socket: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    int reuse = 1;
+    setsockopt(m_socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    if (inet_pton(AF_INET, bind_address.c_str(), &address.sin_addr) != 1) {
+        std::cerr << "Metrics server: invalid bind address " << bind_address << std::endl;
+        close(m_socket);
+        m_socket = -1;
+        return false;
+    }
+
+    if (bind(m_socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+        listen(m_socket, 8) < 0) {
+        std::cerr << "Metrics server: failed to listen on " << bind_address << ":" << port
+                  << ": " << std::strerror(errno) << std::endl;
+        close(m_socket);
+        m_socket = -1;
+        return false;
+    }
+
+    m_running.store(true);
+    m_thread = std::thread(&MetricsServer::serveLoop, this);
+    std::cout << "Metrics available at http://" << bind_address << ":" << port << "/metrics" << std::endl;
+    return true;
+}
+
+void MetricsServer::stop() {
+    if (!m_running.exchange(false)) {
+        return;
+    }
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    close(m_socket);
+    m_socket = -1;
+}
+
+void MetricsServer::serveLoop() {
+    while (m_running.load()) {
+        // Poll with a timeout so stop() is noticed without closing under accept()
+        pollfd descriptor{m_socket, POLLIN, 0};
+        if (poll(&descriptor, 1, 200) <= 0) {
+            continue;
+        }
+
+        int client = accept(m_socket, nullptr, nullptr);
+        if (client >= 0) {
+            handleClient(client);
+            close(client);
+        }
+    }
+}
+
+void MetricsServer::handleClient(int client) {
+    // A slow or idle client must not stall the next scrape for long
+    timeval timeout{1, 0};
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    std::string request;
+    char chunk[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192) {
+        ssize_t received = recv(client, chunk, sizeof(chunk), 0);
+        if (received <= 0) {
+            break;
+        }
+        request.append(chunk, static_cast<size_t>(received));
+    }
+
+    std::istringstream line(request.substr(0, request.find("\r\n")));
+    std::string method, path;
+    line >> method >> path;
+
+    std::string status = "200 OK";
+    std::string content_type;
+    std::string body;
+
+    if (method != "GET") {
+        status = "405 Method Not Allowed";
+        content_type = "text/plain";
+        body = "Only GET is supported\n";
+    } else if (path == "/metrics") {
+        content_type = "text/plain; version=0.0.4";
+        body = Metrics::instance().toPrometheus();
+    } else if (path == "/metrics.json") {
+        content_type = "application/json";
+        body = Metrics::instance().toJson();
+    } else {
+        status = "404 Not Found";
+        content_type = "text/plain";
+        body = "Try /metrics or /metrics.json\n";
+    }
+
+    std::ostringstream response;
+    response << "HTTP/1.1 " << status << "\r\n"
+             << "Content-Type: " << content_type << "\r\n"
+             << "Content-Length: " << body.size() << "\r\n"
+             << "Connection: close\r\n\r\n"
+             << body;
+
+    std::string data = response.str();
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(client, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            break;
+        }
+        sent += static_cast<size_t>(n);
+    }
+}
+#else
+bool MetricsServer::start(int port, const std::string& bind_address) {
+    std::cerr << "Metrics server is not supported on this platform; use Metrics::dumpJson instead" << std::endl;
+    (void)port;
+    (void)bind_address;
+    return false;
+}
+
+void MetricsServer::stop() {
+    m_running.store(false);
+}
+
+void MetricsServer::serveLoop() {
+}
+
+void MetricsServer::handleClient(int client) {
+    (void)client;
+}
+#endif
@@ -0,0 +1,393 @@
+#include "network_sink.h"
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+// Split "scheme://host:port?query" into host and port
+bool parseHostPort(const std::string& url, std::string& host, int& port) {
+    size_t begin = url.find("://");
+    if (begin == std::string::npos) {
+        return false;
+    }
+    begin += 3;
+    size_t end = url.find_first_of("?/", begin);
+    std::string authority = url.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+
+    size_t colon = authority.rfind(':');
+    if (colon == std::string::npos) {
+        return false;
+    }
+    host = authority.substr(0, colon);
+    try {
+        port = std::stoi(authority.substr(colon + 1));
+    } catch (const std::exception&) {
+        return false;
+    }
+    return port > 0 && port < 65536;
+}
+
+} // namespace
+
+NetworkSink::NetworkSink(const Config& config)
+    : m_config(config),
+      m_sent(0),
+      m_dropped(0),
+      m_running(false),
+      m_stopping(false),
+      m_nvenc(false) {
+    if (m_config.queue_size == 0) {
+        m_config.queue_size = 1;
+    }
+
+    Metrics& metrics = Metrics::instance();
+    m_metric_send = metrics.registerLatency("net.send", "Hand-off of one frame to the stream encoder");
+    m_metric_capture_to_send = metrics.registerLatency("net.capture_to_send", "Capture to network hand-off per frame");
+    m_metric_dropped = metrics.registerCounter("net.frames_dropped", "Frames dropped in front of the stream encoder");
+}
+
+NetworkSink::~NetworkSink() {
+    stop();
+}
+
+NetworkSink::Protocol NetworkSink::protocolOf(const std::string& url) {
+    if (url.rfind("srt://", 0) == 0) {
+        return SRT;
+    }
+    if (url.rfind("rtp://", 0) == 0) {
+        return RTP;
+    }
+    if (url.rfind("udp://", 0) == 0) {
+        return UDP;
+    }
+    return UNKNOWN;
+}
+
+std::string NetworkSink::buildPipeline(const Config& config, bool nvenc) {
+    const Protocol protocol = protocolOf(config.url);
+    std::string host;
+    int port = 0;
+    if (protocol == UNKNOWN || (protocol != SRT && !parseHostPort(config.url, host, port))) {
+        return "";
+    }
+
+    const int gop = std::max(config.keyframe_interval, 1);
+    std::ostringstream pipeline;
+
+    // A one-buffer leaky queue keeps GStreamer from building its own backlog
+    pipeline << "appsrc is-live=true do-timestamp=true format=time"
+             << " ! queue max-size-buffers=1 max-size-bytes=0 max-size-time=0 leaky=downstream"
+             << " ! videoconvert";
+
+    if (nvenc) {
+        // Low-latency preset, CBR without lookahead or B-frames
+        pipeline << " ! video/x-raw,format=NV12"
+                 << " ! nvh264enc preset=low-latency-hq rc-mode=cbr-ld-hq zerolatency=true"
+                 << " bframes=0 rc-lookahead=0 gop-size=" << gop
+                 << " bitrate=" << config.bitrate_kbps;
+    } else {
+        pipeline << " ! video/x-raw,format=I420"
+                 << " ! x264enc tune=zerolatency speed-preset=ultrafast sliced-threads=true"
+                 << " bframes=0 key-int-max=" << gop
+                 << " bitrate=" << config.bitrate_kbps;
+    }
+
+    // Repeat SPS/PPS with every IDR so a viewer can join mid-stream
+    pipeline << " ! h264parse config-interval=-1";
+
+    switch (protocol) {
+        case SRT:
+            // alignment=7 packs seven TS packets per datagram (1316 bytes)
+            pipeline << " ! mpegtsmux alignment=7 latency=0"
+                     << " ! srtsink uri=\"" << config.url << "\" latency=" << config.srt_latency_ms
+                     << " wait-for-connection=false sync=false async=false";
+            break;
+        case RTP:
+            pipeline << " ! rtph264pay config-interval=-1 pt=96 mtu=1400"
+                     << " ! udpsink host=" << host << " port=" << port << " sync=false async=false";
+            break;
+        case UDP:
+        default:
+            pipeline << " ! mpegtsmux alignment=7 latency=0"
+                     << " ! udpsink host=" << host << " port=" << port << " sync=false async=false";
+            break;
+    }
+    return pipeline.str();
+}
+
+bool NetworkSink::start() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_running) {
+        return true;
+    }
+
+    if (m_config.url.empty() || m_config.frame_size.area() == 0) {
+        std::cerr << "Network sink requires a URL and a frame size" << std::endl;
+        return false;
+    }
+    if (protocolOf(m_config.url) == UNKNOWN) {
+        std::cerr << "Unsupported stream URL: " << m_config.url
+                  << " (expected srt://, rtp:// or udp://)" << std::endl;
+        return false;
+    }
+
+    // NVENC first; GStreamer fails to open the pipeline if nvh264enc is missing
+    m_nvenc = false;
+    for (bool nvenc : {true, false}) {
+        if (nvenc && !m_config.use_nvenc) {
+            continue;
+        }
+
+        std::string pipeline = buildPipeline(m_config, nvenc);
+        if (pipeline.empty()) {
+            std::cerr << "Invalid stream URL: " << m_config.url << std::endl;
+            return false;
+        }
+
+        try {
+            m_writer = std::make_unique<cv::VideoWriter>(pipeline, cv::CAP_GSTREAMER, 0,
+                                                         m_config.fps, m_config.frame_size, true);
+        } catch (const cv::Exception& e) {
+            std::cerr << "Error creating stream writer: " << e.what() << std::endl;
+            m_writer.reset();
+        }
+
+        if (m_writer && m_writer->isOpened()) {
+            m_nvenc = nvenc;
+            break;
+        }
+        m_writer.reset();
+        if (nvenc) {
+            std::cout << "NVENC stream encoder unavailable, using x264" << std::endl;
+        }
+    }
+
+    if (!m_writer) {
+        std::cerr << "Failed to open stream " << m_config.url
+                  << " (OpenCV needs GStreamer with the SRT/RTP plugins)" << std::endl;
+        return false;
+    }
+
+    std::cout << "Streaming to " << m_config.url << " with "
+              << (m_nvenc ? "NVENC" : "x264") << " (H.264, " << m_config.bitrate_kbps << " kbps)" << std::endl;
+
+    m_sent = 0;
+    m_dropped = 0;
+    m_send_latency.reset();
+    m_stopping = false;
+    m_running = true;
+    m_worker = std::thread(&NetworkSink::workerLoop, this);
+    return true;
+}
+
+void NetworkSink::stop() {
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_stopping) {
+            // Another thread is draining; return only once the stream is closed
+            m_stopped.wait(lock, [this]() { return !m_stopping; });
+            return;
+        }
+        if (!m_running) {
+            return;
+        }
+        m_stopping = true;
+    }
+
+    m_work_available.notify_all();
+    if (m_worker.joinable()) {
+        m_worker.join();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_writer) {
+            m_writer->release();
+            m_writer.reset();
+        }
+
+        m_running = false;
+        m_stopping = false;
+        m_free.clear();
+
+        std::cout << "Stream closed: " << m_config.url << " (" << m_sent << " frames, "
+                  << m_dropped << " dropped)" << std::endl;
+    }
+    m_stopped.notify_all();
+}
+
+bool NetworkSink::acquireJob(Job& job) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_running || m_stopping) {
+        return false;
+    }
+
+    // Live output: a stale frame gives way instead of blocking the caller
+    if (m_queue.size() >= m_config.queue_size) {
+        job = std::move(m_queue.front());
+        m_queue.pop_front();
+        m_dropped++;
+        Metrics::instance().add(m_metric_dropped);
+        return true;
+    }
+
+    if (!m_free.empty()) {
+        job = std::move(m_free.back());
+        m_free.pop_back();
+    }
+    return true;
+}
+
+bool NetworkSink::enqueue(Job& job, const FrameMetadata& metadata) {
+    job.frame_id = metadata.frame_id;
+    job.capture_time = metadata.capture_time;
+    job.queued_time = FrameMetadata::Clock::now();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_running || m_stopping) {
+            return false;
+        }
+        m_queue.push_back(std::move(job));
+    }
+    m_work_available.notify_one();
+    return true;
+}
+
+bool NetworkSink::write(const cv::Mat& frame, const FrameMetadata& metadata) {
+    if (frame.empty()) {
+        return false;
+    }
+
+    Job job;
+    if (!acquireJob(job)) {
+        return false;
+    }
+
+    // Copy outside the lock so the sender keeps draining meanwhile
+    frame.copyTo(job.host);
+    job.on_device = false;
+    return enqueue(job, metadata);
+}
+
+#ifdef WITH_CUDA
+bool NetworkSink::write(const cv::cuda::GpuMat& frame, const FrameMetadata& metadata,
+                        cv::cuda::Stream& stream) {
+    if (frame.empty()) {
+        return false;
+    }
+    if (m_config.i420_input) {
+        std::cerr << "Device frames can't be streamed by an I420 sink" << std::endl;
+        return false;
+    }
+
+    Job job;
+    if (!acquireJob(job)) {
+        return false;
+    }
+
+    try {
+        frame.copyTo(job.device, stream);
+        if (!job.ready) {
+            job.ready = std::make_shared<cv::cuda::Event>(cv::cuda::Event::DISABLE_TIMING);
+        }
+        job.ready->record(stream);
+        job.on_device = true;
+    } catch (const cv::Exception& e) {
+        std::cerr << "Error queueing device frame for streaming: " << e.what() << std::endl;
+        return false;
+    }
+    return enqueue(job, metadata);
+}
+#endif
+
+bool NetworkSink::isRunning() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_running && !m_stopping;
+}
+
+bool NetworkSink::isHardwareEncoding() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_running && m_nvenc;
+}
+
+uint64_t NetworkSink::framesSent() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_sent;
+}
+
+uint64_t NetworkSink::droppedFrames() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_dropped;
+}
+
+void NetworkSink::workerLoop() {
+    Trace::setThreadName("net.sender");
+
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_work_available.wait(lock, [this]() { return m_stopping || !m_queue.empty(); });
+            if (m_queue.empty()) {
+                // Stopping and fully drained
+                break;
+            }
+
+            job = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+
+        Trace::setFrame(job.frame_id);
+        bool sent;
+        {
+            TraceScope span("net.send");
+            MetricTimer timer(m_metric_send);
+            sent = send(job);
+        }
+
+        if (sent) {
+            SendRecord record{job.frame_id, job.capture_time, job.queued_time, FrameMetadata::Clock::now()};
+            const double capture_to_send = record.captureToSend();
+            if (capture_to_send > 0.0) {
+                m_send_latency.record(capture_to_send);
+                Metrics::instance().record(m_metric_capture_to_send, capture_to_send);
+            }
+            if (m_send_callback) {
+                m_send_callback(record);
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (sent) {
+            m_sent++;
+        }
+        m_free.push_back(std::move(job));
+    }
+}
+
+bool NetworkSink::send(Job& job) {
+    try {
+#ifdef WITH_CUDA
+        if (job.on_device) {
+            job.ready->waitForCompletion();
+            job.device.download(m_staging);
+            m_writer->write(m_staging);
+            return true;
+        }
+#endif
+        if (m_config.i420_input) {
+            // The appsrc caps are BGR; converting here keeps the cost off the
+            // caller's thread
+            cv::cvtColor(job.host, m_staging, cv::COLOR_YUV2BGR_I420);
+            m_writer->write(m_staging);
+            return true;
+        }
+        m_writer->write(job.host);
+        return true;
+    } catch (const cv::Exception& e) {
+        std::cerr << "Error streaming frame: " << e.what() << std::endl;
+        return false;
+    }
+}
@@ -0,0 +1,528 @@
+#include "offline_transcoder.h"
+#include "batched_super_res.h"
+#include "camera.h"
+#include "recording_sink.h"
+#include "temporal_consistency.h"
+#include <algorithm>
+#include <future>
+#include <iostream>
+
+#ifdef WITH_CUDA
+#include <opencv2/core/cuda.hpp>
+#endif
+
+namespace {
+constexpr std::chrono::milliseconds CANCEL_POLL(100);
+}
+
+OfflineTranscoder::OfflineTranscoder(const Config& config)
+    : m_config(config),
+      m_max_pending_chunks(1),
+      m_device_frames(false),
+      m_reader_done(false),
+      m_workers_running(0),
+      m_next_to_write(0),
+      m_cancelled(false),
+      m_frames_read(0),
+      m_frames_written(0),
+      m_upscale_failures(0),
+      m_start_time(std::chrono::steady_clock::now()) {
+    if (m_config.chunk_size == 0) {
+        m_config.chunk_size = 1;
+    }
+    if (m_config.workers == 0) {
+        // A couple of workers keep each GPU busy; on the CPU each worker's
+        // OpenCV kernels are already parallel, so leave headroom for the
+        // reader and encoder threads
+        size_t cores = std::max(1u, std::thread::hardware_concurrency());
+        bool gpu = m_config.use_gpu && Upscaler::isGPUAvailable();
+        m_config.workers = gpu ? 2 * gpuCount() : std::max<size_t>(1, cores / 2);
+    }
+}
+
+OfflineTranscoder::~OfflineTranscoder() {
+    cancel();
+    for (auto& batcher : m_batchers) {
+        batcher->stop();
+    }
+}
+
+size_t OfflineTranscoder::gpuCount() {
+#ifdef WITH_CUDA
+    return static_cast<size_t>(std::max(0, cv::cuda::getCudaEnabledDeviceCount()));
+#else
+    return 0;
+#endif
+}
+
+void OfflineTranscoder::bindDevice(size_t worker) const {
+#ifdef WITH_CUDA
+    if (m_worker_devices[worker] >= 0) {
+        cv::cuda::setDevice(m_worker_devices[worker]);
+    }
+#else
+    (void)worker;
+#endif
+}
+
+void OfflineTranscoder::cancel() {
+    requestCancel();
+    m_chunk_available.notify_all();
+    m_chunk_space.notify_all();
+    m_frame_completed.notify_all();
+}
+
+void OfflineTranscoder::requestCancel() {
+    // Lock-free atomic store only, so signal handlers can call it
+    m_cancelled = true;
+}
+
+OfflineTranscoder::Stats OfflineTranscoder::getStats() const {
+    Stats stats;
+    stats.frames_read = m_frames_read;
+    stats.frames_written = m_frames_written;
+    stats.upscale_failures = m_upscale_failures;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    stats.elapsed_seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - m_start_time).count();
+    return stats;
+}
+
+bool OfflineTranscoder::initialize() {
+    m_source = std::make_unique<Camera>(m_config.input_path);
+    if (!m_source->initialize()) {
+        std::cerr << "Failed to open " << m_config.input_path << " for transcoding" << std::endl;
+        return false;
+    }
+
+    // Each worker owns a full chain, including its own copy of the model,
+    // and workers are dealt round-robin across the GPUs
+    size_t gpus = m_config.use_gpu ? gpuCount() : 0;
+    m_upscalers.clear();
+    m_worker_devices.assign(m_config.workers, -1);
+    for (size_t i = 0; i < m_config.workers && gpus > 0; i++) {
+        m_worker_devices[i] = static_cast<int>(i % gpus);
+    }
+    
+    bool batching = m_config.max_batch > 1 && initializeBatchers(std::max<size_t>(1, gpus));
+    for (size_t i = 0; i < m_config.workers && !batching; i++) {
+        bindDevice(i);
+        
+        auto upscaler = std::make_unique<Upscaler>(m_config.algorithm, m_config.use_gpu);
+        if (!upscaler->initialize(m_config.target_width, m_config.target_height)) {
+            std::cerr << "Failed to initialize upscaler for worker " << i << std::endl;
+            return false;
+        }
+        m_upscalers.push_back(std::move(upscaler));
+    }
+
+    m_device_frames = false;
+#ifdef WITH_CUDA
+    // NVDEC frames stay on the device when every worker runs the device chain
+    // on the decoder's GPU; batching and host upscalers take host frames
+    m_device_frames = m_source->isGpuDecoding() && gpus == 1 && !m_upscalers.empty() &&
+                      m_upscalers.front()->overlapsTransfers();
+    m_decode_stream.reset();
+    if (m_device_frames) {
+        m_decode_stream = std::make_unique<cv::cuda::Stream>();
+        std::cout << "Offline transcode: decoded frames stay on the GPU" << std::endl;
+    }
+#endif
+
+    // Nothing may be dropped offline, so the encoder applies backpressure
+    RecordingSink::Config sink_config;
+    sink_config.filename = m_config.output_path;
+    sink_config.frame_size = cv::Size(m_config.target_width, m_config.target_height);
+    sink_config.fps = m_source->getFPS() > 0 ? m_source->getFPS() : 30.0;
+    sink_config.fourcc = m_config.fourcc;
+    sink_config.use_nvenc = m_config.use_nvenc;
+    sink_config.drop_policy = RecordingSink::BLOCK;
+
+    m_sink = std::make_unique<RecordingSink>(sink_config);
+    if (!m_sink->start()) {
+        return false;
+    }
+
+    // Two chunks per worker keeps everyone fed without decoding far ahead
+    m_max_pending_chunks = m_config.workers * 2;
+    return true;
+}
+
+bool OfflineTranscoder::initializeBatchers(size_t devices) {
+    if (m_config.algorithm != Upscaler::SUPER_RES) {
+        std::cerr << "Warning: Batching only applies to FSRCNN super-resolution" << std::endl;
+        return false;
+    }
+
+    m_batchers.clear();
+    for (size_t d = 0; d < devices; d++) {
+#ifdef WITH_CUDA
+        if (m_config.use_gpu && gpuCount() > 0) {
+            cv::cuda::setDevice(static_cast<int>(d));
+        }
+#endif
+        auto model = std::make_shared<DnnSuperRes>("models/FSRCNN_x4.pb", "fsrcnn", 4, DnnSuperRes::FSRCNN);
+        model->setTargetSize(m_config.target_width, m_config.target_height);
+        model->setUseGPU(m_config.use_gpu);
+
+        BatchedSuperRes::Config batch_config;
+        batch_config.max_batch = m_config.max_batch;
+        auto batcher = std::make_unique<BatchedSuperRes>(model, batch_config);
+        if (!model->initialize() || !batcher->start()) {
+            std::cerr << "Warning: Batched model unavailable, using one upscaler per worker" << std::endl;
+            m_batchers.clear();
+            return false;
+        }
+        m_batchers.push_back(std::move(batcher));
+    }
+
+    std::cout << "Offline batching: " << m_batchers.size() << " model(s), batches of "
+              << m_config.max_batch << std::endl;
+    return true;
+}
+
+bool OfflineTranscoder::run() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_start_time = std::chrono::steady_clock::now();
+        m_chunks.clear();
+        m_completed.clear();
+        m_next_to_write = 0;
+        m_reader_done = false;
+    }
+    m_cancelled = false;
+    m_frames_read = 0;
+    m_frames_written = 0;
+    m_upscale_failures = 0;
+
+    if (!initialize()) {
+        m_sink.reset();
+        m_upscalers.clear();
+        m_source.reset();
+        return false;
+    }
+
+    std::cout << "Offline transcode: " << m_config.input_path << " -> " << m_config.output_path
+              << " with " << m_config.workers << " workers, chunks of " << m_config.chunk_size
+              << " (+" << m_config.overlap << " warm-up)" << std::endl;
+
+    m_workers_running = m_config.workers;
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < m_config.workers; i++) {
+        workers.emplace_back(&OfflineTranscoder::workerLoop, this, i);
+    }
+    std::thread reader(&OfflineTranscoder::readerLoop, this);
+
+    writeLoop();
+
+    reader.join();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    m_sink->stop();
+    m_sink.reset();
+    m_upscalers.clear();
+    m_source.reset();
+
+    Stats stats = getStats();
+    std::cout << "Offline transcode " << (m_cancelled ? "cancelled" : "finished") << ": "
+              << stats.frames_written << "/" << stats.frames_read << " frames in "
+              << stats.elapsed_seconds << " s (" << stats.fps() << " FPS)" << std::endl;
+    if (stats.upscale_failures > 0) {
+        std::cout << "  " << stats.upscale_failures << " frames fell back to bicubic resize" << std::endl;
+    }
+
+    return !m_cancelled && stats.frames_written == stats.frames_read;
+}
+
+bool OfflineTranscoder::pushChunk(Chunk& chunk) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_chunk_space.wait_for(lock, CANCEL_POLL, [this]() {
+        return m_cancelled || m_chunks.size() < m_max_pending_chunks;
+    })) {}
+    if (m_cancelled) {
+        return false;
+    }
+
+    m_chunks.push_back(std::move(chunk));
+    lock.unlock();
+    m_chunk_available.notify_one();
+    return true;
+}
+
+bool OfflineTranscoder::readFrame(Chunk& chunk) {
+    // Fresh storage: chunks hold frames until a worker is done
+#ifdef WITH_CUDA
+    if (m_device_frames) {
+        cv::cuda::GpuMat frame;
+        FrameMetadata metadata;
+        if (!m_source->getFrame(frame, metadata, *m_decode_stream) || frame.empty()) {
+            return false;
+        }
+        // Workers read it on their own streams
+        m_decode_stream->waitForCompletion();
+        chunk.device_frames.push_back(frame);
+        return true;
+    }
+#endif
+
+    cv::Mat frame;
+    if (!m_source->getFrame(frame) || frame.empty()) {
+        return false;
+    }
+    chunk.frames.push_back(frame);
+    return true;
+}
+
+void OfflineTranscoder::readerLoop() {
+    // The last frames of each chunk are replayed as the next one's warm-up;
+    // only the list matching the input kind is ever filled
+    std::deque<cv::Mat> tail;
+#ifdef WITH_CUDA
+    std::deque<cv::cuda::GpuMat> device_tail;
+#endif
+    uint64_t next_frame = 0;
+
+    while (!m_cancelled) {
+        Chunk chunk;
+        chunk.first_frame = next_frame;
+        chunk.frames.reserve(tail.size() + m_config.chunk_size);
+        chunk.frames.assign(tail.begin(), tail.end());
+#ifdef WITH_CUDA
+        chunk.device_frames.assign(device_tail.begin(), device_tail.end());
+#endif
+        chunk.warmup = chunk.size();
+
+        bool end_of_file = false;
+        while (chunk.size() < chunk.warmup + m_config.chunk_size) {
+            if (!readFrame(chunk)) {
+                end_of_file = true;
+                break;
+            }
+            next_frame++;
+            m_frames_read++;
+        }
+
+        if (chunk.size() > chunk.warmup) {
+            tail.clear();
+            size_t keep = std::min(m_config.overlap, chunk.frames.size());
+            tail.assign(chunk.frames.end() - keep, chunk.frames.end());
+#ifdef WITH_CUDA
+            keep = std::min(m_config.overlap, chunk.device_frames.size());
+            device_tail.assign(chunk.device_frames.end() - keep, chunk.device_frames.end());
+#endif
+
+            if (!pushChunk(chunk)) {
+                break;
+            }
+        }
+
+        if (end_of_file) {
+            break;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_reader_done = true;
+    }
+    m_chunk_available.notify_all();
+}
+
+void OfflineTranscoder::workerLoop(size_t worker) {
+    // The upscaler's device resources live on the GPU it was built on
+    bindDevice(worker);
+#ifdef WITH_CUDA
+    std::unique_ptr<cv::cuda::Stream> stream;
+    if (m_device_frames) {
+        stream = std::make_unique<cv::cuda::Stream>();
+    }
+#endif
+
+    while (true) {
+        Chunk chunk;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            // Don't run too far ahead of the writer, or a slow chunk would let
+            // the reorder buffer grow without bound behind it
+            uint64_t reorder_window = m_max_pending_chunks * m_config.chunk_size;
+            while (!m_chunk_available.wait_for(lock, CANCEL_POLL, [this, reorder_window]() {
+                return m_cancelled ||
+                       (m_chunks.empty() && m_reader_done) ||
+                       (!m_chunks.empty() && m_chunks.front().first_frame < m_next_to_write + reorder_window);
+            })) {}
+            if (m_cancelled || m_chunks.empty()) {
+                break;
+            }
+
+            chunk = std::move(m_chunks.front());
+            m_chunks.pop_front();
+        }
+        m_chunk_space.notify_one();
+
+        if (!m_batchers.empty()) {
+            upscaleBatched(worker, chunk);
+            continue;
+        }
+        Upscaler& upscaler = *m_upscalers[worker];
+
+        // Start every chunk from clean temporal state; the warm-up rebuilds it
+        if (TemporalConsistency* temporal = upscaler.getTemporalConsistency()) {
+            temporal->reset();
+        }
+
+#ifdef WITH_CUDA
+        if (stream) {
+            upscaleDeviceChunk(upscaler, chunk, *stream);
+            continue;
+        }
+#endif
+
+        for (size_t i = 0; i < chunk.frames.size() && !m_cancelled; i++) {
+            cv::Mat output;  // Handed to the reorder buffer, so never reused
+            bool success = false;
+            try {
+                success = upscaler.upscale(chunk.frames[i], output) && !output.empty();
+            } catch (const cv::Exception& e) {
+                std::cerr << "Error in offline upscale: " << e.what() << std::endl;
+            }
+
+            if (i < chunk.warmup) {
+                chunk.frames[i].release();
+                continue;
+            }
+
+            completeFrame(chunk.first_frame + (i - chunk.warmup), chunk.frames[i], output, success);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_workers_running--;
+    }
+    m_frame_completed.notify_all();
+}
+
+#ifdef WITH_CUDA
+void OfflineTranscoder::upscaleDeviceChunk(Upscaler& upscaler, Chunk& chunk, cv::cuda::Stream& stream) {
+    cv::Size target_size(m_config.target_width, m_config.target_height);
+    cv::cuda::GpuMat d_output;
+
+    for (size_t i = 0; i < chunk.device_frames.size() && !m_cancelled; i++) {
+        cv::Mat output;     // Handed to the reorder buffer, so never reused
+        cv::Mat source;     // Only downloaded for the bicubic fallback
+        bool success = false;
+        try {
+            success = upscaler.upscale(chunk.device_frames[i], d_output, stream) &&
+                      d_output.size() == target_size;
+
+            if (i >= chunk.warmup) {
+                // The encoder takes host frames: the result is the one transfer
+                if (success) {
+                    d_output.download(output, stream);
+                } else {
+                    chunk.device_frames[i].download(source, stream);
+                }
+                stream.waitForCompletion();
+            }
+        } catch (const cv::Exception& e) {
+            std::cerr << "Error in offline upscale: " << e.what() << std::endl;
+            success = false;
+            if (i >= chunk.warmup && source.empty()) {
+                chunk.device_frames[i].download(source);
+            }
+        }
+        chunk.device_frames[i].release();
+
+        if (i < chunk.warmup) {
+            continue;
+        }
+        completeFrame(chunk.first_frame + (i - chunk.warmup), source, output, success);
+    }
+}
+#endif
+
+void OfflineTranscoder::upscaleBatched(size_t worker, Chunk& chunk) {
+    BatchedSuperRes& batcher = *m_batchers[worker % m_batchers.size()];
+
+    // FSRCNN keeps no history, so the warm-up frames are skipped outright and
+    // the rest of the chunk is queued at once to fill batches
+    std::vector<std::future<BatchedSuperRes::Result>> results;
+    results.reserve(chunk.frames.size() - chunk.warmup);
+    for (size_t i = chunk.warmup; i < chunk.frames.size(); i++) {
+        results.push_back(batcher.submit(chunk.frames[i]));
+    }
+
+    for (size_t i = 0; i < results.size(); i++) {
+        BatchedSuperRes::Result result = results[i].get();
+        if (m_cancelled) {
+            continue;
+        }
+        completeFrame(chunk.first_frame + i, chunk.frames[chunk.warmup + i], result.output, result.success);
+    }
+}
+
+void OfflineTranscoder::completeFrame(uint64_t index, cv::Mat& source, cv::Mat& output, bool success) {
+    cv::Size target_size(m_config.target_width, m_config.target_height);
+    if (!success || output.size() != target_size) {
+        cv::resize(source, output, target_size, 0, 0, cv::INTER_CUBIC);
+        m_upscale_failures++;
+    }
+    source.release();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_completed.emplace(index, std::move(output));
+    }
+    m_frame_completed.notify_one();
+}
+
+void OfflineTranscoder::writeLoop() {
+    auto last_report = std::chrono::steady_clock::now();
+
+    while (true) {
+        cv::Mat frame;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            while (!m_frame_completed.wait_for(lock, CANCEL_POLL, [this]() {
+                return m_workers_running == 0 ||
+                       (!m_completed.empty() && m_completed.begin()->first == m_next_to_write);
+            })) {
+                // requestCancel() can't notify; wake the reader and workers here
+                if (m_cancelled) {
+                    m_chunk_available.notify_all();
+                    m_chunk_space.notify_all();
+                }
+            }
+
+            auto next = m_completed.begin();
+            if (next == m_completed.end() || next->first != m_next_to_write) {
+                // Workers are done; anything left is stranded behind a
+                // cancelled chunk and can't be written in order
+                break;
+            }
+
+            frame = std::move(next->second);
+            m_completed.erase(next);
+            m_next_to_write++;
+        }
+        if (m_next_to_write % m_config.chunk_size == 0) {
+            m_chunk_available.notify_all();
+        }
+
+        // Blocks while the encoder is behind, which in turn holds back the
+        // workers through the bounded chunk queue
+        if (m_sink->write(frame)) {
+            m_frames_written++;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_report >= std::chrono::seconds(5)) {
+            Stats stats = getStats();
+            std::cout << "Transcoded " << stats.frames_written << " frames (" << stats.fps() << " FPS)" << std::endl;
+            last_report = now;
+        }
+    }
+}
@@ -2,9 +2,25 @@
 #include "camera.h"
 #include "frame_buffer.h"
 #include "upscaler.h"
+#include "temporal_consistency.h"
+#include "temporal_filter.h"
 #include "display.h"
+#include "stage_graph.h"
+#include "selective_bilateral.h"
+#include "adaptive_sharpening.h"
+#include "frame_arena.h"
+#include "frame_metadata.h"
+#include "latency_histogram.h"
+#include "metrics.h"
+#include "task_pool.h"
+#include "duplicate_detector.h"
+#include "trace.h"
+#include "network_sink.h"
+#include "memory_budget.h"
+#include "thread_placement.h"
 #include <iostream>
 #include <iomanip>
+#include <array>
 #include <chrono>
 #include <thread>
 #include <mutex>
@@ -17,13 +33,20 @@ using Clock = std::chrono::high_resolution_clock;
 // Implementation class (PIMPL pattern)
 class Pipeline::Impl {
 public:
-    Impl(const Pipeline::Config& config, std::atomic<double>& latency, std::atomic<double>& fps, Timer& timer) 
+    Impl(const Pipeline::Config& config, std::atomic<double>& latency, std::atomic<double>& fps) 
         : m_config(config),
           m_running(false),
           m_frame_counter(0),
           m_latency_ref(latency),
-          m_fps_ref(fps),
-          m_timer_ref(timer) {
+          m_fps_ref(fps) {
+        // Registered up front so the thread loops only touch integer IDs
+        Metrics& metrics = Metrics::instance();
+        m_metric_capture = metrics.registerLatency("pipeline.capture", "Camera frame acquisition");
+        m_metric_buffer_push = metrics.registerLatency("pipeline.buffer_push", "Push into the capture queue");
+        m_metric_buffer_pop = metrics.registerLatency("pipeline.buffer_pop", "Wait for a captured frame");
+        m_metric_upscale = metrics.registerLatency("pipeline.upscale", "Upscaler chain per frame");
+        m_metric_display_push = metrics.registerLatency("pipeline.display_push", "Hand-off to the display stage");
+        m_metric_dropped = metrics.registerCounter("pipeline.frames_dropped", "Frames dropped at a full capture queue");
     }
     
     ~Impl() {
@@ -51,6 +74,27 @@ public:
     }
     
     bool initializeCommon() {
+        // Capture, processing and display keep a core each; with the stage
+        // graph so does each of its (up to six) stage threads
+        size_t pipeline_threads = m_config.stage_graph ? 8 : 3;
+        ThreadPlacement& placement = ThreadPlacement::instance();
+        placement.configure(m_config.threading);
+        TaskPool::instance().configure(m_config.cpu_threads > 0 ?
+            static_cast<size_t>(m_config.cpu_threads) :
+            placement.cpuCount(ThreadPlacement::POOL, TaskPool::threadsBeside(pipeline_threads)));
+        TaskPool::instance().installOpenCVBackend();
+        
+        if (m_config.host_memory_mb > 0 || m_config.device_memory_mb > 0) {
+            MemoryBudget::Config budget = MemoryBudget::instance().getConfig();
+            budget.host_bytes = m_config.host_memory_mb << 20;
+            budget.device_bytes = m_config.device_memory_mb << 20;
+            MemoryBudget::instance().configure(budget);
+        }
+        
+        if (!m_config.trace_path.empty()) {
+            Trace::start();
+        }
+        
         // Initialize camera or video source
         try {
             if (!m_config.video_source.empty()) {
@@ -99,6 +143,9 @@ public:
                 std::cerr << "Failed to initialize upscaler" << std::endl;
                 return false;
             }
+            if (m_config.skip_duplicates) {
+                m_upscaler->setDuplicateSkipping(true, m_config.duplicate_threshold);
+            }
             
             std::cout << "Upscaler initialized with algorithm: " << m_upscaler->getAlgorithmName()
                      << ", using " << (m_upscaler->isUsingGPU() ? "GPU" : "CPU") << std::endl; 
@@ -109,7 +156,8 @@ public:
         
         // Initialize display
         try {
-            m_display = std::make_unique<Display>(m_config.target_width, m_config.target_height);
+            m_display = std::make_unique<Display>(m_config.target_width, m_config.target_height,
+                                                  m_config.display_backend);
             if (!m_display->initialize(m_config.window_name)) {
                 std::cerr << "Failed to initialize display" << std::endl;
                 return false;
@@ -126,20 +174,64 @@ public:
             return false;
         }
         
-        // Initialize frame buffer
+        // The stream sink is created here so it gets the final target size
+        if (!m_config.stream_url.empty() && !m_network_sink) {
+            NetworkSink::Config stream_config;
+            stream_config.url = m_config.stream_url;
+            stream_config.frame_size = cv::Size(m_config.target_width, m_config.target_height);
+            stream_config.fps = m_config.max_display_fps > 0 ? m_config.max_display_fps : m_config.camera_fps;
+            stream_config.keyframe_interval = static_cast<int>(stream_config.fps);
+            stream_config.bitrate_kbps = m_config.stream_bitrate_kbps;
+            m_network_sink = std::make_shared<NetworkSink>(stream_config);
+            m_sinks.push_back(m_network_sink);
+        }
+        
+        // Initialize frame buffers
         try {
-            m_buffer = std::make_unique<FrameBuffer>(m_config.buffer_size);
-            std::cout << "Frame buffer initialized with size " << m_config.buffer_size << std::endl;
+            const cv::Size capture_size(m_camera->getWidth(), m_camera->getHeight());
+            const cv::Size display_size(m_config.target_width, m_config.target_height);
+            size_t capture_capacity = static_cast<size_t>(std::max(m_config.buffer_size, 1));
+            size_t display_capacity = static_cast<size_t>(std::max(m_config.display_buffer_size, 1));
+            
+            if (m_config.buffer_memory_mb > 0) {
+                const size_t bytes = m_config.buffer_memory_mb << 20;
+                const size_t frames = capture_capacity + display_capacity;
+                capture_capacity = FrameBuffer::capacityForBytes(bytes * capture_capacity / frames,
+                                                                 capture_size, CV_8UC3);
+                display_capacity = FrameBuffer::capacityForBytes(bytes * display_capacity / frames,
+                                                                 display_size, CV_8UC3);
+            }
+            
+            // Whatever the request, never allocate past the host budget
+            MemoryBudget& budget = MemoryBudget::instance();
+            capture_capacity = budget.fit(MemoryBudget::HOST, MemoryBudget::frameBytes(capture_size, CV_8UC3),
+                                          capture_capacity, 1, "capture buffer");
+            m_buffer = std::make_unique<FrameBuffer>(capture_capacity, capture_size, CV_8UC3);
+            display_capacity = budget.fit(MemoryBudget::HOST, MemoryBudget::frameBytes(display_size, CV_8UC3),
+                                          display_capacity, 1, "display buffer");
+            m_display_buffer = std::make_unique<FrameBuffer>(display_capacity, display_size, CV_8UC3);
+            m_buffer->setName("pipeline_capture");
+            m_display_buffer->setName("pipeline_display");
+            std::cout << "Frame buffers initialized with " << capture_capacity << " capture and "
+                      << display_capacity << " display frames" << std::endl;
         } catch (const std::exception& e) {
             std::cerr << "Error creating frame buffer: " << e.what() << std::endl;
             return false;
         }
         
-        // Reset performance metrics
-        m_timer_ref.reset();
+        // Reset performance metrics (the metrics registry is cumulative)
         m_latency_ref.store(0.0);
         m_fps_ref.store(0.0);
         m_frame_counter = 0;
+        m_next_frame_id = 0;
+        m_frames_presented = 0;
+        m_frames_repeated = 0;
+        m_frames_superseded = 0;
+        m_glass_to_glass_latency.reset();
+        m_queue_latency.reset();
+        for (auto& histogram : m_stage_latency) {
+            histogram.reset();
+        }
         m_last_fps_update = Clock::now();
         
         std::cout << "Pipeline initialized successfully" << std::endl;
@@ -148,7 +240,7 @@ public:
     
     bool start() {
         // Check if components are initialized
-        if (!m_camera || !m_upscaler || !m_display || !m_buffer) {
+        if (!m_camera || !m_upscaler || !m_display || !m_buffer || !m_display_buffer) {
             std::cerr << "Cannot start: Pipeline not fully initialized" << std::endl;
             return false;
         }
@@ -165,16 +257,38 @@ public:
             return false;
         }
         
+        // A previous stop() closed the buffers
+        m_buffer->reopen();
+        m_display_buffer->reopen();
+        
         // Set running flag
         m_running.store(true);
         
+        // The graph is built once: building it moves modules out of the upscaler
+        if (m_config.stage_graph) {
+            if (!m_graph) {
+                buildStageGraph();
+            }
+            if (!m_graph->start()) {
+                m_running.store(false);
+                return false;
+            }
+        }
+        
+        // A sink that fails to open is skipped; the pipeline still runs
+        for (const auto& sink : m_sinks) {
+            if (!sink->start()) {
+                std::cerr << "Output sink " << sink->describe() << " failed to start" << std::endl;
+            }
+        }
+        
         // Start threads
         try {
             m_capture_thread = std::make_unique<std::thread>(&Pipeline::Impl::captureLoop, this);
             m_processing_thread = std::make_unique<std::thread>(&Pipeline::Impl::processingLoop, this);
             m_display_thread = std::make_unique<std::thread>(&Pipeline::Impl::displayLoop, this);
             
-            std::cout << "Pipeline started with " << m_config.buffer_size 
+            std::cout << "Pipeline started with " << m_buffer->capacity() 
                     << " frame buffer" << std::endl;
             return true;
         }
@@ -198,20 +312,48 @@ public:
             m_capture_thread.reset();
         }
         
+        // The processing thread may be blocked popping an empty ring
+        if (m_buffer) {
+            m_buffer->close();
+        }
+        
         if (m_processing_thread && m_processing_thread->joinable()) {
             m_processing_thread->join();
             m_processing_thread.reset();
         }
         
+        // Frames already in the graph drain into the display queue
+        if (m_graph) {
+            m_graph->stop();
+        }
+        
+        // Queued frames still drain; a blocked pop wakes up
+        if (m_display_buffer) {
+            m_display_buffer->close();
+        }
+        
         if (m_display_thread && m_display_thread->joinable()) {
             m_display_thread->join();
             m_display_thread.reset();
         }
         
-        // Clear the buffer
+        // Flush the sinks once the display has handed them its last frame
+        for (const auto& sink : m_sinks) {
+            sink->stop();
+        }
+        
+        // Clear the buffers
         if (m_buffer) {
             m_buffer->clear();
         }
+        if (m_display_buffer) {
+            m_display_buffer->clear();
+        }
+        
+        if (!m_config.trace_path.empty() && Trace::enabled()) {
+            Trace::stop();
+            Trace::dump(m_config.trace_path);
+        }
         
         std::cout << "Pipeline stopped" << std::endl;
     }
@@ -222,7 +364,9 @@ public:
     
     bool waitForKey(int key) {
         while (isRunning()) {
-            int pressed = cv::waitKey(100); // Check every 100ms
+            // The display thread owns the window and collects key presses
+            std::this_thread::sleep_for(std::chrono::milliseconds(100)); // Check every 100ms
+            int pressed = m_display ? m_display->takeLastKey() : -1;
             
             if (pressed == key) {
                 stop();
@@ -250,16 +394,59 @@ public:
         std::cout << "Effective FPS: " << std::fixed << std::setprecision(1) 
                 << m_fps_ref.load() << std::endl;
         
-        // Print detailed component timing from the timer
-        m_timer_ref.printStats();
+        // Latency distributions built from the per-frame metadata
+        std::cout << m_glass_to_glass_latency.summary("Glass-to-glass") << std::endl;
+        std::cout << m_stage_latency[FrameMetadata::CAPTURE].summary("  Capture") << std::endl;
+        std::cout << m_queue_latency.summary("  Queue wait") << std::endl;
+        std::cout << m_stage_latency[FrameMetadata::PROCESS].summary("  Processing") << std::endl;
+        std::cout << m_stage_latency[FrameMetadata::DISPLAY].summary("  Display") << std::endl;
+        std::cout << "Presented frames: " << m_frames_presented.load()
+                  << " (repeated " << m_frames_repeated.load()
+                  << ", superseded " << m_frames_superseded.load() << ")" << std::endl;
+        
+        if (m_upscaler && m_upscaler->getDuplicateDetector()) {
+            DuplicateDetector::Stats duplicates = m_upscaler->getDuplicateDetector()->getStats();
+            std::cout << "Repeated inputs skipped: " << duplicates.previous_hits + duplicates.cache_hits
+                      << " of " << duplicates.checked << " (previous " << duplicates.previous_hits
+                      << ", cached " << duplicates.cache_hits << ")" << std::endl;
+        }
+        
+        if (m_network_sink) {
+            std::cout << m_network_sink->getSendLatency().summary("Capture-to-send") << std::endl;
+            std::cout << "Streamed frames: " << m_network_sink->framesSent()
+                      << " (" << m_network_sink->droppedFrames() << " dropped)" << std::endl;
+        }
+        
+        if (m_graph) {
+            std::cout << "Stage graph:\n" << m_graph->toTable() << std::endl;
+        }
+        
+        // Print detailed component timing from the metrics registry
+        std::cout << Metrics::instance().toTable() << std::endl;
+        std::cout << MemoryBudget::instance().toTable() << std::endl;
+    }
+    
+    double getLatencyPercentile(double percentile) const {
+        return m_glass_to_glass_latency.percentile(percentile);
+    }
+    
+    void addSink(std::shared_ptr<FrameSink> sink) {
+        if (sink) {
+            m_sinks.push_back(std::move(sink));
+        }
     }
     
 private:
     // Components (using unique_ptr to avoid copy/move issues)
     std::unique_ptr<Camera> m_camera;
     std::unique_ptr<FrameBuffer> m_buffer;
+    std::unique_ptr<FrameBuffer> m_display_buffer;
     std::unique_ptr<Upscaler> m_upscaler;
     std::unique_ptr<Display> m_display;
+    TemporalFilter m_temporal_filter;
+    std::unique_ptr<StageGraph> m_graph;   // Replaces the sequential chain when configured
+    std::vector<std::shared_ptr<FrameSink>> m_sinks;
+    std::shared_ptr<NetworkSink> m_network_sink;  // Created from Config::stream_url, also in m_sinks
     
     // Configuration
     Pipeline::Config m_config;
@@ -277,29 +464,60 @@ private:
     // Performance monitoring (references to outer class members)
     std::atomic<double>& m_latency_ref;
     std::atomic<double>& m_fps_ref;
-    Timer& m_timer_ref;
+    
+    // Hot-path metric IDs
+    Metrics::Id m_metric_capture;
+    Metrics::Id m_metric_buffer_push;
+    Metrics::Id m_metric_buffer_pop;
+    Metrics::Id m_metric_upscale;
+    Metrics::Id m_metric_display_push;
+    Metrics::Id m_metric_dropped;
     
     // Local performance tracking
     std::chrono::time_point<std::chrono::high_resolution_clock> m_last_fps_update;
     int m_frame_counter;
     std::mutex m_perf_mutex;
     
+    // Per-frame latency tracking
+    uint64_t m_next_frame_id = 0;
+    LatencyHistogram m_glass_to_glass_latency;
+    LatencyHistogram m_queue_latency;
+    std::array<LatencyHistogram, FrameMetadata::STAGE_COUNT> m_stage_latency;
+    
+    // Display pacing statistics
+    std::atomic<uint64_t> m_frames_presented{0};
+    std::atomic<uint64_t> m_frames_repeated{0};
+    std::atomic<uint64_t> m_frames_superseded{0};
+    
     // Thread loop functions
     void captureLoop() {
         std::cout << "Capture thread started" << std::endl;
+        Trace::setThreadName("capture");
+        ThreadPlacement::instance().apply(ThreadPlacement::CAPTURE);
         cv::Mat frame;
+        FrameMetadata metadata;
         int dropped_frames = 0;
         
         while (m_running.load()) {
-            // Measure capture time
-            m_timer_ref.start("capture");
-            auto capture_start_time = Clock::now();
+            // Wait for the camera's next frame; the timeout rechecks m_running
+            if (!m_camera->waitForFrame(100)) {
+                continue;
+            }
+            
+            // Measure capture time; failed grabs are not recorded
+            MetricTimer capture_timer(m_metric_capture);
+            metadata = FrameMetadata();
+            metadata.enter(FrameMetadata::CAPTURE);
             
             // Get frame from camera
-            bool success = m_camera->getFrame(frame);
+            Trace::setFrame(m_next_frame_id);
+            TraceScope capture_span("capture");
+            bool success = m_camera->getFrame(frame, metadata);
+            capture_span.end();
             
             if (!success || frame.empty()) {
                 std::cerr << "Failed to capture frame" << std::endl;
+                capture_timer.cancel();
                 
                 // Check if we've reached the end of a video file
                 if (!m_camera->isOpened()) {
@@ -312,16 +530,19 @@ private:
                 continue;
             }
             
-            m_timer_ref.stop("capture");
+            capture_timer.stop();
+            metadata.exit(FrameMetadata::CAPTURE);
+            metadata.frame_id = m_next_frame_id++;
             
             // Try to push to buffer (non-blocking)
-            m_timer_ref.start("buffer_push");
-            bool pushed = m_buffer->pushFrame(frame, false);
-            m_timer_ref.stop("buffer_push");
+            auto push_start = Metrics::Clock::now();
+            bool pushed = m_buffer->pushFrame(frame, metadata, false);
+            Metrics::instance().recordSince(m_metric_buffer_push, push_start);
             
             if (!pushed) {
                 // Buffer full, frame dropped
                 dropped_frames++;
+                Metrics::instance().add(m_metric_dropped);
                 
                 if (dropped_frames % 10 == 0) {
                     std::cerr << "Warning: Dropped " << dropped_frames << " frames due to full buffer" << std::endl;
@@ -350,19 +571,25 @@ private:
     
     void processingLoop() {
         std::cout << "Processing thread started" << std::endl;
-        cv::Mat input_frame, output_frame;
+        Trace::setThreadName("process");
+        ThreadPlacement::instance().apply(ThreadPlacement::PROCESSING);
+        cv::Mat input_frame, output_frame, reliability;
+        FrameMetadata metadata;
         
-        // Use a structure to store frame timestamps for latency tracking
-        struct FrameData {
-            cv::Mat frame;
-            std::chrono::time_point<std::chrono::high_resolution_clock> capture_time;
-        };
+        TemporalFilter::Config temporal_config;
+        temporal_config.history_weight = m_config.temporal_history_weight;
+        m_temporal_filter.setConfig(temporal_config);
+        m_temporal_filter.reset();
         
         while (m_running.load()) {
             // Get frame from buffer (blocking)
-            m_timer_ref.start("buffer_pop");
-            bool success = m_buffer->popFrame(input_frame, true);
-            m_timer_ref.stop("buffer_pop");
+            auto pop_start = Metrics::Clock::now();
+            TraceScope pop_span("buffer.wait");
+            bool success = m_buffer->popFrame(input_frame, metadata, true);
+            Trace::setFrame(success ? metadata.frame_id : Trace::NO_FRAME);
+            pop_span.setFrame(Trace::currentFrame());
+            pop_span.end();
+            Metrics::instance().recordSince(m_metric_buffer_pop, pop_start);
             
             if (!success || input_frame.empty()) {
                 // Buffer might be empty due to shutdown
@@ -374,49 +601,216 @@ private:
                 continue;
             }
             
-            // Record when we got this frame for processing
-            auto process_time = Clock::now();
+            // The graph processes the frame on its stage threads and its
+            // sink hands it to the display; pushing blocks while it is full
+            if (m_graph) {
+                metadata.enter(FrameMetadata::PROCESS);
+                m_graph->push(input_frame, metadata, true);
+                continue;
+            }
             
             // Upscale the frame
-            m_timer_ref.start("upscale");
+            metadata.enter(FrameMetadata::PROCESS);
+            auto upscale_start = Metrics::Clock::now();
+            TraceScope upscale_span("upscale");
             bool upscale_success = m_upscaler->upscale(input_frame, output_frame);
-            m_timer_ref.stop("upscale");
+            upscale_span.end();
+            Metrics::instance().recordSince(m_metric_upscale, upscale_start);
+            metadata.exit(FrameMetadata::PROCESS);
             
             if (!upscale_success) {
                 std::cerr << "Failed to upscale frame" << std::endl;
                 continue;
             }
             
-            // Pass the processed frame to the display thread via another buffer
-            FrameData fd{output_frame, process_time};
-            
-            // In a real implementation, we would pass this directly to the display thread
-            // with frame metadata. For this example, we'll just render immediately.
-            m_display->renderFrame(output_frame);
-            
-            // Measure latency from capture to display
-            auto display_time = Clock::now();
-            auto latency = std::chrono::duration<double, std::milli>(display_time - process_time).count();
+            // Smooth over time, gated by the upscaler's flow reliability
+            if (m_config.temporal_filter) {
+                TemporalConsistency* consistency = m_upscaler->getTemporalConsistency();
+                if (!consistency || !m_upscaler->isUsingTemporalConsistency() ||
+                    !consistency->getReliabilityMask(reliability)) {
+                    reliability.release();
+                }
+                TraceScope span("temporal_filter");
+                m_temporal_filter.process(output_frame, output_frame, reliability);
+            }
             
-            // Update moving average of latency (simple low-pass filter)
-            double current = m_latency_ref.load();
-            double updated = (current * 0.9) + (latency * 0.1); // 90% old, 10% new
-            m_latency_ref.store(updated);
+            // Hand off to the display stage; rendering never blocks processing.
+            // A full queue means the display is behind, so this frame is dropped.
+            auto display_push_start = Metrics::Clock::now();
+            if (!m_display_buffer->pushFrame(output_frame, metadata, false)) {
+                m_frames_superseded++;
+            }
+            Metrics::instance().recordSince(m_metric_display_push, display_push_start);
         }
         
         std::cout << "Processing thread exiting" << std::endl;
     }
     
+    // Split the upscaler's host chain into one graph stage per module. The
+    // device chain shares one stream, so a GPU upscaler stays a single stage.
+    void buildStageGraph() {
+        m_graph = std::make_unique<StageGraph>(static_cast<size_t>(std::max(m_config.stage_queue_size, 1)));
+        
+        const bool split = !m_upscaler->isUsingGPU() && m_config.upscale_algorithm == Upscaler::REAL_ESRGAN;
+        SelectiveBilateral* pre = split && m_upscaler->isUsingSelectiveBilateral() ?
+            m_upscaler->getBilateralPreProcessor() : nullptr;
+        AdaptiveSharpening* sharpening = split && m_upscaler->isUsingAdaptiveSharpening() ?
+            m_upscaler->getAdaptiveSharpening() : nullptr;
+        SelectiveBilateral* post = split && m_upscaler->isUsingSelectiveBilateral() ?
+            m_upscaler->getBilateralPostProcessor() : nullptr;
+        TemporalConsistency* temporal = split && m_upscaler->isUsingTemporalConsistency() ?
+            m_upscaler->getTemporalConsistency() : nullptr;
+        
+        if (split) {
+            // The split-out modules run beside upscale() instead of inside it
+            m_upscaler->setUseSelectiveBilateral(false);
+            m_upscaler->setUseAdaptiveSharpening(false);
+            m_upscaler->setUseTemporalConsistency(false);
+        }
+        
+        if (pre) {
+            // Each stage runs on its own thread, so none may keep using the
+            // upscaler's feature cache or scratch arena
+            pre->setArena(std::make_shared<FrameArena>());
+            pre->setFeatures(nullptr);
+            m_graph->addStage("pre_bilateral", [pre](const cv::Mat& in, cv::Mat& out, FrameMetadata&) {
+                return pre->process(in, out);
+            });
+        }
+        m_graph->addStage("upscale", [this](const cv::Mat& in, cv::Mat& out, FrameMetadata&) {
+            return m_upscaler->upscale(in, out);
+        });
+        if (sharpening) {
+            // Sharpening shares the upscaler's scratch arena, which is not
+            // safe across threads
+            sharpening->setArena(std::make_shared<FrameArena>());
+            sharpening->setFeatures(nullptr);
+            m_graph->addStage("sharpen", [sharpening](const cv::Mat& in, cv::Mat& out, FrameMetadata&) {
+                return sharpening->process(in, out);
+            });
+        }
+        if (post) {
+            post->setArena(std::make_shared<FrameArena>());
+            post->setFeatures(nullptr);
+            m_graph->addStage("post_bilateral", [post](const cv::Mat& in, cv::Mat& out, FrameMetadata&) {
+                return post->process(in, out);
+            });
+        }
+        if (temporal) {
+            temporal->setFeatures(nullptr);
+            m_graph->addStage("temporal", [temporal](const cv::Mat& in, cv::Mat& out, FrameMetadata&) {
+                return temporal->process(in, out);
+            });
+        }
+        if (m_config.temporal_filter) {
+            TemporalFilter::Config temporal_config;
+            temporal_config.history_weight = m_config.temporal_history_weight;
+            m_temporal_filter.setConfig(temporal_config);
+            m_temporal_filter.reset();
+            m_graph->addStage("temporal_filter", [this](const cv::Mat& in, cv::Mat& out, FrameMetadata&) {
+                return m_temporal_filter.process(in, out);
+            });
+        }
+        
+        // Same hand-off as the sequential path: never block on the display
+        m_graph->setSink([this](const cv::Mat& frame, const FrameMetadata& metadata) {
+            FrameMetadata finished = metadata;
+            finished.exit(FrameMetadata::PROCESS);
+            if (!m_display_buffer->pushFrame(frame, finished, false)) {
+                m_frames_superseded++;
+            }
+        });
+    }
+    
+    // Fold a displayed frame's stamps into the latency histograms
+    void recordLatency(const FrameMetadata& metadata) {
+        m_glass_to_glass_latency.record(metadata.glassToGlass());
+        m_queue_latency.record(metadata.queueDuration(FrameMetadata::CAPTURE, FrameMetadata::PROCESS) +
+                               metadata.queueDuration(FrameMetadata::PROCESS, FrameMetadata::DISPLAY));
+        for (int stage = 0; stage < FrameMetadata::STAGE_COUNT; ++stage) {
+            m_stage_latency[stage].record(metadata.stageDuration(static_cast<FrameMetadata::Stage>(stage)));
+        }
+        
+        // Expose the median capture-to-display latency
+        m_latency_ref.store(m_glass_to_glass_latency.percentile(50.0));
+    }
+    
     void displayLoop() {
         std::cout << "Display thread started" << std::endl;
+        Trace::setThreadName("display");
+        ThreadPlacement::instance().apply(ThreadPlacement::DISPLAY);
         
-        // This implementation uses direct rendering in the processing thread
-        // In a more advanced implementation, this would be a separate thread
-        // that takes frames from a queue and renders them with precise timing
+        // Presentation cadence. With VSync enabled the Display paces itself
+        // inside renderFrame(); otherwise this loop runs a fixed-rate clock.
+        const bool paced = m_config.max_display_fps > 0;
+        const bool display_paces = paced && m_config.enable_vsync;
+        const auto interval = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(paced ? 1.0 / m_config.max_display_fps : 0.0));
+        auto next_present = Clock::now();
+        
+        cv::Mat frame, newest;
+        FrameMetadata metadata, newest_metadata;
+        bool have_frame = false;
         
-        // For now, just keep the thread alive
         while (m_running.load()) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            if (paced && !display_paces) {
+                std::this_thread::sleep_until(next_present);
+                next_present += interval;
+                
+                // After a long stall resynchronize instead of presenting a burst
+                if (Clock::now() > next_present + interval) {
+                    next_present = Clock::now() + interval;
+                }
+            }
+            
+            // Latest frame wins: anything older that arrived since the last
+            // tick is dropped rather than shown late
+            bool got_new = false;
+            while (m_display_buffer->popFrame(frame, metadata, false)) {
+                if (got_new) {
+                    m_frames_superseded++;
+                }
+                cv::swap(newest, frame);
+                newest_metadata = metadata;
+                got_new = true;
+            }
+            
+            if (!got_new) {
+                if (!have_frame || !paced) {
+                    // Nothing to show yet (or unpaced): keep the window alive
+                    m_display->processEvents();
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                    continue;
+                }
+                
+                // Processing jittered: hold the previous frame for this tick
+                m_frames_repeated++;
+                if (display_paces) {
+                    m_display->renderFrame(newest);
+                } else {
+                    m_display->processEvents();
+                }
+                continue;
+            }
+            
+            have_frame = true;
+            Trace::setFrame(newest_metadata.frame_id);
+            newest_metadata.enter(FrameMetadata::DISPLAY);
+            
+            // Sinks only copy the frame; encoding runs on their own threads
+            for (const auto& sink : m_sinks) {
+                if (sink->isRunning()) {
+                    sink->write(newest, newest_metadata);
+                }
+            }
+            {
+                TraceScope span("render");
+                m_display->renderFrame(newest);
+            }
+            newest_metadata.exit(FrameMetadata::DISPLAY);
+            m_frames_presented++;
+            
+            recordLatency(newest_metadata);
         }
         
         std::cout << "Display thread exiting" << std::endl;
@@ -425,12 +819,12 @@ private:
 
 // Pipeline implementation (delegates to Impl)
 Pipeline::Pipeline() 
-    : m_impl(std::make_unique<Impl>(Config(), m_latency, m_fps, m_timer)) {
+    : m_impl(std::make_unique<Impl>(Config(), m_latency, m_fps)) {
 }
 
 Pipeline::Pipeline(const Config& config) 
     : m_config(config),
-      m_impl(std::make_unique<Impl>(config, m_latency, m_fps, m_timer)) {
+      m_impl(std::make_unique<Impl>(config, m_latency, m_fps)) {
 }
 
 Pipeline::~Pipeline() = default;
@@ -463,6 +857,10 @@ double Pipeline::getLatency() const {
     return m_latency.load();
 }
 
+double Pipeline::getLatencyPercentile(double percentile) const {
+    return m_impl->getLatencyPercentile(percentile);
+}
+
 double Pipeline::getFPS() const {
     return m_fps.load();
 }
@@ -491,6 +889,15 @@ void Pipeline::setDisplayOptions(bool show_metrics) {
     m_impl->setDisplayOptions(show_metrics);
 }
 
+void Pipeline::addSink(std::shared_ptr<FrameSink> sink) {
+    if (isRunning()) {
+        std::cerr << "Cannot add a sink while pipeline is running" << std::endl;
+        return;
+    }
+    
+    m_impl->addSink(std::move(sink));
+}
+
 void Pipeline::printPerformanceStats() const {
     m_impl->printPerformanceStats();
 }
\ No newline at end of file
@@ -8,6 +8,7 @@
 #include <opencv2/cudaarithm.hpp>
 #include <opencv2/cudaimgproc.hpp>
 #include <opencv2/cudafilters.hpp>
+#include "gpu_utils.h"
 #endif
 
 // Implementation class definition
@@ -18,6 +19,11 @@ public:
     virtual void process(const cv::Mat& input, cv::Mat& output, 
                          const std::vector<Processor::Operation>& operations,
                          double& processing_time) = 0;
+#ifdef WITH_CUDA
+    virtual void process(const cv::cuda::GpuMat& input, cv::cuda::GpuMat& output,
+                         const std::vector<Processor::Operation>& operations,
+                         cv::cuda::Stream& stream, double& processing_time) = 0;
+#endif
 };
 
 // CPU implementation
@@ -56,6 +62,22 @@ public:
         auto end_time = std::chrono::high_resolution_clock::now();
         processing_time = std::chrono::duration<double, std::milli>(end_time - start_time).count();
     }
+    
+#ifdef WITH_CUDA
+    void process(const cv::cuda::GpuMat& input, cv::cuda::GpuMat& output,
+                 const std::vector<Processor::Operation>& operations,
+                 cv::cuda::Stream& stream, double& processing_time) override {
+        // The CPU path was chosen explicitly, so device frames take one round trip
+        input.download(m_h_input, stream);
+        stream.waitForCompletion();
+        process(m_h_input, m_h_output, operations, processing_time);
+        output.upload(m_h_output, stream);
+    }
+    
+private:
+    cv::Mat m_h_input;
+    cv::Mat m_h_output;
+#endif
 };
 
 #ifdef WITH_CUDA
@@ -71,11 +93,9 @@ public:
             return false;
         }
         
-        // Set the current device (using the first one)
-        cv::cuda::setDevice(0);
-        
-        // Get device info
-        cv::cuda::DeviceInfo device_info;
+        // Use whichever device the calling thread is bound to, so a
+        // processor created on a DeviceScheduler thread runs on that GPU
+        cv::cuda::DeviceInfo device_info(cv::cuda::getDevice());
         std::cout << "Using GPU: " << device_info.name() 
                   << " (compute capability: " << device_info.majorVersion() 
                   << "." << device_info.minorVersion() << ")" << std::endl;
@@ -94,38 +114,98 @@ public:
         // Start timing
         auto start_time = std::chrono::high_resolution_clock::now();
         
-        // Upload input to GPU
-        cv::cuda::GpuMat d_input;
-        d_input.upload(input);
+        if (!m_stream) {
+            m_stream = std::make_unique<cv::cuda::Stream>();
+        }
+        
+        // Nothing is uploaded until the first device operation needs it
+        Result result = runOperations(&input, nullptr, operations, *m_stream);
+        if (result.host) {
+            result.host->copyTo(output);
+        } else {
+            result.device->download(output, *m_stream);
+            m_stream->waitForCompletion();
+        }
+        
+        // Calculate processing time
+        auto end_time = std::chrono::high_resolution_clock::now();
+        processing_time = std::chrono::duration<double, std::milli>(end_time - start_time).count();
+    }
+    
+    void process(const cv::cuda::GpuMat& input, cv::cuda::GpuMat& output,
+                 const std::vector<Processor::Operation>& operations,
+                 cv::cuda::Stream& stream, double& processing_time) override {
+        
+        if (input.empty()) {
+            return;
+        }
+        
+        auto start_time = std::chrono::high_resolution_clock::now();
+        
+        Result result = runOperations(nullptr, &input, operations, stream);
+        if (result.device) {
+            result.device->copyTo(output, stream);
+        } else {
+            output.upload(*result.host, stream);
+        }
         
-        // Apply each enabled operation
-        // Note: For GPU processing, ideally each operation would be implemented
-        // to work directly with GpuMat to avoid unnecessary transfers
-        cv::cuda::GpuMat d_output = d_input;
-        cv::cuda::GpuMat d_temp;
-        cv::Mat h_temp;
+        // Only host time is measured here; device work may still be queued
+        auto end_time = std::chrono::high_resolution_clock::now();
+        processing_time = std::chrono::duration<double, std::milli>(end_time - start_time).count();
+    }
+    
+private:
+    // Where the current frame lives; exactly one pointer is set
+    struct Result {
+        const cv::Mat* host = nullptr;
+        const cv::cuda::GpuMat* device = nullptr;
+    };
+    
+    std::unique_ptr<cv::cuda::Stream> m_stream;
+    
+    // Ping-pong buffers on each side, reused across frames
+    cv::cuda::GpuMat m_d_frame;
+    cv::cuda::GpuMat m_d_temp;
+    cv::Mat m_h_frame;
+    cv::Mat m_h_temp;
+    
+    // Apply the enabled operations, moving the frame between host and device
+    // only where the residency of consecutive operations changes
+    Result runOperations(const cv::Mat* h_input, const cv::cuda::GpuMat* d_input,
+                         const std::vector<Processor::Operation>& operations,
+                         cv::cuda::Stream& stream) {
+        Result current;
+        current.host = h_input;
+        current.device = d_input;
         
         for (const auto& op : operations) {
             if (!op.enabled) {
                 continue;
             }
             
-            // For this implementation, we'll download to CPU, apply the operation, 
-            // and upload back to GPU. In a real implementation, operations should
-            // be GPU-native to avoid this overhead.
-            d_output.download(h_temp);
-            cv::Mat h_result;
-            op.func(h_temp, h_result);
-            d_temp.upload(h_result);
-            d_output = d_temp;
+            if (op.gpu_func) {
+                if (!current.device) {
+                    m_d_frame.upload(*current.host, stream);
+                    current.device = &m_d_frame;
+                    current.host = nullptr;
+                }
+                op.gpu_func(*current.device, m_d_temp, stream);
+                std::swap(m_d_frame, m_d_temp);
+                current.device = &m_d_frame;
+            } else {
+                if (!current.host) {
+                    current.device->download(m_h_frame, stream);
+                    stream.waitForCompletion();
+                    current.host = &m_h_frame;
+                    current.device = nullptr;
+                }
+                op.func(*current.host, m_h_temp);
+                std::swap(m_h_frame, m_h_temp);
+                current.host = &m_h_frame;
+            }
         }
         
-        // Download result back to CPU
-        d_output.download(output);
-        
-        // Calculate processing time
-        auto end_time = std::chrono::high_resolution_clock::now();
-        processing_time = std::chrono::duration<double, std::milli>(end_time - start_time).count();
+        return current;
     }
 };
 #endif
@@ -192,22 +272,57 @@ bool Processor::process(const cv::Mat& input, cv::Mat& output) {
     return true;
 }
 
+#ifdef WITH_CUDA
+bool Processor::process(const cv::cuda::GpuMat& input, cv::cuda::GpuMat& output, cv::cuda::Stream& stream) {
+    if (!m_initialized || !m_impl) {
+        std::cerr << "Processor not initialized" << std::endl;
+        return false;
+    }
+    
+    if (input.empty()) {
+        std::cerr << "Input frame is empty" << std::endl;
+        return false;
+    }
+    
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    double processing_time = 0.0;
+    try {
+        m_impl->process(input, output, m_operations, stream, processing_time);
+    } catch (const cv::Exception& e) {
+        std::cerr << "Error in device processing: " << e.what() << std::endl;
+        return false;
+    }
+    m_last_processing_time = processing_time;
+    
+    return true;
+}
+#endif
+
 Processor& Processor::addOperation(const std::string& name, ProcessFunction func) {
     std::lock_guard<std::mutex> lock(m_mutex);
     m_operations.emplace_back(name, func);
     return *this;
 }
 
+#ifdef WITH_CUDA
+Processor& Processor::addOperation(const std::string& name, ProcessFunction func, GpuProcessFunction gpu_func) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_operations.emplace_back(name, func, gpu_func);
+    return *this;
+}
+#endif
+
 Processor& Processor::addDefaultPreProcessing() {
     // Add common pre-processing operations
     
     // Noise reduction (Gaussian blur)
-    addOperation("denoise", [](const cv::Mat& input, cv::Mat& output) {
+    auto denoise = [](const cv::Mat& input, cv::Mat& output) {
         cv::GaussianBlur(input, output, cv::Size(5, 5), 0);
-    });
+    };
     
     // Color correction
-    addOperation("color_correction", [](const cv::Mat& input, cv::Mat& output) {
+    auto color_correction = [](const cv::Mat& input, cv::Mat& output) {
         cv::cvtColor(input, output, cv::COLOR_BGR2YUV);
         std::vector<cv::Mat> channels;
         cv::split(output, channels);
@@ -217,7 +332,40 @@ Processor& Processor::addDefaultPreProcessing() {
         
         cv::merge(channels, output);
         cv::cvtColor(output, output, cv::COLOR_YUV2BGR);
-    });
+    };
+    
+#ifdef WITH_CUDA
+    // Device state is created on first use, so nothing touches the GPU
+    // unless the GPU path actually runs
+    auto denoise_filter = std::make_shared<cv::Ptr<cv::cuda::Filter>>();
+    addOperation("denoise", denoise,
+        [denoise_filter](const cv::cuda::GpuMat& input, cv::cuda::GpuMat& output, cv::cuda::Stream& stream) {
+            if (!*denoise_filter) {
+                *denoise_filter = cv::cuda::createGaussianFilter(CV_8UC1, CV_8UC1, cv::Size(5, 5), 0);
+            }
+            gpu_utils::applyPerChannel(*denoise_filter, input, output, stream);
+        });
+    
+    struct ColorBuffers {
+        cv::cuda::GpuMat yuv;
+        cv::cuda::GpuMat equalized;
+        std::vector<cv::cuda::GpuMat> channels;
+    };
+    auto color_buffers = std::make_shared<ColorBuffers>();
+    addOperation("color_correction", color_correction,
+        [color_buffers](const cv::cuda::GpuMat& input, cv::cuda::GpuMat& output, cv::cuda::Stream& stream) {
+            ColorBuffers& b = *color_buffers;
+            cv::cuda::cvtColor(input, b.yuv, cv::COLOR_BGR2YUV, 0, stream);
+            cv::cuda::split(b.yuv, b.channels, stream);
+            cv::cuda::equalizeHist(b.channels[0], b.equalized, stream);
+            std::swap(b.channels[0], b.equalized);
+            cv::cuda::merge(b.channels, b.yuv, stream);
+            cv::cuda::cvtColor(b.yuv, output, cv::COLOR_YUV2BGR, 0, stream);
+        });
+#else
+    addOperation("denoise", denoise);
+    addOperation("color_correction", color_correction);
+#endif
     
     return *this;
 }
@@ -226,18 +374,37 @@ Processor& Processor::addDefaultPostProcessing() {
     // Add common post-processing operations
     
     // Sharpen
-    addOperation("sharpen", [](const cv::Mat& input, cv::Mat& output) {
-        cv::Mat kernel = (cv::Mat_<float>(3, 3) <<
-            -1, -1, -1,
-            -1,  9, -1,
-            -1, -1, -1);
+    cv::Mat kernel = (cv::Mat_<float>(3, 3) <<
+        -1, -1, -1,
+        -1,  9, -1,
+        -1, -1, -1);
+    auto sharpen = [kernel](const cv::Mat& input, cv::Mat& output) {
         cv::filter2D(input, output, -1, kernel);
-    });
+    };
     
     // Contrast enhancement
-    addOperation("contrast", [](const cv::Mat& input, cv::Mat& output) {
+    auto contrast = [](const cv::Mat& input, cv::Mat& output) {
         input.convertTo(output, -1, 1.2, 10);
-    });
+    };
+    
+#ifdef WITH_CUDA
+    auto sharpen_filter = std::make_shared<cv::Ptr<cv::cuda::Filter>>();
+    addOperation("sharpen", sharpen,
+        [sharpen_filter, kernel](const cv::cuda::GpuMat& input, cv::cuda::GpuMat& output, cv::cuda::Stream& stream) {
+            if (!*sharpen_filter) {
+                *sharpen_filter = cv::cuda::createLinearFilter(CV_8UC1, CV_8UC1, kernel);
+            }
+            gpu_utils::applyPerChannel(*sharpen_filter, input, output, stream);
+        });
+    
+    addOperation("contrast", contrast,
+        [](const cv::cuda::GpuMat& input, cv::cuda::GpuMat& output, cv::cuda::Stream& stream) {
+            input.convertTo(output, -1, 1.2, 10, stream);
+        });
+#else
+    addOperation("sharpen", sharpen);
+    addOperation("contrast", contrast);
+#endif
     
     return *this;
 }
@@ -0,0 +1,230 @@
+#include "quality_governor.h"
+#include "temporal_consistency.h"
+#include <iostream>
+
+#ifdef WITH_CUDA
+#include <opencv2/core/cuda.hpp>
+#endif
+
+QualityGovernor::QualityGovernor(const Config& config)
+    : m_config(config),
+      m_level(0),
+      m_deadline_ms(0.0),
+      m_average_ms(0.0),
+      m_slow_frames(0),
+      m_fast_frames(0),
+      m_frames_since_switch(0),
+      m_switches(0),
+      m_device(-1),
+      m_stopping(false) {
+    if (m_config.ladder.empty()) {
+        m_config.ladder = defaultLadder(m_config.top_algorithm);
+    }
+    if (m_config.target_fps <= 0.0) {
+        m_config.target_fps = 30.0;
+    }
+    m_deadline_ms = 1000.0 / m_config.target_fps;
+
+    // Levels sharing an algorithm share a slot; slots follow ladder order
+    for (const Level& level : m_config.ladder) {
+        size_t slot = 0;
+        while (slot < m_slots.size() && m_slots[slot]->algorithm != level.algorithm) {
+            slot++;
+        }
+        if (slot == m_slots.size()) {
+            auto entry = std::make_unique<Slot>();
+            entry->algorithm = level.algorithm;
+            m_slots.push_back(std::move(entry));
+        }
+        m_level_slot.push_back(slot);
+    }
+    m_level_cost_ms.assign(m_config.ladder.size(), 0.0);
+
+    Metrics& metrics = Metrics::instance();
+    m_metric_upscale = metrics.registerLatency("qos.upscale", "Upscaling per frame under the quality governor");
+    m_metric_switches = metrics.registerCounter("qos.switches", "Quality ladder switches");
+}
+
+QualityGovernor::~QualityGovernor() {
+    m_stopping = true;
+    if (m_warmup.joinable()) {
+        m_warmup.join();
+    }
+}
+
+std::vector<QualityGovernor::Level> QualityGovernor::defaultLadder(Upscaler::Algorithm top) {
+    std::vector<Level> ladder;
+    if (top == Upscaler::REAL_ESRGAN) {
+        ladder.push_back({"RealESRGAN + all enhancements", Upscaler::REAL_ESRGAN, true, true, true});
+        ladder.push_back({"RealESRGAN, no temporal", Upscaler::REAL_ESRGAN, true, true, false});
+        ladder.push_back({"RealESRGAN + sharpening", Upscaler::REAL_ESRGAN, false, true, false});
+        ladder.push_back({"RealESRGAN", Upscaler::REAL_ESRGAN, false, false, false});
+    }
+    if (top == Upscaler::REAL_ESRGAN || top == Upscaler::SUPER_RES) {
+        ladder.push_back({"FSRCNN super-res", Upscaler::SUPER_RES, false, false, false});
+    }
+    if (top != Upscaler::BILINEAR && top != Upscaler::NEAREST) {
+        // The bicubic path runs its own edge-aware enhancement
+        ladder.push_back({"Bicubic + edge enhancement", Upscaler::BICUBIC, false, false, false});
+    }
+    ladder.push_back({"Bilinear", Upscaler::BILINEAR, false, false, false});
+    return ladder;
+}
+
+bool QualityGovernor::buildSlot(Slot& slot) {
+    try {
+#ifdef WITH_CUDA
+        if (m_device >= 0) {
+            cv::cuda::setDevice(m_device);
+        }
+#endif
+        auto upscaler = std::make_unique<Upscaler>(slot.algorithm, m_config.use_gpu);
+        if (!upscaler->initialize(m_config.target_width, m_config.target_height)) {
+            return false;
+        }
+        slot.upscaler = std::move(upscaler);
+        slot.ready.store(true, std::memory_order_release);
+        return true;
+    } catch (const cv::Exception& e) {
+        std::cerr << "Error preparing quality level: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool QualityGovernor::initialize() {
+#ifdef WITH_CUDA
+    if (m_config.use_gpu && cv::cuda::getCudaEnabledDeviceCount() > 0) {
+        m_device = cv::cuda::getDevice();
+    }
+#endif
+
+    // The top level is needed right away; everything else warms up behind it
+    if (!buildSlot(*m_slots[m_level_slot[0]])) {
+        std::cerr << "Failed to initialize top quality level: " << m_config.ladder[0].name << std::endl;
+        return false;
+    }
+
+    m_level = 0;
+    switchTo(0);
+
+    if (m_slots.size() > 1) {
+        m_warmup = std::thread(&QualityGovernor::warmupLoop, this);
+    }
+
+    std::cout << "Quality governor: " << m_config.ladder.size() << " levels, deadline "
+              << m_deadline_ms << " ms, starting at " << m_config.ladder[0].name << std::endl;
+    return true;
+}
+
+void QualityGovernor::warmupLoop() {
+    for (size_t level = 0; level < m_config.ladder.size() && !m_stopping; level++) {
+        Slot& slot = *m_slots[m_level_slot[level]];
+        if (slot.ready.load(std::memory_order_acquire) || slot.failed) {
+            continue;
+        }
+        if (!buildSlot(slot)) {
+            // Stays not ready, so the controller skips every level using it
+            slot.failed = true;
+            std::cerr << "Quality level unavailable: " << m_config.ladder[level].name << std::endl;
+        }
+    }
+}
+
+bool QualityGovernor::upscale(const cv::Mat& input, cv::Mat& output) {
+    Upscaler& upscaler = *m_slots[m_level_slot[m_level]]->upscaler;
+
+    auto start = Metrics::Clock::now();
+    bool success = upscaler.upscale(input, output);
+    update(Metrics::instance().recordSince(m_metric_upscale, start));
+
+    return success;
+}
+
+void QualityGovernor::update(double frame_ms) {
+    m_average_ms = m_average_ms > 0.0
+        ? m_average_ms * (1.0 - m_config.smoothing) + frame_ms * m_config.smoothing
+        : frame_ms;
+    m_level_cost_ms[m_level] = m_average_ms;
+    m_frames_since_switch++;
+
+    if (m_average_ms > m_deadline_ms * m_config.downgrade_ratio) {
+        m_slow_frames++;
+        m_fast_frames = 0;
+    } else if (m_average_ms < m_deadline_ms * m_config.upgrade_ratio) {
+        m_fast_frames++;
+        m_slow_frames = 0;
+    } else {
+        m_slow_frames = 0;
+        m_fast_frames = 0;
+    }
+
+    if (m_frames_since_switch < m_config.cooldown_frames) {
+        return;
+    }
+
+    if (m_slow_frames >= m_config.downgrade_frames) {
+        size_t lower = readyBelow();
+        if (lower != m_level) {
+            switchTo(lower);
+        }
+    } else if (m_fast_frames >= m_config.upgrade_frames) {
+        size_t higher = readyAbove();
+        // Don't climb back to a level already known to miss the deadline
+        double known_cost = m_level_cost_ms[higher];
+        if (higher != m_level && (known_cost <= 0.0 || known_cost < m_deadline_ms * m_config.downgrade_ratio)) {
+            switchTo(higher);
+        } else {
+            // Forget gradually, so a level that was only slow under an
+            // earlier load spike gets another try once things stay quiet
+            m_level_cost_ms[higher] *= 0.75;
+            m_fast_frames = 0;
+        }
+    }
+}
+
+void QualityGovernor::switchTo(size_t level) {
+    const Level& target = m_config.ladder[level];
+    Upscaler& upscaler = *m_slots[m_level_slot[level]]->upscaler;
+
+    upscaler.setUseSelectiveBilateral(target.selective_bilateral);
+    upscaler.setUseAdaptiveSharpening(target.adaptive_sharpening);
+    upscaler.setUseTemporalConsistency(target.temporal_consistency);
+
+    // History from before the switch belongs to another configuration
+    if (target.temporal_consistency && upscaler.getTemporalConsistency()) {
+        upscaler.getTemporalConsistency()->reset();
+    }
+
+    if (level != m_level) {
+        std::cout << "Quality governor: " << (level > m_level ? "down" : "up") << " to "
+                  << target.name << " (" << m_average_ms << " ms against a "
+                  << m_deadline_ms << " ms deadline)" << std::endl;
+        m_switches++;
+        Metrics::instance().add(m_metric_switches);
+    }
+
+    // Start from what this level cost last time it ran, if it ever did
+    m_level = level;
+    m_average_ms = m_level_cost_ms[level];
+    m_slow_frames = 0;
+    m_fast_frames = 0;
+    m_frames_since_switch = 0;
+}
+
+size_t QualityGovernor::readyBelow() const {
+    for (size_t level = m_level + 1; level < m_config.ladder.size(); level++) {
+        if (m_slots[m_level_slot[level]]->ready.load(std::memory_order_acquire)) {
+            return level;
+        }
+    }
+    return m_level;
+}
+
+size_t QualityGovernor::readyAbove() const {
+    for (size_t level = m_level; level-- > 0;) {
+        if (m_slots[m_level_slot[level]]->ready.load(std::memory_order_acquire)) {
+            return level;
+        }
+    }
+    return m_level;
+}
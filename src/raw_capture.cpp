@@ -0,0 +1,250 @@
+#include "raw_capture.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define HAVE_MMAP 1
+#endif
+
+namespace rawfile {
+
+bool isRawFile(const std::string& path) {
+    return std::filesystem::path(path).extension() == ".vpraw";
+}
+
+} // namespace rawfile
+
+RawFrameWriter::RawFrameWriter()
+    : m_file(nullptr),
+      m_header() {
+}
+
+RawFrameWriter::~RawFrameWriter() {
+    close();
+}
+
+bool RawFrameWriter::open(const std::string& path, double fps) {
+    close();
+
+    m_file = std::fopen(path.c_str(), "wb");
+    if (!m_file) {
+        std::cerr << "Failed to create raw capture file: " << path << std::endl;
+        return false;
+    }
+
+    m_path = path;
+    m_header = rawfile::FileHeader();
+    std::memcpy(m_header.magic, rawfile::kMagic, sizeof(m_header.magic));
+    m_header.version = rawfile::kVersion;
+    m_header.header_bytes = rawfile::kHeaderBytes;
+    m_header.fps = fps;
+
+    std::cout << "Raw capture to " << path << std::endl;
+    return true;
+}
+
+bool RawFrameWriter::writeHeader() {
+    std::vector<char> page(rawfile::kHeaderBytes, 0);
+    std::memcpy(page.data(), &m_header, sizeof(m_header));
+    return std::fseek(m_file, 0, SEEK_SET) == 0 &&
+           std::fwrite(page.data(), 1, page.size(), m_file) == page.size();
+}
+
+bool RawFrameWriter::write(const cv::Mat& frame, const FrameMetadata& metadata) {
+    if (!m_file || frame.empty()) {
+        return false;
+    }
+
+    if (m_header.frame_count == 0) {
+        if (frame.type() != CV_8UC3 && frame.type() != CV_8UC1) {
+            std::cerr << "Raw capture only stores 8-bit BGR or I420 frames" << std::endl;
+            return false;
+        }
+
+        // The first frame fixes the geometry; the header is written now so
+        // a file that is never closed can still be replayed
+        m_header.cols = frame.cols;
+        m_header.rows = frame.rows;
+        m_header.type = frame.type();
+        m_header.row_bytes = static_cast<uint32_t>(frame.cols * frame.elemSize());
+        size_t payload = rawfile::kFrameHeaderBytes + static_cast<size_t>(m_header.row_bytes) * frame.rows;
+        m_header.record_bytes = (payload + rawfile::kRecordAlignment - 1) /
+                                rawfile::kRecordAlignment * rawfile::kRecordAlignment;
+        m_first_capture = metadata.capture_time;
+        if (!writeHeader()) {
+            std::cerr << "Failed to write raw capture header: " << m_path << std::endl;
+            return false;
+        }
+    } else if (frame.cols != m_header.cols || frame.rows != m_header.rows || frame.type() != m_header.type) {
+        std::cerr << "Raw capture frame differs from the first frame's geometry, skipped" << std::endl;
+        return false;
+    }
+
+    char frame_header[rawfile::kFrameHeaderBytes] = {};
+    rawfile::FrameHeader stamp;
+    stamp.index = m_header.frame_count;
+    stamp.source_timestamp_ms = metadata.source_timestamp_ms;
+    stamp.capture_offset_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        metadata.capture_time - m_first_capture).count();
+    std::memcpy(frame_header, &stamp, sizeof(stamp));
+
+    bool written = std::fwrite(frame_header, 1, sizeof(frame_header), m_file) == sizeof(frame_header);
+    for (int y = 0; written && y < frame.rows; y++) {
+        written = std::fwrite(frame.ptr(y), 1, m_header.row_bytes, m_file) == m_header.row_bytes;
+    }
+
+    size_t padding = m_header.record_bytes - rawfile::kFrameHeaderBytes -
+                     static_cast<size_t>(m_header.row_bytes) * frame.rows;
+    static const char zeros[rawfile::kRecordAlignment] = {};
+    if (written && padding > 0) {
+        written = std::fwrite(zeros, 1, padding, m_file) == padding;
+    }
+
+    if (!written) {
+        std::cerr << "Failed to write raw frame " << m_header.frame_count << " to " << m_path << std::endl;
+        return false;
+    }
+
+    m_header.frame_count++;
+    return true;
+}
+
+void RawFrameWriter::close() {
+    if (!m_file) {
+        return;
+    }
+
+    if (m_header.frame_count > 0 && !writeHeader()) {
+        std::cerr << "Failed to finalize raw capture header: " << m_path << std::endl;
+    }
+    std::fclose(m_file);
+    m_file = nullptr;
+
+    std::cout << "Raw capture wrote " << m_header.frame_count << " frames to " << m_path << std::endl;
+}
+
+RawFrameReader::RawFrameReader()
+    : m_data(nullptr),
+      m_mapped_bytes(0),
+      m_header(),
+      m_frame_count(0),
+      m_position(0) {
+}
+
+RawFrameReader::~RawFrameReader() {
+    close();
+}
+
+bool RawFrameReader::open(const std::string& path) {
+    close();
+
+#ifdef HAVE_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Failed to open raw file: " << path << std::endl;
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < rawfile::kHeaderBytes) {
+        std::cerr << "Raw file is too short: " << path << std::endl;
+        ::close(fd);
+        return false;
+    }
+
+    // Private and writable: consumers may draw into a frame without
+    // touching the file or faulting on a read-only page
+    size_t bytes = static_cast<size_t>(info.st_size);
+    void* data = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        std::cerr << "Failed to map raw file: " << path << std::endl;
+        return false;
+    }
+
+    std::memcpy(&m_header, data, sizeof(m_header));
+    bool valid = std::memcmp(m_header.magic, rawfile::kMagic, sizeof(m_header.magic)) == 0 &&
+                 m_header.version == rawfile::kVersion &&
+                 m_header.header_bytes >= sizeof(m_header) && m_header.header_bytes <= bytes &&
+                 (m_header.type == CV_8UC3 || m_header.type == CV_8UC1) &&
+                 m_header.cols > 0 && m_header.rows > 0 &&
+                 m_header.record_bytes >= rawfile::kFrameHeaderBytes +
+                                          static_cast<uint64_t>(m_header.row_bytes) * m_header.rows;
+    if (!valid) {
+        std::cerr << "Not a raw frame file: " << path << std::endl;
+        munmap(data, bytes);
+        return false;
+    }
+
+    // A writer that never closed the file left the count at zero; trust
+    // only the records that are complete on disk
+    uint64_t stored = (bytes - m_header.header_bytes) / m_header.record_bytes;
+    m_frame_count = m_header.frame_count > 0 ? std::min(m_header.frame_count, stored) : stored;
+
+    m_data = static_cast<uint8_t*>(data);
+    m_mapped_bytes = bytes;
+    m_position = 0;
+    madvise(m_data, m_mapped_bytes, MADV_SEQUENTIAL);
+
+    std::cout << "Mapped raw file " << path << ": " << m_frame_count << " frames of "
+              << m_header.cols << "x" << m_header.rows << " @ " << m_header.fps << " FPS" << std::endl;
+    return true;
+#else
+    std::cerr << "Raw replay needs mmap, unavailable on this platform: " << path << std::endl;
+    return false;
+#endif
+}
+
+void RawFrameReader::close() {
+#ifdef HAVE_MMAP
+    if (m_data) {
+        munmap(m_data, m_mapped_bytes);
+    }
+#endif
+    m_data = nullptr;
+    m_mapped_bytes = 0;
+    m_frame_count = 0;
+    m_position = 0;
+}
+
+bool RawFrameReader::frame(uint64_t index, cv::Mat& view, FrameMetadata* metadata) const {
+    if (!m_data || index >= m_frame_count) {
+        return false;
+    }
+
+    uint8_t* record = m_data + m_header.header_bytes + index * m_header.record_bytes;
+    if (metadata) {
+        rawfile::FrameHeader stamp;
+        std::memcpy(&stamp, record, sizeof(stamp));
+        metadata->source_timestamp_ms = stamp.source_timestamp_ms >= 0.0 ? stamp.source_timestamp_ms :
+                                        stamp.capture_offset_ns / 1e6;
+    }
+
+    view = cv::Mat(m_header.rows, m_header.cols, m_header.type, record + rawfile::kFrameHeaderBytes,
+                   m_header.row_bytes);
+    return true;
+}
+
+bool RawFrameReader::read(cv::Mat& view, FrameMetadata& metadata) {
+    if (!frame(m_position, view, &metadata)) {
+        return false;
+    }
+    metadata.capture_time = FrameMetadata::Clock::now();
+    m_position++;
+    return true;
+}
+
+bool RawFrameReader::seek(uint64_t index) {
+    if (!m_data || index >= m_frame_count) {
+        return false;
+    }
+    m_position = index;
+    return true;
+}
@@ -0,0 +1,323 @@
+#include "recording_sink.h"
+#include <iostream>
+
+RecordingSink::RecordingSink(const Config& config)
+    : m_config(config),
+      m_written(0),
+      m_dropped(0),
+      m_running(false),
+      m_stopping(false) {
+    if (m_config.queue_size == 0) {
+        m_config.queue_size = 1;
+    }
+}
+
+RecordingSink::~RecordingSink() {
+    stop();
+}
+
+bool RecordingSink::openHardwareEncoder() {
+#if defined(WITH_CUDA) && defined(HAVE_OPENCV_CUDACODEC)
+    if (cv::cuda::getCudaEnabledDeviceCount() == 0) {
+        return false;
+    }
+
+    try {
+        m_nvenc = cv::cudacodec::createVideoWriter(m_config.filename, m_config.frame_size,
+                                                   cv::cudacodec::Codec::H264, m_config.fps,
+                                                   m_config.i420_input ? cv::cudacodec::ColorFormat::NV_IYUV
+                                                                       : cv::cudacodec::ColorFormat::BGR);
+        return static_cast<bool>(m_nvenc);
+    } catch (const cv::Exception& e) {
+        std::cout << "NVENC unavailable (" << e.what() << "), using CPU encoder" << std::endl;
+        m_nvenc.reset();
+        return false;
+    }
+#else
+    return false;
+#endif
+}
+
+bool RecordingSink::start() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_running) {
+        return true;
+    }
+
+    if (m_config.filename.empty() || m_config.frame_size.area() == 0) {
+        std::cerr << "Recording sink requires a filename and a frame size" << std::endl;
+        return false;
+    }
+
+    bool hardware = m_config.use_nvenc && openHardwareEncoder();
+    if (!hardware) {
+        try {
+            m_writer = std::make_unique<cv::VideoWriter>(m_config.filename, m_config.fourcc,
+                                                         m_config.fps, m_config.frame_size);
+        } catch (const cv::Exception& e) {
+            std::cerr << "Error creating video writer: " << e.what() << std::endl;
+            m_writer.reset();
+        }
+
+        if (!m_writer || !m_writer->isOpened()) {
+            std::cerr << "Failed to open " << m_config.filename << " for recording" << std::endl;
+            m_writer.reset();
+            return false;
+        }
+    }
+
+    std::cout << "Recording to " << m_config.filename << " with "
+              << (hardware ? "NVENC (H.264)" : "CPU encoder") << std::endl;
+
+    m_written = 0;
+    m_dropped = 0;
+    m_stopping = false;
+    m_running = true;
+    m_worker = std::thread(&RecordingSink::workerLoop, this);
+    return true;
+}
+
+void RecordingSink::stop() {
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_stopping) {
+            // Another thread is draining; return only once the file is closed
+            m_stopped.wait(lock, [this]() { return !m_stopping; });
+            return;
+        }
+        if (!m_running) {
+            return;
+        }
+        // The encoder drains the queue before it exits
+        m_stopping = true;
+    }
+
+    m_work_available.notify_all();
+    m_space_available.notify_all();
+
+    if (m_worker.joinable()) {
+        m_worker.join();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_writer) {
+            m_writer->release();
+            m_writer.reset();
+        }
+#if defined(WITH_CUDA) && defined(HAVE_OPENCV_CUDACODEC)
+        if (m_nvenc) {
+            m_nvenc->release();
+            m_nvenc.reset();
+        }
+#endif
+
+        m_running = false;
+        m_stopping = false;
+        m_free.clear();
+
+        std::cout << "Recording finished: " << m_config.filename << " (" << m_written
+                  << " frames, " << m_dropped << " dropped)" << std::endl;
+    }
+    m_stopped.notify_all();
+}
+
+bool RecordingSink::acquireJob(std::unique_lock<std::mutex>& lock, Job& job) {
+    if (!m_running || m_stopping) {
+        return false;
+    }
+
+    if (m_queue.size() >= m_config.queue_size) {
+        switch (m_config.drop_policy) {
+            case BLOCK:
+                m_space_available.wait(lock, [this]() {
+                    return !m_running || m_stopping || m_queue.size() < m_config.queue_size;
+                });
+                if (!m_running || m_stopping) {
+                    return false;
+                }
+                break;
+            case DROP_OLDEST:
+                // Reuse the oldest frame's storage for the new one
+                job = std::move(m_queue.front());
+                m_queue.pop_front();
+                m_dropped++;
+                return true;
+            case DROP_NEWEST:
+            default:
+                m_dropped++;
+                return false;
+        }
+    }
+
+    if (!m_free.empty()) {
+        job = std::move(m_free.back());
+        m_free.pop_back();
+    }
+    return true;
+}
+
+bool RecordingSink::write(const cv::Mat& frame) {
+    if (frame.empty()) {
+        return false;
+    }
+
+    Job job;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (!acquireJob(lock, job)) {
+            return false;
+        }
+    }
+
+    // Copy outside the lock so the encoder keeps draining meanwhile
+    frame.copyTo(job.host);
+    job.on_device = false;
+    job.frame = Trace::currentFrame();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_running || m_stopping) {
+            return false;
+        }
+        m_queue.push_back(std::move(job));
+    }
+    m_work_available.notify_one();
+    return true;
+}
+
+#ifdef WITH_CUDA
+bool RecordingSink::write(const cv::cuda::GpuMat& frame, cv::cuda::Stream& stream) {
+    if (frame.empty()) {
+        return false;
+    }
+    if (m_config.i420_input) {
+        std::cerr << "Device frames can't be recorded by an I420 sink" << std::endl;
+        return false;
+    }
+
+    Job job;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (!acquireJob(lock, job)) {
+            return false;
+        }
+    }
+
+    try {
+        frame.copyTo(job.device, stream);
+        if (!job.ready) {
+            job.ready = std::make_shared<cv::cuda::Event>(cv::cuda::Event::DISABLE_TIMING);
+        }
+        job.ready->record(stream);
+        job.on_device = true;
+        job.frame = Trace::currentFrame();
+    } catch (const cv::Exception& e) {
+        std::cerr << "Error queueing device frame for recording: " << e.what() << std::endl;
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_running || m_stopping) {
+            return false;
+        }
+        m_queue.push_back(std::move(job));
+    }
+    m_work_available.notify_one();
+    return true;
+}
+#endif
+
+bool RecordingSink::isRunning() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_running && !m_stopping;
+}
+
+bool RecordingSink::isHardwareEncoding() const {
+#if defined(WITH_CUDA) && defined(HAVE_OPENCV_CUDACODEC)
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return static_cast<bool>(m_nvenc);
+#else
+    return false;
+#endif
+}
+
+uint64_t RecordingSink::framesWritten() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_written;
+}
+
+uint64_t RecordingSink::droppedFrames() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_dropped;
+}
+
+void RecordingSink::workerLoop() {
+    Trace::setThreadName("encoder");
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_work_available.wait(lock, [this]() { return m_stopping || !m_queue.empty(); });
+            if (m_queue.empty()) {
+                // Stopping and fully drained
+                break;
+            }
+
+            job = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+        m_space_available.notify_one();
+
+        Trace::setFrame(job.frame);
+        bool encoded;
+        {
+            TraceScope span("encode");
+            encoded = encode(job);
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (encoded) {
+            m_written++;
+        }
+        m_free.push_back(std::move(job));
+    }
+}
+
+bool RecordingSink::encode(Job& job) {
+    try {
+#if defined(WITH_CUDA) && defined(HAVE_OPENCV_CUDACODEC)
+        if (m_nvenc) {
+            if (job.on_device) {
+                job.ready->waitForCompletion();
+                m_nvenc->write(job.device);
+            } else {
+                m_d_staging.upload(job.host);
+                m_nvenc->write(m_d_staging);
+            }
+            return true;
+        }
+#endif
+#ifdef WITH_CUDA
+        if (job.on_device) {
+            job.ready->waitForCompletion();
+            job.device.download(m_h_staging);
+            m_writer->write(m_h_staging);
+            return true;
+        }
+#endif
+        if (m_config.i420_input) {
+            // cv::VideoWriter only takes BGR; converting here keeps the cost
+            // off the caller's thread
+            cv::cvtColor(job.host, m_bgr_staging, cv::COLOR_YUV2BGR_I420);
+            m_writer->write(m_bgr_staging);
+            return true;
+        }
+        m_writer->write(job.host);
+        return true;
+    } catch (const cv::Exception& e) {
+        std::cerr << "Error encoding frame: " << e.what() << std::endl;
+        return false;
+    }
+}
@@ -1,20 +1,32 @@
 #include "selective_bilateral.h"
 #include <iostream>
 #include <algorithm>
+#include "task_pool.h"
 
 // Check if OpenCV was built with CUDA support
 #ifdef WITH_CUDA
 #include <opencv2/cudafilters.hpp>
 #include <opencv2/cudaarithm.hpp>
 #include <opencv2/cudaimgproc.hpp>
+#include <opencv2/cudawarping.hpp>
+#include "gpu_utils.h"
 #endif
 
 SelectiveBilateral::SelectiveBilateral() 
-    : m_initialized(false) {
+    : m_initialized(false),
+      m_features(std::make_shared<FrameFeatures>()),
+      m_shared_features(false),
+      m_arena(std::make_shared<FrameArena>()) {
+    updateArenaNames();
 }
 
 SelectiveBilateral::SelectiveBilateral(const Config& config)
-    : m_config(config), m_initialized(false) {
+    : m_config(config),
+      m_initialized(false),
+      m_features(std::make_shared<FrameFeatures>()),
+      m_shared_features(false),
+      m_arena(std::make_shared<FrameArena>()) {
+    updateArenaNames();
 }
 
 SelectiveBilateral::~SelectiveBilateral() {
@@ -29,6 +41,17 @@ bool SelectiveBilateral::initialize() {
             m_config.use_gpu = false;
         } else {
             std::cout << "Using CUDA for bilateral filtering." << std::endl;
+            
+            try {
+                m_d_sobel_x = cv::cuda::createSobelFilter(CV_8UC1, CV_32FC1, 1, 0, 3);
+                m_d_sobel_y = cv::cuda::createSobelFilter(CV_8UC1, CV_32FC1, 0, 1, 3);
+                m_d_box_filter = cv::cuda::createBoxFilter(CV_32FC1, CV_32FC1, cv::Size(5, 5));
+                m_d_mask_blur = cv::cuda::createGaussianFilter(CV_32FC1, CV_32FC1, cv::Size(5, 5), 1.0);
+            } catch (const cv::Exception& e) {
+                std::cerr << "Failed to create CUDA filters for bilateral filtering: " << e.what() 
+                          << ". Using CPU fallback." << std::endl;
+                m_config.use_gpu = false;
+            }
         }
 #else
         std::cout << "CUDA requested for bilateral filtering but OpenCV was built without CUDA support. Using CPU fallback." << std::endl;
@@ -41,6 +64,7 @@ bool SelectiveBilateral::initialize() {
         // Ensures that the number of scales is reasonable
         m_config.num_scales = std::max(1, std::min(m_config.num_scales, 5));
     }
+    updateArenaNames();
     
     m_initialized = true;
     return true;
@@ -48,12 +72,49 @@ bool SelectiveBilateral::initialize() {
 
 void SelectiveBilateral::setConfig(const Config& config) {
     m_config = config;
+    updateArenaNames();
 }
 
 SelectiveBilateral::Config SelectiveBilateral::getConfig() const {
     return m_config;
 }
 
+void SelectiveBilateral::setArena(std::shared_ptr<FrameArena> arena) {
+    if (arena) {
+        m_arena = std::move(arena);
+    }
+}
+
+void SelectiveBilateral::updateArenaNames() {
+    // Built once here so per-frame lookups pass a stable C string and the
+    // arena doesn't allocate
+    const std::string prefix = m_config.stage == PRE_PROCESSING ? "bilateral_pre." : "bilateral_post.";
+    m_staging_input = prefix + "input";
+    m_staging_output = prefix + "output";
+    
+    const int levels = std::max(1, m_config.use_multiscale ? m_config.num_scales : 1);
+    m_guided_buffers.resize(levels);
+    for (int level = 0; level < levels; level++) {
+        const std::string base = prefix + "guided" + std::to_string(level) + ".";
+        GuidedBuffers& names = m_guided_buffers[level];
+        names.image = base + "image";
+        names.mean = base + "mean";
+        names.corr = base + "corr";
+        names.var = base + "var";
+        names.a = base + "a";
+        names.b = base + "b";
+        names.tmp = base + "tmp";
+        for (size_t c = 0; c < names.planes.size(); c++) {
+            names.planes[c] = base + "plane" + std::to_string(c);
+        }
+    }
+}
+
+void SelectiveBilateral::setFeatures(std::shared_ptr<FrameFeatures> features) {
+    m_shared_features = features != nullptr;
+    m_features = features ? std::move(features) : std::make_shared<FrameFeatures>();
+}
+
 bool SelectiveBilateral::process(const cv::Mat& input, cv::Mat& output) {
     if (!m_initialized) {
         std::cerr << "Selective bilateral filtering module not initialized" << std::endl;
@@ -65,20 +126,42 @@ bool SelectiveBilateral::process(const cv::Mat& input, cv::Mat& output) {
         return false;
     }
     
+#ifdef WITH_CUDA
+    // Keep every scale on the device: one upload and one download per frame
+    if (m_config.use_gpu && m_d_sobel_x) {
+        cv::cuda::GpuMat& d_input = m_arena->device(m_staging_input.c_str(), input.size(), input.type());
+        cv::cuda::GpuMat& d_output = m_arena->device(m_staging_output.c_str(), input.size(), input.type());
+        d_input.upload(input);
+        bool result = process(d_input, d_output, cv::cuda::Stream::Null());
+        d_output.download(output);
+        return result;
+    }
+#endif
+    
+    // A private cache only lives for one call; a shared one is dropped by its owner
+    if (!m_shared_features) {
+        m_features->invalidate();
+    }
+    
+    bool result;
     try {
         // Adjust processing approach based on configuration
         if (m_config.use_multiscale) {
-            return applyMultiscaleBilateral(input, output);
+            result = applyMultiscaleBilateral(input, output);
         } else if (m_config.selective) {
-            return applySelectiveBilateral(input, output);
+            result = applySelectiveBilateral(input, output);
         } else {
-            return applyBilateralFilter(input, output);
+            result = applyBilateralFilter(input, output);
         }
     } catch (const cv::Exception& e) {
         std::cerr << "Error in selective bilateral filtering: " << e.what() << std::endl;
         input.copyTo(output);
-        return false;
+        result = false;
     }
+    
+    // The output may reuse the memory of an image analysed earlier
+    m_features->invalidate(output);
+    return result;
 }
 
 bool SelectiveBilateral::applyBilateralFilter(const cv::Mat& input, cv::Mat& output) {
@@ -92,24 +175,7 @@ bool SelectiveBilateral::applyBilateralFilter(const cv::Mat& input, cv::Mat& out
             calculateAdaptiveParams(input, diameter, sigma_color, sigma_space);
         }
         
-        // Apply bilateral filter with GPU if available and requested
-        if (m_config.use_gpu) {
-#ifdef WITH_CUDA
-    cv::cuda::GpuMat d_input, d_output;
-    d_input.upload(input);
-    // CUDA bilateral via free function:
-    cv::cuda::bilateralFilter(d_input, d_output,
-                              diameter, sigma_color, sigma_space);
-    d_output.download(output);
-#else
-    cv::bilateralFilter(input, output, diameter, sigma_color, sigma_space);
-#endif
-
-        } else {
-            // CPU implementation
-            cv::bilateralFilter(input, output, diameter, sigma_color, sigma_space);
-        }
-        
+        applyEdgePreservingFilter(input, output, diameter, sigma_color, sigma_space);
         return true;
     } catch (const cv::Exception& e) {
         std::cerr << "Error applying bilateral filter: " << e.what() << std::endl;
@@ -118,6 +184,55 @@ bool SelectiveBilateral::applyBilateralFilter(const cv::Mat& input, cv::Mat& out
     }
 }
 
+void SelectiveBilateral::applyEdgePreservingFilter(const cv::Mat& input, cv::Mat& output,
+                                                   int diameter, double sigma_color, double sigma_space,
+                                                   int level) {
+    if (m_config.filter_mode == GUIDED_FILTER) {
+        double eps = sigma_color / 255.0;
+        applyGuidedFilter(input, output, std::max(1, diameter / 2), eps * eps, level);
+    } else {
+        cv::bilateralFilter(input, output, diameter, sigma_color, sigma_space);
+    }
+}
+
+void SelectiveBilateral::applyGuidedFilter(const cv::Mat& input, cv::Mat& output, int radius, double eps,
+                                           int level) {
+    // Self-guided filter: per window q = a * I + b with a = var / (var + eps),
+    // so flat regions average out while edges (var >> eps) pass through.
+    // Every step is a box filter or a pointwise op, independent of radius.
+    const cv::Size window(2 * radius + 1, 2 * radius + 1);
+    const GuidedBuffers& names = m_guided_buffers[std::min<size_t>(level, m_guided_buffers.size() - 1)];
+    const int type = CV_MAKETYPE(CV_32F, input.channels());
+    FrameArena& arena = *m_arena;
+    cv::Mat& I = arena.host(names.image.c_str(), input.size(), type);
+    cv::Mat& mean_I = arena.host(names.mean.c_str(), input.size(), type);
+    cv::Mat& corr_I = arena.host(names.corr.c_str(), input.size(), type);
+    cv::Mat& var_I = arena.host(names.var.c_str(), input.size(), type);
+    cv::Mat& a = arena.host(names.a.c_str(), input.size(), type);
+    cv::Mat& b = arena.host(names.b.c_str(), input.size(), type);
+    cv::Mat& tmp = arena.host(names.tmp.c_str(), input.size(), type);
+    
+    input.convertTo(I, CV_32F, 1.0 / 255.0);
+    cv::boxFilter(I, mean_I, CV_32F, window);
+    cv::multiply(I, I, tmp);
+    cv::boxFilter(tmp, corr_I, CV_32F, window);
+    cv::multiply(mean_I, mean_I, tmp);
+    cv::subtract(corr_I, tmp, var_I);
+    
+    // a = var / (var + eps), b = mean * (1 - a)
+    cv::add(var_I, cv::Scalar::all(eps), tmp);
+    cv::divide(var_I, tmp, a);
+    cv::multiply(a, mean_I, tmp);
+    cv::subtract(mean_I, tmp, b);
+    
+    // q = mean(a) * I + mean(b), written over I
+    cv::boxFilter(a, tmp, CV_32F, window);
+    cv::boxFilter(b, mean_I, CV_32F, window);
+    cv::multiply(tmp, I, I);
+    cv::add(I, mean_I, I);
+    I.convertTo(output, input.type(), 255.0);
+}
+
 bool SelectiveBilateral::applySelectiveBilateral(const cv::Mat& input, cv::Mat& output) {
     try {
         // Create detail mask for selective processing
@@ -159,27 +274,9 @@ bool SelectiveBilateral::applyMultiscaleBilateral(const cv::Mat& input, cv::Mat&
             double sigma_color = m_config.sigma_color * (1.0 + 0.5 * i); // Increase for coarser scales
             double sigma_space = m_config.sigma_space * (1.0 + 0.5 * i); // Increase for coarser scales
             
-            // Apply bilateral filter to this scale
+            // Filter this scale
             cv::Mat filtered;
-            if (m_config.use_gpu) {
-                #ifdef WITH_CUDA
-                    cv::cuda::GpuMat d_input, d_output;
-                    d_input.upload(input);
-                    // CUDA bilateral via free function:
-                    cv::cuda::bilateralFilter(d_input, d_output,
-                                            diameter,
-                                            sigma_color,
-                                            sigma_space);
-                    d_output.download(output);
-                #else
-                    cv::bilateralFilter(input, output, diameter, sigma_color, sigma_space);
-                #endif
-            
-            } else {
-                // CPU implementation
-                cv::bilateralFilter(scales[i], filtered, diameter, sigma_color, sigma_space);
-            }
-            
+            applyEdgePreservingFilter(scales[i], filtered, diameter, sigma_color, sigma_space, i);
             processed_scales.push_back(filtered);
         }
         
@@ -192,38 +289,11 @@ bool SelectiveBilateral::applyMultiscaleBilateral(const cv::Mat& input, cv::Mat&
             cv::Mat detail_mask;
             createDetailMask(processed_scales[i-1], detail_mask);
             
-            // Blend based on detail mask
-            for (int y = 0; y < processed_scales[i-1].rows; y++) {
-                for (int x = 0; x < processed_scales[i-1].cols; x++) {
-                    float detail_value = detail_mask.at<float>(y, x);
-                    float coarse_weight = 1.0f - detail_value; // Less influence on detailed areas
-                    
-                    if (processed_scales[i-1].channels() == 1) {
-                        // Grayscale image
-                        float fine_value = processed_scales[i-1].at<uchar>(y, x);
-                        float coarse_value = upsampled.at<uchar>(y, x);
-                        
-                        // Blend using detail-weighted average
-                        processed_scales[i-1].at<uchar>(y, x) = cv::saturate_cast<uchar>(
-                            fine_value * detail_value + coarse_value * coarse_weight
-                        );
-                    } else {
-                        // Color image (assumed BGR)
-                        cv::Vec3b fine_value = processed_scales[i-1].at<cv::Vec3b>(y, x);
-                        cv::Vec3b coarse_value = upsampled.at<cv::Vec3b>(y, x);
-                        
-                        // Blend each channel
-                        cv::Vec3b result;
-                        for (int c = 0; c < 3; c++) {
-                            result[c] = cv::saturate_cast<uchar>(
-                                fine_value[c] * detail_value + coarse_value[c] * coarse_weight
-                            );
-                        }
-                        
-                        processed_scales[i-1].at<cv::Vec3b>(y, x) = result;
-                    }
-                }
-            }
+            // Keep the fine level where there is detail, the coarse level elsewhere
+            cv::Mat coarse_weight = 1.0 - detail_mask;
+            cv::blendLinear(processed_scales[i-1], upsampled, detail_mask, coarse_weight,
+                            processed_scales[i-1]);
+            m_features->invalidate(processed_scales[i-1]);
         }
         
         // The finest level is the output
@@ -238,51 +308,23 @@ bool SelectiveBilateral::applyMultiscaleBilateral(const cv::Mat& input, cv::Mat&
 
 bool SelectiveBilateral::createDetailMask(const cv::Mat& input, cv::Mat& detail_mask) {
     try {
-        // Convert to grayscale if needed
-        cv::Mat gray;
-        if (input.channels() == 1) {
-            input.copyTo(gray);
-        } else {
-            cv::cvtColor(input, gray, cv::COLOR_BGR2GRAY);
-        }
-        
-        // Calculate gradient magnitude using Sobel operators
-        cv::Mat grad_x, grad_y;
-        cv::Sobel(gray, grad_x, CV_32F, 1, 0, 3);
-        cv::Sobel(gray, grad_y, CV_32F, 0, 1, 3);
-        
-        // Calculate gradient magnitude
-        cv::Mat magnitude;
-        cv::magnitude(grad_x, grad_y, magnitude);
-        
-        // Calculate texture using local standard deviation
-        cv::Mat mean, stddev;
-        cv::meanStdDev(gray, mean, stddev);
-        
-        cv::Mat local_mean, local_stddev;
-        int kernel_size = 5; // Size of local neighborhood
-        cv::blur(gray, local_mean, cv::Size(kernel_size, kernel_size));
-        
-        // Calculate local variance
-        cv::Mat diff_sq;
-        cv::subtract(gray, local_mean, diff_sq);
-        cv::multiply(diff_sq, diff_sq, diff_sq);
+        // Gradient magnitude of the Sobel derivatives, shared with any other
+        // stage analysing this image
+        const cv::Mat& magnitude = m_features->gradientMagnitude(input);
         
-        cv::Mat local_var;
-        cv::blur(diff_sq, local_var, cv::Size(kernel_size, kernel_size));
-        
-        // Local standard deviation
+        // Texture as the local standard deviation over a 5x5 neighborhood
+        const int kernel_size = 5;
         cv::Mat texture;
-        cv::sqrt(local_var, texture);
+        cv::sqrt(m_features->localVariance(input, kernel_size), texture);
         
         // Combine gradient magnitude and texture for detail mask
         // Normalize both to 0-1 range
         double min_val, max_val;
         cv::minMaxLoc(magnitude, &min_val, &max_val);
-        cv::Mat norm_magnitude = magnitude / max_val;
+        cv::Mat norm_magnitude = magnitude / std::max(max_val, 1e-6);
         
         cv::minMaxLoc(texture, &min_val, &max_val);
-        cv::Mat norm_texture = texture / max_val;
+        cv::Mat norm_texture = texture / std::max(max_val, 1e-6);
         
         // Weighted combination
         detail_mask = 0.7 * norm_magnitude + 0.3 * norm_texture;
@@ -290,16 +332,18 @@ bool SelectiveBilateral::createDetailMask(const cv::Mat& input, cv::Mat& detail_
         // Threshold and create mask with smooth transition
         double threshold = m_config.detail_threshold / 255.0;
         cv::Mat mask = cv::Mat(detail_mask.size(), CV_32F);
-        
-        for (int y = 0; y < mask.rows; y++) {
-            for (int x = 0; x < mask.cols; x++) {
-                float detail_value = detail_mask.at<float>(y, x);
-                
-                // Apply sigmoid-like function centered at threshold
-                float mask_value = 1.0f / (1.0f + std::exp(-(detail_value - threshold) * 10.0f));
-                mask.at<float>(y, x) = mask_value;
+        const float center = static_cast<float>(threshold);
+        
+        TaskPool::instance().parallelFor(0, mask.rows, [&](int begin, int end) {
+            for (int y = begin; y < end; y++) {
+                const float* detail = detail_mask.ptr<float>(y);
+                float* out = mask.ptr<float>(y);
+                for (int x = 0; x < mask.cols; x++) {
+                    // Apply sigmoid-like function centered at threshold
+                    out[x] = 1.0f / (1.0f + std::exp(-(detail[x] - center) * 10.0f));
+                }
             }
-        }
+        });
         
         // Apply Gaussian blur for smoother transitions
         cv::GaussianBlur(mask, detail_mask, cv::Size(5, 5), 1.0);
@@ -328,39 +372,7 @@ bool SelectiveBilateral::calculateAdaptiveParams(const cv::Mat& input,
         }
         avg_stddev /= input.channels();
         
-        // Calculate noise level (approximation)
-        double noise_level = avg_stddev;
-        
-        // Adjust parameters based on noise level and image content
-        double noise_factor = 1.0;
-        if (noise_level < 5.0) {
-            noise_factor = 0.7; // Low noise
-        } else if (noise_level > 15.0) {
-            noise_factor = 1.5; // High noise
-        }
-        
-        // Adjust parameters
-        diameter = std::max(5, static_cast<int>(m_config.diameter * noise_factor));
-        
-        // Make sure diameter is odd
-        if (diameter % 2 == 0) {
-            diameter++;
-        }
-        
-        // Constrain maximum diameter for performance
-        diameter = std::min(diameter, 15);
-        
-        // Adjust sigma values
-        sigma_color = m_config.sigma_color * noise_factor;
-        sigma_space = m_config.sigma_space * noise_factor;
-        
-        // Different parameters for different stages
-        if (m_config.stage == POST_PROCESSING) {
-            // For post-processing, be more conservative to avoid oversmoothing
-            diameter = std::max(3, diameter - 2);
-            sigma_color *= 0.8;
-            sigma_space *= 0.8;
-        }
+        adaptParamsToNoise(avg_stddev, diameter, sigma_color, sigma_space);
         
         return true;
     } catch (const cv::Exception& e) {
@@ -370,6 +382,45 @@ bool SelectiveBilateral::calculateAdaptiveParams(const cv::Mat& input,
     }
 }
 
+void SelectiveBilateral::adaptParamsToNoise(double avg_stddev, 
+                                            int& diameter, 
+                                            double& sigma_color, 
+                                            double& sigma_space) const {
+    // Calculate noise level (approximation)
+    double noise_level = avg_stddev;
+    
+    // Adjust parameters based on noise level and image content
+    double noise_factor = 1.0;
+    if (noise_level < 5.0) {
+        noise_factor = 0.7; // Low noise
+    } else if (noise_level > 15.0) {
+        noise_factor = 1.5; // High noise
+    }
+    
+    // Adjust parameters
+    diameter = std::max(5, static_cast<int>(m_config.diameter * noise_factor));
+    
+    // Make sure diameter is odd
+    if (diameter % 2 == 0) {
+        diameter++;
+    }
+    
+    // Constrain maximum diameter for performance
+    diameter = std::min(diameter, 15);
+    
+    // Adjust sigma values
+    sigma_color = m_config.sigma_color * noise_factor;
+    sigma_space = m_config.sigma_space * noise_factor;
+    
+    // Different parameters for different stages
+    if (m_config.stage == POST_PROCESSING) {
+        // For post-processing, be more conservative to avoid oversmoothing
+        diameter = std::max(3, diameter - 2);
+        sigma_color *= 0.8;
+        sigma_space *= 0.8;
+    }
+}
+
 bool SelectiveBilateral::applyJointBilateral(const cv::Mat& input, 
                                             const cv::Mat& detail_mask, 
                                             cv::Mat& output) {
@@ -384,47 +435,28 @@ bool SelectiveBilateral::applyJointBilateral(const cv::Mat& input,
         // Initialize output
         output = cv::Mat(input.size(), input.type());
         
-        // Blend original and filtered based on detail mask
-        if (input.channels() == 1) {
-            // Grayscale image
-            for (int y = 0; y < output.rows; y++) {
-                for (int x = 0; x < output.cols; x++) {
-                    float detail_value = detail_mask.at<float>(y, x);
-                    float preservation = 1.0f + detail_value * (m_config.edge_preserve - 1.0f);
-                    
-                    float original = input.at<uchar>(y, x);
-                    float filtered_value = filtered.at<uchar>(y, x);
-                    
-                    // Blend with detail-dependent weights
-                    output.at<uchar>(y, x) = cv::saturate_cast<uchar>(
-                        original * detail_value * preservation + 
-                        filtered_value * (1.0f - detail_value * preservation)
-                    );
-                }
-            }
-        } else {
-            // Color image (assumed BGR)
-            for (int y = 0; y < output.rows; y++) {
+        // Blend original and filtered based on detail mask, one row tile per task
+        // (grayscale, or colour assumed BGR)
+        const int channels = input.channels();
+        const float edge_preserve = m_config.edge_preserve;
+        TaskPool::instance().parallelFor(0, output.rows, [&](int begin, int end) {
+            for (int y = begin; y < end; y++) {
+                const float* detail = detail_mask.ptr<float>(y);
+                const uchar* original = input.ptr<uchar>(y);
+                const uchar* filtered_row = filtered.ptr<uchar>(y);
+                uchar* out = output.ptr<uchar>(y);
+                
                 for (int x = 0; x < output.cols; x++) {
-                    float detail_value = detail_mask.at<float>(y, x);
-                    float preservation = 1.0f + detail_value * (m_config.edge_preserve - 1.0f);
-                    
-                    cv::Vec3b original = input.at<cv::Vec3b>(y, x);
-                    cv::Vec3b filtered_value = filtered.at<cv::Vec3b>(y, x);
+                    float preservation = 1.0f + detail[x] * (edge_preserve - 1.0f);
+                    float keep = detail[x] * preservation;
                     
                     // Blend each channel with detail-dependent weights
-                    cv::Vec3b result;
-                    for (int c = 0; c < 3; c++) {
-                        result[c] = cv::saturate_cast<uchar>(
-                            original[c] * detail_value * preservation + 
-                            filtered_value[c] * (1.0f - detail_value * preservation)
-                        );
+                    for (int c = x * channels; c < (x + 1) * channels; c++) {
+                        out[c] = cv::saturate_cast<uchar>(original[c] * keep + filtered_row[c] * (1.0f - keep));
                     }
-                    
-                    output.at<cv::Vec3b>(y, x) = result;
                 }
             }
-        }
+        });
         
         return true;
     } catch (const cv::Exception& e) {
@@ -436,4 +468,280 @@ bool SelectiveBilateral::applyJointBilateral(const cv::Mat& input,
         }
         return false;
     }
-}
\ No newline at end of file
+}
+
+#ifdef WITH_CUDA
+bool SelectiveBilateral::process(const cv::cuda::GpuMat& input, cv::cuda::GpuMat& output,
+                                 cv::cuda::Stream& stream) {
+    if (!m_initialized) {
+        std::cerr << "Selective bilateral filtering module not initialized" << std::endl;
+        return false;
+    }
+    
+    if (input.empty()) {
+        std::cerr << "Empty input image" << std::endl;
+        return false;
+    }
+    
+    // Without the device filters, run the host path once instead of per stage
+    if (!m_config.use_gpu || !m_d_sobel_x) {
+        cv::Mat& h_input = m_arena->host(m_staging_input.c_str(), input.size(), input.type());
+        cv::Mat& h_output = m_arena->host(m_staging_output.c_str(), input.size(), input.type());
+        input.download(h_input, stream);
+        stream.waitForCompletion();
+        bool result = process(h_input, h_output);
+        output.upload(h_output, stream);
+        return result;
+    }
+    
+    try {
+        if (m_config.use_multiscale) {
+            return applyMultiscaleBilateral(input, output, stream);
+        } else if (m_config.selective) {
+            return applySelectiveBilateral(input, output, stream);
+        } else {
+            return applyBilateralFilter(input, output, stream);
+        }
+    } catch (const cv::Exception& e) {
+        std::cerr << "Error in selective bilateral filtering (GPU): " << e.what() << std::endl;
+        input.copyTo(output, stream);
+        return false;
+    }
+}
+
+bool SelectiveBilateral::applyBilateralFilter(const cv::cuda::GpuMat& input, cv::cuda::GpuMat& output,
+                                              cv::cuda::Stream& stream) {
+    int diameter = m_config.diameter;
+    double sigma_color = m_config.sigma_color;
+    double sigma_space = m_config.sigma_space;
+    
+    if (m_config.adaptive_params) {
+        calculateAdaptiveParams(input, diameter, sigma_color, sigma_space, stream);
+    }
+    
+    applyEdgePreservingFilter(input, output, diameter, sigma_color, sigma_space, stream);
+    return true;
+}
+
+void SelectiveBilateral::applyEdgePreservingFilter(const cv::cuda::GpuMat& input, cv::cuda::GpuMat& output,
+                                                   int diameter, double sigma_color, double sigma_space,
+                                                   cv::cuda::Stream& stream, int level) {
+    if (m_config.filter_mode == GUIDED_FILTER) {
+        double eps = sigma_color / 255.0;
+        applyGuidedFilter(input, output, std::max(1, diameter / 2), eps * eps, level, stream);
+    } else {
+        cv::cuda::bilateralFilter(input, output, diameter, sigma_color, sigma_space,
+                                  cv::BORDER_DEFAULT, stream);
+    }
+}
+
+void SelectiveBilateral::applyGuidedFilter(const cv::cuda::GpuMat& input, cv::cuda::GpuMat& output,
+                                           int radius, double eps, int level, cv::cuda::Stream& stream) {
+    // CUDA box filters are single-channel for float, so filter plane by plane
+    FrameArena& arena = *m_arena;
+    const cv::Ptr<cv::cuda::Filter>& box = arena.filter("bilateral.guided_box", CV_32FC1, {static_cast<double>(radius)}, [radius]() {
+        return cv::cuda::createBoxFilter(CV_32FC1, CV_32FC1, cv::Size(2 * radius + 1, 2 * radius + 1));
+    });
+    
+    const GuidedBuffers& names = m_guided_buffers[std::min<size_t>(level, m_guided_buffers.size() - 1)];
+    const int channels = std::min<int>(input.channels(), static_cast<int>(names.planes.size()));
+    const cv::Size size = input.size();
+    cv::cuda::GpuMat& image = arena.device(names.image.c_str(), size, CV_MAKETYPE(CV_32F, input.channels()));
+    cv::cuda::GpuMat& mean_I = arena.device(names.mean.c_str(), size, CV_32FC1);
+    cv::cuda::GpuMat& corr_I = arena.device(names.corr.c_str(), size, CV_32FC1);
+    cv::cuda::GpuMat& var_I = arena.device(names.var.c_str(), size, CV_32FC1);
+    cv::cuda::GpuMat& a = arena.device(names.a.c_str(), size, CV_32FC1);
+    cv::cuda::GpuMat& b = arena.device(names.b.c_str(), size, CV_32FC1);
+    cv::cuda::GpuMat& tmp = arena.device(names.tmp.c_str(), size, CV_32FC1);
+    
+    // Headers over the arena planes, so split() and merge() reuse them
+    cv::cuda::GpuMat planes[4];
+    for (int c = 0; c < channels; c++) {
+        planes[c] = arena.device(names.planes[c].c_str(), size, CV_32FC1);
+    }
+    
+    input.convertTo(image, CV_32F, 1.0 / 255.0, stream);
+    cv::cuda::split(image, planes, stream);
+    
+    for (int c = 0; c < channels; c++) {
+        cv::cuda::GpuMat& I = planes[c];
+        box->apply(I, mean_I, stream);
+        cv::cuda::sqr(I, tmp, stream);
+        box->apply(tmp, corr_I, stream);
+        cv::cuda::sqr(mean_I, tmp, stream);
+        cv::cuda::subtract(corr_I, tmp, var_I, cv::noArray(), -1, stream);
+        
+        // a = var / (var + eps), b = mean * (1 - a)
+        cv::cuda::add(var_I, cv::Scalar::all(eps), tmp, cv::noArray(), -1, stream);
+        cv::cuda::divide(var_I, tmp, a, 1.0, -1, stream);
+        cv::cuda::multiply(a, mean_I, tmp, 1.0, -1, stream);
+        cv::cuda::subtract(mean_I, tmp, b, cv::noArray(), -1, stream);
+        
+        // q = mean(a) * I + mean(b), written over the plane
+        box->apply(a, tmp, stream);
+        box->apply(b, mean_I, stream);
+        cv::cuda::multiply(tmp, I, I, 1.0, -1, stream);
+        cv::cuda::add(I, mean_I, I, cv::noArray(), -1, stream);
+    }
+    
+    cv::cuda::merge(planes, channels, image, stream);
+    image.convertTo(output, input.type(), 255.0, stream);
+}
+
+bool SelectiveBilateral::applySelectiveBilateral(const cv::cuda::GpuMat& input, cv::cuda::GpuMat& output,
+                                                 cv::cuda::Stream& stream) {
+    cv::cuda::GpuMat detail_mask;
+    if (!createDetailMask(input, detail_mask, stream)) {
+        std::cerr << "Failed to create detail mask" << std::endl;
+        return applyBilateralFilter(input, output, stream);
+    }
+    
+    return applyJointBilateral(input, detail_mask, output, stream);
+}
+
+bool SelectiveBilateral::applyMultiscaleBilateral(const cv::cuda::GpuMat& input, cv::cuda::GpuMat& output,
+                                                  cv::cuda::Stream& stream) {
+    // Build the pyramid on the device
+    std::vector<cv::cuda::GpuMat> scales;
+    scales.push_back(input);
+    for (int i = 1; i < m_config.num_scales; i++) {
+        cv::cuda::GpuMat downsampled;
+        cv::cuda::pyrDown(scales[i-1], downsampled, stream);
+        scales.push_back(downsampled);
+    }
+    
+    // Filter each scale, widening the sigmas for coarser levels
+    std::vector<cv::cuda::GpuMat> processed_scales(scales.size());
+    for (size_t i = 0; i < scales.size(); i++) {
+        double sigma_color = m_config.sigma_color * (1.0 + 0.5 * i);
+        double sigma_space = m_config.sigma_space * (1.0 + 0.5 * i);
+        applyEdgePreservingFilter(scales[i], processed_scales[i], m_config.diameter,
+                                  sigma_color, sigma_space, stream, static_cast<int>(i));
+    }
+    
+    // Upsample and blend from coarse to fine
+    for (size_t i = processed_scales.size() - 1; i > 0; i--) {
+        cv::cuda::GpuMat& fine = processed_scales[i-1];
+        
+        cv::cuda::GpuMat upsampled;
+        cv::cuda::pyrUp(processed_scales[i], upsampled, stream);
+        if (upsampled.size() != fine.size()) {
+            // pyrDown rounds odd sizes up, so the upsampled level can be one pixel larger
+            if (upsampled.cols >= fine.cols && upsampled.rows >= fine.rows) {
+                upsampled = upsampled(cv::Rect(0, 0, fine.cols, fine.rows));
+            } else {
+                cv::cuda::GpuMat resized;
+                cv::cuda::resize(upsampled, resized, fine.size(), 0, 0, cv::INTER_LINEAR, stream);
+                upsampled = resized;
+            }
+        }
+        
+        // Keep the fine level where there is detail, the coarse level elsewhere
+        cv::cuda::GpuMat detail_mask;
+        createDetailMask(fine, detail_mask, stream);
+        gpu_utils::lerp(upsampled, fine, detail_mask, fine, stream);
+    }
+    
+    processed_scales[0].copyTo(output, stream);
+    return true;
+}
+
+bool SelectiveBilateral::createDetailMask(const cv::cuda::GpuMat& input, cv::cuda::GpuMat& detail_mask,
+                                          cv::cuda::Stream& stream) {
+    try {
+        cv::cuda::GpuMat gray;
+        if (input.channels() == 1) {
+            gray = input;
+        } else {
+            cv::cuda::cvtColor(input, gray, cv::COLOR_BGR2GRAY, 0, stream);
+        }
+        
+        // Gradient magnitude
+        cv::cuda::GpuMat grad_x, grad_y, magnitude;
+        m_d_sobel_x->apply(gray, grad_x, stream);
+        m_d_sobel_y->apply(gray, grad_y, stream);
+        cv::cuda::magnitude(grad_x, grad_y, magnitude, stream);
+        
+        // Local standard deviation as a texture measure
+        cv::cuda::GpuMat gray_float, local_mean, diff_sq, local_var, texture;
+        gray.convertTo(gray_float, CV_32F, stream);
+        m_d_box_filter->apply(gray_float, local_mean, stream);
+        cv::cuda::subtract(gray_float, local_mean, diff_sq, cv::noArray(), -1, stream);
+        cv::cuda::sqr(diff_sq, diff_sq, stream);
+        m_d_box_filter->apply(diff_sq, local_var, stream);
+        cv::cuda::sqrt(local_var, texture, stream);
+        
+        // Normalising needs the maxima on the host; only two scalars cross the bus
+        stream.waitForCompletion();
+        double min_val, max_magnitude, max_texture;
+        cv::cuda::minMax(magnitude, &min_val, &max_magnitude);
+        cv::cuda::minMax(texture, &min_val, &max_texture);
+        max_magnitude = std::max(max_magnitude, 1e-6);
+        max_texture = std::max(max_texture, 1e-6);
+        
+        // Weighted combination of the normalised maps
+        cv::cuda::GpuMat combined;
+        cv::cuda::addWeighted(magnitude, 0.7 / max_magnitude, texture, 0.3 / max_texture, 0,
+                              combined, -1, stream);
+        
+        // Smooth transition around the threshold, then blur for soft edges
+        cv::cuda::GpuMat mask;
+        gpu_utils::sigmoid(combined, m_config.detail_threshold / 255.0, 10.0, mask, stream);
+        m_d_mask_blur->apply(mask, detail_mask, stream);
+        
+        return true;
+    } catch (const cv::Exception& e) {
+        std::cerr << "Error creating detail mask (GPU): " << e.what() << std::endl;
+        detail_mask.create(input.size(), CV_32FC1);
+        detail_mask.setTo(cv::Scalar(0.5), stream); // Neutral mask
+        return false;
+    }
+}
+
+bool SelectiveBilateral::calculateAdaptiveParams(const cv::cuda::GpuMat& input, 
+                                                 int& diameter, 
+                                                 double& sigma_color, 
+                                                 double& sigma_space,
+                                                 cv::cuda::Stream& stream) {
+    try {
+        // Per-channel standard deviation from the first two moments
+        stream.waitForCompletion();
+        cv::Scalar sum = cv::cuda::sum(input);
+        cv::Scalar sqr_sum = cv::cuda::sqrSum(input);
+        double pixel_count = static_cast<double>(input.rows) * input.cols;
+        
+        double avg_stddev = 0;
+        for (int i = 0; i < input.channels(); i++) {
+            double mean = sum[i] / pixel_count;
+            double variance = std::max(0.0, sqr_sum[i] / pixel_count - mean * mean);
+            avg_stddev += std::sqrt(variance);
+        }
+        avg_stddev /= input.channels();
+        
+        adaptParamsToNoise(avg_stddev, diameter, sigma_color, sigma_space);
+        return true;
+    } catch (const cv::Exception& e) {
+        std::cerr << "Error calculating adaptive parameters (GPU): " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool SelectiveBilateral::applyJointBilateral(const cv::cuda::GpuMat& input, 
+                                             const cv::cuda::GpuMat& detail_mask, 
+                                             cv::cuda::GpuMat& output,
+                                             cv::cuda::Stream& stream) {
+    cv::cuda::GpuMat filtered;
+    if (!applyBilateralFilter(input, filtered, stream)) {
+        input.copyTo(output, stream);
+        return false;
+    }
+    
+    // Weight of the original pixel: detail * (1 + detail * (edge_preserve - 1))
+    cv::cuda::GpuMat weight;
+    cv::cuda::multiply(detail_mask, detail_mask, weight, m_config.edge_preserve - 1.0, -1, stream);
+    cv::cuda::add(weight, detail_mask, weight, cv::noArray(), -1, stream);
+    
+    gpu_utils::lerp(filtered, input, weight, output, stream);
+    return true;
+}
+#endif
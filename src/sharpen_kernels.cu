@@ -0,0 +1,112 @@
+#include "sharpen_kernels.h"
+
+#include <cuda_runtime.h>
+
+namespace sharpen_kernels {
+
+namespace {
+
+__device__ __forceinline__ float saturate(float v) {
+    return fminf(fmaxf(v, 0.0f), 255.0f);
+}
+
+// BORDER_REFLECT_101, the default border of the OpenCV Gaussian filters
+__device__ __forceinline__ int reflect101(int v, int size) {
+    v = v < 0 ? -v : v;
+    v = v >= size ? 2 * size - 2 - v : v;
+    return min(max(v, 0), size - 1);
+}
+
+template <int CN>
+__global__ void variableSigmaSharpenKernel(const unsigned char* src, size_t src_step,
+                                           const float* sigma, size_t sigma_step,
+                                           const float* edge, size_t edge_step,
+                                           unsigned char* dst, size_t dst_step,
+                                           int width, int height, Params p) {
+    const int x = blockIdx.x * blockDim.x + threadIdx.x;
+    const int y = blockIdx.y * blockDim.y + threadIdx.y;
+    if (x >= width || y >= height) {
+        return;
+    }
+
+    // Fractional level of this pixel's sigma; only its two neighbours count
+    const float s = reinterpret_cast<const float*>(reinterpret_cast<const char*>(sigma) + y * sigma_step)[x];
+    const float u = fminf(fmaxf((s - p.min_sigma) * p.level_scale, 0.0f), p.levels - 1.0f);
+    const int lo = min(static_cast<int>(u), p.levels - 1);
+    const int hi = min(lo + 1, p.levels - 1);
+    const float t = u - lo;
+
+    const int r = p.radius;
+    float blur_lo[CN] = {};
+    float blur_hi[CN] = {};
+    for (int dy = -r; dy <= r; dy++) {
+        const unsigned char* row = src + reflect101(y + dy, height) * src_step;
+        const float wy_lo = p.weights[lo][dy + r];
+        const float wy_hi = p.weights[hi][dy + r];
+        for (int dx = -r; dx <= r; dx++) {
+            const unsigned char* px = row + reflect101(x + dx, width) * CN;
+            const float w_lo = wy_lo * p.weights[lo][dx + r];
+            const float w_hi = wy_hi * p.weights[hi][dx + r];
+            for (int c = 0; c < CN; c++) {
+                blur_lo[c] += w_lo * px[c];
+                blur_hi[c] += w_hi * px[c];
+            }
+        }
+    }
+
+    const unsigned char* in = src + y * src_step + x * CN;
+    const float e = reinterpret_cast<const float*>(reinterpret_cast<const char*>(edge) + y * edge_step)[x];
+    const float strength = p.gain * e + p.offset;
+
+    // Levels are rounded to 8 bits like the per-level blurs this replaces
+    float out[CN];
+    for (int c = 0; c < CN; c++) {
+        const float blurred = rintf((1.0f - t) * rintf(blur_lo[c]) + t * rintf(blur_hi[c]));
+        out[c] = in[c] + strength * fmaxf(in[c] - blurred, 0.0f);
+    }
+
+    // Keeping the input chroma of a YCrCb round trip is the same as adding
+    // the luma change to every channel
+    if (CN == 3 && p.preserve_tone) {
+        const float delta = 0.114f * (out[0] - in[0]) + 0.587f * (out[1] - in[1]) + 0.299f * (out[2] - in[2]);
+        for (int c = 0; c < CN; c++) {
+            out[c] = in[c] + delta;
+        }
+    }
+
+    unsigned char* o = dst + y * dst_step + x * CN;
+    for (int c = 0; c < CN; c++) {
+        o[c] = static_cast<unsigned char>(__float2int_rn(saturate(out[c])));
+    }
+}
+
+} // namespace
+
+bool launchVariableSigmaSharpen(const unsigned char* src, size_t src_step, int channels,
+                                const float* sigma, size_t sigma_step,
+                                const float* edge, size_t edge_step,
+                                unsigned char* dst, size_t dst_step,
+                                int width, int height,
+                                const Params& params, cudaStream_t stream) {
+    if (params.levels < 1 || params.levels > kMaxLevels ||
+        params.radius < 0 || params.radius > kMaxRadius) {
+        return false;
+    }
+
+    const dim3 block(32, 8);
+    const dim3 grid((width + block.x - 1) / block.x, (height + block.y - 1) / block.y);
+    if (channels == 3) {
+        variableSigmaSharpenKernel<3><<<grid, block, 0, stream>>>(src, src_step, sigma, sigma_step,
+                                                                  edge, edge_step, dst, dst_step,
+                                                                  width, height, params);
+    } else if (channels == 1) {
+        variableSigmaSharpenKernel<1><<<grid, block, 0, stream>>>(src, src_step, sigma, sigma_step,
+                                                                  edge, edge_step, dst, dst_step,
+                                                                  width, height, params);
+    } else {
+        return false;
+    }
+    return cudaGetLastError() == cudaSuccess;
+}
+
+} // namespace sharpen_kernels
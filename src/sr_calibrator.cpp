@@ -0,0 +1,371 @@
+#include "sr_calibrator.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+#ifdef WITH_CUDA
+#include <opencv2/core/cuda.hpp>
+#endif
+
+namespace {
+
+// Quality order of the network families, higher is better
+int familyRank(DnnSuperRes::ModelType type) {
+    switch (type) {
+        case DnnSuperRes::REAL_ESRGAN: return 4;
+        case DnnSuperRes::EDSR:        return 3;
+        case DnnSuperRes::LAPSRN:      return 2;
+        case DnnSuperRes::FSRCNN:      return 1;
+        case DnnSuperRes::ESPCN:       return 0;
+    }
+    return 0;
+}
+
+// Upscaling factor from a "_x4" style suffix, 4 when there is none
+int parseScale(const std::string& stem) {
+    size_t pos = stem.rfind("_x");
+    if (pos != std::string::npos && pos + 2 < stem.size() && std::isdigit(static_cast<unsigned char>(stem[pos + 2]))) {
+        return std::max(1, std::atoi(stem.c_str() + pos + 2));
+    }
+    return 4;
+}
+
+std::string upper(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+    return text;
+}
+
+std::string sanitize(std::string text) {
+    for (char& c : text) {
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '-' && c != '.') {
+            c = '_';
+        }
+    }
+    return text;
+}
+
+std::string describe(const cv::Size& size) {
+    return std::to_string(size.width) + "x" + std::to_string(size.height);
+}
+
+} // namespace
+
+SrCalibrator::SrCalibrator()
+    : SrCalibrator(Config()) {
+}
+
+SrCalibrator::SrCalibrator(const Config& config)
+    : m_config(config) {
+}
+
+std::vector<SrCalibrator::Candidate> SrCalibrator::findCandidates() const {
+    std::vector<Candidate> candidates;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(m_config.model_dir, error)) {
+        if (!entry.is_regular_file(error)) {
+            continue;
+        }
+
+        const std::filesystem::path& path = entry.path();
+        const std::string stem = path.stem().string();
+        const std::string prefix = upper(stem);
+        Candidate candidate;
+        candidate.algorithm = Upscaler::SUPER_RES;
+        candidate.model.path = path.string();
+        candidate.model.scale = parseScale(stem);
+        candidate.file_bytes = entry.file_size(error);
+
+        if (path.extension() == ".onnx") {
+            candidate.algorithm = Upscaler::REAL_ESRGAN;
+            candidate.model.name = "esrgan";
+            candidate.model.type = DnnSuperRes::REAL_ESRGAN;
+        } else if (path.extension() != ".pb") {
+            continue;
+        } else if (prefix.rfind("EDSR", 0) == 0) {
+            candidate.model.name = "edsr";
+            candidate.model.type = DnnSuperRes::EDSR;
+        } else if (prefix.rfind("LAPSRN", 0) == 0) {
+            candidate.model.name = "lapsrn";
+            candidate.model.type = DnnSuperRes::LAPSRN;
+        } else if (prefix.rfind("FSRCNN", 0) == 0) {
+            candidate.model.name = "fsrcnn";
+            candidate.model.type = DnnSuperRes::FSRCNN;
+        } else if (prefix.rfind("ESPCN", 0) == 0) {
+            candidate.model.name = "espcn";
+            candidate.model.type = DnnSuperRes::ESPCN;
+        } else {
+            continue;
+        }
+
+        candidate.quality_rank = familyRank(candidate.model.type);
+        candidates.push_back(candidate);
+    }
+
+    // Within a family a model that reaches the output width on its own
+    // beats one the final resize has to stretch, then the bigger network
+    const int target_width = m_config.target_width;
+    std::sort(candidates.begin(), candidates.end(), [this, target_width](const Candidate& a, const Candidate& b) {
+        if (a.quality_rank != b.quality_rank) {
+            return a.quality_rank > b.quality_rank;
+        }
+        bool a_reaches = a.model.scale * inputSizeFor(a).width >= target_width;
+        bool b_reaches = b.model.scale * inputSizeFor(b).width >= target_width;
+        if (a_reaches != b_reaches) {
+            return a_reaches;
+        }
+        if (a.file_bytes != b.file_bytes) {
+            return a.file_bytes > b.file_bytes;
+        }
+        return a.model.path < b.model.path;
+    });
+    return candidates;
+}
+
+cv::Size SrCalibrator::inputSizeFor(const Candidate& candidate) const {
+    if (!m_config.input_size.empty()) {
+        return m_config.input_size;
+    }
+    return candidate.algorithm == Upscaler::REAL_ESRGAN ? m_config.esrgan_input : m_config.dnn_input;
+}
+
+std::string SrCalibrator::hostKey() const {
+    std::string host = "host";
+#if defined(__unix__) || defined(__APPLE__)
+    char name[256] = {};
+    if (gethostname(name, sizeof(name) - 1) == 0 && name[0] != '\0') {
+        host = name;
+    }
+#endif
+
+    std::string device = "cpu";
+#ifdef WITH_CUDA
+    try {
+        if (m_config.use_gpu && cv::cuda::getCudaEnabledDeviceCount() > 0) {
+            cv::cuda::DeviceInfo info(cv::cuda::getDevice());
+            device = std::string(info.name()) + "-sm" + std::to_string(info.majorVersion()) +
+                     std::to_string(info.minorVersion());
+        }
+    } catch (const cv::Exception&) {
+        // No usable device: calibrate for the CPU
+    }
+#endif
+    return sanitize(host) + "/" + sanitize(device);
+}
+
+std::string SrCalibrator::cacheKey(const std::vector<Candidate>& candidates) const {
+    // FNV-1a over every model's path, size and modification time, so an
+    // added, removed or replaced model invalidates the choice
+    uint64_t hash = 1469598103934665603ULL;
+    auto mix = [&hash](const std::string& text) {
+        for (unsigned char c : text) {
+            hash = (hash ^ c) * 1099511628211ULL;
+        }
+    };
+    for (const Candidate& candidate : candidates) {
+        std::error_code error;
+        auto mtime = std::filesystem::last_write_time(candidate.model.path, error);
+        mix(candidate.model.path);
+        mix(std::to_string(candidate.file_bytes));
+        mix(std::to_string(mtime.time_since_epoch().count()));
+    }
+
+    std::ostringstream key;
+    const char* precision[] = {"fp32", "fp16", "int8"};
+    const char* backend[] = {"dnn", "trt", "openvino"};
+    key << hostKey()
+        << "|in=" << (m_config.input_size.empty() ? "default" : describe(m_config.input_size))
+        << "|out=" << m_config.target_width << "x" << m_config.target_height
+        << "|budget=" << std::fixed << std::setprecision(2) << m_config.frame_budget_ms * m_config.headroom
+        << "|" << precision[DnnSuperRes::getDefaultPrecision()]
+        << "|" << backend[DnnSuperRes::getDefaultInferenceBackend()]
+        << "|models=" << std::hex << std::setw(16) << std::setfill('0') << hash;
+    return key.str();
+}
+
+bool SrCalibrator::loadCached(const std::string& key, const std::vector<Candidate>& candidates,
+                              Result& result) const {
+    std::ifstream in(m_config.cache_path);
+    std::string line;
+    while (std::getline(in, line)) {
+        // key \t algorithm \t median_ms \t model path ("-" when nothing fit)
+        std::istringstream fields(line);
+        std::string line_key, algorithm, median, path;
+        if (!std::getline(fields, line_key, '\t') || line_key != key ||
+            !std::getline(fields, algorithm, '\t') || !std::getline(fields, median, '\t') ||
+            !std::getline(fields, path)) {
+            continue;
+        }
+
+        result = Result();
+        result.from_cache = true;
+        if (path == "-") {
+            return true;
+        }
+        for (const Candidate& candidate : candidates) {
+            if (candidate.model.path == path && std::to_string(candidate.algorithm) == algorithm) {
+                result.found = true;
+                result.algorithm = candidate.algorithm;
+                result.model = candidate.model;
+                result.median_ms = std::atof(median.c_str());
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void SrCalibrator::storeCached(const std::string& key, const Result& result) const {
+    std::vector<std::string> lines;
+    {
+        std::ifstream in(m_config.cache_path);
+        std::string line;
+        while (std::getline(in, line)) {
+            if (!line.empty() && line.compare(0, key.size() + 1, key + "\t") != 0) {
+                lines.push_back(line);
+            }
+        }
+    }
+
+    std::ostringstream entry;
+    entry << key << "\t" << static_cast<int>(result.algorithm) << "\t"
+          << std::fixed << std::setprecision(3) << result.median_ms << "\t"
+          << (result.found ? result.model.path : "-");
+    lines.push_back(entry.str());
+
+    std::ofstream out(m_config.cache_path, std::ios::trunc);
+    for (const std::string& line : lines) {
+        out << line << "\n";
+    }
+    if (!out) {
+        std::cerr << "Failed to write SR calibration cache: " << m_config.cache_path << std::endl;
+    }
+}
+
+SrCalibrator::Measurement SrCalibrator::measure(const Candidate& candidate) const {
+    Measurement measurement;
+    measurement.candidate = candidate;
+
+    Upscaler upscaler(candidate.algorithm, m_config.use_gpu);
+    upscaler.setModel(candidate.algorithm, candidate.model);
+    if (!upscaler.initialize(m_config.target_width, m_config.target_height) || !upscaler.isUsingModel()) {
+        std::cerr << "Calibration skipped " << candidate.model.path << ": model did not load" << std::endl;
+        return measurement;
+    }
+    measurement.loaded = true;
+
+    // Blurred noise stands in for camera content; every run sees the frame
+    // shifted by a pixel so temporal reuse and tile skipping can't cheat
+    const cv::Size input = inputSizeFor(candidate);
+    const int runs = std::max(1, m_config.timed_runs);
+    const int total = std::max(0, m_config.warmup_runs) + runs;
+    cv::Mat canvas(input.height + total, input.width + total, CV_8UC3);
+    cv::randu(canvas, cv::Scalar::all(0), cv::Scalar::all(255));
+    cv::GaussianBlur(canvas, canvas, cv::Size(0, 0), 1.5);
+
+    std::vector<double> times;
+    cv::Mat output;
+    try {
+        for (int i = 0; i < total; i++) {
+            cv::Mat frame = canvas(cv::Rect(i, i, input.width, input.height)).clone();
+            auto start = std::chrono::steady_clock::now();
+            if (!upscaler.upscale(frame, output) || output.empty()) {
+                std::cerr << "Calibration run failed for " << candidate.model.path << std::endl;
+                measurement.loaded = false;
+                return measurement;
+            }
+            if (i >= m_config.warmup_runs) {
+                times.push_back(std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - start).count());
+            }
+        }
+    } catch (const cv::Exception& e) {
+        std::cerr << "Calibration error for " << candidate.model.path << ": " << e.what() << std::endl;
+        measurement.loaded = false;
+        return measurement;
+    }
+
+    std::nth_element(times.begin(), times.begin() + times.size() / 2, times.end());
+    measurement.median_ms = times[times.size() / 2];
+    measurement.fits = measurement.median_ms <= m_config.frame_budget_ms * m_config.headroom;
+    return measurement;
+}
+
+SrCalibrator::Result SrCalibrator::calibrate() {
+    const std::vector<Candidate> candidates = findCandidates();
+    if (candidates.empty()) {
+        std::cerr << "No super-resolution models found in " << m_config.model_dir << std::endl;
+        return Result();
+    }
+
+    const std::string key = cacheKey(candidates);
+    Result result;
+    if (m_config.use_cache && !m_config.cache_path.empty() && loadCached(key, candidates, result)) {
+        std::cout << "SR calibration (cached for " << hostKey() << "): "
+                  << (result.found ? result.model.path : "no model fits the budget") << std::endl;
+        return result;
+    }
+
+    std::cout << "Calibrating " << candidates.size() << " SR models on " << hostKey()
+              << " for a " << std::fixed << std::setprecision(1) << m_config.frame_budget_ms
+              << " ms frame budget..." << std::endl;
+
+    // Best quality first: the first model that fits is the answer
+    result = Result();
+    for (const Candidate& candidate : candidates) {
+        Measurement measurement = measure(candidate);
+        result.measurements.push_back(measurement);
+        if (measurement.fits) {
+            result.found = true;
+            result.algorithm = candidate.algorithm;
+            result.model = candidate.model;
+            result.median_ms = measurement.median_ms;
+            break;
+        }
+    }
+
+    if (result.found) {
+        std::cout << "SR calibration chose " << result.model.path << " ("
+                  << std::setprecision(1) << result.median_ms << " ms per frame)" << std::endl;
+    } else {
+        std::cerr << "No SR model fits the frame budget, using bicubic upscaling" << std::endl;
+    }
+
+    if (!m_config.cache_path.empty()) {
+        storeCached(key, result);
+    }
+    return result;
+}
+
+std::string SrCalibrator::toTable(const Result& result) const {
+    if (result.measurements.empty()) {
+        return std::string();
+    }
+
+    std::ostringstream out;
+    out << std::left << std::setw(36) << "Model" << std::right
+        << std::setw(12) << "Input" << std::setw(12) << "ms/frame" << std::setw(8) << "Fits" << "\n";
+    for (const Measurement& measurement : result.measurements) {
+        out << std::left << std::setw(36) << std::filesystem::path(measurement.candidate.model.path).filename().string()
+            << std::right << std::setw(12) << describe(inputSizeFor(measurement.candidate));
+        if (measurement.loaded) {
+            out << std::setw(12) << std::fixed << std::setprecision(2) << measurement.median_ms
+                << std::setw(8) << (measurement.fits ? "yes" : "no");
+        } else {
+            out << std::setw(12) << "-" << std::setw(8) << "failed";
+        }
+        out << "\n";
+    }
+    out << "Budget: " << std::fixed << std::setprecision(2) << m_config.frame_budget_ms * m_config.headroom
+        << " ms of " << m_config.frame_budget_ms << " ms";
+    return out.str();
+}
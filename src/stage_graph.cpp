@@ -0,0 +1,169 @@
+#include "stage_graph.h"
+#include "thread_placement.h"
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+StageGraph::StageGraph(size_t queue_capacity)
+    : m_queue_capacity(std::max<size_t>(queue_capacity, 1)),
+      m_running(false) {
+}
+
+StageGraph::~StageGraph() {
+    stop();
+}
+
+StageGraph& StageGraph::addStage(const std::string& name, StageFunction func) {
+    if (m_running) {
+        std::cerr << "Cannot add stage " << name << " to a running graph" << std::endl;
+        return *this;
+    }
+
+    auto stage = std::make_unique<Stage>();
+    stage->name = name;
+    stage->func = std::move(func);
+    stage->metric = Metrics::instance().registerLatency("graph." + name, "Stage " + name + " per frame");
+    stage->trace_name = Trace::intern("graph." + name);
+
+    m_stages.push_back(std::move(stage));
+    return *this;
+}
+
+void StageGraph::setSink(SinkFunction sink) {
+    m_sink = std::move(sink);
+}
+
+bool StageGraph::start() {
+    if (m_running) {
+        return true;
+    }
+    if (m_stages.empty()) {
+        std::cerr << "Cannot start a stage graph without stages" << std::endl;
+        return false;
+    }
+
+    // Queues are created here because stop() closes them. Every stage
+    // blocks on a full successor, so no frame is dropped inside the graph.
+    for (auto& stage : m_stages) {
+        stage->input = std::make_unique<FrameBuffer>(m_queue_capacity);
+        stage->input->setName("graph." + stage->name);
+        stage->processed = 0;
+        stage->failed = 0;
+        stage->busy_ns = 0;
+    }
+
+    m_start_time = FrameMetadata::Clock::now();
+    m_running = true;
+    for (size_t i = 0; i < m_stages.size(); i++) {
+        m_stages[i]->thread = std::thread(&StageGraph::runStage, this, i);
+    }
+
+    std::cout << "Stage graph started with " << m_stages.size() << " stages" << std::endl;
+    return true;
+}
+
+void StageGraph::stop() {
+    if (!m_running) {
+        return;
+    }
+
+    // Closing a queue lets its stage drain it and exit; the next queue is
+    // only closed once nothing can push into it anymore
+    for (auto& stage : m_stages) {
+        stage->input->close();
+        if (stage->thread.joinable()) {
+            stage->thread.join();
+        }
+    }
+    m_running = false;
+}
+
+bool StageGraph::push(const cv::Mat& frame, const FrameMetadata& metadata, bool blocking) {
+    if (!m_running) {
+        return false;
+    }
+    return m_stages.front()->input->pushFrame(frame, metadata, blocking);
+}
+
+void StageGraph::runStage(size_t index) {
+    Stage& stage = *m_stages[index];
+    FrameBuffer* next = index + 1 < m_stages.size() ? m_stages[index + 1]->input.get() : nullptr;
+
+    cv::Mat input, output;
+    FrameMetadata metadata;
+    Trace::setThreadName(stage.trace_name);
+    ThreadPlacement::instance().apply(ThreadPlacement::PROCESSING);
+
+    // A blocking pop only fails once the queue is closed and drained
+    while (stage.input->popFrame(input, metadata, true)) {
+        Trace::setFrame(metadata.frame_id);
+        auto start = FrameMetadata::Clock::now();
+        bool success = false;
+        try {
+            TraceScope span(stage.trace_name);
+            success = stage.func(input, output, metadata);
+        } catch (const cv::Exception& e) {
+            std::cerr << "Error in stage " << stage.name << ": " << e.what() << std::endl;
+        }
+        auto elapsed = FrameMetadata::Clock::now() - start;
+
+        stage.busy_ns.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(),
+                                std::memory_order_relaxed);
+        Metrics::instance().record(stage.metric, std::chrono::duration<double, std::milli>(elapsed).count());
+        stage.processed.fetch_add(1, std::memory_order_relaxed);
+
+        if (!success || output.empty()) {
+            stage.failed.fetch_add(1, std::memory_order_relaxed);
+        }
+        const cv::Mat& result = success && !output.empty() ? output : input;
+
+        if (next) {
+            next->pushFrame(result, metadata, true);
+        } else if (m_sink) {
+            m_sink(result, metadata);
+        }
+    }
+}
+
+std::vector<StageGraph::StageStats> StageGraph::getStats() const {
+    const double wall_ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        FrameMetadata::Clock::now() - m_start_time).count());
+
+    std::vector<StageStats> stats;
+    for (const auto& stage : m_stages) {
+        StageStats entry;
+        entry.name = stage->name;
+        entry.processed = stage->processed.load(std::memory_order_relaxed);
+        entry.failed = stage->failed.load(std::memory_order_relaxed);
+
+        const double busy_ns = static_cast<double>(stage->busy_ns.load(std::memory_order_relaxed));
+        entry.occupancy = wall_ns > 0.0 ? std::min(busy_ns / wall_ns, 1.0) : 0.0;
+        entry.mean_ms = entry.processed > 0 ? busy_ns / 1e6 / entry.processed : 0.0;
+        entry.queue_depth = stage->input ? stage->input->size() : 0;
+        entry.queue_capacity = m_queue_capacity;
+        stats.push_back(entry);
+    }
+    return stats;
+}
+
+std::string StageGraph::toTable() const {
+    std::ostringstream out;
+    out << std::left << std::setw(20) << "stage"
+        << std::right << std::setw(10) << "frames"
+        << std::setw(10) << "failed"
+        << std::setw(12) << "mean ms"
+        << std::setw(12) << "occupancy"
+        << std::setw(10) << "queue" << "\n";
+
+    for (const StageStats& entry : getStats()) {
+        out << std::left << std::setw(20) << entry.name
+            << std::right << std::setw(10) << entry.processed
+            << std::setw(10) << entry.failed
+            << std::setw(12) << std::fixed << std::setprecision(2) << entry.mean_ms
+            << std::setw(11) << std::setprecision(1) << entry.occupancy * 100.0 << "%"
+            << std::setw(10) << (std::to_string(entry.queue_depth) + "/" + std::to_string(entry.queue_capacity))
+            << "\n";
+    }
+    return out.str();
+}
@@ -0,0 +1,417 @@
+#include "stream_host.h"
+#include "batched_super_res.h"
+#include "camera.h"
+#include "frame_buffer.h"
+#include "memory_budget.h"
+#include "temporal_consistency.h"
+#include "trace.h"
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+StreamHost::StreamHost(const Config& config)
+    : m_config(config),
+      m_running(false),
+      m_stopping(false) {
+    if (m_config.workers == 0) {
+        m_config.workers = 1;
+    }
+    m_metric_upscale = Metrics::instance().registerLatency("streams.upscale", "Shared upscale per frame, all streams");
+}
+
+StreamHost::~StreamHost() {
+    stop();
+}
+
+int StreamHost::addStream(const StreamConfig& config) {
+    if (m_running) {
+        std::cerr << "Streams must be added before the host starts" << std::endl;
+        return -1;
+    }
+
+    auto stream = std::make_unique<Stream>();
+    stream->config = config;
+    if (stream->config.name.empty()) {
+        stream->config.name = "s" + std::to_string(m_streams.size());
+    }
+
+    // Admit the stream only if its smallest footprint fits: one output frame
+    // and, with temporal state, the previous frame plus one history entry
+    MemoryBudget& budget = MemoryBudget::instance();
+    const cv::Size target(m_config.target_width, m_config.target_height);
+    const size_t frame_bytes = MemoryBudget::frameBytes(target, CV_8UC3);
+    bool fits = budget.fits(MemoryBudget::HOST, frame_bytes);
+    if (m_config.algorithm == Upscaler::REAL_ESRGAN) {
+        const MemoryBudget::Pool pool = m_config.use_gpu ? MemoryBudget::DEVICE : MemoryBudget::HOST;
+        const size_t temporal_bytes = 2 * frame_bytes + 21 * MemoryBudget::frameBytes(target, CV_32F);
+        fits = fits && budget.fits(pool, temporal_bytes);
+    }
+    if (!fits) {
+        std::cerr << "Memory budget exhausted, stream " << stream->config.name << " not added" << std::endl;
+        return -1;
+    }
+
+    if (config.video_source.empty()) {
+        stream->camera = std::make_unique<Camera>(config.camera_index);
+    } else {
+        stream->camera = std::make_unique<Camera>(config.video_source);
+    }
+    if (!stream->camera->initialize(config.capture_width, config.capture_height, config.capture_fps)) {
+        std::cerr << "Failed to open source for stream " << stream->config.name << std::endl;
+        return -1;
+    }
+
+    // Shared upscalers can't hold history for one stream, so every stream
+    // carries its own temporal state
+    if (m_config.algorithm == Upscaler::REAL_ESRGAN) {
+        TemporalConsistency::Config temporal_config;
+        temporal_config.use_gpu = m_config.use_gpu;
+        stream->temporal = std::make_unique<TemporalConsistency>(temporal_config);
+        if (!stream->temporal->initialize()) {
+            stream->temporal.reset();
+        }
+    }
+
+    const size_t output_capacity = budget.fit(MemoryBudget::HOST, frame_bytes,
+                                              std::max<size_t>(1, config.output_buffer_size), 1,
+                                              "stream output buffer");
+    stream->output = std::make_unique<FrameBuffer>(output_capacity, target, CV_8UC3);
+
+    Metrics& metrics = Metrics::instance();
+    const std::string prefix = "stream." + stream->config.name;
+    stream->metric_latency = metrics.registerLatency(prefix + ".latency", "Capture to upscaled output");
+    stream->metric_dropped = metrics.registerCounter(prefix + ".dropped", "Frames superseded or rejected");
+
+    m_streams.push_back(std::move(stream));
+    return static_cast<int>(m_streams.size() - 1);
+}
+
+bool StreamHost::start() {
+    if (m_running) {
+        return true;
+    }
+    if (m_streams.empty()) {
+        std::cerr << "Stream host has no streams" << std::endl;
+        return false;
+    }
+
+    m_upscalers.clear();
+    size_t workers = m_config.workers;
+    if (m_config.max_batch > 1 && startBatcher()) {
+        // Enough callers in flight for a batch to fill up
+        workers = std::max(workers, m_config.max_batch);
+    }
+    for (size_t i = 0; !m_batcher && i < workers; i++) {
+        auto upscaler = std::make_unique<Upscaler>(m_config.algorithm, m_config.use_gpu);
+        if (!upscaler->initialize(m_config.target_width, m_config.target_height)) {
+            std::cerr << "Failed to initialize shared upscaler " << i << std::endl;
+            m_upscalers.clear();
+            return false;
+        }
+        upscaler->setUseTemporalConsistency(false);
+        m_upscalers.push_back(std::move(upscaler));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = false;
+        for (auto& stream : m_streams) {
+            stream->has_pending = false;
+            stream->in_service = false;
+            stream->capture_done = false;
+        }
+    }
+    m_running = true;
+
+    for (size_t i = 0; i < workers; i++) {
+        m_workers.emplace_back(&StreamHost::workerLoop, this, i);
+    }
+    for (auto& stream : m_streams) {
+        stream->capture = std::thread(&StreamHost::captureLoop, this, std::ref(*stream));
+    }
+
+    if (m_batcher) {
+        std::cout << "Stream host running " << m_streams.size() << " streams on one batched model, "
+                  << workers << " workers, batches of " << m_config.max_batch << std::endl;
+    } else {
+        std::cout << "Stream host running " << m_streams.size() << " streams on "
+                  << m_upscalers.size() << " shared " << m_upscalers.front()->getAlgorithmName()
+                  << " upscaler(s)" << std::endl;
+    }
+    return true;
+}
+
+bool StreamHost::startBatcher() {
+    if (m_config.algorithm != Upscaler::SUPER_RES) {
+        std::cerr << "Warning: Batching only applies to FSRCNN super-resolution" << std::endl;
+        return false;
+    }
+
+    auto model = std::make_shared<DnnSuperRes>("models/FSRCNN_x4.pb", "fsrcnn", 4, DnnSuperRes::FSRCNN);
+    model->setTargetSize(m_config.target_width, m_config.target_height);
+    model->setUseGPU(m_config.use_gpu);
+    if (!model->initialize()) {
+        std::cerr << "Warning: Batched model unavailable, using one upscaler per worker" << std::endl;
+        return false;
+    }
+
+    BatchedSuperRes::Config batch_config;
+    batch_config.max_batch = m_config.max_batch;
+    batch_config.max_wait_ms = m_config.batch_wait_ms;
+    m_batcher = std::make_unique<BatchedSuperRes>(model, batch_config);
+    if (!m_batcher->start()) {
+        m_batcher.reset();
+        return false;
+    }
+    return true;
+}
+
+void StreamHost::stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_running) {
+            return;
+        }
+        m_stopping = true;
+    }
+    m_work_available.notify_all();
+
+    for (auto& stream : m_streams) {
+        if (stream->capture.joinable()) {
+            stream->capture.join();
+        }
+    }
+    for (auto& worker : m_workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    m_workers.clear();
+    m_upscalers.clear();
+    if (m_batcher) {
+        m_batcher->stop();
+        m_batcher.reset();
+    }
+    m_running = false;
+}
+
+bool StreamHost::allFinished() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto& stream : m_streams) {
+        if (!stream->capture_done || stream->has_pending || stream->in_service) {
+            return false;
+        }
+    }
+    return true;
+}
+
+FrameBuffer& StreamHost::output(size_t stream) {
+    return *m_streams.at(stream)->output;
+}
+
+const std::string& StreamHost::streamName(size_t stream) const {
+    return m_streams.at(stream)->config.name;
+}
+
+void StreamHost::captureLoop(Stream& stream) {
+    const bool paced = stream.config.realtime && !stream.config.video_source.empty() &&
+                       stream.camera->getFPS() > 0;
+    const auto frame_interval = std::chrono::microseconds(
+        paced ? static_cast<long long>(1000000.0 / stream.camera->getFPS()) : 0);
+    auto next_frame_time = std::chrono::steady_clock::now();
+    uint64_t frame_id = 0;
+    Trace::setThreadName("capture." + stream.config.name);
+
+    cv::Mat frame;
+    FrameMetadata metadata;
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_stopping) {
+                break;
+            }
+        }
+
+        // Live cameras deliver from their grab thread; the timeout rechecks
+        // m_stopping
+        if (!stream.camera->waitForFrame(100)) {
+            continue;
+        }
+
+        metadata = FrameMetadata();
+        metadata.enter(FrameMetadata::CAPTURE);
+        Trace::setFrame(frame_id);
+        TraceScope capture_span("capture");
+        if (!stream.camera->getFrame(frame, metadata) || frame.empty()) {
+            // Files are done at the first failed read; a camera only when it
+            // has closed, otherwise the grabber just had nothing new yet
+            if (!stream.config.video_source.empty() || !stream.camera->isOpened()) {
+                break;
+            }
+            continue;
+        }
+        capture_span.end();
+        metadata.exit(FrameMetadata::CAPTURE);
+        metadata.frame_id = frame_id++;
+        stream.captured++;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (stream.has_pending) {
+                // Live: a frame nobody picked up yet is superseded by this one
+                stream.dropped++;
+                Metrics::instance().add(stream.metric_dropped);
+            }
+            // The previous pending storage comes back for the next capture
+            cv::swap(stream.pending, frame);
+            stream.pending_metadata = metadata;
+            stream.has_pending = true;
+        }
+        m_work_available.notify_one();
+
+        if (paced) {
+            next_frame_time += frame_interval;
+            std::this_thread::sleep_until(next_frame_time);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        stream.capture_done = true;
+    }
+    m_work_available.notify_all();
+}
+
+StreamHost::Stream* StreamHost::selectStream() {
+    Stream* best = nullptr;
+    FrameMetadata::TimePoint best_deadline;
+    for (auto& stream : m_streams) {
+        if (!stream->has_pending || stream->in_service) {
+            continue;
+        }
+
+        auto deadline = stream->pending_metadata.capture_time +
+            std::chrono::duration_cast<FrameMetadata::Clock::duration>(
+                std::chrono::duration<double, std::milli>(stream->config.latency_target_ms));
+        if (!best || deadline < best_deadline) {
+            best = stream.get();
+            best_deadline = deadline;
+        }
+    }
+    return best;
+}
+
+void StreamHost::workerLoop(size_t worker) {
+    Upscaler* upscaler = m_batcher ? nullptr : m_upscalers[worker].get();
+    const cv::Size target_size(m_config.target_width, m_config.target_height);
+    cv::Mat input, upscaled, output;
+    Trace::setThreadName("worker." + std::to_string(worker));
+
+    while (true) {
+        Stream* stream = nullptr;
+        FrameMetadata metadata;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_work_available.wait(lock, [this, &stream]() {
+                return m_stopping || (stream = selectStream()) != nullptr;
+            });
+            if (m_stopping) {
+                break;
+            }
+
+            cv::swap(input, stream->pending);
+            metadata = stream->pending_metadata;
+            stream->has_pending = false;
+            stream->in_service = true;
+        }
+
+        metadata.enter(FrameMetadata::PROCESS);
+        Trace::setFrame(metadata.frame_id);
+        TraceScope upscale_span("upscale");
+        auto start = Metrics::Clock::now();
+        bool success = false;
+        try {
+            success = (upscaler ? upscaler->upscale(input, upscaled)
+                                : m_batcher->upscale(input, upscaled)) && !upscaled.empty();
+        } catch (const cv::Exception& e) {
+            std::cerr << "Error upscaling stream " << stream->config.name << ": " << e.what() << std::endl;
+        }
+        if (!success || upscaled.size() != target_size) {
+            cv::resize(input, upscaled, target_size, 0, 0, cv::INTER_LINEAR);
+        }
+        Metrics::instance().recordSince(m_metric_upscale, start);
+        upscale_span.end();
+
+        // Only this worker touches the stream's temporal state while it is in service
+        const cv::Mat* result = &upscaled;
+        if (stream->temporal && stream->temporal->process(upscaled, output)) {
+            result = &output;
+        }
+        metadata.exit(FrameMetadata::PROCESS);
+
+        double latency_ms = std::chrono::duration<double, std::milli>(
+            FrameMetadata::Clock::now() - metadata.capture_time).count();
+        Metrics::instance().record(stream->metric_latency, latency_ms);
+        if (latency_ms > stream->config.latency_target_ms) {
+            stream->deadline_misses++;
+        }
+
+        if (stream->output->pushFrame(*result, metadata, false)) {
+            stream->processed++;
+        } else {
+            stream->dropped++;
+            Metrics::instance().add(stream->metric_dropped);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            stream->in_service = false;
+        }
+        // The stream may already have its next frame waiting
+        m_work_available.notify_one();
+    }
+}
+
+std::vector<StreamHost::StreamStats> StreamHost::getStreamStats() const {
+    std::vector<StreamStats> stats;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto& stream : m_streams) {
+        StreamStats entry;
+        entry.name = stream->config.name;
+        entry.captured = stream->captured;
+        entry.processed = stream->processed;
+        entry.dropped = stream->dropped;
+        entry.deadline_misses = stream->deadline_misses;
+        entry.finished = stream->capture_done && !stream->has_pending && !stream->in_service;
+
+        Metrics::Snapshot latency = Metrics::instance().snapshot(stream->metric_latency);
+        entry.latency_p50_ms = latency.p50_ms;
+        entry.latency_p99_ms = latency.p99_ms;
+        stats.push_back(entry);
+    }
+    return stats;
+}
+
+std::string StreamHost::toTable() const {
+    std::ostringstream out;
+    out << std::left << std::setw(16) << "Stream" << " | "
+        << std::right << std::setw(9) << "Captured" << " | "
+        << std::setw(9) << "Processed" << " | "
+        << std::setw(8) << "Dropped" << " | "
+        << std::setw(8) << "Missed" << " | "
+        << std::setw(9) << "p50 (ms)" << " | "
+        << std::setw(9) << "p99 (ms)" << "\n";
+    out << std::string(87, '-') << "\n";
+
+    out << std::fixed << std::setprecision(1);
+    for (const StreamStats& entry : getStreamStats()) {
+        out << std::left << std::setw(16) << entry.name.substr(0, 16) << " | "
+            << std::right << std::setw(9) << entry.captured << " | "
+            << std::setw(9) << entry.processed << " | "
+            << std::setw(8) << entry.dropped << " | "
+            << std::setw(8) << entry.deadline_misses << " | "
+            << std::setw(9) << entry.latency_p50_ms << " | "
+            << std::setw(9) << entry.latency_p99_ms << "\n";
+    }
+    return out.str();
+}
@@ -0,0 +1,257 @@
+#include "task_pool.h"
+#include "trace.h"
+#include "thread_placement.h"
+#include <opencv2/core.hpp>
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+#if __has_include(<opencv2/core/parallel/parallel_backend.hpp>)
+#include <opencv2/core/parallel/parallel_backend.hpp>
+#define HAVE_OPENCV_PARALLEL_BACKEND 1
+#endif
+
+namespace {
+
+// Worker index of the current thread (0 outside the pool)
+thread_local int t_worker_index = 0;
+
+#ifdef HAVE_OPENCV_PARALLEL_BACKEND
+// OpenCV parallel_for_ on top of the shared pool
+class TaskPoolBackend : public cv::parallel::ParallelForAPI {
+public:
+    void parallel_for(int tasks, FN_parallel_for_body_cb_t body_callback, void* callback_data) override {
+        TaskPool::instance().parallelFor(0, tasks, [&](int begin, int end) {
+            body_callback(begin, end, callback_data);
+        }, 1);
+    }
+
+    int getThreadNum() const override {
+        return TaskPool::currentThreadIndex();
+    }
+
+    int getNumThreads() const override {
+        return static_cast<int>(TaskPool::instance().threadCount());
+    }
+
+    int setNumThreads(int) override {
+        // The pipeline owns the pool size
+        return getNumThreads();
+    }
+
+    const char* getName() const override {
+        return "video_processor";
+    }
+};
+#endif
+
+} // namespace
+
+TaskPool& TaskPool::instance() {
+    static TaskPool pool;
+    return pool;
+}
+
+TaskPool::TaskPool()
+    : m_stop(false),
+      m_queued(0),
+      m_next_victim(0) {
+}
+
+TaskPool::~TaskPool() {
+    stopWorkers();
+}
+
+size_t TaskPool::threadsBeside(size_t pipeline_threads) {
+    size_t hardware = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    return hardware > pipeline_threads ? hardware - pipeline_threads : 1;
+}
+
+void TaskPool::configure(size_t threads) {
+    if (threads == 0) {
+        threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    }
+
+    stopWorkers();
+    startWorkers(threads - 1);
+    std::cout << "Task pool running tiles on " << threadCount() << " threads" << std::endl;
+}
+
+size_t TaskPool::threadCount() const {
+    return m_workers.size() + 1;
+}
+
+int TaskPool::currentThreadIndex() {
+    return t_worker_index;
+}
+
+bool TaskPool::installOpenCVBackend() {
+#ifdef HAVE_OPENCV_PARALLEL_BACKEND
+    try {
+        cv::parallel::setParallelForBackend(std::make_shared<TaskPoolBackend>(), false);
+        std::cout << "OpenCV parallel_for_ runs on the shared task pool" << std::endl;
+        return true;
+    } catch (const cv::Exception& e) {
+        std::cerr << "Failed to install the task pool as OpenCV backend: " << e.what() << std::endl;
+    }
+#endif
+    // Same core budget, separate threads
+    cv::setNumThreads(static_cast<int>(threadCount()));
+    std::cout << "OpenCV limited to " << threadCount() << " threads" << std::endl;
+    return false;
+}
+
+void TaskPool::startWorkers(size_t count) {
+    m_stop = false;
+    for (size_t i = 0; i < count; i++) {
+        m_workers.push_back(std::make_unique<Worker>());
+    }
+    // Threads start after every deque exists, since workers steal from all of them
+    for (size_t i = 0; i < count; i++) {
+        m_workers[i]->thread = std::thread(&TaskPool::workerLoop, this, i);
+    }
+}
+
+void TaskPool::stopWorkers() {
+    {
+        std::lock_guard<std::mutex> lock(m_wake_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+
+    for (auto& worker : m_workers) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+    m_workers.clear();
+    m_queued = 0;
+}
+
+void TaskPool::parallelFor(int begin, int end, const RangeBody& body, int grain) {
+    if (end <= begin) {
+        return;
+    }
+
+    const int length = end - begin;
+    const int threads = static_cast<int>(threadCount());
+    if (grain <= 0) {
+        grain = std::max(1, length / (threads * 4));
+    }
+
+    // Small ranges and pool-less runs stay on the calling thread
+    if (m_workers.empty() || length <= grain) {
+        body(begin, end);
+        return;
+    }
+
+    Group group;
+    const int tiles = (length + grain - 1) / grain;
+    group.pending = tiles;
+    group.frame = Trace::currentFrame();
+
+    // A worker queues on its own deque (others steal from it); an outside
+    // caller spreads the tiles over every worker
+    const int self = t_worker_index - 1;
+    size_t victim = m_next_victim.fetch_add(1, std::memory_order_relaxed);
+    for (int tile = 0; tile < tiles; tile++) {
+        const int tile_begin = begin + tile * grain;
+        const int tile_end = std::min(end, tile_begin + grain);
+        Worker& worker = self >= 0 ? *m_workers[self] : *m_workers[(victim + tile) % m_workers.size()];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.tasks.push_back({&body, tile_begin, tile_end, &group});
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_wake_mutex);
+        m_queued += tiles;
+    }
+    m_wake.notify_all();
+
+    // Help until the queues run dry, then wait for tiles still running elsewhere
+    while (group.pending.load() > 0 && runOne(self)) {
+    }
+    {
+        std::unique_lock<std::mutex> lock(group.mutex);
+        group.done.wait(lock, [&group]() { return group.pending.load() == 0; });
+    }
+
+    if (group.error) {
+        std::rethrow_exception(group.error);
+    }
+}
+
+void TaskPool::workerLoop(size_t index) {
+    t_worker_index = static_cast<int>(index) + 1;
+    Trace::setThreadName("pool." + std::to_string(t_worker_index));
+    ThreadPlacement::instance().apply(ThreadPlacement::POOL);
+
+    while (true) {
+        if (runOne(static_cast<int>(index))) {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_wake_mutex);
+        m_wake.wait(lock, [this]() { return m_stop.load() || m_queued.load() > 0; });
+        if (m_stop.load()) {
+            break;
+        }
+    }
+}
+
+bool TaskPool::runOne(int self) {
+    Task task{};
+    bool found = false;
+
+    // Own tiles newest first: they are the most likely to be in cache
+    if (self >= 0) {
+        Worker& worker = *m_workers[self];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (!worker.tasks.empty()) {
+            task = worker.tasks.back();
+            worker.tasks.pop_back();
+            found = true;
+        }
+    }
+
+    // Steal the oldest tile of another worker
+    const size_t count = m_workers.size();
+    const size_t start = self >= 0 ? static_cast<size_t>(self) + 1 : m_next_victim.load(std::memory_order_relaxed);
+    for (size_t i = 0; !found && i < count; i++) {
+        Worker& worker = *m_workers[(start + i) % count];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (!worker.tasks.empty()) {
+            task = worker.tasks.front();
+            worker.tasks.pop_front();
+            found = true;
+        }
+    }
+
+    if (!found) {
+        return false;
+    }
+
+    m_queued.fetch_sub(1);
+    execute(task);
+    return true;
+}
+
+void TaskPool::execute(const Task& task) {
+    Group& group = *task.group;
+    try {
+        TraceScope span("pool.tile");
+        span.setFrame(group.frame);
+        (*task.body)(task.begin, task.end);
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(group.mutex);
+        if (!group.error) {
+            group.error = std::current_exception();
+        }
+    }
+
+    // Decrement under the lock: the waiter may destroy the group as soon as
+    // it sees zero, so the notify must happen before it can get the mutex
+    std::lock_guard<std::mutex> lock(group.mutex);
+    if (--group.pending == 0) {
+        group.done.notify_all();
+    }
+}
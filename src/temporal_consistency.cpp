@@ -7,20 +7,53 @@
 #include <opencv2/cudawarping.hpp>
 #include <opencv2/cudaarithm.hpp>
 #include <opencv2/cudaimgproc.hpp>
+#include "gpu_utils.h"
 #endif
 
+namespace {
+
+// Fill an identity sampling grid (x and y coordinates of every pixel)
+void buildIdentityGrid(const cv::Size& size, cv::Mat& grid_x, cv::Mat& grid_y) {
+    grid_x.create(size, CV_32F);
+    grid_y.create(size, CV_32F);
+    for (int y = 0; y < size.height; y++) {
+        float* row_x = grid_x.ptr<float>(y);
+        float* row_y = grid_y.ptr<float>(y);
+        for (int x = 0; x < size.width; x++) {
+            row_x[x] = static_cast<float>(x);
+            row_y[x] = static_cast<float>(y);
+        }
+    }
+}
+
+// Weight of the history entry at @p age; the current frame has weight 1
+double historyWeight(size_t age, float blend_strength) {
+    return std::exp(-static_cast<double>(age + 1) / 2.0) * blend_strength;
+}
+
+} // namespace
+
 TemporalConsistency::TemporalConsistency() 
-    : m_initialized(false) {
+    : m_initialized(false),
+      m_has_prev(false),
+      m_memory("temporal_history", MemoryBudget::HOST),
+      m_features(std::make_shared<FrameFeatures>()),
+      m_shared_features(false) {
+#ifdef WITH_CUDA
+    m_d_has_prev = false;
+#endif
 }
 
 TemporalConsistency::TemporalConsistency(const Config& config)
-    : m_config(config), m_initialized(false) {
+    : TemporalConsistency() {
+    m_config = config;
 }
 
 TemporalConsistency::~TemporalConsistency() {
 }
 
 bool TemporalConsistency::initialize() {
+    resizeHistory();
     reset();
     
     // Check if GPU is available when requested
@@ -31,6 +64,11 @@ bool TemporalConsistency::initialize() {
             m_config.use_gpu = false;
         } else {
             std::cout << "Using CUDA for temporal consistency processing." << std::endl;
+            
+            if (!createGpuResources()) {
+                std::cerr << "Failed to create CUDA optical flow for temporal consistency. Using CPU fallback." << std::endl;
+                m_config.use_gpu = false;
+            }
         }
 #else
         std::cout << "CUDA requested for temporal consistency but OpenCV was built without CUDA support. Using CPU fallback." << std::endl;
@@ -43,21 +81,99 @@ bool TemporalConsistency::initialize() {
 }
 
 void TemporalConsistency::reset() {
+    // Buffers stay allocated; only the history is forgotten
     std::lock_guard<std::mutex> lock(m_buffer_mutex);
-    m_frame_buffer.clear();
-    m_gray_buffer.clear();
-    m_flow_buffer.clear();
+    m_has_prev = false;
+    m_history.clear();
+#ifdef WITH_CUDA
+    m_d_has_prev = false;
+    m_d_history.clear();
+#endif
 }
 
 void TemporalConsistency::setConfig(const Config& config) {
     std::lock_guard<std::mutex> lock(m_buffer_mutex);
+    bool resize = config.buffer_size != m_config.buffer_size;
     m_config = config;
+    
+    if (resize) {
+        resizeHistory();
+    }
+    
+#ifdef WITH_CUDA
+    // Flow parameters are baked into the device optical flow object
+    if (m_initialized && m_config.use_gpu && !createGpuResources()) {
+        m_config.use_gpu = false;
+    }
+#endif
 }
 
 TemporalConsistency::Config TemporalConsistency::getConfig() const {
     return m_config;
 }
 
+void TemporalConsistency::setFeatures(std::shared_ptr<FrameFeatures> features) {
+    m_shared_features = features != nullptr;
+    m_features = features ? std::move(features) : std::make_shared<FrameFeatures>();
+}
+
+bool TemporalConsistency::getReliabilityMask(cv::Mat& mask) {
+    std::lock_guard<std::mutex> lock(m_buffer_mutex);
+#ifdef WITH_CUDA
+    // Host frames are routed through the device path when it is active
+    if (!m_d_history.empty()) {
+        m_d_history.at(0).mask.download(mask);
+        return true;
+    }
+#endif
+    if (m_history.empty() || m_history.at(0).mask.empty()) {
+        return false;
+    }
+    m_history.at(0).mask.copyTo(mask);
+    return true;
+}
+
+#ifdef WITH_CUDA
+bool TemporalConsistency::getReliabilityMask(cv::cuda::GpuMat& mask, cv::cuda::Stream& stream) {
+    std::lock_guard<std::mutex> lock(m_buffer_mutex);
+    if (m_d_history.empty() || m_d_history.at(0).mask.empty()) {
+        return false;
+    }
+    m_d_history.at(0).mask.copyTo(mask, stream);
+    return true;
+}
+#endif
+
+void TemporalConsistency::resizeHistory() {
+    // Each entry holds one warped predecessor; the oldest is buffer_size - 1 frames back
+    size_t capacity = static_cast<size_t>(std::max(m_config.buffer_size - 1, 1));
+    m_history.reserve(capacity);
+    m_has_prev = false;
+#ifdef WITH_CUDA
+    m_d_history.reserve(capacity);
+    m_d_has_prev = false;
+#endif
+}
+
+template <typename Entry>
+void TemporalConsistency::fitHistory(HistoryRing<Entry>& history, const cv::Size& size, int type,
+                                     MemoryBudget::Pool pool) {
+    // Each entry is a warped frame and its CV_32F mask. The previous frame
+    // and the flow/blend workspace (about 20 float planes) are needed at any
+    // depth, so they are charged first.
+    const size_t entry_bytes = MemoryBudget::frameBytes(size, type) + MemoryBudget::frameBytes(size, CV_32F);
+    const size_t fixed_bytes = MemoryBudget::frameBytes(size, type) + 20 * MemoryBudget::frameBytes(size, CV_32F);
+    const size_t wanted = static_cast<size_t>(std::max(m_config.buffer_size - 1, 1));
+    
+    m_memory.setPool(pool);
+    m_memory.set(fixed_bytes);
+    size_t depth = MemoryBudget::instance().fit(pool, entry_bytes, wanted, 1, "temporal history depth");
+    if (depth != history.capacity()) {
+        history.reserve(depth);
+    }
+    m_memory.set(fixed_bytes + depth * entry_bytes);
+}
+
 bool TemporalConsistency::process(const cv::Mat& current_frame, cv::Mat& output_frame) {
     if (!m_initialized) {
         std::cerr << "Temporal consistency module not initialized" << std::endl;
@@ -70,151 +186,89 @@ bool TemporalConsistency::process(const cv::Mat& current_frame, cv::Mat& output_
         return false;
     }
     
-    // Convert current frame to grayscale for optical flow
-    cv::Mat current_gray;
-    cv::cvtColor(current_frame, current_gray, cv::COLOR_BGR2GRAY);
+#ifdef WITH_CUDA
+    // Flow, remap and blending all run on the device: one upload, one download
+    if (m_config.use_gpu && m_d_farneback && m_d_stream) {
+        try {
+            cv::cuda::Stream& stream = *m_d_stream;
+            m_d_input.upload(current_frame, stream);
+            bool result = process(m_d_input, m_d_output, stream);
+            m_d_output.download(output_frame, stream);
+            stream.waitForCompletion();
+            return result;
+        } catch (const cv::Exception& e) {
+            std::cerr << "Error in temporal consistency (GPU): " << e.what() << std::endl;
+            current_frame.copyTo(output_frame);
+            return false;
+        }
+    }
+#endif
     
     std::lock_guard<std::mutex> lock(m_buffer_mutex);
+    Workspace<cv::Mat>& ws = m_workspace;
     
-    // If this is the first frame or if buffer is still filling
-    if (m_frame_buffer.empty()) {
-        // First frame, just store it and return
-        m_frame_buffer.push_back(current_frame.clone());
-        m_gray_buffer.push_back(current_gray.clone());
-        current_frame.copyTo(output_frame);
-        return true;
+    // Grayscale for optical flow; another stage may already have converted
+    // this frame. The copy becomes the next frame's m_prev_gray.
+    if (!m_shared_features) {
+        m_features->invalidate();
     }
+    m_features->gray(current_frame).copyTo(ws.current_gray);
     
-    // Check for scene change
-    bool scene_change = false;
-    if (!m_gray_buffer.empty()) {
-        scene_change = detectSceneChange(m_gray_buffer.back(), current_gray);
+    // A resolution change invalidates the history like a scene change
+    if (m_has_prev && m_prev_frame.size() != current_frame.size()) {
+        m_has_prev = false;
+        m_history.clear();
     }
-    
-    // Calculate optical flow between current and previous frame
-    cv::Mat flow;
-    if (!scene_change && calculateOpticalFlow(m_gray_buffer.back(), current_gray, flow)) {
-        m_flow_buffer.push_back(flow.clone());
-    } else {
-        // If scene change or flow calculation failed, reset buffer
-        if (scene_change) {
-            std::cout << "Scene change detected, resetting temporal buffer" << std::endl;
-            m_frame_buffer.clear();
-            m_gray_buffer.clear();
-            m_flow_buffer.clear();
-        }
-        
-        // Add current frame to buffer and return it as output
-        m_frame_buffer.push_back(current_frame.clone());
-        m_gray_buffer.push_back(current_gray.clone());
-        current_frame.copyTo(output_frame);
-        return true;
+    if (!m_has_prev) {
+        fitHistory(m_history, current_frame.size(), current_frame.type(), MemoryBudget::HOST);
     }
     
-    // If we have at least one flow field and two frames, we can apply temporal consistency
-    if (!m_flow_buffer.empty() && m_frame_buffer.size() >= 1) {
-        // Create a vector to hold all frames for blending
-        std::vector<cv::Mat> frames_to_blend;
-        std::vector<cv::Mat> reliability_masks;
-        
-        // Add current frame as the first one
-        frames_to_blend.push_back(current_frame.clone());
-        // Add identity reliability mask for current frame (full weight)
-        cv::Mat identity_mask = cv::Mat::ones(current_frame.size(), CV_32F);
-        reliability_masks.push_back(identity_mask);
-        
-        // For each previous frame and flow field
-        for (size_t i = 0; i < m_flow_buffer.size() && i < m_frame_buffer.size(); i++) {
-            // Get frame and flow
-            const cv::Mat& prev_frame = m_frame_buffer[m_frame_buffer.size() - 1 - i];
-            const cv::Mat& flow_field = m_flow_buffer[m_flow_buffer.size() - 1 - i];
-            
-            // Warp previous frame to align with current frame
-            cv::Mat warped_frame;
-            if (warpFrame(prev_frame, flow_field, warped_frame)) {
-                // Calculate reliability mask for this warped frame
-                cv::Mat reliability_mask;
-                calculateFlowReliabilityMask(flow_field, reliability_mask);
-                
-                // Add to blend arrays
-                frames_to_blend.push_back(warped_frame);
-                reliability_masks.push_back(reliability_mask);
-            }
-        }
+    bool blend = false;
+    if (m_has_prev) {
+        bool scene_change = detectSceneChange(m_prev_gray, ws.current_gray);
         
-        // Blend all frames using calculated reliability masks
-        if (frames_to_blend.size() > 1) {
-            blendFrames(frames_to_blend, reliability_masks, output_frame);
+        // Warp the previous frame onto the current one; older warps are already in the history
+        if (!scene_change && calculateOpticalFlow(m_prev_gray, ws.current_gray, ws.flow)) {
+            HistoryEntry<cv::Mat>& entry = m_history.push();
+            if (warpFrame(m_prev_frame, ws.flow, entry.warped)) {
+                calculateFlowReliabilityMask(ws.flow, entry.mask);
+                blend = true;
+            } else {
+                m_history.clear();
+            }
         } else {
-            // If we only have the current frame, just return it
-            current_frame.copyTo(output_frame);
+            // If scene change or flow calculation failed, restart the history
+            if (scene_change) {
+                std::cout << "Scene change detected, resetting temporal buffer" << std::endl;
+            }
+            m_history.clear();
         }
-    } else {
-        // Not enough data for temporal blending yet
-        current_frame.copyTo(output_frame);
     }
     
-    // Update frame buffer
-    m_frame_buffer.push_back(current_frame.clone());
-    m_gray_buffer.push_back(current_gray.clone());
-    
-    // Keep buffer size in check
-    while (m_frame_buffer.size() > m_config.buffer_size) {
-        m_frame_buffer.pop_front();
-        m_gray_buffer.pop_front();
-    }
+    // Update the previous frame before writing the output, which may alias the input
+    current_frame.copyTo(m_prev_frame);
+    std::swap(m_prev_gray, ws.current_gray);
+    m_has_prev = true;
     
-    while (m_flow_buffer.size() >= m_config.buffer_size) {
-        m_flow_buffer.pop_front();
+    if (blend) {
+        blendFrames(m_prev_frame, m_history, output_frame);
+    } else {
+        m_prev_frame.copyTo(output_frame);
     }
+    m_features->invalidate(output_frame);
     
     return true;
 }
 
 bool TemporalConsistency::calculateOpticalFlow(const cv::Mat& prev_frame, const cv::Mat& curr_frame, cv::Mat& flow) {
     try {
-        if (m_config.use_gpu) {
-#ifdef WITH_CUDA
-            // GPU implementation using CUDA
-            cv::cuda::GpuMat d_prev, d_curr, d_flow;
-            d_prev.upload(prev_frame);
-            d_curr.upload(curr_frame);
-            
-            // Create Farneback flow object with configured parameters
-            auto farneback = cv::cuda::FarnebackOpticalFlow::create(
-                m_config.levels,
-                m_config.pyr_scale,
-                false, // fastPyramids
-                m_config.winsize,
-                m_config.iterations,
-                m_config.poly_n,
-                m_config.poly_sigma,
-                m_config.flags
-            );
-            
-            // Calculate flow
-            farneback->calc(d_prev, d_curr, d_flow);
-            
-            // Download result
-            d_flow.download(flow);
-#else
-            // Fall back to CPU if CUDA was requested but not available at compile time
-            cv::calcOpticalFlowFarneback(
-                prev_frame, curr_frame, flow,
-                m_config.pyr_scale, m_config.levels, m_config.winsize,
-                m_config.iterations, m_config.poly_n, m_config.poly_sigma,
-                m_config.flags
-            );
-#endif
-        } else {
-            // CPU implementation
-            cv::calcOpticalFlowFarneback(
-                prev_frame, curr_frame, flow,
-                m_config.pyr_scale, m_config.levels, m_config.winsize,
-                m_config.iterations, m_config.poly_n, m_config.poly_sigma,
-                m_config.flags
-            );
-        }
+        // Host frames only reach this when the device path is off
+        cv::calcOpticalFlowFarneback(
+            prev_frame, curr_frame, flow,
+            m_config.pyr_scale, m_config.levels, m_config.winsize,
+            m_config.iterations, m_config.poly_n, m_config.poly_sigma,
+            m_config.flags
+        );
         
         return !flow.empty();
     } catch (const cv::Exception& e) {
@@ -225,54 +279,19 @@ bool TemporalConsistency::calculateOpticalFlow(const cv::Mat& prev_frame, const
 
 bool TemporalConsistency::warpFrame(const cv::Mat& frame, const cv::Mat& flow, cv::Mat& warped_frame) {
     try {
-        if (m_config.use_gpu) {
-#ifdef WITH_CUDA
-            // GPU implementation
-            cv::cuda::GpuMat d_frame, d_flow, d_warped;
-            d_frame.upload(frame);
-            d_flow.upload(flow);
-            
-            // Remap using the flow field
-            cv::cuda::remap(d_frame, d_warped, flow, cv::noArray(), 
-                          cv::INTER_LINEAR, cv::BORDER_REPLICATE);
-            
-            // Download result
-            d_warped.download(warped_frame);
-#else
-            // CPU implementation if CUDA requested but not available
-            // Create map from flow field
-            cv::Mat map_x(flow.size(), CV_32F);
-            cv::Mat map_y(flow.size(), CV_32F);
-            
-            for (int y = 0; y < flow.rows; y++) {
-                for (int x = 0; x < flow.cols; x++) {
-                    const cv::Vec2f& f = flow.at<cv::Vec2f>(y, x);
-                    map_x.at<float>(y, x) = x + f[0];
-                    map_y.at<float>(y, x) = y + f[1];
-                }
-            }
-            
-            // Apply mapping
-            cv::remap(frame, warped_frame, map_x, map_y, cv::INTER_LINEAR, cv::BORDER_REPLICATE);
-#endif
-        } else {
-            // CPU implementation
-            // Create map from flow field
-            cv::Mat map_x(flow.size(), CV_32F);
-            cv::Mat map_y(flow.size(), CV_32F);
-            
-            for (int y = 0; y < flow.rows; y++) {
-                for (int x = 0; x < flow.cols; x++) {
-                    const cv::Vec2f& f = flow.at<cv::Vec2f>(y, x);
-                    map_x.at<float>(y, x) = x + f[0];
-                    map_y.at<float>(y, x) = y + f[1];
-                }
-            }
-            
-            // Apply mapping
-            cv::remap(frame, warped_frame, map_x, map_y, cv::INTER_LINEAR, cv::BORDER_REPLICATE);
+        Workspace<cv::Mat>& ws = m_workspace;
+        
+        // Identity sampling grid, rebuilt only when the resolution changes
+        if (ws.grid_x.size() != flow.size()) {
+            buildIdentityGrid(flow.size(), ws.grid_x, ws.grid_y);
         }
         
+        cv::split(flow, ws.flow_xy);
+        cv::add(ws.grid_x, ws.flow_xy[0], ws.map_x);
+        cv::add(ws.grid_y, ws.flow_xy[1], ws.map_y);
+        
+        cv::remap(frame, warped_frame, ws.map_x, ws.map_y, cv::INTER_LINEAR, cv::BORDER_REPLICATE);
+        
         return !warped_frame.empty();
     } catch (const cv::Exception& e) {
         std::cerr << "Error warping frame: " << e.what() << std::endl;
@@ -299,7 +318,7 @@ bool TemporalConsistency::detectSceneChange(const cv::Mat& prev_frame, const cv:
         double difference = 1.0 - correlation; // Convert correlation to difference (0-1)
         
         // Also calculate mean absolute difference between frames
-        cv::Mat diff;
+        cv::Mat& diff = m_workspace.diff;
         cv::absdiff(prev_frame, curr_frame, diff);
         double mad = cv::mean(diff)[0];
         
@@ -324,121 +343,312 @@ bool TemporalConsistency::detectSceneChange(const cv::Mat& prev_frame, const cv:
 
 void TemporalConsistency::calculateFlowReliabilityMask(const cv::Mat& flow, cv::Mat& mask) {
     try {
-        // Create a mask based on flow magnitude
-        mask = cv::Mat(flow.size(), CV_32F, cv::Scalar(1.0));
-        
-        // For each pixel, calculate flow magnitude and check against threshold
-        for (int y = 0; y < flow.rows; y++) {
-            for (int x = 0; x < flow.cols; x++) {
-                const cv::Vec2f& f = flow.at<cv::Vec2f>(y, x);
-                float magnitude = std::sqrt(f[0] * f[0] + f[1] * f[1]);
-                
-                // If magnitude is greater than threshold, reduce reliability
-                // using a sigmoid-like falloff for smooth transition
-                if (magnitude > m_config.motion_threshold) {
-                    float reliability = std::exp(-(magnitude - m_config.motion_threshold) / 10.0f);
-                    reliability = std::max(0.0f, std::min(1.0f, reliability));
-                    mask.at<float>(y, x) = reliability;
-                }
-            }
-        }
+        Workspace<cv::Mat>& ws = m_workspace;
+        
+        cv::split(flow, ws.flow_xy);
+        cv::magnitude(ws.flow_xy[0], ws.flow_xy[1], ws.magnitude);
+        
+        // exp(-(magnitude - threshold) / 10) above the threshold, 1 below it
+        ws.magnitude.convertTo(ws.reliability, CV_32F, 1.0, -m_config.motion_threshold);
+        cv::threshold(ws.reliability, ws.reliability, 0.0, 0.0, cv::THRESH_TOZERO);
+        ws.reliability.convertTo(ws.reliability, CV_32F, -0.1, 0.0);
+        cv::exp(ws.reliability, ws.reliability);
         
         // Apply Gaussian blur to the mask for smoother transitions
-        cv::GaussianBlur(mask, mask, cv::Size(15, 15), 5.0);
+        cv::GaussianBlur(ws.reliability, mask, cv::Size(15, 15), 5.0);
     } catch (const cv::Exception& e) {
         std::cerr << "Error calculating flow reliability mask: " << e.what() << std::endl;
         // In case of error, create a neutral mask
-        mask = cv::Mat(flow.size(), CV_32F, cv::Scalar(0.5));
+        mask.create(flow.size(), CV_32F);
+        mask.setTo(cv::Scalar(0.5));
     }
 }
 
-void TemporalConsistency::blendFrames(const std::vector<cv::Mat>& frames, 
-                                      const std::vector<cv::Mat>& reliability_masks, 
+void TemporalConsistency::blendFrames(const cv::Mat& current,
+                                      const HistoryRing<HistoryEntry<cv::Mat>>& history,
                                       cv::Mat& output) {
     try {
-        if (frames.empty() || frames[0].empty()) {
-            if (!frames.empty()) {
-                frames[0].copyTo(output);
+        Workspace<cv::Mat>& ws = m_workspace;
+        const int channels = current.channels();
+        
+        // The current frame always contributes with weight 1
+        current.convertTo(ws.accumulated, CV_32F);
+        ws.weight_sum.create(current.size(), CV_32F);
+        ws.weight_sum.setTo(cv::Scalar(1.0));
+        
+        for (size_t age = 0; age < history.size(); age++) {
+            const HistoryEntry<cv::Mat>& entry = history.at(age);
+            if (entry.warped.size() != current.size() || entry.mask.empty()) {
+                continue;
             }
-            return;
+            
+            // Exponential decay for older frames, scaled by the blend strength
+            entry.mask.convertTo(ws.weight, CV_32F, historyWeight(age, m_config.blend_strength));
+            cv::add(ws.weight_sum, ws.weight, ws.weight_sum);
+            
+            cv::Mat weight_planes[4] = {ws.weight, ws.weight, ws.weight, ws.weight};
+            cv::merge(weight_planes, channels, ws.weight_n);
+            entry.warped.convertTo(ws.frame_float, CV_32F);
+            cv::accumulateProduct(ws.frame_float, ws.weight_n, ws.accumulated);
         }
         
-        // Create result frame initialized with zeros
-        output = cv::Mat::zeros(frames[0].size(), frames[0].type());
+        cv::Mat sum_planes[4] = {ws.weight_sum, ws.weight_sum, ws.weight_sum, ws.weight_sum};
+        cv::merge(sum_planes, channels, ws.weight_sum_n);
+        cv::divide(ws.accumulated, ws.weight_sum_n, ws.accumulated);
+        
+        // Convert back to the input depth
+        ws.accumulated.convertTo(output, current.depth());
+    } catch (const cv::Exception& e) {
+        std::cerr << "Error blending frames: " << e.what() << std::endl;
+        // In case of error, return the current frame
+        current.copyTo(output);
+    }
+}
+
+#ifdef WITH_CUDA
+bool TemporalConsistency::createGpuResources() {
+    try {
+        m_d_farneback = cv::cuda::FarnebackOpticalFlow::create(
+            m_config.levels,
+            m_config.pyr_scale,
+            false, // fastPyramids
+            m_config.winsize,
+            m_config.iterations,
+            m_config.poly_n,
+            m_config.poly_sigma,
+            m_config.flags
+        );
+        m_d_reliability_blur = cv::cuda::createGaussianFilter(CV_32FC1, CV_32FC1, cv::Size(15, 15), 5.0);
+        if (!m_d_stream) {
+            m_d_stream.reset(new cv::cuda::Stream());
+        }
+        return true;
+    } catch (const cv::Exception& e) {
+        std::cerr << "Error creating CUDA optical flow: " << e.what() << std::endl;
+        m_d_farneback.reset();
+        m_d_reliability_blur.reset();
+        return false;
+    }
+}
+
+bool TemporalConsistency::process(const cv::cuda::GpuMat& current_frame, cv::cuda::GpuMat& output_frame,
+                                  cv::cuda::Stream& stream) {
+    if (!m_initialized) {
+        std::cerr << "Temporal consistency module not initialized" << std::endl;
+        current_frame.copyTo(output_frame, stream);
+        return false;
+    }
+    
+    if (current_frame.empty()) {
+        std::cerr << "Empty input frame" << std::endl;
+        return false;
+    }
+    
+    // Without the device flow engine, run the host path once instead of per stage
+    if (!m_config.use_gpu || !m_d_farneback) {
+        cv::Mat h_current, h_output;
+        current_frame.download(h_current, stream);
+        stream.waitForCompletion();
+        bool result = process(h_current, h_output);
+        output_frame.upload(h_output, stream);
+        return result;
+    }
+    
+    try {
+        std::lock_guard<std::mutex> lock(m_buffer_mutex);
+        Workspace<cv::cuda::GpuMat>& ws = m_d_workspace;
         
-        // Create a weight accumulation buffer
-        cv::Mat weight_sum = cv::Mat::zeros(frames[0].size(), CV_32F);
+        cv::cuda::cvtColor(current_frame, ws.current_gray, cv::COLOR_BGR2GRAY, 0, stream);
         
-        // Prepare frame weights with exponential decay for older frames
-        std::vector<float> frame_weights(frames.size());
-        for (size_t i = 0; i < frames.size(); i++) {
-            // Exponential decay weight - newer frames have higher weight
-            frame_weights[i] = std::exp(-static_cast<float>(i) / 2.0f);
+        // A resolution change invalidates the history like a scene change
+        if (m_d_has_prev && m_d_prev_frame.size() != current_frame.size()) {
+            m_d_has_prev = false;
+            m_d_history.clear();
+        }
+        if (!m_d_has_prev) {
+            fitHistory(m_d_history, current_frame.size(), current_frame.type(), MemoryBudget::DEVICE);
         }
         
-        // Apply blending with variable weights
-        for (size_t i = 0; i < frames.size(); i++) {
-            // Skip invalid frames
-            if (frames[i].empty() || frames[i].size() != frames[0].size()) {
-                continue;
-            }
+        bool blend = false;
+        if (m_d_has_prev) {
+            bool scene_change = detectSceneChange(m_d_prev_gray, ws.current_gray, stream);
             
-            // Use reliability mask if available, otherwise use all ones
-            cv::Mat mask;
-            if (i < reliability_masks.size() && !reliability_masks[i].empty()) {
-                mask = reliability_masks[i];
+            // Warp the previous frame onto the current one; older warps are already in the history
+            if (!scene_change && calculateOpticalFlow(m_d_prev_gray, ws.current_gray, ws.flow, stream)) {
+                HistoryEntry<cv::cuda::GpuMat>& entry = m_d_history.push();
+                if (warpFrame(m_d_prev_frame, ws.flow, entry.warped, stream)) {
+                    calculateFlowReliabilityMask(ws.flow, entry.mask, stream);
+                    blend = true;
+                } else {
+                    m_d_history.clear();
+                }
             } else {
-                mask = cv::Mat::ones(frames[i].size(), CV_32F);
-            }
-            
-            // Apply temporal blend strength parameter to all but the current frame
-            float blend_factor = (i == 0) ? 1.0f : m_config.blend_strength;
-            
-            // Convert frame to float for blending
-            cv::Mat frame_float;
-            frames[i].convertTo(frame_float, CV_32F);
-            
-            // For each pixel, accumulate weighted value and weight sum
-            for (int y = 0; y < output.rows; y++) {
-                for (int x = 0; x < output.cols; x++) {
-                    // Calculate pixel weight using reliability mask and frame weight
-                    float weight = frame_weights[i] * mask.at<float>(y, x) * blend_factor;
-                    
-                    // Accumulate weighted pixel value
-                    cv::Vec3f& out_pixel = output.at<cv::Vec3f>(y, x);
-                    const cv::Vec3b& in_pixel = frames[i].at<cv::Vec3b>(y, x);
-                    
-                    out_pixel[0] += weight * in_pixel[0];
-                    out_pixel[1] += weight * in_pixel[1];
-                    out_pixel[2] += weight * in_pixel[2];
-                    
-                    // Accumulate weight
-                    weight_sum.at<float>(y, x) += weight;
+                if (scene_change) {
+                    std::cout << "Scene change detected, resetting temporal buffer" << std::endl;
                 }
+                m_d_history.clear();
             }
         }
         
-        // Normalize by weight sum
-        for (int y = 0; y < output.rows; y++) {
-            for (int x = 0; x < output.cols; x++) {
-                float weight = weight_sum.at<float>(y, x);
-                if (weight > 0) {
-                    cv::Vec3f& pixel = output.at<cv::Vec3f>(y, x);
-                    pixel /= weight;
-                } else {
-                    // If weight is zero, use the current frame
-                    output.at<cv::Vec3f>(y, x) = cv::Vec3f(frames[0].at<cv::Vec3b>(y, x));
-                }
-            }
+        // The history owns its frames, since callers reuse their buffers
+        current_frame.copyTo(m_d_prev_frame, stream);
+        m_d_prev_gray.swap(ws.current_gray);
+        m_d_has_prev = true;
+        
+        if (blend) {
+            blendFrames(m_d_prev_frame, m_d_history, output_frame, stream);
+        } else {
+            m_d_prev_frame.copyTo(output_frame, stream);
         }
         
-        // Convert back to 8-bit
-        output.convertTo(output, CV_8UC3);
+        return true;
     } catch (const cv::Exception& e) {
-        std::cerr << "Error blending frames: " << e.what() << std::endl;
-        // In case of error, return the current frame
-        if (!frames.empty()) {
-            frames[0].copyTo(output);
+        std::cerr << "Error in temporal consistency (GPU): " << e.what() << std::endl;
+        current_frame.copyTo(output_frame, stream);
+        return false;
+    }
+}
+
+bool TemporalConsistency::calculateOpticalFlow(const cv::cuda::GpuMat& prev_frame, const cv::cuda::GpuMat& curr_frame,
+                                               cv::cuda::GpuMat& flow, cv::cuda::Stream& stream) {
+    try {
+        m_d_farneback->calc(prev_frame, curr_frame, flow, stream);
+        return !flow.empty();
+    } catch (const cv::Exception& e) {
+        std::cerr << "Error calculating optical flow (GPU): " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool TemporalConsistency::warpFrame(const cv::cuda::GpuMat& frame, const cv::cuda::GpuMat& flow,
+                                    cv::cuda::GpuMat& warped_frame, cv::cuda::Stream& stream) {
+    try {
+        Workspace<cv::cuda::GpuMat>& ws = m_d_workspace;
+        
+        // Identity sampling grid, rebuilt only when the resolution changes
+        if (ws.grid_x.size() != flow.size()) {
+            cv::Mat grid_x, grid_y;
+            buildIdentityGrid(flow.size(), grid_x, grid_y);
+            ws.grid_x.upload(grid_x, stream);
+            ws.grid_y.upload(grid_y, stream);
+            stream.waitForCompletion();
         }
+        
+        cv::cuda::split(flow, ws.flow_xy, stream);
+        cv::cuda::add(ws.grid_x, ws.flow_xy[0], ws.map_x, cv::noArray(), -1, stream);
+        cv::cuda::add(ws.grid_y, ws.flow_xy[1], ws.map_y, cv::noArray(), -1, stream);
+        
+        cv::cuda::remap(frame, warped_frame, ws.map_x, ws.map_y, cv::INTER_LINEAR,
+                        cv::BORDER_REPLICATE, cv::Scalar(), stream);
+        return !warped_frame.empty();
+    } catch (const cv::Exception& e) {
+        std::cerr << "Error warping frame (GPU): " << e.what() << std::endl;
+        return false;
     }
-}
\ No newline at end of file
+}
+
+bool TemporalConsistency::detectSceneChange(const cv::cuda::GpuMat& prev_frame, const cv::cuda::GpuMat& curr_frame,
+                                            cv::cuda::Stream& stream) {
+    try {
+        // 256-bin histograms on the device; only the bins are downloaded
+        cv::cuda::GpuMat d_prev_hist, d_curr_hist;
+        cv::cuda::GpuMat& d_diff = m_d_workspace.diff;
+        cv::cuda::calcHist(prev_frame, d_prev_hist, stream);
+        cv::cuda::calcHist(curr_frame, d_curr_hist, stream);
+        cv::cuda::absdiff(prev_frame, curr_frame, d_diff, stream);
+        
+        cv::Mat prev_bins, curr_bins;
+        d_prev_hist.download(prev_bins, stream);
+        d_curr_hist.download(curr_bins, stream);
+        stream.waitForCompletion();
+        
+        // Fold into the 64 bins used by the host path
+        const int histSize = 64;
+        cv::Mat prev_hist(histSize, 1, CV_32F, cv::Scalar(0));
+        cv::Mat curr_hist(histSize, 1, CV_32F, cv::Scalar(0));
+        const int* prev_ptr = prev_bins.ptr<int>(0);
+        const int* curr_ptr = curr_bins.ptr<int>(0);
+        for (int i = 0; i < 256; i++) {
+            prev_hist.at<float>(i * histSize / 256) += static_cast<float>(prev_ptr[i]);
+            curr_hist.at<float>(i * histSize / 256) += static_cast<float>(curr_ptr[i]);
+        }
+        
+        cv::normalize(prev_hist, prev_hist, 0, 1, cv::NORM_MINMAX);
+        cv::normalize(curr_hist, curr_hist, 0, 1, cv::NORM_MINMAX);
+        
+        double correlation = cv::compareHist(prev_hist, curr_hist, cv::HISTCMP_CORREL);
+        double difference = 1.0 - correlation;
+        
+        double mad = cv::cuda::sum(d_diff)[0] / (static_cast<double>(d_diff.rows) * d_diff.cols);
+        
+        double combined_diff = (difference * 100.0) + (mad * 0.5);
+        bool is_scene_change = combined_diff > m_config.scene_change_threshold;
+        
+        if (is_scene_change) {
+            std::cout << "Scene change detected: diff=" << combined_diff 
+                      << " (hist_diff=" << difference * 100.0 
+                      << ", mad=" << mad << ")" << std::endl;
+        }
+        
+        return is_scene_change;
+    } catch (const cv::Exception& e) {
+        std::cerr << "Error detecting scene change (GPU): " << e.what() << std::endl;
+        return false;
+    }
+}
+
+void TemporalConsistency::calculateFlowReliabilityMask(const cv::cuda::GpuMat& flow, cv::cuda::GpuMat& mask,
+                                                       cv::cuda::Stream& stream) {
+    try {
+        Workspace<cv::cuda::GpuMat>& ws = m_d_workspace;
+        
+        cv::cuda::split(flow, ws.flow_xy, stream);
+        cv::cuda::magnitude(ws.flow_xy[0], ws.flow_xy[1], ws.magnitude, stream);
+        
+        // exp(-(magnitude - threshold) / 10) above the threshold, 1 below it
+        ws.magnitude.convertTo(ws.reliability, CV_32F, 1.0, -m_config.motion_threshold, stream);
+        cv::cuda::threshold(ws.reliability, ws.reliability, 0.0, 0.0, cv::THRESH_TOZERO, stream);
+        ws.reliability.convertTo(ws.reliability, CV_32F, -0.1, 0.0, stream);
+        cv::cuda::exp(ws.reliability, ws.reliability, stream);
+        
+        m_d_reliability_blur->apply(ws.reliability, mask, stream);
+    } catch (const cv::Exception& e) {
+        std::cerr << "Error calculating flow reliability mask (GPU): " << e.what() << std::endl;
+        mask.create(flow.size(), CV_32FC1);
+        mask.setTo(cv::Scalar(0.5), stream);
+    }
+}
+
+void TemporalConsistency::blendFrames(const cv::cuda::GpuMat& current,
+                                      const HistoryRing<HistoryEntry<cv::cuda::GpuMat>>& history,
+                                      cv::cuda::GpuMat& output,
+                                      cv::cuda::Stream& stream) {
+    try {
+        Workspace<cv::cuda::GpuMat>& ws = m_d_workspace;
+        
+        // The current frame always contributes with weight 1
+        current.convertTo(ws.accumulated, CV_32F, stream);
+        ws.weight_sum.create(current.size(), CV_32FC1);
+        ws.weight_sum.setTo(cv::Scalar(1.0), stream);
+        
+        for (size_t age = 0; age < history.size(); age++) {
+            const HistoryEntry<cv::cuda::GpuMat>& entry = history.at(age);
+            if (entry.warped.size() != current.size() || entry.mask.empty()) {
+                continue;
+            }
+            
+            // Exponential decay for older frames, scaled by the blend strength
+            entry.mask.convertTo(ws.weight, CV_32F, historyWeight(age, m_config.blend_strength), 0.0, stream);
+            gpu_utils::weightedAdd(ws.accumulated, entry.warped, ws.weight, ws.accumulated, stream);
+            cv::cuda::add(ws.weight_sum, ws.weight, ws.weight_sum, cv::noArray(), -1, stream);
+        }
+        
+        gpu_utils::replicateChannels(ws.weight_sum, current.channels(), ws.weight_sum_n, stream);
+        cv::cuda::divide(ws.accumulated, ws.weight_sum_n, ws.accumulated, 1.0, -1, stream);
+        ws.accumulated.convertTo(output, current.depth(), stream);
+    } catch (const cv::Exception& e) {
+        std::cerr << "Error blending frames (GPU): " << e.what() << std::endl;
+        current.copyTo(output, stream);
+    }
+}
+#endif
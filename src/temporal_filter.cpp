@@ -0,0 +1,173 @@
+#include "temporal_filter.h"
+#include <algorithm>
+#include <iostream>
+
+#ifdef WITH_CUDA
+#include <opencv2/cudaarithm.hpp>
+#endif
+
+TemporalFilter::TemporalFilter() {
+}
+
+TemporalFilter::TemporalFilter(const Config& config)
+    : m_config(config) {
+}
+
+void TemporalFilter::reset() {
+    m_host.valid = false;
+#ifdef WITH_CUDA
+    m_device.valid = false;
+#endif
+}
+
+void TemporalFilter::setConfig(const Config& config) {
+    m_config = config;
+}
+
+TemporalFilter::Config TemporalFilter::getConfig() const {
+    return m_config;
+}
+
+float TemporalFilter::historyWeight() const {
+    return std::clamp(m_config.history_weight, 0.0f, 1.0f);
+}
+
+bool TemporalFilter::process(const cv::Mat& frame, cv::Mat& output, const cv::Mat& reliability) {
+    if (frame.empty()) {
+        std::cerr << "Empty input frame" << std::endl;
+        return false;
+    }
+
+    State<cv::Mat>& s = m_host;
+    const float w = historyWeight();
+
+    try {
+        // The first frame, a format change or a disabled filter restarts the history
+        if (!s.valid || w <= 0.0f || s.accumulator.size() != frame.size() ||
+            s.accumulator.channels() != frame.channels()) {
+            frame.convertTo(s.accumulator, CV_32F);
+            s.valid = true;
+            if (output.data != frame.data) {
+                frame.copyTo(output);
+            }
+            return true;
+        }
+
+        const bool use_reliability = !reliability.empty() && reliability.size() == frame.size();
+
+        if (!m_config.motion_gating && !use_reliability) {
+            // Plain exponential decay in a single pass
+            cv::accumulateWeighted(frame, s.accumulator, 1.0 - w);
+        } else {
+            frame.convertTo(s.frame_float, CV_32F);
+            cv::subtract(s.accumulator, s.frame_float, s.delta);
+
+            if (use_reliability) {
+                if (frame.channels() == 1) {
+                    reliability.convertTo(s.reliability, CV_32F);
+                } else {
+                    s.planes.assign(frame.channels(), reliability);
+                    cv::merge(s.planes, s.reliability);
+                }
+            }
+
+            if (m_config.motion_gating) {
+                // w * (1 - |delta| / threshold), clamped at 0
+                const float threshold = std::max(m_config.motion_threshold, 1.0f);
+                cv::absdiff(s.accumulator, s.frame_float, s.weight);
+                s.weight.convertTo(s.weight, CV_32F, -w / threshold, w);
+                cv::max(s.weight, 0.0, s.weight);
+                if (use_reliability) {
+                    cv::multiply(s.weight, s.reliability, s.weight);
+                }
+            } else {
+                s.reliability.convertTo(s.weight, CV_32F, w);
+            }
+
+            cv::multiply(s.delta, s.weight, s.delta);
+            cv::add(s.frame_float, s.delta, s.accumulator);
+        }
+
+        s.accumulator.convertTo(output, frame.depth());
+        return true;
+    } catch (const cv::Exception& e) {
+        std::cerr << "Error in temporal filter: " << e.what() << std::endl;
+        s.valid = false;
+        if (output.data != frame.data) {
+            frame.copyTo(output);
+        }
+        return false;
+    }
+}
+
+#ifdef WITH_CUDA
+bool TemporalFilter::process(const cv::cuda::GpuMat& frame, cv::cuda::GpuMat& output,
+                             const cv::cuda::GpuMat& reliability, cv::cuda::Stream& stream) {
+    if (frame.empty()) {
+        std::cerr << "Empty input frame" << std::endl;
+        return false;
+    }
+
+    State<cv::cuda::GpuMat>& s = m_device;
+    const float w = historyWeight();
+
+    try {
+        // The first frame, a format change or a disabled filter restarts the history
+        if (!s.valid || w <= 0.0f || s.accumulator.size() != frame.size() ||
+            s.accumulator.channels() != frame.channels()) {
+            frame.convertTo(s.accumulator, CV_32F, stream);
+            s.valid = true;
+            if (output.data != frame.data) {
+                frame.copyTo(output, stream);
+            }
+            return true;
+        }
+
+        const bool use_reliability = !reliability.empty() && reliability.size() == frame.size();
+
+        frame.convertTo(s.frame_float, CV_32F, stream);
+
+        if (!m_config.motion_gating && !use_reliability) {
+            // Plain exponential decay in a single pass
+            cv::cuda::addWeighted(s.accumulator, w, s.frame_float, 1.0 - w, 0.0, s.accumulator, -1, stream);
+        } else {
+            cv::cuda::subtract(s.accumulator, s.frame_float, s.delta, cv::noArray(), -1, stream);
+
+            if (use_reliability) {
+                if (frame.channels() == 1) {
+                    reliability.convertTo(s.reliability, CV_32F, stream);
+                } else {
+                    s.planes.assign(frame.channels(), reliability);
+                    cv::cuda::merge(s.planes, s.reliability, stream);
+                }
+            }
+
+            if (m_config.motion_gating) {
+                // w * (1 - |delta| / threshold), clamped at 0
+                const float threshold = std::max(m_config.motion_threshold, 1.0f);
+                cv::cuda::absdiff(s.accumulator, s.frame_float, s.weight, stream);
+                s.weight.convertTo(s.weight, CV_32F, -w / threshold, w, stream);
+                cv::cuda::max(s.weight, cv::Scalar::all(0.0), s.weight, stream);
+                if (use_reliability) {
+                    cv::cuda::multiply(s.weight, s.reliability, s.weight, 1.0, -1, stream);
+                }
+            } else {
+                s.reliability.convertTo(s.weight, CV_32F, w, 0.0, stream);
+            }
+
+            cv::cuda::multiply(s.delta, s.weight, s.delta, 1.0, -1, stream);
+            cv::cuda::add(s.frame_float, s.delta, s.accumulator, cv::noArray(), -1, stream);
+        }
+
+        s.accumulator.convertTo(output, frame.depth(), stream);
+        return true;
+    } catch (const cv::Exception& e) {
+        std::cerr << "Error in temporal filter (GPU): " << e.what() << std::endl;
+        s.valid = false;
+        if (output.data != frame.data) {
+            frame.copyTo(output, stream);
+        }
+        return false;
+    }
+}
+#endif
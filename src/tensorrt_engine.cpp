@@ -0,0 +1,345 @@
+#include "tensorrt_engine.h"
+
+#ifdef WITH_TENSORRT
+
+#include <NvInfer.h>
+#include <NvOnnxParser.h>
+#include <cuda_runtime_api.h>
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+class Logger : public nvinfer1::ILogger {
+public:
+    void log(Severity severity, const char* message) noexcept override {
+        if (severity <= Severity::kWARNING) {
+            std::cerr << "TensorRT: " << message << std::endl;
+        }
+    }
+};
+
+Logger& logger() {
+    static Logger instance;
+    return instance;
+}
+
+// FNV-1a over a byte range, chained through `hash`
+uint64_t fnv1a(const char* data, size_t size, uint64_t hash = 1469598103934665603ULL) {
+    for (size_t i = 0; i < size; i++) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+bool readFile(const std::string& path, std::vector<char>& data) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        return false;
+    }
+    data.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    return static_cast<bool>(file.read(data.data(), data.size()));
+}
+
+bool writeFile(const std::string& path, const void* data, size_t size) {
+    // Write then rename, so a crash mid-write never leaves a truncated cache entry
+    std::string temp = path + ".tmp";
+    {
+        std::ofstream file(temp, std::ios::binary);
+        if (!file.write(static_cast<const char*>(data), size)) {
+            return false;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(temp, path, ec);
+    return !ec;
+}
+
+size_t volume(const nvinfer1::Dims& dims) {
+    size_t count = 1;
+    for (int i = 0; i < dims.nbDims; i++) {
+        count *= static_cast<size_t>(std::max<int64_t>(0, dims.d[i]));
+    }
+    return count;
+}
+
+} // namespace
+
+TensorRTEngine::TensorRTEngine(const std::string& onnx_path, const std::string& cache_dir, bool fp16)
+    : m_onnx_path(onnx_path),
+      m_cache_dir(cache_dir),
+      m_fp16(fp16),
+      m_model_hash(0),
+      m_d_input(nullptr),
+      m_d_output(nullptr),
+      m_input_bytes(0),
+      m_output_bytes(0),
+      m_stream(nullptr) {
+}
+
+TensorRTEngine::~TensorRTEngine() {
+    m_context.reset();
+    m_engine.reset();
+    m_runtime.reset();
+    releaseBuffers();
+    if (m_stream) {
+        cudaStreamDestroy(static_cast<cudaStream_t>(m_stream));
+    }
+}
+
+bool TensorRTEngine::initialize() {
+    std::vector<char> model;
+    if (!readFile(m_onnx_path, model)) {
+        std::cerr << "TensorRT: cannot read " << m_onnx_path << std::endl;
+        return false;
+    }
+    m_model_hash = fnv1a(model.data(), model.size());
+
+    std::error_code ec;
+    std::filesystem::create_directories(m_cache_dir, ec);
+    if (ec) {
+        std::cerr << "TensorRT: cannot create engine cache " << m_cache_dir << ": " << ec.message() << std::endl;
+    }
+
+    cudaStream_t stream = nullptr;
+    if (cudaStreamCreate(&stream) != cudaSuccess) {
+        std::cerr << "TensorRT: failed to create a CUDA stream" << std::endl;
+        return false;
+    }
+    m_stream = stream;
+
+    m_runtime.reset(nvinfer1::createInferRuntime(logger()));
+    return m_runtime != nullptr;
+}
+
+std::string TensorRTEngine::deviceKey() {
+    int device = 0;
+    cudaGetDevice(&device);
+    cudaDeviceProp prop;
+    if (cudaGetDeviceProperties(&prop, device) != cudaSuccess) {
+        return "unknown";
+    }
+
+    std::string key = std::string(prop.name) + "-sm" + std::to_string(prop.major) + std::to_string(prop.minor);
+    for (char& c : key) {
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '-') {
+            c = '_';
+        }
+    }
+    return key;
+}
+
+std::string TensorRTEngine::engineCachePath(const std::vector<int>& shape) const {
+    std::ostringstream key;
+    key << std::hex << std::setw(16) << std::setfill('0') << m_model_hash << std::dec;
+    key << "-";
+    for (size_t i = 0; i < shape.size(); i++) {
+        key << (i ? "x" : "") << shape[i];
+    }
+    key << (m_fp16 ? "-fp16-" : "-fp32-") << deviceKey() << "-trt" << getInferLibVersion() << ".engine";
+
+    return (std::filesystem::path(m_cache_dir) /
+            (std::filesystem::path(m_onnx_path).stem().string() + "-" + key.str())).string();
+}
+
+std::string TensorRTEngine::timingCachePath() const {
+    return (std::filesystem::path(m_cache_dir) /
+            (deviceKey() + "-trt" + std::to_string(getInferLibVersion()) + ".timing")).string();
+}
+
+bool TensorRTEngine::buildEngine(const std::vector<int>& shape, std::vector<char>& plan) {
+    std::unique_ptr<nvinfer1::IBuilder> builder(nvinfer1::createInferBuilder(logger()));
+    if (!builder) {
+        return false;
+    }
+
+    const auto explicit_batch = 1U << static_cast<uint32_t>(nvinfer1::NetworkDefinitionCreationFlag::kEXPLICIT_BATCH);
+    std::unique_ptr<nvinfer1::INetworkDefinition> network(builder->createNetworkV2(explicit_batch));
+    std::unique_ptr<nvonnxparser::IParser> parser(nvonnxparser::createParser(*network, logger()));
+    if (!parser->parseFromFile(m_onnx_path.c_str(), static_cast<int>(nvinfer1::ILogger::Severity::kWARNING))) {
+        std::cerr << "TensorRT: failed to parse " << m_onnx_path << std::endl;
+        return false;
+    }
+
+    std::unique_ptr<nvinfer1::IBuilderConfig> config(builder->createBuilderConfig());
+    config->setMemoryPoolLimit(nvinfer1::MemoryPoolType::kWORKSPACE, 1ULL << 30);
+    if (m_fp16) {
+        if (builder->platformHasFastFp16()) {
+            config->setFlag(nvinfer1::BuilderFlag::kFP16);
+        } else {
+            std::cout << "TensorRT: GPU has no fast FP16, building an FP32 engine" << std::endl;
+        }
+    }
+
+    // Dynamic inputs get a profile pinned to the exact blob shape
+    nvinfer1::ITensor* input = network->getInput(0);
+    nvinfer1::Dims dims = input->getDimensions();
+    bool dynamic = false;
+    for (int i = 0; i < dims.nbDims; i++) {
+        dynamic = dynamic || dims.d[i] < 0;
+    }
+    if (dynamic) {
+        nvinfer1::Dims4 exact(shape[0], shape[1], shape[2], shape[3]);
+        nvinfer1::IOptimizationProfile* profile = builder->createOptimizationProfile();
+        profile->setDimensions(input->getName(), nvinfer1::OptProfileSelector::kMIN, exact);
+        profile->setDimensions(input->getName(), nvinfer1::OptProfileSelector::kOPT, exact);
+        profile->setDimensions(input->getName(), nvinfer1::OptProfileSelector::kMAX, exact);
+        config->addOptimizationProfile(profile);
+    }
+
+    // Reuse kernel timings measured by earlier builds on this GPU
+    std::vector<char> timing_data;
+    readFile(timingCachePath(), timing_data);
+    std::unique_ptr<nvinfer1::ITimingCache> timing(
+        config->createTimingCache(timing_data.data(), timing_data.size()));
+    if (timing) {
+        config->setTimingCache(*timing, false);
+    }
+
+    std::cout << "TensorRT: building " << (m_fp16 ? "FP16" : "FP32") << " engine for "
+              << shape[0] << "x" << shape[1] << "x" << shape[2] << "x" << shape[3]
+              << " (first run only)" << std::endl;
+    std::unique_ptr<nvinfer1::IHostMemory> serialized(builder->buildSerializedNetwork(*network, *config));
+    if (!serialized || serialized->size() == 0) {
+        std::cerr << "TensorRT: engine build failed" << std::endl;
+        return false;
+    }
+
+    plan.assign(static_cast<const char*>(serialized->data()),
+                static_cast<const char*>(serialized->data()) + serialized->size());
+
+    if (const nvinfer1::ITimingCache* updated = config->getTimingCache()) {
+        std::unique_ptr<nvinfer1::IHostMemory> timing_out(updated->serialize());
+        if (timing_out) {
+            writeFile(timingCachePath(), timing_out->data(), timing_out->size());
+        }
+    }
+    return true;
+}
+
+bool TensorRTEngine::loadEngine(const std::vector<int>& shape) {
+    m_context.reset();
+    m_engine.reset();
+    m_shape.clear();
+
+    const std::string cache_path = engineCachePath(shape);
+    std::vector<char> plan;
+    bool cached = readFile(cache_path, plan);
+    if (cached) {
+        m_engine.reset(m_runtime->deserializeCudaEngine(plan.data(), plan.size()));
+        if (!m_engine) {
+            // Stale or corrupt entry; rebuild it below
+            std::cerr << "TensorRT: discarding unusable cache entry " << cache_path << std::endl;
+            cached = false;
+        }
+    }
+
+    if (!cached) {
+        if (!buildEngine(shape, plan)) {
+            return false;
+        }
+        m_engine.reset(m_runtime->deserializeCudaEngine(plan.data(), plan.size()));
+        if (!m_engine) {
+            return false;
+        }
+        if (!writeFile(cache_path, plan.data(), plan.size())) {
+            std::cerr << "TensorRT: could not write engine cache " << cache_path << std::endl;
+        }
+    } else {
+        std::cout << "TensorRT: loaded cached engine " << cache_path << std::endl;
+    }
+
+    m_context.reset(m_engine->createExecutionContext());
+    if (!m_context) {
+        m_engine.reset();
+        return false;
+    }
+
+    m_input_name.clear();
+    m_output_name.clear();
+    for (int i = 0; i < m_engine->getNbIOTensors(); i++) {
+        const char* name = m_engine->getIOTensorName(i);
+        if (m_engine->getTensorIOMode(name) == nvinfer1::TensorIOMode::kINPUT) {
+            m_input_name = name;
+        } else if (m_output_name.empty()) {
+            m_output_name = name;
+        }
+    }
+
+    nvinfer1::Dims4 dims(shape[0], shape[1], shape[2], shape[3]);
+    if (m_input_name.empty() || m_output_name.empty() || !m_context->setInputShape(m_input_name.c_str(), dims)) {
+        std::cerr << "TensorRT: engine does not accept a " << shape[2] << "x" << shape[3] << " input" << std::endl;
+        m_context.reset();
+        m_engine.reset();
+        return false;
+    }
+
+    releaseBuffers();
+    m_input_bytes = volume(dims) * sizeof(float);
+    m_output_bytes = volume(m_context->getTensorShape(m_output_name.c_str())) * sizeof(float);
+    if (cudaMalloc(&m_d_input, m_input_bytes) != cudaSuccess ||
+        cudaMalloc(&m_d_output, m_output_bytes) != cudaSuccess) {
+        std::cerr << "TensorRT: out of device memory for I/O buffers" << std::endl;
+        releaseBuffers();
+        m_context.reset();
+        m_engine.reset();
+        return false;
+    }
+    m_context->setTensorAddress(m_input_name.c_str(), m_d_input);
+    m_context->setTensorAddress(m_output_name.c_str(), m_d_output);
+
+    m_shape = shape;
+    return true;
+}
+
+bool TensorRTEngine::forward(const cv::Mat& blob, cv::Mat& output) {
+    if (!m_runtime || blob.dims != 4 || blob.type() != CV_32F || !blob.isContinuous()) {
+        return false;
+    }
+
+    std::vector<int> shape = {blob.size[0], blob.size[1], blob.size[2], blob.size[3]};
+    if (shape != m_shape && !loadEngine(shape)) {
+        return false;
+    }
+
+    nvinfer1::Dims out_dims = m_context->getTensorShape(m_output_name.c_str());
+    if (out_dims.nbDims != 4) {
+        return false;
+    }
+    int out_shape[] = {static_cast<int>(out_dims.d[0]), static_cast<int>(out_dims.d[1]),
+                       static_cast<int>(out_dims.d[2]), static_cast<int>(out_dims.d[3])};
+    output.create(4, out_shape, CV_32F);
+
+    cudaStream_t stream = static_cast<cudaStream_t>(m_stream);
+    bool ok = cudaMemcpyAsync(m_d_input, blob.ptr(), m_input_bytes, cudaMemcpyHostToDevice, stream) == cudaSuccess &&
+              m_context->enqueueV3(stream) &&
+              cudaMemcpyAsync(output.ptr(), m_d_output, m_output_bytes, cudaMemcpyDeviceToHost, stream) == cudaSuccess &&
+              cudaStreamSynchronize(stream) == cudaSuccess;
+    if (!ok) {
+        std::cerr << "TensorRT: inference failed" << std::endl;
+    }
+    return ok;
+}
+
+void TensorRTEngine::releaseBuffers() {
+    if (m_d_input) {
+        cudaFree(m_d_input);
+        m_d_input = nullptr;
+    }
+    if (m_d_output) {
+        cudaFree(m_d_output);
+        m_d_output = nullptr;
+    }
+    m_input_bytes = 0;
+    m_output_bytes = 0;
+}
+
+#endif // WITH_TENSORRT
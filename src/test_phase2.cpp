@@ -18,6 +18,11 @@ void producer_thread(Camera& camera, FrameBuffer& buffer, Timer& timer) {
     int frame_count = 0;
     
     while (g_running) {
+        // Wait for the grab thread's next frame; the timeout rechecks g_running
+        if (!camera.waitForFrame(100)) {
+            continue;
+        }
+        
         // Measure frame acquisition time
         timer.start("acquisition");
         bool success = camera.getFrame(frame);
@@ -0,0 +1,324 @@
+#include "thread_placement.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#ifdef WITH_CUDA
+#include <opencv2/core/cuda.hpp>
+#endif
+
+namespace {
+
+#ifdef __linux__
+// From <linux/mempolicy.h>; set_mempolicy and mbind are called directly so
+// the build does not need libnuma
+constexpr int kMpolDefault = 0;
+constexpr int kMpolPreferred = 1;
+constexpr unsigned kMpolMfMove = 1u << 1;
+
+// Node mask with one node set; maxnode is the mask width in bits
+struct NodeMask {
+    static constexpr size_t WORDS = 16;     // 1024 nodes
+    unsigned long bits[WORDS] = {};
+    unsigned long maxnode = WORDS * sizeof(unsigned long) * 8;
+
+    explicit NodeMask(int node) {
+        const size_t per_word = sizeof(unsigned long) * 8;
+        if (node >= 0 && static_cast<size_t>(node) < WORDS * per_word) {
+            bits[node / per_word] |= 1ul << (node % per_word);
+        }
+    }
+};
+#endif
+
+std::string readFirstLine(const std::string& path) {
+    std::ifstream file(path);
+    std::string line;
+    std::getline(file, line);
+    return line;
+}
+
+} // namespace
+
+ThreadPlacement::ThreadPlacement()
+    : m_warned_affinity(false),
+      m_warned_realtime(false) {
+}
+
+ThreadPlacement& ThreadPlacement::instance() {
+    static ThreadPlacement placement;
+    return placement;
+}
+
+void ThreadPlacement::configure(const Config& config) {
+    Config resolved = config;
+    if (resolved.numa_node == GPU_NUMA_NODE) {
+        resolved.numa_node = deviceNumaNode(0);
+        if (resolved.numa_node < 0) {
+            std::cout << "GPU NUMA node unknown, frame memory is not placed" << std::endl;
+        }
+    }
+
+    std::vector<int> node_cpus;
+    if (resolved.numa_node >= 0) {
+        node_cpus = nodeCpus(resolved.numa_node);
+        if (node_cpus.empty()) {
+            std::cerr << "NUMA node " << resolved.numa_node << " not found, frame memory is not placed" << std::endl;
+            resolved.numa_node = -1;
+        } else {
+            std::cout << "Frame memory on NUMA node " << resolved.numa_node
+                      << " (CPUs " << formatCpuList(node_cpus) << ")" << std::endl;
+        }
+    }
+
+    for (Policy& policy : resolved.roles) {
+        policy.realtime_priority = std::min(std::max(policy.realtime_priority, 0), 99);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_config = resolved;
+    m_node_cpus = node_cpus;
+}
+
+ThreadPlacement::Config ThreadPlacement::getConfig() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_config;
+}
+
+int ThreadPlacement::numaNode() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_config.numa_node;
+}
+
+size_t ThreadPlacement::cpuCount(Role role, size_t fallback) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const std::vector<int>& cpus = m_config.roles[role].cpus;
+    return cpus.empty() ? fallback : cpus.size();
+}
+
+bool ThreadPlacement::apply(Role role) {
+    Policy policy;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        policy = m_config.roles[role];
+        // Roles without their own cores stay on the frame memory's node
+        if (policy.cpus.empty()) {
+            policy.cpus = m_node_cpus;
+        }
+    }
+    if (policy.cpus.empty() && policy.realtime_priority == 0) {
+        return true;
+    }
+
+#ifdef __linux__
+    bool ok = true;
+    if (!policy.cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : policy.cpus) {
+            if (cpu >= 0 && cpu < CPU_SETSIZE) {
+                CPU_SET(cpu, &set);
+            }
+        }
+        int result = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (result != 0) {
+            ok = false;
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_warned_affinity) {
+                std::cerr << "Failed to pin " << roleName(role) << " thread to CPUs "
+                          << formatCpuList(policy.cpus) << ": " << std::strerror(result) << std::endl;
+                m_warned_affinity = true;
+            }
+        }
+    }
+
+    if (policy.realtime_priority > 0) {
+        sched_param param{};
+        param.sched_priority = policy.realtime_priority;
+        int result = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (result != 0) {
+            ok = false;
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_warned_realtime) {
+                std::cerr << "Failed to set SCHED_FIFO priority " << policy.realtime_priority << " for the "
+                          << roleName(role) << " thread: " << std::strerror(result)
+                          << " (needs CAP_SYS_NICE or an rtprio limit)" << std::endl;
+                m_warned_realtime = true;
+            }
+        }
+    }
+
+    // Pool workers are many and identical; the pool reports its cores once
+    if (ok && role != POOL) {
+        std::cout << "Thread " << roleName(role) << ": CPUs " << formatCpuList(policy.cpus);
+        if (policy.realtime_priority > 0) {
+            std::cout << ", SCHED_FIFO " << policy.realtime_priority;
+        }
+        std::cout << std::endl;
+    }
+    return ok;
+#else
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_warned_affinity) {
+        std::cerr << "Thread placement is only supported on Linux" << std::endl;
+        m_warned_affinity = true;
+    }
+    return false;
+#endif
+}
+
+bool ThreadPlacement::bindMemory(void* data, size_t bytes) const {
+    const int node = numaNode();
+    if (node < 0 || !data || bytes == 0) {
+        return true;
+    }
+
+#ifdef __linux__
+    // mbind works on whole pages: shrink the range to the pages it covers fully
+    const uintptr_t page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    uintptr_t begin = (reinterpret_cast<uintptr_t>(data) + page - 1) & ~(page - 1);
+    uintptr_t end = (reinterpret_cast<uintptr_t>(data) + bytes) & ~(page - 1);
+    if (end <= begin) {
+        return true;
+    }
+
+    NodeMask mask(node);
+    long result = syscall(SYS_mbind, reinterpret_cast<void*>(begin), end - begin, kMpolPreferred,
+                          mask.bits, mask.maxnode, kMpolMfMove);
+    return result == 0;
+#else
+    return false;
+#endif
+}
+
+ThreadPlacement::MemoryScope::MemoryScope()
+    : m_active(false) {
+#ifdef __linux__
+    const int node = ThreadPlacement::instance().numaNode();
+    if (node >= 0) {
+        NodeMask mask(node);
+        m_active = syscall(SYS_set_mempolicy, kMpolPreferred, mask.bits, mask.maxnode) == 0;
+    }
+#endif
+}
+
+ThreadPlacement::MemoryScope::~MemoryScope() {
+#ifdef __linux__
+    if (m_active) {
+        syscall(SYS_set_mempolicy, kMpolDefault, nullptr, 0ul);
+    }
+#endif
+}
+
+bool ThreadPlacement::parseCpuList(const std::string& text, std::vector<int>& cpus) {
+    cpus.clear();
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (item.empty()) {
+            continue;
+        }
+        int first = 0;
+        int last = 0;
+        char dash = 0;
+        char extra = 0;
+        std::istringstream range(item);
+        if (!(range >> first)) {
+            return false;
+        }
+        if (range >> dash) {
+            if (dash != '-' || !(range >> last) || range >> extra) {
+                return false;
+            }
+        } else {
+            last = first;
+        }
+        if (first < 0 || last < first) {
+            return false;
+        }
+        for (int cpu = first; cpu <= last; cpu++) {
+            cpus.push_back(cpu);
+        }
+    }
+
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return !cpus.empty();
+}
+
+std::string ThreadPlacement::formatCpuList(const std::vector<int>& cpus) {
+    if (cpus.empty()) {
+        return "any";
+    }
+
+    std::ostringstream out;
+    size_t i = 0;
+    while (i < cpus.size()) {
+        size_t j = i;
+        while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) {
+            j++;
+        }
+        if (i > 0) {
+            out << ",";
+        }
+        out << cpus[i];
+        if (j > i) {
+            out << "-" << cpus[j];
+        }
+        i = j + 1;
+    }
+    return out.str();
+}
+
+int ThreadPlacement::deviceNumaNode(int device) {
+#ifdef WITH_CUDA
+    try {
+        if (device < 0 || device >= cv::cuda::getCudaEnabledDeviceCount()) {
+            return -1;
+        }
+        cv::cuda::DeviceInfo info(device);
+        char address[32];
+        std::snprintf(address, sizeof(address), "%04x:%02x:%02x.0",
+                      info.pciDomainID(), info.pciBusID(), info.pciDeviceID());
+
+        // sysfs reports -1 on single-node machines
+        std::string node = readFirstLine(std::string("/sys/bus/pci/devices/") + address + "/numa_node");
+        return node.empty() ? -1 : std::max(std::stoi(node), -1);
+    } catch (const std::exception& e) {
+        std::cerr << "Error finding the GPU's NUMA node: " << e.what() << std::endl;
+    }
+#else
+    (void)device;
+#endif
+    return -1;
+}
+
+std::vector<int> ThreadPlacement::nodeCpus(int node) {
+    std::vector<int> cpus;
+    if (node >= 0) {
+        parseCpuList(readFirstLine("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist"), cpus);
+    }
+    return cpus;
+}
+
+const char* ThreadPlacement::roleName(Role role) {
+    switch (role) {
+        case CAPTURE:    return "capture";
+        case PROCESSING: return "process";
+        case DISPLAY:    return "display";
+        case INFERENCE:  return "sr";
+        case POOL:       return "pool";
+        default:         return "unknown";
+    }
+}
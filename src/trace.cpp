@@ -0,0 +1,198 @@
+#include "trace.h"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+#ifdef WITH_NVTX
+#include <nvtx3/nvToolsExt.h>
+#endif
+
+namespace {
+
+struct Event {
+    const char* name = nullptr;
+    uint64_t frame = Trace::NO_FRAME;
+    Trace::Clock::time_point begin;
+    Trace::Clock::time_point end;
+};
+
+// One thread's spans. Only the owning thread writes; the count is published
+// with release so a dump sees every span below it filled in.
+struct Ring {
+    std::vector<Event> events;
+    std::atomic<uint64_t> written{0};
+    std::string thread_name;                    // Guarded by Registry::mutex
+    int tid = 0;
+};
+
+struct Registry {
+    std::mutex mutex;                           // Guards rings, names and settings
+    std::vector<std::unique_ptr<Ring>> rings;   // Kept after their thread exits
+    std::unordered_set<std::string> names;      // Interned span names (node addresses are stable)
+    size_t capacity = 65536;
+    bool started = false;
+    Trace::Clock::time_point epoch;
+};
+
+Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+thread_local Ring* t_ring = nullptr;
+thread_local uint64_t t_frame = Trace::NO_FRAME;
+thread_local std::string t_thread_name;
+
+Ring& localRing() {
+    if (!t_ring) {
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        auto ring = std::make_unique<Ring>();
+        ring->events.resize(reg.capacity);
+        ring->tid = static_cast<int>(reg.rings.size()) + 1;
+        ring->thread_name = t_thread_name.empty() ? "thread " + std::to_string(ring->tid) : t_thread_name;
+        t_ring = ring.get();
+        reg.rings.push_back(std::move(ring));
+    }
+    return *t_ring;
+}
+
+void writeJsonString(std::ostream& out, const std::string& text) {
+    out << '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            out << ' ';
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+} // namespace
+
+void Trace::start(size_t events_per_thread) {
+    Registry& reg = registry();
+    {
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        // Rings already created keep their size
+        reg.capacity = std::max<size_t>(events_per_thread, 1);
+        if (!reg.started) {
+            reg.epoch = Clock::now();
+            reg.started = true;
+        }
+    }
+    s_enabled.store(true, std::memory_order_relaxed);
+    std::cout << "Tracing enabled (" << events_per_thread << " spans per thread)" << std::endl;
+}
+
+void Trace::stop() {
+    s_enabled.store(false, std::memory_order_relaxed);
+}
+
+void Trace::setThreadName(const std::string& name) {
+    t_thread_name = name;
+    if (t_ring) {
+        std::lock_guard<std::mutex> lock(registry().mutex);
+        t_ring->thread_name = name;
+    }
+}
+
+void Trace::setFrame(uint64_t frame_id) {
+    t_frame = frame_id;
+}
+
+uint64_t Trace::currentFrame() {
+    return t_frame;
+}
+
+const char* Trace::intern(const std::string& name) {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    return reg.names.insert(name).first->c_str();
+}
+
+void Trace::record(const char* name, uint64_t frame_id, Clock::time_point begin, Clock::time_point end) {
+    Ring& ring = localRing();
+    const uint64_t index = ring.written.load(std::memory_order_relaxed);
+    Event& event = ring.events[index % ring.events.size()];
+    event.name = name;
+    event.frame = frame_id;
+    event.begin = begin;
+    event.end = end;
+    ring.written.store(index + 1, std::memory_order_release);
+}
+
+void Trace::pushRange(const char* name) {
+#ifdef WITH_NVTX
+    nvtxRangePushA(name);
+#else
+    (void)name;
+#endif
+}
+
+void Trace::popRange() {
+#ifdef WITH_NVTX
+    nvtxRangePop();
+#endif
+}
+
+bool Trace::dump(const std::string& path) {
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) {
+        std::cerr << "Failed to write trace: " << path << std::endl;
+        return false;
+    }
+
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+
+    // Chrome trace format: complete ("X") events in microseconds since start()
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    out << std::fixed << std::setprecision(3);
+    bool first = true;
+    size_t spans = 0;
+    for (const auto& ring : reg.rings) {
+        out << (first ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << ring->tid
+            << ",\"args\":{\"name\":";
+        writeJsonString(out, ring->thread_name);
+        out << "}}";
+        first = false;
+
+        const uint64_t written = ring->written.load(std::memory_order_acquire);
+        const uint64_t capacity = ring->events.size();
+        for (uint64_t i = written > capacity ? written - capacity : 0; i < written; i++) {
+            const Event& event = ring->events[i % capacity];
+            if (!event.name || event.begin < reg.epoch) {
+                continue;
+            }
+
+            double ts = std::chrono::duration<double, std::micro>(event.begin - reg.epoch).count();
+            double dur = std::chrono::duration<double, std::micro>(event.end - event.begin).count();
+            out << ",\n{\"name\":";
+            writeJsonString(out, event.name);
+            out << ",\"cat\":\"stage\",\"ph\":\"X\",\"pid\":1,\"tid\":" << ring->tid
+                << ",\"ts\":" << ts << ",\"dur\":" << dur;
+            if (event.frame != NO_FRAME) {
+                out << ",\"args\":{\"frame\":" << event.frame << "}";
+            }
+            out << "}";
+            spans++;
+        }
+    }
+    out << "\n]}\n";
+
+    if (!out) {
+        std::cerr << "Failed to write trace: " << path << std::endl;
+        return false;
+    }
+    std::cout << "Trace with " << spans << " spans written to " << path << std::endl;
+    return true;
+}
@@ -8,12 +8,50 @@
 #include <opencv2/cudaarithm.hpp>
 #include <opencv2/cudaimgproc.hpp>
 #include <opencv2/cudafilters.hpp>
+#include "gpu_utils.h"
 #endif
 
 #include "dnn_super_res.h"
 #include "temporal_consistency.h"
 #include "adaptive_sharpening.h"
 #include "selective_bilateral.h"
+#include "frame_arena.h"
+#include "frame_features.h"
+#include "fused_enhance.h"
+#include "yuv_frame.h"
+#include "trace.h"
+#include "task_pool.h"
+#include "duplicate_detector.h"
+
+namespace {
+Upscaler::Model g_default_sr_model{"models/FSRCNN_x4.pb", "fsrcnn", DnnSuperRes::FSRCNN, 4};
+Upscaler::Model g_default_esrgan_model{"models/RRDB_ESRGAN_x4.onnx", "esrgan", DnnSuperRes::REAL_ESRGAN, 4};
+
+// Closes the arena's frame and drops the frame's feature maps when the
+// outermost upscale() call returns; the host entry point runs the device
+// chain, which must not close it twice
+class ArenaFrameScope {
+public:
+    ArenaFrameScope(FrameArena& arena, FrameFeatures& features, bool& in_frame)
+        : m_arena(arena), m_features(features), m_in_frame(in_frame), m_outermost(!in_frame) {
+        m_in_frame = true;
+    }
+    
+    ~ArenaFrameScope() {
+        if (m_outermost) {
+            m_arena.endFrame();
+            m_features.invalidate();
+            m_in_frame = false;
+        }
+    }
+    
+private:
+    FrameArena& m_arena;
+    FrameFeatures& m_features;
+    bool& m_in_frame;
+    bool m_outermost;
+};
+}
 
 
 
@@ -29,15 +67,46 @@ class UpscalerImpl {
 public:
     virtual ~UpscalerImpl() = default;
     virtual bool upscale(const cv::Mat& input, cv::Mat& output) = 0;
+    
+#ifdef WITH_CUDA
+    // Device-resident upscale; implementations without a device path
+    // round-trip through their host implementation once
+    virtual bool upscale(const cv::cuda::GpuMat& input, cv::cuda::GpuMat& output,
+                         cv::cuda::Stream& stream) {
+        cv::Mat h_input, h_output;
+        input.download(h_input, stream);
+        stream.waitForCompletion();
+        if (!upscale(h_input, h_output)) {
+            return false;
+        }
+        output.upload(h_output, stream);
+        return true;
+    }
+#endif
+    
+    // I420 upscale; implementations whose enhancements need colour
+    // round-trip through BGR
+    virtual bool upscaleI420(const cv::Mat& input, cv::Mat& output) {
+        cv::Mat bgr, upscaled;
+        yuv::toBGR(input, bgr);
+        if (!upscale(bgr, upscaled)) {
+            return false;
+        }
+        yuv::fromBGR(upscaled, output);
+        return true;
+    }
 };
 
 // CPU implementation
 class CPUImpl : public UpscalerImpl {
 public:
-    CPUImpl(Upscaler::Algorithm algorithm, int target_width, int target_height)
+    CPUImpl(Upscaler::Algorithm algorithm, int target_width, int target_height,
+            std::shared_ptr<FrameArena> arena, std::shared_ptr<FrameFeatures> features)
         : m_algorithm(algorithm),
           m_target_width(target_width),
-          m_target_height(target_height) {
+          m_target_height(target_height),
+          m_arena(std::move(arena)),
+          m_features(std::move(features)) {
     }
     
     bool upscale(const cv::Mat& input, cv::Mat& output) override {
@@ -74,7 +143,7 @@ public:
         // For BICUBIC specifically, add enhanced anti-aliasing processing
         if (m_algorithm == Upscaler::BICUBIC) {
             // Step 1: Slight Gaussian blur before upscaling to prevent jagged edges
-            cv::Mat preProcessed;
+            cv::Mat& preProcessed = m_arena->host("upscale.pre_blur", input.size(), input.type());
             cv::GaussianBlur(input, preProcessed, cv::Size(3, 3), 0.5);
             
             // Step 2: Upscale with bicubic interpolation
@@ -95,62 +164,101 @@ public:
         return true;
     }
     
+    bool upscaleI420(const cv::Mat& input, cv::Mat& output) override {
+        // Bicubic anti-aliasing and the super-res colour boost work on BGR
+        if (m_algorithm == Upscaler::BICUBIC || m_algorithm == Upscaler::SUPER_RES) {
+            return UpscalerImpl::upscaleI420(input, output);
+        }
+        
+        int interpolation = cv::INTER_LANCZOS4;
+        if (m_algorithm == Upscaler::NEAREST) {
+            interpolation = cv::INTER_NEAREST;
+        } else if (m_algorithm == Upscaler::BILINEAR) {
+            interpolation = cv::INTER_LINEAR;
+        }
+        
+        // Chroma is interpolated at its own quarter resolution; NEAREST stays
+        // pixelated in every plane
+        const int chroma_interpolation =
+            m_algorithm == Upscaler::NEAREST ? cv::INTER_NEAREST : cv::INTER_LINEAR;
+        yuv::resize(input, output, cv::Size(m_target_width, m_target_height),
+                    interpolation, chroma_interpolation);
+        
+        // The detail kernel sums to one, so on luma alone it sharpens the
+        // same edges without touching the colour
+        if (m_algorithm != Upscaler::NEAREST) {
+            cv::Mat y, u, v;
+            yuv::planes(output, y, u, v);
+            enhanceDetails(y);
+        }
+        return true;
+    }
+    
     void enhanceBicubicResult(cv::Mat& image) {
         // Simplified approach focused on performance
         
+        FrameArena& arena = *m_arena;
+        
         // Step 1: Apply a fast bilateral filter only to smooth areas
-        cv::Mat blurred;
+        cv::Mat& blurred = arena.host("bicubic.blurred", image.size(), image.type());
         cv::bilateralFilter(image, blurred, 5, 30, 30);
         
-        // Step 2: Fast edge detection
-        cv::Mat gray, edges;
-        cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
-        cv::Canny(gray, edges, 50, 150);
+        // Step 2: Fast edge detection on the shared gray frame
+        const cv::Mat& edges = m_features->edgeMask(image, 50, 150);
         
         // Dilate edges slightly
-        cv::Mat edgeMask;
+        cv::Mat& edgeMask = arena.host("bicubic.edge_mask", image.size(), CV_8UC1);
         cv::dilate(edges, edgeMask, cv::getStructuringElement(cv::MORPH_RECT, cv::Size(2, 2)));
         
         // Create binary mask (255 for edges, 0 for non-edges)
         edgeMask.convertTo(edgeMask, CV_8U, 1.0/255.0);
         
-        // Step 3: Apply a simple sharpening only to edge areas (much faster than filter2D)
-        cv::Mat sharpened = image.clone();
-        for (int y = 1; y < image.rows-1; y++) {
-            for (int x = 1; x < image.cols-1; x++) {
-                if (edgeMask.at<uchar>(y, x) > 0) {
-                    // Simple 3x3 sharpening directly in the loop (faster than filter2D)
-                    for (int c = 0; c < 3; c++) {
-                        int val = 5 * image.at<cv::Vec3b>(y, x)[c] - 
-                                  image.at<cv::Vec3b>(y-1, x)[c] -
-                                  image.at<cv::Vec3b>(y+1, x)[c] -
-                                  image.at<cv::Vec3b>(y, x-1)[c] -
-                                  image.at<cv::Vec3b>(y, x+1)[c];
-                        sharpened.at<cv::Vec3b>(y, x)[c] = cv::saturate_cast<uchar>(val);
+        // Steps 3 and 4 in one tile-parallel pass: a 3x3 sharpen at interior
+        // edge pixels, the unfiltered pixel at border edges, blurred elsewhere.
+        // The sharpen reads neighbouring rows of the image, so rows are
+        // written to a separate frame and copied back afterwards.
+        cv::Mat& result = arena.host("bicubic.result", image.size(), image.type());
+        const int rows = image.rows;
+        const int cols = image.cols;
+        TaskPool::instance().parallelFor(0, rows, [&](int begin, int end) {
+            for (int y = begin; y < end; y++) {
+                const uchar* mask = edgeMask.ptr<uchar>(y);
+                const uchar* src = image.ptr<uchar>(y);
+                const uchar* smooth = blurred.ptr<uchar>(y);
+                uchar* dst = result.ptr<uchar>(y);
+                const bool interior_row = y > 0 && y < rows - 1;
+                const uchar* above = interior_row ? image.ptr<uchar>(y - 1) : src;
+                const uchar* below = interior_row ? image.ptr<uchar>(y + 1) : src;
+                
+                for (int x = 0; x < cols; x++) {
+                    const int i = x * 3;
+                    if (mask[x] == 0) {
+                        dst[i] = smooth[i];
+                        dst[i + 1] = smooth[i + 1];
+                        dst[i + 2] = smooth[i + 2];
+                    } else if (interior_row && x > 0 && x < cols - 1) {
+                        for (int c = i; c < i + 3; c++) {
+                            dst[c] = cv::saturate_cast<uchar>(
+                                5 * src[c] - above[c] - below[c] - src[c - 3] - src[c + 3]);
+                        }
+                    } else {
+                        dst[i] = src[i];
+                        dst[i + 1] = src[i + 1];
+                        dst[i + 2] = src[i + 2];
                     }
                 }
             }
-        }
-        
-        // Step 4: Blend results (no pixel-by-pixel processing)
-        // - Use sharpened version at edges
-        // - Use blurred version in non-edge areas
-        for (int y = 0; y < image.rows; y++) {
-            for (int x = 0; x < image.cols; x++) {
-                // If it's an edge pixel, use sharpened, otherwise use blurred
-                if (edgeMask.at<uchar>(y, x) > 0) {
-                    image.at<cv::Vec3b>(y, x) = sharpened.at<cv::Vec3b>(y, x);
-                } else {
-                    image.at<cv::Vec3b>(y, x) = blurred.at<cv::Vec3b>(y, x);
-                }
-            }
-        }
+        });
+        result.copyTo(image);
+        m_features->invalidate(image);
     }
     
 private:
     Upscaler::Algorithm m_algorithm;
     int m_target_width;
     int m_target_height;
+    std::shared_ptr<FrameArena> m_arena;
+    std::shared_ptr<FrameFeatures> m_features;
     
     // Enhanced multi-stage upscaling for SUPER_RES algorithm
     bool upscaleSuperRes(const cv::Mat& input, cv::Mat& output) {
@@ -239,13 +347,33 @@ private:
 };
 
 #ifdef WITH_CUDA
-// GPU implementation using CUDA
+// GPU implementation using CUDA; every step stays on the device
 class GPUImpl : public UpscalerImpl {
 public:
-    GPUImpl(Upscaler::Algorithm algorithm, int target_width, int target_height)
+    GPUImpl(Upscaler::Algorithm algorithm, int target_width, int target_height,
+            std::shared_ptr<FrameArena> arena)
         : m_algorithm(algorithm),
           m_target_width(target_width),
-          m_target_height(target_height) {
+          m_target_height(target_height),
+          m_arena(std::move(arena)) {
+        // Filters are created once; this throws if CUDA is unusable
+        m_pre_blur = cv::cuda::createGaussianFilter(CV_8UC1, CV_8UC1, cv::Size(3, 3), 0.5);
+        m_median = cv::cuda::createMedianFilter(CV_8UC1, 3);
+        m_edge_dilate = cv::cuda::createMorphologyFilter(cv::MORPH_DILATE, CV_8UC1,
+            cv::getStructuringElement(cv::MORPH_RECT, cv::Size(2, 2)));
+        
+        cv::Mat detail_kernel = (cv::Mat_<float>(3, 3) <<
+            -0.1, -0.1, -0.1,
+            -0.1,  1.8, -0.1,
+            -0.1, -0.1, -0.1);
+        m_detail_sharpen = cv::cuda::createLinearFilter(CV_8UC1, CV_8UC1, detail_kernel);
+        
+        // More refined sharpening kernel for the luminance channel
+        cv::Mat luma_kernel = (cv::Mat_<float>(3, 3) <<
+            -0.5f, -0.5f, -0.5f,
+            -0.5f,  5.0f, -0.5f,
+            -0.5f, -0.5f, -0.5f);
+        m_luma_sharpen = cv::cuda::createLinearFilter(CV_8UC1, CV_8UC1, luma_kernel);
     }
     
     bool upscale(const cv::Mat& input, cv::Mat& output) override {
@@ -253,43 +381,46 @@ public:
             return false;
         }
         
+        // One upload, one download
+        m_d_input.upload(input, m_stream);
+        if (!upscale(m_d_input, m_d_output, m_stream)) {
+            return false;
+        }
+        gpu_utils::ensurePageLocked(output, m_d_output.size(), m_d_output.type());
+        m_d_output.download(output, m_stream);
+        m_stream.waitForCompletion();
+        
+        return true;
+    }
+    
+    bool upscale(const cv::cuda::GpuMat& input, cv::cuda::GpuMat& output,
+                 cv::cuda::Stream& stream) override {
+        if (input.empty()) {
+            return false;
+        }
+        
         // For super-res algorithm, use multi-stage processing with CUDA
         if (m_algorithm == Upscaler::SUPER_RES) {
-            return upscaleSuperRes(input, output);
+            return upscaleSuperRes(input, output, stream);
         }
         
+        cv::Size target_size(m_target_width, m_target_height);
+        
         // For BICUBIC, apply specialized processing pipeline
         if (m_algorithm == Upscaler::BICUBIC) {
             // Step 1: Slight Gaussian blur before upscaling
-            cv::cuda::GpuMat d_input, d_blurred;
-            d_input.upload(input);
-            
-            // Apply gaussian blur using CUDA
-            cv::Ptr<cv::cuda::Filter> gaussianFilter = cv::cuda::createGaussianFilter(
-                d_input.type(), d_input.type(), cv::Size(3, 3), 0.5);
-            gaussianFilter->apply(d_input, d_blurred);
+            cv::cuda::GpuMat blurred;
+            gpu_utils::applyPerChannel(m_pre_blur, input, blurred, stream);
             
             // Step 2: Upscale with bicubic (CUDA uses CUBIC instead of Lanczos)
-            cv::cuda::GpuMat d_output;
-            cv::cuda::resize(d_blurred, d_output, cv::Size(m_target_width, m_target_height), 
-                             0, 0, cv::INTER_CUBIC);
-            
-            // Download for post-processing
-            d_output.download(output);
+            cv::cuda::resize(blurred, output, target_size, 0, 0, cv::INTER_CUBIC, stream);
             
             // Step 3: Apply specialized bicubic enhancement
-            enhanceBicubicResult(output);
+            enhanceBicubicResult(output, stream);
             
             return true;
         }
         
-        // Standard processing for other algorithms
-        cv::cuda::GpuMat d_input;
-        d_input.upload(input);
-        
-        // GPU Mat for output
-        cv::cuda::GpuMat d_output;
-        
         // Use standard resize with appropriate interpolation
         int interpolation = cv::INTER_LINEAR; // Default
         
@@ -308,129 +439,118 @@ public:
                 break;
         }
         
-        cv::cuda::resize(d_input, d_output, cv::Size(m_target_width, m_target_height), 0, 0, interpolation);
+        cv::cuda::resize(input, output, target_size, 0, 0, interpolation, stream);
         
         // Apply post-processing for better quality (except for NEAREST)
         if (m_algorithm != Upscaler::NEAREST) {
-            // Download for post-processing
-            d_output.download(output);
-            enhanceDetails(output);
-        } else {
-            // Just download the result without enhancement
-            d_output.download(output);
+            enhanceDetails(output, stream);
         }
         
         return true;
     }
 
-    void enhanceBicubicResult(cv::Mat& image) {
-        // Ultra-optimized approach for real-time performance
+    void enhanceBicubicResult(cv::cuda::GpuMat& image, cv::cuda::Stream& stream) {
+        FrameArena& arena = *m_arena;
         
-        // Fast adaptive blur that preserves edges - much faster than bilateral filter
-        // and works better for removing pixelation
-        cv::Mat blurred;
-        cv::medianBlur(image, blurred, 3);  // Remove pixelation artifacts while preserving edges
+        // Median blur removes pixelation artifacts while preserving edges
+        cv::cuda::GpuMat& blurred = arena.device("bicubic.blurred", image.size(), image.type());
+        gpu_utils::applyPerChannel(m_median, image, blurred, stream);
         
         // Detect just the significant edges that should remain sharp
-        cv::Mat gray;
-        cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
+        cv::cuda::GpuMat& gray = arena.device("bicubic.gray", image.size(), CV_8UC1);
+        cv::cuda::cvtColor(image, gray, cv::COLOR_BGR2GRAY, 0, stream);
         
-        // Use a faster method to detect edges
-        cv::Mat edges(gray.size(), CV_8U, cv::Scalar(0));
         const int threshold = 30; // Adjust based on your content
-        
-        // Process only every other pixel for speed (we'll process the full image in the final blend)
-        for (int y = 1; y < gray.rows-1; y += 2) {
-            for (int x = 1; x < gray.cols-1; x += 2) {
-                // Fast edge detection using horizontal and vertical differences
-                int diff_h = std::abs(gray.at<uchar>(y, x+1) - gray.at<uchar>(y, x-1));
-                int diff_v = std::abs(gray.at<uchar>(y+1, x) - gray.at<uchar>(y-1, x));
-                
-                if (diff_h > threshold || diff_v > threshold) {
-                    edges.at<uchar>(y, x) = 255;
-                }
-            }
+        const int w = gray.cols;
+        const int h = gray.rows;
+        if (w < 3 || h < 3) {
+            return;
         }
         
+        // Horizontal and vertical central differences, evaluated for every
+        // pixel since the device handles the full frame in one pass
+        cv::cuda::GpuMat& diff_h = arena.device("bicubic.diff_h", gray.size(), CV_8UC1);
+        cv::cuda::GpuMat& diff_v = arena.device("bicubic.diff_v", gray.size(), CV_8UC1);
+        diff_h.setTo(cv::Scalar(0), stream);
+        diff_v.setTo(cv::Scalar(0), stream);
+        
+        cv::cuda::GpuMat diff_h_inner = diff_h(cv::Rect(1, 0, w - 2, h));
+        cv::cuda::GpuMat diff_v_inner = diff_v(cv::Rect(0, 1, w, h - 2));
+        cv::cuda::absdiff(gray(cv::Rect(2, 0, w - 2, h)), gray(cv::Rect(0, 0, w - 2, h)), diff_h_inner, stream);
+        cv::cuda::absdiff(gray(cv::Rect(0, 2, w, h - 2)), gray(cv::Rect(0, 0, w, h - 2)), diff_v_inner, stream);
+        
+        cv::cuda::GpuMat& edges = arena.device("bicubic.edges", gray.size(), CV_8UC1);
+        cv::cuda::GpuMat& dilated = arena.device("bicubic.dilated", gray.size(), CV_8UC1);
+        cv::cuda::GpuMat& smooth_areas = arena.device("bicubic.smooth_areas", gray.size(), CV_8UC1);
+        cv::cuda::max(diff_h, diff_v, edges, stream);
+        cv::cuda::threshold(edges, edges, threshold, 255, cv::THRESH_BINARY, stream);
+        
         // Small dilation to connect edges
-        cv::dilate(edges, edges, cv::getStructuringElement(cv::MORPH_RECT, cv::Size(2, 2)));
-        
-        // Simple blending of original and blurred based on edges
-        // This is the most critical step for fixing pixelation
-        for (int y = 0; y < image.rows; y++) {
-            const uchar* edge_row = edges.ptr<uchar>(y);
-            cv::Vec3b* img_row = image.ptr<cv::Vec3b>(y);
-            cv::Vec3b* blur_row = blurred.ptr<cv::Vec3b>(y);
-            
-            for (int x = 0; x < image.cols; x++) {
-                // If it's an edge pixel, keep original, otherwise use blurred to fix pixelation
-                if (edge_row[x] > 0) {
-                    // Keep original edges sharp (no change needed)
-                } else {
-                    // For non-edge areas, use blurred version to remove pixelation
-                    img_row[x] = blur_row[x];
-                }
-            }
-        }
+        m_edge_dilate->apply(edges, dilated, stream);
+        
+        // Keep original edges sharp, use the blurred version elsewhere
+        cv::cuda::bitwise_not(dilated, smooth_areas, cv::noArray(), stream);
+        blurred.copyTo(image, smooth_areas, stream);
     }
     
-    
 private:
     Upscaler::Algorithm m_algorithm;
     int m_target_width;
     int m_target_height;
+    std::shared_ptr<FrameArena> m_arena;
+    
+    // Stream and buffers for the host entry point
+    cv::cuda::Stream m_stream;
+    cv::cuda::GpuMat m_d_input;
+    cv::cuda::GpuMat m_d_output;
+    
+    // Filters created once in the constructor
+    cv::Ptr<cv::cuda::Filter> m_pre_blur;
+    cv::Ptr<cv::cuda::Filter> m_median;
+    cv::Ptr<cv::cuda::Filter> m_edge_dilate;
+    cv::Ptr<cv::cuda::Filter> m_detail_sharpen;
+    cv::Ptr<cv::cuda::Filter> m_luma_sharpen;
     
     // CUDA-accelerated multi-stage upscaling
-    bool upscaleSuperRes(const cv::Mat& input, cv::Mat& output) {
+    bool upscaleSuperRes(const cv::cuda::GpuMat& input, cv::cuda::GpuMat& output,
+                         cv::cuda::Stream& stream) {
+        cv::Size target_size(m_target_width, m_target_height);
+        
         try {
             // Step 1: Convert to YCrCb for better processing
-            cv::Mat ycrcb;
-            cv::cvtColor(input, ycrcb, cv::COLOR_BGR2YCrCb);
-            std::vector<cv::Mat> channels;
-            cv::split(ycrcb, channels);
-            
-            // Step 2: For filtering, we'll do it on CPU since your CUDA build may not have bilateral filter
-            cv::Mat y_filtered;
-            cv::bilateralFilter(channels[0], y_filtered, 5, 50, 50);
-            
-            // Step 3: Upload filtered Y channel to GPU
-            cv::cuda::GpuMat d_y_filtered, d_y_upscaled;
-            d_y_filtered.upload(y_filtered);
-            
-            // Step 4: Upscale Y channel with CUBIC instead of LANCZOS4 which isn't supported by your CUDA build
-            cv::cuda::resize(d_y_filtered, d_y_upscaled, cv::Size(m_target_width, m_target_height), 0, 0, cv::INTER_CUBIC);
-            
-            // Step 5: Upscale chroma channels (bilinear is fine for chroma)
-            cv::cuda::GpuMat d_cr, d_cb, d_cr_upscaled, d_cb_upscaled;
-            d_cr.upload(channels[1]);
-            d_cb.upload(channels[2]);
-            cv::cuda::resize(d_cr, d_cr_upscaled, cv::Size(m_target_width, m_target_height), 0, 0, cv::INTER_LINEAR);
-            cv::cuda::resize(d_cb, d_cb_upscaled, cv::Size(m_target_width, m_target_height), 0, 0, cv::INTER_LINEAR);
-            
-            // Step 6: Download channels from GPU
-            cv::Mat y_upscaled, cr_upscaled, cb_upscaled;
-            d_y_upscaled.download(y_upscaled);
-            d_cr_upscaled.download(cr_upscaled);
-            d_cb_upscaled.download(cb_upscaled);
-            
-            // Step 7: Enhance details in Y channel (add a bit more sharpening to compensate for not using Lanczos)
-            cv::Mat y_enhanced;
-            enhanceDetailsY(y_upscaled, y_enhanced);
-            
-            // Step 8: Merge channels
-            std::vector<cv::Mat> upscaled_channels = {y_enhanced, cr_upscaled, cb_upscaled};
-            cv::Mat merged;
-            cv::merge(upscaled_channels, merged);
-            
-            // Step 9: Convert back to BGR
-            cv::cvtColor(merged, output, cv::COLOR_YCrCb2BGR);
+            cv::cuda::GpuMat ycrcb;
+            cv::cuda::cvtColor(input, ycrcb, cv::COLOR_BGR2YCrCb, 0, stream);
+            std::vector<cv::cuda::GpuMat> channels;
+            cv::cuda::split(ycrcb, channels, stream);
+            
+            // Step 2: Reduce noise in the Y channel while preserving edges
+            cv::cuda::GpuMat y_filtered;
+            cv::cuda::bilateralFilter(channels[0], y_filtered, 5, 50, 50, cv::BORDER_DEFAULT, stream);
+            
+            // Step 3: Upscale Y channel with CUBIC (CUDA has no LANCZOS4)
+            cv::cuda::GpuMat y_upscaled;
+            cv::cuda::resize(y_filtered, y_upscaled, target_size, 0, 0, cv::INTER_CUBIC, stream);
+            
+            // Step 4: Upscale chroma channels (bilinear is fine for chroma)
+            cv::cuda::GpuMat cr_upscaled, cb_upscaled;
+            cv::cuda::resize(channels[1], cr_upscaled, target_size, 0, 0, cv::INTER_LINEAR, stream);
+            cv::cuda::resize(channels[2], cb_upscaled, target_size, 0, 0, cv::INTER_LINEAR, stream);
+            
+            // Step 5: Enhance details in Y channel (a bit more sharpening to compensate for not using Lanczos)
+            cv::cuda::GpuMat y_enhanced;
+            enhanceDetailsY(y_upscaled, y_enhanced, stream);
+            
+            // Step 6: Merge channels and convert back to BGR
+            std::vector<cv::cuda::GpuMat> upscaled_channels = {y_enhanced, cr_upscaled, cb_upscaled};
+            cv::cuda::GpuMat merged;
+            cv::cuda::merge(upscaled_channels, merged, stream);
+            cv::cuda::cvtColor(merged, output, cv::COLOR_YCrCb2BGR, 0, stream);
             
             // Extra step: Reduce noise in dark areas
-            reduceDarkAreaNoise(output);
-
+            reduceDarkAreaNoise(output, stream);
             
-            // Step 10: Final color enhancement
-            enhanceColors(output);
+            // Step 7: Final color enhancement
+            enhanceColors(output, stream);
             
             return true;
         }
@@ -438,112 +558,81 @@ private:
             std::cerr << "CUDA error in super resolution: " << e.what() << std::endl;
             
             // Fallback to standard CUBIC resize (not Lanczos)
-            cv::cuda::GpuMat d_input, d_output;
-            d_input.upload(input);
             try {
-                cv::cuda::resize(d_input, d_output, cv::Size(m_target_width, m_target_height), 0, 0, cv::INTER_CUBIC);
-                d_output.download(output);
-                
-                // Still apply some enhancement
-                enhanceDetails(output);
+                cv::cuda::resize(input, output, target_size, 0, 0, cv::INTER_CUBIC, stream);
+                enhanceDetails(output, stream);
+                return true;
             }
             catch (const cv::Exception& e2) {
-                std::cerr << "CUDA resize failed again: " << e2.what() << ", falling back to CPU" << std::endl;
-                
-                // Ultimate fallback to CPU
-                cv::resize(input, output, cv::Size(m_target_width, m_target_height), 0, 0, cv::INTER_CUBIC);
-                enhanceDetails(output);
+                std::cerr << "CUDA resize failed again: " << e2.what() << std::endl;
+                return false;
             }
-            
-            return true;
         }
     }
     
     // Enhance details in BGR image
-    void enhanceDetails(cv::Mat& image) {
+    void enhanceDetails(cv::cuda::GpuMat& image, cv::cuda::Stream& stream) {
         // Apply a subtle sharpening filter
-        cv::Mat kernel = (cv::Mat_<float>(3, 3) <<
-            -0.1, -0.1, -0.1,
-            -0.1,  1.8, -0.1,
-            -0.1, -0.1, -0.1);
-            
-        cv::filter2D(image, image, -1, kernel);
+        gpu_utils::applyPerChannel(m_detail_sharpen, image, image, stream);
     }
     
     // Enhance details in Y channel (more aggressive since it's just luminance)
-    void enhanceDetailsY(const cv::Mat& input, cv::Mat& output) {
-        // Create a more refined sharpening kernel for the luminance channel
-        float kernel_data[] = {
-            -0.5f, -0.5f, -0.5f,
-            -0.5f,  5.0f, -0.5f,
-            -0.5f, -0.5f, -0.5f
-        };
-        cv::Mat kernel = cv::Mat(3, 3, CV_32F, kernel_data);
-                    
-        // Apply filter
-        cv::filter2D(input, output, -1, kernel);
+    void enhanceDetailsY(const cv::cuda::GpuMat& input, cv::cuda::GpuMat& output,
+                         cv::cuda::Stream& stream) {
+        cv::cuda::GpuMat sharpened;
+        m_luma_sharpen->apply(input, sharpened, stream);
         
         // Blend with original for a more natural look
-        cv::addWeighted(input, 0.3, output, 0.7, 0, output);
+        cv::cuda::addWeighted(input, 0.3, sharpened, 0.7, 0, output, -1, stream);
     }
 
-    void reduceDarkAreaNoise(cv::Mat& image) {
+    void reduceDarkAreaNoise(cv::cuda::GpuMat& image, cv::cuda::Stream& stream) {
         // Convert to YCrCb for better luminance isolation
-        cv::Mat ycrcb;
-        cv::cvtColor(image, ycrcb, cv::COLOR_BGR2YCrCb);
+        cv::cuda::GpuMat ycrcb;
+        cv::cuda::cvtColor(image, ycrcb, cv::COLOR_BGR2YCrCb, 0, stream);
         
-        // Split channels
-        std::vector<cv::Mat> channels;
-        cv::split(ycrcb, channels);
+        std::vector<cv::cuda::GpuMat> channels;
+        cv::cuda::split(ycrcb, channels, stream);
         
         // Create a mask for dark areas
-        cv::Mat darkMask;
-        cv::threshold(channels[0], darkMask, 60, 1.0, cv::THRESH_BINARY_INV);
+        cv::cuda::GpuMat dark_mask;
+        cv::cuda::threshold(channels[0], dark_mask, 60, 255, cv::THRESH_BINARY_INV, stream);
         
         // Apply stronger bilateral filter only to dark areas
-        cv::Mat filtered;
-        cv::bilateralFilter(channels[0], filtered, 5, 30, 30);
-        
-        // Blend original and filtered based on mask
-        channels[0] = channels[0].mul(1.0 - darkMask) + filtered.mul(darkMask);
+        cv::cuda::GpuMat filtered;
+        cv::cuda::bilateralFilter(channels[0], filtered, 5, 30, 30, cv::BORDER_DEFAULT, stream);
+        filtered.copyTo(channels[0], dark_mask, stream);
         
-        // Merge channels
-        cv::merge(channels, ycrcb);
-        
-        // Convert back to BGR
-        cv::cvtColor(ycrcb, image, cv::COLOR_YCrCb2BGR);
+        cv::cuda::merge(channels, ycrcb, stream);
+        cv::cuda::cvtColor(ycrcb, image, cv::COLOR_YCrCb2BGR, 0, stream);
     }
     
     // Enhance colors for more vibrant output (YouTube-like)
-    void enhanceColors(cv::Mat& image) {
+    void enhanceColors(cv::cuda::GpuMat& image, cv::cuda::Stream& stream) {
         // Convert to Lab color space for better color manipulation
-        cv::Mat lab;
-        cv::cvtColor(image, lab, cv::COLOR_BGR2Lab);
+        cv::cuda::GpuMat lab;
+        cv::cuda::cvtColor(image, lab, cv::COLOR_BGR2Lab, 0, stream);
         
-        // Split into channels
-        std::vector<cv::Mat> channels;
-        cv::split(lab, channels);
+        std::vector<cv::cuda::GpuMat> channels;
+        cv::cuda::split(lab, channels, stream);
         
         // More subtle color enhancement (reduce from 1.1 to 1.05)
-        channels[1] = channels[1] * 1.05; // Slightly increase 'a' (controls green-red)
-        channels[2] = channels[2] * 1.05; // Slightly increase 'b' (controls blue-yellow)
-        
-        // Merge channels
-        cv::merge(channels, lab);
+        channels[1].convertTo(channels[1], -1, 1.05, 0, stream); // Slightly increase 'a' (controls green-red)
+        channels[2].convertTo(channels[2], -1, 1.05, 0, stream); // Slightly increase 'b' (controls blue-yellow)
         
-        // Convert back to BGR
-        cv::cvtColor(lab, image, cv::COLOR_Lab2BGR);
+        cv::cuda::merge(channels, lab, stream);
+        cv::cuda::cvtColor(lab, image, cv::COLOR_Lab2BGR, 0, stream);
         
         // Slightly increase contrast but less aggressively
-        image.convertTo(image, -1, 1.03, 0);
+        image.convertTo(image, -1, 1.03, 0, stream);
         
         // Add a very subtle brightness boost
-        cv::Mat brightened;
-        image.convertTo(brightened, -1, 1.0, 3);  // Add a small constant value
+        cv::cuda::GpuMat brightened;
+        image.convertTo(brightened, -1, 1.0, 3, stream);  // Add a small constant value
         
         // Blend the original with brightened for more natural look
         double alpha = 0.7; // Blend factor - 70% original, 30% brightened
-        cv::addWeighted(image, alpha, brightened, 1-alpha, 0, image);
+        cv::cuda::addWeighted(image, alpha, brightened, 1-alpha, 0, image, -1, stream);
     }
 };
 #endif
@@ -555,7 +644,13 @@ Upscaler::Upscaler(Algorithm algorithm, bool use_gpu)
       m_initialized(false),
       m_target_width(0),
       m_target_height(0),
-      m_impl(nullptr) {
+      m_sr_model(g_default_sr_model),
+      m_esrgan_model(g_default_esrgan_model),
+      m_impl(nullptr),
+      m_arena(std::make_shared<FrameArena>()),
+      m_features(std::make_shared<FrameFeatures>()),
+      m_in_frame(false),
+      m_use_fused_enhancement(true) {
     
     // Adjust if GPU requested but not available
     if (m_use_gpu && !isGPUAvailable()) {
@@ -564,6 +659,29 @@ Upscaler::Upscaler(Algorithm algorithm, bool use_gpu)
     }
 }
 
+#ifdef WITH_CUDA
+// Two frames in flight for upscaleOverlapped(). Uploads and downloads run on
+// their own streams; device work stays in order on the chain's stream, so
+// the chain's shared buffers are never used by two frames at once.
+struct Upscaler::OverlapState {
+    struct Slot {
+        cv::cuda::GpuMat d_input;
+        cv::cuda::GpuMat d_output;
+        cv::Mat h_output;               // Page-locked download target
+        cv::cuda::Event uploaded;
+        cv::cuda::Event computed;
+        cv::cuda::Event downloaded;
+        bool pending = false;           // Submitted and not yet collected
+        bool success = false;
+    };
+    
+    cv::cuda::Stream upload_stream;
+    cv::cuda::Stream download_stream;
+    Slot slots[2];
+    int next = 0;
+};
+#endif
+
 Upscaler::~Upscaler() = default;
 
 bool Upscaler::initialize(int target_width, int target_height) {
@@ -579,11 +697,18 @@ bool Upscaler::initialize(int target_width, int target_height) {
     m_impl.reset();
     m_dnn_sr.reset();
     
+#ifdef WITH_CUDA
+    initializeStream();
+#endif
+    
     // Reset enhancement modules
     m_bilateral_pre.reset();
     m_sharpening.reset();
     m_bilateral_post.reset();
     m_temporal_consistency.reset();
+#ifdef WITH_FUSED_KERNELS
+    m_fused.reset();
+#endif
     
     // Initialize common flags
     m_use_selective_bilateral = true;
@@ -592,32 +717,15 @@ bool Upscaler::initialize(int target_width, int target_height) {
     
     if (m_algorithm == SUPER_RES || m_algorithm == REAL_ESRGAN) {
         try {
-            // For REAL_ESRGAN, use REAL_ESRGAN model type
-            DnnSuperRes::ModelType model_type = (m_algorithm == REAL_ESRGAN) ? 
-                                              DnnSuperRes::REAL_ESRGAN : 
-                                              DnnSuperRes::FSRCNN;
-                                               
-            // Select appropriate model based on algorithm
-            std::string model_path;
-            std::string model_name;
-            
-            if (m_algorithm == REAL_ESRGAN) {
-                model_path = "models/RRDB_ESRGAN_x4.onnx";
-                model_name = "esrgan";
-            } else {
-                // Default FSRCNN model
-                model_path = "models/FSRCNN_x4.pb";
-                model_name = "fsrcnn";
-            }
-            
             // Create and initialize super-resolution model
-            m_dnn_sr = std::make_unique<DnnSuperRes>(model_path, model_name, 4, model_type);
+            const Model& model = getModel(m_algorithm);
+            m_dnn_sr = std::make_unique<DnnSuperRes>(model.path, model.name, model.scale, model.type);
             m_dnn_sr->setTargetSize(m_target_width, m_target_height);
             m_dnn_sr->setUseGPU(m_use_gpu);
             
             if (m_dnn_sr->initialize()) {
                 std::cout << "Using " << (m_algorithm == REAL_ESRGAN ? "RealESRGAN" : "DNN Super Resolution") 
-                          << " for upscaling" << std::endl;
+                          << " (" << model.path << ") for upscaling" << std::endl;
                 m_initialized = true;
                 
                 // Initialize enhancement modules when using RealESRGAN
@@ -643,7 +751,7 @@ bool Upscaler::initialize(int target_width, int target_height) {
 #ifdef WITH_CUDA
     if (m_use_gpu) {
         try {
-            m_impl = std::make_unique<GPUImpl>(m_algorithm, m_target_width, m_target_height);
+            m_impl = std::make_unique<GPUImpl>(m_algorithm, m_target_width, m_target_height, m_arena);
             std::cout << "Using GPU-accelerated upscaling with " << getAlgorithmName() << std::endl;
         } catch (const std::exception& e) {
             std::cerr << "Failed to initialize GPU implementation: " << e.what() << std::endl;
@@ -654,7 +762,7 @@ bool Upscaler::initialize(int target_width, int target_height) {
     
     // Create CPU implementation if GPU is not being used
     if (!m_impl) {
-        m_impl = std::make_unique<CPUImpl>(m_algorithm, m_target_width, m_target_height);
+        m_impl = std::make_unique<CPUImpl>(m_algorithm, m_target_width, m_target_height, m_arena, m_features);
         std::cout << "Using CPU upscaling with " << getAlgorithmName() << std::endl;
     }
     
@@ -681,6 +789,8 @@ bool Upscaler::initializeEnhancements() {
             3                                   // Number of scales
         });
     
+    m_bilateral_pre->setArena(m_arena);
+    m_bilateral_pre->setFeatures(m_features);
     if (!m_bilateral_pre->initialize()) {
         std::cerr << "Warning: Failed to initialize bilateral pre-processor" << std::endl;
         m_bilateral_pre.reset();
@@ -701,6 +811,8 @@ bool Upscaler::initializeEnhancements() {
             true                                // Use adaptive sigma
         });
     
+    m_sharpening->setArena(m_arena);
+    m_sharpening->setFeatures(m_features);
     if (!m_sharpening->initialize()) {
         std::cerr << "Warning: Failed to initialize adaptive sharpening" << std::endl;
         m_sharpening.reset();
@@ -724,6 +836,8 @@ bool Upscaler::initializeEnhancements() {
             2                                   // Number of scales (fewer for post)
         });
     
+    m_bilateral_post->setArena(m_arena);
+    m_bilateral_post->setFeatures(m_features);
     if (!m_bilateral_post->initialize()) {
         std::cerr << "Warning: Failed to initialize bilateral post-processor" << std::endl;
         m_bilateral_post.reset();
@@ -747,33 +861,120 @@ bool Upscaler::initializeEnhancements() {
             0                                   // Flags
         });
     
+    m_temporal_consistency->setFeatures(m_features);
     if (!m_temporal_consistency->initialize()) {
         std::cerr << "Warning: Failed to initialize temporal consistency" << std::endl;
         m_temporal_consistency.reset();
         return false;
     }
     
+#ifdef WITH_FUSED_KERNELS
+    if (m_use_gpu) {
+        m_fused = std::make_unique<FusedEnhancer>(m_sharpening->getConfig(), m_bilateral_post->getConfig());
+        std::cout << "Fused CUDA kernel enabled for sharpening and post-filtering" << std::endl;
+    }
+#endif
+    
     std::cout << "Enhancement modules initialized successfully!" << std::endl;
     return true;
 }  
 
 bool Upscaler::upscale(const cv::Mat& input, cv::Mat& output) {
+    if (!m_duplicates || !m_initialized || input.empty()) {
+        return upscaleHost(input, output);
+    }
+    if (m_duplicates->lookup(input, output)) {
+        return true;
+    }
+    if (!upscaleHost(input, output)) {
+        return false;
+    }
+    m_duplicates->store(output);
+    return true;
+}
+
+bool Upscaler::upscaleI420(const cv::Mat& input, cv::Mat& output) {
+    if (!m_duplicates || !m_initialized || input.empty()) {
+        return upscaleI420Frame(input, output);
+    }
+    if (m_duplicates->lookup(input, output)) {
+        return true;
+    }
+    if (!upscaleI420Frame(input, output)) {
+        return false;
+    }
+    m_duplicates->store(output);
+    return true;
+}
+
+#ifdef WITH_CUDA
+bool Upscaler::upscale(const cv::cuda::GpuMat& input, cv::cuda::GpuMat& output, cv::cuda::Stream& stream) {
+    if (!m_duplicates || !m_initialized || input.empty()) {
+        return upscaleDevice(input, output, stream);
+    }
+    if (m_duplicates->lookup(input, output, stream)) {
+        return true;
+    }
+    if (!upscaleDevice(input, output, stream)) {
+        return false;
+    }
+    m_duplicates->store(output, stream);
+    return true;
+}
+#endif
+
+void Upscaler::setDuplicateSkipping(bool enable, float threshold) {
+    if (!enable) {
+        m_duplicates.reset();
+        return;
+    }
+    
+    DuplicateDetector::Config config;
+    config.threshold = threshold;
+    if (m_duplicates) {
+        m_duplicates->setConfig(config);
+    } else {
+        m_duplicates = std::make_unique<DuplicateDetector>(config);
+    }
+}
+
+bool Upscaler::upscaleHost(const cv::Mat& input, cv::Mat& output) {
     if (!m_initialized) {
         std::cerr << "Upscaler not initialized" << std::endl;
         return false;
     }
+    ArenaFrameScope frame_scope(*m_arena, *m_features, m_in_frame);
     
     if (input.empty()) {
         std::cerr << "Input frame is empty" << std::endl;
         return false;
     }
     
+#ifdef WITH_CUDA
+    // Keep the whole chain on the device: one upload here, one download at the end
+    if (m_use_gpu && m_stream) {
+        try {
+            m_d_input.upload(input, *m_stream);
+            if (upscaleDevice(m_d_input, m_d_output, *m_stream)) {
+                gpu_utils::ensurePageLocked(output, m_d_output.size(), m_d_output.type());
+                m_d_output.download(output, *m_stream);
+                m_stream->waitForCompletion();
+                return true;
+            }
+            std::cerr << "GPU upscaling failed, falling back to host path" << std::endl;
+        } catch (const cv::Exception& e) {
+            std::cerr << "Error in GPU upscaling: " << e.what() << ", falling back to host path" << std::endl;
+        }
+    }
+#endif
+    
     // For RealESRGAN algorithm with enhancements
     if (m_algorithm == REAL_ESRGAN && m_dnn_sr && m_dnn_sr->isInitialized()) {
         try {
             cv::Mat preprocessed, upscaled, sharpened, postprocessed;
             
             // Step 1: Pre-processing with selective bilateral filtering
+            TraceScope pre_span("upscale.pre_bilateral");
             if (m_use_selective_bilateral && m_bilateral_pre) {
                 if (!m_bilateral_pre->process(input, preprocessed)) {
                     std::cerr << "Pre-processing failed, using original input" << std::endl;
@@ -782,6 +983,7 @@ bool Upscaler::upscale(const cv::Mat& input, cv::Mat& output) {
             } else {
                 input.copyTo(preprocessed);
             }
+            pre_span.end();
             
             // Step 2: Super-resolution upscaling
             if (!m_dnn_sr->upscale(preprocessed, upscaled)) {
@@ -797,6 +999,7 @@ bool Upscaler::upscale(const cv::Mat& input, cv::Mat& output) {
             }
             
             // Step 3: Adaptive sharpening
+            TraceScope sharpen_span("upscale.sharpen");
             if (m_use_adaptive_sharpening && m_sharpening) {
                 if (!m_sharpening->process(upscaled, sharpened)) {
                     std::cerr << "Sharpening failed, using upscaled result" << std::endl;
@@ -805,8 +1008,10 @@ bool Upscaler::upscale(const cv::Mat& input, cv::Mat& output) {
             } else {
                 upscaled.copyTo(sharpened);
             }
+            sharpen_span.end();
             
             // Step 4: Post-processing with selective bilateral filtering
+            TraceScope post_span("upscale.post_bilateral");
             if (m_use_selective_bilateral && m_bilateral_post) {
                 if (!m_bilateral_post->process(sharpened, postprocessed)) {
                     std::cerr << "Post-processing failed, using sharpened result" << std::endl;
@@ -815,8 +1020,10 @@ bool Upscaler::upscale(const cv::Mat& input, cv::Mat& output) {
             } else {
                 sharpened.copyTo(postprocessed);
             }
+            post_span.end();
             
             // Step 5: Temporal consistency
+            TraceScope temporal_span("upscale.temporal");
             if (m_use_temporal_consistency && m_temporal_consistency) {
                 if (!m_temporal_consistency->process(postprocessed, output)) {
                     std::cerr << "Temporal consistency failed, using post-processed result" << std::endl;
@@ -825,6 +1032,7 @@ bool Upscaler::upscale(const cv::Mat& input, cv::Mat& output) {
             } else {
                 postprocessed.copyTo(output);
             }
+            temporal_span.end();
             
             return true;
         } catch (const cv::Exception& e) {
@@ -860,6 +1068,297 @@ bool Upscaler::upscale(const cv::Mat& input, cv::Mat& output) {
     }
 }
 
+bool Upscaler::upscaleI420Frame(const cv::Mat& input, cv::Mat& output) {
+    if (!m_initialized) {
+        std::cerr << "Upscaler not initialized" << std::endl;
+        return false;
+    }
+    ArenaFrameScope frame_scope(*m_arena, *m_features, m_in_frame);
+    
+    if (input.empty() || input.type() != CV_8UC1 || input.rows % 3 != 0) {
+        std::cerr << "Input frame is not an I420 frame" << std::endl;
+        return false;
+    }
+    const cv::Size target(m_target_width, m_target_height);
+    if (target.width % 2 != 0 || target.height % 2 != 0) {
+        std::cerr << "I420 upscaling requires an even target size" << std::endl;
+        return false;
+    }
+    
+    try {
+        // Luma-only models see the Y plane directly; chroma is interpolated
+        // bicubically at its native resolution, as dnn_superres would
+        if (m_algorithm != REAL_ESRGAN && m_dnn_sr && m_dnn_sr->isInitialized() &&
+            m_dnn_sr->supportsLuma()) {
+            cv::Mat in_y, in_u, in_v, out_y, out_u, out_v;
+            yuv::create(target, output);
+            yuv::planes(input, in_y, in_u, in_v);
+            yuv::planes(output, out_y, out_u, out_v);
+            
+            cv::Mat luma;
+            if (!m_dnn_sr->upscaleLuma(in_y, luma)) {
+                std::cerr << "Luma super-resolution failed, using Lanczos" << std::endl;
+                cv::resize(in_y, out_y, target, 0, 0, cv::INTER_LANCZOS4);
+            } else if (luma.size() == target) {
+                luma.copyTo(out_y);
+            } else {
+                cv::resize(luma, out_y, target, 0, 0, cv::INTER_LANCZOS4);
+            }
+            cv::resize(in_u, out_u, out_u.size(), 0, 0, cv::INTER_CUBIC);
+            cv::resize(in_v, out_v, out_v.size(), 0, 0, cv::INTER_CUBIC);
+            return true;
+        }
+        
+        // RealESRGAN, the enhancement chain and the device path are BGR
+        // throughout, so they pay one conversion each way
+        bool bgr_chain = (m_dnn_sr && m_dnn_sr->isInitialized()) || !m_impl;
+#ifdef WITH_CUDA
+        bgr_chain = bgr_chain || (m_use_gpu && m_stream);
+#endif
+        if (bgr_chain) {
+            cv::Mat bgr, upscaled;
+            yuv::toBGR(input, bgr);
+            if (!upscaleHost(bgr, upscaled)) {
+                return false;
+            }
+            yuv::fromBGR(upscaled, output);
+            return true;
+        }
+        
+        return m_impl->upscaleI420(input, output);
+    } catch (const cv::Exception& e) {
+        std::cerr << "Error in I420 upscaling: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+#ifdef WITH_CUDA
+bool Upscaler::upscaleDevice(const cv::cuda::GpuMat& input, cv::cuda::GpuMat& output, cv::cuda::Stream& stream) {
+    if (!m_initialized) {
+        std::cerr << "Upscaler not initialized" << std::endl;
+        return false;
+    }
+    ArenaFrameScope frame_scope(*m_arena, *m_features, m_in_frame);
+    
+    if (input.empty()) {
+        std::cerr << "Input frame is empty" << std::endl;
+        return false;
+    }
+    
+    try {
+        // For RealESRGAN algorithm with enhancements
+        if (m_algorithm == REAL_ESRGAN && m_dnn_sr && m_dnn_sr->isInitialized()) {
+            // Device spans cover the host side of each stage; the GPU work
+            // itself shows up under the matching NVTX range in Nsight
+            // Step 1: Pre-processing with selective bilateral filtering
+            TraceScope pre_span("upscale.pre_bilateral");
+            if (m_use_selective_bilateral && m_bilateral_pre) {
+                if (!m_bilateral_pre->process(input, m_d_preprocessed, stream)) {
+                    std::cerr << "Pre-processing failed, using original input" << std::endl;
+                    input.copyTo(m_d_preprocessed, stream);
+                }
+            } else {
+                input.copyTo(m_d_preprocessed, stream);
+            }
+            pre_span.end();
+            
+            // Step 2: Super-resolution upscaling. cv::dnn only takes host
+            // memory, so this is the one place the frame leaves the device.
+            TraceScope sr_span("upscale.sr");
+            gpu_utils::ensurePageLocked(m_h_sr_input, m_d_preprocessed.size(), m_d_preprocessed.type());
+            m_d_preprocessed.download(m_h_sr_input, stream);
+            stream.waitForCompletion();
+            
+            if (!m_dnn_sr->upscale(m_h_sr_input, m_h_sr_output)) {
+                std::cerr << "Super-resolution failed" << std::endl;
+                
+                // Fall back to standard resize if super-resolution fails
+                cv::resize(m_h_sr_input, m_h_sr_output, cv::Size(m_target_width, m_target_height), 
+                          0, 0, cv::INTER_LANCZOS4);
+                
+                if (m_h_sr_output.empty()) {
+                    return false;
+                }
+            }
+            m_d_upscaled.upload(m_h_sr_output, stream);
+            sr_span.end();
+            
+            // Steps 3-4 in one pass when the fused kernel is available
+            TraceScope enhance_span("upscale.enhance");
+            bool fused = false;
+#ifdef WITH_FUSED_KERNELS
+            if (m_fused && m_use_fused_enhancement && m_use_adaptive_sharpening && m_use_selective_bilateral) {
+                fused = m_fused->process(m_d_upscaled, m_d_postprocessed, stream);
+                if (!fused) {
+                    std::cerr << "Fused enhancement failed, running the stages separately" << std::endl;
+                }
+            }
+#endif
+            
+            if (!fused) {
+                // Step 3: Adaptive sharpening
+                if (m_use_adaptive_sharpening && m_sharpening) {
+                    if (!m_sharpening->process(m_d_upscaled, m_d_sharpened, stream)) {
+                        std::cerr << "Sharpening failed, using upscaled result" << std::endl;
+                        m_d_upscaled.copyTo(m_d_sharpened, stream);
+                    }
+                } else {
+                    m_d_upscaled.copyTo(m_d_sharpened, stream);
+                }
+                
+                // Step 4: Post-processing with selective bilateral filtering
+                if (m_use_selective_bilateral && m_bilateral_post) {
+                    if (!m_bilateral_post->process(m_d_sharpened, m_d_postprocessed, stream)) {
+                        std::cerr << "Post-processing failed, using sharpened result" << std::endl;
+                        m_d_sharpened.copyTo(m_d_postprocessed, stream);
+                    }
+                } else {
+                    m_d_sharpened.copyTo(m_d_postprocessed, stream);
+                }
+            }
+            enhance_span.end();
+            
+            // Step 5: Temporal consistency
+            TraceScope temporal_span("upscale.temporal");
+            if (m_use_temporal_consistency && m_temporal_consistency) {
+                if (!m_temporal_consistency->process(m_d_postprocessed, output, stream)) {
+                    std::cerr << "Temporal consistency failed, using post-processed result" << std::endl;
+                    m_d_postprocessed.copyTo(output, stream);
+                }
+            } else {
+                m_d_postprocessed.copyTo(output, stream);
+            }
+            
+            return true;
+        }
+        // For other upscaling algorithms or if DNN isn't available/initialized
+        else if (m_dnn_sr && m_dnn_sr->isInitialized()) {
+            gpu_utils::ensurePageLocked(m_h_sr_input, input.size(), input.type());
+            input.download(m_h_sr_input, stream);
+            stream.waitForCompletion();
+            if (!m_dnn_sr->upscale(m_h_sr_input, m_h_sr_output)) {
+                return false;
+            }
+            output.upload(m_h_sr_output, stream);
+            return true;
+        }
+        else if (m_impl) {
+            return m_impl->upscale(input, output, stream);
+        }
+        else {
+            // Last resort fallback (CUDA has no Lanczos, use cubic)
+            cv::cuda::resize(input, output, cv::Size(m_target_width, m_target_height), 
+                            0, 0, cv::INTER_CUBIC, stream);
+            return true;
+        }
+    } catch (const cv::Exception& e) {
+        std::cerr << "Error in GPU upscaling: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool Upscaler::upscaleOverlapped(const cv::Mat& input, cv::Mat& output) {
+    if (!overlapsTransfers()) {
+        if (input.empty()) {
+            output.release();
+            return true;
+        }
+        return upscale(input, output);
+    }
+    
+    try {
+        if (!m_overlap) {
+            m_overlap = std::make_unique<OverlapState>();
+        }
+        OverlapState& state = *m_overlap;
+        OverlapState::Slot& previous = state.slots[state.next ^ 1];
+        
+        // The slot was collected on the previous call, so all of its buffers
+        // are free. The upload overlaps the previous frame's device work.
+        if (!input.empty()) {
+            OverlapState::Slot& slot = state.slots[state.next];
+            slot.d_input.upload(input, state.upload_stream);
+            slot.uploaded.record(state.upload_stream);
+            m_stream->waitEvent(slot.uploaded);
+            
+            // No duplicate check here: it would wait for the chain's stream
+            slot.success = upscaleDevice(slot.d_input, slot.d_output, *m_stream);
+            slot.computed.record(*m_stream);
+            
+            state.download_stream.waitEvent(slot.computed);
+            if (slot.success) {
+                gpu_utils::ensurePageLocked(slot.h_output, slot.d_output.size(), slot.d_output.type());
+                slot.d_output.download(slot.h_output, state.download_stream);
+            }
+            slot.downloaded.record(state.download_stream);
+            slot.pending = true;
+            state.next ^= 1;
+            
+            // The caller may reuse input as soon as this returns
+            slot.uploaded.waitForCompletion();
+        }
+        
+        // Hand back the previous frame; its download ran while this frame
+        // was uploaded and computed
+        if (!previous.pending) {
+            output.release();
+            return true;
+        }
+        previous.downloaded.waitForCompletion();
+        previous.pending = false;
+        if (!previous.success) {
+            return false;
+        }
+        cv::swap(output, previous.h_output);
+        return true;
+    } catch (const cv::Exception& e) {
+        std::cerr << "Error in overlapped GPU upscaling: " << e.what() << std::endl;
+        m_overlap.reset();
+        return false;
+    }
+}
+
+void Upscaler::initializeStream() {
+    m_stream.reset();
+    m_overlap.reset();
+    
+    if (!m_use_gpu) {
+        return;
+    }
+    
+    try {
+        m_stream = std::make_unique<cv::cuda::Stream>();
+    } catch (const cv::Exception& e) {
+        std::cerr << "Failed to create CUDA stream: " << e.what() << std::endl;
+        m_stream.reset();
+    }
+}
+#endif
+
+void Upscaler::setModel(Algorithm algorithm, const Model& model) {
+    if (algorithm == REAL_ESRGAN) {
+        m_esrgan_model = model;
+    } else if (algorithm == SUPER_RES) {
+        m_sr_model = model;
+    }
+}
+
+const Upscaler::Model& Upscaler::getModel(Algorithm algorithm) const {
+    return algorithm == REAL_ESRGAN ? m_esrgan_model : m_sr_model;
+}
+
+void Upscaler::setDefaultModel(Algorithm algorithm, const Model& model) {
+    if (algorithm == REAL_ESRGAN) {
+        g_default_esrgan_model = model;
+    } else if (algorithm == SUPER_RES) {
+        g_default_sr_model = model;
+    }
+}
+
+Upscaler::Model Upscaler::getDefaultModel(Algorithm algorithm) {
+    return algorithm == REAL_ESRGAN ? g_default_esrgan_model : g_default_sr_model;
+}
+
 void Upscaler::setAlgorithm(Algorithm algorithm) {
     if (m_algorithm != algorithm) {
         m_algorithm = algorithm;
@@ -921,39 +1420,31 @@ bool Upscaler::initializeImpl() {
     // Clean up existing implementation
     m_impl.reset();
     
+    // Stored results came from the old chain
+    if (m_duplicates) {
+        m_duplicates->reset();
+    }
+    
     if (m_target_width <= 0 || m_target_height <= 0) {
         std::cerr << "Invalid target resolution" << std::endl;
         m_initialized = false;
         return false;
     }
+    
+#ifdef WITH_CUDA
+    initializeStream();
+#endif
 
     if (m_algorithm == SUPER_RES || m_algorithm == REAL_ESRGAN) {
         try {
-            // For REAL_ESRGAN, use REAL_ESRGAN model type
-            DnnSuperRes::ModelType model_type = (m_algorithm == REAL_ESRGAN) ? 
-                                              DnnSuperRes::REAL_ESRGAN : 
-                                              DnnSuperRes::FSRCNN;
-                                               
-            // Use RRDB_ESRGAN.onnx model for RealESRGAN
-            std::string model_path;
-            std::string model_name;
-            
-            if (m_algorithm == REAL_ESRGAN) {
-                model_path = "models/RRDB_ESRGAN_x4.onnx";
-                model_name = "esrgan";
-            } else {
-                // Default FSRCNN model
-                model_path = "models/FSRCNN_x4.pb";
-                model_name = "fsrcnn";
-            }
-            
-            m_dnn_sr = std::make_unique<DnnSuperRes>(model_path, model_name, 4, model_type);
+            const Model& model = getModel(m_algorithm);
+            m_dnn_sr = std::make_unique<DnnSuperRes>(model.path, model.name, model.scale, model.type);
             m_dnn_sr->setTargetSize(m_target_width, m_target_height);
             m_dnn_sr->setUseGPU(m_use_gpu);
             
             if (m_dnn_sr->initialize()) {
                 std::cout << "Using " << (m_algorithm == REAL_ESRGAN ? "RealESRGAN" : "DNN Super Resolution") 
-                          << " for upscaling" << std::endl;
+                          << " (" << model.path << ") for upscaling" << std::endl;
                 m_initialized = true;
                 return true;
             } else {
@@ -972,7 +1463,7 @@ bool Upscaler::initializeImpl() {
 #ifdef WITH_CUDA
     if (m_use_gpu) {
         try {
-            m_impl = std::make_unique<GPUImpl>(m_algorithm, m_target_width, m_target_height);
+            m_impl = std::make_unique<GPUImpl>(m_algorithm, m_target_width, m_target_height, m_arena);
             std::cout << "Using GPU-accelerated upscaling with " << getAlgorithmName() << std::endl;
         } catch (const std::exception& e) {
             std::cerr << "Failed to initialize GPU implementation: " << e.what() << std::endl;
@@ -983,7 +1474,7 @@ bool Upscaler::initializeImpl() {
     
     // Create CPU implementation if GPU is not being used
     if (!m_impl) {
-        m_impl = std::make_unique<CPUImpl>(m_algorithm, m_target_width, m_target_height);
+        m_impl = std::make_unique<CPUImpl>(m_algorithm, m_target_width, m_target_height, m_arena, m_features);
         std::cout << "Using CPU upscaling with " << getAlgorithmName() << std::endl;
     }
     
@@ -0,0 +1,80 @@
+#include "upscaler_loader.h"
+#include "temporal_consistency.h"
+#include <chrono>
+#include <iostream>
+
+#ifdef WITH_CUDA
+#include <opencv2/core/cuda.hpp>
+#endif
+
+UpscalerLoader::UpscalerLoader(const Config& config)
+    : m_config(config),
+      m_ready(false),
+      m_failed(false),
+      m_load_seconds(0.0),
+      m_device(-1) {
+}
+
+UpscalerLoader::~UpscalerLoader() {
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+void UpscalerLoader::start() {
+    if (m_thread.joinable() || m_ready) {
+        return;
+    }
+
+#ifdef WITH_CUDA
+    if (m_config.use_gpu && cv::cuda::getCudaEnabledDeviceCount() > 0) {
+        m_device = cv::cuda::getDevice();
+    }
+#endif
+    m_thread = std::thread(&UpscalerLoader::load, this);
+}
+
+void UpscalerLoader::load() {
+    auto start = std::chrono::steady_clock::now();
+    try {
+#ifdef WITH_CUDA
+        if (m_device >= 0) {
+            cv::cuda::setDevice(m_device);
+        }
+#endif
+        auto upscaler = std::make_unique<Upscaler>(m_config.algorithm, m_config.use_gpu);
+        if (!upscaler->initialize(m_config.target_width, m_config.target_height)) {
+            std::cerr << "Background load of " << upscaler->getAlgorithmName() << " failed" << std::endl;
+            m_failed = true;
+            return;
+        }
+
+        // The first inference at a new shape is the slow one; pay it here
+        if (!m_config.warmup_size.empty()) {
+            cv::Mat dummy(m_config.warmup_size, CV_8UC3, cv::Scalar::all(128));
+            cv::Mat warm;
+            upscaler->upscale(dummy, warm);
+
+            // The dummy frame must not become the first frame of history
+            if (TemporalConsistency* temporal = upscaler->getTemporalConsistency()) {
+                temporal->reset();
+            }
+        }
+
+        m_upscaler = std::move(upscaler);
+    } catch (const cv::Exception& e) {
+        std::cerr << "Error loading upscaler in the background: " << e.what() << std::endl;
+        m_failed = true;
+        return;
+    }
+
+    m_load_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    m_ready.store(true, std::memory_order_release);
+}
+
+std::unique_ptr<Upscaler> UpscalerLoader::take() {
+    if (!isReady()) {
+        return nullptr;
+    }
+    return std::move(m_upscaler);
+}
@@ -3,17 +3,85 @@
 #include <fstream>
 #include <sstream>
 #include <cmath>
+#include <algorithm>
+#include "task_pool.h"
+
+#ifdef WITH_FUSED_KERNELS
+#include <opencv2/core/cuda_stream_accessor.hpp>
+#endif
 
 // If M_PI is not defined in your environment:
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 
+namespace {
+// Rows per parallel stripe for the LUT pass
+constexpr int kRowsPerStripe = 32;
+
+double stripeCount(int rows) {
+    return std::max(1, std::min(rows / kRowsPerStripe, cv::getNumThreads() * 4));
+}
+
+// Lattice cell and 8-bit interpolation weight of every input value along one LUT axis
+struct LutAxis {
+    int index[256];
+    int frac[256];
+};
+
+void buildLutAxis(int lut_size, LutAxis& axis) {
+    for (int v = 0; v < 256; v++) {
+        float pos = v * (lut_size - 1) / 255.0f;
+        int index = std::min(static_cast<int>(pos), lut_size - 2);
+        axis.index[v] = index;
+        axis.frac[v] = cvRound((pos - index) * 256.0f);
+    }
+}
+
+// Trilinear lookup of one BGR row through a continuous LUT laid out as
+// rows (b + g * size) and columns r. Fixed-point weights, no at<> and no
+// per-pixel division; the optional gain row is applied in the same pass.
+void lutRow(const uchar* in, uchar* out, int cols, const uchar* lut, int lut_size,
+            const LutAxis& axis, const float* gain) {
+    const int dr = 3;
+    const int db = lut_size * 3;
+    const int dg = lut_size * lut_size * 3;
+    
+    for (int x = 0; x < cols; x++) {
+        const int b = in[x * 3], g = in[x * 3 + 1], r = in[x * 3 + 2];
+        const uchar* p = lut + axis.index[b] * db + axis.index[g] * dg + axis.index[r] * dr;
+        const int fb = axis.frac[b], fg = axis.frac[g], fr = axis.frac[r];
+        
+        for (int c = 0; c < 3; c++) {
+            // Interpolate along B, then G (rescaled to 16 bits), then R
+            int c00 = p[c] * (256 - fb) + p[db + c] * fb;
+            int c10 = p[dg + c] * (256 - fb) + p[dg + db + c] * fb;
+            int c01 = p[dr + c] * (256 - fb) + p[dr + db + c] * fb;
+            int c11 = p[dg + dr + c] * (256 - fb) + p[dg + dr + db + c] * fb;
+            int c0 = (c00 * (256 - fg) + c10 * fg + 128) >> 8;
+            int c1 = (c01 * (256 - fg) + c11 * fg + 128) >> 8;
+            int value = c0 * (256 - fr) + c1 * fr;
+            
+            if (gain) {
+                float scaled = value * (gain[x] / 65536.0f);
+                out[x * 3 + c] = static_cast<uchar>(std::min(scaled + 0.5f, 255.0f));
+            } else {
+                out[x * 3 + c] = static_cast<uchar>((value + 32768) >> 16);
+            }
+        }
+    }
+}
+}
+
 VideoEnhancer::VideoEnhancer(EnhancementLevel level)
-    : m_level(level), m_initialized(false) {
+    : m_level(level), m_initialized(false), m_arena(std::make_shared<FrameArena>()),
+      m_color_lut_valid(false), m_vignette_strength(0.0f) {
 }
 
 VideoEnhancer::~VideoEnhancer() {
+#ifdef WITH_FUSED_KERNELS
+    fused_kernels::releaseLut3D(m_device_lut);
+#endif
 }
 
 bool VideoEnhancer::initialize() {
@@ -41,26 +109,25 @@ bool VideoEnhancer::enhance(const cv::Mat& input, cv::Mat& output) {
     // Create a working copy
     input.copyTo(output);
     
-    // Process based on enhancement level
+    // Process based on enhancement level. The colour stage is one LUT pass
+    // holding every per-pixel colour operation of the level (see rebuildColorLUT)
     switch (m_level) {
         case LIGHT:
             reduceNoise(output, 0.3f);
             enhanceDetails(output);
-            enhanceColors(output);
+            applyColorStage(output);
             break;
             
         case MEDIUM:
             reduceNoise(output, 0.5f);
             enhanceDetails(output);
-            enhanceColors(output);
-            adjustContrast(output, 1.05f);
+            applyColorStage(output);
             break;
             
         case STRONG:
             reduceNoise(output, 0.6f);
             enhanceDetails(output);
-            enhanceColors(output);
-            adjustContrast(output, 1.1f);
+            applyColorStage(output);
             localContrastEnhancement(output);
             break;
             
@@ -68,7 +135,7 @@ bool VideoEnhancer::enhance(const cv::Mat& input, cv::Mat& output) {
             reduceNoise(output, 0.5f);
             enhanceDarkAreas(output);
             enhanceDetails(output);
-            colorGrading(output);
+            applyColorStage(output);
             localContrastEnhancement(output);
             recoverHighlights(output);
             break;
@@ -81,130 +148,202 @@ bool VideoEnhancer::enhance(const cv::Mat& input, cv::Mat& output) {
 }
 
 void VideoEnhancer::setLevel(EnhancementLevel level) {
+    if (level != m_level) {
+        m_color_lut_valid = false;
+    }
     m_level = level;
 }
 
+void VideoEnhancer::setArena(std::shared_ptr<FrameArena> arena) {
+    if (arena) {
+        m_arena = std::move(arena);
+    }
+}
+
 VideoEnhancer::EnhancementLevel VideoEnhancer::getLevel() const {
     return m_level;
 }
 
+bool VideoEnhancer::loadCubeLUT(const std::string& filepath) {
+    if (filepath.empty()) {
+        m_grading_lut.release();
+        m_color_lut_valid = false;
+        return true;
+    }
+    
+    cv::Mat lut3D;
+    if (!loadCubeLUT(filepath, lut3D)) {
+        return false;
+    }
+    
+    m_grading_lut = lut3D;
+    m_color_lut_valid = false;
+    return true;
+}
+
+void VideoEnhancer::rebuildColorLUT() {
+    // Identity lattice in the same layout as the grading LUTs; running the
+    // colour operations over it bakes them into a single table
+    const int LUT_SIZE = COLOR_LUT_SIZE;
+    cv::Mat lattice(LUT_SIZE * LUT_SIZE, LUT_SIZE, CV_8UC3);
+    for (int b = 0; b < LUT_SIZE; b++) {
+        for (int g = 0; g < LUT_SIZE; g++) {
+            cv::Vec3b* row = lattice.ptr<cv::Vec3b>(b + g * LUT_SIZE);
+            for (int r = 0; r < LUT_SIZE; r++) {
+                row[r] = cv::Vec3b(cv::saturate_cast<uchar>(b * 255.0 / (LUT_SIZE - 1)),
+                                   cv::saturate_cast<uchar>(g * 255.0 / (LUT_SIZE - 1)),
+                                   cv::saturate_cast<uchar>(r * 255.0 / (LUT_SIZE - 1)));
+            }
+        }
+    }
+    
+    // Same order as the unfused chain used to apply them per frame
+    switch (m_level) {
+        case LIGHT:
+            enhanceColors(lattice);
+            break;
+        case MEDIUM:
+            enhanceColors(lattice);
+            adjustContrast(lattice, 1.05f);
+            break;
+        case STRONG:
+            enhanceColors(lattice);
+            adjustContrast(lattice, 1.1f);
+            break;
+        case YOUTUBE:
+            colorGrading(lattice);
+            break;
+        default:
+            break;
+    }
+    
+    m_color_lut = lattice;
+    m_color_lut_valid = true;
+}
+
+void VideoEnhancer::applyColorStage(cv::Mat& image) {
+    if (!m_color_lut_valid) {
+        rebuildColorLUT();
+    }
+    
+    // The cinematic vignette rides along in the same pass
+    cv::Mat gain;
+    if (m_level == YOUTUBE) {
+        gain = vignetteGain(image.size(), 0.3f);
+    }
+    
+    applyLUT(image, image, m_color_lut, gain);
+}
+
 void VideoEnhancer::enhanceColors(cv::Mat& image) {
     // Convert to LAB colorspace for better color processing
-    cv::Mat lab;
+    cv::Mat& lab = m_arena->host("enhance.lab", image.size(), CV_8UC3);
     cv::cvtColor(image, lab, cv::COLOR_BGR2Lab);
     
-    // Split channels
-    std::vector<cv::Mat> channels;
-    cv::split(lab, channels);
-    
-    // Enhance a and b channels for more vivid colors
+    // Enhance a and b channels for more vivid colors; L is scaled by 1
     float factor = (m_level == YOUTUBE) ? 1.08f : 1.05f;
-    channels[1] = channels[1] * factor;
-    channels[2] = channels[2] * factor;
+    cv::multiply(lab, cv::Scalar(1.0, factor, factor), lab);
     
-    // Merge and convert back
-    cv::merge(channels, lab);
+    // Convert back
     cv::cvtColor(lab, image, cv::COLOR_Lab2BGR);
 }
 
 void VideoEnhancer::adjustContrast(cv::Mat& image, float factor) {
-    cv::Mat result;
-    image.convertTo(result, -1, factor, 0);
-    result.copyTo(image);
+    // convertTo is element-wise, so it can run in place
+    image.convertTo(image, -1, factor, 0);
 }
 
 void VideoEnhancer::adjustSaturation(cv::Mat& image, float factor) {
-    cv::Mat hsv;
+    cv::Mat& hsv = m_arena->host("enhance.hsv", image.size(), CV_8UC3);
     cv::cvtColor(image, hsv, cv::COLOR_BGR2HSV);
     
-    std::vector<cv::Mat> channels;
-    cv::split(hsv, channels);
+    cv::multiply(hsv, cv::Scalar(1.0, factor, 1.0), hsv);
     
-    channels[1] = channels[1] * factor;
-    
-    cv::merge(channels, hsv);
     cv::cvtColor(hsv, image, cv::COLOR_HSV2BGR);
 }
 
 void VideoEnhancer::adjustGamma(cv::Mat& image, float gamma) {
-    cv::Mat lookUpTable(1, 256, CV_8U);
+    cv::Mat& lookUpTable = m_arena->host("enhance.gamma_lut", cv::Size(256, 1), CV_8U);
     uchar* p = lookUpTable.ptr();
     for (int i = 0; i < 256; ++i)
         p[i] = cv::saturate_cast<uchar>(pow(i / 255.0, gamma) * 255.0);
     
-    cv::Mat result;
-    cv::LUT(image, lookUpTable, result);
-    result.copyTo(image);
+    // Table lookup is element-wise, so it can run in place
+    cv::LUT(image, lookUpTable, image);
 }
 
 void VideoEnhancer::enhanceDetails(cv::Mat& image) {
+    FrameArena& arena = *m_arena;
+    
     // Convert to YCrCb for better detail processing
-    cv::Mat ycrcb;
+    cv::Mat& ycrcb = arena.host("enhance.ycrcb", image.size(), CV_8UC3);
     cv::cvtColor(image, ycrcb, cv::COLOR_BGR2YCrCb);
     
-    // Split channels
-    std::vector<cv::Mat> channels;
-    cv::split(ycrcb, channels);
-    
     // Apply sharpening to Y channel only
-    cv::Mat y = channels[0];
-    cv::Mat sharpened;
+    cv::Mat& y = arena.host("enhance.y", image.size(), CV_8UC1);
+    cv::Mat& sharpened = arena.host("enhance.y_sharpened", image.size(), CV_8UC1);
+    cv::extractChannel(ycrcb, y, 0);
     
     // Create sharpening kernel
     float strength = (m_level == YOUTUBE) ? 0.8f : 0.5f;
-    cv::Mat kernel = (cv::Mat_<float>(3, 3) << 
-        -0.1f*strength, -0.1f*strength, -0.1f*strength,
-        -0.1f*strength,  1.0f + 0.8f*strength, -0.1f*strength,
-        -0.1f*strength, -0.1f*strength, -0.1f*strength);
+    cv::Mat& kernel = arena.host("enhance.detail_kernel", cv::Size(3, 3), CV_32F);
+    kernel.setTo(cv::Scalar(-0.1f * strength));
+    kernel.at<float>(1, 1) = 1.0f + 0.8f * strength;
     
     cv::filter2D(y, sharpened, -1, kernel);
     
     // Blend with original for more natural look
-    cv::addWeighted(y, 0.3, sharpened, 0.7, 0, channels[0]);
+    cv::addWeighted(y, 0.3, sharpened, 0.7, 0, y);
     
-    // Merge channels
-    cv::merge(channels, ycrcb);
+    // Put the Y channel back and convert
+    cv::insertChannel(y, ycrcb, 0);
     cv::cvtColor(ycrcb, image, cv::COLOR_YCrCb2BGR);
 }
 
 void VideoEnhancer::sharpenAdaptive(cv::Mat& image, float strength) {
+    FrameArena& arena = *m_arena;
+    
     // Convert to grayscale to detect edges
-    cv::Mat gray;
+    cv::Mat& gray = arena.host("enhance.gray", image.size(), CV_8UC1);
     cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
     
     // Detect edges using Laplacian
-    cv::Mat edges;
+    cv::Mat& edges = arena.host("enhance.edges", image.size(), CV_8UC1);
     cv::Laplacian(gray, edges, CV_8U, 3);
     
     // Threshold edges to create mask
-    cv::Mat mask;
-    cv::threshold(edges, mask, 25, 255, cv::THRESH_BINARY);
-    
-    // Dilate mask to extend edges
-    cv::Mat kernel = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(3, 3));
-    cv::dilate(mask, mask, kernel);
+    cv::threshold(edges, edges, 25, 255, cv::THRESH_BINARY);
     
-    // Convert mask to float 0-1
-    mask.convertTo(mask, CV_32F, 1.0/255.0);
+    // Dilate mask to extend edges (3x3 ellipse, which is a cross)
+    cv::Mat& mask = arena.host("enhance.edge_mask", image.size(), CV_8UC1);
+    cv::Mat& kernel = arena.host("enhance.dilate_kernel", cv::Size(3, 3), CV_8U);
+    kernel.setTo(cv::Scalar(1));
+    kernel.at<uchar>(0, 0) = kernel.at<uchar>(0, 2) = kernel.at<uchar>(2, 0) = kernel.at<uchar>(2, 2) = 0;
+    cv::dilate(edges, mask, kernel);
     
     // Apply sharpening filter to entire image
-    cv::Mat sharpened;
-    cv::Mat sharpen_kernel = (cv::Mat_<float>(3, 3) << 
-        0, -strength, 0,
-        -strength, 1+4*strength, -strength,
-        0, -strength, 0);
+    cv::Mat& sharpened = arena.host("enhance.sharpened", image.size(), image.type());
+    cv::Mat& sharpen_kernel = arena.host("enhance.sharpen_kernel", cv::Size(3, 3), CV_32F);
+    sharpen_kernel.setTo(cv::Scalar(0));
+    sharpen_kernel.at<float>(0, 1) = sharpen_kernel.at<float>(1, 0) = -strength;
+    sharpen_kernel.at<float>(1, 2) = sharpen_kernel.at<float>(2, 1) = -strength;
+    sharpen_kernel.at<float>(1, 1) = 1 + 4 * strength;
     
     cv::filter2D(image, sharpened, -1, sharpen_kernel);
     
-    // Blend based on mask
-    for (int i = 0; i < image.rows; i++) {
-        for (int j = 0; j < image.cols; j++) {
-            float m = mask.at<float>(i, j);
-            if (m > 0) {
-                image.at<cv::Vec3b>(i, j) = sharpened.at<cv::Vec3b>(i, j);
+    // Take the sharpened pixels on the (non-zero) mask
+    TaskPool::instance().parallelFor(0, image.rows, [&](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            const uchar* m = mask.ptr<uchar>(i);
+            const cv::Vec3b* sharp = sharpened.ptr<cv::Vec3b>(i);
+            cv::Vec3b* row = image.ptr<cv::Vec3b>(i);
+            for (int j = 0; j < image.cols; j++) {
+                if (m[j] > 0) {
+                    row[j] = sharp[j];
+                }
             }
         }
-    }
+    });
 }
 
 void VideoEnhancer::reduceNoise(cv::Mat& image, float strength) {
@@ -217,55 +356,51 @@ void VideoEnhancer::reduceNoise(cv::Mat& image, float strength) {
     double sigmaColor = 15 * strength;
     double sigmaSpace = 15 * strength;
     
-    cv::Mat result;
+    // The bilateral filter cannot run in place
+    cv::Mat& result = m_arena->host("enhance.denoised", image.size(), image.type());
     cv::bilateralFilter(image, result, d, sigmaColor, sigmaSpace);
     result.copyTo(image);
 }
 
 void VideoEnhancer::localContrastEnhancement(cv::Mat& image) {
+    FrameArena& arena = *m_arena;
+    
     // Convert to YCrCb
-    cv::Mat ycrcb;
+    cv::Mat& ycrcb = arena.host("enhance.ycrcb", image.size(), CV_8UC3);
     cv::cvtColor(image, ycrcb, cv::COLOR_BGR2YCrCb);
     
-    // Split channels
-    std::vector<cv::Mat> channels;
-    cv::split(ycrcb, channels);
+    cv::Mat& y = arena.host("enhance.y", image.size(), CV_8UC1);
+    cv::extractChannel(ycrcb, y, 0);
     
     // Apply CLAHE to the Y channel
-    cv::Ptr<cv::CLAHE> clahe = cv::createCLAHE();
-    clahe->setClipLimit(2.0);
-    clahe->setTilesGridSize(cv::Size(8, 8));
+    if (!m_clahe) {
+        m_clahe = cv::createCLAHE();
+        m_clahe->setClipLimit(2.0);
+        m_clahe->setTilesGridSize(cv::Size(8, 8));
+    }
     
-    cv::Mat enhanced;
-    clahe->apply(channels[0], enhanced);
+    cv::Mat& enhanced = arena.host("enhance.y_clahe", image.size(), CV_8UC1);
+    m_clahe->apply(y, enhanced);
     
     // Blend with original Y channel for more natural look
-    cv::addWeighted(channels[0], 0.3, enhanced, 0.7, 0, channels[0]);
+    cv::addWeighted(y, 0.3, enhanced, 0.7, 0, y);
     
-    // Merge and convert back
-    cv::merge(channels, ycrcb);
+    // Put the Y channel back and convert
+    cv::insertChannel(y, ycrcb, 0);
     cv::cvtColor(ycrcb, image, cv::COLOR_YCrCb2BGR);
 }
 
 void VideoEnhancer::colorGrading(cv::Mat& image) {
     // LUT-based color grading implementation
-    // This simulates professional color grading used in film/YouTube
-    
-    // If we haven't loaded the LUT yet, create it
-    static cv::Mat lut3D;
-    static bool lut_initialized = false;
-    
-    if (!lut_initialized) {
+    // This simulates professional color grading used in film/YouTube.
+    // A loaded .cube LUT replaces the built-in cinematic grade.
+    if (m_grading_lut.empty() && m_cinematic_lut.empty()) {
         // Create a 3D LUT with 33x33x33 size (standard for color grading)
-        lut3D = createCinematicLUT();
-        lut_initialized = true;
+        m_cinematic_lut = createCinematicLUT();
     }
     
     // Apply the 3D LUT to the image
-    applyLUT(image, lut3D);
-    
-    // Optional: Add a subtle vignette for cinematic effect
-    addVignette(image, 0.3f);
+    applyLUT(image, m_grading_lut.empty() ? m_cinematic_lut : m_grading_lut);
 }
 
 cv::Mat VideoEnhancer::createCinematicLUT() {
@@ -403,84 +538,104 @@ cv::Mat VideoEnhancer::createCinematicLUT() {
 }
 
 void VideoEnhancer::applyLUT(cv::Mat& image, const cv::Mat& lut3D) {
-    const int LUT_SIZE = 33; // Must match LUT creation
+    applyLUT(image, image, lut3D, cv::Mat());
+}
+
+void VideoEnhancer::applyLUT(const cv::Mat& src, cv::Mat& dst, const cv::Mat& lut3D, const cv::Mat& gain) {
+    // LUT is (size * size) x size, indexed as (b + g * size, r)
+    const int lut_size = lut3D.cols;
+    if (src.type() != CV_8UC3 || lut3D.type() != CV_8UC3 || lut_size < 2 ||
+        lut3D.rows != lut_size * lut_size) {
+        std::cerr << "applyLUT expects an 8-bit BGR image and a 3D LUT" << std::endl;
+        if (&src != &dst) {
+            src.copyTo(dst);
+        }
+        return;
+    }
     
-    // Process each pixel
-    for (int i = 0; i < image.rows; i++) {
-        for (int j = 0; j < image.cols; j++) {
-            cv::Vec3b& pixel = image.at<cv::Vec3b>(i, j);
-            
-            // Get normalized coordinates in the LUT
-            float bVal = pixel[0] / 255.0f * (LUT_SIZE - 1);
-            float gVal = pixel[1] / 255.0f * (LUT_SIZE - 1);
-            float rVal = pixel[2] / 255.0f * (LUT_SIZE - 1);
-            
-            // Get the 8 surrounding points in the LUT cube
-            int b0 = std::floor(bVal);
-            int g0 = std::floor(gVal);
-            int r0 = std::floor(rVal);
-            
-            int b1 = std::min(b0 + 1, LUT_SIZE - 1);
-            int g1 = std::min(g0 + 1, LUT_SIZE - 1);
-            int r1 = std::min(r0 + 1, LUT_SIZE - 1);
-            
-            // Get fractional parts for interpolation
-            float bFrac = bVal - b0;
-            float gFrac = gVal - g0;
-            float rFrac = rVal - r0;
-            
-            // 3D linear interpolation (trilinear)
-            // First interpolate in B direction
-            cv::Vec3b c000 = lut.at<cv::Vec3b>(b0 + g0 * LUT_SIZE, r0);
-            cv::Vec3b c100 = lut.at<cv::Vec3b>(b1 + g0 * LUT_SIZE, r0);
-            cv::Vec3b c00 = c000 * (1 - bFrac) + c100 * bFrac;
-            
-            cv::Vec3b c010 = lut.at<cv::Vec3b>(b0 + g1 * LUT_SIZE, r0);
-            cv::Vec3b c110 = lut.at<cv::Vec3b>(b1 + g1 * LUT_SIZE, r0);
-            cv::Vec3b c01 = c010 * (1 - bFrac) + c110 * bFrac;
-            
-            cv::Vec3b c001 = lut.at<cv::Vec3b>(b0 + g0 * LUT_SIZE, r1);
-            cv::Vec3b c101 = lut.at<cv::Vec3b>(b1 + g0 * LUT_SIZE, r1);
-            cv::Vec3b c10 = c001 * (1 - bFrac) + c101 * bFrac;
-            
-            cv::Vec3b c011 = lut.at<cv::Vec3b>(b0 + g1 * LUT_SIZE, r1);
-            cv::Vec3b c111 = lut.at<cv::Vec3b>(b1 + g1 * LUT_SIZE, r1);
-            cv::Vec3b c11 = c011 * (1 - bFrac) + c111 * bFrac;
-            
-            // Interpolate in G direction
-            cv::Vec3b c0 = c00 * (1 - gFrac) + c01 * gFrac;
-            cv::Vec3b c1 = c10 * (1 - gFrac) + c11 * gFrac;
-            
-            // Finally, interpolate in R direction
-            cv::Vec3b result = c0 * (1 - rFrac) + c1 * rFrac;
-            
-            // Update the pixel
-            pixel = result;
+    cv::Mat lut = lut3D.isContinuous() ? lut3D : lut3D.clone();
+    bool use_gain = !gain.empty() && gain.size() == src.size() && gain.type() == CV_32F;
+    
+    LutAxis axis;
+    buildLutAxis(lut_size, axis);
+    
+    dst.create(src.size(), CV_8UC3);
+    cv::parallel_for_(cv::Range(0, src.rows), [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end; y++) {
+            lutRow(src.ptr<uchar>(y), dst.ptr<uchar>(y), src.cols, lut.ptr<uchar>(), lut_size,
+                   axis, use_gain ? gain.ptr<float>(y) : nullptr);
         }
+    }, stripeCount(src.rows));
+}
+
+#ifdef WITH_FUSED_KERNELS
+bool VideoEnhancer::applyLUT(const cv::cuda::GpuMat& src, cv::cuda::GpuMat& dst, const cv::Mat& lut3D,
+                             const cv::cuda::GpuMat& gain, cv::cuda::Stream& stream) {
+    const int lut_size = lut3D.cols;
+    if (src.type() != CV_8UC3 || lut3D.type() != CV_8UC3 || lut_size < 2 ||
+        lut3D.rows != lut_size * lut_size) {
+        std::cerr << "applyLUT expects an 8-bit BGR image and a 3D LUT" << std::endl;
+        return false;
     }
+    
+    // A rebuilt LUT is a new Mat; holding the old header keeps its buffer
+    // alive, so a matching data pointer always means the same table
+    if (m_device_lut_source.data != lut3D.data || m_device_lut.size != lut_size) {
+        cv::Mat lut = lut3D.isContinuous() ? lut3D : lut3D.clone();
+        if (!fused_kernels::uploadLut3D(lut.ptr<uchar>(), lut_size, m_device_lut)) {
+            m_device_lut_source.release();
+            std::cerr << "Failed to upload the 3D LUT texture" << std::endl;
+            return false;
+        }
+        m_device_lut_source = lut3D;
+    }
+    
+    bool use_gain = !gain.empty() && gain.size() == src.size() && gain.type() == CV_32F;
+    
+    dst.create(src.size(), CV_8UC3);
+    return fused_kernels::launchApplyLut3D(src.ptr<uchar>(), src.step, dst.ptr<uchar>(), dst.step,
+                                           src.cols, src.rows, m_device_lut,
+                                           use_gain ? gain.ptr<float>() : nullptr, gain.step,
+                                           cv::cuda::StreamAccessor::getStream(stream));
 }
+#endif
 
-void VideoEnhancer::addVignette(cv::Mat& image, float strength) {
-    int borderSize = image.cols / 15;
-    cv::Mat mask = cv::Mat::ones(image.size(), CV_32F);
+const cv::Mat& VideoEnhancer::vignetteGain(const cv::Size& size, float strength) {
+    if (m_vignette_gain.size() == size && m_vignette_strength == strength) {
+        return m_vignette_gain;
+    }
+    
+    int borderSize = size.width / 15;
+    cv::Mat mask = cv::Mat::ones(size, CV_32F);
     cv::rectangle(mask, 
                  cv::Rect(borderSize, borderSize, 
-                          image.cols - 2*borderSize, image.rows - 2*borderSize),
+                          size.width - 2*borderSize, size.height - 2*borderSize),
                  cv::Scalar(0), -1);
     cv::GaussianBlur(mask, mask, cv::Size(borderSize*2+1, borderSize*2+1), 0);
-    mask = 1.0 - mask;
+    
+    // gain = 1 - (1 - blurred border) * strength
+    mask.convertTo(m_vignette_gain, CV_32F, strength, 1.0 - strength);
+    m_vignette_strength = strength;
+    return m_vignette_gain;
+}
+
+void VideoEnhancer::addVignette(cv::Mat& image, float strength) {
+    const cv::Mat& gain = vignetteGain(image.size(), strength);
     
     // Apply vignette
-    for (int i = 0; i < image.rows; i++) {
-        for (int j = 0; j < image.cols; j++) {
-            float m = 1.0 - (mask.at<float>(i, j) * strength);
-            image.at<cv::Vec3b>(i, j) = cv::Vec3b(
-                cv::saturate_cast<uchar>(image.at<cv::Vec3b>(i, j)[0] * m),
-                cv::saturate_cast<uchar>(image.at<cv::Vec3b>(i, j)[1] * m),
-                cv::saturate_cast<uchar>(image.at<cv::Vec3b>(i, j)[2] * m)
-            );
+    TaskPool::instance().parallelFor(0, image.rows, [&](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            const float* g = gain.ptr<float>(i);
+            cv::Vec3b* row = image.ptr<cv::Vec3b>(i);
+            for (int j = 0; j < image.cols; j++) {
+                row[j] = cv::Vec3b(
+                    cv::saturate_cast<uchar>(row[j][0] * g[j]),
+                    cv::saturate_cast<uchar>(row[j][1] * g[j]),
+                    cv::saturate_cast<uchar>(row[j][2] * g[j])
+                );
+            }
         }
-    }
+    });
 }
 
 // Add this to load industry-standard LUTs in CUBE format
@@ -492,6 +647,7 @@ bool VideoEnhancer::loadCubeLUT(const std::string& filepath, cv::Mat& lut3D) {
     }
     
     int size = 0;
+    int count = 0;
     std::string line;
     while (std::getline(file, line)) {
         // Skip comments and empty lines
@@ -503,85 +659,99 @@ bool VideoEnhancer::loadCubeLUT(const std::string& filepath, cv::Mat& lut3D) {
             std::istringstream iss(line);
             std::string tmp;
             iss >> tmp >> size;
+            if (size < 2) {
+                std::cerr << "Invalid LUT_3D_SIZE in " << filepath << std::endl;
+                return false;
+            }
+            lut3D.create(size * size, size, CV_8UC3);
             continue;
         }
         
-        // Process data points if size is known
-        if (size > 0) {
+        // Process data points if size is known; keyword lines fail to parse
+        if (size > 0 && count < size * size * size) {
             // Check if line contains 3 float values
             float r, g, b;
             std::istringstream iss(line);
             if (iss >> r >> g >> b) {
-                // Convert 0-1 range to 0-255
-                uchar rVal = cv::saturate_cast<uchar>(r * 255.0f);
-                uchar gVal = cv::saturate_cast<uchar>(g * 255.0f);
-                uchar bVal = cv::saturate_cast<uchar>(b * 255.0f);
-                
-                // Calculate position in the LUT
-                int rIdx = (r * (size - 1) + 0.5f);
-                int gIdx = (g * (size - 1) + 0.5f);
-                int bIdx = (b * (size - 1) + 0.5f);
+                // Entries are listed with red changing fastest, then green, then blue
+                int rIdx = count % size;
+                int gIdx = (count / size) % size;
+                int bIdx = count / (size * size);
                 
-                // Store in LUT
-                lut3D.at<cv::Vec3b>(bIdx + gIdx * size, rIdx) = cv::Vec3b(bVal, gVal, rVal);
+                // Convert 0-1 range to 0-255 and store in LUT
+                lut3D.at<cv::Vec3b>(bIdx + gIdx * size, rIdx) = cv::Vec3b(
+                    cv::saturate_cast<uchar>(b * 255.0f),
+                    cv::saturate_cast<uchar>(g * 255.0f),
+                    cv::saturate_cast<uchar>(r * 255.0f));
+                count++;
             }
         }
     }
     
     file.close();
+    
+    if (size == 0 || count != size * size * size) {
+        std::cerr << "Incomplete 3D LUT in " << filepath << ": " << count
+                  << " of " << size * size * size << " entries" << std::endl;
+        lut3D.release();
+        return false;
+    }
     return true;
 }
 
 void VideoEnhancer::enhanceDarkAreas(cv::Mat& image) {
+    FrameArena& arena = *m_arena;
+    
     // Convert to YCrCb
-    cv::Mat ycrcb;
+    cv::Mat& ycrcb = arena.host("enhance.ycrcb", image.size(), CV_8UC3);
     cv::cvtColor(image, ycrcb, cv::COLOR_BGR2YCrCb);
     
-    // Split channels
-    std::vector<cv::Mat> channels;
-    cv::split(ycrcb, channels);
+    cv::Mat& y = arena.host("enhance.y", image.size(), CV_8UC1);
+    cv::extractChannel(ycrcb, y, 0);
     
-    // Create a mask for dark areas
-    cv::Mat darkMask;
-    cv::threshold(channels[0], darkMask, 60, 1.0, cv::THRESH_BINARY_INV);
-    cv::GaussianBlur(darkMask, darkMask, cv::Size(5, 5), 0);
+    // Create a mask for dark areas. It is 8-bit 0/1 and stays so after the
+    // blur, so the blend below is a masked copy
+    cv::Mat& raw_mask = arena.host("enhance.tone_threshold", image.size(), CV_8UC1);
+    cv::Mat& darkMask = arena.host("enhance.tone_mask", image.size(), CV_8UC1);
+    cv::threshold(y, raw_mask, 60, 1.0, cv::THRESH_BINARY_INV);
+    cv::GaussianBlur(raw_mask, darkMask, cv::Size(5, 5), 0);
     
     // Lighten dark areas
-    cv::Mat y = channels[0];
-    cv::Mat y_light;
+    cv::Mat& y_light = arena.host("enhance.y_adjusted", image.size(), CV_8UC1);
     y.convertTo(y_light, -1, 1.0, 15);
     
     // Blend based on mask
-    channels[0] = y.mul(1.0 - darkMask) + y_light.mul(darkMask);
+    y_light.copyTo(y, darkMask);
     
-    // Merge channels
-    cv::merge(channels, ycrcb);
+    // Put the Y channel back and convert
+    cv::insertChannel(y, ycrcb, 0);
     cv::cvtColor(ycrcb, image, cv::COLOR_YCrCb2BGR);
 }
 
 void VideoEnhancer::recoverHighlights(cv::Mat& image) {
+    FrameArena& arena = *m_arena;
+    
     // Convert to YCrCb
-    cv::Mat ycrcb;
+    cv::Mat& ycrcb = arena.host("enhance.ycrcb", image.size(), CV_8UC3);
     cv::cvtColor(image, ycrcb, cv::COLOR_BGR2YCrCb);
     
-    // Split channels
-    std::vector<cv::Mat> channels;
-    cv::split(ycrcb, channels);
+    cv::Mat& y = arena.host("enhance.y", image.size(), CV_8UC1);
+    cv::extractChannel(ycrcb, y, 0);
     
-    // Create a mask for highlight areas
-    cv::Mat highlightMask;
-    cv::threshold(channels[0], highlightMask, 235, 1.0, cv::THRESH_BINARY);
-    cv::GaussianBlur(highlightMask, highlightMask, cv::Size(5, 5), 0);
+    // Create a mask for highlight areas (8-bit 0/1, as in enhanceDarkAreas)
+    cv::Mat& raw_mask = arena.host("enhance.tone_threshold", image.size(), CV_8UC1);
+    cv::Mat& highlightMask = arena.host("enhance.tone_mask", image.size(), CV_8UC1);
+    cv::threshold(y, raw_mask, 235, 1.0, cv::THRESH_BINARY);
+    cv::GaussianBlur(raw_mask, highlightMask, cv::Size(5, 5), 0);
     
     // Recover highlights by reducing brightness
-    cv::Mat y = channels[0];
-    cv::Mat y_recovered;
+    cv::Mat& y_recovered = arena.host("enhance.y_adjusted", image.size(), CV_8UC1);
     y.convertTo(y_recovered, -1, 0.9, 0);
     
     // Blend based on mask
-    channels[0] = y.mul(1.0 - highlightMask) + y_recovered.mul(highlightMask);
+    y_recovered.copyTo(y, highlightMask);
     
-    // Merge channels
-    cv::merge(channels, ycrcb);
+    // Put the Y channel back and convert
+    cv::insertChannel(y, ycrcb, 0);
     cv::cvtColor(ycrcb, image, cv::COLOR_YCrCb2BGR);
 }
\ No newline at end of file
@@ -0,0 +1,46 @@
+#include "yuv_frame.h"
+
+namespace yuv {
+
+cv::Size frameSize(const cv::Mat& i420) {
+    return cv::Size(i420.cols, i420.rows * 2 / 3);
+}
+
+void create(const cv::Size& size, cv::Mat& i420) {
+    i420.create(size.height * 3 / 2, size.width, CV_8UC1);
+}
+
+void planes(const cv::Mat& i420, cv::Mat& y, cv::Mat& u, cv::Mat& v) {
+    const cv::Size size = frameSize(i420);
+    const cv::Size chroma(size.width / 2, size.height / 2);
+    uchar* data = i420.data;
+
+    y = cv::Mat(size, CV_8UC1, data, i420.step);
+    u = cv::Mat(chroma, CV_8UC1, data + static_cast<size_t>(size.area()));
+    v = cv::Mat(chroma, CV_8UC1, data + static_cast<size_t>(size.area()) + chroma.area());
+}
+
+void resize(const cv::Mat& src, cv::Mat& dst, const cv::Size& size,
+            int luma_interpolation, int chroma_interpolation) {
+    create(size, dst);
+
+    cv::Mat src_y, src_u, src_v, dst_y, dst_u, dst_v;
+    planes(src, src_y, src_u, src_v);
+    planes(dst, dst_y, dst_u, dst_v);
+
+    // The destination views already have the right shape, so resize writes
+    // straight into the frame
+    cv::resize(src_y, dst_y, dst_y.size(), 0, 0, luma_interpolation);
+    cv::resize(src_u, dst_u, dst_u.size(), 0, 0, chroma_interpolation);
+    cv::resize(src_v, dst_v, dst_v.size(), 0, 0, chroma_interpolation);
+}
+
+void toBGR(const cv::Mat& i420, cv::Mat& bgr) {
+    cv::cvtColor(i420, bgr, cv::COLOR_YUV2BGR_I420);
+}
+
+void fromBGR(const cv::Mat& bgr, cv::Mat& i420) {
+    cv::cvtColor(bgr, i420, cv::COLOR_BGR2YUV_I420);
+}
+
+} // namespace yuv
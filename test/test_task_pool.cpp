@@ -0,0 +1,95 @@
+#include "task_pool.h"
+#include <atomic>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+// Exercises TaskPool::parallelFor under contention. Build with
+// -DSANITIZE=thread or -DSANITIZE=address to catch lifetime races between a
+// returning caller and workers still signalling its tile group.
+
+namespace {
+
+int g_failures = 0;
+
+void check(bool condition, const char* what) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << std::endl;
+        g_failures++;
+    }
+}
+
+// Every index is visited exactly once
+void testCoverage(TaskPool& pool) {
+    const int length = 10000;
+    std::vector<std::atomic<int>> visits(length);
+    for (int round = 0; round < 200; round++) {
+        for (auto& visit : visits) {
+            visit = 0;
+        }
+        pool.parallelFor(0, length, [&](int begin, int end) {
+            for (int i = begin; i < end; i++) {
+                visits[i]++;
+            }
+        }, 16);
+
+        bool once = true;
+        for (auto& visit : visits) {
+            once = once && visit.load() == 1;
+        }
+        check(once, "every index visited once");
+    }
+}
+
+// Loops started from inside tiles finish without deadlocking
+void testNested(TaskPool& pool) {
+    for (int round = 0; round < 200; round++) {
+        std::atomic<int> total(0);
+        pool.parallelFor(0, 32, [&](int begin, int end) {
+            for (int i = begin; i < end; i++) {
+                pool.parallelFor(0, 64, [&](int inner_begin, int inner_end) {
+                    total += inner_end - inner_begin;
+                }, 4);
+            }
+        }, 1);
+        check(total.load() == 32 * 64, "nested loops cover every inner index");
+    }
+}
+
+// A throwing tile reaches the caller after every other tile has finished
+void testThrowingTile(TaskPool& pool) {
+    for (int round = 0; round < 200; round++) {
+        std::atomic<int> ran(0);
+        bool caught = false;
+        try {
+            pool.parallelFor(0, 64, [&](int begin, int) {
+                ran++;
+                if (begin == 13) {
+                    throw std::runtime_error("tile failed");
+                }
+            }, 1);
+        } catch (const std::runtime_error&) {
+            caught = true;
+        }
+        check(caught, "tile exception rethrown to the caller");
+        check(ran.load() == 64, "remaining tiles still ran");
+    }
+}
+
+} // namespace
+
+int main() {
+    TaskPool& pool = TaskPool::instance();
+    pool.configure(4);
+
+    testCoverage(pool);
+    testNested(pool);
+    testThrowingTile(pool);
+
+    if (g_failures > 0) {
+        std::cerr << g_failures << " task pool check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "Task pool tests passed" << std::endl;
+    return 0;
+}